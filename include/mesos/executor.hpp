@@ -143,6 +143,19 @@ public:
    * callback.
    */
   virtual void error(ExecutorDriver* driver, const std::string& message) = 0;
+
+  /**
+   * Invoked when the driver's internal event queue depth crosses the
+   * threshold given by the MESOS_DRIVER_BACKLOG_THRESHOLD environment
+   * variable (unset disables these notifications), and again only
+   * after the queue has since drained. NOTE: Unlike the other
+   * callbacks this one is NOT serialized with them and may be invoked
+   * from an arbitrary thread; it exists so an executor can shed or
+   * batch work while the driver is backed up, which is exactly when
+   * the serialized callbacks would lag. The default implementation
+   * does nothing.
+   */
+  virtual void backlogged(ExecutorDriver* driver, const DriverStats& stats) {}
 };
 
 
@@ -257,6 +270,14 @@ public:
   virtual Status sendStatusUpdate(const TaskStatus& status);
   virtual Status sendFrameworkMessage(const std::string& data);
 
+  /**
+   * Fills in a snapshot of the driver's internal queue and
+   * send-buffer statistics (see DriverStats in mesos.proto), for
+   * detecting backpressure. Unlike the other calls this never waits
+   * behind the driver's queue and may be invoked from any thread.
+   */
+  virtual Status stats(DriverStats* stats);
+
 private:
   friend class internal::ExecutorProcess;
 
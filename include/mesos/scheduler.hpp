@@ -50,6 +50,14 @@ class SchedulerProcess;
  * so it is not recommended that you block within a callback because
  * it may cause a deadlock.
  *
+ * Schedulers whose callbacks do non-trivial work (e.g., writing
+ * status updates to a database) can opt into concurrent callback
+ * delivery by setting the MESOS_SCHEDULER_CALLBACK_THREADS
+ * environment variable to the desired number of delivery threads. In
+ * that mode callbacks for the same task (and messages from the same
+ * executor) are still delivered in order, but otherwise callbacks may
+ * be invoked concurrently, so the scheduler must be thread safe.
+ *
  * Each callback includes a pointer to the scheduler driver that was
  * used to run this scheduler. The pointer will not change for the
  * duration of a scheduler (i.e., from the point you do
@@ -132,6 +140,23 @@ public:
   virtual void statusUpdate(SchedulerDriver* driver,
                             const TaskStatus& status) = 0;
 
+  /**
+   * Invoked when several status updates arrive together (e.g.,
+   * batched by the master). The default implementation simply invokes
+   * Scheduler::statusUpdate for each update in order, so overriding
+   * this is never required; language bindings override it to amortize
+   * their per-callback overhead across the batch. As with
+   * statusUpdate, returning from this callback acknowledges receipt
+   * of all the updates in the batch.
+   */
+  virtual void statusUpdates(SchedulerDriver* driver,
+                             const std::vector<TaskStatus>& statuses)
+  {
+    for (size_t i = 0; i < statuses.size(); i++) {
+      statusUpdate(driver, statuses[i]);
+    }
+  }
+
   /**
    * Invoked when an executor sends a message. These messages are best
    * effort; do not expect a framework message to be retransmitted in
@@ -166,6 +191,19 @@ public:
    * callback.
    */
   virtual void error(SchedulerDriver* driver, const std::string& message) = 0;
+
+  /**
+   * Invoked when the driver's internal event queue depth crosses the
+   * threshold given by the MESOS_DRIVER_BACKLOG_THRESHOLD environment
+   * variable (unset disables these notifications), and again only
+   * after the queue has since drained. NOTE: Unlike the other
+   * callbacks this one is NOT serialized with them and may be invoked
+   * from an arbitrary thread; it exists so a scheduler can shed or
+   * batch work while the driver is backed up, which is exactly when
+   * the serialized callbacks would lag. The default implementation
+   * does nothing.
+   */
+  virtual void backlogged(SchedulerDriver* driver, const DriverStats& stats) {}
 };
 
 
@@ -238,15 +276,25 @@ public:
    * declined. The specified filters are applied on all unused
    * resources (see mesos.proto for a description of Filters).
    * Invoking this function with an empty collection of tasks declines
-   * this offer in its entirety (see Scheduler::declineOffer). Note
-   * that currently tasks can only be launched per offer. In the
-   * future, frameworks will be allowed to aggregate offers
-   * (resources) to launch their tasks.
+   * this offer in its entirety (see Scheduler::declineOffer).
    */
   virtual Status launchTasks(const OfferID& offerId,
                              const std::vector<TaskInfo>& tasks,
                              const Filters& filters = Filters()) = 0;
 
+  /**
+   * Launches the given set of tasks using the resources from the
+   * given set of offers (which may span multiple slaves). Each task's
+   * 'slave_id' determines which of the offered slaves it runs on. All
+   * of the offers are consumed by a single call: any resources not
+   * used by the tasks or their executors are considered declined and
+   * the specified filters are applied on them, exactly as with the
+   * single offer variant above.
+   */
+  virtual Status launchTasks(const std::vector<OfferID>& offerIds,
+                             const std::vector<TaskInfo>& tasks,
+                             const Filters& filters = Filters()) = 0;
+
   /**
    * Kills the specified task. Note that attempting to kill a task is
    * currently not reliable. If, for example, a scheduler fails over
@@ -347,6 +395,9 @@ public:
   virtual Status launchTasks(const OfferID& offerId,
                              const std::vector<TaskInfo>& tasks,
                              const Filters& filters = Filters());
+  virtual Status launchTasks(const std::vector<OfferID>& offerIds,
+                             const std::vector<TaskInfo>& tasks,
+                             const Filters& filters = Filters());
   virtual Status killTask(const TaskID& taskId);
   virtual Status declineOffer(const OfferID& offerId,
                               const Filters& filters = Filters());
@@ -355,6 +406,14 @@ public:
                                       const SlaveID& slaveId,
                                       const std::string& data);
 
+  /**
+   * Fills in a snapshot of the driver's internal queue and
+   * send-buffer statistics (see DriverStats in mesos.proto), for
+   * detecting backpressure. Unlike the other calls this never waits
+   * behind the driver's queue and may be invoked from any thread.
+   */
+  virtual Status stats(DriverStats* stats);
+
 private:
   Scheduler* scheduler;
   FrameworkInfo framework;
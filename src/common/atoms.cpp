@@ -0,0 +1,47 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+
+#include <set>
+#include <string>
+
+#include "common/atoms.hpp"
+#include "common/lock.hpp"
+
+using std::set;
+using std::string;
+
+namespace mesos {
+namespace internal {
+
+const string* Atom::intern(const string& s)
+{
+  // Elements of a std::set have stable addresses, so pointers into
+  // the table stay valid as it grows. The table is intentionally
+  // leaked (atoms may be compared during static destruction).
+  static set<string>* table = new set<string>();
+  static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+  Lock lock(&mutex);
+
+  return &*table->insert(s).first;
+}
+
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,88 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ATOMS_HPP__
+#define __ATOMS_HPP__
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+namespace mesos {
+namespace internal {
+
+// An interned immutable string. Two atoms constructed from equal
+// strings share the same underlying storage, so equality is a
+// pointer comparison and hashing is a pointer hash, which makes
+// atoms cheap keys on hot paths that would otherwise compare the
+// same names (resource names, roles, framework and slave IDs)
+// character by character over and over. Interning takes a global
+// lock, so construct atoms at the edges and pass them around by
+// value (an atom is a single pointer).
+//
+// Interned strings are never reclaimed; the set of names used in a
+// running master is small and effectively static.
+class Atom
+{
+public:
+  Atom() : str(intern(std::string())) {}
+
+  explicit Atom(const std::string& s) : str(intern(s)) {}
+
+  const std::string& value() const { return *str; }
+
+  operator const std::string& () const { return *str; }
+
+  bool operator == (const Atom& that) const { return str == that.str; }
+  bool operator != (const Atom& that) const { return str != that.str; }
+
+  // Lexicographic, so that replacing a string key with an atom in an
+  // ordered container preserves the ordering (and the pointer check
+  // short-circuits the common equal case).
+  bool operator < (const Atom& that) const
+  {
+    return str != that.str && *str < *that.str;
+  }
+
+private:
+  friend std::size_t hash_value(const Atom& atom);
+
+  // Returns a pointer to the interned copy of 's', inserting it into
+  // the global table if necessary.
+  static const std::string* intern(const std::string& s);
+
+  const std::string* str;
+};
+
+
+// For boost::hash (i.e., hashmap/hashset keyed by Atom).
+inline std::size_t hash_value(const Atom& atom)
+{
+  return reinterpret_cast<std::size_t>(atom.str);
+}
+
+
+inline std::ostream& operator << (std::ostream& stream, const Atom& atom)
+{
+  return stream << atom.value();
+}
+
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __ATOMS_HPP__
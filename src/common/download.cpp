@@ -0,0 +1,370 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_LIBCURL
+#include <curl/curl.h>
+#endif
+
+#include <sys/select.h>
+#include <sys/time.h>
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <process/future.hpp>
+
+#include <stout/bytes.hpp>
+#include <stout/option.hpp>
+
+#include "common/download.hpp"
+
+using process::Future;
+using process::Promise;
+
+using std::list;
+using std::map;
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace download {
+
+#ifndef HAVE_LIBCURL
+
+Future<int> get(
+    const string& url,
+    const string& path,
+    const Option<Bytes>& limit,
+    const Option<Progress>& progress)
+{
+  Promise<int> promise;
+  promise.fail("Mesos was built without libcurl");
+  return promise.future();
+}
+
+#else
+
+namespace {
+
+// Maximum number of transfers performed concurrently; further
+// transfers wait (in submission order) for an active one to finish.
+const size_t MAX_PARALLEL = 8;
+
+// Upper bound on how long the engine thread waits in select(2) when
+// libcurl has no earlier deadline of its own. This bounds the latency
+// of picking up newly submitted transfers.
+const long PICKUP_TIMEOUT_MS = 100;
+
+
+// State for a single transfer, from submission until its future is
+// completed. Owned by the engine (and deleted when finished).
+struct Transfer
+{
+  Transfer(
+      const string& _url,
+      const string& _path,
+      const Option<Bytes>& _limit,
+      const Option<Progress>& _progress)
+    : url(_url),
+      path(_path),
+      limit(_limit),
+      progress(_progress),
+      promise(new Promise<int>()),
+      curl(NULL),
+      file(NULL) {}
+
+  const string url;
+  const string path;
+  const Option<Bytes> limit;
+  const Option<Progress> progress;
+
+  Promise<int>* promise;
+
+  CURL* curl;
+  FILE* file;
+};
+
+
+// Invoked by libcurl (on the engine thread) as a transfer makes
+// progress.
+int progressed(
+    void* data,
+    double downloadTotal,
+    double downloadNow,
+    double uploadTotal,
+    double uploadNow)
+{
+  Transfer* transfer = reinterpret_cast<Transfer*>(data);
+  if (transfer->progress.isSome()) {
+    const Progress& progress = transfer->progress.get();
+    progress((uint64_t) downloadNow, (uint64_t) downloadTotal);
+  }
+  return 0; // Returning non-zero would abort the transfer.
+}
+
+
+// Drives all transfers from a single background thread using one
+// libcurl multi handle. Keeping all the easy handles in one multi
+// handle means connections to the same server get reused across
+// transfers (via the multi handle's connection cache).
+class Engine
+{
+public:
+  static Engine* instance();
+
+  Future<int> submit(
+      const string& url,
+      const string& path,
+      const Option<Bytes>& limit,
+      const Option<Progress>& progress);
+
+private:
+  Engine();
+
+  static void* run(void* arg);
+
+  void loop();
+  void start(Transfer* transfer);
+  void finish(Transfer* transfer, CURLcode code);
+
+  // Protects 'queued'; everything else is only touched by the engine
+  // thread.
+  pthread_mutex_t mutex;
+  list<Transfer*> queued;
+
+  map<CURL*, Transfer*> active;
+
+  CURLM* multi;
+};
+
+
+Engine* engine = NULL;
+pthread_once_t once = PTHREAD_ONCE_INIT;
+
+void initialize()
+{
+  engine = new Engine();
+}
+
+
+Engine* Engine::instance()
+{
+  pthread_once(&once, &initialize);
+  return engine;
+}
+
+
+Engine::Engine()
+{
+  curl_global_init(CURL_GLOBAL_ALL);
+
+  multi = curl_multi_init();
+
+  pthread_mutex_init(&mutex, NULL);
+
+  pthread_t thread;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  pthread_create(&thread, &attr, &Engine::run, this);
+  pthread_attr_destroy(&attr);
+}
+
+
+Future<int> Engine::submit(
+    const string& url,
+    const string& path,
+    const Option<Bytes>& limit,
+    const Option<Progress>& progress)
+{
+  Transfer* transfer = new Transfer(url, path, limit, progress);
+
+  // NOTE: Promise::future() returns by value, hence the named local
+  // (the engine thread may delete the transfer once it's queued).
+  Future<int> future = transfer->promise->future();
+
+  pthread_mutex_lock(&mutex);
+  queued.push_back(transfer);
+  pthread_mutex_unlock(&mutex);
+
+  return future;
+}
+
+
+void* Engine::run(void* arg)
+{
+  Engine* engine = reinterpret_cast<Engine*>(arg);
+  engine->loop();
+  return NULL;
+}
+
+
+void Engine::loop()
+{
+  while (true) {
+    // Pick up newly submitted transfers, respecting the parallelism
+    // limit. Don't hold the lock while touching libcurl.
+    list<Transfer*> starting;
+
+    pthread_mutex_lock(&mutex);
+    while (!queued.empty() && active.size() + starting.size() < MAX_PARALLEL) {
+      starting.push_back(queued.front());
+      queued.pop_front();
+    }
+    pthread_mutex_unlock(&mutex);
+
+    while (!starting.empty()) {
+      start(starting.front());
+      starting.pop_front();
+    }
+
+    int running = 0;
+    curl_multi_perform(multi, &running);
+
+    // Reap completed transfers.
+    CURLMsg* message;
+    int messages = 0;
+    while ((message = curl_multi_info_read(multi, &messages)) != NULL) {
+      if (message->msg == CURLMSG_DONE) {
+        CURL* handle = message->easy_handle;
+        CURLcode code = message->data.result;
+        Transfer* transfer = active[handle];
+        active.erase(handle);
+        curl_multi_remove_handle(multi, handle);
+        finish(transfer, code);
+      }
+    }
+
+    // Wait until libcurl has work to do (or our pickup timeout
+    // expires, so that newly submitted transfers get started
+    // promptly).
+    fd_set read;
+    fd_set write;
+    fd_set error;
+    FD_ZERO(&read);
+    FD_ZERO(&write);
+    FD_ZERO(&error);
+
+    int max = -1;
+    curl_multi_fdset(multi, &read, &write, &error, &max);
+
+    long timeout = -1;
+    curl_multi_timeout(multi, &timeout);
+    if (timeout < 0 || timeout > PICKUP_TIMEOUT_MS) {
+      timeout = PICKUP_TIMEOUT_MS;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    if (max >= 0) {
+      select(max + 1, &read, &write, &error, &tv);
+    } else {
+      // No descriptors to watch yet (e.g., connections still being
+      // set up, or nothing active); just sleep for the timeout.
+      select(0, NULL, NULL, NULL, &tv);
+    }
+  }
+}
+
+
+void Engine::start(Transfer* transfer)
+{
+  transfer->file = fopen(transfer->path.c_str(), "w");
+  if (transfer->file == NULL) {
+    transfer->promise->fail(
+        "Failed to open '" + transfer->path + "': " + strerror(errno));
+    delete transfer->promise;
+    delete transfer;
+    return;
+  }
+
+  transfer->curl = curl_easy_init();
+
+  curl_easy_setopt(transfer->curl, CURLOPT_URL, transfer->url.c_str());
+
+  // The default write function writes to the FILE* passed via
+  // CURLOPT_WRITEDATA (same trick as net::download).
+  curl_easy_setopt(transfer->curl, CURLOPT_WRITEFUNCTION, NULL);
+  curl_easy_setopt(transfer->curl, CURLOPT_WRITEDATA, transfer->file);
+
+  // We drive libcurl from a thread, so it must not use signals for
+  // its timeouts.
+  curl_easy_setopt(transfer->curl, CURLOPT_NOSIGNAL, 1);
+
+  if (transfer->limit.isSome() && transfer->limit.get().bytes() > 0) {
+    curl_easy_setopt(
+        transfer->curl,
+        CURLOPT_MAX_RECV_SPEED_LARGE,
+        (curl_off_t) transfer->limit.get().bytes());
+  }
+
+  if (transfer->progress.isSome()) {
+    curl_easy_setopt(transfer->curl, CURLOPT_NOPROGRESS, 0);
+    curl_easy_setopt(transfer->curl, CURLOPT_PROGRESSFUNCTION, &progressed);
+    curl_easy_setopt(transfer->curl, CURLOPT_PROGRESSDATA, transfer);
+  }
+
+  active[transfer->curl] = transfer;
+
+  curl_multi_add_handle(multi, transfer->curl);
+}
+
+
+void Engine::finish(Transfer* transfer, CURLcode code)
+{
+  fclose(transfer->file);
+
+  if (code != CURLE_OK) {
+    transfer->promise->fail(curl_easy_strerror(code));
+  } else {
+    long response;
+    curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &response);
+    transfer->promise->set((int) response);
+  }
+
+  curl_easy_cleanup(transfer->curl);
+
+  delete transfer->promise;
+  delete transfer;
+}
+
+} // namespace {
+
+
+Future<int> get(
+    const string& url,
+    const string& path,
+    const Option<Bytes>& limit,
+    const Option<Progress>& progress)
+{
+  return Engine::instance()->submit(url, path, limit, progress);
+}
+
+#endif // HAVE_LIBCURL
+
+} // namespace download {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,67 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DOWNLOAD_HPP__
+#define __DOWNLOAD_HPP__
+
+#include <stdint.h>
+
+#include <string>
+
+#include <tr1/functional>
+
+#include <process/future.hpp>
+
+#include <stout/bytes.hpp>
+#include <stout/option.hpp>
+
+namespace mesos {
+namespace internal {
+namespace download {
+
+// Invoked (from the engine's transfer thread) as a download makes
+// progress, with the bytes downloaded so far and the total expected
+// bytes (0 if the server did not report a length). Callbacks must be
+// cheap and must not block; dispatch to a process for anything more.
+typedef std::tr1::function<void(uint64_t, uint64_t)> Progress;
+
+
+// Asynchronously downloads the specified HTTP or FTP URL into a file
+// at the specified path, returning the HTTP/FTP response code. All
+// downloads share a single libcurl multi engine driven by one
+// background thread, so transfers run concurrently (up to an
+// engine-wide parallelism limit; further transfers wait in
+// submission order) and connections to a server get reused across
+// transfers rather than re-established per transfer. An optional
+// 'limit' caps the transfer rate in bytes per second; an optional
+// 'progress' callback reports progress (see above). The returned
+// future fails on transport errors (and when Mesos was built without
+// libcurl). This is the shared download path for anything in the
+// master or slave that needs HTTP; the executor launcher, being a
+// standalone program, still uses net::download directly.
+process::Future<int> get(
+    const std::string& url,
+    const std::string& path,
+    const Option<Bytes>& limit = Option<Bytes>::none(),
+    const Option<Progress>& progress = Option<Progress>::none());
+
+} // namespace download {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __DOWNLOAD_HPP__
@@ -0,0 +1,163 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include <process/statistics.hpp>
+
+#include <stout/foreach.hpp>
+
+#include "common/lock.hpp"
+#include "common/metrics.hpp"
+
+using std::map;
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace metrics {
+
+uint64_t Histogram::count() const
+{
+  uint64_t total = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    total += buckets[i];
+  }
+  return total;
+}
+
+
+double Histogram::percentile(double p) const
+{
+  uint64_t total = count();
+  if (total == 0) {
+    return 0.0;
+  }
+
+  uint64_t target = (uint64_t) (p * total + 0.5);
+  if (target == 0) {
+    target = 1;
+  }
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= target) {
+      // The upper boundary of bucket i, see the bucket layout
+      // described in metrics.hpp.
+      return ldexp(1.0, i + 1);
+    }
+  }
+
+  return ldexp(1.0, BUCKETS);
+}
+
+
+Registry::Registry()
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+
+Registry::~Registry()
+{
+  foreachvalue (Counter* counter, counters) {
+    delete counter;
+  }
+  foreachvalue (Gauge* gauge, gauges) {
+    delete gauge;
+  }
+  foreachvalue (Histogram* histogram, histograms) {
+    delete histogram;
+  }
+
+  pthread_mutex_destroy(&mutex);
+}
+
+
+Counter* Registry::counter(const string& name)
+{
+  Lock lock(&mutex);
+  if (!counters.contains(name)) {
+    counters[name] = new Counter();
+  }
+  return counters[name];
+}
+
+
+Gauge* Registry::gauge(const string& name)
+{
+  Lock lock(&mutex);
+  if (!gauges.contains(name)) {
+    gauges[name] = new Gauge();
+  }
+  return gauges[name];
+}
+
+
+Histogram* Registry::histogram(const string& name)
+{
+  Lock lock(&mutex);
+  if (!histograms.contains(name)) {
+    histograms[name] = new Histogram();
+  }
+  return histograms[name];
+}
+
+
+map<string, double> Registry::snapshot() const
+{
+  map<string, double> values;
+
+  Lock lock(&mutex);
+
+  foreachpair (const string& name, Counter* counter, counters) {
+    values[name] = counter->get();
+  }
+
+  foreachpair (const string& name, Gauge* gauge, gauges) {
+    values[name] = gauge->get();
+  }
+
+  foreachpair (const string& name, Histogram* histogram, histograms) {
+    values[name + "_count"] = histogram->count();
+    values[name + "_p50"] = histogram->percentile(0.50);
+    values[name + "_p90"] = histogram->percentile(0.90);
+    values[name + "_p99"] = histogram->percentile(0.99);
+  }
+
+  return values;
+}
+
+
+void Registry::publish(const string& context) const
+{
+  map<string, double> values = snapshot();
+
+  foreachpair (const string& name, double value, values) {
+    process::statistics->set(context, name, value);
+  }
+}
+
+} // namespace metrics {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,214 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __METRICS_HPP__
+#define __METRICS_HPP__
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+
+#include <stout/hashmap.hpp>
+#include <stout/stopwatch.hpp>
+
+namespace mesos {
+namespace internal {
+namespace metrics {
+
+// A registry of named counters, gauges and histograms, shared by the
+// master, slave and allocator. Components register their instruments
+// once at initialization and record into the returned objects on
+// their hot paths: recording is a single atomic operation and never
+// takes the registry lock, so it is safe (and cheap) from any thread.
+// The registry renders a flattened snapshot for the JSON endpoints
+// and can publish the same snapshot into the process::Statistics
+// time series store (see Registry::publish).
+
+
+// A monotonically increasing counter.
+class Counter
+{
+public:
+  Counter() : value(0) {}
+
+  void increment(uint64_t amount = 1)
+  {
+    __sync_fetch_and_add(&value, amount);
+  }
+
+  uint64_t get() const
+  {
+    return __sync_fetch_and_add(const_cast<volatile uint64_t*>(&value), 0);
+  }
+
+private:
+  Counter(const Counter&);              // No copying.
+  Counter& operator = (const Counter&); // No assigning.
+
+  volatile uint64_t value;
+};
+
+
+// A point-in-time value (e.g., offers outstanding, queue depth). The
+// double is stored through its bit pattern so that sets and gets are
+// single atomic operations rather than torn word writes.
+class Gauge
+{
+public:
+  Gauge() : bits(0) {}
+
+  void set(double value)
+  {
+    uint64_t b;
+    memcpy(&b, &value, sizeof(b));
+    __sync_lock_test_and_set(&bits, b);
+  }
+
+  double get() const
+  {
+    uint64_t b =
+      __sync_fetch_and_add(const_cast<volatile uint64_t*>(&bits), 0);
+    double value;
+    memcpy(&value, &b, sizeof(value));
+    return value;
+  }
+
+private:
+  Gauge(const Gauge&);              // No copying.
+  Gauge& operator = (const Gauge&); // No assigning.
+
+  volatile uint64_t bits;
+};
+
+
+// A histogram over power-of-two buckets: bucket 0 holds values in
+// [0, 2), bucket i holds values in [2^i, 2^(i+1)). Recording costs
+// two atomic increments; percentiles are estimated from the bucket
+// boundaries when read, so they are accurate to within a factor of
+// two (plenty for latency monitoring, where order of magnitude is
+// what matters). Values must be non-negative; pick units so that the
+// interesting range is well above 1 (e.g., microseconds).
+class Histogram
+{
+public:
+  static const size_t BUCKETS = 64;
+
+  Histogram()
+  {
+    for (size_t i = 0; i < BUCKETS; i++) {
+      buckets[i] = 0;
+    }
+  }
+
+  void record(double value)
+  {
+    size_t bucket = 0;
+    uint64_t integral = (uint64_t) value;
+    while (integral >>= 1) {
+      bucket++;
+    }
+    if (bucket > BUCKETS - 1) {
+      bucket = BUCKETS - 1;
+    }
+    __sync_fetch_and_add(&buckets[bucket], 1);
+  }
+
+  uint64_t count() const;
+
+  // Returns an estimate (the upper bucket boundary) of the value at
+  // the given percentile in [0.0, 1.0], or 0 if nothing has been
+  // recorded yet.
+  double percentile(double p) const;
+
+private:
+  Histogram(const Histogram&);              // No copying.
+  Histogram& operator = (const Histogram&); // No assigning.
+
+  volatile uint64_t buckets[BUCKETS];
+};
+
+
+// Records the lifetime of the enclosing scope into a histogram, in
+// microseconds. Handlers drop one of these at the top of the
+// function to get their latency recorded on every exit path.
+class Timed
+{
+public:
+  explicit Timed(Histogram* _histogram) : histogram(_histogram)
+  {
+    stopwatch.start();
+  }
+
+  ~Timed()
+  {
+    histogram->record(stopwatch.elapsed().us());
+  }
+
+private:
+  Timed(const Timed&);              // No copying.
+  Timed& operator = (const Timed&); // No assigning.
+
+  Histogram* histogram;
+  Stopwatch stopwatch;
+};
+
+
+class Registry
+{
+public:
+  Registry();
+  ~Registry();
+
+  // Returns the counter / gauge / histogram registered under 'name',
+  // creating it on first use. The returned pointer remains valid for
+  // the lifetime of the registry, so callers should look up their
+  // instruments once and keep the pointer.
+  Counter* counter(const std::string& name);
+  Gauge* gauge(const std::string& name);
+  Histogram* histogram(const std::string& name);
+
+  // Returns a flattened view of every metric: counters and gauges
+  // under their own names, histograms as '<name>_count',
+  // '<name>_p50', '<name>_p90' and '<name>_p99'.
+  std::map<std::string, double> snapshot() const;
+
+  // Writes the snapshot into the process-wide statistics time series
+  // under the given context (see process/statistics.hpp).
+  void publish(const std::string& context) const;
+
+private:
+  Registry(const Registry&);              // No copying.
+  Registry& operator = (const Registry&); // No assigning.
+
+  // Protects the maps below; recording into an already registered
+  // instrument does not take this lock.
+  mutable pthread_mutex_t mutex;
+
+  hashmap<std::string, Counter*> counters;
+  hashmap<std::string, Gauge*> gauges;
+  hashmap<std::string, Histogram*> histograms;
+};
+
+} // namespace metrics {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __METRICS_HPP__
@@ -19,10 +19,13 @@
 #ifndef __PROTOBUF_UTILS_HPP__
 #define __PROTOBUF_UTILS_HPP__
 
+#include <stdint.h>
+
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 
 #include <stout/none.hpp>
+#include <stout/stringify.hpp>
 #include <stout/uuid.hpp>
 
 #include "common/type_utils.hpp"
@@ -90,6 +93,41 @@ inline Task createTask(const TaskInfo& task,
   return t;
 }
 
+
+// 64 bit FNV-1a hash of 'data'. The result can be fed back in as
+// 'seed' to chain hashes.
+inline uint64_t fnv1a(
+    const std::string& data,
+    uint64_t seed = 14695981039346656037ULL)
+{
+  uint64_t hash = seed;
+  for (size_t i = 0; i < data.size(); i++) {
+    hash ^= (uint8_t) data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+
+// Digest contributions of a framework's state on a slave, used by
+// digest based slave re-registration (see ReregisterSlaveMessage).
+// Contributions are combined by addition, which makes a framework's
+// digest independent of enumeration order; the slave and the master
+// compute digests independently and equality means the master's view
+// of the framework's executors and tasks on the slave is current.
+inline uint64_t digest(const Task& task)
+{
+  return fnv1a(stringify(task.state()), fnv1a(task.task_id().value()));
+}
+
+
+inline uint64_t digest(const ExecutorID& executorId)
+{
+  // Seeded differently than task digests so that a task and an
+  // executor with the same name contribute differently.
+  return fnv1a(executorId.value(), 1099511628211ULL);
+}
+
 } // namespace protobuf
 } // namespace internal {
 } // namespace mesos {
@@ -0,0 +1,266 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <stout/crc32c.hpp>
+#include <stout/error.hpp>
+#include <stout/os.hpp>
+#include <stout/stringify.hpp>
+
+#include "common/records.hpp"
+
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace records {
+
+namespace {
+
+const char MAGIC[8] = { 'M', 'E', 'S', 'O', 'S', 'R', 'E', 'C' };
+const uint32_t VERSION = 1;
+const uint32_t SENTINEL = 0xffffffff; // Footer length marker.
+
+
+// Legacy CRC-32 (as in IEEE 802.3), table driven, only used to
+// verify records written before the switch to CRC-32C (which has
+// hardware support via SSE4.2; see stout/crc32c.hpp). The table is
+// filled in by a static initializer before main().
+struct Table
+{
+  Table()
+  {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int j = 0; j < 8; j++) {
+        crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+      }
+      entries[i] = crc;
+    }
+  }
+
+  uint32_t entries[256];
+} table;
+
+
+uint32_t crc32(const char* data, size_t length)
+{
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < length; i++) {
+    crc = (crc >> 8) ^ table.entries[(crc ^ (uint8_t) data[i]) & 0xff];
+  }
+  return crc ^ 0xffffffff;
+}
+
+} // namespace {
+
+
+bool framed(const string& path)
+{
+  Try<int> fd = os::open(path, O_RDONLY);
+  if (fd.isError()) {
+    return false;
+  }
+
+  char magic[sizeof(MAGIC)];
+  ssize_t length;
+  do {
+    length = ::read(fd.get(), magic, sizeof(magic));
+  } while (length < 0 && errno == EINTR);
+
+  os::close(fd.get());
+
+  return length == sizeof(magic) &&
+    ::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+
+Try<Nothing> header(int fd)
+{
+  string buffer(MAGIC, sizeof(MAGIC));
+  buffer.append((const char*) &VERSION, sizeof(VERSION));
+  return os::write(fd, buffer);
+}
+
+
+Try<Nothing> write(int fd, const google::protobuf::Message& message)
+{
+  string payload;
+  if (!message.SerializeToString(&payload)) {
+    return Error("Failed to serialize " + message.GetTypeName());
+  }
+
+  return write(fd, payload);
+}
+
+
+Try<Nothing> write(int fd, const string& payload)
+{
+  uint32_t length = payload.size();
+  uint32_t crc = crc32c::checksum(payload.data(), payload.size());
+
+  // Frame the record into a single buffer so that appending it costs
+  // a single write(2).
+  string buffer;
+  buffer.reserve(sizeof(length) + sizeof(crc) + payload.size());
+  buffer.append((const char*) &length, sizeof(length));
+  buffer.append((const char*) &crc, sizeof(crc));
+  buffer.append(payload);
+
+  return os::write(fd, buffer);
+}
+
+
+Try<Nothing> footer(int fd)
+{
+  uint32_t crc = crc32c::checksum(MAGIC, sizeof(MAGIC));
+
+  string buffer((const char*) &SENTINEL, sizeof(SENTINEL));
+  buffer.append((const char*) &crc, sizeof(crc));
+
+  return os::write(fd, buffer);
+}
+
+
+Try<Reader*> Reader::open(const string& path)
+{
+  Try<int> fd = os::open(path, O_RDONLY);
+  if (fd.isError()) {
+    return Error("Failed to open '" + path + "': " + fd.error());
+  }
+
+  struct stat s;
+  if (::fstat(fd.get(), &s) < 0) {
+    ErrnoError error("Failed to fstat '" + path + "'");
+    os::close(fd.get());
+    return error;
+  }
+
+  if ((size_t) s.st_size < sizeof(MAGIC) + sizeof(VERSION)) {
+    os::close(fd.get());
+    return Error("File '" + path + "' is too short for a stream header");
+  }
+
+  void* data =
+    ::mmap(NULL, s.st_size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+
+  if (data == MAP_FAILED) {
+    ErrnoError error("Failed to mmap '" + path + "'");
+    os::close(fd.get());
+    return error;
+  }
+
+  if (::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+    ::munmap(data, s.st_size);
+    os::close(fd.get());
+    return Error("File '" + path + "' lacks the stream magic");
+  }
+
+  uint32_t version;
+  ::memcpy(&version, (const char*) data + sizeof(MAGIC), sizeof(version));
+
+  if (version != VERSION) {
+    ::munmap(data, s.st_size);
+    os::close(fd.get());
+    return Error("File '" + path + "' has unknown stream version " +
+                 stringify(version));
+  }
+
+  return new Reader(fd.get(), (const char*) data, s.st_size);
+}
+
+
+Reader::Reader(int _fd, const char* _data, size_t _length)
+  : fd(_fd),
+    data(_data),
+    length(_length),
+    position(sizeof(MAGIC) + sizeof(VERSION)),
+    valid(sizeof(MAGIC) + sizeof(VERSION)) {}
+
+
+Reader::~Reader()
+{
+  ::munmap((void*) data, length);
+  os::close(fd);
+}
+
+
+Result<std::pair<const char*, uint32_t> > Reader::next()
+{
+  while (true) {
+    if (position == length) {
+      return None();
+    }
+
+    uint32_t size;
+    uint32_t crc;
+
+    if (length - position < sizeof(size) + sizeof(crc)) {
+      return Error("Torn record frame at offset " + stringify(position));
+    }
+
+    ::memcpy(&size, data + position, sizeof(size));
+    ::memcpy(&crc, data + position + sizeof(size), sizeof(crc));
+
+    if (size == SENTINEL) {
+      // A clean-close footer; verify and skip it. Also accept the
+      // legacy CRC-32 so streams written (or appended to) by older
+      // slaves still replay.
+      if (crc != crc32c::checksum(MAGIC, sizeof(MAGIC)) &&
+          crc != crc32(MAGIC, sizeof(MAGIC))) {
+        return Error("Corrupt footer at offset " + stringify(position));
+      }
+      position += sizeof(size) + sizeof(crc);
+      valid = position;
+      continue;
+    }
+
+    if (size > length - position - sizeof(size) - sizeof(crc)) {
+      return Error("Torn record of claimed length " + stringify(size) +
+                   " at offset " + stringify(position));
+    }
+
+    const char* payload = data + position + sizeof(size) + sizeof(crc);
+
+    if (crc32c::checksum(payload, size) != crc &&
+        crc32(payload, size) != crc) {
+      return Error("Record checksum mismatch at offset " +
+                   stringify(position));
+    }
+
+    position += sizeof(size) + sizeof(crc) + size;
+    valid = position;
+
+    return std::make_pair(payload, size);
+  }
+}
+
+} // namespace records {
+} // namespace internal {
+} // namespace mesos {
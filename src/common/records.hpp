@@ -0,0 +1,149 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __COMMON_RECORDS_HPP__
+#define __COMMON_RECORDS_HPP__
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+
+#include <google/protobuf/message.h>
+
+#include <stout/nothing.hpp>
+#include <stout/result.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace records {
+
+// A framed checkpoint stream format:
+//
+//   file   := header record* footer?
+//   header := magic[8] version(uint32)
+//   record := length(uint32) crc(uint32) payload[length]
+//   footer := 0xFFFFFFFF(uint32) crc(uint32)
+//
+// All integers are in native byte order, since checkpoints are
+// written and recovered on the same host. The crc (CRC-32C, see
+// stout/crc32c.hpp; readers also accept the legacy CRC-32 written by
+// older slaves) in a record covers its payload, so that a record
+// interrupted by a crash
+// or power loss (a "torn write") is detected during replay rather
+// than parsed as garbage. The footer, whose crc covers the magic
+// (making it self validating), marks a clean close of a write
+// session; because streams are reopened and appended to across slave
+// restarts, a file may contain footers in the middle, which readers
+// skip.
+//
+// Each record is framed into a single buffer before being written, so
+// appending costs one write(2) (::protobuf::write() costs two), and
+// the reader mmap(2)s the file and parses records out of the mapping
+// without copying them.
+
+
+// Returns true if the file at 'path' begins with the stream header
+// above (rather than, e.g., the plain length-prefixed format of
+// ::protobuf::write()).
+bool framed(const std::string& path);
+
+
+// Appends the stream header to 'fd'. Should only be done to an empty
+// file, before any records are written.
+Try<Nothing> header(int fd);
+
+
+// Appends a record framing the serialized 'message' to 'fd'.
+Try<Nothing> write(int fd, const google::protobuf::Message& message);
+
+
+// Appends a record framing the raw 'payload' to 'fd', for streams
+// whose records are not single protobufs (e.g., master/capture.hpp).
+Try<Nothing> write(int fd, const std::string& payload);
+
+
+// Appends a clean-close footer to 'fd'.
+Try<Nothing> footer(int fd);
+
+
+// Replays a framed stream by mapping the file into memory and parsing
+// records out of the mapping (zero copy). Parsing stops at the first
+// torn or corrupt record, so everything before it can be recovered
+// and the tail repaired (see offset()).
+class Reader
+{
+public:
+  // Maps the file at 'path', verifying the stream header.
+  static Try<Reader*> open(const std::string& path);
+
+  ~Reader();
+
+  // Parses the next record into a message of type T. Returns None at
+  // the end of the valid data, or an error if the remaining bytes are
+  // a torn or corrupt tail.
+  template <typename T>
+  Result<T> read()
+  {
+    Result<std::pair<const char*, uint32_t> > record = next();
+
+    if (record.isError()) {
+      return Error(record.error());
+    } else if (record.isNone()) {
+      return None();
+    }
+
+    T t;
+    if (!t.ParseFromArray(record.get().first, record.get().second)) {
+      return Error("Failed to parse " + t.GetTypeName() +
+                   " record ending at offset " + stringify(valid));
+    }
+
+    return t;
+  }
+
+  // Returns a view of the next record's payload within the mapping,
+  // None at the end of the valid data, or an error as above.
+  Result<std::pair<const char*, uint32_t> > next();
+
+  // Offset just past the last whole, checksummed record (or footer).
+  // Truncating the file to this length repairs a torn tail.
+  size_t offset() const { return valid; }
+
+private:
+  Reader(int fd, const char* data, size_t length);
+
+  // No copying, no assigning.
+  Reader(const Reader&);
+  Reader& operator = (const Reader&);
+
+  const int fd;
+  const char* const data; // The mapping.
+  const size_t length;    // Size of the mapping.
+
+  size_t position; // Offset of the first unparsed byte.
+  size_t valid;    // Offset just past the last valid record.
+};
+
+} // namespace records {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __COMMON_RECORDS_HPP__
@@ -17,7 +17,6 @@
  */
 
 #include <iostream>
-#include <vector>
 
 #include <glog/logging.h>
 
@@ -31,7 +30,6 @@
 
 using std::ostream;
 using std::string;
-using std::vector;
 
 
 namespace mesos {
@@ -197,18 +195,32 @@ Resource Resources::parse(const std::string& name, const std::string& text)
 
 Resources Resources::parse(const string& s)
 {
-  // Tokenize and parse the value of "resources".
+  // Split the value of "resources" in a single pass: pairs are
+  // separated by ';' or '\n' and a single ':' separates each name
+  // from its value. No intermediate token vectors are built; only
+  // the name and value substrings themselves are extracted.
   Resources resources;
 
-  vector<string> tokens = strings::tokenize(s, ";\n");
+  size_t begin = 0;
+  while (begin < s.size()) {
+    size_t end = s.find_first_of(";\n", begin);
+    if (end == string::npos) {
+      end = s.size();
+    }
+
+    if (end > begin) { // Skip empty pairs (consecutive separators).
+      size_t colon = s.find(':', begin);
+      if (colon >= end || s.find(':', colon + 1) < end) {
+        LOG(FATAL) << "Bad value for resources, missing or extra ':' within "
+                   << s.substr(begin, end - begin);
+      }
 
-  for (size_t i = 0; i < tokens.size(); i++) {
-    const vector<string>& pairs = strings::tokenize(tokens[i], ":");
-    if (pairs.size() != 2) {
-      LOG(FATAL) << "Bad value for resources, missing ':' within " << pairs[0];
+      resources += parse(
+          s.substr(begin, colon - begin),
+          s.substr(colon + 1, end - colon - 1));
     }
 
-    resources += parse(pairs[0], pairs[1]);
+    begin = end + 1;
   }
 
   return resources;
@@ -19,7 +19,11 @@
 #ifndef __RESOURCES_HPP__
 #define __RESOURCES_HPP__
 
+#include <stdint.h>
+#include <string.h>
+
 #include <iterator>
+#include <tr1/memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -84,25 +88,22 @@ namespace internal {
 class Resources
 {
 public:
-  Resources() {}
+  Resources() : data(new Data()) {}
 
   Resources(const google::protobuf::RepeatedPtrField<Resource>& _resources)
+    : data(new Data())
   {
-    resources.MergeFrom(_resources);
+    data->resources.MergeFrom(_resources);
   }
 
+  // Copies (and assignments) share the body: the first mutation
+  // through either object clones it, see own().
   Resources(const Resources& that)
-  {
-    resources.MergeFrom(that.resources);
-  }
+    : data(that.data) {}
 
   Resources& operator = (const Resources& that)
   {
-    if (this != &that) {
-      resources.Clear();
-      resources.MergeFrom(that.resources);
-    }
-
+    data = that.data;
     return *this;
   }
 
@@ -111,9 +112,9 @@ public:
   {
     Resources result;
 
-    foreach (const Resource& resource, resources) {
+    foreach (const Resource& resource, data->resources) {
       if (isAllocatable(resource)) {
-        result.resources.Add()->MergeFrom(resource);
+        result.data->resources.Add()->MergeFrom(resource);
       }
     }
 
@@ -122,14 +123,14 @@ public:
 
   size_t size() const
   {
-    return resources.size();
+    return data->resources.size();
   }
 
   // Using this operator makes it easy to copy a resources object into
   // a protocol buffer field.
   operator const google::protobuf::RepeatedPtrField<Resource>& () const
   {
-    return resources;
+    return data->resources;
   }
 
   bool operator == (const Resources& that) const
@@ -138,7 +139,14 @@ public:
       return false;
     }
 
-    foreach (const Resource& resource, resources) {
+    // Equal collections hash equally (the hash is insensitive to
+    // ordering, like the comparison below), so a hash mismatch
+    // rejects without walking both collections.
+    if (hash() != that.hash()) {
+      return false;
+    }
+
+    foreach (const Resource& resource, data->resources) {
       Option<Resource> option = that.get(resource);
       if (option.isNone()) {
         return false;
@@ -154,7 +162,7 @@ public:
 
   bool operator <= (const Resources& that) const
   {
-    foreach (const Resource& resource, resources) {
+    foreach (const Resource& resource, data->resources) {
       Option<Resource> option = that.get(resource);
       if (option.isNone()) {
         return false;
@@ -172,7 +180,7 @@ public:
   {
     Resources result(*this);
 
-    foreach (const Resource& resource, that.resources) {
+    foreach (const Resource& resource, that.data->resources) {
       result += resource;
     }
 
@@ -183,7 +191,7 @@ public:
   {
     Resources result(*this);
 
-    foreach (const Resource& resource, that.resources) {
+    foreach (const Resource& resource, that.data->resources) {
       result -= resource;
     }
 
@@ -192,7 +200,7 @@ public:
 
   Resources& operator += (const Resources& that)
   {
-    foreach (const Resource& resource, that.resources) {
+    foreach (const Resource& resource, that.data->resources) {
       *this += resource;
     }
 
@@ -201,7 +209,7 @@ public:
 
   Resources& operator -= (const Resources& that)
   {
-    foreach (const Resource& resource, that.resources) {
+    foreach (const Resource& resource, that.data->resources) {
       *this -= resource;
     }
 
@@ -210,58 +218,57 @@ public:
 
   Resources operator + (const Resource& that) const
   {
-    Resources result;
-
-    bool added = false;
-
-    foreach (const Resource& resource, resources) {
-      if (resource.name() == that.name() &&
-          resource.type() == that.type()) {
-        result.resources.Add()->MergeFrom(resource + that);
-        added = true;
-      } else {
-        result.resources.Add()->MergeFrom(resource);
-      }
-    }
-
-    if (!added) {
-      result.resources.Add()->MergeFrom(that);
-    }
-
+    Resources result(*this);
+    result += that;
     return result;
   }
 
   Resources operator - (const Resource& that) const
   {
-    Resources result;
-
-    foreach (const Resource& resource, resources) {
-      if (resource.name() == that.name() &&
-          resource.type() == that.type()) {
-        result.resources.Add()->MergeFrom(resource - that);
-      } else {
-        result.resources.Add()->MergeFrom(resource);
-      }
-    }
-
+    Resources result(*this);
+    result -= that;
     return result;
   }
 
+  // The compound assignments merge in place: they find the matching
+  // resource and mutate it, rather than rebuilding (and copying) the
+  // entire collection the way operator+/- must.
   Resources& operator += (const Resource& that)
   {
-    *this = *this + that;
+    own();
+
+    for (int i = 0; i < data->resources.size(); i++) {
+      Resource* resource = data->resources.Mutable(i);
+      if (resource->name() == that.name() &&
+          resource->type() == that.type()) {
+        *resource += that;
+        return *this;
+      }
+    }
+
+    data->resources.Add()->MergeFrom(that);
     return *this;
   }
 
   Resources& operator -= (const Resource& that)
   {
-    *this = *this - that;
+    own();
+
+    for (int i = 0; i < data->resources.size(); i++) {
+      Resource* resource = data->resources.Mutable(i);
+      if (resource->name() == that.name() &&
+          resource->type() == that.type()) {
+        *resource -= that;
+        break;
+      }
+    }
+
     return *this;
   }
 
   Option<Resource> get(const Resource& r) const
   {
-    foreach (const Resource& resource, resources) {
+    foreach (const Resource& resource, data->resources) {
       if (resource.name() == r.name() &&
           resource.type() == r.type()) {
         return resource;
@@ -274,12 +281,16 @@ public:
   template <typename T>
   T get(const std::string& name, const T& t) const;
 
-  // Helpers to get known resource types.
+  // Helpers to get the well known resource types. The scalar
+  // accessors are direct slot reads backed by the flat index, with
+  // no string comparison or runtime type dispatch; prefer them to
+  // get<T>(name, default) at call sites that name these resources
+  // with literals.
   // TODO(vinod): Fix this when we make these types as first class protobufs.
-  Option<double> cpus();
-  Option<double> mem();
-  Option<double> disk();
-  Option<Value::Ranges> ports(); // TODO(vinod): Provide a Ranges abstraction.
+  Option<double> cpus() const;
+  Option<double> mem() const;
+  Option<double> disk() const;
+  Option<Value::Ranges> ports() const; // TODO(vinod): Provide a Ranges abstraction.
 
   typedef google::protobuf::RepeatedPtrField<Resource>::iterator
   iterator;
@@ -287,11 +298,11 @@ public:
   typedef google::protobuf::RepeatedPtrField<Resource>::const_iterator
   const_iterator;
 
-  iterator begin() { return resources.begin(); }
-  iterator end() { return resources.end(); }
+  iterator begin() { own(); return data->resources.begin(); }
+  iterator end() { own(); return data->resources.end(); }
 
-  const_iterator begin() const { return resources.begin(); }
-  const_iterator end() const { return resources.end(); }
+  const_iterator begin() const { return data->resources.begin(); }
+  const_iterator end() const { return data->resources.end(); }
 
   static Resource parse(const std::string& name, const std::string& value);
   static Resources parse(const std::string& s);
@@ -371,7 +382,158 @@ public:
   }
 
 private:
-  google::protobuf::RepeatedPtrField<Resource> resources;
+  // The well known scalar resources get fixed slots in a flat array
+  // in the body so that the hot accessors (cpus, mem, disk and the
+  // scalar get) can read a double directly instead of re-scanning
+  // the repeated protobuf field and comparing names each time.
+  enum Slot {
+    CPUS = 0,
+    MEM = 1,
+    DISK = 2,
+    NUM_SLOTS = 3
+  };
+
+  // The body of the collection: the protobuf plus the derived state
+  // cached off it (the fixed slots and the content hash). A
+  // Resources object holds a shared pointer to its body, so copying
+  // Resources shares one body; mutation clones the body first if it
+  // is shared (copy-on-write, see own()). The common pattern --
+  // built once by the master, then read many times by the allocator
+  // and the sorters -- therefore passes a single buffer across the
+  // dispatch boundary instead of deep-copying at every hop.
+  struct Data
+  {
+    Data() : indexed(false), hashed(false) {}
+
+    google::protobuf::RepeatedPtrField<Resource> resources;
+
+    bool indexed;
+    bool present[NUM_SLOTS];
+    double slots[NUM_SLOTS];
+
+    bool hashed;
+    size_t hash;
+  };
+
+  // Ensures this object exclusively owns its body before a mutation,
+  // cloning the body if it is currently shared, and marks the
+  // derived state stale.
+  void own()
+  {
+    if (!data.unique()) {
+      std::tr1::shared_ptr<Data> copy(new Data());
+      copy->resources.MergeFrom(data->resources);
+      data = copy;
+    }
+
+    data->indexed = false;
+    data->hashed = false;
+  }
+
+  static int slot(const std::string& name)
+  {
+    if (name == "cpus") return CPUS;
+    if (name == "mem") return MEM;
+    if (name == "disk") return DISK;
+    return -1;
+  }
+
+  // Returns a content hash of the collection, built lazily. The hash
+  // is commutative over the resources (summed contributions) so it
+  // is insensitive to ordering, and for non-scalar types it covers
+  // only the name and type: ranges and sets compare equal under
+  // reordering and coalescing, which a hash of their raw contents
+  // would not respect. Equal collections therefore always hash
+  // equally, which is what operator == relies on to reject on a
+  // mismatch.
+  size_t hash() const
+  {
+    if (data->hashed) {
+      return data->hash;
+    }
+
+    size_t result = 0;
+
+    foreach (const Resource& resource, data->resources) {
+      size_t h = 0;
+
+      const std::string& name = resource.name();
+      for (size_t i = 0; i < name.size(); i++) {
+        h = h * 31 + name[i];
+      }
+
+      h = h * 31 + resource.type();
+
+      if (resource.type() == Value::SCALAR) {
+        // Scalar equality is exact double equality, so hashing the
+        // bit pattern is consistent with it.
+        uint64_t bits = 0;
+        double value = resource.scalar().value();
+        if (value == 0) {
+          value = 0; // Normalize -0.0 so it hashes like +0.0.
+        }
+        memcpy(&bits, &value, sizeof(value));
+        h = h * 31 + (size_t) bits;
+      }
+
+      result += h;
+    }
+
+    // Only cache in the body when it is exclusively ours: a shared
+    // body may be read concurrently through another copy, and the
+    // caches must not be written behind its back.
+    if (data.unique()) {
+      data->hash = result;
+      data->hashed = true;
+    }
+
+    return result;
+  }
+
+  Option<double> lookup(Slot s) const
+  {
+    if (data->indexed) {
+      if (data->present[s]) {
+        return data->slots[s];
+      }
+      return Option<double>::none();
+    }
+
+    bool present[NUM_SLOTS];
+    double slots[NUM_SLOTS];
+
+    for (int i = 0; i < NUM_SLOTS; i++) {
+      present[i] = false;
+      slots[i] = 0.0;
+    }
+
+    foreach (const Resource& resource, data->resources) {
+      if (resource.type() == Value::SCALAR) {
+        int i = slot(resource.name());
+        if (i >= 0) {
+          present[i] = true;
+          slots[i] = resource.scalar().value();
+        }
+      }
+    }
+
+    // See hash() for why caching requires exclusive ownership.
+    if (data.unique()) {
+      for (int i = 0; i < NUM_SLOTS; i++) {
+        data->present[i] = present[i];
+        data->slots[i] = slots[i];
+      }
+      data->indexed = true;
+    }
+
+    if (present[s]) {
+      return slots[s];
+    }
+
+    return Option<double>::none();
+  }
+
+  std::tr1::shared_ptr<Data> data;
 };
 
 
@@ -380,7 +542,18 @@ inline Value::Scalar Resources::get(
     const std::string& name,
     const Value::Scalar& scalar) const
 {
-  foreach (const Resource& resource, resources) {
+  int i = slot(name);
+  if (i >= 0) {
+    Option<double> value = lookup((Slot) i);
+    if (value.isSome()) {
+      Value::Scalar result;
+      result.set_value(value.get());
+      return result;
+    }
+    return scalar;
+  }
+
+  foreach (const Resource& resource, data->resources) {
     if (resource.name() == name &&
         resource.type() == Value::SCALAR) {
       return resource.scalar();
@@ -396,7 +569,7 @@ inline Value::Ranges Resources::get(
     const std::string& name,
     const Value::Ranges& ranges) const
 {
-  foreach (const Resource& resource, resources) {
+  foreach (const Resource& resource, data->resources) {
     if (resource.name() == name &&
         resource.type() == Value::RANGES) {
       return resource.ranges();
@@ -412,7 +585,7 @@ inline Value::Set Resources::get(
     const std::string& name,
     const Value::Set& set) const
 {
-  foreach (const Resource& resource, resources) {
+  foreach (const Resource& resource, data->resources) {
     if (resource.name() == name &&
         resource.type() == Value::SET) {
       return resource.set();
@@ -423,44 +596,27 @@ inline Value::Set Resources::get(
 }
 
 
-inline Option<double> Resources::cpus()
+inline Option<double> Resources::cpus() const
 {
-  foreach (const Resource& resource, resources) {
-    if (resource.name() == "cpus" && resource.type() == Value::SCALAR) {
-      return resource.scalar().value();
-    }
-  }
-  return Option<double>::none();
+  return lookup(CPUS);
 }
 
 
-inline Option<double> Resources::mem()
+inline Option<double> Resources::mem() const
 {
-  foreach (const Resource& resource, resources) {
-    if (resource.name() == "mem" &&
-        resource.type() == Value::SCALAR) {
-      return resource.scalar().value();
-    }
-  }
-  return Option<double>::none();
+  return lookup(MEM);
 }
 
 
-inline Option<double> Resources::disk()
+inline Option<double> Resources::disk() const
 {
-  foreach (const Resource& resource, resources) {
-    if (resource.name() == "disk" &&
-        resource.type() == Value::SCALAR) {
-      return resource.scalar().value();
-    }
-  }
-  return Option<double>::none();
+  return lookup(DISK);
 }
 
 
-inline Option<Value::Ranges> Resources::ports()
+inline Option<Value::Ranges> Resources::ports() const
 {
-  foreach (const Resource& resource, resources) {
+  foreach (const Resource& resource, data->resources) {
     if (resource.name() == "ports" &&
         resource.type() == Value::RANGES) {
       return resource.ranges();
@@ -16,16 +16,18 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
+
+#include <algorithm>
 #include <iostream>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
 
-#include <boost/lexical_cast.hpp>
-
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
-#include <stout/strings.hpp>
+#include <stout/hashset.hpp>
 
 #include "common/resources.hpp"
 #include "common/values.hpp"
@@ -41,89 +43,169 @@ namespace mesos {
 namespace internal {
 namespace values {
 
+// Scans past (ignored) spaces, returning the next position.
+static size_t skipSpaces(const std::string& text, size_t i)
+{
+  while (i < text.size() && text[i] == ' ') {
+    i++;
+  }
+  return i;
+}
+
+
+// Scans a non-negative integer at position 'i', accumulating it into
+// 'result'. Returns the position after the last digit, or 'i' itself
+// if no digits were found.
+static size_t scanInteger(const std::string& text, size_t i, uint64_t* result)
+{
+  *result = 0;
+  while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+    *result = (*result * 10) + (text[i] - '0');
+    i++;
+  }
+  return i;
+}
+
+
 Try<Value> parse(const std::string& text)
 {
   Value value;
 
-  // Remove any spaces from the text.
-  string temp;
-  foreach (const char c, text) {
-    if (c != ' ') {
-      temp += c;
-    }
-  }
+  // This is a single pass scanner: spaces are skipped as they are
+  // encountered rather than first building a stripped copy of the
+  // input, and ranges are accumulated digit by digit rather than
+  // tokenized into intermediate string vectors.
+  const size_t n = text.size();
+  size_t i = skipSpaces(text, 0);
 
-  if (temp.length() == 0) {
+  if (i == n) {
     return Error("Expecting non-empty string");
   }
 
-  // TODO(ynie): Find a better way to check brackets.
-  if (!strings::checkBracketsMatching(temp, '{', '}') ||
-      !strings::checkBracketsMatching(temp, '[', ']') ||
-      !strings::checkBracketsMatching(temp, '(', ')')) {
-    return Error("Mismatched brackets");
-  }
-
-  size_t index = temp.find('[');
-  if (index == 0) {
+  if (text[i] == '[') {
     // This is a ranges.
     Value::Ranges ranges;
-    const vector<string>& tokens = strings::tokenize(temp, "[]-,\n");
-    if (tokens.size() % 2 != 0) {
-      return Error("Expecting one or more \"ranges\"");
-    } else {
-      for (size_t i = 0; i < tokens.size(); i += 2) {
-        Value::Range *range = ranges.add_range();
-
-        int j = i;
-        try {
-          range->set_begin(boost::lexical_cast<uint64_t>((tokens[j++])));
-          range->set_end(boost::lexical_cast<uint64_t>(tokens[j++]));
-        } catch (const boost::bad_lexical_cast&) {
-          return Error(
-              "Expecting non-negative integers in '" + tokens[j - 1] + "'");
-        }
+
+    i = skipSpaces(text, i + 1); // Consume '['.
+
+    while (true) {
+      if (i == n) {
+        return Error("Mismatched brackets");
       }
 
-      value.set_type(Value::RANGES);
-      value.mutable_ranges()->MergeFrom(ranges);
-      return value;
-    }
-  } else if (index == string::npos) {
-    size_t index = temp.find('{');
-    if (index == 0) {
-      // This is a set.
-      Value::Set set;
-      const vector<string>& tokens = strings::tokenize(temp, "{},\n");
-      for (size_t i = 0; i < tokens.size(); i++) {
-        set.add_item(tokens[i]);
+      if (text[i] == ']') {
+        i++;
+        break;
       }
 
-      value.set_type(Value::SET);
-      value.mutable_set()->MergeFrom(set);
-      return value;
-    } else if (index == string::npos) {
-      try {
-        Value::Scalar scalar;
-        scalar.set_value(boost::lexical_cast<double>(temp));
-        // This is a Scalar.
-        value.set_type(Value::SCALAR);
-        value.mutable_scalar()->MergeFrom(scalar);
-        return value;
-      } catch (const boost::bad_lexical_cast&) {
-        // This is a Text.
-        Value::Text text;
-        text.set_value(temp);
-        value.set_type(Value::TEXT);
-        value.mutable_text()->MergeFrom(text);
-        return value;
+      uint64_t begin;
+      size_t j = scanInteger(text, i, &begin);
+      if (j == i) {
+        return Error("Expecting one or more \"ranges\"");
       }
-    } else {
-      return Error("Unexpected '{' found");
+
+      i = skipSpaces(text, j);
+      if (i == n || text[i] != '-') {
+        return Error("Expecting one or more \"ranges\"");
+      }
+
+      i = skipSpaces(text, i + 1); // Consume '-'.
+
+      uint64_t end;
+      j = scanInteger(text, i, &end);
+      if (j == i) {
+        return Error("Expecting one or more \"ranges\"");
+      }
+
+      Value::Range* range = ranges.add_range();
+      range->set_begin(begin);
+      range->set_end(end);
+
+      i = skipSpaces(text, j);
+      if (i < n && (text[i] == ',' || text[i] == '\n')) {
+        i = skipSpaces(text, i + 1);
+      }
+    }
+
+    if (skipSpaces(text, i) != n) {
+      return Error("Unexpected characters after ']'");
+    }
+
+    value.set_type(Value::RANGES);
+    value.mutable_ranges()->MergeFrom(ranges);
+    return value;
+  }
+
+  if (text[i] == '{') {
+    // This is a set.
+    Value::Set set;
+    string item;
+
+    bool closed = false;
+    for (i++; i < n; i++) {
+      const char c = text[i];
+
+      if (c == ' ') {
+        continue; // Spaces are ignored, including within items.
+      } else if (c == ',' || c == '\n' || c == '}') {
+        if (!item.empty()) {
+          set.add_item(item);
+          item.clear();
+        }
+        if (c == '}') {
+          closed = true;
+          i++;
+          break;
+        }
+      } else if (c == '{' || c == '[' || c == ']') {
+        return Error("Mismatched brackets");
+      } else {
+        item += c;
+      }
+    }
+
+    if (!closed || skipSpaces(text, i) != n) {
+      return Error("Mismatched brackets");
+    }
+
+    value.set_type(Value::SET);
+    value.mutable_set()->MergeFrom(set);
+    return value;
+  }
+
+  // A scalar or some text: strip the (ignored) spaces and classify.
+  string temp;
+  temp.reserve(n - i);
+  for (size_t j = i; j < n; j++) {
+    if (text[j] != ' ') {
+      temp += text[j];
     }
   }
 
-  return Error("Unexpected '[' found");
+  if (temp.find('[') != string::npos) {
+    return Error("Unexpected '[' found");
+  } else if (temp.find('{') != string::npos) {
+    return Error("Unexpected '{' found");
+  }
+
+  char* end = NULL;
+  double d = strtod(temp.c_str(), &end);
+
+  if (end == temp.c_str() + temp.length()) {
+    // This is a scalar.
+    Value::Scalar scalar;
+    scalar.set_value(d);
+    value.set_type(Value::SCALAR);
+    value.mutable_scalar()->MergeFrom(scalar);
+    return value;
+  }
+
+  // This is a text.
+  Value::Text text_;
+  text_.set_value(temp);
+  value.set_type(Value::TEXT);
+  value.mutable_text()->MergeFrom(text_);
+  return value;
 }
 
 } // namespace values {
@@ -189,171 +271,142 @@ static void add(Value::Ranges* result, int64_t begin, int64_t end)
   range->set_end(end);
 }
 
-}
 
+// An interval as a plain pair so we can sort and sweep without
+// touching protobuf accessors in the inner loops.
+typedef std::pair<int64_t, int64_t> Interval;
 
-// Coalesce the given 'range' into already coalesced 'ranges'.
-static void coalesce(Value::Ranges* ranges, const Value::Range& range)
-{
-  // Note that we assume that ranges has already been coalesced.
 
-  Value::Ranges result;
-  Value::Range temp = range;
-
-  for (int i = 0; i < ranges->range_size(); i++) {
-    const Value::Range& current = ranges->range(i);
-
-    // Check if current and range overlap. Note, we only need to
-    // compare with range and not with temp to check for overlap
-    // because we expect ranges to be coalesced to begin with!
-    if (current.begin() <= range.end() + 1 &&
-        current.end() >= range.begin() - 1) {
-      // current:   |   |
-      // range:       |   |
-      // range:   |   |
-      // Update temp with new boundaries.
-      temp.set_begin(min(temp.begin(), min(range.begin(), current.begin())));
-      temp.set_end(max(temp.end(), max(range.end(), current.end())));
-    } else { // No overlap.
-      result.add_range()->MergeFrom(current);
-    }
-  }
-
-  result.add_range()->MergeFrom(temp);
-  *ranges = result;
+static bool beginsBefore(const Interval& left, const Interval& right)
+{
+  return left.first < right.first;
 }
 
 
-// Coalesce the given un-coalesced 'uranges' into already coalesced 'ranges'.
-static void coalesce(Value::Ranges* ranges, const Value::Ranges& uranges)
+// Returns 'ranges' in normalized form: sorted by begin, with
+// overlapping and adjacent ranges merged. Normalized form is
+// canonical, so two normalized ranges are equal iff they are
+// element-wise identical. This is O(n log n) for the sort (O(n) if
+// the input is already sorted, which it typically is since all the
+// arithmetic below produces normalized output).
+static vector<Interval> normalize(const Value::Ranges& ranges)
 {
-  // Note that we assume that ranges has already been coalesced.
+  vector<Interval> intervals;
+  intervals.reserve(ranges.range_size());
 
-  for (int i = 0; i < uranges.range_size(); i++) {
-    coalesce(ranges, uranges.range(i));
+  for (int i = 0; i < ranges.range_size(); i++) {
+    intervals.push_back(
+        Interval(ranges.range(i).begin(), ranges.range(i).end()));
   }
-}
-
 
-static void remove(Value::Ranges* ranges, const Value::Range& range)
-{
-  // Note that we assume that ranges has already been coalesced.
+  std::sort(intervals.begin(), intervals.end(), beginsBefore);
 
-  Value::Ranges result;
+  vector<Interval> result;
+  result.reserve(intervals.size());
 
-  for (int i = 0; i < ranges->range_size(); i++) {
-    const Value::Range& current = ranges->range(i);
-
-    // Note that these if/else if conditionals are in a particular
-    // order. In particular, the last two assume that the "subsumes"
-    // checks have already occured.
-    if (range.begin() <= current.begin() && range.end() >= current.end()) {
-      // Range subsumes current.
-      // current:  |     |
-      // range:  |         |
-      // range:  |       |
-      // range:    |       |
-      // range:    |     |
-    } else if (range.begin() >= current.begin() &&
-               range.end() <= current.end()) {
-      // Range is subsumed by current.
-      // current:  |     |
-      // range:      | |
-      // range:    |   |
-      // range:      |   |
-      ranges::add(&result, current.begin(), range.begin() - 1);
-      ranges::add(&result, range.end() + 1, current.end());
-    } else if (range.begin() <= current.begin() &&
-               range.end() >= current.begin()) {
-      // Range overlaps to the left.
-      // current:  |     |
-      // range:  |     |
-      // range:  | |
-      ranges::add(&result, range.end() + 1, current.end());
-    } else if (range.begin() <= current.end() && range.end() >= current.end()) {
-      // Range overlaps to the right.
-      // current:  |     |
-      // range:      |      |
-      // range:          |  |
-      ranges::add(&result, current.begin(), range.begin() - 1);
+  for (size_t i = 0; i < intervals.size(); i++) {
+    if (!result.empty() && intervals[i].first <= result.back().second + 1) {
+      // Overlaps or is adjacent to the previous interval.
+      result.back().second = max(result.back().second, intervals[i].second);
     } else {
-      // Range doesn't overlap current.
-      // current:        |   |
-      // range:   |   |
-      // range:                |   |
-      ranges::add(&result, current.begin(), current.end());
+      result.push_back(intervals[i]);
     }
   }
 
-  *ranges = result;
+  return result;
 }
 
 
-ostream& operator << (ostream& stream, const Value::Ranges& ranges)
+// Linear-time union of two normalized interval lists.
+static vector<Interval> merge(
+    const vector<Interval>& left,
+    const vector<Interval>& right)
 {
-  stream << "[";
-  for (int i = 0; i < ranges.range_size(); i++) {
-    stream << ranges.range(i).begin() << "-" << ranges.range(i).end();
-    if (i + 1 < ranges.range_size()) {
-      stream << ", ";
+  vector<Interval> result;
+  result.reserve(left.size() + right.size());
+
+  size_t i = 0;
+  size_t j = 0;
+
+  while (i < left.size() || j < right.size()) {
+    // Take the interval that begins first.
+    Interval next = (j == right.size() ||
+                     (i < left.size() && left[i].first <= right[j].first))
+      ? left[i++]
+      : right[j++];
+
+    if (!result.empty() && next.first <= result.back().second + 1) {
+      result.back().second = max(result.back().second, next.second);
+    } else {
+      result.push_back(next);
     }
   }
-  stream << "]";
-  return stream;
+
+  return result;
 }
 
 
-bool operator == (const Value::Ranges& _left, const Value::Ranges& _right)
+// Linear-time subtraction of normalized 'right' from normalized
+// 'left': sweep 'left', chopping pieces off the current interval as
+// we advance through the overlapping intervals of 'right'.
+static vector<Interval> subtract(
+    const vector<Interval>& left,
+    const vector<Interval>& right)
 {
-  Value::Ranges left;
-  coalesce(&left, _left);
+  vector<Interval> result;
+  result.reserve(left.size());
 
-  Value::Ranges right;
-  coalesce(&right, _right);
+  size_t j = 0;
 
-  if (left.range_size() == right.range_size()) {
-    for (int i = 0; i < left.range_size(); i++) {
-      // Make sure this range is equal to a range in the right.
-      bool found = false;
-      for (int j = 0; j < right.range_size(); j++) {
-        if (left.range(i).begin() == right.range(j).begin() &&
-            left.range(i).end() == right.range(j).end()) {
-          found = true;
-          break;
-        }
-      }
+  for (size_t i = 0; i < left.size(); i++) {
+    int64_t begin = left[i].first;
+    const int64_t end = left[i].second;
+
+    // Skip intervals of 'right' entirely before this one.
+    while (j < right.size() && right[j].second < begin) {
+      j++;
+    }
 
-      if (!found) {
-        return false;
+    // Emit the pieces of [begin, end] not covered by 'right'. Note
+    // that we don't advance 'j' past an interval that extends beyond
+    // 'end' since it may also overlap left[i + 1].
+    size_t k = j;
+    while (k < right.size() && right[k].first <= end) {
+      if (right[k].first > begin) {
+        result.push_back(Interval(begin, right[k].first - 1));
+      }
+      begin = right[k].second + 1;
+      if (right[k].second > end) {
+        break;
       }
+      k++;
     }
 
-    return true;
+    if (begin <= end) {
+      result.push_back(Interval(begin, end));
+    }
   }
 
-  return false;
+  return result;
 }
 
 
-bool operator <= (const Value::Ranges& _left, const Value::Ranges& _right)
+// Linear-time check that every interval of normalized 'left' is
+// contained in some interval of normalized 'right'.
+static bool contains(
+    const vector<Interval>& right,
+    const vector<Interval>& left)
 {
-  Value::Ranges left;
-  coalesce(&left, _left);
+  size_t j = 0;
 
-  Value::Ranges right;
-  coalesce(&right, _right);
-
-  for (int i = 0; i < left.range_size(); i++) {
-    // Make sure this range is a subset of a range in right.
-    bool matched = false;
-    for (int j = 0; j < right.range_size(); j++) {
-      if (left.range(i).begin() >= right.range(j).begin() &&
-          left.range(i).end() <= right.range(j).end()) {
-        matched = true;
-        break;
-      }
+  for (size_t i = 0; i < left.size(); i++) {
+    while (j < right.size() && right[j].second < left[i].first) {
+      j++;
     }
-    if (!matched) {
+
+    if (j == right.size() ||
+        right[j].first > left[i].first ||
+        right[j].second < left[i].second) {
       return false;
     }
   }
@@ -362,59 +415,77 @@ bool operator <= (const Value::Ranges& _left, const Value::Ranges& _right)
 }
 
 
-Value::Ranges operator + (const Value::Ranges& left, const Value::Ranges& right)
+static Value::Ranges render(const vector<Interval>& intervals)
 {
   Value::Ranges result;
 
-  coalesce(&result, left);
-  coalesce(&result, right);
+  for (size_t i = 0; i < intervals.size(); i++) {
+    add(&result, intervals[i].first, intervals[i].second);
+  }
 
   return result;
 }
 
+} // namespace ranges {
 
-Value::Ranges operator - (const Value::Ranges& left, const Value::Ranges& right)
-{
-  Value::Ranges result;
-
-  coalesce(&result, left);
-  coalesce(&result, right);
 
-  for (int i = 0; i < right.range_size(); i++) {
-    remove(&result, right.range(i));
+ostream& operator << (ostream& stream, const Value::Ranges& ranges)
+{
+  stream << "[";
+  for (int i = 0; i < ranges.range_size(); i++) {
+    stream << ranges.range(i).begin() << "-" << ranges.range(i).end();
+    if (i + 1 < ranges.range_size()) {
+      stream << ", ";
+    }
   }
-
-  return result;
+  stream << "]";
+  return stream;
 }
 
 
-Value::Ranges& operator += (Value::Ranges& left, const Value::Ranges& right)
+bool operator == (const Value::Ranges& _left, const Value::Ranges& _right)
 {
-  Value::Ranges temp;
+  // Normalized form is canonical, so equality is an element-wise
+  // comparison.
+  const vector<ranges::Interval>& left = ranges::normalize(_left);
+  const vector<ranges::Interval>& right = ranges::normalize(_right);
+
+  return left == right;
+}
 
-  coalesce(&temp, left);
 
-  left = temp;
+bool operator <= (const Value::Ranges& _left, const Value::Ranges& _right)
+{
+  return ranges::contains(
+      ranges::normalize(_right),
+      ranges::normalize(_left));
+}
 
-  coalesce(&left, right);
 
-  return left;
+Value::Ranges operator + (const Value::Ranges& left, const Value::Ranges& right)
+{
+  return ranges::render(
+      ranges::merge(ranges::normalize(left), ranges::normalize(right)));
 }
 
 
-Value::Ranges& operator -= (Value::Ranges& left, const Value::Ranges& right)
+Value::Ranges operator - (const Value::Ranges& left, const Value::Ranges& right)
 {
-  Value::Ranges temp;
+  return ranges::render(
+      ranges::subtract(ranges::normalize(left), ranges::normalize(right)));
+}
 
-  coalesce(&temp, left);
-  coalesce(&temp, right);
 
-  left = temp;
+Value::Ranges& operator += (Value::Ranges& left, const Value::Ranges& right)
+{
+  left = left + right;
+  return left;
+}
 
-  for (int i = 0; i < right.range_size(); i++) {
-    remove(&left, right.range(i));
-  }
 
+Value::Ranges& operator -= (Value::Ranges& left, const Value::Ranges& right)
+{
+  left = left - right;
   return left;
 }
 
@@ -433,144 +504,117 @@ ostream& operator << (ostream& stream, const Value::Set& set)
 }
 
 
+// NOTE: The set operations below hash their operands' items so that
+// they run linear in the set sizes (set typed resources can carry
+// hundreds of items, e.g., license tokens), rather than nesting
+// loops over the items.
+
+// Writes the items out in sorted order, so that a set has a single
+// canonical form on the wire regardless of the order in which it was
+// assembled.
+static void canonicalize(const hashset<string>& items, Value::Set* result)
+{
+  vector<string> sorted(items.begin(), items.end());
+  std::sort(sorted.begin(), sorted.end());
+
+  foreach (const string& item, sorted) {
+    result->add_item(item);
+  }
+}
+
+
 bool operator == (const Value::Set& left, const Value::Set& right)
 {
-  if (left.item_size() == right.item_size()) {
-    for (int i = 0; i < left.item_size(); i++) {
-      // Make sure this item is equal to an item in the right.
-      bool found = false;
-      for (int j = 0; j < right.item_size(); j++) {
-        if (left.item(i) == right.item(i)) {
-          found = true;
-          break;
-        }
-      }
+  if (left.item_size() != right.item_size()) {
+    return false;
+  }
 
-      if (!found) {
-        return false;
-      }
-    }
+  hashset<string> items;
+  for (int i = 0; i < right.item_size(); i++) {
+    items.insert(right.item(i));
+  }
 
-    return true;
+  // Make sure each item is equal to an item in the right.
+  for (int i = 0; i < left.item_size(); i++) {
+    if (!items.contains(left.item(i))) {
+      return false;
+    }
   }
 
-  return false;
+  return true;
 }
 
 
 bool operator <= (const Value::Set& left, const Value::Set& right)
 {
-  if (left.item_size() <= right.item_size()) {
-    for (int i = 0; i < left.item_size(); i++) {
-      // Make sure this item is equal to an item in the right.
-      bool found = false;
-      for (int j = 0; j < right.item_size(); j++) {
-        if (left.item(i) == right.item(i)) {
-          found = true;
-          break;
-        }
-      }
+  if (left.item_size() > right.item_size()) {
+    return false;
+  }
 
-      if (!found) {
-        return false;
-      }
-    }
+  hashset<string> items;
+  for (int i = 0; i < right.item_size(); i++) {
+    items.insert(right.item(i));
+  }
 
-    return true;
+  // Make sure each item is equal to an item in the right.
+  for (int i = 0; i < left.item_size(); i++) {
+    if (!items.contains(left.item(i))) {
+      return false;
+    }
   }
 
-  return false;
+  return true;
 }
 
 
 Value::Set operator + (const Value::Set& left, const Value::Set& right)
 {
-  Value::Set result;
+  hashset<string> items;
 
   for (int i = 0; i < left.item_size(); i++) {
-    result.add_item(left.item(i));
+    items.insert(left.item(i));
   }
 
-  // A little bit of extra logic to avoid adding duplicates from right.
   for (int i = 0; i < right.item_size(); i++) {
-    bool found = false;
-    for (int j = 0; j < result.item_size(); j++) {
-      if (right.item(i) == result.item(j)) {
-        found = true;
-        break;
-      }
-    }
-
-    if (!found) {
-      result.add_item(right.item(i));
-    }
+    items.insert(right.item(i));
   }
 
+  Value::Set result;
+  canonicalize(items, &result);
   return result;
 }
 
 
 Value::Set operator - (const Value::Set& left, const Value::Set& right)
 {
-  Value::Set result;
+  hashset<string> subtrahend;
+  for (int i = 0; i < right.item_size(); i++) {
+    subtrahend.insert(right.item(i));
+  }
 
-  // Look for the same item in right as we add left to result.
+  hashset<string> items;
   for (int i = 0; i < left.item_size(); i++) {
-    bool found = false;
-    for (int j = 0; j < right.item_size(); j++) {
-      if (left.item(i) == right.item(j)) {
-        found = true;
-        break;
-      }
-    }
-
-    if (!found) {
-      result.add_item(left.item(i));
+    if (!subtrahend.contains(left.item(i))) {
+      items.insert(left.item(i));
     }
   }
 
+  Value::Set result;
+  canonicalize(items, &result);
   return result;
 }
 
 
 Value::Set& operator += (Value::Set& left, const Value::Set& right)
 {
-  // A little bit of extra logic to avoid adding duplicates from right.
-  for (int i = 0; i < right.item_size(); i++) {
-    bool found = false;
-    for (int j = 0; j < left.item_size(); j++) {
-      if (right.item(i) == left.item(j)) {
-        found = true;
-        break;
-      }
-    }
-
-    if (!found) {
-      left.add_item(right.item(i));
-    }
-  }
-
+  left = left + right;
   return left;
 }
 
 
 Value::Set& operator -= (Value::Set& left, const Value::Set& right)
 {
-  // For each item in right check if it's in left and add it if not.
-  for (int i = 0; i < right.item_size(); i++) {
-    bool found = false;
-    for (int j = 0; j < left.item_size(); j++) {
-      if (right.item(i) == left.item(j)) {
-        found = true;
-        break;
-      }
-    }
-
-    if (!found) {
-      left.add_item(right.item(i));
-    }
-  }
-
+  left = left - right;
   return left;
 }
 
@@ -18,8 +18,12 @@
 
 #include <glog/logging.h>
 
+#include <pthread.h>
+
 #include <fstream>
 #include <ios>
+#include <map>
+#include <set>
 #include <vector>
 
 #include <process/delay.hpp>
@@ -53,7 +57,9 @@ using process::Timer;
 using process::UPID;
 using process::wait; // Necessary on some OS's to disambiguate.
 
+using std::map;
 using std::pair;
+using std::set;
 using std::string;
 using std::vector;
 
@@ -82,6 +88,15 @@ public:
   // ZooKeeperMasterDetector implementation.
   int64_t session();
 
+  // Subscribes another pid to leader change notifications (used when
+  // this process is shared, see the registry below). The new
+  // subscriber is immediately told about the currently detected
+  // master, or that no master is currently known.
+  void subscribe(const UPID& subscriber);
+
+  // Unsubscribes the pid from any further notifications.
+  void unsubscribe(const UPID& subscriber);
+
   // ZooKeeper events.
   void connected(bool reconnect);
   void reconnecting();
@@ -105,6 +120,9 @@ private:
   const UPID pid;
   bool contend;
 
+  // All pids to notify of leader changes (always includes 'pid').
+  set<UPID> pids;
+
   Watcher* watcher;
   ZooKeeper* zk;
 
@@ -116,6 +134,24 @@ private:
 };
 
 
+// Process-wide registry of shared (non-contending) ZooKeeper master
+// detector processes, keyed by URL. Co-located consumers (e.g., a
+// slave plus its monitoring components) thereby share one ZooKeeper
+// session to the ensemble instead of each holding their own, and
+// leader change notifications get fanned out to all of their pids.
+// Contending detectors are never shared since each contender is
+// represented by its own ephemeral znode (and thus needs its own
+// session).
+struct SharedDetectorProcess
+{
+  ZooKeeperMasterDetectorProcess* process;
+  int references;
+};
+
+static map<string, SharedDetectorProcess>* sharedDetectorProcesses = NULL;
+static pthread_mutex_t sharedMutex = PTHREAD_MUTEX_INITIALIZER;
+
+
 MasterDetector::~MasterDetector() {}
 
 
@@ -248,6 +284,8 @@ ZooKeeperMasterDetectorProcess::ZooKeeperMasterDetectorProcess(
     zk(NULL),
     expire(false)
 {
+  pids.insert(pid);
+
   // Set verbosity level for underlying ZooKeeper library logging.
   // TODO(benh): Put this in the C++ API.
   zoo_set_debug_level(quiet ? ZOO_LOG_LEVEL_ERROR : ZOO_LOG_LEVEL_DEBUG);
@@ -277,6 +315,28 @@ int64_t ZooKeeperMasterDetectorProcess::session()
 }
 
 
+void ZooKeeperMasterDetectorProcess::subscribe(const UPID& subscriber)
+{
+  pids.insert(subscriber);
+
+  // Bring the new subscriber up to date so it doesn't have to wait
+  // for the next leader change.
+  if (!currentMasterSeq.empty()) {
+    NewMasterDetectedMessage message;
+    message.set_pid(currentMasterPID);
+    process::post(subscriber, message);
+  } else {
+    process::post(subscriber, NoMasterDetectedMessage());
+  }
+}
+
+
+void ZooKeeperMasterDetectorProcess::unsubscribe(const UPID& subscriber)
+{
+  pids.erase(subscriber);
+}
+
+
 void ZooKeeperMasterDetectorProcess::connected(bool reconnect)
 {
   if (!reconnect) {
@@ -504,7 +564,9 @@ void ZooKeeperMasterDetectorProcess::detectMaster()
   // No master present (lost or possibly hasn't come up yet).
   if (masterSeq.empty()) {
     LOG(INFO) << "Master detector (" << pid << ") couldn't find any masters";
-    process::post(pid, NoMasterDetectedMessage());
+    foreach (const UPID& subscriber, pids) {
+      process::post(subscriber, NoMasterDetectedMessage());
+    }
   } else if (masterSeq != currentMasterSeq) {
     // Okay, let's fetch the master pid from ZooKeeper.
     string result;
@@ -538,14 +600,18 @@ void ZooKeeperMasterDetectorProcess::detectMaster()
         // might have failed because of DNS, and whoever is using the
         // detector might sit "unconnected" indefinitely!
         LOG(ERROR) << "Failed to parse new master pid!";
-        process::post(pid, NoMasterDetectedMessage());
+        foreach (const UPID& subscriber, pids) {
+          process::post(subscriber, NoMasterDetectedMessage());
+        }
       } else {
         currentMasterSeq = masterSeq;
         currentMasterPID = masterPid;
 
         NewMasterDetectedMessage message;
         message.set_pid(currentMasterPID);
-        process::post(pid, message);
+        foreach (const UPID& subscriber, pids) {
+          process::post(subscriber, message);
+        }
       }
     }
   }
@@ -554,20 +620,80 @@ void ZooKeeperMasterDetectorProcess::detectMaster()
 
 ZooKeeperMasterDetector::ZooKeeperMasterDetector(
     const zookeeper::URL& url,
-    const UPID& pid,
+    const UPID& _pid,
     bool contend,
     bool quiet)
+  : pid(_pid)
 {
-  process = new ZooKeeperMasterDetectorProcess(url, pid, contend, quiet);
-  spawn(process);
+  if (contend) {
+    // Contenders always get their own detector process (and thus
+    // their own ZooKeeper session), see the registry above.
+    process = new ZooKeeperMasterDetectorProcess(url, pid, contend, quiet);
+    spawn(process);
+    return;
+  }
+
+  key = url.servers + url.path;
+  if (url.authentication.isSome()) {
+    key += "!" + url.authentication.get().scheme + ":" +
+      url.authentication.get().credentials;
+  }
+
+  pthread_mutex_lock(&sharedMutex);
+
+  if (sharedDetectorProcesses == NULL) {
+    sharedDetectorProcesses = new map<string, SharedDetectorProcess>();
+  }
+
+  if (sharedDetectorProcesses->count(key) == 0) {
+    SharedDetectorProcess shared;
+    shared.process =
+      new ZooKeeperMasterDetectorProcess(url, pid, contend, quiet);
+    shared.references = 0;
+    spawn(shared.process);
+    (*sharedDetectorProcesses)[key] = shared;
+    process = shared.process;
+  } else {
+    process = (*sharedDetectorProcesses)[key].process;
+    dispatch(process, &ZooKeeperMasterDetectorProcess::subscribe, pid);
+  }
+
+  (*sharedDetectorProcesses)[key].references++;
+
+  pthread_mutex_unlock(&sharedMutex);
 }
 
 
 ZooKeeperMasterDetector::~ZooKeeperMasterDetector()
 {
-  terminate(process);
-  wait(process);
-  delete process;
+  if (key.empty()) { // Exclusively owned, i.e., contending.
+    terminate(process);
+    wait(process);
+    delete process;
+    return;
+  }
+
+  bool cleanup = false;
+
+  pthread_mutex_lock(&sharedMutex);
+
+  CHECK(sharedDetectorProcesses != NULL);
+  CHECK(sharedDetectorProcesses->count(key) == 1);
+
+  if (--(*sharedDetectorProcesses)[key].references == 0) {
+    sharedDetectorProcesses->erase(key);
+    cleanup = true;
+  } else {
+    dispatch(process, &ZooKeeperMasterDetectorProcess::unsubscribe, pid);
+  }
+
+  pthread_mutex_unlock(&sharedMutex);
+
+  if (cleanup) {
+    terminate(process);
+    wait(process);
+    delete process;
+  }
 }
 
 
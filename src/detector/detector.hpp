@@ -117,7 +117,11 @@ class ZooKeeperMasterDetector : public MasterDetector
 public:
   /**
    * Uses ZooKeeper for both detecting masters and contending to be a
-   * master.
+   * master. Note that non-contending detectors for the same URL
+   * within one OS process share a single underlying ZooKeeper session
+   * and leader change notifications are fanned out to every
+   * subscribed pid; contending detectors always get their own session
+   * (each contender is represented by its own ephemeral znode).
    *
    * @param url znode path of the master
    * @param pid libprocess pid to send messages/updates to (and to
@@ -140,6 +144,12 @@ public:
 
 private:
   ZooKeeperMasterDetectorProcess* process;
+
+  // The pid we subscribed with and the key under which 'process' is
+  // registered for sharing (see detector.cpp); an empty key means the
+  // process is exclusively owned (i.e., we are contending).
+  const process::UPID pid;
+  std::string key;
 };
 
 } // namespace internal {
@@ -17,6 +17,7 @@
  */
 
 #include <signal.h>
+#include <stdint.h>
 
 #include <sys/types.h>
 
@@ -160,11 +161,53 @@ public:
 
     install<ShutdownExecutorMessage>(
         &ExecutorProcess::shutdown);
+
+    // Opt-in backpressure notifications: when
+    // MESOS_DRIVER_BACKLOG_THRESHOLD is set to a positive number the
+    // executor's 'backlogged' callback is invoked whenever this
+    // process's event queue depth crosses it (see ProcessBase).
+    if (os::hasenv("MESOS_DRIVER_BACKLOG_THRESHOLD")) {
+      string value = os::getenv("MESOS_DRIVER_BACKLOG_THRESHOLD");
+      Try<size_t> threshold = numify<size_t>(value);
+      if (threshold.isError()) {
+        LOG(WARNING) << "Ignoring MESOS_DRIVER_BACKLOG_THRESHOLD='"
+                     << value << "': " << threshold.error();
+      } else {
+        setBacklogThreshold(threshold.get());
+      }
+    }
+
+    pendingSends = 0;
   }
 
   virtual ~ExecutorProcess() {}
 
+  // Fills in queue/backpressure statistics for the driver. NOTE:
+  // This is invoked directly (not dispatched) so that it reflects
+  // the queue even when this process is backed up; it only touches
+  // state that is safe to read from another thread.
+  void driverStats(DriverStats* stats)
+  {
+    QueueStats snapshot = queueStats();
+    stats->set_queue_depth(snapshot.depth);
+    stats->set_queue_watermark(snapshot.watermark);
+    stats->set_events_enqueued(snapshot.enqueued);
+    stats->set_events_handled(snapshot.handled);
+    stats->set_oldest_event_age(snapshot.oldest);
+    stats->set_pending_sends(__sync_add_and_fetch(&pendingSends, 0));
+  }
+
 protected:
+  virtual void backlogged(size_t depth)
+  {
+    // NOTE: Invoked from whichever thread enqueued the crossing event
+    // (see ProcessBase::backlogged); Executor::backlogged documents
+    // that it is not serialized with the other callbacks.
+    DriverStats stats;
+    driverStats(&stats);
+    executor->backlogged(driver, stats);
+  }
+
   virtual void initialize()
   {
     VLOG(1) << "Executor started at: " << self()
@@ -405,7 +448,9 @@ protected:
     // Capture the status update.
     updates[update->uuid()] = *update;
 
-    send(slave, message);
+    pendingUpdates.add_updates()->MergeFrom(message);
+    __sync_add_and_fetch(&pendingSends, 1);
+    scheduleFlush();
   }
 
   void sendFrameworkMessage(const string& data)
@@ -415,7 +460,55 @@ protected:
     message.mutable_framework_id()->MergeFrom(frameworkId);
     message.mutable_executor_id()->MergeFrom(executorId);
     message.set_data(data);
-    send(slave, message);
+
+    pendingMessages.add_messages()->MergeFrom(message);
+    __sync_add_and_fetch(&pendingSends, 1);
+    scheduleFlush();
+  }
+
+  // Outgoing messages to the slave are coalesced over a small window
+  // into batched wire messages, cutting the slave's ingress message
+  // rate from executors that emit many small updates or messages. A
+  // batch is flushed early once it exceeds the size cap below.
+  void scheduleFlush()
+  {
+    static const int MAX_PENDING_BYTES = 64 * 1024;
+
+    if (pendingUpdates.updates_size() + pendingMessages.messages_size() == 1) {
+      delay(Milliseconds(10.0), self(), &Self::flushPendingMessages);
+    } else if (pendingUpdates.ByteSize() + pendingMessages.ByteSize() >
+               MAX_PENDING_BYTES) {
+      flushPendingMessages();
+    }
+  }
+
+  void flushPendingMessages()
+  {
+    __sync_sub_and_fetch(
+        &pendingSends,
+        pendingUpdates.updates_size() + pendingMessages.messages_size());
+
+    if (pendingUpdates.updates_size() == 1) {
+      // No point paying the batch framing for a single update (and
+      // older slaves only understand the plain message).
+      send(slave, pendingUpdates.updates(0));
+    } else if (pendingUpdates.updates_size() > 1) {
+      VLOG(1) << "Sending " << pendingUpdates.updates_size()
+              << " coalesced status updates";
+      send(slave, pendingUpdates);
+    }
+
+    pendingUpdates.Clear();
+
+    if (pendingMessages.messages_size() == 1) {
+      send(slave, pendingMessages.messages(0));
+    } else if (pendingMessages.messages_size() > 1) {
+      VLOG(1) << "Sending " << pendingMessages.messages_size()
+              << " coalesced framework messages";
+      send(slave, pendingMessages);
+    }
+
+    pendingMessages.Clear();
   }
 
 private:
@@ -440,6 +533,15 @@ private:
   // recovery, the slave relaunches only those tasks that have
   // never reached this executor.
   hashmap<TaskID, TaskInfo> tasks; // Unacknowledged tasks.
+
+  // Outgoing messages coalesced towards the slave, awaiting the
+  // flush timer (see scheduleFlush).
+  StatusUpdatesMessage pendingUpdates;
+  ExecutorToFrameworkMessagesMessage pendingMessages;
+
+  // Number of coalesced-but-unsent messages, updated atomically
+  // since it gets read by driverStats from other threads.
+  volatile uint64_t pendingSends;
 };
 
 } // namespace internal {
@@ -670,3 +772,21 @@ Status MesosExecutorDriver::sendFrameworkMessage(const string& data)
 
   return status;
 }
+
+
+Status MesosExecutorDriver::stats(DriverStats* stats)
+{
+  Lock lock(&mutex);
+
+  if (status != DRIVER_RUNNING) {
+    return status;
+  }
+
+  CHECK(process != NULL);
+
+  // NOTE: Deliberately not dispatched; see
+  // ExecutorProcess::driverStats.
+  process->driverStats(stats);
+
+  return status;
+}
@@ -1,21 +1,33 @@
+#include <dirent.h>
+#include <poll.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <sys/stat.h>
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif // __linux__
+
 #include <algorithm>
 #include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include <boost/shared_array.hpp>
 
+#include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/http.hpp>
+#include <process/id.hpp>
 #include <process/io.hpp>
 #include <process/mime.hpp>
 #include <process/process.hpp>
 
+#include <stout/duration.hpp>
 #include <stout/error.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/json.hpp>
@@ -26,6 +38,7 @@
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/result.hpp>
+#include <stout/shardedcache.hpp>
 #include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 #include <stout/try.hpp>
@@ -52,6 +65,167 @@ using std::vector;
 namespace mesos {
 namespace internal {
 
+// Budget (in bytes of rendered JSON) and expiration for cached
+// directory listings. The cache key includes the directory's mtime so
+// any entry creation, removal or rename invalidates immediately; the
+// TTL exists because a contained file growing (e.g., an executor log)
+// does not touch the directory's mtime, so it bounds how stale the
+// reported sizes can get.
+const size_t LISTING_CACHE_CAPACITY = 8 * 1024 * 1024;
+const Duration LISTING_CACHE_TTL = Seconds(5.0);
+
+// Number of bytes a tailer pushes per pass before backing off for a
+// poll interval, bounding the load a single watch can generate when
+// the file grows faster than the client can stream it.
+const size_t TAIL_BURST_LIMIT = 64 * 1024;
+
+// How often a tailer checks for appended data when inotify is not
+// available, and how often an idle tailer checks that its client is
+// still connected.
+const Duration TAIL_POLL_INTERVAL = Milliseconds(500.0);
+
+
+// Follows a file and pushes appended data into the write end of a
+// pipe, the read end of which libprocess streams to the client as a
+// chunked HTTP response (see Response::PIPE). On Linux the file is
+// watched via inotify so appended lines get pushed immediately;
+// elsewhere we fall back to polling for new data. The process
+// terminates itself once the client disconnects, which we observe
+// either as a failed write or by polling the pipe.
+class TailerProcess : public Process<TailerProcess>
+{
+public:
+  TailerProcess(const string& _path, int _fd, int _pipe)
+    : ProcessBase(ID::generate("tailer")),
+      path(_path),
+      fd(_fd),
+      pipe(_pipe),
+      inotify(-1) {}
+
+protected:
+  virtual void initialize()
+  {
+    os::nonblock(pipe);
+
+#ifdef __linux__
+    inotify = inotify_init();
+    if (inotify >= 0) {
+      if (inotify_add_watch(inotify, path.c_str(), IN_MODIFY) < 0) {
+        os::close(inotify);
+        inotify = -1;
+      } else {
+        os::nonblock(inotify);
+      }
+    }
+
+    if (inotify < 0) {
+      LOG(WARNING) << "Failed to set up an inotify watch on '" << path
+                   << "', falling back to polling";
+    }
+#endif // __linux__
+
+    delay(TAIL_POLL_INTERVAL, self(), &TailerProcess::check);
+
+    read();
+  }
+
+  virtual void finalize()
+  {
+    os::close(fd);
+    os::close(pipe);
+    if (inotify >= 0) {
+      os::close(inotify);
+    }
+  }
+
+private:
+  // Reads appended data (up to the burst limit) and queues it on the
+  // pipe, then arranges to be woken up when there is more.
+  void read()
+  {
+    size_t total = 0;
+
+    while (total < TAIL_BURST_LIMIT) {
+      char buffer[4096];
+      ssize_t length = ::read(fd, buffer, sizeof(buffer));
+      if (length <= 0) {
+        break; // At end of file (errors get retried on the next pass).
+      }
+      pending.append(buffer, length);
+      total += length;
+    }
+
+    flush();
+
+    if (total >= TAIL_BURST_LIMIT || inotify < 0) {
+      // Either there is (likely) more data than the burst limit
+      // allowed us to push, or we have no watch: come back after a
+      // poll interval rather than spinning.
+      delay(TAIL_POLL_INTERVAL, self(), &TailerProcess::read);
+    } else {
+      io::poll(inotify, io::READ)
+        .onAny(defer(self(), &TailerProcess::wakeup, lambda::_1));
+    }
+  }
+
+  // Invoked when inotify reports a modification. The events
+  // themselves carry nothing we need, so just drain them and read.
+  void wakeup(const Future<short>&)
+  {
+    char buffer[4096];
+    while (::read(inotify, buffer, sizeof(buffer)) > 0) {}
+    read();
+  }
+
+  // Writes as much pending data to the pipe as it will take,
+  // returning to finish up once the client catches up.
+  void flush()
+  {
+    while (!pending.empty()) {
+      ssize_t length = ::write(pipe, pending.data(), pending.size());
+      if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        io::poll(pipe, io::WRITE)
+          .onAny(defer(self(), &TailerProcess::_flush, lambda::_1));
+        return;
+      } else if (length <= 0) {
+        // Broken pipe: the client has disconnected.
+        terminate(self());
+        return;
+      }
+      pending.erase(0, length);
+    }
+  }
+
+  void _flush(const Future<short>&)
+  {
+    flush();
+  }
+
+  // Periodically makes sure the client is still connected even if the
+  // file never grows, so that idle watches get reclaimed.
+  void check()
+  {
+    struct pollfd pfd;
+    pfd.fd = pipe;
+    pfd.events = 0;
+    pfd.revents = 0;
+
+    if (::poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLERR) != 0) {
+      terminate(self());
+      return;
+    }
+
+    delay(TAIL_POLL_INTERVAL, self(), &TailerProcess::check);
+  }
+
+  const string path;
+  int fd; // The file being tailed.
+  int pipe; // Write end of the pipe to the client.
+  int inotify; // inotify file descriptor, or -1 when unavailable.
+  string pending; // Data read from the file but not yet written.
+};
+
+
 class FilesProcess : public Process<FilesProcess>
 {
 public:
@@ -85,20 +259,38 @@ private:
   // See the jquery pailer for the expected behavior.
   Future<Response> read(const Request& request);
 
-  // Returns the raw file contents for a given path.
+  // Returns the raw file contents for a given path. The file is sent
+  // via 'sendfile' (see Response::PATH) so even huge sandbox logs are
+  // never buffered through our heap.
   // Requests have the following parameters:
-  //   path: The directory to browse. Required.
+  //   path: The file to download. Required.
+  //   offset: Offset within the file to start from. Optional.
+  //   length: Number of bytes to send (truncated at the end of the
+  //     file). Optional, defaults to the rest of the file.
   Future<Response> download(const Request& request);
 
+  // Streams the contents of a file to the client as data gets
+  // appended (i.e., 'tail -f'), using a chunked response fed by a
+  // TailerProcess.
+  // Requests have the following parameters:
+  //   path: The file to tail. Required.
+  //   offset: Offset to start streaming from. Optional, defaults to
+  //     the current end of the file (i.e., only new data).
+  Future<Response> tail(const Request& request);
+
   // Returns the internal virtual path mapping.
   Future<Response> debug(const Request& request);
 
   hashmap<string, string> paths;
+
+  // Rendered directory listings, keyed by (path, directory mtime).
+  shardedcache<string, string> listings;
 };
 
 
 FilesProcess::FilesProcess()
-  : ProcessBase("files")
+  : ProcessBase("files"),
+    listings(LISTING_CACHE_CAPACITY, LISTING_CACHE_TTL)
 {}
 
 
@@ -107,6 +299,7 @@ void FilesProcess::initialize()
   route("/browse.json", &FilesProcess::browse);
   route("/read.json", &FilesProcess::read);
   route("/download.json", &FilesProcess::download);
+  route("/tail.txt", &FilesProcess::tail);
   route("/debug.json", &FilesProcess::debug);
 }
 
@@ -160,27 +353,79 @@ Future<Response> FilesProcess::browse(const Request& request)
     return NotFound();
   }
 
-  // The result will be a sorted (on path) array of files and dirs:
-  // [{"name": "README", "path": "dir/README" "dir":False, "size":42}, ...]
-  map<string, JSON::Object> files;
-  foreach (const string& filename, os::ls(resolvedPath.get())) {
-    struct stat s;
-    string fullPath = path::join(resolvedPath.get(), filename);
+  struct stat s;
+  if (stat(resolvedPath.get().c_str(), &s) < 0) {
+    return InternalServerError(string(strerror(errno)) + ".\n");
+  }
 
-    if (stat(fullPath.c_str(), &s) < 0) {
-      PLOG(WARNING) << "Found " << fullPath << " in ls but stat failed";
-      continue;
+  // Listings are cached keyed by (path, directory mtime) so repeat
+  // browses of an unchanged sandbox skip the directory scan entirely.
+  const string& key = resolvedPath.get() + ":" + stringify(s.st_mtime);
+
+  Option<string> rendered = listings.get(key);
+
+  if (rendered.isNone()) {
+    // The result will be a sorted (on path) array of files and dirs:
+    // [{"name": "README", "path": "dir/README" "dir":False, "size":42}, ...]
+    // Walk the directory in a single pass: each entry is stat'ed via
+    // fstatat relative to the open directory, so the kernel never
+    // re-resolves the full path per entry.
+    map<string, JSON::Object> files;
+
+    DIR* dir = opendir(resolvedPath.get().c_str());
+    if (dir == NULL) {
+      return InternalServerError(string(strerror(errno)) + ".\n");
+    }
+
+    int dirfd = ::dirfd(dir);
+
+    dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+      if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+        continue;
+      }
+
+      struct stat status;
+      if (fstatat(dirfd, entry->d_name, &status, 0) < 0) {
+        PLOG(WARNING) << "Found " << entry->d_name << " in "
+                      << resolvedPath.get() << " but stat failed";
+        continue;
+      }
+
+      files[entry->d_name] =
+        jsonFileInfo(path::join(path.get(), entry->d_name), status);
     }
 
-    files[fullPath] = jsonFileInfo(path::join(path.get(), filename), s);
+    closedir(dir);
+
+    JSON::Array listing;
+    foreachvalue(const JSON::Object& file, files) {
+      listing.values.push_back(file);
+    }
+
+    std::ostringstream out;
+    JSON::render(out, listing);
+    rendered = out.str();
+
+    listings.put(key, rendered.get(), key.size() + rendered.get().size());
   }
 
-  JSON::Array listing;
-  foreachvalue(const JSON::Object& file, files) {
-    listing.values.push_back(file);
+  // Equivalent to OK(listing, jsonp) but reusing the cached rendering.
+  OK response;
+  response.type = response.BODY;
+
+  Option<string> jsonp = request.query.get("jsonp");
+  if (jsonp.isSome()) {
+    response.headers["Content-Type"] = "text/javascript";
+    response.body = jsonp.get() + "(" + rendered.get() + ");";
+  } else {
+    response.headers["Content-Type"] = "application/json";
+    response.body = rendered.get();
   }
 
-  return OK(listing, request.query.get("jsonp"));
+  response.headers["Content-Length"] = stringify(response.body.size());
+
+  return response;
 }
 
 
@@ -322,6 +567,26 @@ Future<Response> FilesProcess::download(const Request& request)
     return BadRequest("Expecting 'path=value' in query.\n");
   }
 
+  off_t offset = 0;
+
+  if (request.query.get("offset").isSome()) {
+    Try<off_t> result = numify<off_t>(request.query.get("offset").get());
+    if (result.isError()) {
+      return BadRequest("Failed to parse offset: " + result.error() + ".\n");
+    }
+    offset = result.get();
+  }
+
+  ssize_t length = -1;
+
+  if (request.query.get("length").isSome()) {
+    Try<ssize_t> result = numify<ssize_t>(request.query.get("length").get());
+    if (result.isError()) {
+      return BadRequest("Failed to parse length: " + result.error() + ".\n");
+    }
+    length = result.get();
+  }
+
   Result<string> resolvedPath = resolve(path.get());
 
   if (resolvedPath.isError()) {
@@ -344,6 +609,8 @@ Future<Response> FilesProcess::download(const Request& request)
   OK response;
   response.type = response.PATH;
   response.path = resolvedPath.get();
+  response.offset = offset;
+  response.length = length;
   response.headers["Content-Type"] = "application/octet-stream";
   response.headers["Content-Disposition"] =
     strings::format("attachment; filename=%s", basename.get()).get();
@@ -361,6 +628,87 @@ Future<Response> FilesProcess::download(const Request& request)
 }
 
 
+Future<Response> FilesProcess::tail(const Request& request)
+{
+  Option<string> path = request.query.get("path");
+
+  if (!path.isSome() || path.get().empty()) {
+    return BadRequest("Expecting 'path=value' in query.\n");
+  }
+
+  Result<string> resolvedPath = resolve(path.get());
+
+  if (resolvedPath.isError()) {
+    return BadRequest(resolvedPath.error() + ".\n");
+  } else if (!resolvedPath.isSome()) {
+    return NotFound();
+  }
+
+  // Don't tail directories.
+  if (os::isdir(resolvedPath.get())) {
+    return BadRequest("Cannot tail a directory.\n");
+  }
+
+  Try<int> fd = os::open(resolvedPath.get(), O_RDONLY);
+
+  if (fd.isError()) {
+    string error = strings::format("Failed to open file at '%s': %s",
+        resolvedPath.get(), fd.error()).get();
+    LOG(WARNING) << error;
+    return InternalServerError(error + ".\n");
+  }
+
+  off_t size = lseek(fd.get(), 0, SEEK_END);
+
+  if (size == -1) {
+    string error = strings::format("Failed to open file at '%s': %s",
+        resolvedPath.get(), strerror(errno)).get();
+    LOG(WARNING) << error;
+    os::close(fd.get());
+    return InternalServerError(error + ".\n");
+  }
+
+  // Default to streaming only data appended after this request.
+  off_t offset = size;
+
+  if (request.query.get("offset").isSome()) {
+    Try<off_t> result = numify<off_t>(request.query.get("offset").get());
+    if (result.isError()) {
+      os::close(fd.get());
+      return BadRequest("Failed to parse offset: " + result.error() + ".\n");
+    }
+    offset = std::min(result.get(), size);
+  }
+
+  if (lseek(fd.get(), offset, SEEK_SET) == -1) {
+    string error = strings::format("Failed to seek file at '%s': %s",
+        resolvedPath.get(), strerror(errno)).get();
+    LOG(WARNING) << error;
+    os::close(fd.get());
+    return InternalServerError(error + ".\n");
+  }
+
+  int pipes[2];
+  if (::pipe(pipes) == -1) {
+    os::close(fd.get());
+    return InternalServerError(string(strerror(errno)) + ".\n");
+  }
+
+  // The tailer owns the file descriptor and the write end of the
+  // pipe, and cleans both up once the client disconnects. The read
+  // end is closed by libprocess when streaming finishes (see
+  // Response::PIPE).
+  spawn(new TailerProcess(resolvedPath.get(), fd.get(), pipes[1]), true);
+
+  OK response;
+  response.type = response.PIPE;
+  response.pipe = pipes[0];
+  response.headers["Content-Type"] = "text/plain";
+
+  return response;
+}
+
+
 Future<Response> FilesProcess::debug(const Request& request)
 {
   JSON::Object object;
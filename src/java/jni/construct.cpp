@@ -28,6 +28,7 @@
 #include <mesos/mesos.hpp>
 
 #include "construct.hpp"
+#include "convert.hpp"
 
 using namespace mesos;
 
@@ -50,6 +51,40 @@ T parse(const void* data, int size)
 }
 
 
+// Constructs a protobuf of type T from its Java counterpart by
+// grabbing the serialized bytes via toByteArray and parsing them in
+// place. Pinning the array with GetPrimitiveArrayCritical avoids the
+// copy that GetByteArrayElements is allowed to make.
+template <typename T>
+T parse(JNIEnv* env, jobject jobj)
+{
+  // byte[] data = obj.toByteArray();
+  // NOTE: toByteArray is declared by AbstractMessageLite, so the
+  // cached method ID dispatches correctly for every generated
+  // message type.
+  const std::pair<jclass, jmethodID>& toByteArray =
+    lookupMethod(env,
+                 "com/google/protobuf/AbstractMessageLite",
+                 "toByteArray",
+                 "()[B",
+                 false);
+
+  jbyteArray jdata =
+    (jbyteArray) env->CallObjectMethod(jobj, toByteArray.second);
+
+  jsize length = env->GetArrayLength(jdata);
+
+  // NOTE: No JNI calls are allowed while the array is pinned.
+  void* data = env->GetPrimitiveArrayCritical(jdata, NULL);
+
+  const T& t = parse<T>(data, length);
+
+  env->ReleasePrimitiveArrayCritical(jdata, data, JNI_ABORT);
+
+  return t;
+}
+
+
 template <>
 string construct(JNIEnv* env, jobject jobj)
 {
@@ -113,147 +148,49 @@ map<string, string> construct(JNIEnv *env, jobject jobj)
 template <>
 FrameworkInfo construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const FrameworkInfo& framework = parse<FrameworkInfo>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return framework;
+  return parse<FrameworkInfo>(env, jobj);
 }
 
 
 template <>
 Filters construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const Filters& filters = parse<Filters>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return filters;
+  return parse<Filters>(env, jobj);
 }
 
 
 template <>
 FrameworkID construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const FrameworkID& frameworkId = parse<FrameworkID>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return frameworkId;
+  return parse<FrameworkID>(env, jobj);
 }
 
 
 template <>
 ExecutorID construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const ExecutorID& executorId = parse<ExecutorID>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return executorId;
+  return parse<ExecutorID>(env, jobj);
 }
 
 
 template <>
 TaskID construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const TaskID& taskId = parse<TaskID>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return taskId;
+  return parse<TaskID>(env, jobj);
 }
 
 
 template <>
 SlaveID construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const SlaveID& slaveId = parse<SlaveID>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return slaveId;
+  return parse<SlaveID>(env, jobj);
 }
 
 
 template <>
 OfferID construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const OfferID& offerId = parse<OfferID>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return offerId;
+  return parse<OfferID>(env, jobj);
 }
 
 
@@ -274,82 +211,26 @@ TaskState construct(JNIEnv* env, jobject jobj)
 template <>
 TaskInfo construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const TaskInfo& task = parse<TaskInfo>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return task;
+  return parse<TaskInfo>(env, jobj);
 }
 
 
 template <>
 TaskStatus construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const TaskStatus& status = parse<TaskStatus>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return status;
+  return parse<TaskStatus>(env, jobj);
 }
 
 
 template <>
 ExecutorInfo construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const ExecutorInfo& executor = parse<ExecutorInfo>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return executor;
+  return parse<ExecutorInfo>(env, jobj);
 }
 
 
 template <>
 Request construct(JNIEnv* env, jobject jobj)
 {
-  jclass clazz = env->GetObjectClass(jobj);
-
-  // byte[] data = obj.toByteArray();
-  jmethodID toByteArray = env->GetMethodID(clazz, "toByteArray", "()[B");
-
-  jbyteArray jdata = (jbyteArray) env->CallObjectMethod(jobj, toByteArray);
-
-  jbyte* data = env->GetByteArrayElements(jdata, NULL);
-  jsize length = env->GetArrayLength(jdata);
-
-  const Request& request = parse<Request>(data, length);
-
-  env->ReleaseByteArrayElements(jdata, data, 0);
-
-  return request;
+  return parse<Request>(env, jobj);
 }
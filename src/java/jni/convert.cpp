@@ -17,10 +17,15 @@
  */
 
 #include <jni.h>
+#include <pthread.h>
 
+#include <map>
 #include <string>
+#include <utility>
 #include <assert.h>
 
+#include <google/protobuf/message.h>
+
 #include <mesos/mesos.hpp>
 
 #include <stout/strings.hpp>
@@ -105,6 +110,156 @@ jclass FindMesosClass(JNIEnv* env, const char* className)
   return cls;
 }
 
+
+// Cache of class and method ID lookups, see lookupMethod in
+// convert.hpp. The global references keep the classes from being
+// unloaded (which also keeps the cached jmethodIDs valid).
+pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+std::map<string, std::pair<jclass, jmethodID> > methodCache;
+
+
+// Converts a protobuf message into its Java counterpart by
+// serializing it directly into an exactly sized Java byte[] and
+// invoking the (cached) parseFrom on the Java side. Serializing in
+// place avoids the intermediate native buffer (and its copy) that
+// SerializeToString would require for every message.
+jobject convert(
+    JNIEnv* env,
+    const google::protobuf::Message& message,
+    const char* className)
+{
+  const int size = message.ByteSize();
+
+  jbyteArray jdata = env->NewByteArray(size);
+
+  // NOTE: No JNI calls are allowed while the array is pinned.
+  void* data = env->GetPrimitiveArrayCritical(jdata, NULL);
+  bool serialized = message.SerializeToArray(data, size);
+  env->ReleasePrimitiveArrayCritical(jdata, data, 0);
+
+  CHECK(serialized) << "Unexpected failure while serializing protobuf";
+
+  const string signature = string("([B)L") + className + ";";
+
+  const std::pair<jclass, jmethodID>& parseFrom =
+    lookupMethod(env, className, "parseFrom", signature.c_str(), true);
+
+  return env->CallStaticObjectMethod(parseFrom.first, parseFrom.second, jdata);
+}
+
+} // namespace {
+
+
+std::pair<jclass, jmethodID> lookupMethod(
+    JNIEnv* env,
+    const char* className,
+    const char* methodName,
+    const char* signature,
+    bool isStatic)
+{
+  const string key = string(className) + "." + methodName + signature;
+
+  pthread_mutex_lock(&cacheMutex);
+
+  std::pair<jclass, jmethodID>& entry = methodCache[key];
+
+  if (entry.first == NULL) {
+    jclass clazz = FindMesosClass(env, className);
+    CHECK(clazz != NULL) << "Failed to find class " << className;
+
+    entry.first = (jclass) env->NewGlobalRef(clazz);
+    entry.second = isStatic
+      ? env->GetStaticMethodID(entry.first, methodName, signature)
+      : env->GetMethodID(entry.first, methodName, signature);
+  }
+
+  std::pair<jclass, jmethodID> result = entry;
+
+  pthread_mutex_unlock(&cacheMutex);
+
+  return result;
+}
+
+
+namespace {
+
+// Pre-populates the method cache for the conversions on the
+// per-message hot paths, so steady-state marshalling never does a
+// ClassLoader walk. Types missing from these lists simply fall back
+// to caching on first use.
+void initializeMethodCache(JNIEnv* env)
+{
+  static const char* messages[] = {
+    "org/apache/mesos/Protos$FrameworkID",
+    "org/apache/mesos/Protos$FrameworkInfo",
+    "org/apache/mesos/Protos$MasterInfo",
+    "org/apache/mesos/Protos$ExecutorID",
+    "org/apache/mesos/Protos$TaskID",
+    "org/apache/mesos/Protos$SlaveID",
+    "org/apache/mesos/Protos$SlaveInfo",
+    "org/apache/mesos/Protos$OfferID",
+    "org/apache/mesos/Protos$TaskInfo",
+    "org/apache/mesos/Protos$TaskStatus",
+    "org/apache/mesos/Protos$Offer",
+    "org/apache/mesos/Protos$ExecutorInfo",
+    NULL
+  };
+
+  for (int i = 0; messages[i] != NULL; i++) {
+    const string signature = string("([B)L") + messages[i] + ";";
+    lookupMethod(env, messages[i], "parseFrom", signature.c_str(), true);
+  }
+
+  lookupMethod(env,
+               "org/apache/mesos/Protos$TaskState",
+               "valueOf",
+               "(I)Lorg/apache/mesos/Protos$TaskState;",
+               true);
+
+  lookupMethod(env,
+               "org/apache/mesos/Protos$Status",
+               "valueOf",
+               "(I)Lorg/apache/mesos/Protos$Status;",
+               true);
+
+  // The Java to protobuf direction (see construct.cpp): toByteArray
+  // is declared by AbstractMessageLite, so one method ID dispatches
+  // correctly for every generated message type.
+  lookupMethod(env,
+               "com/google/protobuf/AbstractMessageLite",
+               "toByteArray",
+               "()[B",
+               false);
+
+  // Log.Position and Log.Entry construction (see
+  // org_apache_mesos_Log.cpp).
+  lookupMethod(env, "org/apache/mesos/Log$Position", "<init>", "(J)V", false);
+
+  lookupMethod(env,
+               "org/apache/mesos/Log$Entry",
+               "<init>",
+               "(Lorg/apache/mesos/Log$Position;[B)V",
+               false);
+}
+
+
+// Releases the global class references held by the method cache.
+void finalizeMethodCache(JNIEnv* env)
+{
+  pthread_mutex_lock(&cacheMutex);
+
+  std::map<string, std::pair<jclass, jmethodID> >::iterator iterator;
+  for (iterator = methodCache.begin();
+       iterator != methodCache.end();
+       ++iterator) {
+    env->DeleteGlobalRef(iterator->second.first);
+  }
+
+  methodCache.clear();
+
+  pthread_mutex_unlock(&cacheMutex);
+}
+
 } // namespace {
 
 
@@ -172,6 +327,10 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* jvm, void* reserved)
   jfieldID loaded = env->GetStaticFieldID(clazz, "loaded", "Z");
   env->SetStaticBooleanField(clazz, loaded, (jboolean) true);
 
+  // Pre-populate the JNI method cache while we have a thread whose
+  // context ClassLoader can resolve the Mesos classes.
+  initializeMethodCache(env);
+
   return JNI_VERSION_1_2;
 }
 
@@ -186,6 +345,8 @@ JNIEXPORT void JNICALL JNI_OnUnLoad(JavaVM* jvm, void* reserved)
 
   // TODO(benh): Must we set 'MesosNativeLibrary.loaded' to false?
 
+  finalizeMethodCache(env);
+
   if (mesosClassLoader != NULL) {
     env->DeleteWeakGlobalRef(mesosClassLoader);
     mesosClassLoader = NULL;
@@ -203,309 +364,113 @@ jobject convert(JNIEnv* env, const string& s)
 template <>
 jobject convert(JNIEnv* env, const FrameworkID& frameworkId)
 {
-  string data;
-  frameworkId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // FrameworkID frameworkId = FrameworkID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$FrameworkID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$FrameworkID;");
-
-  jobject jframeworkId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jframeworkId;
+  return convert(env, frameworkId, "org/apache/mesos/Protos$FrameworkID");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const FrameworkInfo& frameworkInfo)
 {
-  string data;
-  frameworkInfo.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // FrameworkInfo frameworkInfo = FrameworkInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$FrameworkInfo");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$FrameworkInfo;");
-
-  jobject jframeworkInfo = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jframeworkInfo;
+  return convert(env, frameworkInfo, "org/apache/mesos/Protos$FrameworkInfo");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const MasterInfo& masterInfo)
 {
-  string data;
-  masterInfo.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // MasterInfo masterInfo = MasterInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$MasterInfo");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$MasterInfo;");
-
-  jobject jmasterInfo = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jmasterInfo;
+  return convert(env, masterInfo, "org/apache/mesos/Protos$MasterInfo");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const ExecutorID& executorId)
 {
-  string data;
-  executorId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // ExecutorID executorId = ExecutorID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$ExecutorID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$ExecutorID;");
-
-  jobject jexecutorId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jexecutorId;
+  return convert(env, executorId, "org/apache/mesos/Protos$ExecutorID");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const TaskID& taskId)
 {
-  string data;
-  taskId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // TaskID taskId = TaskID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$TaskID;");
-
-  jobject jtaskId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jtaskId;
+  return convert(env, taskId, "org/apache/mesos/Protos$TaskID");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const SlaveID& slaveId)
 {
-  string data;
-  slaveId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // SlaveID slaveId = SlaveID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$SlaveID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$SlaveID;");
-
-  jobject jslaveId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jslaveId;
+  return convert(env, slaveId, "org/apache/mesos/Protos$SlaveID");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const SlaveInfo& slaveInfo)
 {
-  string data;
-  slaveInfo.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // SlaveInfo slaveInfo = SlaveInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$SlaveInfo");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$SlaveInfo;");
-
-  jobject jslaveInfo = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jslaveInfo;
+  return convert(env, slaveInfo, "org/apache/mesos/Protos$SlaveInfo");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const OfferID& offerId)
 {
-  string data;
-  offerId.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // OfferID offerId = OfferID.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$OfferID");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$OfferID;");
-
-  jobject jofferId = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jofferId;
+  return convert(env, offerId, "org/apache/mesos/Protos$OfferID");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const TaskState& state)
 {
-  jint jvalue = state;
-
   // TaskState state = TaskState.valueOf(value);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskState");
-
-  jmethodID valueOf =
-    env->GetStaticMethodID(clazz, "valueOf",
-                           "(I)Lorg/apache/mesos/Protos$TaskState;");
-
-  jobject jstate = env->CallStaticObjectMethod(clazz, valueOf, jvalue);
-
-  return jstate;
+  const std::pair<jclass, jmethodID>& valueOf =
+    lookupMethod(env,
+                 "org/apache/mesos/Protos$TaskState",
+                 "valueOf",
+                 "(I)Lorg/apache/mesos/Protos$TaskState;",
+                 true);
+
+  return env->CallStaticObjectMethod(
+      valueOf.first, valueOf.second, (jint) state);
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const TaskInfo& task)
 {
-  string data;
-  task.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // TaskInfo task = TaskInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskInfo");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$TaskInfo;");
-
-  jobject jtask = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jtask;
+  return convert(env, task, "org/apache/mesos/Protos$TaskInfo");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const TaskStatus& status)
 {
-  string data;
-  status.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // TaskStatus status = TaskStatus.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$TaskStatus");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$TaskStatus;");
-
-  jobject jstatus = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jstatus;
+  return convert(env, status, "org/apache/mesos/Protos$TaskStatus");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const Offer& offer)
 {
-  string data;
-  offer.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // Offer offer = Offer.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$Offer");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$Offer;");
-
-  jobject joffer = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return joffer;
+  return convert(env, offer, "org/apache/mesos/Protos$Offer");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const ExecutorInfo& executor)
 {
-  string data;
-  executor.SerializeToString(&data);
-
-  // byte[] data = ..;
-  jbyteArray jdata = env->NewByteArray(data.size());
-  env->SetByteArrayRegion(jdata, 0, data.size(), (jbyte*) data.data());
-
-  // ExecutorInfo executor = ExecutorInfo.parseFrom(data);
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$ExecutorInfo");
-
-  jmethodID parseFrom =
-    env->GetStaticMethodID(clazz, "parseFrom",
-                           "([B)Lorg/apache/mesos/Protos$ExecutorInfo;");
-
-  jobject jexecutor = env->CallStaticObjectMethod(clazz, parseFrom, jdata);
-
-  return jexecutor;
+  return convert(env, executor, "org/apache/mesos/Protos$ExecutorInfo");
 }
 
 
 template <>
 jobject convert(JNIEnv* env, const Status& status)
 {
-  jint jvalue = status;
-
-  jclass clazz = FindMesosClass(env, "org/apache/mesos/Protos$Status");
-
-  jmethodID valueOf =
-    env->GetStaticMethodID(clazz, "valueOf",
-                           "(I)Lorg/apache/mesos/Protos$Status;");
-
-  jobject jstate = env->CallStaticObjectMethod(clazz, valueOf, jvalue);
-
-  return jstate;
+  const std::pair<jclass, jmethodID>& valueOf =
+    lookupMethod(env,
+                 "org/apache/mesos/Protos$Status",
+                 "valueOf",
+                 "(I)Lorg/apache/mesos/Protos$Status;",
+                 true);
+
+  return env->CallStaticObjectMethod(
+      valueOf.first, valueOf.second, (jint) status);
 }
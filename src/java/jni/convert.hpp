@@ -21,8 +21,25 @@
 
 #include <jni.h>
 
+#include <utility>
+
 
 template <typename T>
 jobject convert(JNIEnv* env, const T& t);
 
+
+// Returns the class named 'className' (resolved with the Mesos
+// ClassLoader, see convert.cpp) and its method with the given name
+// and signature, caching the lookup: the first call per method does
+// the ClassLoader walk and pins the class with a global reference,
+// subsequent calls are a map lookup. The cache is pre-populated for
+// the per-message hot paths in JNI_OnLoad and emptied in
+// JNI_OnUnLoad.
+std::pair<jclass, jmethodID> lookupMethod(
+    JNIEnv* env,
+    const char* className,
+    const char* methodName,
+    const char* signature,
+    bool isStatic);
+
 #endif // __CONVERT_HPP__
@@ -80,11 +80,11 @@ jobject convert(JNIEnv* env, const Log::Position& position)
 
   // We can create a Java Log.Position directly because JNI does not
   // enforce access modifiers (thus breaking encapsulation).
-  jclass clazz = env->FindClass("org/apache/mesos/Log$Position");
+  const std::pair<jclass, jmethodID>& constructor = lookupMethod(
+      env, "org/apache/mesos/Log$Position", "<init>", "(J)V", false);
 
-  jmethodID _init_ = env->GetMethodID(clazz, "<init>", "(J)V");
-
-  jobject jposition = env->NewObject(clazz, _init_, jvalue);
+  jobject jposition =
+    env->NewObject(constructor.first, constructor.second, jvalue);
 
   return jposition;
 }
@@ -102,13 +102,15 @@ jobject convert(JNIEnv* env, const Log::Entry& entry)
 
   // We can create a Java Log.Entry directly because JNI does not
   // enforce access modifiers (thus breaking encapsulation).
-  jclass clazz = env->FindClass("org/apache/mesos/Log$Entry");
-
-  jmethodID _init_ = env->GetMethodID(clazz, "<init>",
-                                      "(Lorg/apache/mesos/Log$Position;"
-                                      "[B)V");
-
-  jobject jentry = env->NewObject(clazz, _init_, jposition, jdata);
+  const std::pair<jclass, jmethodID>& constructor = lookupMethod(
+      env,
+      "org/apache/mesos/Log$Entry",
+      "<init>",
+      "(Lorg/apache/mesos/Log$Position;[B)V",
+      false);
+
+  jobject jentry =
+    env->NewObject(constructor.first, constructor.second, jposition, jdata);
 
   return jentry;
 }
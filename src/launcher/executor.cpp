@@ -17,26 +17,33 @@
  */
 
 #include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 
 #include <sys/wait.h>
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <mesos/executor.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/os.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
 
 #include "common/process_utils.hpp"
 #include "common/thread.hpp"
 
+#include "launcher/launcher.hpp"
+
 #include "logging/logging.hpp"
 
 using std::string;
 
+extern char** environ;
+
 namespace mesos {
 namespace internal {
 
@@ -125,88 +132,46 @@ public:
 
     std::cout << "Starting task " << task.task_id().value() << std::endl;
 
-    // Use pipes to determine which child has successfully changed
-    // session. This is needed as the setsid call can fail from other
-    // processes having the same group id.
-    int pipes[2];
-    if (pipe(pipes) < 0) {
-      perror("Failed to create a pipe");
+    // Launch the command via posix_spawn rather than fork so that the
+    // start time is independent of this executor's memory size:
+    // posix_spawn is implemented with vfork under glibc and never
+    // duplicates our page tables. posix_spawn cannot run setsid in
+    // the child, so the command gets its own process group (which is
+    // what killtree walks for cleanup) rather than its own session.
+    posix_spawnattr_t attributes;
+
+    int result = posix_spawnattr_init(&attributes);
+    if (result != 0) {
+      std::cerr << "Failed to initialize spawn attributes: "
+                << strerror(result) << std::endl;
       abort();
     }
 
-    // Set the FD_CLOEXEC flags on these pipes
-    Try<Nothing> cloexec = os::cloexec(pipes[0]);
-    if (cloexec.isError()) {
-      std::cerr << "Failed to cloexec(pipe[0]): " << cloexec.error()
-                << std::endl;
-      abort();
-    }
+    posix_spawnattr_setpgroup(&attributes, 0);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
 
-    cloexec = os::cloexec(pipes[1]);
-    if (cloexec.isError()) {
-      std::cerr << "Failed to cloexec(pipe[1]): " << cloexec.error()
-                << std::endl;
-      abort();
-    }
+    // The arguments reference the command, which outlives the spawn.
+    std::vector<char*> arguments =
+      launcher::shellArguments(task.command().value());
 
-    if ((pid = fork()) == -1) {
-      std::cerr << "Failed to fork to run '" << task.command().value() << "': "
-                << strerror(errno) << std::endl;
-      abort();
-    }
+    std::cout << "sh -c '" << task.command().value() << "'" << std::endl;
 
-    if (pid == 0) {
-      // In child process, we make cleanup easier by putting process
-      // into it's own session.
-      close(pipes[0]);
-
-      // NOTE: We setsid() in a loop because setsid() might fail if another
-      // process has the same process group id as the calling process.
-      while ((pid = setsid()) == -1) {
-        perror("Could not put command in its own session, setsid");
-
-        std::cout << "Forking another process and retrying" << std::endl;
-
-        if ((pid = fork()) == -1) {
-          perror("Failed to fork to launch command");
-          abort();
-        }
-
-        if (pid > 0) {
-          // In parent process. It is ok to suicide here, because
-          // we're not watching this process.
-          exit(0);
-        }
-      }
-
-      if (write(pipes[1], &pid, sizeof(pid)) != sizeof(pid)) {
-        perror("Failed to write PID on pipe");
-        abort();
-      }
-
-      close(pipes[1]);
-
-      // The child has successfully setsid, now run the command.
-      std::cout << "sh -c '" << task.command().value() << "'" << std::endl;
-      execl("/bin/sh", "sh", "-c",
-            task.command().value().c_str(), (char*) NULL);
-      perror("Failed to exec");
-      abort();
-    }
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    result = posix_spawn(
+        &pid, "/bin/sh", NULL, &attributes, &arguments[0], environ);
 
-    // In parent process.
-    close(pipes[1]);
+    posix_spawnattr_destroy(&attributes);
 
-    // Get the child's pid via the pipe.
-    if (read(pipes[0], &pid, sizeof(pid)) == -1) {
-      std::cerr << "Failed to get child PID from pipe, read: "
-                << strerror(errno) << std::endl;
+    if (result != 0) {
+      std::cerr << "Failed to spawn '" << task.command().value() << "': "
+                << strerror(result) << std::endl;
       abort();
     }
 
-    close(pipes[0]);
-
-    std::cout << "Forked command at " << pid << std::endl;
+    std::cout << "Spawned command at " << pid
+              << " in " << stopwatch.elapsed() << std::endl;
 
     // In parent process, fork a thread to wait for this process.
     thread::start(std::tr1::bind(&waiter, pid, task.task_id(), driver));
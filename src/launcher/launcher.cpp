@@ -18,12 +18,22 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <libgen.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pwd.h>
+#include <utime.h>
 
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <sstream>
+#include <utility>
+#include <vector>
+
+#include <sys/file.h>
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -35,6 +45,7 @@
 #include <stout/nothing.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 
 #include "launcher/launcher.hpp"
 
@@ -45,13 +56,27 @@
 using std::cerr;
 using std::cout;
 using std::endl;
+using std::map;
 using std::ostringstream;
+using std::pair;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
 namespace launcher {
 
+vector<char*> shellArguments(const string& command)
+{
+  vector<char*> arguments;
+  arguments.push_back((char*) "sh");
+  arguments.push_back((char*) "-c");
+  arguments.push_back((char*) command.c_str());
+  arguments.push_back(NULL);
+  return arguments;
+}
+
+
 ExecutorLauncher::ExecutorLauncher(
     const SlaveID& _slaveId,
     const FrameworkID& _frameworkId,
@@ -64,6 +89,9 @@ ExecutorLauncher::ExecutorLauncher(
     const string& _slavePid,
     const string& _frameworksHome,
     const string& _hadoopHome,
+    const string& _fetchCacheDirectory,
+    const Bytes& _fetchCacheSize,
+    const Bytes& _fetchRateLimit,
     bool _redirectIO,
     bool _shouldSwitchUser,
     bool _checkpoint)
@@ -78,6 +106,9 @@ ExecutorLauncher::ExecutorLauncher(
     slavePid(_slavePid),
     frameworksHome(_frameworksHome),
     hadoopHome(_hadoopHome),
+    fetchCacheDirectory(_fetchCacheDirectory),
+    fetchCacheSize(_fetchCacheSize),
+    fetchRateLimit(_fetchRateLimit),
     redirectIO(_redirectIO),
     shouldSwitchUser(_shouldSwitchUser),
     checkpoint (_checkpoint) {}
@@ -168,7 +199,8 @@ int ExecutorLauncher::launch()
   const string& command = commandInfo.value();
 
   // Execute the command (via '/bin/sh -c command').
-  execl("/bin/sh", "sh", "-c", command.c_str(), (char*) NULL);
+  vector<char*> arguments = shellArguments(command);
+  execv("/bin/sh", &arguments[0]);
 
   // If we get here, the execv call failed.
   fatalerror("Could not execute '/bin/sh -c %s'", command.c_str());
@@ -187,183 +219,126 @@ int ExecutorLauncher::run()
 }
 
 
+namespace {
+
+// Number of URIs fetched at a time. Each fetch runs the whole
+// per-URI pipeline (download, chown, chmod, extract) in its own
+// child process, so extraction of finished archives also overlaps
+// with the remaining downloads.
+const size_t FETCH_CONCURRENCY = 4;
+
+} // namespace {
+
+
 // Download the executor's files and optionally set executable permissions
 // if requested.
 int ExecutorLauncher::fetchExecutors()
 {
   cout << "Fetching resources into '" << workDirectory << "'" << endl;
 
-  foreach(const CommandInfo::URI& uri, commandInfo.uris()) {
-    string resource = uri.value();
-    bool executable = uri.has_executable() && uri.executable();
-
-    cout << "Fetching resource '" << resource << "'" << endl;
-
+  vector<CommandInfo::URI> uris;
+  foreach (const CommandInfo::URI& uri, commandInfo.uris()) {
     // Some checks to make sure using the URI value in shell commands
     // is safe. TODO(benh): These should be pushed into the scheduler
     // driver and reported to the user.
-    if (resource.find_first_of('\\') != string::npos ||
-        resource.find_first_of('\'') != string::npos ||
-        resource.find_first_of('\0') != string::npos) {
+    if (uri.value().find_first_of('\\') != string::npos ||
+        uri.value().find_first_of('\'') != string::npos ||
+        uri.value().find_first_of('\0') != string::npos) {
       cerr << "Illegal characters in URI" << endl;
       return -1;
     }
 
-    // Grab the resource from HDFS if its path begins with hdfs:// or
-    // htfp://. TODO(matei): Enforce some size limits on files we get
-    // from HDFS
-    if (resource.find("hdfs://") == 0 || resource.find("hftp://") == 0) {
-      // Locate Hadoop's bin/hadoop script. If a Hadoop home was given to us by
-      // the slave (from the Mesos config file), use that. Otherwise check for
-      // a HADOOP_HOME environment variable. Finally, if that doesn't exist,
-      // try looking for hadoop on the PATH.
-      string hadoopScript;
-      if (hadoopHome != "") {
-        hadoopScript = path::join(hadoopHome, "bin/hadoop");
-      } else if (getenv("HADOOP_HOME") != 0) {
-        hadoopScript = path::join(string(getenv("HADOOP_HOME")), "bin/hadoop");
-      } else {
-        hadoopScript = "hadoop"; // Look for hadoop on the PATH.
-      }
+    uris.push_back(uri);
+  }
 
-      Try<std::string> base = os::basename(resource);
-      if (base.isError()) {
-        cerr << base.error() << endl;
-        return -1;
-      }
+  if (uris.empty()) {
+    return 0;
+  }
 
-      string localFile = path::join(".", base.get());
-      ostringstream command;
-      command << hadoopScript << " fs -copyToLocal '" << resource
-              << "' '" << localFile << "'";
-      cout << "Downloading resource from '" << resource << "'" << endl;
-      cout << "HDFS command: " << command.str() << endl;
-
-      int ret = os::system(command.str());
-      if (ret != 0) {
-        cerr << "HDFS copyToLocal failed: return code " << ret << endl;
-        return -1;
-      }
-      resource = localFile;
-    } else if (resource.find("http://") == 0
-               || resource.find("https://") == 0
-               || resource.find("ftp://") == 0
-               || resource.find("ftps://") == 0) {
-      string path = resource.substr(resource.find("://") + 3);
-      if (path.find("/") == string::npos) {
-        cerr << "Malformed URL (missing path)" << endl;
-        return -1;
-      }
+  // Fetch the URIs concurrently, each in a forked child running
+  // fetchExecutor() (see above). The configured rate limit is split
+  // evenly across the concurrent fetches. NOTE: The limit therefore
+  // applies per launching executor; simultaneously launching
+  // executors are not coordinated.
+  const size_t concurrency = std::min(uris.size(), FETCH_CONCURRENCY);
+
+  Bytes limit = Bytes(0);
+  if (fetchRateLimit.bytes() > 0) {
+    limit = Bytes(std::max(
+        fetchRateLimit.bytes() / concurrency, (uint64_t) 1));
+  }
 
-      if (path.size() <= path.find("/") + 1) {
-        cerr << "Malformed URL (missing path)" << endl;
-        return -1;
+  map<pid_t, size_t> children; // Running fetches, by URI index.
+  vector<Stopwatch> stopwatches(uris.size());
+
+  size_t next = 0; // Index of the next URI to fetch.
+  bool failed = false;
+
+  while (next < uris.size() || !children.empty()) {
+    // Top up the pool (unless a fetch has already failed, in which
+    // case we just drain the running children).
+    while (!failed && next < uris.size() && children.size() < concurrency) {
+      pid_t pid = fork();
+      if (pid < 0) {
+        cerr << "Failed to fork fetch process: " << strerror(errno) << endl;
+        failed = true;
+        break;
       }
 
-      path =  path::join(".", path.substr(path.find_last_of("/") + 1));
-      cout << "Downloading '" << resource << "' to '" << path << "'" << endl;
-      Try<int> code = net::download(resource, path);
-      if (code.isError()) {
-        cerr << "Error downloading resource: " << code.error().c_str() << endl;
-        return -1;
-      } else if (code.get() != 200) {
-        cerr << "Error downloading resource, received HTTP/FTP return code "
-             << code.get() << endl;
-        return -1;
-      }
-      resource = path;
-    } else { // Copy the local resource.
-      if (resource.find_first_of("/") != 0) {
-        // We got a non-Hadoop and non-absolute path.
-        if (frameworksHome != "") {
-          resource = path::join(frameworksHome, resource);
-          cout << "Prepended configuration option frameworks_home to resource "
-               << "path, making it: '" << resource << "'" << endl;
-        } else {
-          cerr << "A relative path was passed for the resource, but "
-               << "the configuration option frameworks_home is not set. "
-               << "Please either specify this config option "
-               << "or avoid using a relative path" << endl;
-          return -1;
-        }
+      if (pid == 0) {
+        // In child process.
+        _exit(fetchExecutor(uris[next], limit) < 0 ? 1 : 0);
       }
 
-      // Copy the resource to the current working directory.
-      ostringstream command;
-      command << "cp '" << resource << "' .";
-      cout << "Copying resource from '" << resource << "' to ." << endl;
+      stopwatches[next].start();
+      children[pid] = next;
+      next++;
+    }
 
-      int status = os::system(command.str());
-      if (status != 0) {
-        cerr << "Failed to copy '" << resource
-             << "' : Exit status " << status << endl;
-        return -1;
-      }
+    if (children.empty()) {
+      break;
+    }
 
-      Try<std::string> base = os::basename(resource);
-      if (base.isError()) {
-        cerr << base.error() << endl;
-        return -1;
+    int status;
+    pid_t pid = ::waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR) {
+        continue;
       }
+      cerr << "Failed to wait for fetch process: " << strerror(errno) << endl;
+      return -1;
+    }
 
-      resource = path::join(".", base.get());
+    if (children.count(pid) == 0) {
+      continue; // Not a fetch child.
     }
 
-    if (shouldSwitchUser) {
-      Try<Nothing> chown = os::chown(user, resource);
+    const size_t index = children[pid];
+    children.erase(pid);
+    stopwatches[index].stop();
 
-      if (chown.isError()) {
-        cerr << "Failed to chown '" << resource << "' to user " << user << ": "
-             << chown.error() << endl;
-        return -1;
-      }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      cerr << "Failed to fetch '" << uris[index].value() << "'" << endl;
+      failed = true;
     }
+  }
 
-    if (executable &&
-        !os::chmod(resource, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) {
-      cerr << "Failed to chmod '" << resource << "'" << endl;
-      return -1;
-    }
+  if (failed) {
+    return -1;
+  }
 
-    // Extract any .tgz, tar.gz, tar.bz2 or zip files.
-    if (strings::endsWith(resource, ".tgz") ||
-        strings::endsWith(resource, ".tar.gz")) {
-      string command = "tar xzf '" + resource + "'";
-      cout << "Extracting resource: " << command << endl;
-      int code = os::system(command);
-      if (code != 0) {
-        cerr << "Failed to extract resource: tar exit code " << code << endl;
-        return -1;
-      }
-    } else if (strings::endsWith(resource, ".tbz2") ||
-               strings::endsWith(resource, ".tar.bz2")) {
-      string command = "tar xjf '" + resource + "'";
-      cout << "Extracting resource: " << command << endl;
-      int code = os::system(command);
-      if (code != 0) {
-        cerr << "Failed to extract resource: tar exit code " << code << endl;
-        return -1;
-      }
-    } else if (strings::endsWith(resource, ".txz") ||
-               strings::endsWith(resource, ".tar.xz")) {
-      // If you want to use XZ on Mac OS, you can try the packages here:
-      // http://macpkg.sourceforge.net/
-      string command = "tar xJf '" + resource + "'";
-      cout << "Extracting resource: " << command << endl;
-      int code = os::system(command);
-      if (code != 0) {
-        cerr << "Failed to extract resource: tar exit code " << code << endl;
-        return -1;
-      }
-    } else if (strings::endsWith(resource, ".zip")) {
-      string command = "unzip '" + resource + "'";
-      cout << "Extracting resource: " << command << endl;
-      int code = os::system(command);
-      if (code != 0) {
-        cerr << "Failed to extract resource: unzip exit code " << code << endl;
-        return -1;
-      }
-    }
+  // Report the fetch durations back to the slave, which feeds them
+  // into its metrics registry when the executor registers.
+  ostringstream report;
+  for (size_t i = 0; i < uris.size(); i++) {
+    report << stopwatches[i].elapsed().us() << " " << uris[i].value() << endl;
+  }
+
+  Try<Nothing> write = os::write(
+      slave::paths::getFetchReportPath(workDirectory), report.str());
+  if (write.isError()) {
+    // Non-fatal: the report is only used for monitoring.
+    cerr << "Failed to write fetch durations: " << write.error() << endl;
   }
 
   // Recursively chown the work directory, since extraction may have occurred.
@@ -382,30 +357,464 @@ int ExecutorLauncher::fetchExecutors()
 }
 
 
-// Set up environment variables for launching a framework's executor.
-void ExecutorLauncher::setupEnvironment()
+// Fetches a single URI (downloading it at no more than 'limit' bytes
+// per second, unless zero), chowns and chmods the result as requested
+// and extracts it if it is an archive. NOTE: This runs in a child
+// process forked by fetchExecutors() above.
+int ExecutorLauncher::fetchExecutor(
+    const CommandInfo::URI& uri,
+    const Bytes& limit)
+{
+  string resource = uri.value();
+  const bool executable = uri.has_executable() && uri.executable();
+
+  cout << "Fetching resource '" << resource << "'" << endl;
+
+  // Fetch through the cache when one is configured, so that
+  // repeated launches with the same URIs do not re-download them;
+  // otherwise fetch directly into the sandbox. NOTE: We are
+  // chdir'ed into the work directory at this point.
+  if (fetchCacheDirectory.empty() || fetchCacheSize.bytes() == 0) {
+    resource = fetch(resource, ".", limit);
+  } else {
+    resource = fetchThroughCache(resource, limit);
+  }
+
+  if (resource.empty()) {
+    return -1;
+  }
+
+  if (shouldSwitchUser) {
+    Try<Nothing> chown = os::chown(user, resource);
+
+    if (chown.isError()) {
+      cerr << "Failed to chown '" << resource << "' to user " << user << ": "
+           << chown.error() << endl;
+      return -1;
+    }
+  }
+
+  if (executable &&
+      !os::chmod(resource, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) {
+    cerr << "Failed to chmod '" << resource << "'" << endl;
+    return -1;
+  }
+
+  // Extract any .tgz, tar.gz, tar.bz2 or zip files.
+  if (strings::endsWith(resource, ".tgz") ||
+      strings::endsWith(resource, ".tar.gz")) {
+    string command = "tar xzf '" + resource + "'";
+    cout << "Extracting resource: " << command << endl;
+    int code = os::system(command);
+    if (code != 0) {
+      cerr << "Failed to extract resource: tar exit code " << code << endl;
+      return -1;
+    }
+  } else if (strings::endsWith(resource, ".tbz2") ||
+             strings::endsWith(resource, ".tar.bz2")) {
+    string command = "tar xjf '" + resource + "'";
+    cout << "Extracting resource: " << command << endl;
+    int code = os::system(command);
+    if (code != 0) {
+      cerr << "Failed to extract resource: tar exit code " << code << endl;
+      return -1;
+    }
+  } else if (strings::endsWith(resource, ".txz") ||
+             strings::endsWith(resource, ".tar.xz")) {
+    // If you want to use XZ on Mac OS, you can try the packages here:
+    // http://macpkg.sourceforge.net/
+    string command = "tar xJf '" + resource + "'";
+    cout << "Extracting resource: " << command << endl;
+    int code = os::system(command);
+    if (code != 0) {
+      cerr << "Failed to extract resource: tar exit code " << code << endl;
+      return -1;
+    }
+  } else if (strings::endsWith(resource, ".zip")) {
+    string command = "unzip '" + resource + "'";
+    cout << "Extracting resource: " << command << endl;
+    int code = os::system(command);
+    if (code != 0) {
+      cerr << "Failed to extract resource: unzip exit code " << code << endl;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+
+// Downloads (or copies) 'resource' into 'directory', returning the
+// path of the local file or the empty string on failure. Downloads
+// are capped at 'limit' bytes per second, unless it is zero.
+string ExecutorLauncher::fetch(
+    const string& _resource,
+    const string& directory,
+    const Bytes& limit)
 {
+  string resource = _resource;
+
+  // Grab the resource from HDFS if its path begins with hdfs:// or
+  // htfp://. TODO(matei): Enforce some size limits on files we get
+  // from HDFS
+  if (resource.find("hdfs://") == 0 || resource.find("hftp://") == 0) {
+    // Locate Hadoop's bin/hadoop script. If a Hadoop home was given to us by
+    // the slave (from the Mesos config file), use that. Otherwise check for
+    // a HADOOP_HOME environment variable. Finally, if that doesn't exist,
+    // try looking for hadoop on the PATH.
+    string hadoopScript;
+    if (hadoopHome != "") {
+      hadoopScript = path::join(hadoopHome, "bin/hadoop");
+    } else if (getenv("HADOOP_HOME") != 0) {
+      hadoopScript = path::join(string(getenv("HADOOP_HOME")), "bin/hadoop");
+    } else {
+      hadoopScript = "hadoop"; // Look for hadoop on the PATH.
+    }
+
+    Try<std::string> base = os::basename(resource);
+    if (base.isError()) {
+      cerr << base.error() << endl;
+      return "";
+    }
+
+    string localFile = path::join(directory, base.get());
+    ostringstream command;
+    command << hadoopScript << " fs -copyToLocal '" << resource
+            << "' '" << localFile << "'";
+    cout << "Downloading resource from '" << resource << "'" << endl;
+    cout << "HDFS command: " << command.str() << endl;
+
+    int ret = os::system(command.str());
+    if (ret != 0) {
+      cerr << "HDFS copyToLocal failed: return code " << ret << endl;
+      return "";
+    }
+    return localFile;
+  } else if (resource.find("http://") == 0
+             || resource.find("https://") == 0
+             || resource.find("ftp://") == 0
+             || resource.find("ftps://") == 0) {
+    string path = resource.substr(resource.find("://") + 3);
+    if (path.find("/") == string::npos) {
+      cerr << "Malformed URL (missing path)" << endl;
+      return "";
+    }
+
+    if (path.size() <= path.find("/") + 1) {
+      cerr << "Malformed URL (missing path)" << endl;
+      return "";
+    }
+
+    path = path::join(directory, path.substr(path.find_last_of("/") + 1));
+    cout << "Downloading '" << resource << "' to '" << path << "'" << endl;
+    Try<int> code = net::download(resource, path, limit);
+    if (code.isError()) {
+      cerr << "Error downloading resource: " << code.error().c_str() << endl;
+      return "";
+    } else if (code.get() != 200) {
+      cerr << "Error downloading resource, received HTTP/FTP return code "
+           << code.get() << endl;
+      return "";
+    }
+    return path;
+  } else { // Copy the local resource.
+    if (resource.find_first_of("/") != 0) {
+      // We got a non-Hadoop and non-absolute path.
+      if (frameworksHome != "") {
+        resource = path::join(frameworksHome, resource);
+        cout << "Prepended configuration option frameworks_home to resource "
+             << "path, making it: '" << resource << "'" << endl;
+      } else {
+        cerr << "A relative path was passed for the resource, but "
+             << "the configuration option frameworks_home is not set. "
+             << "Please either specify this config option "
+             << "or avoid using a relative path" << endl;
+        return "";
+      }
+    }
+
+    // Copy the resource into the directory.
+    ostringstream command;
+    command << "cp '" << resource << "' '" << directory << "'";
+    cout << "Copying resource from '" << resource
+         << "' to '" << directory << "'" << endl;
+
+    int status = os::system(command.str());
+    if (status != 0) {
+      cerr << "Failed to copy '" << resource
+           << "' : Exit status " << status << endl;
+      return "";
+    }
+
+    Try<std::string> base = os::basename(resource);
+    if (base.isError()) {
+      cerr << base.error() << endl;
+      return "";
+    }
+
+    return path::join(directory, base.get());
+  }
+}
+
+
+namespace {
+
+// Returns a file system safe name for the cache entry of a URI: a
+// 64 bit FNV-1a hash of the URI, in hex. Collisions are detected via
+// the 'uri' file checkpointed in each entry (see below).
+string cacheKey(const string& uri)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < uri.size(); i++) {
+    hash ^= (uint8_t) uri[i];
+    hash *= 1099511628211ULL;
+  }
+
+  ostringstream out;
+  out << std::hex << hash;
+  return out.str();
+}
+
+} // namespace {
+
+
+// Fetches 'resource' through the cache. The cache has the layout
+// (rooted at slave::paths::getFetchCacheDir(flags.work_dir)):
+//
+//   <cache>/<key>/uri     The full URI, to detect hash collisions.
+//   <cache>/<key>/<base>  The fetched file itself.
+//   <cache>/<key>.lock    flock(2)'d while fetching or evicting the
+//                         entry, so that concurrent launchers fetch a
+//                         URI once and share the result.
+string ExecutorLauncher::fetchThroughCache(
+    const string& resource,
+    const Bytes& limit)
+{
+  Try<Nothing> mkdir = os::mkdir(fetchCacheDirectory);
+  if (mkdir.isError()) {
+    cerr << "Failed to create fetch cache directory '" << fetchCacheDirectory
+         << "': " << mkdir.error() << endl;
+    return "";
+  }
+
+  Try<std::string> base = os::basename(resource);
+  if (base.isError()) {
+    cerr << base.error() << endl;
+    return "";
+  }
+
+  const string& entry = path::join(fetchCacheDirectory, cacheKey(resource));
+  const string& file = path::join(entry, base.get());
+
+  // Take the entry's lock, waiting out any concurrent launcher that
+  // is currently fetching this URI (or an evictor removing it).
+  int lock = ::open((entry + ".lock").c_str(), O_CREAT | O_RDWR, 0600);
+  if (lock < 0 || ::flock(lock, LOCK_EX) < 0) {
+    cerr << "Failed to lock fetch cache entry '" << entry << "': "
+         << strerror(errno) << endl;
+    if (lock >= 0) {
+      ::close(lock);
+    }
+    return "";
+  }
+
+  // Check for a hit: the entry must hold this exact URI (it might
+  // instead hold a URI whose hash collides) and the fetched file.
+  Try<string> uri = os::read(path::join(entry, "uri"));
+  if (uri.isSome() && uri.get() == resource && os::exists(file)) {
+    cout << "Using cached copy of '" << resource << "'" << endl;
+  } else {
+    if (os::exists(entry)) {
+      os::rmdir(entry); // Stale or colliding entry; refetch.
+    }
+
+    Try<Nothing> mkdir = os::mkdir(entry);
+    if (mkdir.isError()) {
+      cerr << "Failed to create fetch cache entry '" << entry << "': "
+           << mkdir.error() << endl;
+      ::close(lock); // Releases the lock.
+      return "";
+    }
+
+    if (fetch(resource, entry, limit).empty()) {
+      os::rmdir(entry); // Don't leave a partial download behind.
+      ::close(lock);
+      return "";
+    }
+
+    // Checkpoint the URI last: its presence marks the entry complete.
+    Try<Nothing> write = os::write(path::join(entry, "uri"), resource);
+    if (write.isError()) {
+      cerr << "Failed to checkpoint URI in fetch cache entry '" << entry
+           << "': " << write.error() << endl;
+      os::rmdir(entry);
+      ::close(lock);
+      return "";
+    }
+  }
+
+  // Record the use for least-recently-used eviction.
+  ::utime(entry.c_str(), NULL);
+
+  // Get the cached file into the sandbox (our working directory).
+  const string& target = path::join(".", base.get());
+
+  if (shouldSwitchUser) {
+    // Copy rather than hard-link, since the launcher chowns (and the
+    // executor may modify) the sandbox copy, which must not alter the
+    // shared cache copy.
+    int status = os::system("cp '" + file + "' '" + target + "'");
+    if (status != 0) {
+      cerr << "Failed to copy '" << file
+           << "' : Exit status " << status << endl;
+      ::close(lock);
+      return "";
+    }
+  } else if (::link(file.c_str(), target.c_str()) < 0) {
+    // Hard-linking fails if the cache is on a different file system
+    // (EXDEV) among others; fall back to copying. NOTE: Executors
+    // must treat hard-linked resources as read only!
+    int status = os::system("cp '" + file + "' '" + target + "'");
+    if (status != 0) {
+      cerr << "Failed to copy '" << file
+           << "' : Exit status " << status << endl;
+      ::close(lock);
+      return "";
+    }
+  }
+
+  // Evict while still holding this entry's lock, so that the entry
+  // just fetched (or reused) is itself never evicted, even if it
+  // alone exceeds the cache size.
+  evictCache();
+
+  ::close(lock); // Releases the lock.
+
+  return target;
+}
+
+
+// Evicts least recently used cache entries (skipping any locked by a
+// concurrent fetch) until the cache fits in 'fetchCacheSize'. Note
+// that evicting an entry only unlinks the cache's reference; sandbox
+// hard links to it remain usable.
+void ExecutorLauncher::evictCache()
+{
+  // Collect the entries with their sizes, ordered by mtime (which
+  // fetchThroughCache() updates on every use).
+  typedef pair<long, string> Entry; // (mtime, entry path).
+  vector<Entry> entries;
+  map<string, uint64_t> sizes;
+  uint64_t total = 0;
+
+  foreach (const string& name, os::ls(fetchCacheDirectory)) {
+    if (strings::endsWith(name, ".lock")) {
+      continue;
+    }
+
+    const string& entry = path::join(fetchCacheDirectory, name);
+
+    Try<long> mtime = os::mtime(entry);
+    if (mtime.isError()) {
+      continue; // Evicted by a concurrent launcher.
+    }
+
+    uint64_t size = 0;
+    foreach (const string& file, os::ls(entry)) {
+      struct stat s;
+      if (::stat(path::join(entry, file).c_str(), &s) == 0) {
+        size += s.st_size;
+      }
+    }
+
+    entries.push_back(std::make_pair(mtime.get(), entry));
+    sizes[entry] = size;
+    total += size;
+  }
+
+  if (total <= fetchCacheSize.bytes()) {
+    return;
+  }
+
+  std::sort(entries.begin(), entries.end()); // Least recently used first.
+
+  foreach (const Entry& next, entries) {
+    if (total <= fetchCacheSize.bytes()) {
+      break;
+    }
+
+    const string& entry = next.second;
+
+    // Skip entries being fetched or linked right now.
+    int lock = ::open((entry + ".lock").c_str(), O_CREAT | O_RDWR, 0600);
+    if (lock < 0) {
+      continue;
+    }
+
+    if (::flock(lock, LOCK_EX | LOCK_NB) < 0) {
+      ::close(lock);
+      continue;
+    }
+
+    cout << "Evicting '" << entry << "' from the fetch cache" << endl;
+
+    os::rmdir(entry);
+    os::rm(entry + ".lock");
+    total -= sizes[entry];
+
+    ::close(lock); // Releases the lock.
+  }
+}
+
+
+// Return the environment variables for launching a framework's
+// executor. NOTE: The values are collected into a map (where later
+// insertions overwrite earlier ones) so that the result can also be
+// shipped to another process, e.g., a launcher pool helper.
+map<string, string> ExecutorLauncher::environment()
+{
+  map<string, string> environment;
+
   // Set LIBPROCESS_PORT so that we bind to a random free port (since
   // this might have been set via --port option). We do this before
   // the environment variables below in case it is included.
-  os::setenv("LIBPROCESS_PORT", "0");
+  environment["LIBPROCESS_PORT"] = "0";
+
+  // Share the slave's unix domain socket directory (if any) so that
+  // the executor and the slave talk over the unix domain transport
+  // instead of TCP over loopback.
+  if (os::hasenv("LIBPROCESS_SOCKET_DIR")) {
+    environment["LIBPROCESS_SOCKET_DIR"] =
+      os::getenv("LIBPROCESS_SOCKET_DIR");
+  }
 
   // Set up the environment as specified in the ExecutorInfo.
   if (commandInfo.has_environment()) {
     foreach (const Environment::Variable& variable,
              commandInfo.environment().variables()) {
-      os::setenv(variable.name(), variable.value());
+      environment[variable.name()] = variable.value();
     }
   }
 
   // Set Mesos environment variables for slave ID, framework ID, etc.
-  os::setenv("MESOS_DIRECTORY", workDirectory);
-  os::setenv("MESOS_SLAVE_PID", slavePid);
-  os::setenv("MESOS_SLAVE_ID", slaveId.value());
-  os::setenv("MESOS_FRAMEWORK_ID", frameworkId.value());
-  os::setenv("MESOS_EXECUTOR_ID", executorId.value());
-  os::setenv("MESOS_EXECUTOR_UUID", uuid.toString());
-  os::setenv("MESOS_CHECKPOINT", checkpoint ? "1" : "0");
+  environment["MESOS_DIRECTORY"] = workDirectory;
+  environment["MESOS_SLAVE_PID"] = slavePid;
+  environment["MESOS_SLAVE_ID"] = slaveId.value();
+  environment["MESOS_FRAMEWORK_ID"] = frameworkId.value();
+  environment["MESOS_EXECUTOR_ID"] = executorId.value();
+  environment["MESOS_EXECUTOR_UUID"] = uuid.toString();
+  environment["MESOS_CHECKPOINT"] = checkpoint ? "1" : "0";
+
+  return environment;
+}
+
+
+// Set up environment variables for launching a framework's executor.
+void ExecutorLauncher::setupEnvironment()
+{
+  foreachpair (const string& key, const string& value, environment()) {
+    os::setenv(key, value);
+  }
 }
 
 
@@ -418,9 +827,9 @@ void ExecutorLauncher::switchUser()
 }
 
 
-void ExecutorLauncher::setupEnvironmentForLauncherMain()
+map<string, string> ExecutorLauncher::environmentForLauncherMain()
 {
-  setupEnvironment();
+  map<string, string> environment = this->environment();
 
   // Set up Mesos environment variables that launcher/main.cpp will
   // pass as arguments to an ExecutorLauncher there.
@@ -436,17 +845,32 @@ void ExecutorLauncher::setupEnvironmentForLauncherMain()
     uris = strings::trim(uris);
   }
 
-  os::setenv("MESOS_FRAMEWORK_ID", frameworkId.value());
-  os::setenv("MESOS_SLAVE_ID", slaveId.value());
-  os::setenv("MESOS_COMMAND", commandInfo.value());
-  os::setenv("MESOS_EXECUTOR_URIS", uris);
-  os::setenv("MESOS_USER", user);
-  os::setenv("MESOS_WORK_DIRECTORY", workDirectory);
-  os::setenv("MESOS_SLAVE_DIRECTORY", slaveDirectory);
-  os::setenv("MESOS_SLAVE_PID", slavePid);
-  os::setenv("MESOS_HADOOP_HOME", hadoopHome);
-  os::setenv("MESOS_REDIRECT_IO", redirectIO ? "1" : "0");
-  os::setenv("MESOS_SWITCH_USER", shouldSwitchUser ? "1" : "0");
+  environment["MESOS_FRAMEWORK_ID"] = frameworkId.value();
+  environment["MESOS_SLAVE_ID"] = slaveId.value();
+  environment["MESOS_COMMAND"] = commandInfo.value();
+  environment["MESOS_EXECUTOR_URIS"] = uris;
+  environment["MESOS_USER"] = user;
+  environment["MESOS_WORK_DIRECTORY"] = workDirectory;
+  environment["MESOS_SLAVE_DIRECTORY"] = slaveDirectory;
+  environment["MESOS_SLAVE_PID"] = slavePid;
+  environment["MESOS_HADOOP_HOME"] = hadoopHome;
+  environment["MESOS_FETCH_CACHE_DIRECTORY"] = fetchCacheDirectory;
+  environment["MESOS_FETCH_CACHE_SIZE"] = stringify(fetchCacheSize.bytes());
+  environment["MESOS_FETCH_RATE_LIMIT"] = stringify(fetchRateLimit.bytes());
+  environment["MESOS_REDIRECT_IO"] = redirectIO ? "1" : "0";
+  environment["MESOS_SWITCH_USER"] = shouldSwitchUser ? "1" : "0";
+
+  return environment;
+}
+
+
+void ExecutorLauncher::setupEnvironmentForLauncherMain()
+{
+  foreachpair (const string& key,
+               const string& value,
+               environmentForLauncherMain()) {
+    os::setenv(key, value);
+  }
 }
 
 } // namespace launcher {
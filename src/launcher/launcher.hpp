@@ -19,10 +19,13 @@
 #ifndef __LAUNCHER_HPP__
 #define __LAUNCHER_HPP__
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include <mesos/mesos.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/uuid.hpp>
 
 #include "slave/flags.hpp"
@@ -31,6 +34,13 @@ namespace mesos {
 namespace internal {
 namespace launcher {
 
+// Returns the argument vector for executing 'command' via the shell,
+// i.e., {"sh", "-c", command, NULL}, suitable for handing to execv or
+// posix_spawn. The vector references the storage of 'command', which
+// must therefore outlive any use of the result.
+std::vector<char*> shellArguments(const std::string& command);
+
+
 // This class sets up the environment for an executor and then exec()'s it.
 // It can either be used after a fork() in the slave process, or run as a
 // standalone program (with the main function in launcher_main.cpp).
@@ -57,6 +67,9 @@ public:
       const std::string& slavePid,
       const std::string& frameworksHome,
       const std::string& hadoopHome,
+      const std::string& fetchCacheDirectory,
+      const Bytes& fetchCacheSize,
+      const Bytes& fetchRateLimit,
       bool redirectIO,
       bool shouldSwitchUser,
       bool checkpoint);
@@ -77,12 +90,54 @@ public:
   // cannot exec the user's executor directly.
   virtual void setupEnvironmentForLauncherMain();
 
+  // Returns the environment variables that
+  // setupEnvironmentForLauncherMain() would set, so that a launch
+  // can be shipped to another process (e.g., a LauncherPool helper)
+  // without mutating this one.
+  virtual std::map<std::string, std::string> environmentForLauncherMain();
+
 protected:
   // Download the required files for the executor from the given set of URIs.
   // Optionally, it will set the executable file permissions for the files.
-  // This method is expected to place files in the workDirectory.
+  // This method is expected to place files in the workDirectory. The
+  // URIs are fetched concurrently (see fetchExecutor below) and the
+  // durations are reported back to the slave through a file in the
+  // work directory (see slave::paths::getFetchReportPath).
   virtual int fetchExecutors();
 
+  // Fetches a single URI: downloads it (directly or through the
+  // cache, capping the transfer rate at 'limit' bytes per second
+  // unless it is zero), chowns and chmods the result as requested
+  // and extracts it if it is an archive. Runs in a child process
+  // forked by fetchExecutors(), so that fetches proceed in parallel
+  // and extraction overlaps with the remaining downloads.
+  int fetchExecutor(const CommandInfo::URI& uri, const Bytes& limit);
+
+  // Downloads (or copies) 'resource' into 'directory', returning the
+  // path of the local file or the empty string on failure.
+  std::string fetch(
+      const std::string& resource,
+      const std::string& directory,
+      const Bytes& limit);
+
+  // Fetches 'resource' through the fetch cache, downloading it only
+  // if it is not already cached, and hard-links (or copies, when
+  // switching user) it into the current working directory. Returns
+  // the path of the file in the working directory or the empty string
+  // on failure. Also evicts the least recently used cache entries
+  // once the cache exceeds 'fetchCacheSize'.
+  std::string fetchThroughCache(
+      const std::string& resource,
+      const Bytes& limit);
+
+  // Evicts least recently used cache entries (that are not locked by
+  // a concurrent fetch) until the cache fits in 'fetchCacheSize'.
+  void evictCache();
+
+  // Returns the environment variables for launching a framework's
+  // executor.
+  virtual std::map<std::string, std::string> environment();
+
   // Set up environment variables for launching a framework's executor.
   virtual void setupEnvironment();
 
@@ -101,6 +156,9 @@ protected:
   const std::string slavePid;
   const std::string frameworksHome;
   const std::string hadoopHome;
+  const std::string fetchCacheDirectory; // Empty: caching disabled.
+  const Bytes fetchCacheSize;
+  const Bytes fetchRateLimit; // 0: unlimited.
   const bool redirectIO;   // Whether to redirect stdout and stderr to files.
   const bool shouldSwitchUser; // Whether to setuid to framework's user.
   const bool checkpoint; // Whether the framework enabled checkpointing.
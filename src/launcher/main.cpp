@@ -18,6 +18,8 @@
 
 #include <mesos/mesos.hpp>
 
+#include <stout/bytes.hpp>
+#include <stout/numify.hpp>
 #include <stout/strings.hpp>
 #include <stout/os.hpp>
 
@@ -57,6 +59,24 @@ int main(int argc, char** argv)
     commandInfo.add_uris()->MergeFrom(uri);
   }
 
+  // The fetch cache size is shipped as a plain number of bytes.
+  Bytes fetchCacheSize = 0;
+  const std::string& size = os::getenv("MESOS_FETCH_CACHE_SIZE", false);
+  if (!size.empty()) {
+    Try<uint64_t> bytes = numify<uint64_t>(size);
+    CHECK(!bytes.isError()) << "Invalid fetch cache size in env " << size;
+    fetchCacheSize = Bytes(bytes.get());
+  }
+
+  // Likewise for the fetch rate limit (bytes per second).
+  Bytes fetchRateLimit = 0;
+  const std::string& rate = os::getenv("MESOS_FETCH_RATE_LIMIT", false);
+  if (!rate.empty()) {
+    Try<uint64_t> bytes = numify<uint64_t>(rate);
+    CHECK(!bytes.isError()) << "Invalid fetch rate limit in env " << rate;
+    fetchRateLimit = Bytes(bytes.get());
+  }
+
   return mesos::internal::launcher::ExecutorLauncher(
       slaveId,
       frameworkId,
@@ -69,6 +89,9 @@ int main(int argc, char** argv)
       os::getenv("MESOS_SLAVE_PID"),
       os::getenv("MESOS_FRAMEWORKS_HOME", false),
       os::getenv("MESOS_HADOOP_HOME"),
+      os::getenv("MESOS_FETCH_CACHE_DIRECTORY", false),
+      fetchCacheSize,
+      fetchRateLimit,
       os::getenv("MESOS_REDIRECT_IO") == "1",
       os::getenv("MESOS_SWITCH_USER") == "1",
       os::getenv("MESOS_CHECKPOINT") == "1")
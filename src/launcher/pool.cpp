@@ -0,0 +1,553 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <glog/logging.h>
+
+#include <utility>
+
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/io.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
+#include <stout/os.hpp>
+#include <stout/stringify.hpp>
+
+#include "logging/check_some.hpp"
+
+#include "launcher/pool.hpp"
+
+using namespace process;
+
+using std::list;
+using std::map;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace launcher {
+
+namespace {
+
+// Tags for messages sent from a helper to the slave. Each message is
+// written with a single write(2) by the helper (and only the helper
+// writes on the socket), so the stream never interleaves messages.
+enum MessageTag
+{
+  LAUNCHED = 1, // An executor was forked; 'pid' is its session leader.
+  FAILED = 2,   // A launch failed; 'status' holds the helper's errno.
+  EXITED = 3    // An executor exited; 'pid' and its exit 'status'.
+};
+
+
+struct Message
+{
+  int32_t tag; // One of MessageTag.
+  pid_t pid;
+  int32_t status;
+};
+
+
+// Reads exactly 'size' bytes, looping over short reads. Returns
+// false on end-of-file or error.
+bool receiveAll(int fd, void* data, size_t size)
+{
+  char* p = (char*) data;
+  while (size > 0) {
+    ssize_t length = ::read(fd, p, size);
+    if (length == 0) {
+      return false;
+    } else if (length == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += length;
+    size -= length;
+  }
+  return true;
+}
+
+
+// Writes exactly 'size' bytes, looping over short writes. Retries
+// EAGAIN since the slave's end is non-blocking; messages are tiny
+// and the peer is always draining, so this does not spin in
+// practice. Returns false on error.
+bool sendAll(int fd, const void* data, size_t size)
+{
+  const char* p = (const char*) data;
+  while (size > 0) {
+    ssize_t length = ::write(fd, p, size);
+    if (length == -1) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+        continue;
+      }
+      return false;
+    }
+    p += length;
+    size -= length;
+  }
+  return true;
+}
+
+
+// Self-pipe that routes SIGCHLD into a helper's poll loop (the
+// handler installed by the slave's reaper writes to the slave's
+// pipe, so each helper installs its own after the fork).
+int pipes[2] = { -1, -1 };
+
+
+void handler(int signal)
+{
+  int saved = errno;
+  char byte = 0;
+  while (::write(pipes[1], &byte, sizeof(byte)) == -1 && errno == EINTR);
+  errno = saved;
+}
+
+
+// Main loop of a helper process; never returns. NOTE: We are a
+// fork(2)ed copy of the slave, so DO NOT USE GLOG (or anything else
+// that is not fork safe)!
+void helper(int socket, const string& path)
+{
+  if (pipe(pipes) == -1) {
+    perror("Failed to create the helper's SIGCHLD self-pipe");
+    _exit(1);
+  }
+
+  if (fcntl(pipes[0], F_SETFL, O_NONBLOCK) == -1 ||
+      fcntl(pipes[1], F_SETFL, O_NONBLOCK) == -1) {
+    perror("Failed to set the helper's SIGCHLD self-pipe non-blocking");
+    _exit(1);
+  }
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+
+  if (sigaction(SIGCHLD, &action, NULL) == -1) {
+    perror("Failed to install the helper's SIGCHLD handler");
+    _exit(1);
+  }
+
+  while (true) {
+    struct pollfd fds[2];
+    fds[0].fd = socket;
+    fds[0].events = POLLIN;
+    fds[1].fd = pipes[0];
+    fds[1].events = POLLIN;
+
+    if (::poll(fds, 2, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("Failed to poll in the launcher helper");
+      _exit(1);
+    }
+
+    // Reap any exited executors and report them to the slave.
+    char bytes[32];
+    while (::read(pipes[0], bytes, sizeof(bytes)) > 0);
+
+    pid_t pid;
+    int status;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      if (!WIFSTOPPED(status)) {
+        Message message;
+        message.tag = EXITED;
+        message.pid = pid;
+        message.status = status;
+        sendAll(socket, &message, sizeof(message));
+      }
+    }
+
+    if (!(fds[0].revents & (POLLIN | POLLHUP))) {
+      continue;
+    }
+
+    // Receive a launch descriptor: a count followed by length
+    // prefixed key/value pairs. End-of-file means the slave has
+    // terminated (or is discarding the pool), so we do too.
+    uint32_t count;
+    if (!receiveAll(socket, &count, sizeof(count))) {
+      _exit(0);
+    }
+
+    vector<std::pair<string, string> > environment;
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t length;
+      string key, value;
+
+      if (!receiveAll(socket, &length, sizeof(length))) _exit(0);
+      key.resize(length);
+      if (length > 0 && !receiveAll(socket, &key[0], length)) _exit(0);
+
+      if (!receiveAll(socket, &length, sizeof(length))) _exit(0);
+      value.resize(length);
+      if (length > 0 && !receiveAll(socket, &value[0], length)) _exit(0);
+
+      environment.push_back(std::make_pair(key, value));
+    }
+
+    // Use a pipe to learn the pid of the executor after it has
+    // (possibly repeatedly, see below) changed session.
+    int p[2];
+    if (pipe(p) == -1) {
+      Message message;
+      message.tag = FAILED;
+      message.pid = -1;
+      message.status = errno;
+      sendAll(socket, &message, sizeof(message));
+      continue;
+    }
+
+    if ((pid = fork()) == -1) {
+      Message message;
+      message.tag = FAILED;
+      message.pid = -1;
+      message.status = errno;
+      sendAll(socket, &message, sizeof(message));
+      ::close(p[0]);
+      ::close(p[1]);
+      continue;
+    }
+
+    if (pid == 0) {
+      // In the executor child: put ourselves in our own session for
+      // easier cleanup, mirroring the direct fork path in the
+      // process isolator.
+      ::close(socket);
+      ::close(p[0]);
+      ::close(pipes[0]);
+      ::close(pipes[1]);
+
+      // NOTE: We setsid() in a loop because setsid() might fail if
+      // another process has the same process group id as us.
+      while ((pid = setsid()) == -1) {
+        perror("Could not put executor in its own session");
+
+        if ((pid = fork()) == -1) {
+          perror("Failed to fork to launch executor");
+          abort();
+        }
+
+        if (pid > 0) {
+          // In the (intermediate) parent; it is ok to suicide here
+          // since the isolator ignores unknown processes.
+          _exit(0);
+        }
+      }
+
+      if (write(p[1], &pid, sizeof(pid)) != sizeof(pid)) {
+        perror("Failed to write PID on pipe");
+        abort();
+      }
+
+      ::close(p[1]);
+
+      typedef std::pair<string, string> Variable;
+      foreach (const Variable& entry, environment) {
+        setenv(entry.first.c_str(), entry.second.c_str(), 1);
+      }
+
+      const char* args[2];
+      args[0] = path.c_str();
+      args[1] = NULL;
+
+      execvp(args[0], (char* const*) args);
+
+      perror("Failed to execvp the mesos-launcher");
+      abort();
+    }
+
+    // Back in the helper: relay the executor's pid to the slave.
+    ::close(p[1]);
+
+    Message message;
+    if (receiveAll(p[0], &message.pid, sizeof(message.pid))) {
+      message.tag = LAUNCHED;
+      message.status = 0;
+    } else {
+      message.tag = FAILED;
+      message.pid = -1;
+      message.status = ECHILD;
+    }
+
+    ::close(p[0]);
+
+    sendAll(socket, &message, sizeof(message));
+  }
+}
+
+} // namespace {
+
+
+LauncherPoolProcess::LauncherPoolProcess(size_t _size, const string& _path)
+  : ProcessBase(ID::generate("launcher-pool")),
+    size(_size),
+    path(_path),
+    next(0) {}
+
+
+LauncherPoolProcess::~LauncherPoolProcess()
+{
+  foreach (Helper* helper, helpers) {
+    foreach (Promise<pid_t>* promise, helper->promises) {
+      promise->fail("The launcher pool is being destroyed");
+      delete promise;
+    }
+    delete helper;
+  }
+}
+
+
+void LauncherPoolProcess::initialize()
+{
+  for (size_t i = 0; i < size; i++) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == -1) {
+      PLOG(FATAL) << "Failed to create a launcher helper socket pair";
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+      PLOG(FATAL) << "Failed to fork a launcher helper";
+    }
+
+    if (pid == 0) {
+      // In the helper process. DO NOT USE GLOG!
+      ::close(sockets[0]);
+      helper(sockets[1], path); // Never returns.
+      abort();
+    }
+
+    ::close(sockets[1]);
+
+    CHECK_SOME(os::nonblock(sockets[0]));
+    CHECK_SOME(os::cloexec(sockets[0]));
+
+    LOG(INFO) << "Forked launcher helper at " << pid;
+
+    Helper* helper = new Helper();
+    helper->pid = pid;
+    helper->socket = sockets[0];
+    helpers.push_back(helper);
+
+    io::poll(helper->socket, io::READ)
+      .onAny(defer(self(), &Self::ready, i, lambda::_1));
+  }
+}
+
+
+void LauncherPoolProcess::finalize()
+{
+  // Closing the sockets makes the helpers exit on end-of-file.
+  foreach (Helper* helper, helpers) {
+    if (helper->socket != -1) {
+      abandon(helper, "The launcher pool is terminating");
+    }
+  }
+}
+
+
+void LauncherPoolProcess::addListener(
+    const PID<slave::ProcessExitedListener>& listener)
+{
+  listeners.push_back(listener);
+}
+
+
+Future<pid_t> LauncherPoolProcess::launch(
+    const map<string, string>& environment)
+{
+  // Round-robin over the live helpers.
+  for (size_t attempt = 0; attempt < helpers.size(); attempt++) {
+    Helper* helper = helpers[next++ % helpers.size()];
+
+    if (helper->socket == -1) {
+      continue; // The helper died.
+    }
+
+    // Serialize the launch descriptor.
+    string data;
+    uint32_t count = environment.size();
+    data.append((const char*) &count, sizeof(count));
+
+    foreachpair (const string& key, const string& value, environment) {
+      uint32_t length = key.size();
+      data.append((const char*) &length, sizeof(length));
+      data.append(key);
+      length = value.size();
+      data.append((const char*) &length, sizeof(length));
+      data.append(value);
+    }
+
+    if (!sendAll(helper->socket, data.data(), data.size())) {
+      abandon(helper, "Failed to send a launch to launcher helper " +
+              stringify(helper->pid) + ": " + string(strerror(errno)));
+      continue;
+    }
+
+    Promise<pid_t>* promise = new Promise<pid_t>();
+    helper->promises.push_back(promise);
+    return promise->future();
+  }
+
+  return Future<pid_t>::failed("No live launcher helpers");
+}
+
+
+void LauncherPoolProcess::ready(size_t index, const Future<short>& poll)
+{
+  Helper* helper = helpers[index];
+
+  if (helper->socket == -1) {
+    return; // Already abandoned.
+  }
+
+  if (!poll.isReady()) {
+    if (poll.isFailed()) {
+      abandon(helper, "Failed to poll launcher helper " +
+              stringify(helper->pid) + ": " + poll.failure());
+    }
+    return; // Discarded during termination.
+  }
+
+  char data[512];
+  while (true) {
+    ssize_t length = ::read(helper->socket, data, sizeof(data));
+    if (length == -1 && errno == EINTR) {
+      continue;
+    } else if (length == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else if (length <= 0) {
+      abandon(helper, "Launcher helper " + stringify(helper->pid) +
+              (length == 0 ? " exited" : " failed: " + string(strerror(errno))));
+      return;
+    }
+    helper->buffer.append(data, length);
+  }
+
+  // Handle all completely received messages.
+  while (helper->buffer.size() >= sizeof(Message)) {
+    Message message;
+    memcpy(&message, helper->buffer.data(), sizeof(message));
+    helper->buffer.erase(0, sizeof(message));
+
+    if (message.tag == LAUNCHED || message.tag == FAILED) {
+      CHECK(!helper->promises.empty())
+        << "Launcher helper acknowledged a launch we never sent";
+
+      Promise<pid_t>* promise = helper->promises.front();
+      helper->promises.pop_front();
+
+      if (message.tag == LAUNCHED) {
+        promise->set(message.pid);
+      } else {
+        promise->fail("Launcher helper failed to fork an executor: " +
+                      string(strerror(message.status)));
+      }
+      delete promise;
+    } else if (message.tag == EXITED) {
+      notify(message.pid, message.status);
+    } else {
+      LOG(ERROR) << "Ignoring unknown message (tag " << message.tag
+                 << ") from launcher helper " << helper->pid;
+    }
+  }
+
+  io::poll(helper->socket, io::READ)
+    .onAny(defer(self(), &Self::ready, index, lambda::_1));
+}
+
+
+void LauncherPoolProcess::abandon(Helper* helper, const string& reason)
+{
+  LOG(ERROR) << reason;
+
+  ::close(helper->socket);
+  helper->socket = -1;
+
+  foreach (Promise<pid_t>* promise, helper->promises) {
+    promise->fail(reason);
+    delete promise;
+  }
+  helper->promises.clear();
+}
+
+
+void LauncherPoolProcess::notify(pid_t pid, int status)
+{
+  foreach (const PID<slave::ProcessExitedListener>& listener, listeners) {
+    dispatch(
+        listener, &slave::ProcessExitedListener::processExited, pid, status);
+  }
+}
+
+
+LauncherPool::LauncherPool(size_t size, const string& path)
+{
+  process = new LauncherPoolProcess(size, path);
+  spawn(process);
+}
+
+
+LauncherPool::~LauncherPool()
+{
+  terminate(process);
+  process::wait(process);
+  delete process;
+}
+
+
+void LauncherPool::addListener(
+    const PID<slave::ProcessExitedListener>& listener)
+{
+  dispatch(process, &LauncherPoolProcess::addListener, listener);
+}
+
+
+Future<pid_t> LauncherPool::launch(const map<string, string>& environment)
+{
+  return dispatch(process, &LauncherPoolProcess::launch, environment);
+}
+
+} // namespace launcher {
+} // namespace internal {
+} // namespace mesos {
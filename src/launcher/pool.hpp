@@ -0,0 +1,126 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LAUNCHER_POOL_HPP__
+#define __LAUNCHER_POOL_HPP__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <process/future.hpp>
+#include <process/pid.hpp>
+#include <process/process.hpp>
+
+#include "slave/reaper.hpp"
+
+namespace mesos {
+namespace internal {
+namespace launcher {
+
+// Forward declaration.
+class LauncherPoolProcess;
+
+
+// A pool of helper processes forked at slave startup, while the
+// slave's address space is still small, that launch executors on its
+// behalf. Each launch is handed to a helper as a set of environment
+// variables over a socket; the helper forks a cheap child that
+// creates its own session, applies the environment and execs the
+// mesos-launcher binary. This avoids fork(2)ing the (potentially
+// multi-gigabyte) slave process for every executor and lets launch
+// bursts proceed in parallel across helpers. Since the helpers are
+// the parents of the executors they also report executor exits, with
+// the real exit status, back over their sockets.
+class LauncherPool
+{
+public:
+  // Forks 'size' helpers ready to exec the launcher binary at 'path'.
+  LauncherPool(size_t size, const std::string& path);
+  ~LauncherPool();
+
+  // Notify the listener when a launched executor terminates.
+  void addListener(const process::PID<slave::ProcessExitedListener>& listener);
+
+  // Launches an executor with the given environment (as produced by
+  // ExecutorLauncher::environmentForLauncherMain()) through one of
+  // the helpers, returning the pid of the executor's session leader
+  // (suitable for process group kills) once it has been forked.
+  process::Future<pid_t> launch(
+      const std::map<std::string, std::string>& environment);
+
+private:
+  LauncherPoolProcess* process;
+};
+
+
+class LauncherPoolProcess
+  : public process::Process<LauncherPoolProcess>
+{
+public:
+  LauncherPoolProcess(size_t _size, const std::string& _path);
+
+  virtual ~LauncherPoolProcess();
+
+  void addListener(const process::PID<slave::ProcessExitedListener>& listener);
+
+  process::Future<pid_t> launch(
+      const std::map<std::string, std::string>& environment);
+
+protected:
+  virtual void initialize();
+  virtual void finalize();
+
+private:
+  // State for a single helper process.
+  struct Helper
+  {
+    pid_t pid;          // Pid of the helper itself.
+    int socket;         // Stream socket shared with the helper (-1: dead).
+    std::string buffer; // Partially received messages from the helper.
+
+    // Launches written to the helper but not yet acknowledged,
+    // completed in FIFO order since the helper forks sequentially.
+    std::list<process::Promise<pid_t>*> promises;
+  };
+
+  // Invoked when a helper's socket becomes readable.
+  void ready(size_t index, const process::Future<short>& poll);
+
+  // Marks the helper dead and fails its outstanding launches.
+  void abandon(Helper* helper, const std::string& reason);
+
+  void notify(pid_t pid, int status);
+
+  const size_t size;
+  const std::string path;
+
+  std::vector<Helper*> helpers;
+  size_t next; // Index of the next helper to use (round-robin).
+
+  std::list<process::PID<slave::ProcessExitedListener> > listeners;
+};
+
+} // namespace launcher {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __LAUNCHER_POOL_HPP__
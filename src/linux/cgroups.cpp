@@ -17,8 +17,11 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <fts.h>
 #include <signal.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <sys/syscall.h>
@@ -411,8 +414,9 @@ bool enabled()
 
 Try<set<string> > hierarchies()
 {
-  // Read currently mounted file systems from /proc/mounts.
-  Try<fs::MountTable> table = fs::MountTable::read("/proc/mounts");
+  // Read currently mounted file systems from /proc/mounts (cached,
+  // invalidated on mount table changes).
+  Try<fs::MountTable> table = fs::MountTable::cached();
   if (table.isError()) {
     return Error(table.error());
   }
@@ -473,7 +477,11 @@ Try<bool> enabled(const string& subsystems)
   map<string, internal::SubsystemInfo> infos = infosResult.get();
   bool disabled = false;  // Whether some subsystems are not enabled.
 
-  foreach (const string& subsystem, strings::tokenize(subsystems, ",")) {
+  strings::Tokenizer tokenizer(subsystems, ",");
+  const char* data;
+  size_t length;
+  while (tokenizer.next(&data, &length)) {
+    const string subsystem(data, length);
     if (infos.find(subsystem) == infos.end()) {
       return Error("'" + subsystem + "' not found");
     }
@@ -499,7 +507,11 @@ Try<bool> busy(const string& subsystems)
   map<string, internal::SubsystemInfo> infos = infosResult.get();
   bool busy = false;
 
-  foreach (const string& subsystem, strings::tokenize(subsystems, ",")) {
+  strings::Tokenizer tokenizer(subsystems, ",");
+  const char* data;
+  size_t length;
+  while (tokenizer.next(&data, &length)) {
+    const string subsystem(data, length);
     if (infos.find(subsystem) == infos.end()) {
       return Error("'" + subsystem + "' not found");
     }
@@ -542,8 +554,9 @@ Try<set<string> > subsystems(const string& hierarchy)
         "': " + hierarchyAbsPath.error());
   }
 
-  // Read currently mounted file systems from /proc/mounts.
-  Try<fs::MountTable> table = fs::MountTable::read("/proc/mounts");
+  // Read currently mounted file systems from /proc/mounts (cached,
+  // invalidated on mount table changes).
+  Try<fs::MountTable> table = fs::MountTable::cached();
   if (table.isError()) {
     return Error("Failed to read mount table: " + table.error());
   }
@@ -598,7 +611,11 @@ Try<Nothing> mount(const string& hierarchy, const string& subsystems)
   }
 
   // Make sure all subsystems are enabled and not busy.
-  foreach (const string& subsystem, strings::tokenize(subsystems, ",")) {
+  strings::Tokenizer tokenizer(subsystems, ",");
+  const char* data;
+  size_t length;
+  while (tokenizer.next(&data, &length)) {
+    const string subsystem(data, length);
     Try<bool> result = enabled(subsystem);
     if (result.isError()) {
       return Error(result.error());
@@ -688,7 +705,11 @@ Try<bool> mounted(const string& hierarchy, const string& subsystems)
         hierarchy + "': " + attached.error());
   }
 
-  foreach (const string& subsystem, strings::tokenize(subsystems, ",")) {
+  strings::Tokenizer tokenizer(subsystems, ",");
+  const char* data;
+  size_t length;
+  while (tokenizer.next(&data, &length)) {
+    const string subsystem(data, length);
     if (attached.get().count(subsystem) == 0) {
       return false;
     }
@@ -1144,7 +1165,8 @@ public:
       cgroup(_cgroup),
       action(_action),
       interval(_interval),
-      retries(_retries) {}
+      retries(_retries),
+      backoff(Milliseconds(1)) {}
 
   virtual ~Freezer() {}
 
@@ -1276,8 +1298,13 @@ private:
         return;
       }
 
-      // Not done yet, keep watching (and possibly retrying).
-      delay(interval, self(), &Freezer::watchFrozen, attempt + 1);
+      // Not done yet, keep watching (and possibly retrying). The
+      // freezer offers no notification mechanism so we poll, but
+      // with an exponential backoff (capped at 'interval') so that
+      // freezes finishing in a few milliseconds are observed in a
+      // few milliseconds rather than after a full interval.
+      delay(backoff, self(), &Freezer::watchFrozen, attempt + 1);
+      backoff = std::min(backoff + backoff, interval);
     } else {
       LOG(FATAL) << "Unexpected state: " << strings::trim(state.get())
                  << " of cgroup " << path::join(hierarchy, cgroup);
@@ -1299,8 +1326,9 @@ private:
       promise.set(true);
       terminate(self());
     } else if (strings::trim(state.get()) == "FROZEN") {
-      // Not done yet, keep watching.
-      delay(interval, self(), &Freezer::watchThawed);
+      // Not done yet, keep watching (with backoff, as above).
+      delay(backoff, self(), &Freezer::watchThawed);
+      backoff = std::min(backoff + backoff, interval);
     } else {
       LOG(FATAL) << "Unexpected state: " << strings::trim(state.get())
                  << " of cgroup " << path::join(hierarchy, cgroup);
@@ -1312,6 +1340,7 @@ private:
   const string action;
   const Duration interval;
   const unsigned int retries;
+  Duration backoff; // Delay until the next state check, capped at interval.
   Promise<bool> promise;
 };
 
@@ -1351,6 +1380,23 @@ Future<bool> freeze(
 }
 
 
+Future<list<bool> > freeze(
+    const string& hierarchy,
+    const vector<string>& cgroups,
+    const Duration& interval,
+    const unsigned int retries)
+{
+  // Kick off every freeze before waiting on any of them so that the
+  // freeze waits all overlap.
+  list<Future<bool> > futures;
+  foreach (const string& cgroup, cgroups) {
+    futures.push_back(freeze(hierarchy, cgroup, interval, retries));
+  }
+
+  return collect(futures);
+}
+
+
 Future<bool> thaw(
     const string& hierarchy,
     const string& cgroup,
@@ -1749,8 +1795,17 @@ Try<hashmap<string, uint64_t> > stat(
 
   hashmap<string, uint64_t> result;
 
-  foreach (const string& line, strings::split(contents.get(), "\n")) {
-    // Skip empty lines.
+  // Walk the file line by line without building a token vector.
+  // NOTE: Try::get() returns by value, so the tokenizer (which keeps
+  // a reference to the string) must not be handed the temporary.
+  const string stats = contents.get();
+  strings::Tokenizer tokenizer(stats, "\n");
+  const char* data;
+  size_t length;
+  while (tokenizer.next(&data, &length)) {
+    const string line(data, length);
+
+    // Skip (whitespace only) lines.
     if (strings::trim(line).empty()) {
       continue;
     }
@@ -1772,4 +1827,156 @@ Try<hashmap<string, uint64_t> > stat(
   return result;
 }
 
+
+namespace {
+
+// Parses the "<name> <value>" lines in [data, data + length), which
+// must be NUL terminated at 'length'. A line holding a bare value
+// (i.e., a single valued control like "memory.usage_in_bytes") is
+// keyed under the control file name. NOTE: This runs on every
+// monitoring pass, hence the allocation free error type.
+Try<Nothing, ErrorCode> parse(
+    const string& control,
+    const char* data,
+    size_t length,
+    hashmap<string, uint64_t>* result)
+{
+  const char* p = data;
+  const char* end = data + length;
+
+  while (p < end) {
+    const char* eol = (const char*) memchr(p, '\n', end - p);
+    if (eol == NULL) {
+      eol = end;
+    }
+
+    if (eol > p) {
+      const char* space = (const char*) memchr(p, ' ', eol - p);
+
+      char* next = NULL;
+      uint64_t value = strtoull(space == NULL ? p : space + 1, &next, 10);
+
+      if (next == NULL || next != eol) {
+        return ErrorCode(EINVAL, "Unexpected line format in control file");
+      }
+
+      if (space == NULL) {
+        (*result)[control] = value;
+      } else {
+        (*result)[string(p, space - p)] = value;
+      }
+    }
+
+    p = eol + 1;
+  }
+
+  return Nothing();
+}
+
+} // namespace {
+
+
+StatReader::StatReader(
+    const string& _hierarchy,
+    const vector<string>& _controls)
+  : hierarchy(_hierarchy), controls(_controls) {}
+
+
+StatReader::~StatReader()
+{
+  foreachvalue (const vector<int>& opened, fds) {
+    foreach (int fd, opened) {
+      ::close(fd);
+    }
+  }
+}
+
+
+Try<hashmap<string, hashmap<string, uint64_t> >, ErrorCode> StatReader::read(
+    const string& cgroup)
+{
+  if (!fds.contains(cgroup)) {
+    vector<int> opened;
+
+    foreach (const string& control, controls) {
+      const string path = path::join(hierarchy, cgroup, control);
+
+      int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd == -1) {
+        ErrorCode error(errno, "Failed to open control file");
+        foreach (int fd, opened) {
+          ::close(fd);
+        }
+        return error;
+      }
+
+      opened.push_back(fd);
+    }
+
+    fds[cgroup] = opened;
+  }
+
+  const vector<int>& opened = fds[cgroup];
+
+  CHECK(opened.size() == controls.size());
+
+  hashmap<string, hashmap<string, uint64_t> > result;
+
+  for (size_t i = 0; i < controls.size(); i++) {
+    hashmap<string, uint64_t>& stats = result[controls[i]];
+
+    // Control files regenerate their contents on each read, and the
+    // kernel honors the pread(2) offset, so rewinding to 0 yields
+    // fresh values without reopening the file.
+    off_t offset = 0;
+
+    while (true) {
+      ssize_t length = ::pread(opened[i], buffer, sizeof(buffer) - 1, offset);
+
+      if (length == -1) {
+        return ErrorCode(errno, "Failed to read control file");
+      } else if (length == 0) {
+        break;
+      }
+
+      buffer[length] = '\0';
+
+      // Only parse whole lines: anything after the last newline got
+      // truncated by the buffer and is reread at the next offset.
+      // Stat files end in a newline, so a partial tail only occurs
+      // when the buffer filled up.
+      const char* tail = strrchr(buffer, '\n');
+      if (tail == NULL) {
+        return ErrorCode(EINVAL, "Line in control file exceeds buffer");
+      }
+
+      Try<Nothing, ErrorCode> parsed =
+        parse(controls[i], buffer, (tail - buffer) + 1, &stats);
+
+      if (parsed.isError()) {
+        return parsed.error();
+      }
+
+      if (length < (ssize_t) (sizeof(buffer) - 1)) {
+        break;
+      }
+
+      offset += (tail - buffer) + 1;
+    }
+  }
+
+  return result;
+}
+
+
+void StatReader::forget(const string& cgroup)
+{
+  if (fds.contains(cgroup)) {
+    foreach (int fd, fds[cgroup]) {
+      ::close(fd);
+    }
+    fds.erase(cgroup);
+  }
+}
+
 } // namespace cgroups {
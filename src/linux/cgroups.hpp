@@ -21,6 +21,7 @@
 
 #include <stdint.h>
 
+#include <list>
 #include <set>
 #include <string>
 #include <vector>
@@ -30,6 +31,7 @@
 #include <process/future.hpp>
 
 #include <stout/duration.hpp>
+#include <stout/error.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
@@ -299,8 +301,10 @@ process::Future<uint64_t> listen(
 // the given cgroup is not valid, or the given cgroup has already been frozen.
 // @param   hierarchy   Path to the hierarchy root.
 // @param   cgroup      Path to the cgroup relative to the hierarchy root.
-// @param   interval    The time interval between two state check
-//                      requests (default: 0.1 seconds).
+// @param   interval    The maximum time interval between two state
+//                      check requests; checks back off exponentially
+//                      from a millisecond up to this so that fast
+//                      freezes complete fast (default: 0.1 seconds).
 // @param   retries     Number of retry attempts before giving up. None
 //                      indicates infinite retries. (default: 50 attempts).
 // @return  A future which will become true when all processes are frozen, or
@@ -313,14 +317,35 @@ process::Future<bool> freeze(
     const unsigned int retries = FREEZE_RETRIES);
 
 
+// Freeze several cgroups under the same hierarchy at once, overlapping
+// all of the freeze waits rather than serializing them (e.g., when
+// tearing down every executor at slave shutdown). Each cgroup gets its
+// own freezer so a slow freeze does not hold up the others; the result
+// becomes ready once every cgroup has been frozen (in the order given)
+// and fails if any individual freeze fails.
+// @param   hierarchy   Path to the hierarchy root.
+// @param   cgroups     Paths to the cgroups relative to the hierarchy root.
+// @param   interval    The maximum time interval between two state
+//                      check requests (default: 0.1 seconds).
+// @param   retries     Number of retry attempts before giving up
+//                      (default: 50 attempts).
+// @return  A future of per-cgroup results, as with the single cgroup
+//          variant above.
+process::Future<std::list<bool> > freeze(
+    const std::string& hierarchy,
+    const std::vector<std::string>& cgroups,
+    const Duration& interval = Seconds(0.1),
+    const unsigned int retries = FREEZE_RETRIES);
+
+
 // Thaw the given cgroup. This is a revert operation of freezeCgroup. It will
 // return error if the given cgroup is already thawed. Same as
 // freezeCgroup, this function will return a future which can be discarded to
 // allow users to cancel the operation.
 // @param   hierarchy   Path to the hierarchy root.
 // @param   cgroup      Path to the cgroup relative to the hierarchy root.
-// @param   interval    The time interval between two state check
-//                      requests (default: 0.1 seconds).
+// @param   interval    The maximum time interval between two state
+//                      check requests (default: 0.1 seconds).
 // @return  A future which will become ready when all processes are thawed.
 //          Error if something unexpected happens.
 process::Future<bool> thaw(
@@ -373,6 +398,64 @@ Try<hashmap<std::string, uint64_t> > stat(
     const std::string& cgroup,
     const std::string& file);
 
+
+// Reads a fixed set of stat control files (e.g., "cpuacct.stat",
+// "memory.stat") for many cgroups on a monitoring interval. Unlike
+// cgroups::stat, which does an open/read/close per call, this caches
+// an open file descriptor per (cgroup, control) pair and each read()
+// preads all the watched controls of a cgroup with the descriptors
+// rewound to offset 0, which the kernel answers with fresh contents.
+// Parsing reuses an internal buffer and avoids string streams, so a
+// monitoring pass costs one pread(2) per control file and no churn.
+// NOTE: This class is not internally synchronized; keep an instance
+// inside a single process or synchronize access externally.
+class StatReader
+{
+public:
+  // @param   hierarchy   Path to the hierarchy root.
+  // @param   controls    Names of the control files to read.
+  StatReader(
+      const std::string& hierarchy,
+      const std::vector<std::string>& controls);
+
+  // Closes all cached file descriptors.
+  ~StatReader();
+
+  // Reads all watched controls of the given cgroup, returning a map
+  // from control file name to its parsed "<name> <value>" entries.
+  // Single valued controls (e.g., "memory.usage_in_bytes") appear
+  // under the control file name itself. Returns an error if any of
+  // the controls cannot be opened, read, or parsed. Errors here are
+  // expected on every monitoring pass (e.g., a cgroup destroyed
+  // since the last pass yields ENOENT until forget() is called), so
+  // they are returned as an allocation free ErrorCode; a message is
+  // only formatted if the caller asks for one.
+  // @param   cgroup      Path to the cgroup relative to the hierarchy root.
+  Try<hashmap<std::string, hashmap<std::string, uint64_t> >, ErrorCode> read(
+      const std::string& cgroup);
+
+  // Closes the cached file descriptors for the given cgroup. Call
+  // this when the cgroup is being destroyed; reading it again later
+  // simply reopens the descriptors.
+  // @param   cgroup      Path to the cgroup relative to the hierarchy root.
+  void forget(const std::string& cgroup);
+
+private:
+  // No copying, no assigning (owns file descriptors).
+  StatReader(const StatReader&);
+  StatReader& operator = (const StatReader&);
+
+  const std::string hierarchy;
+  const std::vector<std::string> controls;
+
+  // Cached file descriptors per cgroup, parallel to 'controls'.
+  hashmap<std::string, std::vector<int> > fds;
+
+  // Reusable buffer for pread(2), sized generously for the largest
+  // stat files (memory.stat is well under a kilobyte).
+  char buffer[4096];
+};
+
 } // namespace cgroups {
 
 #endif // __CGROUPS_HPP__
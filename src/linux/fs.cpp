@@ -17,8 +17,11 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <linux/limits.h>
 
@@ -106,6 +109,57 @@ Try<MountTable> MountTable::read(const std::string& path)
 }
 
 
+Try<MountTable> MountTable::cached()
+{
+  // Mutex guarding the cached table and the fd used to detect mount
+  // table changes; multiple threads may consult the cache.
+  static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  static MountTable* table = NULL;
+  static int fd = -1;
+
+  Lock lock(&mutex);
+
+  if (table != NULL) {
+    // An open /proc/mounts fd polls with POLLERR|POLLPRI when the set
+    // of mounts has changed since the fd was opened.
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLERR | POLLPRI;
+    pfd.revents = 0;
+
+    if (::poll(&pfd, 1, 0) == 0) {
+      return *table; // No mount changes, serve the cached table.
+    }
+
+    // The mount table changed (or polling failed): re-read below.
+    delete table;
+    table = NULL;
+  }
+
+  // (Re)open the fd used to detect changes BEFORE parsing so that a
+  // concurrent mount is flagged on the next call rather than lost.
+  if (fd >= 0) {
+    ::close(fd);
+  }
+
+  fd = ::open("/proc/mounts", O_RDONLY);
+  if (fd < 0) {
+    return ErrnoError("Failed to open '/proc/mounts'");
+  }
+
+  Try<MountTable> result = read("/proc/mounts");
+  if (result.isError()) {
+    ::close(fd);
+    fd = -1;
+    return result;
+  }
+
+  table = new MountTable(result.get());
+
+  return *table;
+}
+
+
 Try<FileSystemTable> FileSystemTable::read()
 {
   // Mutex for guarding calls into non-reentrant fstab functions. We
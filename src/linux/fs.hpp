@@ -75,6 +75,15 @@ struct MountTable {
   // @return  An instance of MountTable if success.
   static Try<MountTable> read(const std::string& path);
 
+  // Read the mount table from /proc/mounts, cached across calls. The
+  // cache is invalidated when the kernel signals a mount table change
+  // (an open /proc/mounts fd polls with POLLERR|POLLPRI after a mount
+  // or unmount), so callers always see current data while repeated
+  // reads (e.g., the cgroup checks during slave startup) collapse
+  // into a single parse.
+  // @return  An instance of MountTable if success.
+  static Try<MountTable> cached();
+
   std::vector<Entry> entries;
 };
 
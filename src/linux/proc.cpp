@@ -1,5 +1,10 @@
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <glog/logging.h>
 
@@ -57,19 +62,14 @@ Try<set<pid_t> > pids()
 
 Try<set<pid_t> > children(pid_t pid, bool recursive)
 {
-  const Try<set<pid_t> >& pids = proc::pids();
-  if (pids.isError()) {
-    return Error(pids.error());
+  // A single snapshot of every process gives us all the parent
+  // links, without opening an ifstream per process.
+  const Try<ProcessStatistics>& snapshot = statistics();
+  if (snapshot.isError()) {
+    return Error(snapshot.error());
   }
 
-  // Stat all the processes.
-  list<ProcessStatus> processes;
-  foreach (pid_t _pid, pids.get()) {
-    const Try<ProcessStatus>& process = status(_pid);
-    if (process.isSome()) {
-      processes.push_back(process.get());
-    }
-  }
+  const ProcessStatistics& processes = snapshot.get();
 
   // Perform a breadth first search for descendants.
   set<pid_t> descendants;
@@ -81,11 +81,11 @@ Try<set<pid_t> > children(pid_t pid, bool recursive)
     parents.pop();
 
     // Search for children of parent.
-    foreach (const ProcessStatus& process, processes) {
-      if (process.ppid == parent) {
+    for (size_t i = 0; i < processes.size(); i++) {
+      if (processes.ppid[i] == parent) {
         // Have we seen this child yet?
-        if (descendants.insert(process.pid).second) {
-          parents.push(process.pid);
+        if (descendants.insert(processes.pid[i]).second) {
+          parents.push(processes.pid[i]);
         }
       }
     }
@@ -284,6 +284,98 @@ Try<ProcessStatus> status(pid_t pid)
                        signal, blocked, sigcatch, wchan, nswap, cnswap);
 }
 
+namespace {
+
+// Advances past 'fields' space separated fields.
+const char* skip(const char* p, int fields)
+{
+  while (fields-- > 0) {
+    while (*p == ' ') {
+      p++;
+    }
+    while (*p != ' ' && *p != '\0') {
+      p++;
+    }
+  }
+  return p;
+}
+
+} // namespace {
+
+
+Try<ProcessStatistics> statistics()
+{
+  const Try<set<pid_t> >& pids = proc::pids();
+  if (pids.isError()) {
+    return Error(pids.error());
+  }
+
+  return statistics(pids.get());
+}
+
+
+Try<ProcessStatistics> statistics(const set<pid_t>& pids)
+{
+  ProcessStatistics result;
+  result.pid.reserve(pids.size());
+  result.ppid.reserve(pids.size());
+  result.utime.reserve(pids.size());
+  result.stime.reserve(pids.size());
+  result.rss.reserve(pids.size());
+
+  // One buffer reused across every stat file; they are well under a
+  // page (comm is truncated by the kernel to 16 characters).
+  char path[32];
+  char buffer[4096];
+
+  foreach (pid_t pid, pids) {
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int) pid);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      continue; // The process has exited.
+    }
+
+    ssize_t length = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    close(fd);
+
+    if (length <= 0) {
+      continue;
+    }
+
+    buffer[length] = '\0';
+
+    // comm is the second field, wrapped in parentheses and possibly
+    // containing spaces (or parentheses); everything after the last
+    // ')' is the state character followed by space separated
+    // numbers. The field numbering below is relative to state being
+    // field 1; see proc(5).
+    const char* p = strrchr(buffer, ')');
+    if (p == NULL) {
+      continue;
+    }
+
+    p = skip(p + 1, 1);             // Skip state.
+    char* end;
+    pid_t ppid = (pid_t) strtol(p, &end, 10); // Field 2.
+
+    p = skip(end, 9);               // Fields 3 through 11.
+    unsigned long utime = strtoul(p, &end, 10);  // Field 12.
+    unsigned long stime = strtoul(end, &end, 10); // Field 13.
+
+    p = skip(end, 8);               // Fields 14 through 21.
+    long rss = strtol(p, &end, 10); // Field 22.
+
+    result.pid.push_back(pid);
+    result.ppid.push_back(ppid);
+    result.utime.push_back(utime);
+    result.stime.push_back(stime);
+    result.rss.push_back(rss);
+  }
+
+  return result;
+}
+
 } // namespace proc {
 } // namespace internal {
 } // namespace mesos {
@@ -24,6 +24,7 @@
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <stout/try.hpp>
 
@@ -35,6 +36,7 @@ namespace proc {
 struct CPU;
 struct SystemStatus;
 struct ProcessStatus;
+struct ProcessStatistics;
 
 
 // Reads from /proc and returns a list of all running processes.
@@ -53,6 +55,16 @@ Try<SystemStatus> status();
 // Returns the process statistics from /proc/[pid]/stat.
 Try<ProcessStatus> status(pid_t pid);
 
+// Snapshots the counters that usage collection needs (a subset of
+// ProcessStatus) for every given process (or every process in /proc)
+// in a single pass: each stat file is read with one pread into a
+// reusable buffer and the fields are scanned out manually rather
+// than through an ifstream per process. Processes that exit while
+// the snapshot is being taken are skipped rather than failing the
+// batch.
+Try<ProcessStatistics> statistics();
+Try<ProcessStatistics> statistics(const std::set<pid_t>& pids);
+
 // Representation of a processor (really an execution unit since this
 // captures "hardware threads" as well) modeled after /proc/cpuinfo.
 struct CPU
@@ -111,6 +123,20 @@ struct SystemStatus
 };
 
 
+// A batch snapshot of processes, one array per field (entry i of
+// every array describes the same process).
+struct ProcessStatistics
+{
+  size_t size() const { return pid.size(); }
+
+  std::vector<pid_t> pid;
+  std::vector<pid_t> ppid;
+  std::vector<unsigned long> utime; // In clock ticks.
+  std::vector<unsigned long> stime; // In clock ticks.
+  std::vector<long> rss;            // In pages.
+};
+
+
 // Snapshot of a process (modeled after /proc/[pid]/stat).
 // For more information, see:
 // http://www.kernel.org/doc/Documentation/filesystems/proc.txt
@@ -21,9 +21,11 @@
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 
+#include <stout/crc32c.hpp>
 #include <stout/duration.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/none.hpp>
 
 #include "log/coordinator.hpp"
@@ -35,12 +37,23 @@ using std::list;
 using std::pair;
 using std::set;
 using std::string;
+using std::vector;
 
 
 namespace mesos {
 namespace internal {
 namespace log {
 
+// Number of positions requested per bulk learn request while
+// catching up a lagging local replica.
+const uint64_t CATCHUP_WINDOW = 1024;
+
+// Maximum number of learned actions queued before being flushed to
+// the network as a single LearnedBatchMessage (see
+// Coordinator::flush), bounding the size of a batch.
+const int LEARNED_BATCH_SIZE = 64;
+
+
 Coordinator::Coordinator(int _quorum,
                          Replica* _replica,
                          Network* _network)
@@ -133,13 +146,23 @@ Result<uint64_t> Coordinator::elect(const Timeout& timeout)
 
     CHECK(positions.isReady()) << "Not expecting a discarded future!";
 
-    foreach (uint64_t position, positions.get()) {
+    // First try and catch up the missing positions by bulk learning
+    // them from our peers in concurrently requested windows. Only
+    // the positions that remain missing afterwards (e.g., not
+    // learned by any peer) go through the fill protocol below, which
+    // serializes a full consistency check per position.
+    // NOTE: catchup() returns by value, hence the named local.
+    const set<uint64_t>& remaining = catchup(positions.get(), timeout);
+
+    foreach (uint64_t position, remaining) {
       Result<Action> result = fill(position, timeout);
       if (result.isError()) {
         elected = false;
+        flush();
         return Error(result.error());
       } else if (result.isNone()) {
         elected = false;
+        flush();
         return None();
       } else {
         CHECK_SOME(result);
@@ -147,6 +170,8 @@ Result<uint64_t> Coordinator::elect(const Timeout& timeout)
       }
     }
 
+    flush();
+
     index += 1;
     return index - 1;
   }
@@ -159,6 +184,7 @@ Result<uint64_t> Coordinator::elect(const Timeout& timeout)
 
 Result<uint64_t> Coordinator::demote()
 {
+  flush(); // Don't hold on to any queued learned actions.
   elected = false;
   return index - 1;
 }
@@ -180,6 +206,11 @@ Result<uint64_t> Coordinator::append(
   Action::Append* append = action.mutable_append();
   append->set_bytes(bytes);
 
+  // Attach a payload checksum so replicas can detect a payload
+  // corrupted in transit before persisting it.
+  uint32_t crc = crc32c::checksum(bytes);
+  append->set_cksum((const char*) &crc, sizeof(crc));
+
   Result<uint64_t> result = write(action, timeout);
 
   if (result.isSome()) {
@@ -191,6 +222,155 @@ Result<uint64_t> Coordinator::append(
 }
 
 
+Result<uint64_t> Coordinator::append(
+    const Buffer& buffer,
+    const Timeout& timeout)
+{
+  // The payload gets copied (once) into the append action here; the
+  // write path below swaps it between the protocol messages rather
+  // than copying it again at each step.
+  return append(buffer.bytes(), timeout);
+}
+
+
+Result<uint64_t> Coordinator::append(
+    const vector<string>& entries,
+    const Timeout& timeout)
+{
+  if (!elected) {
+    return Error("Coordinator not elected");
+  }
+
+  if (entries.empty()) {
+    return Error("No entries to append");
+  }
+
+  // A single entry is just a regular append.
+  if (entries.size() == 1) {
+    return append(entries.front(), timeout);
+  }
+
+  // Build one append action per entry, at consecutive positions.
+  vector<Action> actions;
+  for (size_t i = 0; i < entries.size(); i++) {
+    Action action;
+    action.set_position(index + i);
+    action.set_promised(id);
+    action.set_performed(id);
+    action.set_type(Action::APPEND);
+    action.mutable_append()->set_bytes(entries[i]);
+
+    uint32_t crc = crc32c::checksum(entries[i]);
+    action.mutable_append()->set_cksum((const char*) &crc, sizeof(crc));
+
+    actions.push_back(action);
+  }
+
+  // TODO(benh): Eliminate this special case hack?
+  if (quorum == 1) {
+    foreach (Action& action, actions) {
+      Result<uint64_t> result = commit(action);
+      if (result.isError()) {
+        flush();
+        return Error(result.error());
+      } else if (result.isNone()) {
+        flush();
+        return None();
+      }
+      CHECK_SOME(result);
+      index++;
+    }
+    flush();
+    return index - 1;
+  }
+
+  LOG(INFO) << "Coordinator attempting to pipeline " << actions.size()
+            << " append actions at positions [" << index << ", "
+            << (index + actions.size() - 1) << "] within "
+            << timeout.remaining();
+
+  // Broadcast the write requests for every position up front,
+  // *excluding* the local replica. The acknowledgements for the
+  // positions come back interleaved and are collected below in
+  // whatever order they arrive.
+  set<Future<WriteResponse> > futures;
+
+  foreach (Action& action, actions) {
+    WriteRequest request;
+    request.set_id(id);
+    request.set_position(action.position());
+    request.set_type(Action::APPEND);
+
+    // Swap (rather than copy) the payload into the request, and back
+    // again once the request has been broadcast.
+    request.mutable_append()->Swap(action.mutable_append());
+
+    // NOTE: remotecast() returns by value, hence the named local.
+    const set<Future<WriteResponse> > responses =
+      remotecast(protocol::write, request);
+
+    action.mutable_append()->Swap(request.mutable_append());
+
+    futures.insert(responses.begin(), responses.end());
+  }
+
+  hashmap<uint64_t, uint32_t> okays; // Okays received per position.
+  size_t acked = 0; // Number of positions that have reached a quorum.
+
+  do {
+    Future<Future<WriteResponse> > future = select(futures);
+    if (future.await(timeout.remaining())) {
+      CHECK(future.get().isReady());
+      const WriteResponse& response = future.get().get();
+      CHECK(response.id() == id);
+      CHECK(response.position() >= index);
+      CHECK(response.position() < index + actions.size());
+      if (!response.okay()) {
+        discard(futures);
+        elected = false;
+        return Error("Coordinator demoted");
+      }
+      if (++okays[response.position()] == (quorum - 1)) { // N.B. (quorum - 1)!
+        if (++acked == actions.size()) {
+          break;
+        }
+      }
+      futures.erase(future.get());
+    }
+  } while (timeout.remaining() > Seconds(0));
+
+  // Discard the remaining futures.
+  discard(futures);
+
+  if (acked < actions.size()) {
+    // Timed out before every position reached a quorum. Nothing has
+    // been committed, so the append can simply be retried (just as a
+    // timed out regular append can).
+    LOG(INFO) << "Coordinator timed out while attempting to pipeline "
+              << actions.size() << " append actions at position " << index;
+    return None();
+  }
+
+  // Every position has reached a quorum: commit the actions in
+  // order, so that the entries become readable in append order.
+  foreach (Action& action, actions) {
+    Result<uint64_t> result = commit(action);
+    if (result.isError()) {
+      flush();
+      return Error(result.error());
+    } else if (result.isNone()) {
+      flush();
+      return None();
+    }
+    CHECK_SOME(result);
+    index++;
+  }
+
+  flush();
+  return index - 1;
+}
+
+
 Result<uint64_t> Coordinator::truncate(
     uint64_t to,
     const Timeout& timeout)
@@ -219,7 +399,7 @@ Result<uint64_t> Coordinator::truncate(
 
 
 Result<uint64_t> Coordinator::write(
-    const Action& action,
+    Action& action,
     const Timeout& timeout)
 {
   LOG(INFO) << "Coordinator attempting to write "
@@ -235,6 +415,7 @@ Result<uint64_t> Coordinator::write(
   // TODO(benh): Eliminate this special case hack?
   if (quorum == 1) {
     Result<uint64_t> result = commit(action);
+    flush();
     if (result.isError()) {
       return Error(result.error());
     } else if (result.isNone()) {
@@ -256,7 +437,9 @@ Result<uint64_t> Coordinator::write(
       break;
     case Action::APPEND:
       CHECK(action.has_append());
-      request.mutable_append()->MergeFrom(action.append());
+      // Swap (rather than copy) the payload into the request, and
+      // back again once the request has been broadcast.
+      request.mutable_append()->Swap(action.mutable_append());
       break;
     case Action::TRUNCATE:
       CHECK(action.has_truncate());
@@ -270,6 +453,10 @@ Result<uint64_t> Coordinator::write(
   set<Future<WriteResponse> > futures =
     remotecast(protocol::write, request);
 
+  if (action.type() == Action::APPEND) {
+    action.mutable_append()->Swap(request.mutable_append());
+  }
+
   uint32_t okays = 0;
 
   do {
@@ -288,6 +475,7 @@ Result<uint64_t> Coordinator::write(
           // and try and commit the action locally.
           discard(futures);
           Result<uint64_t> result = commit(action);
+          flush();
           if (result.isError()) {
             return Error(result.error());
           } else if (result.isNone()) {
@@ -311,7 +499,7 @@ Result<uint64_t> Coordinator::write(
 }
 
 
-Result<uint64_t> Coordinator::commit(const Action& action)
+Result<uint64_t> Coordinator::commit(Action& action)
 {
   LOG(INFO) << "Coordinator attempting to commit "
             << Action::Type_Name(action.type())
@@ -331,7 +519,10 @@ Result<uint64_t> Coordinator::commit(const Action& action)
       break;
     case Action::APPEND:
       CHECK(action.has_append());
-      request.mutable_append()->MergeFrom(action.append());
+      // Swap (rather than copy) the payload into the request; it
+      // gets swapped onwards into the learned message below once the
+      // local write has completed.
+      request.mutable_append()->Swap(action.mutable_append());
       break;
     case Action::TRUNCATE:
       CHECK(action.has_truncate());
@@ -371,25 +562,47 @@ Result<uint64_t> Coordinator::commit(const Action& action)
     return Error("Coordinator demoted");
   }
 
-  // Commit successful, send a learned message to the network
-  // *excluding* the local replica and return the position.
+  // Commit successful, queue a learned action for the network
+  // *excluding* the local replica and return the position. The
+  // queued batch is sent by flush, either when it reaches
+  // LEARNED_BATCH_SIZE or at the end of the enclosing operation.
 
-  LearnedMessage message;
-  message.mutable_action()->MergeFrom(action);
+  Action* learned = learning.add_actions();
+  learned->MergeFrom(action);
 
   if (!action.has_learned() || !action.learned()) {
-    message.mutable_action()->set_learned(true);
+    learned->set_learned(true);
   }
 
-  LOG(INFO) << "Telling other replicas of learned action at position "
-            << action.position();
+  if (action.type() == Action::APPEND) {
+    // The payload currently lives in the (no longer needed) write
+    // request; swap it into the queued action rather than copying.
+    learned->mutable_append()->Swap(request.mutable_append());
+  }
 
-  remotecast(message);
+  if (learning.actions_size() >= LEARNED_BATCH_SIZE) {
+    flush();
+  }
 
   return action.position();
 }
 
 
+void Coordinator::flush()
+{
+  if (learning.actions_size() == 0) {
+    return;
+  }
+
+  LOG(INFO) << "Telling other replicas of " << learning.actions_size()
+            << " learned actions";
+
+  remotecast(learning);
+
+  learning.Clear();
+}
+
+
 Result<Action> Coordinator::fill(uint64_t position, const Timeout& timeout)
 {
   LOG(INFO) << "Coordinator attempting to fill position "
@@ -451,7 +664,10 @@ Result<Action> Coordinator::fill(uint64_t position, const Timeout& timeout)
           // actual action at this position. Picking either action is
           // _correct_, since eventually we know this position will be
           // truncated. Fun!
-          Result<uint64_t> result = commit(response.action());
+          // NOTE: commit() may steal an append action's payload,
+          // hence the copy (we still return the original below).
+          Action learned = response.action();
+          Result<uint64_t> result = commit(learned);
           if (result.isError()) {
             return Error(result.error());
           } else if (result.isNone()) {
@@ -501,6 +717,110 @@ Result<Action> Coordinator::fill(uint64_t position, const Timeout& timeout)
 }
 
 
+set<uint64_t> Coordinator::catchup(
+    const set<uint64_t>& positions,
+    const Timeout& timeout)
+{
+  if (positions.empty()) {
+    return positions;
+  }
+
+  LOG(INFO) << "Coordinator attempting to catch up "
+            << positions.size() << " missing positions";
+
+  CHECK(elected);
+
+  // Request a bulk learn per window of missing positions, all
+  // concurrently, so that a long outage gets recovered with
+  // overlapping transfers rather than a protocol round per position.
+  set<Future<BulkLearnResponse> > futures;
+
+  uint64_t from = *positions.begin();
+  const uint64_t last = *positions.rbegin();
+
+  while (from <= last) {
+    uint64_t to = std::min(last, from + CATCHUP_WINDOW - 1);
+
+    BulkLearnRequest request;
+    request.set_from(from);
+    request.set_to(to);
+
+    // NOTE: remotecast() returns by value, hence the named local.
+    const set<Future<BulkLearnResponse> >& broadcasted =
+      remotecast(protocol::bulklearn, request);
+
+    futures.insert(broadcasted.begin(), broadcasted.end());
+
+    from = to + 1;
+  }
+
+  // Collect learned actions for the missing positions as the
+  // responses arrive, quitting early once every position is covered.
+  hashmap<uint64_t, Action> actions;
+
+  while (actions.size() < positions.size() && !futures.empty()) {
+    Future<Future<BulkLearnResponse> > future = select(futures);
+    if (!future.await(timeout.remaining())) {
+      break;
+    }
+
+    CHECK(future.get().isReady());
+
+    // NOTE: Future::get() returns by value, hence the named local.
+    const BulkLearnResponse& response = future.get().get();
+
+    if (response.okay()) {
+      for (int i = 0; i < response.actions_size(); i++) {
+        const Action& action = response.actions(i);
+        if (positions.count(action.position()) > 0 &&
+            action.has_learned() && action.learned()) {
+          actions[action.position()] = action;
+        }
+      }
+    }
+
+    futures.erase(future.get());
+  }
+
+  discard(futures);
+
+  // Apply whatever we got with a single batched write to the local
+  // replica and determine which positions remain missing.
+  set<uint64_t> remaining = positions;
+
+  if (!actions.empty()) {
+    list<Action> learned;
+
+    // Apply the actions in position order (not required for
+    // correctness, but it keeps the replica's hole bookkeeping from
+    // transiently ballooning).
+    foreach (uint64_t position, positions) {
+      if (actions.count(position) > 0) {
+        learned.push_back(actions[position]);
+      }
+    }
+
+    Future<bool> persisted = replica->catchup(learned);
+
+    if (persisted.await(timeout.remaining()) &&
+        persisted.isReady() &&
+        persisted.get()) {
+      foreach (uint64_t position, positions) {
+        if (actions.count(position) > 0) {
+          remaining.erase(position);
+        }
+      }
+    }
+  }
+
+  LOG(INFO) << "Coordinator caught up "
+            << (positions.size() - remaining.size()) << " of "
+            << positions.size() << " missing positions";
+
+  return remaining;
+}
+
+
 template <typename Req, typename Res>
 set<Future<Res> > Coordinator::broadcast(
     const Protocol<Req, Res>& protocol,
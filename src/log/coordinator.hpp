@@ -22,6 +22,8 @@
 #include <string>
 #include <vector>
 
+#include <tr1/memory>
+
 #include <process/process.hpp>
 #include <process/timeout.hpp>
 
@@ -37,6 +39,28 @@ namespace mesos {
 namespace internal {
 namespace log {
 
+// A refcounted, immutable append payload. Copying a Buffer shares
+// the underlying bytes rather than copying them, so a payload can be
+// held onto cheaply (e.g., for retrying a timed out append) while
+// only getting copied into the write protocol once.
+class Buffer
+{
+public:
+  // Copies the specified bytes into the buffer.
+  explicit Buffer(const std::string& bytes)
+    : data(new std::string(bytes)) {}
+
+  // Takes ownership of the specified bytes (avoiding a copy).
+  explicit Buffer(std::string* bytes)
+    : data(bytes) {}
+
+  const std::string& bytes() const { return *data; }
+
+private:
+  std::tr1::shared_ptr<const std::string> data;
+};
+
+
 class Coordinator
 {
 public:
@@ -58,6 +82,26 @@ public:
       const std::string& bytes,
       const process::Timeout& timeout);
 
+  // Like append, but takes a refcounted buffer: the payload is
+  // copied once into the write protocol and the buffer itself can be
+  // shared (e.g., retained for retries) without further copies.
+  Result<uint64_t> append(
+      const Buffer& buffer,
+      const process::Timeout& timeout);
+
+  // Like append, but each entry becomes its own log position and the
+  // write rounds for all positions are pipelined: the write requests
+  // are broadcast up front and their acknowledgements collected in
+  // whatever order they arrive, rather than serializing a full round
+  // trip to the quorum per entry. The actions are committed in order
+  // once every position has reached a quorum, so readers observe the
+  // entries in append order. Returns the position of the last entry
+  // appended. A result of none means nothing was committed (e.g.,
+  // due to timeout) and the append can be retried.
+  Result<uint64_t> append(
+      const std::vector<std::string>& entries,
+      const process::Timeout& timeout);
+
   // Returns the result of trying to truncate the log (from the
   // beginning to the specified position exclusive). A result of
   // none means the truncate failed (e.g., due to timeout), but can be
@@ -67,16 +111,37 @@ public:
 private:
   // Helper that tries to achieve consensus of the specified action. A
   // result of none means the write failed (e.g., due to timeout), but
-  // can be retried.
-  Result<uint64_t> write(const Action& action, const process::Timeout& timeout);
+  // can be retried. Note that an append action's payload is swapped
+  // (not copied) through the protocol messages, so the action's
+  // bytes may have been stolen by the time this returns.
+  Result<uint64_t> write(Action& action, const process::Timeout& timeout);
 
   // Helper that handles commiting an action (i.e., writing to the
-  // local replica and then sending out learned messages).
-  Result<uint64_t> commit(const Action& action);
+  // local replica and then queueing a learned message). Like
+  // write, may steal an append action's payload.
+  Result<uint64_t> commit(Action& action);
+
+  // Sends any learned actions queued by commit to the network
+  // *excluding* the local replica, as a single batch. Called when
+  // the batch reaches LEARNED_BATCH_SIZE and at the end of each
+  // operation, so that one operation (e.g., a pipelined multi-entry
+  // append) disseminates its learning in one message rather than one
+  // per action.
+  void flush();
 
   // Helper that tries to fill a position in the log.
   Result<Action> fill(uint64_t position, const process::Timeout& timeout);
 
+  // Helper that tries to bring the local replica up to date by bulk
+  // learning the missing positions from our peers in concurrently
+  // requested windows, applying what it gets with a single batched
+  // write. Returns the positions that could not be caught up this
+  // way (e.g., not learned by any peer) and thus still need to go
+  // through the fill protocol.
+  std::set<uint64_t> catchup(
+      const std::set<uint64_t>& positions,
+      const process::Timeout& timeout);
+
   // Helper that uses the specified protocol to broadcast a request to
   // our group and return a set of futures.
   template <typename Req, typename Res>
@@ -105,6 +170,9 @@ private:
   uint64_t id; // Coordinator ID.
 
   uint64_t index; // Last position written in the log.
+
+  // Learned actions queued by commit but not yet sent (see flush).
+  LearnedBatchMessage learning;
 };
 
 } // namespace log {
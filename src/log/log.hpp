@@ -22,6 +22,7 @@
 #include <list>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <process/process.hpp>
 #include <process/timeout.hpp>
@@ -137,6 +138,20 @@ public:
     // partitioned).
     Position ending();
 
+    // Durably installs a compacted snapshot of everything the
+    // consumer has applied up to and including the specified
+    // position, so that a recovery can restore the snapshot and
+    // replay only the tail of the log after it rather than the whole
+    // retained log. A snapshot is local to this replica (it is not
+    // replicated via consensus); each consumer is responsible for
+    // snapshotting its own replica. Returns true if the snapshot was
+    // installed.
+    bool install(const Position& position, const std::string& data);
+
+    // Returns the most recently installed snapshot (its position and
+    // data), or none if no snapshot has been installed.
+    Option<Entry> snapshot();
+
   private:
     Replica* replica;
   };
@@ -159,6 +174,25 @@ public:
         const std::string& data,
         const process::Timeout& timeout);
 
+    // Like append, but takes a refcounted buffer: the payload gets
+    // copied into the write protocol only once and the buffer can be
+    // cheaply retained (e.g., for retrying after a none result)
+    // without holding a second copy of the data.
+    Result<Position> append(
+        const Buffer& buffer,
+        const process::Timeout& timeout);
+
+    // Attempts to append all of the specified entries to the log,
+    // each at its own position, in one pipelined round of the
+    // underlying protocol rather than one full round trip to the
+    // quorum per entry. Either all of the entries get appended (and
+    // the position of the last one is returned) or none do. A none
+    // result means the operation timed out and can be retried. Upon
+    // error a new Writer must be created.
+    Result<Position> append(
+        const std::list<std::string>& entries,
+        const process::Timeout& timeout);
+
     // Attempts to truncate the log up to but not including the
     // specificed position. A none result means the operation timed
     // out, otherwise the new ending position of the log is returned
@@ -173,18 +207,20 @@ public:
   };
 
   // Creates a new replicated log that assumes the specified quorum
-  // size, is backed by a file at the specified path, and coordiantes
-  // with other replicas via the set of process PIDs.
+  // size, is backed by a file at the specified path (with the
+  // optionally specified storage tuning), and coordiantes with other
+  // replicas via the set of process PIDs.
   Log(int _quorum,
       const std::string& path,
-      const std::set<process::UPID>& pids)
+      const std::set<process::UPID>& pids,
+      const StorageOptions& storage = StorageOptions())
     : group(NULL)
   {
     GOOGLE_PROTOBUF_VERIFY_VERSION;
 
     quorum = _quorum;
 
-    replica = new Replica(path);
+    replica = new Replica(path, storage);
 
     network = new Network(pids);
 
@@ -201,7 +237,8 @@ public:
       const std::string& servers,
       const Duration& timeout,
       const std::string& znode,
-      const Option<zookeeper::Authentication>& auth = None())
+      const Option<zookeeper::Authentication>& auth = None(),
+      const StorageOptions& storage = StorageOptions())
   {
     GOOGLE_PROTOBUF_VERIFY_VERSION;
 
@@ -209,7 +246,7 @@ public:
 
     LOG(INFO) << "Creating a new log replica";
 
-    replica = new Replica(path);
+    replica = new Replica(path, storage);
 
     group = new zookeeper::Group(servers, timeout, znode, auth);
     network = new ZooKeeperNetwork(group);
@@ -339,6 +376,43 @@ Log::Position Log::Reader::ending()
 }
 
 
+bool Log::Reader::install(
+    const Log::Position& position,
+    const std::string& data)
+{
+  Snapshot snapshot;
+  snapshot.set_position(position.value);
+  snapshot.set_bytes(data);
+
+  // TODO(benh): Take a timeout and return an Option.
+  process::Future<bool> installed = replica->install(snapshot);
+  installed.await();
+  CHECK(installed.isReady()) << "Not expecting a failed or discarded future!";
+  return installed.get();
+}
+
+
+Option<Log::Entry> Log::Reader::snapshot()
+{
+  // TODO(benh): Take a timeout and return an Option.
+  process::Future<Option<Snapshot> > future = replica->snapshot();
+  future.await();
+  CHECK(future.isReady()) << "Not expecting a failed or discarded future!";
+
+  // NOTE: Future::get() returns by value, hence the named local.
+  const Option<Snapshot>& option = future.get();
+
+  if (option.isNone()) {
+    return Option<Log::Entry>::none();
+  }
+
+  // NOTE: Option::get() returns by value, hence the named local.
+  const Snapshot& snapshot = option.get();
+
+  return Entry(Position(snapshot.position()), snapshot.bytes());
+}
+
+
 Log::Writer::Writer(Log* log, const Duration& timeout, int retries)
   : error(None()),
     coordinator(log->quorum, log->replica, log->network)
@@ -388,6 +462,66 @@ Result<Log::Position> Log::Writer::append(
 }
 
 
+Result<Log::Position> Log::Writer::append(
+    const Buffer& buffer,
+    const process::Timeout& timeout)
+{
+  if (error.isSome()) {
+    return Error(error.get());
+  }
+
+  LOG(INFO) << "Attempting to append " << buffer.bytes().size()
+            << " bytes to the log";
+
+  Result<uint64_t> result = coordinator.append(buffer, timeout);
+
+  if (result.isError()) {
+    error = result.error();
+    return Error(error.get());
+  } else if (result.isNone()) {
+    return None();
+  }
+
+  CHECK_SOME(result);
+
+  return Log::Position(result.get());
+}
+
+
+Result<Log::Position> Log::Writer::append(
+    const std::list<std::string>& entries,
+    const process::Timeout& timeout)
+{
+  if (error.isSome()) {
+    return Error(error.get());
+  }
+
+  size_t bytes = 0;
+  std::vector<std::string> copy;
+  copy.reserve(entries.size());
+  foreach (const std::string& entry, entries) {
+    bytes += entry.size();
+    copy.push_back(entry);
+  }
+
+  LOG(INFO) << "Attempting to append " << copy.size() << " entries ("
+            << bytes << " bytes) to the log";
+
+  Result<uint64_t> result = coordinator.append(copy, timeout);
+
+  if (result.isError()) {
+    error = result.error();
+    return Error(error.get());
+  } else if (result.isNone()) {
+    return None();
+  }
+
+  CHECK_SOME(result);
+
+  return Log::Position(result.get());
+}
+
+
 Result<Log::Position> Log::Writer::truncate(
     const Log::Position& to,
     const process::Timeout& timeout)
@@ -16,21 +16,31 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <list>
 #include <string>
+#include <vector>
 
 #include <process/process.hpp>
+#include <process/timeout.hpp>
 
+#include <stout/bytes.hpp>
+#include <stout/duration.hpp>
 #include <stout/foreach.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 
 #include "configurator/configurator.hpp"
 #include "configurator/configuration.hpp"
 
 #include "flags/flags.hpp"
 
+#include "log/coordinator.hpp"
+#include "log/network.hpp"
 #include "log/replica.hpp"
 
 #include "logging/flags.hpp"
@@ -40,10 +50,15 @@ using namespace mesos;
 using namespace mesos::internal;
 using namespace mesos::internal::log;
 
+using process::Timeout;
+using process::UPID;
+
 using std::cerr;
 using std::cout;
 using std::endl;
+using std::set;
 using std::string;
+using std::vector;
 
 
 void usage(const char* argv0, const Configurator& configurator)
@@ -55,6 +70,168 @@ void usage(const char* argv0, const Configurator& configurator)
 }
 
 
+// Returns the specified percentile (e.g., 0.5, 0.99) of the sorted
+// latencies, in seconds.
+double percentile(const vector<double>& latencies, double q)
+{
+  CHECK(!latencies.empty());
+  size_t index = (size_t) (q * latencies.size());
+  return latencies[std::min(index, latencies.size() - 1)];
+}
+
+
+// Drives a synthetic append workload against a local quorum of
+// replicas (all stored under the specified scratch directory) and
+// reports append latency percentiles, sustained throughput, and the
+// cost of the truncate and catch-up paths.
+int benchmark(
+    const string& path,
+    int replicas,
+    int appends,
+    const Bytes& size,
+    int batch,
+    const StorageOptions& storage)
+{
+  CHECK(replicas > 0);
+  CHECK(appends > 0);
+  CHECK(batch > 0);
+
+  cout << "Benchmarking " << appends << " appends of " << size.bytes()
+       << " bytes (batches of " << batch << ") against "
+       << replicas << " local replicas" << endl;
+
+  // Spin up the local quorum.
+  vector<Replica*> members;
+  set<UPID> pids;
+
+  for (int i = 0; i < replicas; i++) {
+    Replica* replica =
+      new Replica(path::join(path, "replica" + stringify(i)), storage);
+    members.push_back(replica);
+    pids.insert(replica->pid());
+  }
+
+  Network network(pids);
+
+  int quorum = (replicas / 2) + 1;
+
+  Coordinator coordinator(quorum, members[0], &network);
+
+  // An election can return none (e.g., lost a round) and be retried.
+  Result<uint64_t> elected = None();
+  for (int i = 0; i < 3 && elected.isNone(); i++) {
+    elected = coordinator.elect(Timeout(Seconds(10.0)));
+  }
+
+  if (!elected.isSome()) {
+    cerr << "Failed to elect a coordinator"
+         << (elected.isError() ? ": " + elected.error() : "") << endl;
+    return 1;
+  }
+
+  const string data(size.bytes(), 'x');
+
+  vector<double> latencies;
+  latencies.reserve(appends);
+
+  Stopwatch total;
+  total.start();
+
+  uint64_t position = 0;
+
+  for (int appended = 0; appended < appends; appended += batch) {
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    Result<uint64_t> result = None();
+
+    if (batch == 1) {
+      result = coordinator.append(data, Timeout(Seconds(10.0)));
+    } else {
+      vector<string> entries(batch, data);
+      result = coordinator.append(entries, Timeout(Seconds(10.0)));
+    }
+
+    if (!result.isSome()) {
+      cerr << "Append failed"
+           << (result.isError() ? ": " + result.error() : "") << endl;
+      return 1;
+    }
+
+    position = result.get();
+
+    latencies.push_back(stopwatch.elapsed().secs());
+  }
+
+  double elapsed = total.elapsed().secs();
+
+  std::sort(latencies.begin(), latencies.end());
+
+  cout << "Appended " << appends << " entries ("
+       << (appends * size.bytes()) << " bytes) in "
+       << elapsed << " secs: " << (appends / elapsed) << " appends/sec"
+       << endl;
+  cout << "Latency per append call (secs):"
+       << " p50 " << percentile(latencies, 0.50)
+       << " p90 " << percentile(latencies, 0.90)
+       << " p99 " << percentile(latencies, 0.99)
+       << " max " << latencies.back()
+       << endl;
+
+  // Exercise the truncate path (truncate away the first half).
+  {
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    Result<uint64_t> result =
+      coordinator.truncate(position / 2, Timeout(Seconds(10.0)));
+
+    if (!result.isSome()) {
+      cerr << "Truncate failed"
+           << (result.isError() ? ": " + result.error() : "") << endl;
+      return 1;
+    }
+
+    cout << "Truncated to position " << (position / 2) << " in "
+         << stopwatch.elapsed().secs() << " secs" << endl;
+  }
+
+  // Exercise the catch-up path: elect a coordinator whose local
+  // replica is brand new and thus has to catch up the entire log.
+  {
+    Replica lagging(path::join(path, "lagging"), storage);
+
+    Network network2(pids);
+    network2.add(lagging.pid());
+
+    Coordinator coordinator2(quorum, &lagging, &network2);
+
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    Result<uint64_t> result = None();
+    for (int i = 0; i < 3 && result.isNone(); i++) {
+      result = coordinator2.elect(Timeout(Seconds(10.0)));
+    }
+
+    if (!result.isSome()) {
+      cerr << "Failed to elect a catch-up coordinator"
+           << (result.isError() ? ": " + result.error() : "") << endl;
+      return 1;
+    }
+
+    cout << "Caught up a new replica (and got elected) in "
+         << stopwatch.elapsed().secs() << " secs" << endl;
+  }
+
+  for (size_t i = 0; i < members.size(); i++) {
+    delete members[i];
+  }
+
+  return 0;
+}
+
+
 int main(int argc, char** argv)
 {
   flags::Flags<logging::Flags> flags;
@@ -69,6 +246,67 @@ int main(int argc, char** argv)
             "to",
             "Position from which to stop reading in the log");
 
+  Bytes write_buffer_size;
+  flags.add(&write_buffer_size,
+            "write_buffer_size",
+            "Size of the leveldb write buffer\n"
+            "(0 means use the leveldb default)",
+            Bytes(0));
+
+  Bytes block_cache_size;
+  flags.add(&block_cache_size,
+            "block_cache_size",
+            "Size of the leveldb block cache\n"
+            "(0 means use the leveldb default)",
+            Bytes(0));
+
+  int bloom_bits;
+  flags.add(&bloom_bits,
+            "bloom_bits",
+            "Bits per key for the leveldb bloom filter\n"
+            "(0 means no bloom filter)",
+            0);
+
+  bool group_sync;
+  flags.add(&group_sync,
+            "group_sync",
+            "Whether persisted actions share periodic sync\n"
+            "barriers rather than each being synced immediately",
+            false);
+
+  bool benchmark;
+  flags.add(&benchmark,
+            "benchmark",
+            "Run a benchmark against a local quorum of replicas\n"
+            "(stored under the path argument, which should be a\n"
+            "scratch directory) instead of reading a log",
+            false);
+
+  int replicas;
+  flags.add(&replicas,
+            "replicas",
+            "Number of local replicas to benchmark against",
+            3);
+
+  int appends;
+  flags.add(&appends,
+            "appends",
+            "Number of entries to append while benchmarking",
+            1000);
+
+  Bytes size;
+  flags.add(&size,
+            "size",
+            "Size of each appended entry while benchmarking",
+            Bytes(256));
+
+  int batch;
+  flags.add(&batch,
+            "batch",
+            "Number of entries appended per (pipelined) append\n"
+            "call while benchmarking",
+            1);
+
   bool help;
   flags.add(&help,
             "help",
@@ -98,7 +336,17 @@ int main(int argc, char** argv)
 
   string path = argv[argc - 1];
 
-  Replica replica(path);
+  StorageOptions storage;
+  storage.writeBufferSize = write_buffer_size.bytes();
+  storage.blockCacheSize = block_cache_size.bytes();
+  storage.bloomBits = bloom_bits;
+  storage.groupSync = group_sync;
+
+  if (benchmark) {
+    return ::benchmark(path, replicas, appends, size, batch, storage);
+  }
+
+  Replica replica(path, storage);
 
   process::Future<uint64_t> begin = replica.beginning();
   process::Future<uint64_t> end = replica.ending();
@@ -22,10 +22,14 @@
 // TODO(benh): Eventually move and associate this code with the
 // libprocess protobuf code rather than keep it here.
 
+#include <list>
+#include <map>
 #include <set>
 #include <string>
 
 #include <process/collect.hpp>
+#include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/executor.hpp>
 #include <process/protobuf.hpp>
 #include <process/timeout.hpp>
@@ -33,9 +37,15 @@
 #include <stout/duration.hpp>
 #include <stout/foreach.hpp>
 #include <stout/lambda.hpp>
+#include <stout/option.hpp>
+#include <stout/stopwatch.hpp>
 
 #include "logging/logging.hpp"
 
+// TODO(benh): Kill this dependency (e.g., by parameterizing the
+// probe protocol) if this code ever moves out of the log.
+#include "log/replica.hpp"
+
 #include "zookeeper/group.hpp"
 
 // Forward declaration.
@@ -69,6 +79,20 @@ public:
       const Req& req,
       const std::set<process::UPID>& filter = std::set<process::UPID>());
 
+  // Sends a request to each member of the network and returns a
+  // future that completes with the first 'quorum' responses received
+  // (or fails once too many members have failed to respond for a
+  // quorum to remain possible). Lagging responses are deliberately
+  // left flowing in the background rather than discarded. Members
+  // whose responses have been consistently slow may be skipped
+  // entirely, but only when enough members remain for a quorum.
+  template <typename Req, typename Res>
+  process::Future<std::list<Res> > gather(
+      const Protocol<Req, Res>& protocol,
+      const Req& req,
+      size_t quorum,
+      const std::set<process::UPID>& filter = std::set<process::UPID>());
+
   // Sends a message to each member of the network.
   template <typename M>
   void broadcast(
@@ -107,26 +131,128 @@ private:
 };
 
 
+// Weight given to the most recent response latency in the moving
+// average kept per member (see NetworkProcess::responded).
+const double LATENCY_ALPHA = 0.25;
+
+// How many times slower than the fastest member a member's average
+// response latency must be before a quorum gather will skip it.
+const double LATENCY_SLOW_FACTOR = 3.0;
+
+// How often each member gets probed with a lightweight ping, keeping
+// connections warm and latency averages fresh even without log
+// traffic (see NetworkProcess::probe).
+const Duration PROBE_INTERVAL = Seconds(2.0);
+
+
+// Completes a promise with the first 'quorum' responses received
+// from a broadcast (modeled after process::internal::CollectProcess).
+// Futures still pending once a quorum has responded are deliberately
+// *not* discarded so that lagging responses keep flowing in the
+// background.
+template <typename Res>
+class QuorumProcess : public process::Process<QuorumProcess<Res> >
+{
+public:
+  QuorumProcess(
+      const std::set<process::Future<Res> >& _futures,
+      size_t _quorum,
+      process::Promise<std::list<Res> >* _promise)
+    : futures(_futures),
+      quorum(_quorum),
+      promise(_promise),
+      failures(0) {}
+
+  virtual ~QuorumProcess()
+  {
+    delete promise;
+  }
+
+  virtual void initialize()
+  {
+    // Stop this nonsense if nobody cares.
+    promise->future().onDiscarded(
+        process::defer(this, &QuorumProcess<Res>::discarded));
+
+    if (futures.size() < quorum) {
+      promise->fail("Quorum gather failed: too few members");
+      process::terminate(this);
+      return;
+    }
+
+    typename std::set<process::Future<Res> >::const_iterator iterator;
+    for (iterator = futures.begin(); iterator != futures.end(); ++iterator) {
+      (*iterator).onAny(process::defer(
+          this, &QuorumProcess<Res>::waited, std::tr1::placeholders::_1));
+    }
+  }
+
+private:
+  void discarded()
+  {
+    process::terminate(this);
+  }
+
+  void waited(const process::Future<Res>& future)
+  {
+    if (future.isReady()) {
+      values.push_back(future.get());
+      if (values.size() == quorum) {
+        promise->set(values);
+        process::terminate(this);
+      }
+    } else {
+      // A failed (or discarded) response; rather than waiting on a
+      // timeout we can fail as soon as a quorum of responses is no
+      // longer possible.
+      failures++;
+      if ((futures.size() - failures) < quorum) {
+        promise->fail("Quorum gather failed: too many failures");
+        process::terminate(this);
+      }
+    }
+  }
+
+  const std::set<process::Future<Res> > futures;
+  const size_t quorum;
+  process::Promise<std::list<Res> >* promise;
+  std::list<Res> values;
+  size_t failures;
+};
+
+
 class NetworkProcess : public ProtobufProcess<NetworkProcess>
 {
 public:
-  NetworkProcess() {}
+  NetworkProcess() : round(0) {}
 
   NetworkProcess(const std::set<process::UPID>& pids)
+    : round(0)
   {
     set(pids);
   }
 
+  virtual void initialize()
+  {
+    process::delay(PROBE_INTERVAL, self(), &NetworkProcess::probe);
+  }
+
   void add(const process::UPID& pid)
   {
     link(pid); // Try and keep a socket open (more efficient).
     pids.insert(pid);
+
+    // Probe the new member right away: this warms up the connection
+    // before any consensus round needs it and seeds the latency
+    // average used by gather.
+    ping(pid);
   }
 
   void remove(const process::UPID& pid)
   {
     // TODO(benh): unlink(pid);
     pids.erase(pid);
+    pending.erase(pid);
   }
 
   void set(const std::set<process::UPID>& _pids)
@@ -146,16 +272,76 @@ public:
       const std::set<process::UPID>& filter)
   {
     std::set<process::Future<Res> > futures;
-    typename std::set<process::UPID>::const_iterator iterator;
+    std::set<process::UPID>::const_iterator iterator;
     for (iterator = pids.begin(); iterator != pids.end(); ++iterator) {
       const process::UPID& pid = *iterator;
       if (filter.count(pid) == 0) {
-        futures.insert(protocol(pid, req));
+        futures.insert(request(protocol, pid, req));
       }
     }
     return futures;
   }
 
+  // Sends a request to each of the groups members and returns a
+  // future that completes with the first 'quorum' responses (see
+  // Network::gather).
+  template <typename Req, typename Res>
+  process::Future<std::list<Res> > gather(
+      const Protocol<Req, Res>& protocol,
+      const Req& req,
+      size_t quorum,
+      const std::set<process::UPID>& filter)
+  {
+    std::set<process::UPID> targets;
+    std::set<process::UPID>::const_iterator iterator;
+    for (iterator = pids.begin(); iterator != pids.end(); ++iterator) {
+      if (filter.count(*iterator) == 0) {
+        targets.insert(*iterator);
+      }
+    }
+
+    // Determine the fastest average response latency among the
+    // targets so we can recognize consistently slow members.
+    Option<double> fastest;
+    for (iterator = targets.begin(); iterator != targets.end(); ++iterator) {
+      if (latencies.count(*iterator) > 0) {
+        const double latency = latencies[*iterator];
+        if (fastest.isNone() || latency < fastest.get()) {
+          fastest = latency;
+        }
+      }
+    }
+
+    // Skip consistently slow members, but only as many as still
+    // leaves a full quorum of members being asked.
+    if (fastest.isSome() && targets.size() > quorum) {
+      size_t skips = targets.size() - quorum;
+      iterator = targets.begin();
+      while (iterator != targets.end() && skips > 0) {
+        const process::UPID& pid = *iterator;
+        if (latencies.count(pid) > 0 &&
+            latencies[pid] > (LATENCY_SLOW_FACTOR * fastest.get())) {
+          VLOG(1) << "Skipping slow member " << pid << " in quorum gather";
+          targets.erase(iterator++);
+          skips--;
+        } else {
+          ++iterator;
+        }
+      }
+    }
+
+    std::set<process::Future<Res> > futures;
+    for (iterator = targets.begin(); iterator != targets.end(); ++iterator) {
+      futures.insert(request(protocol, *iterator, req));
+    }
+
+    process::Promise<std::list<Res> >* promise =
+      new process::Promise<std::list<Res> >();
+    process::Future<std::list<Res> > future = promise->future();
+    process::spawn(new QuorumProcess<Res>(futures, quorum, promise), true);
+    return future;
+  }
+
   template <typename M>
   void broadcast(
       const M& m,
@@ -171,11 +357,122 @@ public:
   }
 
 private:
+  // Periodically probes every member with a lightweight ping so that
+  // sockets stay warm and the per-member latency averages (used by
+  // gather to skip slow members) stay fresh even without log
+  // traffic. A member that has gone half-dead thus gets recognized
+  // before it can stall a consensus round.
+  void probe()
+  {
+    // Penalize members that never answered their previous probe:
+    // record them as at least a probe interval slow, so that gather
+    // prefers healthier members in the meantime.
+    std::set<process::UPID>::const_iterator iterator;
+    for (iterator = pending.begin(); iterator != pending.end(); ++iterator) {
+      if (pids.count(*iterator) > 0) {
+        responded(*iterator, PROBE_INTERVAL);
+      }
+    }
+    pending.clear();
+
+    round++;
+
+    for (iterator = pids.begin(); iterator != pids.end(); ++iterator) {
+      ping(*iterator);
+    }
+
+    process::delay(PROBE_INTERVAL, self(), &NetworkProcess::probe);
+  }
+
+  // Sends a single health probe to the specified member (see probe).
+  void ping(const process::UPID& pid)
+  {
+    mesos::internal::log::PingRequest req;
+    req.set_id(round);
+
+    pending.insert(pid);
+
+    request(mesos::internal::log::protocol::ping, pid, req)
+      .onAny(lambda::bind(
+          &NetworkProcess::pinged, self(), pid, lambda::_1));
+  }
+
+  // Invoked (from the responding future's execution context, hence
+  // static plus a dispatch) once a probe has completed. Note that
+  // the probe's latency is recorded by 'request' just like any other
+  // request.
+  static void pinged(
+      const process::PID<NetworkProcess>& network,
+      const process::UPID& pid,
+      const process::Future<mesos::internal::log::PingResponse>& future)
+  {
+    if (future.isReady()) {
+      process::dispatch(network, &NetworkProcess::answered, pid);
+    }
+  }
+
+  void answered(const process::UPID& pid)
+  {
+    pending.erase(pid);
+  }
+
+  // Sends a request to the specified member, arranging for its
+  // response latency to be recorded (see 'responded').
+  template <typename Req, typename Res>
+  process::Future<Res> request(
+      const Protocol<Req, Res>& protocol,
+      const process::UPID& pid,
+      const Req& req)
+  {
+    Stopwatch stopwatch;
+    stopwatch.start();
+    process::Future<Res> future = protocol(pid, req);
+    future.onAny(lambda::bind(
+        &NetworkProcess::observed<Res>, self(), pid, stopwatch, lambda::_1));
+    return future;
+  }
+
+  // Invoked (from the responding future's execution context, hence
+  // static plus a dispatch) once a member has responded.
+  template <typename Res>
+  static void observed(
+      const process::PID<NetworkProcess>& network,
+      const process::UPID& pid,
+      const Stopwatch& stopwatch,
+      const process::Future<Res>& future)
+  {
+    if (future.isReady()) {
+      process::dispatch(
+          network, &NetworkProcess::responded, pid, stopwatch.elapsed());
+    }
+  }
+
+  // Records the response latency of the specified member as an
+  // exponentially weighted moving average.
+  void responded(const process::UPID& pid, const Duration& duration)
+  {
+    if (latencies.count(pid) > 0) {
+      latencies[pid] =
+        (LATENCY_ALPHA * duration.secs()) +
+        ((1.0 - LATENCY_ALPHA) * latencies[pid]);
+    } else {
+      latencies[pid] = duration.secs();
+    }
+  }
+
   // Not copyable, not assignable.
   NetworkProcess(const NetworkProcess&);
   NetworkProcess& operator = (const NetworkProcess&);
 
   std::set<process::UPID> pids;
+
+  // Average response latency (in seconds) per member.
+  std::map<process::UPID, double> latencies;
+
+  // Members probed in the current round that have not answered yet.
+  std::set<process::UPID> pending;
+
+  uint64_t round; // Current probe round (used as the ping id).
 };
 
 
@@ -230,6 +527,18 @@ process::Future<std::set<process::Future<Res> > > Network::broadcast(
 }
 
 
+template <typename Req, typename Res>
+process::Future<std::list<Res> > Network::gather(
+    const Protocol<Req, Res>& protocol,
+    const Req& req,
+    size_t quorum,
+    const std::set<process::UPID>& filter)
+{
+  return process::dispatch(process, &NetworkProcess::gather<Req, Res>,
+                           protocol, req, quorum, filter);
+}
+
+
 template <typename M>
 void Network::broadcast(
     const M& m,
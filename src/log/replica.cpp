@@ -16,22 +16,31 @@
  * limitations under the License.
  */
 
+#include <string.h> // For memcmp.
+
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 
+#include <leveldb/cache.h>
 #include <leveldb/comparator.h>
 #include <leveldb/db.h>
+#include <leveldb/filter_policy.h>
 #include <leveldb/write_batch.h>
 
 #include <algorithm>
+#include <vector>
 
 #include <process/dispatch.hpp>
 #include <process/protobuf.hpp>
+#include <process/timing.hpp>
 
+#include <stout/crc32c.hpp>
+#include <stout/duration.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
 #include <stout/numify.hpp>
+#include <stout/option.hpp>
 #include <stout/stopwatch.hpp>
 #include <stout/utils.hpp>
 
@@ -59,10 +68,37 @@ namespace protocol {
 Protocol<PromiseRequest, PromiseResponse> promise;
 Protocol<WriteRequest, WriteResponse> write;
 Protocol<LearnRequest, LearnResponse> learn;
+Protocol<BulkLearnRequest, BulkLearnResponse> bulklearn;
+Protocol<PingRequest, PingResponse> ping;
 
 } // namespace protocol {
 
 
+// Number of positions covered by the in-memory cache of recently
+// learned actions in each replica (see ReplicaProcess::cache).
+const size_t ACTION_CACHE_SIZE = 1024;
+
+
+// Returns true if the action's append payload matches its checksum
+// (trivially true when there is no append or the coordinator did not
+// attach a checksum). Checked before anything reaches disk so that a
+// payload corrupted in transit does not get persisted; at-rest
+// integrity is already covered by leveldb's block checksums.
+static bool verify(const Action& action)
+{
+  if (!action.has_append() || !action.append().has_cksum()) {
+    return true;
+  }
+
+  const Action::Append& append = action.append();
+
+  uint32_t crc = crc32c::checksum(append.bytes());
+
+  return append.cksum().size() == sizeof(crc) &&
+    memcmp(append.cksum().data(), &crc, sizeof(crc)) == 0;
+}
+
+
 struct State
 {
   uint64_t coordinator; // Last promise made to a coordinator.
@@ -81,23 +117,55 @@ public:
   virtual Try<State> recover(const string& path) = 0;
   virtual Try<Nothing> persist(const Promise& promise) = 0;
   virtual Try<Nothing> persist(const Action& action) = 0;
+  virtual Try<Nothing> persist(const std::list<Action>& actions) = 0;
+  virtual Try<Nothing> persist(const Snapshot& snapshot) = 0;
   virtual Try<Action> read(uint64_t position) = 0;
+  virtual Try<std::list<Action> > read(uint64_t from, uint64_t to) = 0;
+  virtual Try<Option<Snapshot> > snapshot() = 0;
 };
 
 
+// In group-sync mode (see StorageOptions), how many actions may be
+// written and how much time may pass before a sync barrier is issued.
+const size_t GROUP_SYNC_LIMIT = 64;
+const Duration GROUP_SYNC_WINDOW = Milliseconds(100.0);
+
+
+// Key under which a snapshot record is stored. Note that '!' sorts
+// before the (numeric) keys used for promise and action records so
+// that seeks and iterations over positions never encounter it.
+const char SNAPSHOT_KEY[] = "!snapshot";
+
+// Key under which the replica metadata record (promised, begin, end)
+// is stored; like the snapshot key it sorts before all positions.
+// The metadata is updated transactionally with every write so that
+// recovery can read it from this single key rather than discovering
+// the same state by iterating the entire database.
+const char METADATA_KEY[] = "!metadata";
+
+
 // Concrete implementation of the storage interface using leveldb.
 class LevelDBStorage : public Storage
 {
 public:
-  LevelDBStorage();
+  LevelDBStorage(const StorageOptions& tuning);
   virtual ~LevelDBStorage();
 
   virtual Try<State> recover(const string& path);
   virtual Try<Nothing> persist(const Promise& promise);
   virtual Try<Nothing> persist(const Action& action);
+  virtual Try<Nothing> persist(const std::list<Action>& actions);
+  virtual Try<Nothing> persist(const Snapshot& snapshot);
   virtual Try<Action> read(uint64_t position);
+  virtual Try<std::list<Action> > read(uint64_t from, uint64_t to);
+  virtual Try<Option<Snapshot> > snapshot();
 
 private:
+  // Serializes the current metadata (see below) into a put on the
+  // given write batch, so that it gets committed transactionally
+  // with the write it accompanies.
+  Try<Nothing> persistMetadata(leveldb::WriteBatch* batch);
+
   class Varint64Comparator : public leveldb::Comparator
   {
   public:
@@ -175,22 +243,43 @@ private:
 
   // Varint64Comparator comparator; // TODO(benh): Use varint comparator.
 
+  const StorageOptions tuning; // Requested leveldb tuning.
+
   leveldb::DB* db;
 
+  leveldb::Cache* cache; // Block cache (NULL unless tuned).
+  const leveldb::FilterPolicy* filter; // Bloom filter (NULL unless tuned).
+
   uint64_t first; // First position still in leveldb, used during truncation.
+
+  size_t unsynced; // Actions written since the last sync barrier.
+  Stopwatch sinceSync; // Time since the last sync barrier.
+
+  // Durable replica metadata (see Record::Metadata), mirrored here
+  // and written transactionally with every write.
+  Metadata metadata;
 };
 
 
-LevelDBStorage::LevelDBStorage()
-  : db(NULL), first(0)
+LevelDBStorage::LevelDBStorage(const StorageOptions& _tuning)
+  : tuning(_tuning), db(NULL), cache(NULL), filter(NULL), first(0), unsynced(0)
 {
-  // Nothing to see here.
+  sinceSync.start();
+
+  metadata.set_promised(0);
+  metadata.set_begin(0);
+  metadata.set_end(0);
 }
 
 
 LevelDBStorage::~LevelDBStorage()
 {
   delete db; // Might be null if open failed in LevelDBStorage::recover.
+
+  // NOTE: leveldb does not take ownership of these, and they must
+  // outlive the db, hence deleting them after it.
+  delete cache;
+  delete filter;
 }
 
 
@@ -199,6 +288,20 @@ Try<State> LevelDBStorage::recover(const string& path)
   leveldb::Options options;
   options.create_if_missing = true;
 
+  if (tuning.writeBufferSize > 0) {
+    options.write_buffer_size = tuning.writeBufferSize;
+  }
+
+  if (tuning.blockCacheSize > 0) {
+    cache = leveldb::NewLRUCache(tuning.blockCacheSize);
+    options.block_cache = cache;
+  }
+
+  if (tuning.bloomBits > 0) {
+    filter = leveldb::NewBloomFilterPolicy(tuning.bloomBits);
+    options.filter_policy = filter;
+  }
+
   // TODO(benh): Can't use varint comparator until bug discussed at
   // groups.google.com/group/leveldb/browse_thread/thread/17eac39168909ba7
   // gets fixed. For now, we are using the default byte-wise
@@ -228,18 +331,54 @@ Try<State> LevelDBStorage::recover(const string& path)
 
   LOG(INFO) << "Opened db in " << stopwatch.elapsed();
 
-  stopwatch.start(); // Restart the stopwatch.
-
-  // TODO(benh): Conditionally compact to avoid long recovery times?
-  db->CompactRange(NULL, NULL);
-
-  LOG(INFO) << "Compacted db in " << stopwatch.elapsed();
-
   State state;
   state.coordinator = 0;
   state.begin = 0;
   state.end = 0;
 
+  // If a metadata record exists (i.e., the database was written by a
+  // version that keeps one) recover promised/begin/end from that
+  // single key and scan only the retained [begin, end] range of
+  // positions below. Otherwise fall back to iterating the entire
+  // database, including a (potentially long) compaction first.
+  // Replica restart is on the master failover critical path, so in
+  // the metadata case we also skip the eager compaction: leveldb
+  // compacts in the background anyway.
+  bool fast = false;
+
+  string value;
+  leveldb::Status status_ =
+    db->Get(leveldb::ReadOptions(), METADATA_KEY, &value);
+
+  if (status_.ok()) {
+    google::protobuf::io::ArrayInputStream stream(
+        value.data(), value.size());
+
+    Record record;
+
+    if (!record.ParseFromZeroCopyStream(&stream)) {
+      return Error("Failed to deserialize record");
+    } else if (record.type() != Record::METADATA) {
+      return Error("Bad record");
+    }
+
+    CHECK(record.has_metadata());
+    state.coordinator = record.metadata().promised();
+    state.begin = record.metadata().begin();
+    state.end = record.metadata().end();
+    fast = true;
+
+    LOG(INFO) << "Recovered replica metadata with log positions "
+              << state.begin << " -> " << state.end;
+  } else {
+    stopwatch.start(); // Restart the stopwatch.
+
+    // TODO(benh): Conditionally compact to avoid long recovery times?
+    db->CompactRange(NULL, NULL);
+
+    LOG(INFO) << "Compacted db in " << stopwatch.elapsed();
+  }
+
   // TODO(benh): Consider just reading the "promise" record (e.g.,
   // 'encode(0, false)') and then iterating over the rest of the
   // records and confirming that they are all indeed of type
@@ -253,7 +392,15 @@ Try<State> LevelDBStorage::recover(const string& path)
 
   stopwatch.start(); // Restart the stopwatch.
 
-  iterator->SeekToFirst();
+  if (fast) {
+    // Only the retained positions need to be scanned (to rediscover
+    // learned/unlearned positions and holes); this also skips the
+    // promise, snapshot and metadata records, whose keys sort before
+    // all positions.
+    iterator->Seek(encode(state.begin));
+  } else {
+    iterator->SeekToFirst();
+  }
 
   LOG(INFO) << "Seeked to beginning of db in " << stopwatch.elapsed();
 
@@ -298,6 +445,22 @@ Try<State> LevelDBStorage::recover(const string& path)
         break;
       }
 
+      case Record::SNAPSHOT: {
+        CHECK(record.has_snapshot());
+        break; // Snapshots are read on demand, not kept in memory.
+      }
+
+      case Record::METADATA: {
+        // Only encountered on the full-scan path; merge rather than
+        // overwrite since the scan rediscovers the same state.
+        CHECK(record.has_metadata());
+        state.coordinator =
+          std::max(state.coordinator, record.metadata().promised());
+        state.begin = std::max(state.begin, record.metadata().begin());
+        state.end = std::max(state.end, record.metadata().end());
+        break;
+      }
+
       default: {
         return Error("Bad record");
       }
@@ -322,10 +485,35 @@ Try<State> LevelDBStorage::recover(const string& path)
 
   delete iterator;
 
+  // Mirror the recovered state in the metadata written with every
+  // subsequent write (this also installs a metadata record on the
+  // first write to a database that predates them).
+  metadata.set_promised(state.coordinator);
+  metadata.set_begin(state.begin);
+  metadata.set_end(state.end);
+
   return state;
 }
 
 
+Try<Nothing> LevelDBStorage::persistMetadata(leveldb::WriteBatch* batch)
+{
+  Record record;
+  record.set_type(Record::METADATA);
+  record.mutable_metadata()->MergeFrom(metadata);
+
+  string value;
+
+  if (!record.SerializeToString(&value)) {
+    return Error("Failed to serialize record");
+  }
+
+  batch->Put(METADATA_KEY, value);
+
+  return Nothing();
+}
+
+
 Try<Nothing> LevelDBStorage::persist(const Promise& promise)
 {
   Stopwatch stopwatch;
@@ -344,7 +532,17 @@ Try<Nothing> LevelDBStorage::persist(const Promise& promise)
     return Error("Failed to serialize record");
   }
 
-  leveldb::Status status = db->Put(options, encode(0, false), value);
+  metadata.set_promised(promise.id());
+
+  leveldb::WriteBatch batch;
+  batch.Put(encode(0, false), value);
+
+  Try<Nothing> persisted = persistMetadata(&batch);
+  if (persisted.isError()) {
+    return Error(persisted.error());
+  }
+
+  leveldb::Status status = db->Write(options, &batch);
 
   if (!status.ok()) {
     return Error(status.ToString());
@@ -375,7 +573,35 @@ Try<Nothing> LevelDBStorage::persist(const Action& action)
   leveldb::WriteOptions options;
   options.sync = true;
 
-  leveldb::Status status = db->Put(options, encode(action.position()), value);
+  // In group-sync mode only issue a sync barrier once enough actions
+  // have been written (or enough time has passed) since the last one;
+  // the barrier's fsync also flushes leveldb's sequential log up to
+  // and including the unsynced writes before it.
+  if (tuning.groupSync) {
+    if (++unsynced >= GROUP_SYNC_LIMIT ||
+        sinceSync.elapsed() >= GROUP_SYNC_WINDOW) {
+      unsynced = 0;
+      sinceSync.start(); // Restart the barrier window.
+    } else {
+      options.sync = false;
+    }
+  }
+
+  metadata.set_end(std::max(metadata.end(), action.position()));
+  if (action.has_type() && action.type() == Action::TRUNCATE &&
+      action.has_learned() && action.learned()) {
+    metadata.set_begin(std::max(metadata.begin(), action.truncate().to()));
+  }
+
+  leveldb::WriteBatch write;
+  write.Put(encode(action.position()), value);
+
+  Try<Nothing> persisted = persistMetadata(&write);
+  if (persisted.isError()) {
+    return Error(persisted.error());
+  }
+
+  leveldb::Status status = db->Write(options, &write);
 
   if (!status.ok()) {
     return Error(status.ToString());
@@ -439,6 +665,98 @@ Try<Nothing> LevelDBStorage::persist(const Action& action)
 }
 
 
+Try<Nothing> LevelDBStorage::persist(const list<Action>& actions)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  leveldb::WriteBatch batch;
+
+  size_t bytes = 0;
+
+  foreach (const Action& action, actions) {
+    Record record;
+    record.set_type(Record::ACTION);
+    record.mutable_action()->MergeFrom(action);
+
+    string value;
+
+    if (!record.SerializeToString(&value)) {
+      return Error("Failed to serialize record");
+    }
+
+    bytes += value.size();
+
+    batch.Put(encode(action.position()), value);
+
+    metadata.set_end(std::max(metadata.end(), action.position()));
+    if (action.has_type() && action.type() == Action::TRUNCATE &&
+        action.has_learned() && action.learned()) {
+      metadata.set_begin(std::max(metadata.begin(), action.truncate().to()));
+    }
+  }
+
+  Try<Nothing> persisted = persistMetadata(&batch);
+  if (persisted.isError()) {
+    return Error(persisted.error());
+  }
+
+  // A single synchronous write suffices for the entire batch (which
+  // is the point of batching: one fsync amortized over all of the
+  // actions). Note that we don't bother eagerly deleting positions
+  // for any learned truncations in the batch since that is
+  // best-effort anyway (a later truncation will clean them up).
+  leveldb::WriteOptions options;
+  options.sync = true;
+
+  leveldb::Status status = db->Write(options, &batch);
+
+  if (!status.ok()) {
+    return Error(status.ToString());
+  }
+
+  LOG(INFO) << "Persisting " << actions.size() << " actions (" << bytes
+            << " bytes) to leveldb took " << stopwatch.elapsed();
+
+  return Nothing();
+}
+
+
+Try<Nothing> LevelDBStorage::persist(const Snapshot& snapshot)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  Record record;
+  record.set_type(Record::SNAPSHOT);
+  record.mutable_snapshot()->MergeFrom(snapshot);
+
+  string value;
+
+  if (!record.SerializeToString(&value)) {
+    return Error("Failed to serialize record");
+  }
+
+  // A snapshot replaces any previous snapshot, so there is only ever
+  // one snapshot record in the database. Note that we always sync
+  // snapshots (even in group-sync mode) since a snapshot is what
+  // allows a consumer to skip replaying the retained log.
+  leveldb::WriteOptions options;
+  options.sync = true;
+
+  leveldb::Status status = db->Put(options, SNAPSHOT_KEY, value);
+
+  if (!status.ok()) {
+    return Error(status.ToString());
+  }
+
+  LOG(INFO) << "Persisting snapshot (" << value.size()
+            << " bytes) to leveldb took " << stopwatch.elapsed();
+
+  return Nothing();
+}
+
+
 Try<Action> LevelDBStorage::read(uint64_t position)
 {
   Stopwatch stopwatch;
@@ -472,12 +790,94 @@ Try<Action> LevelDBStorage::read(uint64_t position)
 }
 
 
+Try<list<Action> > LevelDBStorage::read(uint64_t from, uint64_t to)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  list<Action> actions;
+
+  // Rather than issuing a point lookup per position we drive a single
+  // iterator across the encoded key range so that a large catch-up
+  // read turns into sequential I/O. Missing positions (i.e., holes)
+  // are simply skipped over by the iterator.
+  leveldb::Iterator* iterator = db->NewIterator(leveldb::ReadOptions());
+
+  iterator->Seek(encode(from));
+
+  while (iterator->Valid() && decode(iterator->key()) <= to) {
+    const leveldb::Slice& slice = iterator->value();
+
+    google::protobuf::io::ArrayInputStream stream(slice.data(), slice.size());
+
+    Record record;
+
+    if (!record.ParseFromZeroCopyStream(&stream)) {
+      delete iterator;
+      return Error("Failed to deserialize record");
+    }
+
+    if (record.type() != Record::ACTION) {
+      delete iterator;
+      return Error("Bad record");
+    }
+
+    actions.push_back(record.action());
+
+    iterator->Next();
+  }
+
+  delete iterator;
+
+  LOG(INFO) << "Reading " << actions.size() << " actions in ["
+            << from << ", " << to << "] from leveldb took "
+            << stopwatch.elapsed();
+
+  return actions;
+}
+
+
+Try<Option<Snapshot> > LevelDBStorage::snapshot()
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  leveldb::ReadOptions options;
+
+  string value;
+
+  leveldb::Status status = db->Get(options, SNAPSHOT_KEY, &value);
+
+  if (status.IsNotFound()) {
+    return Option<Snapshot>::none();
+  } else if (!status.ok()) {
+    return Error(status.ToString());
+  }
+
+  google::protobuf::io::ArrayInputStream stream(value.data(), value.size());
+
+  Record record;
+
+  if (!record.ParseFromZeroCopyStream(&stream)) {
+    return Error("Failed to deserialize record");
+  }
+
+  if (record.type() != Record::SNAPSHOT) {
+    return Error("Bad record");
+  }
+
+  LOG(INFO) << "Reading snapshot from leveldb took " << stopwatch.elapsed();
+
+  return Option<Snapshot>::some(record.snapshot());
+}
+
+
 class ReplicaProcess : public ProtobufProcess<ReplicaProcess>
 {
 public:
   // Constructs a new replica process using specified path to a
   // directory for storing the underlying log.
-  ReplicaProcess(const std::string& path);
+  ReplicaProcess(const std::string& path, const StorageOptions& options);
 
   virtual ~ReplicaProcess();
 
@@ -506,6 +906,19 @@ public:
   // Returns the highest implicit promise this replica has given.
   uint64_t promised();
 
+  // Durably installs a compacted snapshot in this replica, replacing
+  // any previous snapshot. Returns true on success.
+  bool install(const Snapshot& snapshot);
+
+  // Returns the most recently installed snapshot, or none if no
+  // snapshot has been installed (or reading it failed).
+  Option<Snapshot> snapshot();
+
+  // Durably applies a batch of learned actions using a single
+  // batched write to the underlying storage. Returns true on
+  // success.
+  bool catchup(const std::list<Action>& actions);
+
 private:
   // Handles a request from a coordinator to promise not to accept
   // writes from any other coordinator.
@@ -518,14 +931,31 @@ private:
   // specified position in the log.
   void learn(uint64_t position);
 
+  // Handles a request to bulk learn a range of positions, replying
+  // with all the learned actions this replica has in the range.
+  void bulklearn(const BulkLearnRequest& request);
+
   // Handles a message notifying of a learned action.
   void learned(const Action& action);
 
+  // Handles a message notifying of a batch of learned actions,
+  // applying the whole batch with a single storage write.
+  void learnedBatch(const LearnedBatchMessage& message);
+
+  // Handles a lightweight health probe from a peer's network layer,
+  // answered immediately (no storage access) so that the round trip
+  // measures only queueing and network latency.
+  void ping(const PingRequest& request);
+
   // Helper routines that write a record corresponding to the
   // specified argument. Returns true on success and false otherwise.
   bool persist(const Promise& promise);
   bool persist(const Action& action);
 
+  // Helper that updates the in-memory bookkeeping (holes, unlearned
+  // positions, begin, end) to reflect a persisted action.
+  void update(const Action& action);
+
   // Helper routine to recover log (e.g., on restart).
   void recover(const std::string& path);
 
@@ -546,15 +976,27 @@ private:
 
   // Unlearned positions in the log.
   std::set<uint64_t> unlearned;
+
+  // Fixed-size ring over the last ACTION_CACHE_SIZE positions,
+  // holding recently learned actions and consulted by read() before
+  // going to storage: the most common reads (a coordinator reading
+  // back what it just wrote, a replica catching up) are for
+  // positions written moments ago. Only learned actions are cached
+  // since they are final; an unlearned action can still be replaced
+  // by a write from a later coordinator. Entries are invalidated
+  // when a truncation is learned.
+  std::vector<Option<Action> > cache;
 };
 
 
-ReplicaProcess::ReplicaProcess(const string& path)
+ReplicaProcess::ReplicaProcess(const string& path, const StorageOptions& options)
   : coordinator(0),
     begin(0),
-    end(0)
+    end(0),
+    cache(ACTION_CACHE_SIZE)
 {
-  storage = new LevelDBStorage(); // TODO(benh): Factor out and expose storage.
+  // TODO(benh): Factor out and expose storage.
+  storage = new LevelDBStorage(options);
 
   recover(path);
 
@@ -569,9 +1011,18 @@ ReplicaProcess::ReplicaProcess(const string& path)
       &ReplicaProcess::learned,
       &LearnedMessage::action);
 
+  install<LearnedBatchMessage>(
+      &ReplicaProcess::learnedBatch);
+
   install<LearnRequest>(
       &ReplicaProcess::learn,
       &LearnRequest::position);
+
+  install<BulkLearnRequest>(
+      &ReplicaProcess::bulklearn);
+
+  install<PingRequest>(
+      &ReplicaProcess::ping);
 }
 
 
@@ -591,6 +1042,13 @@ Result<Action> ReplicaProcess::read(uint64_t position)
     return None();
   }
 
+  // Consult the cache of recently learned actions before going to
+  // storage.
+  const Option<Action>& cached = cache[position % cache.size()];
+  if (cached.isSome() && cached.get().position() == position) {
+    return cached.get();
+  }
+
   // Must exist in storage ...
   Try<Action> action = storage->read(position);
 
@@ -624,21 +1082,19 @@ process::Future<list<Action> > ReplicaProcess::read(
     return promise.future();
   }
 
-  list<Action> actions;
-
-  for (uint64_t position = from; position <= to; position++) {
-    Result<Action> result = read(position);
+  // Stream the entire range out of storage in one go (e.g., via a
+  // single leveldb iterator) rather than doing a point lookup per
+  // position. Positions in the range that have never been written
+  // (i.e., holes) are elided, just as with a per-position read.
+  Try<list<Action> > actions = storage->read(from, to);
 
-    if (result.isError()) {
-      process::Promise<list<Action> > promise;
-      promise.fail(result.error());
-      return promise.future();
-    } else if (result.isSome()) {
-      actions.push_back(result.get());
-    }
+  if (actions.isError()) {
+    process::Promise<list<Action> > promise;
+    promise.fail(actions.error());
+    return promise.future();
   }
 
-  return actions;
+  return actions.get();
 }
 
 
@@ -684,6 +1140,74 @@ uint64_t ReplicaProcess::promised()
 }
 
 
+bool ReplicaProcess::install(const Snapshot& snapshot)
+{
+  // A snapshot only makes sense for positions that have actually
+  // been written to this replica's log.
+  if (end < snapshot.position()) {
+    LOG(ERROR) << "Error installing snapshot at position "
+               << snapshot.position() << " past end of log " << end;
+    return false;
+  }
+
+  Try<Nothing> persisted = storage->persist(snapshot);
+
+  if (persisted.isError()) {
+    LOG(ERROR) << "Error writing snapshot to log: " << persisted.error();
+    return false;
+  }
+
+  LOG(INFO) << "Replica installed snapshot at position "
+            << snapshot.position();
+
+  return true;
+}
+
+
+Option<Snapshot> ReplicaProcess::snapshot()
+{
+  Try<Option<Snapshot> > snapshot = storage->snapshot();
+
+  if (snapshot.isError()) {
+    LOG(ERROR) << "Error reading snapshot from log: " << snapshot.error();
+    return Option<Snapshot>::none();
+  }
+
+  return snapshot.get();
+}
+
+
+bool ReplicaProcess::catchup(const std::list<Action>& actions)
+{
+  // All of the actions must have been learned (e.g., bulk
+  // transferred from a peer that has learned them).
+  foreach (const Action& action, actions) {
+    CHECK(action.has_learned() && action.learned());
+
+    if (!verify(action)) {
+      LOG(ERROR) << "Checksum mismatch on append action at position "
+                 << action.position() << "; refusing to catch up";
+      return false;
+    }
+  }
+
+  Try<Nothing> persisted = storage->persist(actions);
+
+  if (persisted.isError()) {
+    LOG(ERROR) << "Error writing to log: " << persisted.error();
+    return false;
+  }
+
+  LOG(INFO) << "Replica caught up " << actions.size() << " learned actions";
+
+  foreach (const Action& action, actions) {
+    update(action);
+  }
+
+  return true;
+}
+
+
 // Note that certain failures that occur result in returning from the
 // current function but *NOT* sending a 'nack' back to the coordinator
 // because that implies a coordinator has been demoted. Not sending
@@ -804,6 +1328,8 @@ void ReplicaProcess::promise(const PromiseRequest& request)
 
 void ReplicaProcess::write(const WriteRequest& request)
 {
+  TIMED_SCOPE("replica/write");
+
   LOG(INFO) << "Replica received write request for position " << request.position();
 
   Result<Action> result = read(request.position());
@@ -916,6 +1442,50 @@ void ReplicaProcess::learned(const Action& action)
 }
 
 
+void ReplicaProcess::learnedBatch(const LearnedBatchMessage& message)
+{
+  list<Action> actions;
+  foreach (const Action& action, message.actions()) {
+    CHECK(action.has_learned() && action.learned());
+
+    if (!verify(action)) {
+      LOG(ERROR) << "Checksum mismatch on append action at position "
+                 << action.position() << "; ignoring learned batch";
+      return;
+    }
+
+    actions.push_back(action);
+  }
+
+  if (actions.empty()) {
+    return;
+  }
+
+  // Persist the whole batch using a single (batched) storage write
+  // rather than one commit per action.
+  Try<Nothing> persisted = storage->persist(actions);
+
+  if (persisted.isError()) {
+    LOG(ERROR) << "Error writing to log: " << persisted.error();
+    return;
+  }
+
+  LOG(INFO) << "Replica learned batch of " << actions.size() << " actions";
+
+  foreach (const Action& action, actions) {
+    update(action);
+  }
+}
+
+
+void ReplicaProcess::ping(const PingRequest& request)
+{
+  PingResponse response;
+  response.set_id(request.id());
+  reply(response);
+}
+
+
 void ReplicaProcess::learn(uint64_t position)
 {
   LOG(INFO) << "Replica received learn request for position " << position;
@@ -940,6 +1510,43 @@ void ReplicaProcess::learn(uint64_t position)
 }
 
 
+void ReplicaProcess::bulklearn(const BulkLearnRequest& request)
+{
+  LOG(INFO) << "Replica received bulk learn request for ["
+            << request.from() << ", " << request.to() << "]";
+
+  BulkLearnResponse response;
+  response.set_okay(true);
+
+  // Clamp the requested range to what this replica actually has.
+  // Positions in the range that we don't have (or haven't learned)
+  // simply don't appear in the response.
+  uint64_t from = std::max(request.from(), begin);
+  uint64_t to = std::min(request.to(), end);
+
+  if (from <= to) {
+    Try<list<Action> > actions = storage->read(from, to);
+
+    if (actions.isError()) {
+      LOG(ERROR) << "Error getting log records in [" << from << ", "
+                 << to << "]: " << actions.error();
+      response.set_okay(false);
+    } else {
+      // NOTE: Try::get() returns by value, hence the named local.
+      const list<Action>& records = actions.get();
+
+      foreach (const Action& action, records) {
+        if (action.has_learned() && action.learned()) {
+          response.add_actions()->MergeFrom(action);
+        }
+      }
+    }
+  }
+
+  reply(response);
+}
+
+
 bool ReplicaProcess::persist(const Promise& promise)
 {
   Try<Nothing> persisted = storage->persist(promise);
@@ -957,6 +1564,12 @@ bool ReplicaProcess::persist(const Promise& promise)
 
 bool ReplicaProcess::persist(const Action& action)
 {
+  if (!verify(action)) {
+    LOG(ERROR) << "Checksum mismatch on append action at position "
+               << action.position() << "; refusing to persist it";
+    return false;
+  }
+
   Try<Nothing> persisted = storage->persist(action);
 
   if (persisted.isError()) {
@@ -966,12 +1579,24 @@ bool ReplicaProcess::persist(const Action& action)
 
   LOG(INFO) << "Persisted action at " << action.position();
 
+  update(action);
+
+  return true;
+}
+
+
+void ReplicaProcess::update(const Action& action)
+{
   // No longer a hole here (if there even was one).
   holes.erase(action.position());
 
   // Update unlearned positions and deal with truncation actions.
   if (action.has_learned() && action.learned()) {
     unlearned.erase(action.position());
+
+    // Cache the learned action for subsequent reads.
+    cache[action.position() % cache.size()] = action;
+
     if (action.has_type() && action.type() == Action::TRUNCATE) {
       // No longer consider truncated positions as holes (so that a
       // coordinator doesn't try and fill them).
@@ -991,6 +1616,15 @@ bool ReplicaProcess::persist(const Action& action)
 
       // And update the beginning position.
       begin = std::max(begin, action.truncate().to());
+
+      // Invalidate cached actions at truncated positions (reads of
+      // those positions error out before consulting the cache, but
+      // there is no point holding on to the actions).
+      for (size_t i = 0; i < cache.size(); i++) {
+        if (cache[i].isSome() && cache[i].get().position() < begin) {
+          cache[i] = Option<Action>::none();
+        }
+      }
     }
   }
 
@@ -1001,8 +1635,6 @@ bool ReplicaProcess::persist(const Action& action)
 
   // And update the end position.
   end = std::max(end, action.position());
-
-  return true;
 }
 
 
@@ -1043,9 +1675,9 @@ void ReplicaProcess::recover(const string& path)
 }
 
 
-Replica::Replica(const std::string& path)
+Replica::Replica(const std::string& path, const StorageOptions& options)
 {
-  process = new ReplicaProcess(path);
+  process = new ReplicaProcess(path, options);
   process::spawn(process);
 }
 
@@ -1090,6 +1722,24 @@ process::Future<uint64_t> Replica::promised()
 }
 
 
+process::Future<bool> Replica::install(const Snapshot& snapshot)
+{
+  return process::dispatch(process, &ReplicaProcess::install, snapshot);
+}
+
+
+process::Future<Option<Snapshot> > Replica::snapshot()
+{
+  return process::dispatch(process, &ReplicaProcess::snapshot);
+}
+
+
+process::Future<bool> Replica::catchup(const std::list<Action>& actions)
+{
+  return process::dispatch(process, &ReplicaProcess::catchup, actions);
+}
+
+
 process::PID<ReplicaProcess> Replica::pid()
 {
   return process->self();
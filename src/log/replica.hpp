@@ -26,6 +26,7 @@
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 
+#include <stout/option.hpp>
 #include <stout/result.hpp>
 #include <stout/try.hpp>
 
@@ -41,6 +42,8 @@ namespace protocol {
 extern Protocol<PromiseRequest, PromiseResponse> promise;
 extern Protocol<WriteRequest, WriteResponse> write;
 extern Protocol<LearnRequest, LearnResponse> learn;
+extern Protocol<BulkLearnRequest, BulkLearnResponse> bulklearn;
+extern Protocol<PingRequest, PingResponse> ping;
 
 } // namespace protocol {
 
@@ -49,12 +52,51 @@ extern Protocol<LearnRequest, LearnResponse> learn;
 class ReplicaProcess;
 
 
+// Tuning knobs for the leveldb instance backing a replica. The
+// defaults match leveldb's own (default write buffer and block
+// cache, no bloom filters, one synchronous write per persisted
+// record).
+struct StorageOptions
+{
+  StorageOptions()
+    : writeBufferSize(0),
+      blockCacheSize(0),
+      bloomBits(0),
+      groupSync(false) {}
+
+  // Size of the leveldb write buffer (memtable) in bytes. 0 uses the
+  // leveldb default.
+  size_t writeBufferSize;
+
+  // Size of the leveldb block cache in bytes. 0 uses the leveldb
+  // default cache.
+  size_t blockCacheSize;
+
+  // Bits per key for the leveldb bloom filter, which avoids disk
+  // reads for keys not present in an sstable. 0 disables the filter.
+  int bloomBits;
+
+  // When true, persisted actions are written without an immediate
+  // fsync and instead share periodic sync barriers: a later
+  // synchronous write also flushes leveldb's sequential log up to
+  // and including the earlier writes, so all the actions since the
+  // previous barrier share one fsync. This trades the durability of
+  // the last few actions on this replica for considerably cheaper
+  // appends; entries acknowledged to a coordinator remain safe as
+  // long as a quorum of replicas does not crash within the same
+  // barrier window. Promise records are always synced regardless.
+  bool groupSync;
+};
+
+
 class Replica
 {
 public:
   // Constructs a new replica process using specified path to a
   // directory for storing the underlying log.
-  Replica(const std::string& path);
+  Replica(
+      const std::string& path,
+      const StorageOptions& options = StorageOptions());
   ~Replica();
 
   // Returns all the actions between the specified positions, unless
@@ -74,6 +116,22 @@ public:
   // Returns the highest implicit promise this replica has given.
   process::Future<uint64_t> promised();
 
+  // Durably installs a compacted snapshot of everything a consumer
+  // had applied up to (and including) the snapshot's position,
+  // replacing any previous snapshot. Note that a snapshot is local
+  // to this replica (it is not replicated via consensus). Returns
+  // true if the snapshot was installed.
+  process::Future<bool> install(const Snapshot& snapshot);
+
+  // Returns the most recently installed snapshot, or none if no
+  // snapshot has been installed.
+  process::Future<Option<Snapshot> > snapshot();
+
+  // Durably applies a batch of learned actions (e.g., bulk
+  // transferred from peers while catching up) using a single batched
+  // write to the underlying storage. Returns true on success.
+  process::Future<bool> catchup(const std::list<Action>& actions);
+
   // Returns the PID associated with this replica.
   process::PID<ReplicaProcess> pid();
 
@@ -49,11 +49,21 @@ public:
         "logbufsecs",
         "How many seconds to buffer log messages for",
         0);
+
+    add(&Flags::async_log,
+        "async_log",
+        "Buffer INFO and WARNING log writes in memory and\n"
+        "write them from a dedicated thread, so logging in\n"
+        "hot paths never blocks on disk. If the buffer fills\n"
+        "up, lines are dropped (and counted) rather than\n"
+        "blocking. ERROR and FATAL always write synchronously",
+        false);
   }
 
   bool quiet;
   Option<std::string> log_dir;
   int logbufsecs;
+  bool async_log;
 };
 
 } // namespace logging {
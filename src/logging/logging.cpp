@@ -18,6 +18,13 @@
 
 #include <glog/logging.h>
 
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h> // For memcpy.
+#include <time.h>
+
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
@@ -51,6 +58,206 @@ namespace mesos {
 namespace internal {
 namespace logging {
 
+namespace {
+
+// Total log lines dropped across all asynchronous sinks due to
+// buffer overflow (see AsyncLogger below).
+uint64_t droppedLines = 0;
+
+
+// A glog sink that never blocks the logging thread on disk: Write
+// copies the formatted line into a bounded in-memory ring buffer and
+// a dedicated writer thread drains it into the wrapped (file) logger.
+// When the ring is full, lines are dropped and counted rather than
+// blocking; the writer reports the count once it catches up. Flush
+// remains synchronous (it drains the ring and then flushes the
+// wrapped logger), so explicit flushes -- including the ones glog
+// performs while dying on FATAL -- still reach disk.
+class AsyncLogger : public google::base::Logger
+{
+public:
+  explicit AsyncLogger(google::base::Logger* _wrapped)
+    : wrapped(_wrapped),
+      ring(new char[RING_SIZE]),
+      head(0),
+      tail(0),
+      dropped(0),
+      reported(0),
+      flushes(0),
+      flushed(0)
+  {
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&filled, NULL);
+    pthread_cond_init(&emptied, NULL);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, &AsyncLogger::run, this);
+    pthread_detach(thread);
+  }
+
+  // NOTE: Never destroyed (installed for the lifetime of the
+  // process), so there is no thread shutdown to deal with.
+
+  virtual void Write(
+      bool force,
+      time_t timestamp,
+      const char* message,
+      int length)
+  {
+    pthread_mutex_lock(&mutex);
+
+    const size_t needed = sizeof(Header) + length;
+
+    if (RING_SIZE - (size_t) (head - tail) < needed) {
+      // Full: losing the line is the contract; never block the
+      // logging thread.
+      dropped++;
+      __sync_fetch_and_add(&droppedLines, (uint64_t) 1);
+      pthread_mutex_unlock(&mutex);
+      return;
+    }
+
+    Header header;
+    header.timestamp = timestamp;
+    header.length = length;
+    header.force = force;
+
+    put((const char*) &header, sizeof(Header));
+    put(message, length);
+
+    pthread_cond_signal(&filled);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  virtual void Flush()
+  {
+    pthread_mutex_lock(&mutex);
+    flushes++;
+    pthread_cond_signal(&filled);
+    while (head != tail || flushed < flushes) {
+      pthread_cond_wait(&emptied, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+
+  virtual google::uint32 LogSize()
+  {
+    return wrapped->LogSize();
+  }
+
+private:
+  struct Header
+  {
+    time_t timestamp;
+    int length;
+    bool force;
+  };
+
+  static const size_t RING_SIZE = 1024 * 1024;
+
+  // Copies 'length' bytes into the ring at 'head', wrapping around
+  // the end as needed. Requires the mutex and enough free space.
+  void put(const char* data, size_t length)
+  {
+    size_t index = (size_t) (head % RING_SIZE);
+    size_t chunk = std::min(length, RING_SIZE - index);
+    memcpy(ring + index, data, chunk);
+    memcpy(ring, data + chunk, length - chunk);
+    head += length;
+  }
+
+  // Copies 'length' bytes out of the ring at 'tail', as above.
+  void take(char* data, size_t length)
+  {
+    size_t index = (size_t) (tail % RING_SIZE);
+    size_t chunk = std::min(length, RING_SIZE - index);
+    memcpy(data, ring + index, chunk);
+    memcpy(data + chunk, ring, length - chunk);
+    tail += length;
+  }
+
+  static void* run(void* arg)
+  {
+    reinterpret_cast<AsyncLogger*>(arg)->loop();
+    return NULL;
+  }
+
+  void loop()
+  {
+    // Scratch buffer for a single message; glog bounds a log line
+    // well below this.
+    char* scratch = new char[64 * 1024];
+
+    pthread_mutex_lock(&mutex);
+
+    while (true) {
+      while (head == tail && flushed == flushes && dropped == reported) {
+        pthread_cond_wait(&filled, &mutex);
+      }
+
+      if (head != tail) {
+        Header header;
+        take((char*) &header, sizeof(Header));
+        take(scratch, header.length);
+
+        // Write without holding the lock so producers never wait on
+        // the disk.
+        pthread_mutex_unlock(&mutex);
+        wrapped->Write(header.force, header.timestamp, scratch, header.length);
+        pthread_mutex_lock(&mutex);
+        continue;
+      }
+
+      // The ring is drained; report any drops since the last report.
+      if (dropped != reported) {
+        uint64_t count = dropped - reported;
+        reported = dropped;
+        pthread_mutex_unlock(&mutex);
+        char line[128];
+        int length = snprintf(
+            line,
+            sizeof(line),
+            "WARNING: dropped %llu log line(s) (async log buffer overflow)\n",
+            (unsigned long long) count);
+        wrapped->Write(true, time(NULL), line, length);
+        pthread_mutex_lock(&mutex);
+        continue;
+      }
+
+      if (flushed < flushes) {
+        uint64_t target = flushes;
+        pthread_mutex_unlock(&mutex);
+        wrapped->Flush();
+        pthread_mutex_lock(&mutex);
+        flushed = target;
+        pthread_cond_broadcast(&emptied);
+      }
+    }
+  }
+
+  google::base::Logger* wrapped; // Owned by glog; do not delete.
+
+  char* ring;
+
+  // Logical byte positions; only ever advance. head - tail is the
+  // number of buffered bytes.
+  uint64_t head; // Producer.
+  uint64_t tail; // Consumer (writer thread).
+
+  uint64_t dropped;
+  uint64_t reported; // Drops already reported by the writer thread.
+
+  uint64_t flushes; // Flushes requested.
+  uint64_t flushed; // Flushes completed.
+
+  pthread_mutex_t mutex;
+  pthread_cond_t filled;
+  pthread_cond_t emptied;
+};
+
+} // namespace {
+
+
 class LoggingProcess : public Process<LoggingProcess>
 {
 public:
@@ -176,6 +383,18 @@ void initialize(const string& _argv0, const Flags& flags)
 
   google::InitGoogleLogging(argv0.c_str());
 
+  if (flags.async_log) {
+    // Wrap the INFO and WARNING sinks (the high volume ones); ERROR
+    // and FATAL stay synchronous so crash diagnostics cannot get
+    // stranded in the buffer.
+    google::base::SetLogger(
+        google::INFO,
+        new AsyncLogger(google::base::GetLogger(google::INFO)));
+    google::base::SetLogger(
+        google::WARNING,
+        new AsyncLogger(google::base::GetLogger(google::WARNING)));
+  }
+
   VLOG(1) << "Logging to " <<
     (flags.log_dir.isSome() ? flags.log_dir.get() : "STDERR");
 
@@ -187,6 +406,12 @@ void initialize(const string& _argv0, const Flags& flags)
 }
 
 
+uint64_t dropped()
+{
+  return __sync_fetch_and_add(&droppedLines, (uint64_t) 0);
+}
+
+
 Try<string> getLogFile(google::LogSeverity severity)
 {
   if (FLAGS_log_dir.empty()) {
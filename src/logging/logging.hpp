@@ -19,6 +19,8 @@
 #ifndef __LOGGING_LOGGING_HPP__
 #define __LOGGING_LOGGING_HPP__
 
+#include <stdint.h>
+
 #include <string>
 
 #include <glog/logging.h> // Includes LOG(*), PLOG(*), CHECK, etc.
@@ -36,6 +38,12 @@ namespace logging {
 void initialize(const std::string& argv0, const Flags& flags);
 
 
+// Returns the total number of log lines dropped due to buffer
+// overflow in the asynchronous logging sink (see the --async_log
+// flag); always 0 when asynchronous logging is not enabled.
+uint64_t dropped();
+
+
 // Returns the log file for the provided severity level.
 // LogSeverity is one of {INFO, WARNING, ERROR}.
 Try<std::string> getLogFile(google::LogSeverity severity);
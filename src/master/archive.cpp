@@ -0,0 +1,132 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <leveldb/db.h>
+
+#include <string>
+#include <vector>
+
+#include <stout/error.hpp>
+#include <stout/none.hpp>
+#include <stout/option.hpp>
+
+#include "logging/logging.hpp"
+
+#include "master/archive.hpp"
+
+using namespace process;
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+ArchiveProcess::ArchiveProcess(const string& _path)
+  : path(_path), db(NULL) {}
+
+
+ArchiveProcess::~ArchiveProcess()
+{
+  delete db; // Might be null if open failed in ArchiveProcess::initialize.
+}
+
+
+void ArchiveProcess::initialize()
+{
+  leveldb::Options options;
+  options.create_if_missing = true;
+
+  leveldb::Status status = leveldb::DB::Open(options, path, &db);
+
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to open framework archive at '" << path
+               << "': " << status.ToString();
+    error = Option<string>::some(status.ToString());
+  }
+}
+
+
+Future<bool> ArchiveProcess::archive(
+    const string& frameworkId,
+    const string& record)
+{
+  if (error.isSome()) {
+    return Future<bool>::failed(error.get());
+  }
+
+  // Archival is best effort history; no need to sync each write.
+  leveldb::WriteOptions options;
+
+  leveldb::Status status = db->Put(options, frameworkId, record);
+
+  if (!status.ok()) {
+    return Future<bool>::failed(status.ToString());
+  }
+
+  return true;
+}
+
+
+Future<Option<string> > ArchiveProcess::fetch(const string& frameworkId)
+{
+  if (error.isSome()) {
+    return Future<Option<string> >::failed(error.get());
+  }
+
+  string record;
+
+  leveldb::Status status =
+    db->Get(leveldb::ReadOptions(), frameworkId, &record);
+
+  if (status.IsNotFound()) {
+    return None();
+  } else if (!status.ok()) {
+    return Future<Option<string> >::failed(status.ToString());
+  }
+
+  return Option<string>::some(record);
+}
+
+
+Future<vector<string> > ArchiveProcess::names()
+{
+  if (error.isSome()) {
+    return Future<vector<string> >::failed(error.get());
+  }
+
+  vector<string> results;
+
+  leveldb::Iterator* iterator = db->NewIterator(leveldb::ReadOptions());
+
+  iterator->SeekToFirst();
+
+  while (iterator->Valid()) {
+    results.push_back(iterator->key().ToString());
+    iterator->Next();
+  }
+
+  delete iterator;
+
+  return results;
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
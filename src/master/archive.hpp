@@ -0,0 +1,124 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MASTER_ARCHIVE_HPP__
+#define __MASTER_ARCHIVE_HPP__
+
+#include <string>
+#include <vector>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/process.hpp>
+
+#include <stout/option.hpp>
+
+// Forward declarations.
+namespace leveldb { class DB; }
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Spills records of completed frameworks (and their completed tasks)
+// out of the master's heap into a local leveldb instance, so that
+// history can be retained beyond the in-memory circular buffers
+// without growing master resident memory. Records are the rendered
+// JSON framework fragments also served by '/master/state.json',
+// keyed by framework id, and can be queried back through the
+// master's '/master/archive.json' endpoint.
+class ArchiveProcess : public process::Process<ArchiveProcess>
+{
+public:
+  ArchiveProcess(const std::string& path);
+  virtual ~ArchiveProcess();
+
+  virtual void initialize();
+
+  // Stores the serialized record for the framework, replacing any
+  // previous record (e.g., from an earlier registration).
+  process::Future<bool> archive(
+      const std::string& frameworkId,
+      const std::string& record);
+
+  // Returns the stored record for the framework, if any.
+  process::Future<Option<std::string> > fetch(
+      const std::string& frameworkId);
+
+  // Returns the ids of all archived frameworks.
+  process::Future<std::vector<std::string> > names();
+
+private:
+  const std::string path;
+  leveldb::DB* db;
+
+  Option<std::string> error;
+};
+
+
+// Wrapper around ArchiveProcess, following the Allocator pattern:
+// the process is spawned by the constructor and terminated by the
+// destructor.
+class Archive
+{
+public:
+  Archive(const std::string& path)
+  {
+    process = new ArchiveProcess(path);
+    process::spawn(process);
+  }
+
+  ~Archive()
+  {
+    process::terminate(process);
+    process::wait(process);
+    delete process;
+  }
+
+  process::Future<bool> archive(
+      const std::string& frameworkId,
+      const std::string& record)
+  {
+    return process::dispatch(
+        process, &ArchiveProcess::archive, frameworkId, record);
+  }
+
+  process::Future<Option<std::string> > fetch(
+      const std::string& frameworkId)
+  {
+    return process::dispatch(process, &ArchiveProcess::fetch, frameworkId);
+  }
+
+  process::Future<std::vector<std::string> > names()
+  {
+    return process::dispatch(process, &ArchiveProcess::names);
+  }
+
+private:
+  Archive(const Archive&); // Not copyable.
+  Archive& operator=(const Archive&); // Not assignable.
+
+  ArchiveProcess* process;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_ARCHIVE_HPP__
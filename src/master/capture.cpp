@@ -0,0 +1,175 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <utility>
+
+#include <process/clock.hpp>
+
+#include <stout/error.hpp>
+#include <stout/os.hpp>
+
+#include "common/records.hpp"
+
+#include "master/capture.hpp"
+
+using std::pair;
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace master {
+namespace capture {
+
+Try<Recorder*> Recorder::open(const string& path)
+{
+  Try<int> fd = os::open(
+      path,
+      O_CREAT | O_WRONLY | O_TRUNC,
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  if (fd.isError()) {
+    return Error("Failed to open '" + path + "': " + fd.error());
+  }
+
+  Try<Nothing> header = records::header(fd.get());
+  if (header.isError()) {
+    os::close(fd.get());
+    return Error("Failed to write stream header: " + header.error());
+  }
+
+  return new Recorder(fd.get());
+}
+
+
+Recorder::Recorder(int _fd) : fd(_fd) {}
+
+
+Recorder::~Recorder()
+{
+  records::footer(fd); // Best effort; replay stops at the valid tail.
+  os::close(fd);
+}
+
+
+Try<Nothing> Recorder::record(const process::Message& message)
+{
+  uint64_t micros = (uint64_t) (process::Clock::now() * 1000000.0);
+
+  const string from = stringify(message.from);
+  uint32_t fromLength = from.size();
+  uint32_t nameLength = message.name.size();
+
+  string payload;
+  payload.reserve(
+      sizeof(micros) + sizeof(fromLength) + from.size() +
+      sizeof(nameLength) + message.name.size() + message.body.size());
+
+  payload.append((const char*) &micros, sizeof(micros));
+  payload.append((const char*) &fromLength, sizeof(fromLength));
+  payload.append(from);
+  payload.append((const char*) &nameLength, sizeof(nameLength));
+  payload.append(message.name);
+  payload.append(message.body);
+
+  return records::write(fd, payload);
+}
+
+
+Try<Reader*> Reader::open(const string& path)
+{
+  Try<records::Reader*> reader = records::Reader::open(path);
+  if (reader.isError()) {
+    return Error(reader.error());
+  }
+
+  return new Reader(reader.get());
+}
+
+
+Reader::Reader(records::Reader* _reader) : reader(_reader) {}
+
+
+Reader::~Reader()
+{
+  delete reader;
+}
+
+
+Result<Captured> Reader::read()
+{
+  Result<pair<const char*, uint32_t> > record = reader->next();
+
+  if (record.isError()) {
+    return Error(record.error());
+  } else if (record.isNone()) {
+    return None();
+  }
+
+  const char* data = record.get().first;
+  uint32_t remaining = record.get().second;
+
+  uint64_t micros;
+  uint32_t fromLength;
+  uint32_t nameLength;
+
+  if (remaining < sizeof(micros) + sizeof(fromLength)) {
+    return Error("Malformed capture record (truncated timestamp)");
+  }
+
+  ::memcpy(&micros, data, sizeof(micros));
+  data += sizeof(micros);
+  remaining -= sizeof(micros);
+
+  ::memcpy(&fromLength, data, sizeof(fromLength));
+  data += sizeof(fromLength);
+  remaining -= sizeof(fromLength);
+
+  if (remaining < fromLength + sizeof(nameLength)) {
+    return Error("Malformed capture record (truncated sender)");
+  }
+
+  const string from(data, fromLength);
+  data += fromLength;
+  remaining -= fromLength;
+
+  ::memcpy(&nameLength, data, sizeof(nameLength));
+  data += sizeof(nameLength);
+  remaining -= sizeof(nameLength);
+
+  if (remaining < nameLength) {
+    return Error("Malformed capture record (truncated name)");
+  }
+
+  Captured captured;
+  captured.secs = micros / 1000000.0;
+  captured.from = process::UPID(from);
+  captured.name = string(data, nameLength);
+  captured.body = string(data + nameLength, remaining - nameLength);
+
+  return captured;
+}
+
+} // namespace capture {
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,133 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MASTER_CAPTURE_HPP__
+#define __MASTER_CAPTURE_HPP__
+
+#include <string>
+
+#include <process/message.hpp>
+#include <process/pid.hpp>
+
+#include <stout/nothing.hpp>
+#include <stout/result.hpp>
+#include <stout/try.hpp>
+
+// Forward declaration.
+namespace mesos {
+namespace internal {
+namespace records {
+
+class Reader;
+
+} // namespace records {
+} // namespace internal {
+} // namespace mesos {
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+namespace capture {
+
+// Record-and-replay of the master's inbound message stream. A master
+// started with --capture appends every message it is delivered to a
+// capture file (the framed stream format from common/records.hpp),
+// and the mesos-replay-benchmark driver feeds a capture back into a
+// standalone master at the original or an accelerated cadence, so
+// that allocator and sorter changes can be profiled and compared
+// against real workloads that cannot be reproduced in a lab.
+//
+// Each record's payload is, in native byte order:
+//
+//   micros(uint64) fromLength(uint32) from nameLength(uint32) name body
+//
+// where 'micros' is the arrival time in microseconds since the
+// epoch, 'from' is the stringified sender pid (so that replay can
+// spoof it, since handlers key state on the sender), 'name' is the
+// message (protobuf type) name, and 'body' is the serialized message
+// and runs to the end of the record.
+
+
+// Appends inbound messages to a capture file. Writing a record costs
+// one write(2) (see common/records.hpp), cheap enough to leave on
+// while a production master is being observed.
+class Recorder
+{
+public:
+  // Creates (or truncates) the capture file at 'path' and writes the
+  // stream header.
+  static Try<Recorder*> open(const std::string& path);
+
+  // Appends a clean-close footer and closes the file.
+  ~Recorder();
+
+  // Appends a record of the message, timestamped with the current
+  // time.
+  Try<Nothing> record(const process::Message& message);
+
+private:
+  explicit Recorder(int _fd);
+
+  // No copying, no assigning.
+  Recorder(const Recorder&);
+  Recorder& operator = (const Recorder&);
+
+  const int fd;
+};
+
+
+// A captured message, as recorded above.
+struct Captured
+{
+  double secs; // Arrival time, in seconds since the epoch.
+  process::UPID from;
+  std::string name;
+  std::string body;
+};
+
+
+// Reads a capture file back in arrival order.
+class Reader
+{
+public:
+  // Maps the capture file at 'path' (see records::Reader).
+  static Try<Reader*> open(const std::string& path);
+
+  ~Reader();
+
+  // Returns the next captured message, None at the end of the valid
+  // data, or an error for a torn or malformed tail.
+  Result<Captured> read();
+
+private:
+  explicit Reader(records::Reader* _reader);
+
+  // No copying, no assigning.
+  Reader(const Reader&);
+  Reader& operator = (const Reader&);
+
+  records::Reader* reader;
+};
+
+} // namespace capture {
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_CAPTURE_HPP__
@@ -34,6 +34,16 @@ const uint32_t MAX_SLAVE_PING_TIMEOUTS = 5;
 const uint32_t MAX_COMPLETED_FRAMEWORKS = 50;
 const uint32_t MAX_COMPLETED_TASKS_PER_FRAMEWORK = 1000;
 const Duration WHITELIST_WATCH_INTERVAL = Seconds(5.0);
+const Duration STATUS_UPDATE_BATCH_WAIT = Milliseconds(10.0);
+const uint32_t TEARDOWN_TASKS_PER_CHUNK = 1000;
+const uint32_t MAX_POOLED_OFFERS = 10000;
+const Duration METRICS_PUBLISH_INTERVAL = Seconds(10.0);
+const uint32_t MAX_REREGISTERING_SLAVES = 32;
+const uint32_t MAX_JOURNALED_EVENTS = 10000;
+const Duration EVENT_POLL_TIMEOUT = Seconds(30.0);
+const Duration MIRROR_RETRY_INTERVAL = Seconds(2.0);
+const Duration REGISTRY_WRITE_TIMEOUT = Seconds(10.0);
+const uint32_t REGISTRY_OPERATIONS_PER_SNAPSHOT = 1000;
 
 } // namespace mesos {
 } // namespace internal {
@@ -68,6 +68,50 @@ extern const uint32_t MAX_COMPLETED_TASKS_PER_FRAMEWORK;
 // Time interval to check for updated watchers list.
 extern const Duration WHITELIST_WATCH_INTERVAL;
 
+// Amount of time to wait collecting status updates destined for the
+// same scheduler before forwarding them in one batched message.
+extern const Duration STATUS_UPDATE_BATCH_WAIT;
+
+// Maximum number of tasks removed per event-loop iteration when
+// tearing down a framework (see Master::_removeFramework), bounding
+// how long a large framework's removal can stall other events.
+extern const uint32_t TEARDOWN_TASKS_PER_CHUNK;
+
+// Maximum number of Offer protobufs kept around for reuse in the
+// master's offer pool (see Master::releaseOffer).
+extern const uint32_t MAX_POOLED_OFFERS;
+
+// Interval at which the master samples its gauges and publishes its
+// metrics registry into the statistics time series (see
+// common/metrics.hpp).
+extern const Duration METRICS_PUBLISH_INTERVAL;
+
+// Maximum number of slave re-registrations to admit concurrently
+// after a master failover. Slaves beyond the window simply retry
+// (see Master::reregisterSlave).
+extern const uint32_t MAX_REREGISTERING_SLAVES;
+
+// Maximum number of deltas retained in the event journal backing
+// '/master/events.json' (see Master::journal). A client that falls
+// further behind must resynchronize from '/master/state.json'.
+extern const uint32_t MAX_JOURNALED_EVENTS;
+
+// How long '/master/events.json' holds an up-to-date long poll open
+// waiting for the next delta before returning an empty one.
+extern const Duration EVENT_POLL_TIMEOUT;
+
+// How long a standby backs off before restarting its mirror of the
+// leader's rendered state after a failed fetch (see Master::mirror).
+extern const Duration MIRROR_RETRY_INTERVAL;
+
+// Timeout for each operation against the registry's replicated log
+// (electing the writer, appending a batch, truncating).
+extern const Duration REGISTRY_WRITE_TIMEOUT;
+
+// Number of operations journaled to the registry log before it is
+// compacted with a full Registry snapshot (see Registrar).
+extern const uint32_t REGISTRY_OPERATIONS_PER_SNAPSHOT;
+
 } // namespace mesos {
 } // namespace internal {
 } // namespace master {
@@ -43,7 +43,7 @@ bool DRFComparator::operator () (
 void DRFSorter::add(const string& name)
 {
   Client client;
-  client.name = name;
+  client.name = Atom(name);
   client.share = 0;
   clients.insert(client);
 
@@ -68,7 +68,7 @@ void DRFSorter::activate(const string& name)
   CHECK(allocations.contains(name));
 
   Client client;
-  client.name = name;
+  client.name = Atom(name);
   client.share = calculateShare(name);
   clients.insert(client);
 }
@@ -121,6 +121,7 @@ void DRFSorter::unallocated(
 void DRFSorter::add(const Resources& _resources)
 {
   resources += _resources;
+  retotal();
 
   // We have to recalculate all shares when the total resources
   // change, but we put it off until sort is called
@@ -133,6 +134,7 @@ void DRFSorter::add(const Resources& _resources)
 void DRFSorter::remove(const Resources& _resources)
 {
   resources -= _resources;
+  retotal();
   dirty = true;
 }
 
@@ -182,12 +184,24 @@ void DRFSorter::update(const string& name)
   clients.erase(it);
 
   Client client;
-  client.name = name;
+  client.name = Atom(name);
   client.share = calculateShare(name);
   clients.insert(client);
 }
 
 
+void DRFSorter::retotal()
+{
+  totals.clear();
+
+  foreach (const Resource& resource, resources) {
+    if (resource.type() == Value::SCALAR) {
+      totals[resource.name()] = resource.scalar().value();
+    }
+  }
+}
+
+
 double DRFSorter::calculateShare(const string& name)
 {
   double share = 0;
@@ -196,19 +210,20 @@ double DRFSorter::calculateShare(const string& name)
   // currently does not take into account resources that are not
   // scalars.
 
-  foreach (const Resource& resource, resources) {
+  // Iterate over the client's allocation (typically a handful of
+  // resource types) and read the pool totals from the cache, rather
+  // than scanning the whole pool and doing a Resources::get (string
+  // lookup) per type: a resource type the client has none of can't
+  // contribute to its dominant share anyway.
+  foreach (const Resource& resource, allocations[name]) {
     if (resource.type() == Value::SCALAR) {
-      double total = resource.scalar().value();
+      Option<double> total = totals.get(resource.name());
 
-    if (total > 0) {
-      Value::Scalar none;
-      const Value::Scalar& scalar =
-        allocations[name].get(resource.name(), none);
-
-      share = std::max(share, scalar.value() / total);
+      if (total.isSome() && total.get() > 0) {
+        share = std::max(share, resource.scalar().value() / total.get());
+      }
     }
   }
-}
 
   return share;
 }
@@ -216,9 +231,12 @@ double DRFSorter::calculateShare(const string& name)
 
 set<Client, DRFComparator>::iterator DRFSorter::find(const string& name)
 {
+  // Intern once so the scan compares pointers, not characters.
+  Atom atom(name);
+
   set<Client, DRFComparator>::iterator it;
   for (it = clients.begin(); it != clients.end(); it++) {
-    if (name == (*it).name) {
+    if (atom == (*it).name) {
       break;
     }
   }
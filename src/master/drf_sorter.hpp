@@ -24,6 +24,7 @@
 
 #include <stout/hashmap.hpp>
 
+#include "common/atoms.hpp"
 #include "common/resources.hpp"
 
 #include "master/sorter.hpp"
@@ -33,9 +34,12 @@ namespace mesos {
 namespace internal {
 namespace master {
 
+// The name is interned so that looking a client up in the ordered
+// set compares pointers instead of characters (see find() and the
+// tie break in DRFComparator).
 struct Client
 {
-  std::string name;
+  Atom name;
   double share;
 };
 
@@ -90,6 +94,10 @@ private:
   // Returns the dominant resource share for the client.
   double calculateShare(const std::string& name);
 
+  // Rebuilds the cached per resource-type scalar totals (see
+  // 'totals' below).
+  void retotal();
+
   // Returns an iterator to the specified client, if
   // it exists in this Sorter.
   std::set<Client, DRFComparator>::iterator find(const std::string& name);
@@ -105,6 +113,11 @@ private:
 
   // Total resources.
   Resources resources;
+
+  // Scalar totals per resource type, rebuilt whenever the pool
+  // changes (rare) so calculateShare (run on every allocation
+  // change) never rescans the pool protobufs.
+  hashmap<std::string, double> totals;
 };
 
 } // namespace master {
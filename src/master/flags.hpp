@@ -80,10 +80,82 @@ public:
         " (batch) allocations (e.g., 500ms, 1sec, etc)",
         Seconds(1.0));
 
+    add(&Flags::allocator_shards,
+        "allocator_shards",
+        "Number of allocator shards to partition\n"
+        "the slaves across. Each shard performs its\n"
+        "allocations on its own libprocess process,\n"
+        "so shards can run in parallel on multiple\n"
+        "cores (see master/sharded_allocator_process.hpp)",
+        1);
+
+    add(&Flags::offer_timeout,
+        "offer_timeout",
+        "Time to wait for a framework to answer an offer\n"
+        "before rescinding it and returning the resources\n"
+        "to the allocator (e.g., 30secs, 5mins, etc), so a\n"
+        "slow or wedged scheduler cannot hold capacity\n"
+        "hostage indefinitely. Frameworks can override\n"
+        "this via FrameworkInfo.offer_timeout.\n"
+        "(0 means offers never time out)",
+        Seconds(0.0));
+
+    add(&Flags::archive_dir,
+        "archive_dir",
+        "Directory for archiving completed framework\n"
+        "and task records to a local leveldb instance,\n"
+        "queryable via '/master/archive.json'. If unset\n"
+        "history is only retained in the in-memory\n"
+        "circular buffers");
+
+    add(&Flags::capture,
+        "capture",
+        "Path of a file to append a record of every\n"
+        "inbound message (type, payload, sender and\n"
+        "arrival time) to, for offline replay and\n"
+        "profiling with mesos-replay-benchmark\n"
+        "(see master/capture.hpp for the format)");
+
     add(&Flags::cluster,
         "cluster",
         "Human readable name for the cluster,\n"
         "displayed in the webui");
+
+    add(&Flags::registry,
+        "registry",
+        "Directory for this master's replica of the\n"
+        "replicated log holding the registry of\n"
+        "cluster membership (see master/registrar.hpp).\n"
+        "If unset the registry is disabled and a newly\n"
+        "elected master rebuilds all membership from\n"
+        "re-registrations");
+
+    add(&Flags::registry_quorum,
+        "registry_quorum",
+        "Number of replicas that must accept a\n"
+        "registry write before it is considered\n"
+        "durable; should be a strict majority of\n"
+        "the masters. Replicas discover each other\n"
+        "via the ZooKeeper URL given with --zk",
+        1);
+
+    add(&Flags::framework_rate_limit,
+        "framework_rate_limit",
+        "Sustained rate (messages/second) of resource\n"
+        "request and offer revival messages allowed\n"
+        "from each framework; messages beyond the\n"
+        "limit are dropped so one misbehaving\n"
+        "scheduler cannot starve the rest.\n"
+        "0 disables rate limiting",
+        0.0);
+
+    add(&Flags::framework_rate_limit_burst,
+        "framework_rate_limit_burst",
+        "Number of messages a framework may burst\n"
+        "above the sustained rate (the token bucket\n"
+        "capacity); only meaningful when\n"
+        "framework_rate_limit is set",
+        100.0);
   }
 
   bool root_submissions;
@@ -93,7 +165,15 @@ public:
   std::string user_sorter;
   std::string framework_sorter;
   Duration allocation_interval;
+  int allocator_shards;
+  Duration offer_timeout;
+  Option<std::string> archive_dir;
+  Option<std::string> capture;
   Option<std::string> cluster;
+  Option<std::string> registry;
+  int registry_quorum;
+  double framework_rate_limit;
+  double framework_rate_limit_burst;
 };
 
 } // namespace mesos {
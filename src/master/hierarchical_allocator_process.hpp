@@ -19,14 +19,20 @@
 #ifndef __HIERARCHICAL_ALLOCATOR_PROCESS_HPP__
 #define __HIERARCHICAL_ALLOCATOR_PROCESS_HPP__
 
+#include <map>
+#include <vector>
+
 #include <process/delay.hpp>
 #include <process/id.hpp>
 #include <process/timeout.hpp>
+#include <process/timing.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 
+#include "common/attributes.hpp"
 #include "common/resources.hpp"
 
 #include "master/allocator.hpp"
@@ -39,6 +45,7 @@ namespace master {
 
 // Forward declarations.
 class DRFSorter;
+class IncrementalDRFSorter;
 class Filter;
 
 
@@ -50,6 +57,10 @@ class HierarchicalAllocatorProcess;
 typedef HierarchicalAllocatorProcess<DRFSorter, DRFSorter>
 HierarchicalDRFAllocatorProcess;
 
+typedef HierarchicalAllocatorProcess<IncrementalDRFSorter,
+                                     IncrementalDRFSorter>
+HierarchicalIncrementalDRFAllocatorProcess;
+
 
 // Implements the basic allocator algorithm - first pick a user by
 // some criteria, then pick one of their frameworks to allocate to.
@@ -119,6 +130,16 @@ protected:
   // Callback for doing batch allocations.
   void batch();
 
+  // Schedules an event-driven allocation for the specified slave.
+  // Triggers that arrive before the dispatched flush() runs are
+  // coalesced into a single allocation pass, so a burst of recovered
+  // resources (e.g., a framework finishing a batch of tasks) results
+  // in one pass rather than one per event.
+  void trigger(const SlaveID& slaveId);
+
+  // Performs an allocation for the slaves collected by trigger().
+  void flush();
+
   // Allocate any allocatable resources.
   void allocate();
 
@@ -129,7 +150,32 @@ protected:
   void allocate(const hashset<SlaveID>& slaveIds);
 
   // Remove a filter for the specified framework.
-  void expire(const FrameworkID& frameworkId, Filter* filter);
+  void expire(
+      const FrameworkID& frameworkId,
+      const SlaveID& slaveId,
+      Filter* filter);
+
+  // Expires all the filters in the specified bucket. Filters are
+  // bucketed by their expiration second so that a burst of declines
+  // schedules one delayed expiry per second rather than one per
+  // filter.
+  void expireBucket(int64_t bucket);
+
+  // Adds/removes a filter to/from the (framework, slave) index.
+  void index(
+      const FrameworkID& frameworkId,
+      const SlaveID& slaveId,
+      Filter* filter);
+
+  void unindex(const FrameworkID& frameworkId);
+
+  // Returns the slaves whose attributes include the given attribute
+  // (e.g., rack=r42), in O(result). The master maintains the same
+  // index (Master::slavesWithAttribute); the allocator keeps its own
+  // copy, built from slaveAdded/slaveRemoved, since processes don't
+  // share state. Constraint-aware allocation can use this to
+  // pre-filter candidate slaves without scanning the cluster.
+  hashset<SlaveID> slavesWithAttribute(const Attribute& attribute);
 
   // Checks whether the slave is whitelisted.
   bool isWhitelisted(const SlaveID& slave);
@@ -159,12 +205,47 @@ protected:
   // Contains all active slaves.
   hashmap<SlaveID, SlaveInfo> slaves;
 
+  // Inverted index from a rendered attribute (e.g., "rack=r42") to
+  // the slaves carrying it, see slavesWithAttribute().
+  hashmap<std::string, hashset<SlaveID> > attributeIndex;
+
   // Filters that have been added by frameworks.
   multihashmap<FrameworkID, Filter*> filters;
 
+  // Index of the filters by (framework, slave) so that the per-slave
+  // check during allocation only examines the filters that can
+  // possibly match, instead of every filter the framework has.
+  hashmap<FrameworkID, multihashmap<SlaveID, Filter*> > filterIndex;
+
+  // Filters bucketed by expiration second, see expireBucket(). An
+  // entry remembers the framework and slave the filter was indexed
+  // under. Every filter ends up in exactly one bucket and is deleted
+  // when its bucket expires.
+  struct Expiring
+  {
+    FrameworkID frameworkId;
+    SlaveID slaveId;
+    Filter* filter;
+  };
+
+  std::map<int64_t, std::vector<Expiring> > expiries;
+
   // Slaves to send offers for.
   Option<hashset<std::string> > whitelist;
 
+  // Slaves awaiting an event-driven allocation, see trigger().
+  hashset<SlaveID> triggered;
+
+  // Slaves whose allocatable resources were below the minimum
+  // offerable threshold (MIN_CPUS / MIN_MEM) at the last scan. Such
+  // a slave can only become offerable again when resources are
+  // returned to it, and every code path that increases
+  // 'allocatable[slaveId]' removes the slave from this set, so
+  // allocation cycles can skip these slaves entirely. This keeps the
+  // per-cycle cost proportional to the number of slaves with
+  // offerable resources rather than the cluster size.
+  hashset<SlaveID> unallocatable;
+
   // Sorter containing all active users.
   UserSorter* userSorter;
 };
@@ -309,6 +390,8 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::frameworkRemoved(
 
   filters.remove(frameworkId);
 
+  unindex(frameworkId);
+
   LOG(INFO) << "Removed framework " << frameworkId;
 }
 
@@ -356,6 +439,8 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::frameworkDeactivated(
 
   filters.remove(frameworkId);
 
+  unindex(frameworkId);
+
   LOG(INFO) << "Deactivated framework " << frameworkId;
 }
 
@@ -392,11 +477,17 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::slaveAdded(
 
   allocatable[slaveId] = unused;
 
+  foreach (const Attribute& attribute, slaveInfo.attributes()) {
+    attributeIndex[stringify(attribute)].insert(slaveId);
+  }
+
   LOG(INFO) << "Added slave " << slaveId << " (" << slaveInfo.hostname()
             << ") with " << slaveInfo.resources() << " (and " << unused
             << " available)";
 
-  allocate(slaveId);
+  // Trigger (rather than perform) the allocation so that a burst of
+  // slave registrations gets allocated in a single pass.
+  trigger(slaveId);
 }
 
 
@@ -411,10 +502,22 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::slaveRemoved(
 
   userSorter->remove(slaves[slaveId].resources());
 
+  foreach (const Attribute& attribute, slaves[slaveId].attributes()) {
+    const std::string& key = stringify(attribute);
+    attributeIndex[key].erase(slaveId);
+    if (attributeIndex[key].empty()) {
+      attributeIndex.erase(key);
+    }
+  }
+
   slaves.erase(slaveId);
 
   allocatable.erase(slaveId);
 
+  triggered.erase(slaveId);
+
+  unallocatable.erase(slaveId);
+
   // Note that we DO NOT actually delete any filters associated with
   // this slave, that will occur when the delayed
   // HierarchicalAllocatorProcess::expire gets invoked (or the framework
@@ -487,6 +590,7 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::resourcesUnused(
   // Update resources allocatable on slave.
   CHECK(allocatable.contains(slaveId));
   allocatable[slaveId] += resources;
+  unallocatable.erase(slaveId);
 
   // Create a refused resources filter.
   Seconds seconds(filters.isSome()
@@ -498,13 +602,31 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::resourcesUnused(
               << " filtered slave " << slaveId
               << " for " << seconds;
 
-    // Create a new filter and delay it's expiration.
+    // Create a new filter and schedule it's expiration.
     mesos::internal::master::Filter* filter =
       new RefusedFilter(slaveId, resources, Timeout(seconds));
 
     this->filters.put(frameworkId, filter);
 
-    delay(seconds, self(), &Self::expire, frameworkId, filter);
+    index(frameworkId, slaveId, filter);
+
+    // Bucket the expiry to the next whole second so that a burst of
+    // declines schedules a single delayed expiry per second rather
+    // than one timer per filter.
+    int64_t bucket = (int64_t) (Clock::now() + seconds.secs()) + 1;
+
+    if (expiries.count(bucket) == 0) {
+      delay(Seconds(bucket - Clock::now()),
+            self(),
+            &Self::expireBucket,
+            bucket);
+    }
+
+    Expiring expiring;
+    expiring.frameworkId = frameworkId;
+    expiring.slaveId = slaveId;
+    expiring.filter = filter;
+    expiries[bucket].push_back(expiring);
   }
 }
 
@@ -540,11 +662,17 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::resourcesRecovered(
   // before we received Allocator::slaveRemoved).
   if (allocatable.contains(slaveId)) {
     allocatable[slaveId] += resources;
+    unallocatable.erase(slaveId);
 
     LOG(INFO) << "Recovered " << resources.allocatable()
               << " (total allocatable: " << allocatable[slaveId] << ")"
               << " on slave " << slaveId
               << " from framework " << frameworkId;
+
+    // Don't wait for the next batch allocation; recovered resources
+    // should be re-offered as soon as the current burst of recoveries
+    // has been drained.
+    trigger(slaveId);
   }
 }
 
@@ -569,6 +697,8 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::offersRevived(
 
   filters.remove(frameworkId);
 
+  unindex(frameworkId);
+
   LOG(INFO) << "Removed filters for framework " << frameworkId;
 
   allocate();
@@ -585,6 +715,48 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::batch()
 }
 
 
+template <class UserSorter, class FrameworkSorter>
+void
+HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::trigger(
+    const SlaveID& slaveId)
+{
+  CHECK(initialized);
+
+  // Dispatch (rather than invoke) the flush so that all the triggers
+  // already sitting in our event queue get coalesced into it. Only
+  // dispatch when this is the first trigger since the last flush,
+  // otherwise a flush is already on its way.
+  if (triggered.empty()) {
+    dispatch(self(), &Self::flush);
+  }
+
+  triggered.insert(slaveId);
+}
+
+
+template <class UserSorter, class FrameworkSorter>
+void
+HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::flush()
+{
+  CHECK(initialized);
+
+  if (triggered.empty()) {
+    return;
+  }
+
+  hashset<SlaveID> slaveIds = triggered;
+  triggered.clear();
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  allocate(slaveIds);
+
+  VLOG(1) << "Performed event-driven allocation for " << slaveIds.size()
+          << " slaves in " << stopwatch.elapsed();
+}
+
+
 template <class UserSorter, class FrameworkSorter>
 void
 HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::allocate()
@@ -626,6 +798,8 @@ void
 HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::allocate(
     const hashset<SlaveID>& slaveIds)
 {
+  TIMED_SCOPE("allocator/allocate");
+
   CHECK(initialized);
 
   if (userSorter->count() == 0) {
@@ -641,6 +815,12 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::allocate(
       continue;
     }
 
+    // Skip slaves known to be below the offerable threshold since
+    // the last scan; nothing has been returned to them since.
+    if (unallocatable.contains(slaveId)) {
+      continue;
+    }
+
     if (isWhitelisted(slaveId)) {
       resources = resources.allocatable(); // Make sure they're allocatable.
 
@@ -652,14 +832,16 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::allocate(
       // and then end up waiting the default Filters::refuse_seconds
       // (unless the framework set it to something different).
 
-      Value::Scalar none;
-      Value::Scalar cpus = resources.get("cpus", none);
-      Value::Scalar mem = resources.get("mem", none);
+      Option<double> cpus = resources.cpus();
+      Option<double> mem = resources.mem();
 
-      if (cpus.value() >= MIN_CPUS && mem.value() > MIN_MEM) {
+      if (cpus.isSome() && cpus.get() >= MIN_CPUS &&
+          mem.isSome() && mem.get() > MIN_MEM) {
         VLOG(1) << "Found available resources: " << resources
                 << " on slave " << slaveId;
         available[slaveId] = resources;
+      } else {
+        unallocatable.insert(slaveId);
       }
     }
   }
@@ -715,6 +897,7 @@ template <class UserSorter, class FrameworkSorter>
 void
 HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::expire(
     const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
     Filter* filter)
 {
   // The filter might have already been removed (e.g., if the
@@ -725,10 +908,70 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::expire(
   if (users.contains(frameworkId) && filters.contains(frameworkId, filter)) {
     filters.remove(frameworkId, filter);
   }
+
+  if (filterIndex.contains(frameworkId)) {
+    filterIndex[frameworkId].remove(slaveId, filter);
+    if (filterIndex[frameworkId].empty()) {
+      filterIndex.erase(frameworkId);
+    }
+  }
+
   delete filter;
 }
 
 
+template <class UserSorter, class FrameworkSorter>
+void
+HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::expireBucket(
+    int64_t bucket)
+{
+  if (expiries.count(bucket) > 0) {
+    foreach (const Expiring& expiring, expiries[bucket]) {
+      expire(expiring.frameworkId, expiring.slaveId, expiring.filter);
+    }
+
+    expiries.erase(bucket);
+  }
+}
+
+
+template <class UserSorter, class FrameworkSorter>
+void
+HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::index(
+    const FrameworkID& frameworkId,
+    const SlaveID& slaveId,
+    Filter* filter)
+{
+  filterIndex[frameworkId].put(slaveId, filter);
+}
+
+
+template <class UserSorter, class FrameworkSorter>
+void
+HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::unindex(
+    const FrameworkID& frameworkId)
+{
+  filterIndex.erase(frameworkId);
+}
+
+
+template <class UserSorter, class FrameworkSorter>
+hashset<SlaveID>
+HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::slavesWithAttribute(
+    const Attribute& attribute)
+{
+  CHECK(initialized);
+
+  Option<hashset<SlaveID> > slaveIds = attributeIndex.get(stringify(attribute));
+
+  if (slaveIds.isSome()) {
+    return slaveIds.get();
+  }
+
+  return hashset<SlaveID>();
+}
+
+
 template <class UserSorter, class FrameworkSorter>
 bool
 HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::isWhitelisted(
@@ -751,15 +994,22 @@ HierarchicalAllocatorProcess<UserSorter, FrameworkSorter>::isFiltered(
     const Resources& resources)
 {
   bool filtered = false;
-  foreach (Filter* filter, filters.get(frameworkId)) {
-    if (filter->filter(slaveId, resources)) {
-      VLOG(1) << "Filtered " << resources
-              << " on slave " << slaveId
-              << " for framework " << frameworkId;
-      filtered = true;
-      break;
+
+  // Only examine the filters indexed under this slave; the common
+  // case is zero or one, regardless of how many slaves the framework
+  // has declined in total.
+  if (filterIndex.contains(frameworkId)) {
+    foreach (Filter* filter, filterIndex[frameworkId].get(slaveId)) {
+      if (filter->filter(slaveId, resources)) {
+        VLOG(1) << "Filtered " << resources
+                << " on slave " << slaveId
+                << " for framework " << frameworkId;
+        filtered = true;
+        break;
+      }
     }
   }
+
   return filtered;
 }
 
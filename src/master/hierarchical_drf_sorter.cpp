@@ -0,0 +1,333 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <stout/strings.hpp>
+
+#include "logging/logging.hpp"
+
+#include "master/hierarchical_drf_sorter.hpp"
+
+using std::list;
+using std::map;
+using std::string;
+using std::vector;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+void HierarchicalDRFSorter::add(const string& name)
+{
+  Node* node = insert(name);
+
+  CHECK(!node->client) << "Client " << name << " already added";
+
+  node->client = true;
+  node->active = true;
+
+  clients[name] = node;
+}
+
+
+void HierarchicalDRFSorter::remove(const string& name)
+{
+  Option<Node*> option = clients.get(name);
+
+  if (option.isNone()) {
+    return;
+  }
+
+  Node* node = option.get();
+
+  // Clients are leaves (allocations only land on clients).
+  CHECK(node->children.empty())
+    << "Client " << name << " has children";
+
+  // Drop the client's allocation from the cached aggregates along
+  // its path.
+  for (Node* ancestor = node->parent;
+       ancestor != NULL;
+       ancestor = ancestor->parent) {
+    ancestor->allocation -= node->allocation;
+    if (!dirty) {
+      ancestor->share = calculateShare(ancestor->allocation);
+    }
+  }
+
+  clients.erase(name);
+  prune(node);
+}
+
+
+void HierarchicalDRFSorter::activate(const string& name)
+{
+  Option<Node*> option = clients.get(name);
+
+  CHECK(option.isSome()) << "Unknown client " << name;
+
+  option.get()->active = true;
+}
+
+
+void HierarchicalDRFSorter::deactivate(const string& name)
+{
+  Option<Node*> option = clients.get(name);
+
+  if (option.isSome()) {
+    option.get()->active = false;
+  }
+}
+
+
+void HierarchicalDRFSorter::allocated(
+    const string& name,
+    const Resources& _resources)
+{
+  Option<Node*> option = clients.get(name);
+
+  CHECK(option.isSome()) << "Unknown client " << name;
+
+  // Update the cached aggregate and share along the path from the
+  // leaf to the root: O(depth), nothing else in the tree moves. If
+  // the total resources have changed every share gets recalculated
+  // on the next sort, so don't bother here.
+  for (Node* node = option.get(); node != NULL; node = node->parent) {
+    node->allocation += _resources;
+    if (!dirty) {
+      node->share = calculateShare(node->allocation);
+    }
+  }
+}
+
+
+void HierarchicalDRFSorter::unallocated(
+    const string& name,
+    const Resources& _resources)
+{
+  Option<Node*> option = clients.get(name);
+
+  CHECK(option.isSome()) << "Unknown client " << name;
+
+  for (Node* node = option.get(); node != NULL; node = node->parent) {
+    node->allocation -= _resources;
+    if (!dirty) {
+      node->share = calculateShare(node->allocation);
+    }
+  }
+}
+
+
+Resources HierarchicalDRFSorter::allocation(const string& name)
+{
+  Option<Node*> option = clients.get(name);
+
+  if (option.isSome()) {
+    return option.get()->allocation;
+  }
+
+  return Resources();
+}
+
+
+void HierarchicalDRFSorter::add(const Resources& _resources)
+{
+  resources += _resources;
+  retotal();
+
+  // We have to recalculate all shares when the total resources
+  // change, but we put it off until sort is called so that if
+  // something else changes before the next allocation we don't
+  // recalculate everything twice.
+  dirty = true;
+}
+
+
+void HierarchicalDRFSorter::remove(const Resources& _resources)
+{
+  resources -= _resources;
+  retotal();
+  dirty = true;
+}
+
+
+list<string> HierarchicalDRFSorter::sort()
+{
+  if (dirty) {
+    recalculate(root);
+    dirty = false;
+  }
+
+  list<string> ordering;
+  emit(root, &ordering);
+  return ordering;
+}
+
+
+bool HierarchicalDRFSorter::contains(const string& name)
+{
+  return clients.contains(name);
+}
+
+
+int HierarchicalDRFSorter::count()
+{
+  return clients.size();
+}
+
+
+void HierarchicalDRFSorter::weight(const string& path, double w)
+{
+  CHECK(w > 0) << "Invalid weight " << w << " for " << path;
+
+  insert(path)->weight = w;
+}
+
+
+HierarchicalDRFSorter::Node* HierarchicalDRFSorter::insert(
+    const string& path)
+{
+  Option<Node*> option = nodes.get(path);
+
+  if (option.isSome()) {
+    return option.get();
+  }
+
+  Node* node = root;
+  string prefix;
+
+  foreach (const string& component, strings::tokenize(path, "/")) {
+    prefix = prefix.empty() ? component : prefix + "/" + component;
+
+    map<string, Node*>::iterator iterator = node->children.find(component);
+    if (iterator != node->children.end()) {
+      node = iterator->second;
+    } else {
+      Node* child = new Node(component, prefix, node);
+      node->children[component] = child;
+      nodes[prefix] = child;
+      node = child;
+    }
+  }
+
+  return node;
+}
+
+
+void HierarchicalDRFSorter::prune(Node* node)
+{
+  // Walk upwards deleting nodes left with no children and no client;
+  // an interior node shared with other clients stops the pruning.
+  while (node != root &&
+         node->children.empty() &&
+         !node->client) {
+    Node* parent = node->parent;
+    parent->children.erase(node->name);
+    nodes.erase(node->path);
+    delete node;
+    node = parent;
+  }
+}
+
+
+double HierarchicalDRFSorter::calculateShare(const Resources& allocation)
+{
+  double share = 0;
+
+  // As in DRFSorter, non-scalar resources do not (yet) contribute,
+  // and the pool totals come from the cache so nothing rescans the
+  // pool protobufs.
+  foreach (const Resource& resource, allocation) {
+    if (resource.type() == Value::SCALAR) {
+      Option<double> total = totals.get(resource.name());
+
+      if (total.isSome() && total.get() > 0) {
+        share = std::max(share, resource.scalar().value() / total.get());
+      }
+    }
+  }
+
+  return share;
+}
+
+
+void HierarchicalDRFSorter::retotal()
+{
+  totals.clear();
+
+  foreach (const Resource& resource, resources) {
+    if (resource.type() == Value::SCALAR) {
+      totals[resource.name()] = resource.scalar().value();
+    }
+  }
+}
+
+
+void HierarchicalDRFSorter::recalculate(Node* node)
+{
+  node->share = calculateShare(node->allocation);
+
+  for (map<string, Node*>::iterator iterator = node->children.begin();
+       iterator != node->children.end();
+       ++iterator) {
+    recalculate(iterator->second);
+  }
+}
+
+
+void HierarchicalDRFSorter::emit(Node* node, list<string>* ordering)
+{
+  vector<Node*> order;
+  order.reserve(node->children.size());
+
+  for (map<string, Node*>::iterator iterator = node->children.begin();
+       iterator != node->children.end();
+       ++iterator) {
+    order.push_back(iterator->second);
+  }
+
+  std::sort(order.begin(), order.end(), &HierarchicalDRFSorter::compare);
+
+  for (size_t i = 0; i < order.size(); i++) {
+    Node* child = order[i];
+    if (child->client && child->active) {
+      ordering->push_back(child->path);
+    }
+    emit(child, ordering);
+  }
+}
+
+
+bool HierarchicalDRFSorter::compare(Node* left, Node* right)
+{
+  double l = left->share / left->weight;
+  double r = right->share / right->weight;
+
+  if (l == r) {
+    return left->name < right->name;
+  }
+
+  return l < r;
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,182 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HIERARCHICAL_DRF_SORTER_HPP__
+#define __HIERARCHICAL_DRF_SORTER_HPP__
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <stout/hashmap.hpp>
+
+#include "common/resources.hpp"
+
+#include "master/sorter.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// A weighted hierarchical DRF sorter. Client names are '/' separated
+// paths (e.g., "engineering/alice/framework-1"); interior nodes get
+// created implicitly as clients are added and every node caches the
+// aggregate allocation and dominant share of its subtree. An
+// allocation change therefore only touches the path from the
+// affected leaf up to the root (O(depth)), instead of rebuilding a
+// sorter per level, and sort() walks the tree ordering siblings by
+// their weighted share at every level. With flat (single segment)
+// names this degenerates to plain DRF over one level. Clients are
+// expected to be leaves of the tree (allocations land on clients, so
+// an interior node's aggregate is exactly its children's).
+class HierarchicalDRFSorter : public Sorter
+{
+public:
+  HierarchicalDRFSorter()
+    : root(new Node("", "", NULL)), dirty(false) {}
+
+  virtual ~HierarchicalDRFSorter()
+  {
+    delete root;
+  }
+
+  virtual void add(const std::string& name);
+
+  virtual void remove(const std::string& name);
+
+  virtual void activate(const std::string& name);
+
+  virtual void deactivate(const std::string& name);
+
+  virtual void allocated(const std::string& name,
+                         const Resources& resources);
+
+  virtual void unallocated(const std::string& name,
+                           const Resources& resources);
+
+  virtual Resources allocation(const std::string& name);
+
+  virtual void add(const Resources& resources);
+
+  virtual void remove(const Resources& resources);
+
+  virtual std::list<std::string> sort();
+
+  virtual bool contains(const std::string& name);
+
+  virtual int count();
+
+  // Sets the weight of the node at 'path' (creating interior nodes
+  // as needed). Siblings get ordered by share divided by weight, so
+  // a node with weight 2 can hold twice the share before losing its
+  // place in line; weights default to 1. Subtrees inherit nothing:
+  // each level is weighted among its own siblings.
+  void weight(const std::string& path, double w);
+
+private:
+  struct Node
+  {
+    Node(const std::string& _name, const std::string& _path, Node* _parent)
+      : name(_name),
+        path(_path),
+        parent(_parent),
+        weight(1.0),
+        share(0.0),
+        client(false),
+        active(false) {}
+
+    ~Node()
+    {
+      for (std::map<std::string, Node*>::iterator iterator =
+             children.begin();
+           iterator != children.end();
+           ++iterator) {
+        delete iterator->second;
+      }
+    }
+
+    std::string name; // Path component.
+    std::string path; // Full path from the root (the client name).
+    Node* parent;
+
+    double weight;
+    double share; // Cached dominant share of 'allocation'.
+
+    bool client; // Whether this node was add()ed (vs. interior only).
+    bool active;
+
+    // Aggregate allocation of the subtree rooted here.
+    Resources allocation;
+
+    // Children by path component; an ordered map keeps iteration
+    // (and thus tie breaking) deterministic.
+    std::map<std::string, Node*> children;
+  };
+
+  // Returns the node at 'path', creating it (and any missing
+  // interior nodes) as needed.
+  Node* insert(const std::string& path);
+
+  // Removes the node from its parent and prunes any interior
+  // ancestors left with no children and no client.
+  void prune(Node* node);
+
+  // Returns the dominant share of the given aggregate allocation
+  // against the cached pool totals.
+  double calculateShare(const Resources& allocation);
+
+  // Rebuilds the cached per resource-type scalar totals.
+  void retotal();
+
+  // Recomputes the cached shares of the entire subtree (used when
+  // the pool changes, which dirties every share).
+  void recalculate(Node* node);
+
+  // Appends the subtree's active clients to the ordering, siblings
+  // in weighted share order at every level.
+  void emit(Node* node, std::list<std::string>* ordering);
+
+  // Orders siblings by share scaled down by weight, ties broken by
+  // path component.
+  static bool compare(Node* left, Node* right);
+
+  Node* root;
+
+  // All nodes by full path.
+  hashmap<std::string, Node*> nodes;
+
+  // Client nodes (active and deactivated) by full path.
+  hashmap<std::string, Node*> clients;
+
+  // Total resources.
+  Resources resources;
+
+  // Scalar totals per resource type, rebuilt whenever the pool
+  // changes so share recomputation never rescans the pool protobufs.
+  hashmap<std::string, double> totals;
+
+  // If true, sort() will recalculate all shares.
+  bool dirty;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __HIERARCHICAL_DRF_SORTER_HPP__
@@ -16,12 +16,17 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <iomanip>
 #include <map>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include <tr1/functional>
+
+#include <process/delay.hpp>
+
 #include <stout/foreach.hpp>
 #include <stout/json.hpp>
 #include <stout/net.hpp>
@@ -37,6 +42,7 @@
 
 #include "logging/logging.hpp"
 
+#include "master/archive.hpp"
 #include "master/http.hpp"
 #include "master/master.hpp"
 
@@ -49,6 +55,7 @@ using process::Future;
 using process::http::BadRequest;
 using process::http::InternalServerError;
 using process::http::NotFound;
+using process::http::NotModified;
 using process::http::OK;
 using process::http::TemporaryRedirect;
 using process::http::Response;
@@ -62,21 +69,25 @@ using std::vector;
 // it becomes available).
 
 
-// Returns a JSON object modeled on a Resources.
-JSON::Object model(const Resources& resources)
+// The model() functions write straight into a JSON::Writer rather
+// than building a tree of JSON values per request; serializing the
+// master's whole state is the hot path of webui polling.
+
+// Writes a JSON object modeled on a Resources.
+void model(JSON::Writer& writer, const Resources& resources)
 {
-  JSON::Object object;
+  writer.beginObject();
 
   foreach (const Resource& resource, resources) {
     switch (resource.type()) {
       case Value::SCALAR:
-        object.values[resource.name()] = resource.scalar().value();
+        writer.field(resource.name(), resource.scalar().value());
         break;
       case Value::RANGES:
-        object.values[resource.name()] = stringify(resource.ranges());
+        writer.field(resource.name(), stringify(resource.ranges()));
         break;
       case Value::SET:
-        object.values[resource.name()] = stringify(resource.set());
+        writer.field(resource.name(), stringify(resource.set()));
         break;
       default:
         LOG(FATAL) << "Unexpected Value type: " << resource.type();
@@ -84,27 +95,27 @@ JSON::Object model(const Resources& resources)
     }
   }
 
-  return object;
+  writer.endObject();
 }
 
 
-JSON::Object model(const Attributes& attributes)
+void model(JSON::Writer& writer, const Attributes& attributes)
 {
-  JSON::Object object;
+  writer.beginObject();
 
   foreach (const Attribute& attribute, attributes) {
     switch (attribute.type()) {
       case Value::SCALAR:
-        object.values[attribute.name()] = attribute.scalar().value();
+        writer.field(attribute.name(), attribute.scalar().value());
         break;
       case Value::RANGES:
-        object.values[attribute.name()] = stringify(attribute.ranges());
+        writer.field(attribute.name(), stringify(attribute.ranges()));
         break;
       case Value::SET:
-        object.values[attribute.name()] = stringify(attribute.set());
+        writer.field(attribute.name(), stringify(attribute.set()));
         break;
       case Value::TEXT:
-        object.values[attribute.name()] = attribute.text().value();
+        writer.field(attribute.name(), attribute.text().value());
         break;
       default:
         LOG(FATAL) << "Unexpected Value type: " << attribute.type();
@@ -112,100 +123,99 @@ JSON::Object model(const Attributes& attributes)
     }
   }
 
-  return object;
+  writer.endObject();
 }
 
 
-// Returns a JSON object modeled on a Task.
+// Writes a JSON object modeled on a Task.
 // TODO(bmahler): Expose the executor name / source.
-JSON::Object model(const Task& task)
+void model(JSON::Writer& writer, const Task& task)
 {
-  JSON::Object object;
-  object.values["id"] = task.task_id().value();
-  object.values["name"] = task.name();
-  object.values["framework_id"] = task.framework_id().value();
-  object.values["executor_id"] = task.executor_id().value();
-  object.values["slave_id"] = task.slave_id().value();
-  object.values["state"] = TaskState_Name(task.state());
-  object.values["resources"] = model(task.resources());
-  return object;
+  writer.beginObject();
+  writer.field("id", task.task_id().value());
+  writer.field("name", task.name());
+  writer.field("framework_id", task.framework_id().value());
+  writer.field("executor_id", task.executor_id().value());
+  writer.field("slave_id", task.slave_id().value());
+  writer.field("state", TaskState_Name(task.state()));
+  writer.key("resources");
+  model(writer, task.resources());
+  writer.endObject();
 }
 
 
-// Returns a JSON object modeled on an Offer.
-JSON::Object model(const Offer& offer)
+// Writes a JSON object modeled on an Offer.
+void model(JSON::Writer& writer, const Offer& offer)
 {
-  JSON::Object object;
-  object.values["id"] = offer.id().value();
-  object.values["framework_id"] = offer.framework_id().value();
-  object.values["slave_id"] = offer.slave_id().value();
-  object.values["resources"] = model(offer.resources());
-  return object;
+  writer.beginObject();
+  writer.field("id", offer.id().value());
+  writer.field("framework_id", offer.framework_id().value());
+  writer.field("slave_id", offer.slave_id().value());
+  writer.key("resources");
+  model(writer, offer.resources());
+  writer.endObject();
 }
 
 
-// Returns a JSON object modeled on a Framework.
-JSON::Object model(const Framework& framework)
+// Writes a JSON object modeled on a Framework.
+void model(JSON::Writer& writer, const Framework& framework)
 {
-  JSON::Object object;
-  object.values["id"] = framework.id.value();
-  object.values["name"] = framework.info.name();
-  object.values["user"] = framework.info.user();
-  object.values["registered_time"] = framework.registeredTime;
-  object.values["unregistered_time"] = framework.unregisteredTime;
-  object.values["active"] = framework.active;
-  object.values["resources"] = model(framework.resources);
+  writer.beginObject();
+  writer.field("id", framework.id.value());
+  writer.field("name", framework.info.name());
+  writer.field("user", framework.info.user());
+  writer.field("registered_time", framework.registeredTime);
+  writer.field("unregistered_time", framework.unregisteredTime);
+  writer.field("active", framework.active);
+  writer.key("resources");
+  model(writer, framework.resources);
 
   // TODO(benh): Consider making reregisteredTime an Option.
   if (framework.registeredTime != framework.reregisteredTime) {
-    object.values["reregistered_time"] = framework.reregisteredTime;
+    writer.field("reregistered_time", framework.reregisteredTime);
   }
 
   // Model all of the tasks associated with a framework.
-  {
-    JSON::Array array;
-    foreachvalue (Task* task, framework.tasks) {
-      array.values.push_back(model(*task));
-    }
-
-    object.values["tasks"] = array;
+  writer.key("tasks");
+  writer.beginArray();
+  foreachvalue (Task* task, framework.tasks) {
+    model(writer, *task);
   }
+  writer.endArray();
 
   // Model all of the completed tasks of a framework.
-  {
-    JSON::Array array;
-    foreach (const Task& task, framework.completedTasks) {
-      array.values.push_back(model(task));
-    }
-
-    object.values["completed_tasks"] = array;
+  writer.key("completed_tasks");
+  writer.beginArray();
+  foreach (const Task& task, framework.completedTasks) {
+    model(writer, task);
   }
+  writer.endArray();
 
   // Model all of the offers associated with a framework.
-  {
-    JSON::Array array;
-    foreach (Offer* offer, framework.offers) {
-      array.values.push_back(model(*offer));
-    }
-
-    object.values["offers"] = array;
+  writer.key("offers");
+  writer.beginArray();
+  foreach (Offer* offer, framework.offers) {
+    model(writer, *offer);
   }
+  writer.endArray();
 
-  return object;
+  writer.endObject();
 }
 
 
-// Returns a JSON object modeled after a Slave.
-JSON::Object model(const Slave& slave)
+// Writes a JSON object modeled after a Slave.
+void model(JSON::Writer& writer, const Slave& slave)
 {
-  JSON::Object object;
-  object.values["id"] = slave.id.value();
-  object.values["pid"] = string(slave.pid);
-  object.values["hostname"] = slave.info.hostname();
-  object.values["registered_time"] = slave.registeredTime;
-  object.values["resources"] = model(slave.info.resources());
-  object.values["attributes"] = model(slave.info.attributes());
-  return object;
+  writer.beginObject();
+  writer.field("id", slave.id.value());
+  writer.field("pid", string(slave.pid));
+  writer.field("hostname", slave.info.hostname());
+  writer.field("registered_time", slave.registeredTime);
+  writer.key("resources");
+  model(writer, slave.info.resources());
+  writer.key("attributes");
+  model(writer, slave.info.attributes());
+  writer.endObject();
 }
 
 
@@ -254,28 +264,71 @@ Future<Response> redirect(
 
 namespace json {
 
+namespace {
+
+// Wraps already-serialized JSON as an HTTP response, with JSONP
+// decoration when requested. The response carries an entity tag so
+// that conditional polls of an unchanged body collapse to "304 Not
+// Modified" (see http::etag).
+Response respond(const string& json, const Option<string>& jsonp)
+{
+  std::ostringstream out;
+
+  if (jsonp.isSome()) {
+    out << jsonp.get() << "(" << json << ");";
+  } else {
+    out << json;
+  }
+
+  OK response(out.str());
+  response.headers["Content-Type"] =
+    jsonp.isSome() ? "text/javascript" : "application/json";
+  response.headers["ETag"] = process::http::etag(response.body);
+  return response;
+}
+
+
+// As above, but answers a conditional request directly: when the
+// request's 'If-None-Match' matches the content's entity tag, "304
+// Not Modified" is returned instead of the body.
+Response respond(const string& json, const Request& request)
+{
+  Response response = respond(json, request.query.get("jsonp"));
+
+  if (request.headers.get("If-None-Match") ==
+      response.headers.get("ETag")) {
+    return NotModified(response.headers.get("ETag").get());
+  }
+
+  return response;
+}
+
+} // namespace {
+
+
 Future<Response> stats(
     const Master& master,
     const Request& request)
 {
   VLOG(1) << "HTTP request for '" << request.path << "'";
 
-  JSON::Object object;
-  object.values["uptime"] = Clock::now() - master.startTime;
-  object.values["elected"] = master.elected; // Note: using int not bool.
-  object.values["total_schedulers"] = master.frameworks.size();
-  object.values["active_schedulers"] = master.getActiveFrameworks().size();
-  object.values["activated_slaves"] = master.slaveHostnamePorts.size();
-  object.values["connected_slaves"] = master.slaves.size();
-  object.values["staged_tasks"] = master.stats.tasks[TASK_STAGING];
-  object.values["started_tasks"] = master.stats.tasks[TASK_STARTING];
-  object.values["finished_tasks"] = master.stats.tasks[TASK_FINISHED];
-  object.values["killed_tasks"] = master.stats.tasks[TASK_KILLED];
-  object.values["failed_tasks"] = master.stats.tasks[TASK_FAILED];
-  object.values["lost_tasks"] = master.stats.tasks[TASK_LOST];
-  object.values["valid_status_updates"] = master.stats.validStatusUpdates;
-  object.values["invalid_status_updates"] = master.stats.invalidStatusUpdates;
-  object.values["outstanding_offers"] = master.offers.size();
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.field("uptime", Clock::now() - master.startTime);
+  writer.field("elected", master.elected); // Note: using int not bool.
+  writer.field("total_schedulers", master.frameworks.size());
+  writer.field("active_schedulers", master.getActiveFrameworks().size());
+  writer.field("activated_slaves", master.slaveHostnamePorts.size());
+  writer.field("connected_slaves", master.slaves.size());
+  writer.field("staged_tasks", master.stats.tasks[TASK_STAGING]);
+  writer.field("started_tasks", master.stats.tasks[TASK_STARTING]);
+  writer.field("finished_tasks", master.stats.tasks[TASK_FINISHED]);
+  writer.field("killed_tasks", master.stats.tasks[TASK_KILLED]);
+  writer.field("failed_tasks", master.stats.tasks[TASK_FAILED]);
+  writer.field("lost_tasks", master.stats.tasks[TASK_LOST]);
+  writer.field("valid_status_updates", master.stats.validStatusUpdates);
+  writer.field("invalid_status_updates", master.stats.invalidStatusUpdates);
+  writer.field("outstanding_offers", master.offers.size());
 
   // Get total and used (note, not offered) resources in order to
   // compute capacity of scalar resources.
@@ -290,17 +343,86 @@ Future<Response> stats(
     if (resource.type() == Value::SCALAR) {
       CHECK(resource.has_scalar());
       double total = resource.scalar().value();
-      object.values[resource.name() + "_total"] = total;
+      writer.field(resource.name() + "_total", total);
       Option<Resource> option = usedResources.get(resource);
       CHECK(!option.isSome() || option.get().has_scalar());
       double used = option.isSome() ? option.get().scalar().value() : 0.0;
-      object.values[resource.name() + "_used"] = used;
+      writer.field(resource.name() + "_used", used);
       double percent = used / total;
-      object.values[resource.name() + "_percent"] = percent;
+      writer.field(resource.name() + "_percent", percent);
     }
   }
 
-  return OK(object, request.query.get("jsonp"));
+  // Append the operational metrics registry (see common/metrics.hpp).
+  map<string, double> metrics = master.metrics.snapshot();
+  foreachpair (const string& name, double value, metrics) {
+    writer.field(name, value);
+  }
+
+  writer.endObject();
+
+  return respond(writer.str(), request);
+}
+
+
+Future<Response> summary(
+    const Master& master,
+    const Request& request)
+{
+  VLOG(1) << "HTTP request for '" << request.path << "'";
+
+  // A standby serves its mirror of the leader's rendering (see
+  // Master::mirror), stamped with its age so consumers can judge
+  // the freshness.
+  if (!master.elected && master.mirroredSummary.isSome()) {
+    Response response =
+      respond(master.mirroredSummary.get(), request);
+    response.headers["X-Mesos-Staleness"] =
+      stringify(Clock::now() - master.mirroredTime);
+    return response;
+  }
+
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.field("start_time", master.startTime);
+  writer.field("elected", master.elected); // Note: using int not bool.
+  writer.field("activated_slaves", master.slaveHostnamePorts.size());
+  writer.field("connected_slaves", master.slaves.size());
+  writer.field("outstanding_offers", master.offers.size());
+  writer.field("total_frameworks", master.frameworks.size());
+
+  // Aggregate resources across all connected slaves, maintained by
+  // addSlave/removeSlave rather than summed here.
+  writer.key("resources");
+  model(writer, master.totalResources);
+
+  writer.key("frameworks");
+  writer.beginArray();
+  foreachvalue (Framework* framework, master.frameworks) {
+    writer.beginObject();
+    writer.field("id", framework->id.value());
+    writer.field("name", framework->info.name());
+    writer.field("active", framework->active);
+
+    writer.key("resources");
+    model(writer, framework->resources);
+
+    // Counts of live tasks for the active states and cumulative
+    // totals for the terminal ones (see Framework::taskStates).
+    writer.field("staging_tasks", framework->taskStates[TASK_STAGING]);
+    writer.field("starting_tasks", framework->taskStates[TASK_STARTING]);
+    writer.field("running_tasks", framework->taskStates[TASK_RUNNING]);
+    writer.field("finished_tasks", framework->taskStates[TASK_FINISHED]);
+    writer.field("killed_tasks", framework->taskStates[TASK_KILLED]);
+    writer.field("failed_tasks", framework->taskStates[TASK_FAILED]);
+    writer.field("lost_tasks", framework->taskStates[TASK_LOST]);
+    writer.endObject();
+  }
+  writer.endArray();
+
+  writer.endObject();
+
+  return respond(writer.str(), request);
 }
 
 
@@ -310,68 +432,387 @@ Future<Response> state(
 {
   VLOG(1) << "HTTP request for '" << request.path << "'";
 
-  JSON::Object object;
-  object.values["build_date"] = build::DATE;
-  object.values["build_time"] = build::TIME;
-  object.values["build_user"] = build::USER;
-  object.values["start_time"] = master.startTime;
-  object.values["id"] = master.info.id();
-  object.values["pid"] = string(master.self());
-  object.values["activated_slaves"] = master.slaveHostnamePorts.size();
-  object.values["connected_slaves"] = master.slaves.size();
-  object.values["staged_tasks"] = master.stats.tasks[TASK_STAGING];
-  object.values["started_tasks"] = master.stats.tasks[TASK_STARTING];
-  object.values["finished_tasks"] = master.stats.tasks[TASK_FINISHED];
-  object.values["killed_tasks"] = master.stats.tasks[TASK_KILLED];
-  object.values["failed_tasks"] = master.stats.tasks[TASK_FAILED];
-  object.values["lost_tasks"] = master.stats.tasks[TASK_LOST];
+  // A standby serves its mirror of the leader's rendering, just as
+  // for the summary above.
+  if (!master.elected && master.mirroredState.isSome()) {
+    Response response =
+      respond(master.mirroredState.get(), request);
+    response.headers["X-Mesos-Staleness"] =
+      stringify(Clock::now() - master.mirroredTime);
+    return response;
+  }
+
+  // Serve repeated polls from the cached rendering when no state
+  // transition has occurred since it was built. Master bumps
+  // 'stateVersion' (via Master::invalidateState) on every transition
+  // that affects the contents of this endpoint.
+  if (master.renderedState.isSome() &&
+      master.renderedStateVersion == master.stateVersion) {
+    return respond(master.renderedState.get(), request);
+  }
+
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.field("build_date", build::DATE);
+  writer.field("build_time", build::TIME);
+  writer.field("build_user", build::USER);
+  writer.field("start_time", master.startTime);
+  writer.field("id", master.info.id());
+  writer.field("pid", string(master.self()));
+  writer.field("activated_slaves", master.slaveHostnamePorts.size());
+  writer.field("connected_slaves", master.slaves.size());
+  writer.field("staged_tasks", master.stats.tasks[TASK_STAGING]);
+  writer.field("started_tasks", master.stats.tasks[TASK_STARTING]);
+  writer.field("finished_tasks", master.stats.tasks[TASK_FINISHED]);
+  writer.field("killed_tasks", master.stats.tasks[TASK_KILLED]);
+  writer.field("failed_tasks", master.stats.tasks[TASK_FAILED]);
+  writer.field("lost_tasks", master.stats.tasks[TASK_LOST]);
 
   if (master.flags.cluster.isSome()) {
-    object.values["cluster"] = master.flags.cluster.get();
+    writer.field("cluster", master.flags.cluster.get());
   }
 
   // TODO(benh): Use an Option for the leader PID.
   if (master.leader != UPID()) {
-    object.values["leader"] = string(master.leader);
+    writer.field("leader", string(master.leader));
   }
 
   if (master.flags.log_dir.isSome()) {
-    object.values["log_dir"] = master.flags.log_dir.get();
+    writer.field("log_dir", master.flags.log_dir.get());
   }
 
   // Model all of the slaves.
+  writer.key("slaves");
+  writer.beginArray();
+  foreachvalue (Slave* slave, master.slaves) {
+    model(writer, *slave);
+  }
+  writer.endArray();
+
+  // Model all of the frameworks, re-rendering only the fragments of
+  // frameworks that have seen a state transition since the last
+  // rendering and reusing the cached fragments for the rest.
   {
-    JSON::Array array;
-    foreachvalue (Slave* slave, master.slaves) {
-      array.values.push_back(model(*slave));
+    hashmap<FrameworkID, uint64_t> versions;
+    hashmap<FrameworkID, string> fragments;
+
+    writer.key("frameworks");
+    writer.beginArray();
+    foreachvalue (Framework* framework, master.frameworks) {
+      Option<uint64_t> version =
+        master.frameworkStateVersions.get(framework->id);
+      uint64_t current = version.isSome() ? version.get() : 0;
+
+      Option<uint64_t> rendered =
+        master.renderedFrameworkVersions.get(framework->id);
+
+      string fragment;
+      if (rendered.isSome() && rendered.get() == current) {
+        fragment = master.renderedFrameworks[framework->id];
+      } else {
+        JSON::Writer rendering;
+        model(rendering, *framework);
+        fragment = rendering.str();
+      }
+
+      writer.append(fragment);
+
+      versions[framework->id] = current;
+      fragments[framework->id] = fragment;
     }
+    writer.endArray();
 
-    object.values["slaves"] = array;
+    // Replace (rather than update) the fragment cache so that
+    // entries for removed frameworks get pruned.
+    master.renderedFrameworkVersions = versions;
+    master.renderedFrameworks = fragments;
   }
 
-  // Model all of the frameworks.
-  {
-    JSON::Array array;
+  // Model all of the completed frameworks.
+  writer.key("completed_frameworks");
+  writer.beginArray();
+  foreach (const std::tr1::shared_ptr<Framework>& framework,
+           master.completedFrameworks) {
+    model(writer, *framework);
+  }
+  writer.endArray();
+
+  writer.endObject();
+
+  master.renderedState = writer.str();
+  master.renderedStateVersion = master.stateVersion;
+
+  return respond(writer.str(), request);
+}
+
+
+namespace {
+
+// Orders tasks by framework then task id so that paging through
+// '/tasks.json' is deterministic across requests (the underlying
+// hash maps make no iteration order guarantees).
+bool lessThan(const Task* left, const Task* right)
+{
+  if (left->framework_id().value() != right->framework_id().value()) {
+    return left->framework_id().value() < right->framework_id().value();
+  }
+  return left->task_id().value() < right->task_id().value();
+}
+
+} // namespace {
+
+
+Future<Response> tasks(
+    const Master& master,
+    const Request& request)
+{
+  VLOG(1) << "HTTP request for '" << request.path << "'";
+
+  size_t offset = 0;
+  size_t limit = 100;
+
+  Option<string> param = request.query.get("offset");
+  if (param.isSome()) {
+    Try<size_t> numified = numify<size_t>(param.get());
+    if (numified.isError()) {
+      return BadRequest("Invalid 'offset' parameter.\n");
+    }
+    offset = numified.get();
+  }
+
+  param = request.query.get("limit");
+  if (param.isSome()) {
+    Try<size_t> numified = numify<size_t>(param.get());
+    if (numified.isError()) {
+      return BadRequest("Invalid 'limit' parameter.\n");
+    }
+    limit = numified.get();
+  }
+
+  Option<TaskState> state = Option<TaskState>::none();
+  param = request.query.get("state");
+  if (param.isSome()) {
+    TaskState parsed;
+    if (!TaskState_Parse(param.get(), &parsed)) {
+      return BadRequest("Unknown task state '" + param.get() + "'.\n");
+    }
+    state = parsed;
+  }
+
+  Option<string> frameworkParam = request.query.get("framework");
+  Option<string> slaveParam = request.query.get("slave");
+
+  // Collect the candidate tasks from the narrowest index available:
+  // the framework's task table, the slave's task table, or (lacking
+  // either filter) all frameworks. This keeps filtered queries
+  // proportional to the candidate set rather than the cluster.
+  vector<const Task*> candidates;
+
+  if (frameworkParam.isSome()) {
+    FrameworkID frameworkId;
+    frameworkId.set_value(frameworkParam.get());
+
+    // NOTE: densehashmap::get returns by value, hence the named local.
+    Option<Framework*> framework = master.frameworks.get(frameworkId);
+    if (framework.isNone()) {
+      return NotFound();
+    }
+
+    foreachvalue (Task* task, framework.get()->tasks) {
+      candidates.push_back(task);
+    }
+  } else if (slaveParam.isSome()) {
+    SlaveID slaveId;
+    slaveId.set_value(slaveParam.get());
+
+    Option<Slave*> slave = master.slaves.get(slaveId);
+    if (slave.isNone()) {
+      return NotFound();
+    }
+
+    foreachvalue (Task* task, slave.get()->tasks) {
+      candidates.push_back(task);
+    }
+  } else {
     foreachvalue (Framework* framework, master.frameworks) {
-      array.values.push_back(model(*framework));
+      foreachvalue (Task* task, framework->tasks) {
+        candidates.push_back(task);
+      }
     }
+  }
 
-    object.values["frameworks"] = array;
+  // Apply the remaining filters.
+  vector<const Task*> matched;
+  foreach (const Task* task, candidates) {
+    if (state.isSome() && task->state() != state.get()) {
+      continue;
+    }
+    if (frameworkParam.isSome() && slaveParam.isSome() &&
+        task->slave_id().value() != slaveParam.get()) {
+      continue;
+    }
+    matched.push_back(task);
   }
 
-  // Model all of the completed frameworks.
-  {
-    JSON::Array array;
+  std::sort(matched.begin(), matched.end(), lessThan);
+
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.field("offset", offset);
+  writer.field("limit", limit);
+  writer.field("count", matched.size());
+
+  writer.key("tasks");
+  writer.beginArray();
+  for (size_t i = offset; i < matched.size() && i - offset < limit; i++) {
+    model(writer, *matched[i]);
+  }
+  writer.endArray();
+
+  writer.endObject();
+
+  return respond(writer.str(), request);
+}
+
 
-    foreach (const std::tr1::shared_ptr<Framework>& framework,
-             master.completedFrameworks) {
-      array.values.push_back(model(*framework));
+Response renderEvents(
+    const Master& master,
+    uint64_t since,
+    const Option<string>& jsonp)
+{
+  JSON::Writer writer;
+  writer.beginObject();
+
+  // The client resumes its cursor from here; the journal is ordered,
+  // so the last delta below (if any) carries this version.
+  writer.field("version", master.eventVersion);
+
+  writer.key("events");
+  writer.beginArray();
+  foreach (const Master::Event& event, master.events) {
+    if (event.version > since) {
+      writer.append(event.json);
     }
+  }
+  writer.endArray();
+
+  writer.endObject();
+
+  Response response = respond(writer.str(), jsonp);
+
+  // Also stamped on the response so that consumers (in particular a
+  // mirroring standby, see Master::mirror) can advance their cursor
+  // without parsing the body.
+  response.headers["X-Mesos-Event-Version"] = stringify(master.eventVersion);
+
+  return response;
+}
+
 
-    object.values["completed_frameworks"] = array;
+Future<Response> events(
+    const Master& master,
+    const Request& request)
+{
+  VLOG(1) << "HTTP request for '" << request.path << "'";
+
+  uint64_t since = 0;
+
+  Option<string> param = request.query.get("since");
+  if (param.isSome()) {
+    Try<uint64_t> numified = numify<uint64_t>(param.get());
+    if (numified.isError()) {
+      return BadRequest("Invalid 'since' parameter.\n");
+    }
+    since = numified.get();
+  }
+
+  // A cursor ahead of the journal is from a previous master
+  // incarnation (versions restart at zero on failover): the client
+  // must resynchronize from '/master/state.json'.
+  if (since > master.eventVersion) {
+    return BadRequest("'since' is ahead of the event journal.\n");
+  }
+
+  if (since < master.eventVersion) {
+    CHECK(!master.events.empty());
+
+    // A client that has fallen behind the bounded journal cannot be
+    // caught up incrementally either; tell it to resynchronize and
+    // resume its cursor from the current version.
+    if (since + 1 < master.events.front().version) {
+      JSON::Writer writer;
+      writer.beginObject();
+      writer.field("version", master.eventVersion);
+      writer.field("truncated", 1); // Note: using int not bool.
+      writer.endObject();
+
+      Response response = respond(writer.str(), request);
+      response.headers["X-Mesos-Event-Version"] =
+        stringify(master.eventVersion);
+      return response;
+    }
+
+    return renderEvents(master, since, request.query.get("jsonp"));
+  }
+
+  // The client is current: park the request until the next delta is
+  // journaled (see Master::journal) or the poll timeout expires.
+  Master::EventWaiter waiter;
+  waiter.since = since;
+  waiter.jsonp = request.query.get("jsonp");
+  waiter.timestamp = Clock::now();
+  waiter.promise.reset(new process::Promise<Response>());
+
+  master.eventWaiters.push_back(waiter);
+
+  delay(EVENT_POLL_TIMEOUT, master.self(), &Master::timeoutEventWaiters);
+
+  return waiter.promise->future();
+}
+
+
+namespace {
+
+// Renders a framework record fetched back from the archive. The
+// record is already serialized JSON, so it is passed through
+// directly (with JSONP decoration when requested).
+Response renderArchived(
+    const Option<string>& jsonp,
+    const Option<string>& record)
+{
+  if (record.isNone()) {
+    return NotFound();
   }
 
-  return OK(object, request.query.get("jsonp"));
+  return respond(record.get(), jsonp);
+}
+
+} // namespace {
+
+
+Future<Response> archive(
+    const Master& master,
+    const Request& request)
+{
+  VLOG(1) << "HTTP request for '" << request.path << "'";
+
+  if (master.archive == NULL) {
+    return NotFound();
+  }
+
+  Option<string> frameworkId = request.query.get("framework_id");
+
+  if (frameworkId.isNone()) {
+    return BadRequest("Expecting 'framework_id=value' in query.\n");
+  }
+
+  std::tr1::function<Response(const Option<string>&)> render =
+    std::tr1::bind(
+        &renderArchived,
+        request.query.get("jsonp"),
+        std::tr1::placeholders::_1);
+
+  return master.archive->fetch(frameworkId.get()).then(render);
 }
 
 } // namespace json {
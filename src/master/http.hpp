@@ -19,9 +19,15 @@
 #ifndef __MASTER_HTTP_HPP__
 #define __MASTER_HTTP_HPP__
 
+#include <stdint.h>
+
+#include <string>
+
 #include <process/future.hpp>
 #include <process/http.hpp>
 
+#include <stout/option.hpp>
+
 namespace mesos {
 namespace internal {
 namespace master {
@@ -56,6 +62,51 @@ process::Future<process::http::Response> state(
     const Master& master,
     const process::http::Request& request);
 
+
+// Returns a lightweight summary for dashboards: cluster counts,
+// aggregate resource totals and per-framework task state counts, all
+// maintained incrementally by the master rather than computed by
+// iterating tasks at request time.
+process::Future<process::http::Response> summary(
+    const Master& master,
+    const process::http::Request& request);
+
+
+// Returns a page of active tasks. Accepts 'framework', 'slave' and
+// 'state' query parameters to filter the result and 'offset' /
+// 'limit' parameters to page through it, so that tooling interested
+// in a handful of tasks need not download the entire cluster state.
+process::Future<process::http::Response> tasks(
+    const Master& master,
+    const process::http::Request& request);
+
+
+// The event feed: returns the state deltas (task state transitions,
+// slave and framework additions and removals) journaled after the
+// version given by the 'since' query parameter, long polling until
+// the next delta (or a timeout) when the client is already current.
+// Integrations cursor over the feed instead of polling the whole of
+// '/master/state.json' (see Master::journal).
+process::Future<process::http::Response> events(
+    const Master& master,
+    const process::http::Request& request);
+
+
+// Renders the deltas journaled after 'since' along with the latest
+// version. Used both by the 'events' handler above and by the master
+// when completing parked long polls (see Master::journal).
+process::http::Response renderEvents(
+    const Master& master,
+    uint64_t since,
+    const Option<std::string>& jsonp);
+
+
+// Returns the archived record of a completed framework, looked up
+// by the 'framework_id' query parameter (see master/archive.hpp).
+process::Future<process::http::Response> archive(
+    const Master& master,
+    const process::http::Request& request);
+
 } // namespace json {
 } // namespace http {
 } // namespace master {
@@ -0,0 +1,229 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "logging/logging.hpp"
+
+#include "master/incremental_drf_sorter.hpp"
+
+using std::list;
+using std::set;
+using std::string;
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+void IncrementalDRFSorter::add(const string& name)
+{
+  Client client;
+  client.name = Atom(name);
+  client.share = 0;
+  clients.insert(client);
+
+  shares[name] = 0;
+  allocations[name] = Resources::parse("");
+}
+
+
+void IncrementalDRFSorter::remove(const string& name)
+{
+  erase(name);
+  allocations.erase(name);
+}
+
+
+void IncrementalDRFSorter::activate(const string& name)
+{
+  CHECK(allocations.contains(name));
+
+  Client client;
+  client.name = Atom(name);
+  client.share = calculateShare(name);
+  clients.insert(client);
+
+  shares[name] = client.share;
+}
+
+
+void IncrementalDRFSorter::deactivate(const string& name)
+{
+  erase(name);
+}
+
+
+void IncrementalDRFSorter::allocated(
+    const string& name,
+    const Resources& resources)
+{
+  allocations[name] += resources;
+
+  // If the total resources have changed, we're going to
+  // recalculate all the shares, so don't bother just
+  // updating this client.
+  if (!dirty) {
+    update(name);
+  }
+}
+
+
+Resources IncrementalDRFSorter::allocation(
+    const string& name)
+{
+  return allocations[name];
+}
+
+
+void IncrementalDRFSorter::unallocated(
+    const string& name,
+    const Resources& resources)
+{
+  allocations[name] -= resources;
+
+  if (!dirty) {
+    update(name);
+  }
+}
+
+
+void IncrementalDRFSorter::add(const Resources& _resources)
+{
+  resources += _resources;
+
+  // We have to recalculate all shares when the total resources
+  // change, but we put it off until sort is called
+  // so that if something else changes before the next allocation
+  // we don't recalculate everything twice.
+  dirty = true;
+}
+
+
+void IncrementalDRFSorter::remove(const Resources& _resources)
+{
+  resources -= _resources;
+  dirty = true;
+}
+
+
+list<string> IncrementalDRFSorter::sort()
+{
+  if (dirty) {
+    set<Client, DRFComparator> temp;
+
+    set<Client, DRFComparator>::iterator it;
+    for (it = clients.begin(); it != clients.end(); it++) {
+      Client client;
+      client.name = (*it).name;
+      client.share = calculateShare((*it).name);
+      temp.insert(client);
+
+      shares[client.name] = client.share;
+    }
+
+    clients = temp;
+
+    dirty = false;
+  }
+
+  list<string> ret;
+
+  set<Client, DRFComparator>::iterator it;
+  for (it = clients.begin(); it != clients.end(); it++) {
+    ret.push_back((*it).name);
+  }
+
+  return ret;
+}
+
+
+bool IncrementalDRFSorter::contains(const string& name)
+{
+  return allocations.contains(name);
+}
+
+
+int IncrementalDRFSorter::count()
+{
+  return allocations.size();
+}
+
+
+void IncrementalDRFSorter::update(const string& name)
+{
+  if (!shares.contains(name)) {
+    return; // Deactivated clients are repositioned on activate().
+  }
+
+  erase(name);
+
+  Client client;
+  client.name = Atom(name);
+  client.share = calculateShare(name);
+  clients.insert(client);
+
+  shares[name] = client.share;
+}
+
+
+double IncrementalDRFSorter::calculateShare(const string& name)
+{
+  double share = 0;
+
+  // TODO(benh): This implementation of "dominant resource fairness"
+  // currently does not take into account resources that are not
+  // scalars.
+
+  foreach (const Resource& resource, resources) {
+    if (resource.type() == Value::SCALAR) {
+      double total = resource.scalar().value();
+
+      if (total > 0) {
+        Value::Scalar none;
+        const Value::Scalar& scalar =
+          allocations[name].get(resource.name(), none);
+
+        share = std::max(share, scalar.value() / total);
+      }
+    }
+  }
+
+  return share;
+}
+
+
+void IncrementalDRFSorter::erase(const string& name)
+{
+  if (!shares.contains(name)) {
+    return; // Not active.
+  }
+
+  // Reconstruct the key under which the client was inserted so
+  // that the erase is a single O(log n) tree descent.
+  Client client;
+  client.name = Atom(name);
+  client.share = shares[name];
+
+  size_t erased = clients.erase(client);
+  CHECK(erased == 1u);
+
+  shares.erase(name);
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
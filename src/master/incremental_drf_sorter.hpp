@@ -0,0 +1,112 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __INCREMENTAL_DRF_SORTER_HPP__
+#define __INCREMENTAL_DRF_SORTER_HPP__
+
+#include <set>
+#include <string>
+
+#include <stout/hashmap.hpp>
+
+#include "common/resources.hpp"
+
+#include "master/drf_sorter.hpp"
+#include "master/sorter.hpp"
+
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// A DRF sorter that repositions only the affected client when an
+// allocation changes, rather than rebuilding the entire ordering.
+// It keeps an index from client name to the share under which the
+// client is currently stored in 'clients', so that erasing and
+// re-inserting a client is O(log n) instead of the O(n) scan plus
+// full O(n log n) rebuild that DRFSorter performs. A change to the
+// total resources still dirties every share, so that (unavoidable)
+// full recalculation is deferred until the next sort().
+class IncrementalDRFSorter : public Sorter
+{
+public:
+  IncrementalDRFSorter() : dirty(false) {}
+
+  virtual ~IncrementalDRFSorter() {}
+
+  virtual void add(const std::string& name);
+
+  virtual void remove(const std::string& name);
+
+  virtual void activate(const std::string& name);
+
+  virtual void deactivate(const std::string& name);
+
+  virtual void allocated(const std::string& name,
+                         const Resources& resources);
+
+  virtual void unallocated(const std::string& name,
+                           const Resources& resources);
+
+  virtual Resources allocation(const std::string& name);
+
+  virtual void add(const Resources& resources);
+
+  virtual void remove(const Resources& resources);
+
+  virtual std::list<std::string> sort();
+
+  virtual bool contains(const std::string& name);
+
+  virtual int count();
+
+private:
+  // Recalculates the share for the client and moves it in
+  // 'clients' accordingly, using the indexed share for an
+  // O(log n) erase.
+  void update(const std::string& name);
+
+  // Returns the dominant resource share for the client.
+  double calculateShare(const std::string& name);
+
+  // Erases the client from 'clients' using the indexed share.
+  void erase(const std::string& name);
+
+  // If true, sort() will recalculate all shares.
+  bool dirty;
+
+  // A set of Clients (names and shares) sorted by share.
+  std::set<Client, DRFComparator> clients;
+
+  // Maps active client names to the share under which they are
+  // currently stored in 'clients', so they can be found without
+  // a linear scan.
+  hashmap<std::string, double> shares;
+
+  // Maps client names to the resources they have been allocated.
+  hashmap<std::string, Resources> allocations;
+
+  // Total resources.
+  Resources resources;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __INCREMENTAL_DRF_SORTER_HPP__
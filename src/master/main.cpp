@@ -16,6 +16,9 @@
  * limitations under the License.
  */
 
+#include <set>
+
+#include <stout/duration.hpp>
 #include <stout/os.hpp>
 #include <stout/stringify.hpp>
 #include <stout/try.hpp>
@@ -29,13 +32,19 @@
 
 #include "flags/flags.hpp"
 
+#include "log/log.hpp"
+
 #include "logging/flags.hpp"
 #include "logging/logging.hpp"
 
 #include "master/allocator.hpp"
 #include "master/drf_sorter.hpp"
 #include "master/hierarchical_allocator_process.hpp"
+#include "master/sharded_allocator_process.hpp"
 #include "master/master.hpp"
+#include "master/registrar.hpp"
+
+#include "zookeeper/url.hpp"
 
 using namespace mesos::internal;
 using namespace mesos::internal::master;
@@ -116,11 +125,50 @@ int main(int argc, char** argv)
   LOG(INFO) << "Build: " << build::DATE << " by " << build::USER;
   LOG(INFO) << "Starting Mesos master";
 
-  AllocatorProcess* allocatorProcess = new HierarchicalDRFAllocatorProcess();
+  AllocatorProcess* allocatorProcess = flags.allocator_shards > 1
+    ? (AllocatorProcess*) new ShardedHierarchicalDRFAllocatorProcess()
+    : (AllocatorProcess*) new HierarchicalDRFAllocatorProcess();
   Allocator* allocator = new Allocator(allocatorProcess);
 
+  // Set up the replicated log backed registry of cluster membership,
+  // if enabled (see master/registrar.hpp).
+  log::Log* log = NULL;
+  Registrar* registrar = NULL;
+
+  if (flags.registry.isSome()) {
+    if (zk.empty()) {
+      // Standalone master: a single local replica suffices.
+      log = new log::Log(
+          flags.registry_quorum,
+          flags.registry.get(),
+          std::set<process::UPID>());
+    } else {
+      // Replicas of the other masters are discovered via ZooKeeper,
+      // in a znode alongside the one used for leader election.
+      Try<zookeeper::URL> url = zookeeper::URL::parse(zk);
+
+      if (url.isError()) {
+        cerr << "Failed to parse ZooKeeper URL: " << url.error() << endl;
+        exit(1);
+      }
+
+      // NOTE: Try::get() returns by value, hence the named local.
+      const zookeeper::URL& zkurl = url.get();
+
+      log = new log::Log(
+          flags.registry_quorum,
+          flags.registry.get(),
+          zkurl.servers,
+          Seconds(10.0),
+          zkurl.path + "/log_replicas",
+          zkurl.authentication);
+    }
+
+    registrar = new Registrar(log);
+  }
+
   Files files;
-  Master* master = new Master(allocator, &files, flags);
+  Master* master = new Master(allocator, &files, flags, registrar);
   process::spawn(master);
 
   Try<MasterDetector*> detector =
@@ -133,6 +181,9 @@ int main(int argc, char** argv)
   delete allocator;
   delete allocatorProcess;
 
+  delete registrar; // Might be NULL if the registry is not enabled.
+  delete log;
+
   MasterDetector::destroy(detector.get());
 
   return 0;
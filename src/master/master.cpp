@@ -16,23 +16,40 @@
  * limitations under the License.
  */
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif // __linux__
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <list>
 #include <sstream>
 
+#include <process/async.hpp>
 #include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/id.hpp>
+#include <process/io.hpp>
 #include <process/run.hpp>
+#include <process/timing.hpp>
 
+#include <stout/numify.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/utils.hpp>
 #include <stout/uuid.hpp>
 
+#include "common/attributes.hpp"
 #include "common/build.hpp"
 #include "common/date_utils.hpp"
+#include "common/protobuf_utils.hpp"
 
 #include "flags/flags.hpp"
 
@@ -40,8 +57,11 @@
 #include "logging/logging.hpp"
 
 #include "master/allocator.hpp"
+#include "master/archive.hpp"
+#include "master/capture.hpp"
 #include "master/flags.hpp"
 #include "master/master.hpp"
+#include "master/registrar.hpp"
 #include "master/slaves_manager.hpp"
 
 namespace params = std::tr1::placeholders;
@@ -60,20 +80,93 @@ namespace mesos {
 namespace internal {
 namespace master {
 
+// Forward declaration, defined in master/http.cpp.
+void model(JSON::Writer& writer, const Framework& framework);
+
+
 class WhitelistWatcher : public Process<WhitelistWatcher> {
 public:
   WhitelistWatcher(const string& _path, Allocator* _allocator)
   : ProcessBase(ID::generate("whitelist")),
     path(_path),
-    allocator(_allocator) {}
+    allocator(_allocator),
+    fd(-1) {}
+
+  virtual ~WhitelistWatcher()
+  {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
 
 protected:
   virtual void initialize()
   {
+#ifdef __linux__
+    // Watch the whitelist's directory with inotify so that pushes
+    // take effect immediately rather than at the next poll. The
+    // directory (not the file) is watched because pushes typically
+    // replace the file via rename, which would silently detach a
+    // watch on the file itself. The periodic poll below is kept as a
+    // fallback (e.g., for files on network mounts that inotify does
+    // not cover).
+    if (path != "*") {
+      CHECK(path.find("file://") == 0)
+          << "File path " << path << " should start with file://";
+
+      Try<string> directory =
+        os::dirname(path.substr(strlen("file://")));
+
+      if (directory.isSome()) {
+        fd = inotify_init();
+        if (fd >= 0 &&
+            inotify_add_watch(
+                fd,
+                directory.get().c_str(),
+                IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0) {
+          ::close(fd);
+          fd = -1;
+        }
+
+        if (fd >= 0) {
+          os::nonblock(fd);
+          io::poll(fd, io::READ)
+            .onAny(defer(self(), &WhitelistWatcher::changed, params::_1));
+        } else {
+          LOG(WARNING) << "Failed to watch the whitelist directory with"
+                       << " inotify, falling back to polling: "
+                       << strerror(errno);
+        }
+      }
+    }
+#endif // __linux__
+
     watch();
   }
 
   void watch()
+  {
+    check(false);
+    delay(WHITELIST_WATCH_INTERVAL, self(), &WhitelistWatcher::watch);
+  }
+
+  void changed(const Future<short>& poll)
+  {
+    // Drain the notification queue; the events only say "something in
+    // the directory changed" and check() re-examines the file anyway.
+    char buffer[4096];
+    while (::read(fd, buffer, sizeof(buffer)) > 0) {}
+
+    // Bypass the mtime short circuit: mtime has second granularity,
+    // so a push arriving within the same second as the previous one
+    // would otherwise be missed.
+    check(true);
+
+    io::poll(fd, io::READ)
+      .onAny(defer(self(), &WhitelistWatcher::changed, params::_1));
+  }
+
+  void check(bool force)
   {
     // Get the list of white listed slaves.
     Option<hashset<string> > whitelist;
@@ -85,9 +178,22 @@ protected:
       CHECK(path.find("file://") == 0)
           << "File path " << path << " should start with file://";
 
+      const string file = path.substr(strlen("file://"));
+
+      // Skip the read and parse entirely when the file has not been
+      // modified since it was last parsed; with a large whitelist
+      // this is the common case for the periodic poll.
+      Try<long> mtime = os::mtime(file);
+      if (!force &&
+          mtime.isSome() &&
+          lastMtime.isSome() &&
+          mtime.get() == lastMtime.get()) {
+        return;
+      }
+
       // TODO(vinod): Ensure this read is atomic w.r.t external
       // writes/updates to this file.
-      Try<string> read = os::read(path.substr(strlen("file://")));
+      Try<string> read = os::read(file);
       if (read.isError()) {
         LOG(ERROR) << "Error reading whitelist file: " << read.error() << ". "
                    << "Retrying";
@@ -104,6 +210,10 @@ protected:
         }
         whitelist = Option<hashset<string> >::some(hostnames);
       }
+
+      if (mtime.isSome()) {
+        lastMtime = mtime.get();
+      }
     }
 
     // Send the whitelist to allocator, if necessary.
@@ -111,80 +221,150 @@ protected:
       allocator->updateWhitelist(whitelist);
     }
 
-    // Check again.
     lastWhitelist = whitelist;
-    delay(WHITELIST_WATCH_INTERVAL, self(), &WhitelistWatcher::watch);
   }
 
 private:
   const string path;
   Allocator* allocator;
   Option<hashset<string> > lastWhitelist;
+  Option<long> lastMtime;
+  int fd; // inotify descriptor, or -1 when polling only.
 };
 
 
-class SlaveObserver : public Process<SlaveObserver>
+// Monitors the liveness of every slave from a single process. The
+// old per-slave observer approach gave each slave its own process
+// with its own delay() scheduled ping cycle; with thousands of
+// slaves that meant thousands of processes churning the timer map.
+// Here the slaves are spread over a coarse timing wheel with one
+// second slots and a single repeating tick: each tick only touches
+// the slaves due in the current slot (pinging them and checking the
+// previous ping for a timeout), so the per tick cost is O(slaves
+// due) and there is exactly one timer regardless of cluster size.
+// Ping round trip times are recorded into the given histogram.
+class HeartbeatManager : public Process<HeartbeatManager>
 {
 public:
-  SlaveObserver(const UPID& _slave,
-                const SlaveInfo& _slaveInfo,
-                const SlaveID& _slaveId,
-                const PID<Master>& _master)
-    : ProcessBase(ID::generate("slave-observer")),
-      slave(_slave),
-      slaveInfo(_slaveInfo),
-      slaveId(_slaveId),
+  HeartbeatManager(const PID<Master>& _master, metrics::Histogram* _rtts)
+    : ProcessBase(ID::generate("heartbeats")),
       master(_master),
-      timeouts(0),
-      pinged(false)
+      rtts(_rtts),
+      slots(std::max(1, (int) SLAVE_PING_TIMEOUT.secs())),
+      wheel(slots),
+      position(0)
+  {
+    install("PONG", &HeartbeatManager::pong);
+  }
+
+  void watch(const UPID& pid, const SlaveInfo& info)
+  {
+    Record record;
+    record.hostname = info.hostname();
+    record.port = pid.port;
+    record.timeouts = 0;
+    record.pinged = true;
+    record.pingTime = Clock::now();
+    records[pid] = record;
+
+    send(pid, "PING");
+
+    // Due again after one full revolution of the wheel, i.e., in the
+    // slot processed most recently.
+    wheel[(position + slots - 1) % slots].push_back(pid);
+  }
+
+  void forget(const UPID& pid)
   {
-    install("PONG", &SlaveObserver::pong);
+    // The wheel entry is dropped lazily when its slot next comes up.
+    records.erase(pid);
   }
 
 protected:
   virtual void initialize()
   {
-    send(slave, "PING");
-    pinged = true;
-    delay(SLAVE_PING_TIMEOUT, self(), &SlaveObserver::timeout);
+    tick();
   }
 
-  void pong(const UPID& from, const string& body)
+  // Pongs jump ahead of housekeeping dispatches (watch/forget) so a
+  // backed up mailbox can't turn into spurious timeouts. NOTE: Runs
+  // on the enqueuing thread (see ProcessBase::classify), so it only
+  // looks at the event itself.
+  virtual int classify(const process::Event& event) const
   {
-    timeouts = 0;
-    pinged = false;
+    if (event.is<MessageEvent>() &&
+        event.as<MessageEvent>().message->name == "PONG") {
+      return Mailbox::HIGH;
+    }
+    return Mailbox::NORMAL;
   }
 
-  void timeout()
+  void pong(const UPID& from, const string& body)
   {
-    if (pinged) { // So we haven't got back a pong yet ...
-      if (++timeouts >= MAX_SLAVE_PING_TIMEOUTS) {
-        deactivate();
-        return;
+    if (records.contains(from)) {
+      Record& record = records[from];
+      if (record.pinged) {
+        rtts->record((Clock::now() - record.pingTime) * 1000000.0);
       }
+      record.timeouts = 0;
+      record.pinged = false;
     }
-
-    send(slave, "PING");
-    pinged = true;
-    delay(SLAVE_PING_TIMEOUT, self(), &SlaveObserver::timeout);
   }
 
-  void deactivate()
+  void tick()
   {
-    dispatch(
-        master,
-        &Master::deactivatedSlaveHostnamePort,
-        slaveInfo.hostname(),
-        slave.port);
+    list<UPID> due;
+    due.swap(wheel[position]);
+
+    foreach (const UPID& pid, due) {
+      if (!records.contains(pid)) {
+        continue; // Forgotten, drop the wheel entry.
+      }
+
+      Record& record = records[pid];
+
+      if (record.pinged) { // So we haven't got back a pong yet ...
+        if (++record.timeouts >= MAX_SLAVE_PING_TIMEOUTS) {
+          dispatch(
+              master,
+              &Master::deactivatedSlaveHostnamePort,
+              record.hostname,
+              record.port);
+          records.erase(pid);
+          continue;
+        }
+      }
+
+      send(pid, "PING");
+      record.pinged = true;
+      record.pingTime = Clock::now();
+
+      // Due again after a full revolution.
+      wheel[position].push_back(pid);
+    }
+
+    position = (position + 1) % slots;
+
+    delay(Seconds(1.0), self(), &HeartbeatManager::tick);
   }
 
 private:
-  const UPID slave;
-  const SlaveInfo slaveInfo;
-  const SlaveID slaveId;
+  struct Record
+  {
+    string hostname;
+    uint16_t port;
+    uint32_t timeouts;
+    bool pinged;
+    double pingTime; // When the outstanding ping was sent.
+  };
+
   const PID<Master> master;
-  uint32_t timeouts;
-  bool pinged;
+  metrics::Histogram* rtts;
+  const size_t slots;
+  std::vector<std::list<UPID> > wheel;
+  size_t position;
+
+  hashmap<UPID, Record> records;
 };
 
 
@@ -262,20 +442,32 @@ struct SlaveReregistrar
 };
 
 
-Master::Master(Allocator* _allocator, Files* _files)
+Master::Master(Allocator* _allocator, Files* _files, Registrar* _registrar)
   : ProcessBase("master"),
     flags(),
     allocator(_allocator),
     files(_files),
-    completedFrameworks(MAX_COMPLETED_FRAMEWORKS) {}
-
-
-Master::Master(Allocator* _allocator, Files* _files, const Flags& _flags)
+    archive(NULL),
+    recorder(NULL),
+    registrar(_registrar),
+    completedFrameworks(MAX_COMPLETED_FRAMEWORKS),
+    events(MAX_JOURNALED_EVENTS) {}
+
+
+Master::Master(
+    Allocator* _allocator,
+    Files* _files,
+    const Flags& _flags,
+    Registrar* _registrar)
   : ProcessBase("master"),
     flags(_flags),
     allocator(_allocator),
     files(_files),
-    completedFrameworks(MAX_COMPLETED_FRAMEWORKS) {}
+    archive(NULL),
+    recorder(NULL),
+    registrar(_registrar),
+    completedFrameworks(MAX_COMPLETED_FRAMEWORKS),
+    events(MAX_JOURNALED_EVENTS) {}
 
 
 Master::~Master()
@@ -284,6 +476,13 @@ Master::~Master()
 
   foreachvalue (Framework* framework, utils::copy(frameworks)) {
     removeFramework(framework);
+
+    // Teardown is chunked and its continuations are dispatched, but
+    // we are shutting down so no dispatch will ever run; finish the
+    // remaining chunks inline.
+    while (frameworks.contains(framework->id)) {
+      _removeFramework(framework);
+    }
   }
 
   foreachvalue (Slave* slave, utils::copy(slaves)) {
@@ -292,6 +491,10 @@ Master::~Master()
 
   CHECK(offers.size() == 0);
 
+  foreach (Offer* offer, offerPool) {
+    delete offer;
+  }
+
   terminate(slavesManager);
   wait(slavesManager);
 
@@ -301,6 +504,13 @@ Master::~Master()
   wait(whitelistWatcher);
 
   delete whitelistWatcher;
+
+  terminate(heartbeats);
+  wait(heartbeats);
+
+  delete heartbeats;
+
+  delete archive; // Might be NULL if archiving is not enabled.
 }
 
 
@@ -334,6 +544,24 @@ void Master::initialize()
   whitelistWatcher = new WhitelistWatcher(flags.whitelist, allocator);
   spawn(whitelistWatcher);
 
+  // Set up the completed framework archive, if enabled.
+  if (flags.archive_dir.isSome()) {
+    archive = new Archive(flags.archive_dir.get());
+  }
+
+  // Start capturing the inbound message stream, if enabled.
+  if (flags.capture.isSome()) {
+    Try<capture::Recorder*> open =
+      capture::Recorder::open(flags.capture.get());
+    if (open.isError()) {
+      LOG(ERROR) << "Failed to open capture file '" << flags.capture.get()
+                 << "': " << open.error();
+    } else {
+      LOG(INFO) << "Capturing inbound messages to " << flags.capture.get();
+      recorder = open.get();
+    }
+  }
+
   elected = false;
 
   nextFrameworkId = 0;
@@ -355,6 +583,43 @@ void Master::initialize()
 
   startTime = Clock::now();
 
+  stateVersion = 0;
+  renderedStateVersion = 0;
+
+  eventVersion = 0;
+
+  mirroring = false;
+  mirrorVersion = 0;
+  mirroredTime = 0.0;
+
+  // Register the operational metrics and start the publish loop
+  // (recording into the instruments is lock-free, see
+  // common/metrics.hpp).
+  launchTasksLatency = metrics.histogram("launch_tasks_latency_us");
+  statusUpdateLatency = metrics.histogram("status_update_latency_us");
+  postponedReregistrations = metrics.counter("postponed_reregistrations");
+  shedFrameworkMessages = metrics.counter("shed_framework_messages");
+  reregisteringSlavesGauge = metrics.gauge("reregistering_slaves");
+  pendingUpdatesGauge = metrics.gauge("pending_status_updates");
+
+  frameworksGauge = metrics.gauge("frameworks");
+  completedFrameworksGauge = metrics.gauge("completed_frameworks");
+  slavesGauge = metrics.gauge("slaves");
+  offersGauge = metrics.gauge("offers");
+  activeTasksGauge = metrics.gauge("active_tasks");
+  maxRssGauge = metrics.gauge("max_rss_kb");
+
+  offerAges = metrics.histogram("offer_age_us");
+  offersRescinded = metrics.counter("offers_rescinded");
+  oldestOfferAgeGauge = metrics.gauge("oldest_offer_age_secs");
+
+  publishMetrics();
+
+  // Set up the heartbeat manager that monitors all of the slaves.
+  heartbeats = new HeartbeatManager(
+      self(), metrics.histogram("slave_ping_rtt_us"));
+  spawn(heartbeats);
+
   // Install handler functions for certain messages.
   install<SubmitSchedulerRequest>(
       &Master::submitScheduler,
@@ -389,12 +654,7 @@ void Master::initialize()
       &ResourceRequestMessage::framework_id,
       &ResourceRequestMessage::requests);
 
-  install<LaunchTasksMessage>(
-      &Master::launchTasks,
-      &LaunchTasksMessage::framework_id,
-      &LaunchTasksMessage::offer_id,
-      &LaunchTasksMessage::tasks,
-      &LaunchTasksMessage::filters);
+  install<LaunchTasksMessage>(&Master::launchTasks);
 
   install<ReviveOffersMessage>(
       &Master::reviveOffers,
@@ -405,12 +665,14 @@ void Master::initialize()
       &KillTaskMessage::framework_id,
       &KillTaskMessage::task_id);
 
+  // NOTE: The 'data' payload is deliberately not bound: the master
+  // only routes these messages (see 'forward'), so the handler never
+  // needs to look at the blob.
   install<FrameworkToExecutorMessage>(
       &Master::schedulerMessage,
       &FrameworkToExecutorMessage::slave_id,
       &FrameworkToExecutorMessage::framework_id,
-      &FrameworkToExecutorMessage::executor_id,
-      &FrameworkToExecutorMessage::data);
+      &FrameworkToExecutorMessage::executor_id);
 
   install<RegisterSlaveMessage>(
       &Master::registerSlave,
@@ -421,7 +683,8 @@ void Master::initialize()
       &ReregisterSlaveMessage::slave_id,
       &ReregisterSlaveMessage::slave,
       &ReregisterSlaveMessage::executor_infos,
-      &ReregisterSlaveMessage::tasks);
+      &ReregisterSlaveMessage::tasks,
+      &ReregisterSlaveMessage::digests);
 
   install<UnregisterSlaveMessage>(
       &Master::unregisterSlave,
@@ -432,12 +695,13 @@ void Master::initialize()
       &StatusUpdateMessage::update,
       &StatusUpdateMessage::pid);
 
+  // As with FrameworkToExecutorMessage above, the 'data' payload is
+  // not bound since the handler only forwards it.
   install<ExecutorToFrameworkMessage>(
       &Master::executorMessage,
       &ExecutorToFrameworkMessage::slave_id,
       &ExecutorToFrameworkMessage::framework_id,
-      &ExecutorToFrameworkMessage::executor_id,
-      &ExecutorToFrameworkMessage::data);
+      &ExecutorToFrameworkMessage::executor_id);
 
   install<ExitedExecutorMessage>(
       &Master::exitedExecutor,
@@ -451,6 +715,11 @@ void Master::initialize()
   route("/vars", bind(&http::vars, cref(*this), params::_1));
   route("/stats.json", bind(&http::json::stats, cref(*this), params::_1));
   route("/state.json", bind(&http::json::state, cref(*this), params::_1));
+  route("/state-summary.json",
+        bind(&http::json::summary, cref(*this), params::_1));
+  route("/tasks.json", bind(&http::json::tasks, cref(*this), params::_1));
+  route("/events.json", bind(&http::json::events, cref(*this), params::_1));
+  route("/archive.json", bind(&http::json::archive, cref(*this), params::_1));
 
   // Provide HTTP assets from a "webui" directory. This is either
   // specified via flags (which is necessary for running out of the
@@ -475,9 +744,34 @@ void Master::initialize()
 void Master::finalize()
 {
   LOG(INFO) << "Master terminating";
+
+  // Complete the long polls parked on the event feed so that their
+  // connections are not left dangling.
+  completeEventWaiters();
+
   foreachvalue (Slave* slave, slaves) {
     send(slave->pid, ShutdownMessage());
   }
+
+  delete recorder; // Appends the clean-close footer.
+  recorder = NULL;
+}
+
+
+void Master::visit(const process::MessageEvent& event)
+{
+  // Append the message before handling it, so that a capture replays
+  // in exactly the order the master saw.
+  if (recorder != NULL) {
+    Try<Nothing> recorded = recorder->record(*event.message);
+    if (recorded.isError()) {
+      LOG(ERROR) << "Stopping message capture: " << recorded.error();
+      delete recorder;
+      recorder = NULL;
+    }
+  }
+
+  ProtobufProcess<Master>::visit(event);
 }
 
 
@@ -568,6 +862,28 @@ void Master::exited(const UPID& pid)
 }
 
 
+int Master::classify(const process::Event& event) const
+{
+  if (event.is<MessageEvent>()) {
+    // Resolved once: protobuf type names are what
+    // ProtobufProcess::install keys handlers on.
+    static const string STATUS_UPDATE = StatusUpdateMessage().GetTypeName();
+
+    // Status updates get retried by slaves until forwarded, so
+    // letting them wait behind bulk traffic just multiplies it.
+    if (event.as<MessageEvent>().message->name == STATUS_UPDATE) {
+      return Mailbox::HIGH;
+    }
+  } else if (event.is<HttpEvent>()) {
+    // A burst of state rendering requests should not delay protocol
+    // traffic.
+    return Mailbox::BULK;
+  }
+
+  return Mailbox::NORMAL;
+}
+
+
 void Master::fileAttached(const Future<Nothing>& result, const string& path)
 {
   CHECK(!result.isDiscarded());
@@ -597,11 +913,29 @@ void Master::newMasterDetected(const UPID& pid)
 
   leader = pid;
 
+  invalidateState();
+
   if (leader != self() && !elected) {
     LOG(INFO) << "Waiting to be master!";
+
+    // Start mirroring the leader's rendered state so that this
+    // standby can serve state queries too (see Master::mirror).
+    if (!mirroring) {
+      mirroring = true;
+      mirrorVersion = 0;
+      mirror();
+    }
   } else if (leader == self() && !elected) {
     LOG(INFO) << "Elected as master!";
     elected = true;
+
+    // Recover the registry (if enabled): authoritative membership
+    // loads from the replicated log in seconds, and re-registrations
+    // become reconciliation against known state.
+    if (registrar != NULL) {
+      registrar->recover()
+        .onAny(defer(self(), &Self::_recoverRegistry, params::_1));
+    }
   } else if (leader != self() && elected) {
     LOG(FATAL) << "No longer elected master ... committing suicide!";
   } else if (leader == self() && elected) {
@@ -681,6 +1015,15 @@ void Master::reregisterFramework(const FrameworkInfo& frameworkInfo,
   LOG(INFO) << "Re-registering framework " << frameworkInfo.id()
             << " at " << from;
 
+  if (removingFrameworks.contains(frameworkInfo.id())) {
+    // The framework's chunked teardown is still in flight; ignore the
+    // message (the scheduler driver retries) rather than failing over
+    // a framework that is half removed.
+    LOG(INFO) << "Ignoring re-register framework message for framework "
+              << frameworkInfo.id() << " since it is being removed";
+    return;
+  }
+
   if (frameworks.count(frameworkInfo.id()) > 0) {
     // Using the "failover" of the scheduler allows us to keep a
     // scheduler that got partitioned but didn't die (in ZooKeeper
@@ -805,53 +1148,125 @@ void Master::deactivateFramework(const FrameworkID& frameworkId)
 void Master::resourceRequest(const FrameworkID& frameworkId,
                              const vector<Request>& requests)
 {
+  if (shedFrameworkMessage(frameworkId)) {
+    VLOG(1) << "Dropping resource request from framework " << frameworkId
+            << " due to rate limiting";
+    return;
+  }
+
   allocator->resourcesRequested(frameworkId, requests);
 }
 
 
-void Master::launchTasks(const FrameworkID& frameworkId,
-                         const OfferID& offerId,
-                         const vector<TaskInfo>& tasks,
-                         const Filters& filters)
+void Master::launchTasks(const LaunchTasksMessage& message)
 {
-  Framework* framework = getFramework(frameworkId);
-  if (framework != NULL) {
-    // TODO(benh): Support offer "hoarding" and allow multiple offers
-    // *from the same slave* to be used to launch tasks. This can be
-    // accomplished rather easily by collecting and merging all offers
-    // into a mega-offer and passing that offer to
-    // Master::processTasks.
+  TIMED_SCOPE("master/launch_tasks");
+  metrics::Timed timed(launchTasksLatency);
+
+  Framework* framework = getFramework(message.framework_id());
+  if (framework == NULL) {
+    return;
+  }
+
+  // Collect the offers this reply spans. Old schedulers send the
+  // singular 'offer_id'; new schedulers may aggregate several offers
+  // (possibly across slaves) into a single launch via 'offer_ids'.
+  vector<OfferID> offerIds;
+  if (message.offer_ids_size() > 0) {
+    foreach (const OfferID& offerId, message.offer_ids()) {
+      offerIds.push_back(offerId);
+    }
+  } else if (message.has_offer_id()) {
+    offerIds.push_back(message.offer_id());
+  }
+
+  // Look up the offers and group them (and the slaves they name) by
+  // slave, so that each slave's tasks get validated and forwarded in
+  // a single pass further below.
+  hashmap<Slave*, vector<Offer*> > offers;
+  hashmap<SlaveID, Slave*> offered;
+  bool valid = !offerIds.empty();
+
+  foreach (const OfferID& offerId, offerIds) {
     Offer* offer = getOffer(offerId);
-    if (offer != NULL) {
-      CHECK(offer->framework_id() == frameworkId);
+    if (offer == NULL) {
+      LOG(WARNING) << "Offer " << offerId << " is no longer valid";
+      valid = false;
+    } else {
+      CHECK(offer->framework_id() == framework->id);
       Slave* slave = getSlave(offer->slave_id());
       CHECK(slave != NULL) << "An offer should not outlive a slave!";
-      processTasks(offer, framework, slave, tasks, filters);
+      offers[slave].push_back(offer);
+      offered[slave->id] = slave;
+    }
+  }
+
+  if (!valid) {
+    // One of the offers is gone (possibly rescinded, lost slave,
+    // re-reply to same offer, etc). Consume any offers that are still
+    // outstanding and report all tasks as failed.
+    // TODO: Consider adding a new task state TASK_INVALID for
+    // situations like these.
+    foreachpair (Slave* slave, const vector<Offer*>& collected, offers) {
+      processTasks(
+          collected, framework, slave, vector<TaskInfo>(), message.filters());
+    }
+
+    foreach (const TaskInfo& task, message.tasks()) {
+      StatusUpdateMessage lost;
+      StatusUpdate* update = lost.mutable_update();
+      update->mutable_framework_id()->MergeFrom(framework->id);
+      TaskStatus* status = update->mutable_status();
+      status->mutable_task_id()->MergeFrom(task.task_id());
+      status->set_state(TASK_LOST);
+      status->set_message("Task launched with invalid offer");
+      update->set_timestamp(Clock::now());
+      update->set_uuid(UUID::random().toBytes());
+      send(framework->pid, lost);
+    }
+    return;
+  }
+
+  // Partition the tasks across the offered slaves. A task naming a
+  // slave that was not offered is reported as failed (this mirrors
+  // what the SlaveIDChecker does for a single offer).
+  hashmap<Slave*, vector<TaskInfo> > assigned;
+
+  foreach (const TaskInfo& task, message.tasks()) {
+    if (offered.contains(task.slave_id())) {
+      assigned[offered[task.slave_id()]].push_back(task);
     } else {
-      // The offer is gone (possibly rescinded, lost slave, re-reply
-      // to same offer, etc). Report all tasks in it as failed.
-      // TODO: Consider adding a new task state TASK_INVALID for
-      // situations like these.
-      LOG(WARNING) << "Offer " << offerId << " is no longer valid";
-      foreach (const TaskInfo& task, tasks) {
-        StatusUpdateMessage message;
-        StatusUpdate* update = message.mutable_update();
-        update->mutable_framework_id()->MergeFrom(frameworkId);
-        TaskStatus* status = update->mutable_status();
-        status->mutable_task_id()->MergeFrom(task.task_id());
-        status->set_state(TASK_LOST);
-        status->set_message("Task launched with invalid offer");
-        update->set_timestamp(Clock::now());
-        update->set_uuid(UUID::random().toBytes());
-        send(framework->pid, message);
-      }
+      LOG(WARNING) << "Task " << task.task_id()
+                   << " uses invalid slave " << task.slave_id();
+      StatusUpdateMessage lost;
+      StatusUpdate* update = lost.mutable_update();
+      update->mutable_framework_id()->MergeFrom(framework->id);
+      TaskStatus* status = update->mutable_status();
+      status->mutable_task_id()->MergeFrom(task.task_id());
+      status->set_state(TASK_LOST);
+      status->set_message("Task uses invalid slave: " +
+                          task.slave_id().value());
+      update->set_timestamp(Clock::now());
+      update->set_uuid(UUID::random().toBytes());
+      send(framework->pid, lost);
     }
   }
+
+  foreachpair (Slave* slave, const vector<Offer*>& collected, offers) {
+    processTasks(
+        collected, framework, slave, assigned[slave], message.filters());
+  }
 }
 
 
 void Master::reviveOffers(const FrameworkID& frameworkId)
 {
+  if (shedFrameworkMessage(frameworkId)) {
+    VLOG(1) << "Dropping offer revival from framework " << frameworkId
+            << " due to rate limiting";
+    return;
+  }
+
   Framework* framework = getFramework(frameworkId);
   if (framework != NULL) {
     LOG(INFO) << "Reviving offers for framework " << framework->id;
@@ -909,8 +1324,7 @@ void Master::killTask(const FrameworkID& frameworkId,
 
 void Master::schedulerMessage(const SlaveID& slaveId,
                               const FrameworkID& frameworkId,
-                              const ExecutorID& executorId,
-                              const string& data)
+                              const ExecutorID& executorId)
 {
   Framework* framework = getFramework(frameworkId);
   if (framework != NULL) {
@@ -920,12 +1334,9 @@ void Master::schedulerMessage(const SlaveID& slaveId,
                 << frameworkId << " to slave " << slaveId
                 << " (" << slave->info.hostname() << ")";
 
-      FrameworkToExecutorMessage message;
-      message.mutable_slave_id()->MergeFrom(slaveId);
-      message.mutable_framework_id()->MergeFrom(frameworkId);
-      message.mutable_executor_id()->MergeFrom(executorId);
-      message.set_data(data);
-      send(slave->pid, message);
+      // Forward the message verbatim: the master never looks at the
+      // data blob, so there is no reason to re-encode it.
+      forward(slave->pid);
 
       stats.validFrameworkMessages++;
     } else {
@@ -987,10 +1398,38 @@ void Master::registerSlave(const SlaveInfo& slaveInfo)
 }
 
 
+// Validates and summarizes the (possibly very large) executor and
+// task lists carried by a slave re-registration, returning the
+// resources allocated per framework. This is pure computation over
+// copies of the lists so it can safely run off the Master process
+// (see Master::reregisterSlave).
+static hashmap<FrameworkID, Resources> summarize(
+    const vector<ExecutorInfo>& executorInfos,
+    const vector<Task>& tasks)
+{
+  hashmap<FrameworkID, Resources> resources;
+
+  foreach (const ExecutorInfo& executorInfo, executorInfos) {
+    // TODO(benh): Remove this check if framework_id becomes required
+    // on ExecutorInfo (which will also mean we can remove setting it
+    // in the slave).
+    CHECK(executorInfo.has_framework_id());
+    resources[executorInfo.framework_id()] += executorInfo.resources();
+  }
+
+  foreach (const Task& task, tasks) {
+    resources[task.framework_id()] += task.resources();
+  }
+
+  return resources;
+}
+
+
 void Master::reregisterSlave(const SlaveID& slaveId,
                              const SlaveInfo& slaveInfo,
                              const vector<ExecutorInfo>& executorInfos,
-                             const vector<Task>& tasks)
+                             const vector<Task>& tasks,
+                             const vector<FrameworkDigest>& digests)
 {
   if (!elected) {
     LOG(WARNING) << "Ignoring re-register slave message from "
@@ -1001,6 +1440,11 @@ void Master::reregisterSlave(const SlaveID& slaveId,
   if (slaveId == "") {
     LOG(ERROR) << "Slave re-registered without an id!";
     reply(ShutdownMessage());
+  } else if (!digests.empty()) {
+    // Digest negotiation: the slave sent only per-framework content
+    // digests of its state, to avoid shipping the (possibly very
+    // large) executor and task lists when our view is current.
+    reregisterSlaveDigests(slaveId, slaveInfo, digests);
   } else {
     Slave* slave = getSlave(slaveId);
     if (slave != NULL) {
@@ -1022,17 +1466,72 @@ void Master::reregisterSlave(const SlaveID& slaveId,
 
       // Update the slave pid and relink to it.
       slave->pid = from;
-      link(slave->pid);
+      link(slave->pid, SocketOptions::control());
+
+      // Send the latest framework pids to the slave.
+      sendFrameworkPids(slave, tasks);
     } else {
+      // A retry from a slave whose re-registration is already being
+      // prepared; it will get its acknowledgement once the merge
+      // completes (see _reregisterSlave).
+      if (reregistering.contains(slaveId)) {
+        LOG(INFO) << "Ignoring re-register slave message from "
+                  << slaveInfo.hostname()
+                  << " since re-registration is already in progress";
+        return;
+      }
+
+      // Admission control: after a failover every slave re-registers
+      // nearly simultaneously, each carrying its full task and
+      // executor state. Only admit a bounded number at a time and
+      // let the rest retry later (ReregisterSlaveMessage is sent on
+      // a timer), keeping the master responsive while the backlog
+      // drains.
+      if (reregistering.size() >= MAX_REREGISTERING_SLAVES) {
+        postponedReregistrations->increment();
+        LOG(INFO) << "Postponing re-registration of slave at " << from
+                  << " (" << slaveInfo.hostname() << "): "
+                  << reregistering.size()
+                  << " re-registrations already in progress";
+        return;
+      }
+
       slave = new Slave(slaveInfo, slaveId, from, Clock::now());
 
       LOG(INFO) << "Attempting to re-register slave " << slave->id << " at "
                 << slave->pid << " (" << slave->info.hostname() << ")";
 
+      // Reconcile against the membership recovered from the
+      // registry: an unknown id most likely means the slave's
+      // removal was journaled while it was partitioned.
+      if (recoveredRegistry.isSome()) {
+        // NOTE: Option::get() returns by value, hence the named local.
+        const Registry& registry = recoveredRegistry.get();
+        bool known = false;
+        foreach (const Registry::Slave& entry, registry.slaves()) {
+          if (entry.id() == slave->id) {
+            known = true;
+            break;
+          }
+        }
+        if (!known) {
+          LOG(WARNING) << "Re-registering slave " << slave->id
+                       << " is not present in the recovered registry";
+        }
+      }
+
       // TODO(benh): We assume all slaves can register for now.
       CHECK(flags.slaves == "*");
       activatedSlaveHostnamePort(slave->info.hostname(), slave->pid.port);
-      readdSlave(slave, executorInfos, tasks);
+
+      // Validating and summarizing the bulky executor and task lists
+      // is pure computation, so run it on a worker thread and only
+      // apply the final state merge on this process.
+      reregistering.insert(slaveId);
+
+      async(&summarize, executorInfos, tasks)
+        .onAny(defer(self(), &Self::_reregisterSlave,
+                     slave, executorInfos, tasks, params::_1));
 
 //       // Checks if this slave, or if all slaves, can be accepted.
 //       if (slaveHostnamePorts.contains(slaveInfo.hostname(), from.port)) {
@@ -1047,20 +1546,142 @@ void Master::reregisterSlave(const SlaveID& slaveId,
 //         reply(ShutdownMessage());
 //       }
     }
+  }
+}
 
-    // Send the latest framework pids to the slave.
-    CHECK_NOTNULL(slave);
-    hashset<UPID> pids;
-    foreach (const Task& task, tasks) {
-      Framework* framework = getFramework(task.framework_id());
-      if (framework != NULL && !pids.contains(framework->pid)) {
-        UpdateFrameworkMessage message;
-        message.mutable_framework_id()->MergeFrom(framework->id);
-        message.set_pid(framework->pid);
-        send(slave->pid, message);
 
-        pids.insert(framework->pid);
-      }
+void Master::reregisterSlaveDigests(
+    const SlaveID& slaveId,
+    const SlaveInfo& slaveInfo,
+    const vector<FrameworkDigest>& digests)
+{
+  Slave* slave = getSlave(slaveId);
+
+  ReregisterSlaveRequestMessage request;
+  request.mutable_slave_id()->MergeFrom(slaveId);
+
+  if (slave == NULL) {
+    // We do not know this slave (e.g., we just failed over): we need
+    // everything.
+    LOG(INFO) << "Requesting full re-registration state from slave "
+              << slaveId << " at " << from
+              << " (" << slaveInfo.hostname() << ")";
+    reply(request);
+    return;
+  }
+
+  // Compute our own per-framework digests of the slave's state.
+  // NOTE: Frameworks we have state for that the slave did not offer
+  // a digest for are not requested: the slave has nothing to send
+  // for them, and for a known slave we keep our own view regardless
+  // (as in the full re-registration path below).
+  hashmap<FrameworkID, uint64_t> state;
+
+  foreachkey (const FrameworkID& frameworkId, slave->executors) {
+    foreachkey (const ExecutorID& executorId, slave->executors[frameworkId]) {
+      state[frameworkId] += protobuf::digest(executorId);
+    }
+  }
+
+  foreachvalue (Task* task, slave->tasks) {
+    state[task->framework_id()] += protobuf::digest(*task);
+  }
+
+  foreach (const FrameworkDigest& digest, digests) {
+    const Option<uint64_t> expected = state.get(digest.framework_id());
+    if (expected.isNone() || expected.get() != digest.digest()) {
+      request.add_framework_ids()->MergeFrom(digest.framework_id());
+    }
+  }
+
+  if (request.framework_ids_size() > 0) {
+    LOG(INFO) << "Digests of " << request.framework_ids_size()
+              << " framework(s) on slave " << slaveId
+              << " do not match; requesting their full state";
+    reply(request);
+    return;
+  }
+
+  // Every digest matches: complete the re-registration without the
+  // executor and task lists ever going on the wire.
+  LOG(INFO) << "Re-registered slave " << slaveId << " at " << from
+            << " (" << slaveInfo.hostname() << ") via digests";
+
+  SlaveReregisteredMessage message;
+  message.mutable_slave_id()->MergeFrom(slave->id);
+  reply(message);
+
+  // Update the slave pid and relink to it.
+  slave->pid = from;
+  link(slave->pid, SocketOptions::control());
+
+  // Send the latest framework pids to the slave.
+  sendFrameworkPids(slave);
+}
+
+
+void Master::_reregisterSlave(
+    Slave* slave,
+    const vector<ExecutorInfo>& executorInfos,
+    const vector<Task>& tasks,
+    const Future<hashmap<FrameworkID, Resources> >& prepared)
+{
+  CHECK_NOTNULL(slave);
+  CHECK(reregistering.contains(slave->id));
+
+  reregistering.erase(slave->id);
+
+  if (!prepared.isReady()) {
+    LOG(ERROR) << "Failed to prepare re-registration of slave " << slave->id
+               << " (" << slave->info.hostname() << "): "
+               << (prepared.isFailed() ? prepared.failure() : "discarded");
+    delete slave;
+    return;
+  }
+
+  // NOTE: Future::get returns by value, hence the named local.
+  const hashmap<FrameworkID, Resources> resources = prepared.get();
+
+  _readdSlave(slave, executorInfos, tasks, resources);
+
+  // Send the latest framework pids to the slave.
+  sendFrameworkPids(slave, tasks);
+}
+
+
+void Master::sendFrameworkPids(Slave* slave, const vector<Task>& tasks)
+{
+  CHECK_NOTNULL(slave);
+
+  hashset<UPID> pids;
+  foreach (const Task& task, tasks) {
+    Framework* framework = getFramework(task.framework_id());
+    if (framework != NULL && !pids.contains(framework->pid)) {
+      UpdateFrameworkMessage message;
+      message.mutable_framework_id()->MergeFrom(framework->id);
+      message.set_pid(framework->pid);
+      send(slave->pid, message);
+
+      pids.insert(framework->pid);
+    }
+  }
+}
+
+
+void Master::sendFrameworkPids(Slave* slave)
+{
+  CHECK_NOTNULL(slave);
+
+  hashset<UPID> pids;
+  foreachvalue (Task* task, slave->tasks) {
+    Framework* framework = getFramework(task->framework_id());
+    if (framework != NULL && !pids.contains(framework->pid)) {
+      UpdateFrameworkMessage message;
+      message.mutable_framework_id()->MergeFrom(framework->id);
+      message.set_pid(framework->pid);
+      send(slave->pid, message);
+
+      pids.insert(framework->pid);
     }
   }
 }
@@ -1081,6 +1702,8 @@ void Master::unregisterSlave(const SlaveID& slaveId)
 
 void Master::statusUpdate(const StatusUpdate& update, const UPID& pid)
 {
+  metrics::Timed timed(statusUpdateLatency);
+
   const TaskStatus& status = update.status();
 
   LOG(INFO) << "Status update from " << from
@@ -1092,16 +1715,30 @@ void Master::statusUpdate(const StatusUpdate& update, const UPID& pid)
   if (slave != NULL) {
     Framework* framework = getFramework(update.framework_id());
     if (framework != NULL) {
-      // Pass on the (transformed) status update to the framework.
-      StatusUpdateMessage message;
-      message.mutable_update()->MergeFrom(update);
-      message.set_pid(pid);
-      send(framework->pid, message);
+      // Buffer the (transformed) status update so that a burst of
+      // updates destined for the same scheduler (e.g., a large job
+      // finishing) gets forwarded in a single batched message rather
+      // than paying per-message overhead for each update.
+      StatusUpdateMessage* forward =
+        pendingUpdates[framework->id].add_updates();
+      forward->mutable_update()->MergeFrom(update);
+      forward->set_pid(pid);
+
+      if (pendingUpdates[framework->id].updates_size() == 1) {
+        delay(STATUS_UPDATE_BATCH_WAIT,
+              self(),
+              &Master::forwardStatusUpdates,
+              framework->id);
+      }
 
       // Lookup the task and see if we need to update anything locally.
       Task* task = slave->getTask(update.framework_id(), status.task_id());
       if (task != NULL) {
-        task->set_state(status.state());
+        framework->setTaskState(task, status.state());
+
+        invalidateState(update.framework_id());
+
+        journal("task_updated", *task);
 
         // Handle the task appropriately if it's terminated.
         if (status.state() == TASK_FINISHED ||
@@ -1138,8 +1775,7 @@ void Master::statusUpdate(const StatusUpdate& update, const UPID& pid)
 
 void Master::executorMessage(const SlaveID& slaveId,
                              const FrameworkID& frameworkId,
-                             const ExecutorID& executorId,
-                             const string& data)
+                             const ExecutorID& executorId)
 {
   Slave* slave = getSlave(slaveId);
   if (slave != NULL) {
@@ -1148,12 +1784,10 @@ void Master::executorMessage(const SlaveID& slaveId,
       LOG(INFO) << "Sending framework message from slave " << slaveId << " ("
                 << slave->info.hostname() << ")"
                 << " to framework " << frameworkId;
-      ExecutorToFrameworkMessage message;
-      message.mutable_slave_id()->MergeFrom(slaveId);
-      message.mutable_framework_id()->MergeFrom(frameworkId);
-      message.mutable_executor_id()->MergeFrom(executorId);
-      message.set_data(data);
-      send(framework->pid, message);
+
+      // Forward the message verbatim; as with 'schedulerMessage' the
+      // master never looks at the data blob.
+      forward(framework->pid);
 
       stats.validFrameworkMessages++;
     } else {
@@ -1224,6 +1858,8 @@ void Master::activatedSlaveHostnamePort(const string& hostname, uint16_t port)
   LOG(INFO) << "Master now considering a slave at "
             << hostname << ":" << port << " as active";
   slaveHostnamePorts.put(hostname, port);
+
+  invalidateState();
 }
 
 
@@ -1246,6 +1882,8 @@ void Master::deactivatedSlaveHostnamePort(const string& hostname,
     LOG(INFO) << "Master now considering a slave at "
 	            << hostname << ":" << port << " as inactive";
     slaveHostnamePorts.remove(hostname, port);
+
+    invalidateState();
   }
 }
 
@@ -1293,7 +1931,7 @@ void Master::offer(const FrameworkID& frameworkId,
 
     Slave* slave = slaves[slaveId];
 
-    Offer* offer = new Offer();
+    Offer* offer = acquireOffer();
     offer->mutable_id()->MergeFrom(newOfferId());
     offer->mutable_framework_id()->MergeFrom(framework->id);
     offer->mutable_slave_id()->MergeFrom(slave->id);
@@ -1311,10 +1949,24 @@ void Master::offer(const FrameworkID& frameworkId,
     }
 
     offers[offer->id()] = offer;
+    offerTimes[offer->id()] = Clock::now();
 
     framework->addOffer(offer);
     slave->addOffer(offer);
 
+    // Rescind the offer if the framework leaves it unanswered for
+    // too long (the framework's own timeout takes precedence over
+    // the master default). The delay rides the libprocess timing
+    // wheel, so lots of outstanding offers stay cheap.
+    Duration timeout = flags.offer_timeout;
+    if (framework->info.offer_timeout() > 0.0) {
+      timeout = Seconds(framework->info.offer_timeout());
+    }
+
+    if (timeout > Seconds(0.0)) {
+      delay(timeout, self(), &Master::offerTimeout, offer->id());
+    }
+
     // Add the offer *AND* the corresponding slave's PID.
     message.add_offers()->MergeFrom(*offer);
     message.add_pids(slave->pid);
@@ -1324,6 +1976,8 @@ void Master::offer(const FrameworkID& frameworkId,
     return;
   }
 
+  invalidateState(frameworkId);
+
   LOG(INFO) << "Sending " << message.offers().size()
             << " offers to framework " << framework->id;
 
@@ -1544,21 +2198,37 @@ struct CheckpointChecker : TaskInfoVisitor
 };
 
 
-// Process a resource offer reply (for a non-cancelled offer) by
-// launching the desired tasks (if the offer contains a valid set of
-// tasks) and reporting used resources to the allocator.
-void Master::processTasks(Offer* offer,
+// Process a resource offer reply (for non-cancelled offers, all from
+// the same slave) by launching the desired tasks (if the offers
+// contain a valid set of tasks) and reporting used resources to the
+// allocator.
+void Master::processTasks(const vector<Offer*>& offers,
                           Framework* framework,
                           Slave* slave,
                           const vector<TaskInfo>& tasks,
                           const Filters& filters)
 {
-  LOG(INFO) << "Processing reply for offer " << offer->id()
+  CHECK(!offers.empty());
+
+  LOG(INFO) << "Processing reply for " << offers.size() << " offer(s)"
             << " on slave " << slave->id
             << " (" << slave->info.hostname() << ")"
             << " for framework " << framework->id;
 
-  Resources usedResources; // Accumulated resources used from this offer.
+  // Merge the offers into a single "mega-offer" so that the task
+  // visitors (and the unused resources calculation below) see the
+  // combined resources being replied to.
+  Offer merged = *offers[0];
+  for (size_t i = 1; i < offers.size(); i++) {
+    CHECK(offers[i]->slave_id() == merged.slave_id());
+    merged.mutable_resources()->MergeFrom(offers[i]->resources());
+  }
+
+  Offer* offer = &merged;
+
+  Resources usedResources; // Accumulated resources used from these offers.
+
+  vector<TaskInfo> launched; // Tasks that passed validation.
 
   // Create task visitors.
   list<TaskInfoVisitor*> visitors;
@@ -1584,6 +2254,7 @@ void Master::processTasks(Offer* offer,
     if (error.isNone()) {
       // Task looks good, get it running!
       usedResources += launchTask(task, framework, slave);
+      launched.push_back(task);
     } else {
       // Error validating task, send a failed status update.
       LOG(WARNING) << "Error validating task " << task.task_id()
@@ -1608,6 +2279,20 @@ void Master::processTasks(Offer* offer,
     delete visitor;
   } while (!visitors.empty());
 
+  // Tell the slave to launch the tasks, all in one message so the
+  // slave can amortize checkpointing and executor bookkeeping across
+  // the co-scheduled tasks rather than repeating it per task.
+  if (!launched.empty()) {
+    RunTasksMessage message;
+    message.mutable_framework()->MergeFrom(framework->info);
+    message.mutable_framework_id()->MergeFrom(framework->id);
+    message.set_pid(framework->pid);
+    foreach (const TaskInfo& task, launched) {
+      message.add_tasks()->MergeFrom(task);
+    }
+    send(slave->pid, message);
+  }
+
   // All used resources should be allocatable, enforced by our validators.
   CHECK(usedResources == usedResources.allocatable());
 
@@ -1622,7 +2307,9 @@ void Master::processTasks(Offer* offer,
                                filters);
   }
 
-  removeOffer(offer);
+  foreach (Offer* offer, offers) {
+    removeOffer(offer);
+  }
 }
 
 
@@ -1670,21 +2357,19 @@ Resources Master::launchTask(const TaskInfo& task,
 
   resources += task.resources();
 
-  // Tell the slave to launch the task!
+  // NOTE: The task is delivered to the slave batched with the rest
+  // of the co-scheduled tasks (see processTasks).
   LOG(INFO) << "Launching task " << task.task_id()
             << " of framework " << framework->id
             << " with resources " << task.resources() << " on slave "
             << slave->id << " (" << slave->info.hostname() << ")";
 
-  RunTaskMessage message;
-  message.mutable_framework()->MergeFrom(framework->info);
-  message.mutable_framework_id()->MergeFrom(framework->id);
-  message.set_pid(framework->pid);
-  message.mutable_task()->MergeFrom(task);
-  send(slave->pid, message);
-
   stats.tasks[TASK_STAGING]++;
 
+  invalidateState(framework->id);
+
+  journal("task_added", *t);
+
   return resources;
 }
 
@@ -1695,7 +2380,19 @@ void Master::addFramework(Framework* framework)
 
   frameworks[framework->id] = framework;
 
-  link(framework->pid);
+  // Journal the registration to the registry, as for addSlave.
+  if (registrar != NULL) {
+    Registry::Framework entry;
+    entry.mutable_id()->CopyFrom(framework->id);
+    entry.mutable_info()->CopyFrom(framework->info);
+    entry.set_pid(string(framework->pid));
+    registrar->admitFramework(entry)
+      .onAny(defer(self(), &Self::_registryOperation, params::_1,
+                   "admit framework " + stringify(framework->id)));
+  }
+
+  // Scheduler links carry many small latency sensitive messages.
+  link(framework->pid, SocketOptions::control());
 
   FrameworkRegisteredMessage message;
   message.mutable_framework_id()->MergeFrom(framework->id);
@@ -1705,6 +2402,10 @@ void Master::addFramework(Framework* framework)
   allocator->frameworkAdded(framework->id,
                             framework->info,
                             framework->resources);
+
+  invalidateState(framework->id);
+
+  journal("framework_added", *framework);
 }
 
 
@@ -1723,7 +2424,7 @@ void Master::failoverFramework(Framework* framework, const UPID& newPid)
   // TODO(benh): unlink(oldPid);
 
   framework->pid = newPid;
-  link(newPid);
+  link(newPid, SocketOptions::control());
 
   // Make sure we can get offers again.
   if (!framework->active) {
@@ -1751,14 +2452,35 @@ void Master::failoverFramework(Framework* framework, const UPID& newPid)
                                   Resources(offer->resources()));
     removeOffer(offer);
   }
+
+  invalidateState(framework->id);
 }
 
 
 void Master::removeFramework(Framework* framework)
 {
+  if (removingFrameworks.contains(framework->id)) {
+    return; // Teardown is already in progress.
+  }
+
+  removingFrameworks.insert(framework->id);
+
   if (framework->active) {
     // Tell the allocator to stop allocating resources to this framework.
     allocator->frameworkDeactivated(framework->id);
+
+    // Bounce any in-flight allocations that arrive while the rest of
+    // the teardown is interleaved with other events (see
+    // Master::offer).
+    framework->active = false;
+  }
+
+  journal("framework_removed", *framework);
+
+  if (registrar != NULL) {
+    registrar->removeFramework(framework->id)
+      .onAny(defer(self(), &Self::_registryOperation, params::_1,
+                   "remove framework " + stringify(framework->id)));
   }
 
   // Tell slaves to shutdown the framework.
@@ -1768,15 +2490,6 @@ void Master::removeFramework(Framework* framework)
     send(slave->pid, message);
   }
 
-  // Remove pointers to the framework's tasks in slaves.
-  foreachvalue (Task* task, utils::copy(framework->tasks)) {
-    Slave* slave = getSlave(task->slave_id());
-    // Since we only find out about tasks when the slave reregisters,
-    // it must be the case that the slave exists!
-    CHECK(slave != NULL);
-    removeTask(task);
-  }
-
   // Remove the framework's offers (if they weren't removed before).
   foreach (Offer* offer, utils::copy(framework->offers)) {
     allocator->resourcesRecovered(offer->framework_id(),
@@ -1800,19 +2513,68 @@ void Master::removeFramework(Framework* framework)
     }
   }
 
+  framework->unregisteredTime = Clock::now();
+
+  // Flush any status updates still awaiting their batch window.
+  forwardStatusUpdates(framework->id);
+
+  // Remove the framework's tasks in bounded chunks so that tearing
+  // down a framework with tens of thousands of tasks does not stall
+  // the event loop; the rest of the teardown happens when the last
+  // chunk is done.
+  _removeFramework(framework);
+}
+
+
+void Master::_removeFramework(Framework* framework)
+{
+  // Remove (up to) one chunk of the framework's tasks.
+  size_t removed = 0;
+  foreachvalue (Task* task, utils::copy(framework->tasks)) {
+    if (removed == TEARDOWN_TASKS_PER_CHUNK) {
+      break;
+    }
+
+    Slave* slave = getSlave(task->slave_id());
+    // Since we only find out about tasks when the slave reregisters,
+    // it must be the case that the slave exists!
+    CHECK(slave != NULL);
+    removeTask(task);
+    removed++;
+  }
+
+  if (!framework->tasks.empty()) {
+    // More tasks remain; requeue so that other queued events get
+    // processed in between the chunks.
+    dispatch(self(), &Self::_removeFramework, framework);
+    return;
+  }
+
   // TODO(benh): Similar code between removeFramework and
   // failoverFramework needs to be shared!
 
   // TODO(benh): unlink(framework->pid);
 
-  framework->unregisteredTime = Clock::now();
+  // Spill the framework's record (including its completed tasks) to
+  // the archive, so history survives eviction from the in-memory
+  // circular buffer. Archival is asynchronous and best effort.
+  if (archive != NULL) {
+    JSON::Writer writer;
+    model(writer, *framework);
+    archive->archive(framework->id.value(), writer.str());
+  }
 
   // The completedFramework buffer now owns the framework pointer.
   completedFrameworks.push_back(std::tr1::shared_ptr<Framework>(framework));
-  
+
   // Remove it.
   frameworks.erase(framework->id);
   allocator->frameworkRemoved(framework->id);
+
+  frameworkStateVersions.erase(framework->id);
+  buckets.erase(framework->id);
+  removingFrameworks.erase(framework->id);
+  invalidateState();
 }
 
 
@@ -1888,7 +2650,27 @@ void Master::addSlave(Slave* slave, bool reregister)
 
   slaves[slave->id] = slave;
 
-  link(slave->pid);
+  // Journal the admission to the registry. Durability is
+  // asynchronous; a failed write aborts the master (see
+  // _registryOperation).
+  if (registrar != NULL) {
+    Registry::Slave entry;
+    entry.mutable_id()->CopyFrom(slave->id);
+    entry.mutable_info()->CopyFrom(slave->info);
+    entry.set_pid(string(slave->pid));
+    registrar->admitSlave(entry)
+      .onAny(defer(self(), &Self::_registryOperation, params::_1,
+                   "admit slave " + stringify(slave->id)));
+  }
+
+  totalResources += slave->info.resources();
+
+  foreach (const Attribute& attribute, slave->info.attributes()) {
+    attributeIndex[stringify(attribute)].insert(slave->id);
+  }
+
+  // Slave links carry many small latency sensitive messages.
+  link(slave->pid, SocketOptions::control());
 
   if (!reregister) {
     SlaveRegisteredMessage message;
@@ -1905,36 +2687,42 @@ void Master::addSlave(Slave* slave, bool reregister)
   //     dispatch(slavesManager->self(), &SlavesManager::monitor,
   //              slave->pid, slave->info, slave->id);
 
-  // Set up an observer for the slave.
-  slave->observer = new SlaveObserver(slave->pid, slave->info,
-                                      slave->id, self());
-  spawn(slave->observer);
+  // Have the heartbeat manager monitor the slave.
+  dispatch(heartbeats, &HeartbeatManager::watch, slave->pid, slave->info);
 
   if (!reregister) {
     allocator->slaveAdded(slave->id,
                           slave->info,
                           hashmap<FrameworkID, Resources>());
   }
+
+  invalidateState();
+
+  journal("slave_added", *slave);
 }
 
 
 void Master::readdSlave(Slave* slave,
 			const vector<ExecutorInfo>& executorInfos,
 			const vector<Task>& tasks)
+{
+  _readdSlave(slave, executorInfos, tasks, summarize(executorInfos, tasks));
+}
+
+
+void Master::_readdSlave(Slave* slave,
+			 const vector<ExecutorInfo>& executorInfos,
+			 const vector<Task>& tasks,
+			 const hashmap<FrameworkID, Resources>& resources)
 {
   CHECK(slave != NULL);
 
   addSlave(slave, true);
 
-  // Add the executors and tasks to the slave and framework state and
-  // determine the resources that have been allocated to frameworks.
-  hashmap<FrameworkID, Resources> resources;
-
+  // Add the executors and tasks to the slave and framework state
+  // (the resources allocated per framework have already been
+  // determined, see summarize).
   foreach (const ExecutorInfo& executorInfo, executorInfos) {
-    // TODO(benh): Remove this check if framework_id becomes required
-    // on ExecutorInfo (which will also mean we can remove setting it
-    // in the slave).
-    CHECK(executorInfo.has_framework_id());
     if (!slave->hasExecutor(executorInfo.framework_id(),
                             executorInfo.executor_id())) {
       slave->addExecutor(executorInfo.framework_id(), executorInfo);
@@ -1946,8 +2734,6 @@ void Master::readdSlave(Slave* slave,
         framework->addExecutor(slave->id, executorInfo);
       }
     }
-
-    resources[executorInfo.framework_id()] += executorInfo.resources();
   }
 
   foreach (const Task& task, tasks) {
@@ -1973,8 +2759,6 @@ void Master::readdSlave(Slave* slave,
                    << " running on slave " << slave->id << " ("
                    << slave->info.hostname() << ")";
     }
-
-    resources[task.framework_id()] += task.resources();
   }
 
   allocator->slaveAdded(slave->id, slave->info, resources);
@@ -2052,17 +2836,35 @@ void Master::removeSlave(Slave* slave)
   //     dispatch(slavesManager->self(), &SlavesManager::forget,
   //              slave->pid, slave->info, slave->id);
 
-  // Kill the slave observer.
-  terminate(slave->observer);
-  wait(slave->observer);
-
-  delete slave->observer;
+  // Stop monitoring the slave.
+  dispatch(heartbeats, &HeartbeatManager::forget, slave->pid);
 
   // TODO(benh): unlink(slave->pid);
 
   // Delete it.
   slaves.erase(slave->id);
+
+  totalResources -= slave->info.resources();
+
+  foreach (const Attribute& attribute, slave->info.attributes()) {
+    const std::string& key = stringify(attribute);
+    attributeIndex[key].erase(slave->id);
+    if (attributeIndex[key].empty()) {
+      attributeIndex.erase(key);
+    }
+  }
+
+  journal("slave_removed", *slave);
+
+  if (registrar != NULL) {
+    registrar->removeSlave(slave->id)
+      .onAny(defer(self(), &Self::_registryOperation, params::_1,
+                   "remove slave " + stringify(slave->id)));
+  }
+
   delete slave;
+
+  invalidateState();
 }
 
 
@@ -2070,6 +2872,8 @@ void Master::removeTask(Task* task)
 {
   CHECK_NOTNULL(task);
 
+  journal("task_removed", *task);
+
   // Remove from framework.
   Framework* framework = getFramework(task->framework_id());
   if (framework != NULL) { // A framework might not be re-connected yet.
@@ -2085,12 +2889,21 @@ void Master::removeTask(Task* task)
   allocator->resourcesRecovered(
       task->framework_id(), task->slave_id(), Resources(task->resources()));
 
+  invalidateState(task->framework_id());
+
   delete task;
 }
 
 
 void Master::removeOffer(Offer* offer, bool rescind)
 {
+  // Record how long the offer stayed outstanding.
+  Option<double> time = offerTimes.get(offer->id());
+  if (time.isSome()) {
+    offerAges->record((Clock::now() - time.get()) * 1000000.0);
+    offerTimes.erase(offer->id());
+  }
+
   // Remove from framework.
   Framework* framework = getFramework(offer->framework_id());
   CHECK(framework != NULL);
@@ -2107,9 +2920,404 @@ void Master::removeOffer(Offer* offer, bool rescind)
     send(framework->pid, message);
   }
 
-  // Delete it.
+  // Return it to the pool.
   offers.erase(offer->id());
-  delete offer;
+  releaseOffer(offer);
+
+  invalidateState(framework->id);
+}
+
+
+void Master::offerTimeout(const OfferID& offerId)
+{
+  Offer* offer = getOffer(offerId);
+
+  if (offer == NULL) {
+    return; // Already answered (or rescinded for another reason).
+  }
+
+  LOG(INFO) << "Rescinding offer " << offerId << " unanswered by framework "
+            << offer->framework_id() << " for its full lifetime";
+
+  offersRescinded->increment();
+
+  allocator->resourcesRecovered(
+      offer->framework_id(),
+      offer->slave_id(),
+      Resources(offer->resources()));
+
+  removeOffer(offer, true); // Rescind.
+}
+
+
+Offer* Master::acquireOffer()
+{
+  if (offerPool.empty()) {
+    return new Offer();
+  }
+
+  Offer* offer = offerPool.back();
+  offerPool.pop_back();
+  return offer;
+}
+
+
+void Master::releaseOffer(Offer* offer)
+{
+  if (offerPool.size() >= MAX_POOLED_OFFERS) {
+    delete offer;
+    return;
+  }
+
+  // Clear() retains the protobuf's internal buffers so the next
+  // acquire reuses them instead of going back to the heap.
+  offer->Clear();
+  offerPool.push_back(offer);
+}
+
+
+bool Master::shedFrameworkMessage(const FrameworkID& frameworkId)
+{
+  if (flags.framework_rate_limit <= 0.0) {
+    return false;
+  }
+
+  double now = Clock::now();
+
+  if (!buckets.contains(frameworkId)) {
+    TokenBucket bucket;
+    bucket.tokens = flags.framework_rate_limit_burst;
+    bucket.timestamp = now;
+    buckets[frameworkId] = bucket;
+  }
+
+  TokenBucket& bucket = buckets[frameworkId];
+
+  bucket.tokens = std::min(
+      flags.framework_rate_limit_burst,
+      bucket.tokens + (now - bucket.timestamp) * flags.framework_rate_limit);
+  bucket.timestamp = now;
+
+  if (bucket.tokens < 1.0) {
+    shedFrameworkMessages->increment();
+    return true;
+  }
+
+  bucket.tokens -= 1.0;
+  return false;
+}
+
+
+void Master::forwardStatusUpdates(const FrameworkID& frameworkId)
+{
+  if (pendingUpdates.count(frameworkId) == 0) {
+    return; // Already flushed (e.g., by framework removal).
+  }
+
+  Framework* framework = getFramework(frameworkId);
+  if (framework != NULL) {
+    VLOG(1) << "Forwarding " << pendingUpdates[frameworkId].updates_size()
+            << " status updates to framework " << frameworkId;
+
+    send(framework->pid, pendingUpdates[frameworkId]);
+  }
+
+  pendingUpdates.erase(frameworkId);
+}
+
+
+void Master::publishMetrics()
+{
+  // Gauges are sampled here rather than maintained on the mutation
+  // paths; at this cadence the staleness is irrelevant and the hot
+  // paths stay untouched.
+  reregisteringSlavesGauge->set(reregistering.size());
+
+  size_t updates = 0;
+  foreachvalue (const StatusUpdatesMessage& message, pendingUpdates) {
+    updates += message.updates_size();
+  }
+  pendingUpdatesGauge->set(updates);
+
+  // Container sizes and the peak resident set: the published time
+  // series exposes their growth rates, and sustained growth that is
+  // disproportionate to the cluster size is the signature of a leak.
+  frameworksGauge->set(frameworks.size());
+  completedFrameworksGauge->set(completedFrameworks.size());
+  slavesGauge->set(slaves.size());
+  offersGauge->set(offers.size());
+
+  size_t tasks = 0;
+  foreachvalue (Framework* framework, frameworks) {
+    tasks += framework->tasks.size();
+  }
+  activeTasksGauge->set(tasks);
+
+  // Age of the oldest outstanding offer, to surface a framework
+  // sitting on capacity before its offers get rescinded.
+  double oldest = 0.0;
+  foreachvalue (double time, offerTimes) {
+    oldest = std::max(oldest, Clock::now() - time);
+  }
+  oldestOfferAgeGauge->set(oldest);
+
+  // NOTE: ru_maxrss is reported in kilobytes on Linux.
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    maxRssGauge->set(usage.ru_maxrss);
+  }
+
+  metrics.publish("master");
+
+  delay(METRICS_PUBLISH_INTERVAL, self(), &Master::publishMetrics);
+}
+
+
+void Master::invalidateState()
+{
+  stateVersion++;
+}
+
+
+void Master::invalidateState(const FrameworkID& frameworkId)
+{
+  stateVersion++;
+  frameworkStateVersions[frameworkId]++;
+}
+
+
+// NOTE: The deltas below deliberately carry just the ids and the
+// state involved (not the full models of state.json); a consumer
+// that needs more context resolves the ids against its own copy of
+// the state, resynchronizing from '/master/state.json' if needed.
+
+void Master::journal(const string& type, const Task& task)
+{
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.field("type", type);
+  writer.field("framework_id", task.framework_id().value());
+  writer.field("task_id", task.task_id().value());
+  writer.field("slave_id", task.slave_id().value());
+  writer.field("state", TaskState_Name(task.state()));
+  writer.endObject();
+
+  _journal(writer.str());
+}
+
+
+void Master::journal(const string& type, const Slave& slave)
+{
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.field("type", type);
+  writer.field("slave_id", slave.id.value());
+  writer.field("hostname", slave.info.hostname());
+  writer.endObject();
+
+  _journal(writer.str());
+}
+
+
+void Master::journal(const string& type, const Framework& framework)
+{
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.field("type", type);
+  writer.field("framework_id", framework.id.value());
+  writer.field("name", framework.info.name());
+  writer.endObject();
+
+  _journal(writer.str());
+}
+
+
+void Master::_journal(const string& json)
+{
+  Event event;
+  event.version = ++eventVersion;
+  event.json = json;
+  events.push_back(event);
+
+  completeEventWaiters();
+}
+
+
+void Master::completeEventWaiters()
+{
+  while (!eventWaiters.empty()) {
+    const EventWaiter& waiter = eventWaiters.front();
+    waiter.promise->set(
+        http::json::renderEvents(*this, waiter.since, waiter.jsonp));
+    eventWaiters.pop_front();
+  }
+}
+
+
+void Master::timeoutEventWaiters()
+{
+  double now = Clock::now();
+
+  // Waiters are parked in arrival order, so the expired ones (if
+  // any) are at the front.
+  while (!eventWaiters.empty() &&
+         now - eventWaiters.front().timestamp >= EVENT_POLL_TIMEOUT.secs()) {
+    const EventWaiter& waiter = eventWaiters.front();
+    waiter.promise->set(
+        http::json::renderEvents(*this, waiter.since, waiter.jsonp));
+    eventWaiters.pop_front();
+  }
+}
+
+
+void Master::_recoverRegistry(const Future<Registry>& future)
+{
+  if (!future.isReady()) {
+    LOG(FATAL) << "Failed to recover the registry: "
+               << (future.isFailed() ? future.failure() : "discarded")
+               << " ... committing suicide!";
+  }
+
+  // NOTE: Future::get() returns by value, hence the named local.
+  const Registry& registry = future.get();
+
+  recoveredRegistry = registry;
+
+  LOG(INFO) << "Recovered registry with " << registry.slaves().size()
+            << " slaves and " << registry.frameworks().size()
+            << " frameworks";
+}
+
+
+void Master::_registryOperation(
+    const Future<bool>& result,
+    const string& description)
+{
+  if (!result.isReady() || !result.get()) {
+    // Most likely another master has since been elected the log's
+    // writer; abort rather than diverge from the registry.
+    LOG(FATAL) << "Failed to " << description << " in the registry"
+               << (result.isFailed() ? ": " + result.failure() : "")
+               << " ... committing suicide!";
+  }
+
+  VLOG(1) << "Registry operation applied: " << description;
+}
+
+
+void Master::mirror()
+{
+  if (elected || leader == UPID() || leader == self()) {
+    mirroring = false;
+    return;
+  }
+
+  process::http::get(leader, "state.json")
+    .onAny(defer(self(), &Self::_mirrorState, params::_1));
+}
+
+
+void Master::_mirrorState(const Future<process::http::Response>& response)
+{
+  if (elected || leader == UPID() || leader == self()) {
+    mirroring = false;
+    return;
+  }
+
+  if (!response.isReady() || response.get().status != "200 OK") {
+    // The leader may be failing over or overloaded; back off and
+    // bootstrap again.
+    delay(MIRROR_RETRY_INTERVAL, self(), &Self::mirror);
+    return;
+  }
+
+  mirroredState = response.get().body;
+  mirroredTime = Clock::now();
+
+  process::http::get(leader, "state-summary.json")
+    .onAny(defer(self(), &Self::_mirrorSummary, params::_1));
+}
+
+
+void Master::_mirrorSummary(const Future<process::http::Response>& response)
+{
+  if (elected || leader == UPID() || leader == self()) {
+    mirroring = false;
+    return;
+  }
+
+  if (!response.isReady() || response.get().status != "200 OK") {
+    delay(MIRROR_RETRY_INTERVAL, self(), &Self::mirror);
+    return;
+  }
+
+  mirroredSummary = response.get().body;
+
+  __mirror();
+}
+
+
+void Master::__mirror()
+{
+  // Long poll the leader's event feed as a change notification. The
+  // client side timeout leaves the leader's own poll timeout
+  // (EVENT_POLL_TIMEOUT) plenty of room; it only fires if the
+  // connection went silently dead.
+  process::http::get(
+      leader,
+      "events.json",
+      "since=" + stringify(mirrorVersion),
+      Seconds(EVENT_POLL_TIMEOUT.secs() * 2))
+    .onAny(defer(self(), &Self::_mirrorEvents, params::_1));
+}
+
+
+void Master::_mirrorEvents(const Future<process::http::Response>& response)
+{
+  if (elected || leader == UPID() || leader == self()) {
+    mirroring = false;
+    return;
+  }
+
+  if (!response.isReady()) {
+    delay(MIRROR_RETRY_INTERVAL, self(), &Self::mirror);
+    return;
+  }
+
+  if (response.get().status == "400 Bad Request") {
+    // Our cursor is ahead of the leader's journal: the leadership
+    // changed under us (versions restart at zero on failover).
+    // Resynchronize from scratch.
+    mirrorVersion = 0;
+    mirror();
+    return;
+  }
+
+  if (response.get().status != "200 OK") {
+    delay(MIRROR_RETRY_INTERVAL, self(), &Self::mirror);
+    return;
+  }
+
+  uint64_t version = mirrorVersion;
+
+  Option<string> header =
+    response.get().headers.get("X-Mesos-Event-Version");
+  if (header.isSome()) {
+    Try<uint64_t> numified = numify<uint64_t>(header.get());
+    if (numified.isSome()) {
+      version = numified.get();
+    }
+  }
+
+  if (version != mirrorVersion) {
+    // Deltas arrived (this also covers a truncated journal, since
+    // we refresh the full renderings regardless): re-fetch.
+    mirrorVersion = version;
+    mirror();
+  } else {
+    // Idle poll timeout: just re-arm.
+    __mirror();
+  }
 }
 
 
@@ -2143,6 +3351,18 @@ Offer* Master::getOffer(const OfferID& offerId)
 }
 
 
+hashset<SlaveID> Master::slavesWithAttribute(const Attribute& attribute) const
+{
+  Option<hashset<SlaveID> > slaveIds = attributeIndex.get(stringify(attribute));
+
+  if (slaveIds.isSome()) {
+    return slaveIds.get();
+  }
+
+  return hashset<SlaveID>();
+}
+
+
 // Create a new framework ID. We format the ID as MASTERID-FWID, where
 // MASTERID is the ID of the master (launch date plus fault tolerant ID)
 // and FWID is an increasing integer.
@@ -31,12 +31,16 @@
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 
+#include <stout/densehashmap.hpp>
 #include <stout/foreach.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/json.hpp>
 #include <stout/hashset.hpp>
 #include <stout/multihashmap.hpp>
 #include <stout/option.hpp>
 
+#include "common/metrics.hpp"
+#include "common/protobuf_utils.hpp"
 #include "common/resources.hpp"
 #include "common/type_utils.hpp"
 #include "common/units.hpp"
@@ -63,20 +67,29 @@ using namespace process; // Included to make code easier to read.
 // Forward declarations.
 class Allocator;
 class SlavesManager;
-class SlaveObserver;
+class HeartbeatManager;
 class WhitelistWatcher;
 
+class Archive;
+class Registrar;
 struct Framework;
 struct Slave;
 
+namespace capture {
+class Recorder;
+} // namespace capture {
+
 
 class Master : public ProtobufProcess<Master>
 {
 public:
-  Master(Allocator* allocator, Files* files);
+  // Note that the master does not take ownership of the registrar
+  // (NULL disables the persistent registry).
+  Master(Allocator* allocator, Files* files, Registrar* registrar = NULL);
   Master(Allocator* allocator,
          Files* files,
-         const Flags& flags);
+         const Flags& flags,
+         Registrar* registrar = NULL);
 
   virtual ~Master();
 
@@ -91,27 +104,39 @@ public:
   void deactivateFramework(const FrameworkID& frameworkId);
   void resourceRequest(const FrameworkID& frameworkId,
                        const std::vector<Request>& requests);
-  void launchTasks(const FrameworkID& frameworkId,
-                   const OfferID& offerId,
-                   const std::vector<TaskInfo>& tasks,
-                   const Filters& filters);
+  // Handles a launch tasks request, which may span several offers
+  // (possibly across slaves, see the 'offer_ids' field); the tasks
+  // are validated and forwarded per slave in a single pass.
+  void launchTasks(const LaunchTasksMessage& message);
   void reviveOffers(const FrameworkID& frameworkId);
   void killTask(const FrameworkID& frameworkId, const TaskID& taskId);
+  // NOTE: The data payloads of framework messages are deliberately
+  // not passed to these handlers; the master routes the messages
+  // based on the ids and forwards them verbatim (see
+  // ProtobufProcess::forward) without ever decoding the blobs.
   void schedulerMessage(const SlaveID& slaveId,
                         const FrameworkID& frameworkId,
-                        const ExecutorID& executorId,
-                        const std::string& data);
+                        const ExecutorID& executorId);
   void registerSlave(const SlaveInfo& slaveInfo);
   void reregisterSlave(const SlaveID& slaveId,
                        const SlaveInfo& slaveInfo,
                        const std::vector<ExecutorInfo>& executorInfos,
-                       const std::vector<Task>& tasks);
+                       const std::vector<Task>& tasks,
+                       const std::vector<FrameworkDigest>& digests);
+  void reregisterSlaveDigests(
+      const SlaveID& slaveId,
+      const SlaveInfo& slaveInfo,
+      const std::vector<FrameworkDigest>& digests);
+  void _reregisterSlave(
+      Slave* slave,
+      const std::vector<ExecutorInfo>& executorInfos,
+      const std::vector<Task>& tasks,
+      const Future<hashmap<FrameworkID, Resources> >& prepared);
   void unregisterSlave(const SlaveID& slaveId);
   void statusUpdate(const StatusUpdate& update, const UPID& pid);
   void executorMessage(const SlaveID& slaveId,
                        const FrameworkID& frameworkId,
-                       const ExecutorID& executorId,
-                       const std::string& data);
+                       const ExecutorID& executorId);
   void exitedExecutor(const SlaveID& slaveId,
                       const FrameworkID& frameworkId,
                       const ExecutorID& executorId,
@@ -124,20 +149,36 @@ public:
   void offer(const FrameworkID& framework,
              const hashmap<SlaveID, Resources>& resources);
 
+  // Invoked when an offer has been outstanding for its full
+  // lifetime; rescinds it if the framework still has not answered.
+  void offerTimeout(const OfferID& offerId);
+
 protected:
   virtual void initialize();
   virtual void finalize();
   virtual void exited(const UPID& pid);
 
+  // Appends the message to the capture file (when --capture is set)
+  // before delegating to the protobuf handlers.
+  virtual void visit(const process::MessageEvent& event);
+
+  // Assigns mailbox priority classes so liveness critical messages
+  // (e.g., status updates that slaves keep retrying) get serviced
+  // ahead of a burst of bulk HTTP state queries. NOTE: Runs on the
+  // enqueuing thread (see ProcessBase::classify), so it must not
+  // touch master state.
+  virtual int classify(const process::Event& event) const;
+
   void fileAttached(const Future<Nothing>& result, const std::string& path);
 
   // Return connected frameworks that are not in the process of being removed
   std::vector<Framework*> getActiveFrameworks() const;
 
-  // Process a launch tasks request (for a non-cancelled offer) by
-  // launching the desired tasks (if the offer contains a valid set of
-  // tasks) and reporting any unused resources to the allocator.
-  void processTasks(Offer* offer,
+  // Process a launch tasks request (for non-cancelled offers, all
+  // from the same slave) by launching the desired tasks (if the
+  // offers contain a valid set of tasks) and reporting any unused
+  // resources to the allocator. All of the offers are consumed.
+  void processTasks(const std::vector<Offer*>& offers,
                     Framework* framework,
                     Slave* slave,
                     const std::vector<TaskInfo>& tasks,
@@ -154,6 +195,13 @@ protected:
   // reschedule offers that were assigned to this framework.
   void removeFramework(Framework* framework);
 
+  // Continuation of removeFramework: removes up to
+  // TEARDOWN_TASKS_PER_CHUNK of the framework's tasks, re-dispatching
+  // itself while tasks remain so that the teardown of a large
+  // framework interleaves with normal event processing, and finishes
+  // the teardown (archival, bookkeeping) once all tasks are gone.
+  void _removeFramework(Framework* framework);
+
   // Remove a framework from the slave, i.e., kill all of its tasks,
   // remove its offers and reallocate its resources.
   void removeFramework(Slave* slave, Framework* framework);
@@ -165,6 +213,21 @@ protected:
 		  const std::vector<ExecutorInfo>& executorInfos,
 		  const std::vector<Task>& tasks);
 
+  // Like readdSlave but with the per framework resource totals
+  // already computed (see Master::reregisterSlave).
+  void _readdSlave(Slave* slave,
+		   const std::vector<ExecutorInfo>& executorInfos,
+		   const std::vector<Task>& tasks,
+		   const hashmap<FrameworkID, Resources>& resources);
+
+  // Sends the latest framework pids to a (re-)registered slave.
+  void sendFrameworkPids(Slave* slave, const std::vector<Task>& tasks);
+
+  // Like the above, but derives the frameworks from the tasks the
+  // master already has for the slave (used when the slave
+  // re-registers via digests and resends no tasks).
+  void sendFrameworkPids(Slave* slave);
+
   // Lose all of a slave's tasks and delete the slave object
   void removeSlave(Slave* slave);
 
@@ -180,10 +243,29 @@ protected:
   // Remove an offer and optionally rescind the offer as well.
   void removeOffer(Offer* offer, bool rescind = false);
 
+  // Offers are made and declined at one per slave per allocation
+  // cycle, so rather than heap allocating (and later freeing) an
+  // Offer protobuf each time, removed offers are Clear()ed and kept
+  // in a bounded pool for reuse (offer ids are NOT recycled; they
+  // stay unique for the lifetime of the master).
+  Offer* acquireOffer();
+  void releaseOffer(Offer* offer);
+
+  // Returns true if the framework has exhausted its token bucket and
+  // the message should be shed (see --framework_rate_limit). Each
+  // admitted message costs a token; buckets refill at the configured
+  // rate up to the configured burst.
+  bool shedFrameworkMessage(const FrameworkID& frameworkId);
+
   Framework* getFramework(const FrameworkID& frameworkId);
   Slave* getSlave(const SlaveID& slaveId);
   Offer* getOffer(const OfferID& offerId);
 
+  // Returns the slaves whose attributes include the given attribute
+  // (e.g., rack=r42), in O(result) via the inverted index maintained
+  // by addSlave/removeSlave.
+  hashset<SlaveID> slavesWithAttribute(const Attribute& attribute) const;
+
   FrameworkID newFrameworkId();
   OfferID newOfferId();
   SlaveID newSlaveId();
@@ -214,6 +296,27 @@ private:
       const Master& master,
       const process::http::Request& request);
 
+  friend Future<process::http::Response> http::json::summary(
+      const Master& master,
+      const process::http::Request& request);
+
+  friend Future<process::http::Response> http::json::tasks(
+      const Master& master,
+      const process::http::Request& request);
+
+  friend Future<process::http::Response> http::json::events(
+      const Master& master,
+      const process::http::Request& request);
+
+  friend process::http::Response http::json::renderEvents(
+      const Master& master,
+      uint64_t since,
+      const Option<std::string>& jsonp);
+
+  friend Future<process::http::Response> http::json::archive(
+      const Master& master,
+      const process::http::Request& request);
+
   const Flags flags;
 
   UPID leader; // Current leading master.
@@ -223,15 +326,71 @@ private:
   Allocator* allocator;
   SlavesManager* slavesManager;
   WhitelistWatcher* whitelistWatcher;
+  HeartbeatManager* heartbeats;
   Files* files;
 
+  // Off-heap archive of completed frameworks (NULL unless
+  // --archive_dir is set), see master/archive.hpp.
+  Archive* archive;
+
+  // Capture of the inbound message stream for offline replay (NULL
+  // unless --capture is set), see master/capture.hpp.
+  capture::Recorder* recorder;
+
+  // Persistent registry of cluster membership in the replicated log
+  // (NULL unless --registry is set), see master/registrar.hpp.
+  Registrar* registrar;
+
   MasterInfo info;
 
   multihashmap<std::string, uint16_t> slaveHostnamePorts;
 
-  hashmap<FrameworkID, Framework*> frameworks;
-  hashmap<SlaveID, Slave*> slaves;
-  hashmap<OfferID, Offer*> offers;
+  // These tables are probed on every status update and offer
+  // operation, so they use the open addressing map.
+  densehashmap<FrameworkID, Framework*> frameworks;
+  densehashmap<SlaveID, Slave*> slaves;
+  densehashmap<OfferID, Offer*> offers;
+
+  // Creation time of each outstanding offer, for the offer-age
+  // metrics and the rescind timeouts (see Master::offerTimeout).
+  hashmap<OfferID, double> offerTimes;
+
+  // Cleared Offer protobufs awaiting reuse, see acquireOffer.
+  std::vector<Offer*> offerPool;
+
+  // Token bucket per framework, lazily created on the framework's
+  // first rate limited message and dropped with the framework (see
+  // shedFrameworkMessage).
+  struct TokenBucket
+  {
+    double tokens;
+    double timestamp;
+  };
+
+  hashmap<FrameworkID, TokenBucket> buckets;
+
+  // Frameworks whose chunked teardown is in progress (see
+  // removeFramework); used to ignore re-entrant removals and stale
+  // re-registrations until the teardown completes.
+  hashset<FrameworkID> removingFrameworks;
+
+  // Slaves whose re-registration is currently being prepared off the
+  // master process, used both to bound how many re-registrations are
+  // admitted concurrently and to ignore retries from a slave whose
+  // re-registration is already in flight (see reregisterSlave).
+  hashset<SlaveID> reregistering;
+
+  // Sum of the resources of all connected slaves, maintained by
+  // addSlave/removeSlave so that summary endpoints need not iterate
+  // the slaves.
+  Resources totalResources;
+
+  // Inverted index from a rendered attribute (e.g., "rack=r42") to
+  // the slaves carrying it, so that placement queries can pre-filter
+  // candidate slaves without scanning the cluster. Maintained by
+  // addSlave/removeSlave; slave attributes are immutable for the
+  // lifetime of a registration.
+  hashmap<std::string, hashset<SlaveID> > attributeIndex;
 
   boost::circular_buffer<std::tr1::shared_ptr<Framework> > completedFrameworks;
 
@@ -248,7 +407,177 @@ private:
     uint64_t invalidFrameworkMessages;
   } stats;
 
+  // Operational metrics (see common/metrics.hpp). The histograms and
+  // counters below are recorded at the point of the event; the
+  // gauges are sampled by publishMetrics, which also publishes the
+  // whole registry into the statistics time series. The registry is
+  // rendered by '/master/stats.json'.
+  metrics::Registry metrics;
+  metrics::Histogram* launchTasksLatency;
+  metrics::Histogram* statusUpdateLatency;
+  metrics::Counter* postponedReregistrations;
+  metrics::Counter* shedFrameworkMessages;
+  metrics::Gauge* reregisteringSlavesGauge;
+  metrics::Gauge* pendingUpdatesGauge;
+
+  // Sizes of the master's long-lived containers plus the process's
+  // peak resident set, sampled so that the time series exposes their
+  // growth rates: sustained growth disproportionate to cluster size
+  // is the signature of a leak (e.g., completed frameworks or offers
+  // that are never reaped).
+  metrics::Gauge* frameworksGauge;
+  metrics::Gauge* completedFrameworksGauge;
+  metrics::Gauge* slavesGauge;
+  metrics::Gauge* offersGauge;
+  metrics::Gauge* activeTasksGauge;
+  metrics::Gauge* maxRssGauge;
+
+  // Offer lifetimes: how long offers stay outstanding before they
+  // are answered (or rescinded), and how many were rescinded for
+  // timing out. A framework hoarding offers shows up as a growing
+  // oldest-offer age and a climbing rescind count.
+  metrics::Histogram* offerAges;
+  metrics::Counter* offersRescinded;
+  metrics::Gauge* oldestOfferAgeGauge;
+
+  // Samples the gauges, publishes the registry and re-schedules
+  // itself every METRICS_PUBLISH_INTERVAL.
+  void publishMetrics();
+
   double startTime; // Start time used to calculate uptime.
+
+  // Invalidates cached renderings of '/master/state.json', for a
+  // state transition that touches a single framework or (without an
+  // argument) global state such as slaves or the elected leader.
+  // Monitoring tends to poll state.json frequently; versioning the
+  // state lets the HTTP handler serve unchanged polls from a cache
+  // and re-render only the framework fragments that changed, rather
+  // than re-modeling every framework, task, offer and slave on each
+  // request (see master/http.cpp).
+  void invalidateState();
+  void invalidateState(const FrameworkID& frameworkId);
+
+  // Sends the buffered status updates for the framework in a single
+  // batched message, see Master::statusUpdate.
+  void forwardStatusUpdates(const FrameworkID& frameworkId);
+
+  // Status updates buffered per framework, awaiting a delayed
+  // forwardStatusUpdates (scheduled when the first update for the
+  // framework is buffered).
+  hashmap<FrameworkID, StatusUpdatesMessage> pendingUpdates;
+
+  // Registry plumbing (all of it no-ops when 'registrar' is NULL).
+  // Stores the membership recovered from the replicated log once
+  // this master gets elected, so that re-registrations reconcile
+  // against known state.
+  void _recoverRegistry(const Future<Registry>& future);
+
+  // Checks that an asynchronous registry write succeeded. A failed
+  // write means another master has since been elected the log's
+  // writer, so we commit suicide rather than diverge from the
+  // registry.
+  void _registryOperation(
+      const Future<bool>& result,
+      const std::string& description);
+
+  // The membership recovered from the registry on election (none
+  // until recovery completes, or when the registry is disabled).
+  Option<Registry> recoveredRegistry;
+
+  // Records a delta into the bounded event journal backing the
+  // '/master/events.json' feed and completes any long polls parked
+  // on it. The overloads render the small JSON delta (type, ids and
+  // the state involved, not the full models of state.json) for the
+  // state-mutation paths that call them.
+  void journal(const std::string& type, const Task& task);
+  void journal(const std::string& type, const Slave& slave);
+  void journal(const std::string& type, const Framework& framework);
+
+  // Appends a rendered delta to the journal, assigning it the next
+  // version, and completes the parked long polls.
+  void _journal(const std::string& json);
+
+  // Completes all of the parked long polls with the deltas journaled
+  // since each one's cursor (possibly none).
+  void completeEventWaiters();
+
+  // Completes the parked long polls that have been waiting longer
+  // than EVENT_POLL_TIMEOUT with an empty delta, so that clients
+  // (and any proxies in between) see regular traffic.
+  void timeoutEventWaiters();
+
+  // An entry in the event journal: the version assigned to the delta
+  // and its pre-rendered JSON object.
+  struct Event
+  {
+    uint64_t version;
+    std::string json;
+  };
+
+  // Bounded journal of state deltas. Clients cursor over it with
+  // '/master/events.json?since=<version>'; a client that falls
+  // behind the window resynchronizes from '/master/state.json'.
+  boost::circular_buffer<Event> events;
+
+  // Version assigned to the most recently journaled event. Versions
+  // are monotonic for the lifetime of the master; they restart at
+  // zero on failover, which a client observes as its cursor being
+  // ahead of the journal.
+  uint64_t eventVersion;
+
+  // A long poll parked on the event feed until the next delta (or
+  // the poll timeout) arrives, see master/http.cpp.
+  struct EventWaiter
+  {
+    uint64_t since;
+    Option<std::string> jsonp;
+    double timestamp;
+    std::tr1::shared_ptr<process::Promise<process::http::Response> > promise;
+  };
+
+  // Parked long polls in arrival order; mutable because the (const)
+  // HTTP handler registers them.
+  mutable std::list<EventWaiter> eventWaiters;
+
+  // On a standby, maintains a near-real-time mirror of the leader's
+  // rendered state so that dashboards and tooling can query any
+  // master (reserving the leader for scheduling traffic). The mirror
+  // bootstraps by fetching the leader's '/state.json' and
+  // '/state-summary.json' and then long polls '/events.json' as a
+  // change notification, re-fetching the renderings when deltas
+  // arrive. The loop stops once this master is elected; see
+  // master/http.cpp for where the mirror is served.
+  void mirror();
+  void _mirrorState(const Future<process::http::Response>& response);
+  void _mirrorSummary(const Future<process::http::Response>& response);
+  void __mirror();
+  void _mirrorEvents(const Future<process::http::Response>& response);
+
+  // Whether the mirror loop is running.
+  bool mirroring;
+
+  // The leader's journal version the mirror is current through, read
+  // from the X-Mesos-Event-Version response header.
+  uint64_t mirrorVersion;
+
+  double mirroredTime;                 // When the mirror was last fetched.
+  Option<std::string> mirroredState;   // Mirrored '/master/state.json'.
+  Option<std::string> mirroredSummary; // Mirrored '/master/state-summary.json'.
+
+  // Bumped by invalidateState() on every state transition affecting
+  // the contents of '/master/state.json'.
+  uint64_t stateVersion;
+
+  // Per-framework versions, bumped when a transition touches the
+  // framework, so that only its fragment needs re-rendering.
+  hashmap<FrameworkID, uint64_t> frameworkStateVersions;
+
+  // Rendering cache, written by the (const) 'state' HTTP handler;
+  // mutable since caching doesn't change the observable state.
+  mutable uint64_t renderedStateVersion;
+  mutable Option<std::string> renderedState;
+  mutable hashmap<FrameworkID, uint64_t> renderedFrameworkVersions;
+  mutable hashmap<FrameworkID, std::string> renderedFrameworks;
 };
 
 
@@ -263,18 +592,17 @@ struct Slave
       info(_info),
       pid(_pid),
       registeredTime(time),
-      lastHeartbeat(time),
-      observer(NULL) {}
+      lastHeartbeat(time) {}
 
   ~Slave() {}
 
   Task* getTask(const FrameworkID& frameworkId, const TaskID& taskId)
   {
-    foreachvalue (Task* task, tasks) {
-      if (task->framework_id() == frameworkId &&
-          task->task_id() == taskId) {
-        return task;
-      }
+    std::pair<FrameworkID, TaskID> key =
+      std::make_pair(frameworkId, taskId);
+
+    if (tasks.count(key) > 0) {
+      return tasks[key];
     }
 
     return NULL;
@@ -369,13 +697,11 @@ struct Slave
   // TODO(bmahler): The task pointer ownership complexity arises from the fact
   // that we own the pointer here, but it's shared with the Framework struct.
   // We should find a way to eliminate this.
-  hashmap<std::pair<FrameworkID, TaskID>, Task*> tasks;
+  densehashmap<std::pair<FrameworkID, TaskID>, Task*> tasks;
 
   // Active offers on this slave.
   hashset<Offer*> offers;
 
-  SlaveObserver* observer;
-
 private:
   Slave(const Slave&);              // No copying.
   Slave& operator = (const Slave&); // No assigning.
@@ -395,7 +721,12 @@ struct Framework
       active(true),
       registeredTime(time),
       reregisteredTime(time),
-      completedTasks(MAX_COMPLETED_TASKS_PER_FRAMEWORK) {}
+      completedTasks(MAX_COMPLETED_TASKS_PER_FRAMEWORK)
+  {
+    for (int i = 0; i < TaskState_ARRAYSIZE; i++) {
+      taskStates[i] = 0;
+    }
+  }
 
   ~Framework() {}
 
@@ -413,6 +744,7 @@ struct Framework
     CHECK(!tasks.contains(task->task_id()));
     tasks[task->task_id()] = task;
     resources += task->resources();
+    taskStates[task->state()]++;
   }
 
   void removeTask(Task* task)
@@ -422,6 +754,26 @@ struct Framework
     completedTasks.push_back(*task);
     tasks.erase(task->task_id());
     resources -= task->resources();
+
+    if (!protobuf::isTerminalState(task->state())) {
+      // Removed without a terminal transition (e.g., the slave was
+      // lost): account the task as lost. Terminal states need no
+      // bookkeeping here since setTaskState already counted them
+      // (terminal counts are cumulative).
+      taskStates[task->state()]--;
+      taskStates[TASK_LOST]++;
+    }
+  }
+
+  // Transitions a task to the given state, maintaining the per-state
+  // counters. Use this rather than setting the task's state directly.
+  void setTaskState(Task* task, TaskState state)
+  {
+    if (!protobuf::isTerminalState(task->state())) {
+      taskStates[task->state()]--;
+    }
+    task->set_state(state);
+    taskStates[state]++;
   }
 
   void addOffer(Offer* offer)
@@ -480,7 +832,7 @@ struct Framework
   double reregisteredTime;
   double unregisteredTime;
 
-  hashmap<TaskID, Task*> tasks;
+  densehashmap<TaskID, Task*> tasks;
 
   boost::circular_buffer<Task> completedTasks;
 
@@ -488,6 +840,12 @@ struct Framework
 
   Resources resources; // Total resources (tasks + offers + executors).
 
+  // Number of tasks per state: counts of live tasks for the active
+  // states and cumulative totals for the terminal ones, maintained
+  // incrementally (see addTask/removeTask/setTaskState) so summary
+  // endpoints need not iterate the tasks.
+  size_t taskStates[TaskState_ARRAYSIZE];
+
   hashmap<SlaveID, hashmap<ExecutorID, ExecutorInfo> > executors;
 
 private:
@@ -0,0 +1,450 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <list>
+#include <string>
+
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/process.hpp>
+#include <process/timeout.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/option.hpp>
+#include <stout/result.hpp>
+
+#include "common/type_utils.hpp"
+
+#include "logging/logging.hpp"
+
+#include "master/constants.hpp"
+#include "master/registrar.hpp"
+
+using namespace process;
+
+using std::list;
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+using log::Log;
+
+
+class RegistrarProcess : public Process<RegistrarProcess>
+{
+public:
+  RegistrarProcess(Log* _log)
+    : ProcessBase(ID::generate("registrar")),
+      log(_log),
+      reader(_log),
+      writer(NULL),
+      operations(0),
+      flushing(false) {}
+
+  virtual ~RegistrarProcess()
+  {
+    foreach (const Mutation& mutation, mutations) {
+      mutation.promise->fail("Registrar terminating");
+      delete mutation.promise;
+    }
+
+    delete writer; // Might be NULL if recover was never invoked.
+  }
+
+  Future<Registry> recover();
+
+  Future<bool> admitSlave(const Registry::Slave& slave);
+  Future<bool> removeSlave(const SlaveID& slaveId);
+  Future<bool> admitFramework(const Registry::Framework& framework);
+  Future<bool> removeFramework(const FrameworkID& frameworkId);
+
+private:
+  // A queued mutation: the operation to journal and the promise to
+  // complete once it is durably appended.
+  struct Mutation
+  {
+    RegistryOperation operation;
+    Promise<bool>* promise;
+  };
+
+  // Queues the operation for the next batched append.
+  Future<bool> append(const RegistryOperation& operation);
+
+  // Drains the queued mutations, appending each accumulated batch to
+  // the log in a single round of the underlying protocol. Note that
+  // the appends are blocking, so mutations dispatched in the interim
+  // accumulate into the next batch.
+  void flush();
+
+  // Applies an operation to the in-memory registry.
+  void apply(const RegistryOperation& operation);
+
+  // Journals the full registry as a SNAPSHOT entry, truncates the
+  // entries it subsumes, and installs the snapshot locally so that
+  // our own recovery need not re-read it from the log.
+  void compact();
+
+  Log* log;
+  Log::Reader reader;
+  Log::Writer* writer; // NULL until recover elects us as the writer.
+
+  // The in-memory registry; operations get applied as they are
+  // durably appended, so a snapshot of this is always consistent
+  // with some position of the log.
+  Registry registry;
+
+  // Operations appended since the last snapshot, drives compaction.
+  uint64_t operations;
+
+  list<Mutation> mutations; // Queued while an append is in flight.
+  bool flushing; // Whether a flush has been dispatched.
+};
+
+
+Future<Registry> RegistrarProcess::recover()
+{
+  if (writer != NULL) {
+    return Future<Registry>::failed("Registry has already been recovered");
+  }
+
+  LOG(INFO) << "Recovering registry from the replicated log";
+
+  // Electing ourselves as the log's writer invalidates the writer of
+  // any previously elected master and brings the local replica up to
+  // date with the quorum, so the (local) reads below observe
+  // everything that was successfully appended.
+  writer = new Log::Writer(log, REGISTRY_WRITE_TIMEOUT);
+
+  Log::Position begin = reader.beginning();
+  Log::Position end = reader.ending();
+
+  // Restore the most recent locally installed snapshot (if present)
+  // and replay only the tail of the log after it. Without one we
+  // replay from the beginning of the retained log, whose first entry
+  // is the last journaled SNAPSHOT (see compact).
+  Option<Log::Entry> snapshot = reader.snapshot();
+  if (snapshot.isSome()) {
+    if (!registry.ParseFromString(snapshot.get().data)) {
+      return Future<Registry>::failed("Failed to parse registry snapshot");
+    }
+    begin = snapshot.get().position;
+  }
+
+  if (begin < end) {
+    Result<list<Log::Entry> > entries =
+      reader.read(begin, end, Timeout(REGISTRY_WRITE_TIMEOUT));
+
+    if (entries.isError()) {
+      return Future<Registry>::failed(
+          "Failed to read the registry log: " + entries.error());
+    } else if (entries.isNone()) {
+      return Future<Registry>::failed("Timed out reading the registry log");
+    }
+
+    // NOTE: The read includes the snapshot's own position; replaying
+    // an operation on top of a registry that reflects it already is
+    // fine since operations are idempotent.
+    foreach (const Log::Entry& entry, entries.get()) {
+      RegistryOperation operation;
+      if (!operation.ParseFromString(entry.data)) {
+        return Future<Registry>::failed(
+            "Failed to parse an entry of the registry log");
+      }
+      apply(operation);
+    }
+  }
+
+  LOG(INFO) << "Recovered registry with " << registry.slaves_size()
+            << " slaves and " << registry.frameworks_size() << " frameworks";
+
+  // Flush any mutations that queued up while we were recovering.
+  if (!mutations.empty() && !flushing) {
+    flushing = true;
+    dispatch(self(), &RegistrarProcess::flush);
+  }
+
+  return registry;
+}
+
+
+Future<bool> RegistrarProcess::admitSlave(const Registry::Slave& slave)
+{
+  RegistryOperation operation;
+  operation.set_type(RegistryOperation::ADMIT_SLAVE);
+  operation.mutable_slave()->CopyFrom(slave);
+
+  return append(operation);
+}
+
+
+Future<bool> RegistrarProcess::removeSlave(const SlaveID& slaveId)
+{
+  RegistryOperation operation;
+  operation.set_type(RegistryOperation::REMOVE_SLAVE);
+  operation.mutable_slave_id()->CopyFrom(slaveId);
+
+  return append(operation);
+}
+
+
+Future<bool> RegistrarProcess::admitFramework(
+    const Registry::Framework& framework)
+{
+  RegistryOperation operation;
+  operation.set_type(RegistryOperation::ADMIT_FRAMEWORK);
+  operation.mutable_framework()->CopyFrom(framework);
+
+  return append(operation);
+}
+
+
+Future<bool> RegistrarProcess::removeFramework(
+    const FrameworkID& frameworkId)
+{
+  RegistryOperation operation;
+  operation.set_type(RegistryOperation::REMOVE_FRAMEWORK);
+  operation.mutable_framework_id()->CopyFrom(frameworkId);
+
+  return append(operation);
+}
+
+
+Future<bool> RegistrarProcess::append(const RegistryOperation& operation)
+{
+  Mutation mutation;
+  mutation.operation = operation;
+  mutation.promise = new Promise<bool>();
+
+  Future<bool> future = mutation.promise->future();
+
+  mutations.push_back(mutation);
+
+  // Mutations issued before recovery completes just queue up; they
+  // get flushed once the writer has been elected (see recover).
+  if (!flushing && writer != NULL) {
+    flushing = true;
+    dispatch(self(), &RegistrarProcess::flush);
+  }
+
+  return future;
+}
+
+
+void RegistrarProcess::flush()
+{
+  CHECK(writer != NULL);
+
+  while (!mutations.empty()) {
+    list<Mutation> batch;
+    batch.swap(mutations);
+
+    list<string> entries;
+    foreach (const Mutation& mutation, batch) {
+      entries.push_back(mutation.operation.SerializeAsString());
+    }
+
+    // A none result means the batched append timed out and can
+    // simply be retried (a duplicated operation is harmless since
+    // operations are idempotent).
+    int retries = 3;
+    Result<Log::Position> position =
+      writer->append(entries, Timeout(REGISTRY_WRITE_TIMEOUT));
+    while (position.isNone() && --retries > 0) {
+      position = writer->append(entries, Timeout(REGISTRY_WRITE_TIMEOUT));
+    }
+
+    if (!position.isSome()) {
+      // Most likely another master has since been elected as the
+      // log's writer and demoted us: fail the mutations so that the
+      // master aborts rather than diverge from the registry.
+      string message = position.isError()
+        ? position.error()
+        : "Timed out appending to the registry log";
+
+      foreach (const Mutation& mutation, batch) {
+        mutation.promise->fail(message);
+        delete mutation.promise;
+      }
+
+      continue; // Fail the mutations queued behind us too.
+    }
+
+    foreach (const Mutation& mutation, batch) {
+      apply(mutation.operation);
+      mutation.promise->set(true);
+      delete mutation.promise;
+    }
+
+    operations += batch.size();
+
+    if (operations >= REGISTRY_OPERATIONS_PER_SNAPSHOT) {
+      compact();
+    }
+  }
+
+  flushing = false;
+}
+
+
+void RegistrarProcess::apply(const RegistryOperation& operation)
+{
+  switch (operation.type()) {
+    case RegistryOperation::ADMIT_SLAVE: {
+      CHECK(operation.has_slave());
+      // Remove any existing entry first (re-admission, or a replay
+      // of an operation the registry reflects already).
+      for (int i = 0; i < registry.slaves_size(); i++) {
+        if (registry.slaves(i).id() == operation.slave().id()) {
+          registry.mutable_slaves()->SwapElements(
+              i, registry.slaves_size() - 1);
+          registry.mutable_slaves()->RemoveLast();
+          break;
+        }
+      }
+      registry.add_slaves()->CopyFrom(operation.slave());
+      break;
+    }
+
+    case RegistryOperation::REMOVE_SLAVE: {
+      CHECK(operation.has_slave_id());
+      for (int i = 0; i < registry.slaves_size(); i++) {
+        if (registry.slaves(i).id() == operation.slave_id()) {
+          registry.mutable_slaves()->SwapElements(
+              i, registry.slaves_size() - 1);
+          registry.mutable_slaves()->RemoveLast();
+          break;
+        }
+      }
+      break;
+    }
+
+    case RegistryOperation::ADMIT_FRAMEWORK: {
+      CHECK(operation.has_framework());
+      for (int i = 0; i < registry.frameworks_size(); i++) {
+        if (registry.frameworks(i).id() == operation.framework().id()) {
+          registry.mutable_frameworks()->SwapElements(
+              i, registry.frameworks_size() - 1);
+          registry.mutable_frameworks()->RemoveLast();
+          break;
+        }
+      }
+      registry.add_frameworks()->CopyFrom(operation.framework());
+      break;
+    }
+
+    case RegistryOperation::REMOVE_FRAMEWORK: {
+      CHECK(operation.has_framework_id());
+      for (int i = 0; i < registry.frameworks_size(); i++) {
+        if (registry.frameworks(i).id() == operation.framework_id()) {
+          registry.mutable_frameworks()->SwapElements(
+              i, registry.frameworks_size() - 1);
+          registry.mutable_frameworks()->RemoveLast();
+          break;
+        }
+      }
+      break;
+    }
+
+    case RegistryOperation::SNAPSHOT: {
+      CHECK(operation.has_registry());
+      registry.CopyFrom(operation.registry());
+      break;
+    }
+  }
+}
+
+
+void RegistrarProcess::compact()
+{
+  RegistryOperation operation;
+  operation.set_type(RegistryOperation::SNAPSHOT);
+  operation.mutable_registry()->CopyFrom(registry);
+
+  Result<Log::Position> position =
+    writer->append(operation.SerializeAsString(),
+                   Timeout(REGISTRY_WRITE_TIMEOUT));
+
+  if (position.isNone()) {
+    return; // Timed out: not urgent, try again after the next batch.
+  } else if (position.isError()) {
+    // The next mutation will surface the broken writer to the master.
+    LOG(ERROR) << "Failed to append a registry snapshot: "
+               << position.error();
+    return;
+  }
+
+  reader.install(position.get(), registry.SerializeAsString());
+
+  // Truncating the entries the snapshot subsumes is best effort: if
+  // it times out the log just retains more than it strictly needs
+  // to, and we will truncate again after the next snapshot.
+  writer->truncate(position.get(), Timeout(REGISTRY_WRITE_TIMEOUT));
+
+  operations = 0;
+}
+
+
+Registrar::Registrar(Log* log)
+{
+  process = new RegistrarProcess(log);
+  spawn(process);
+}
+
+
+Registrar::~Registrar()
+{
+  terminate(process);
+  wait(process);
+  delete process;
+}
+
+
+Future<Registry> Registrar::recover()
+{
+  return dispatch(process, &RegistrarProcess::recover);
+}
+
+
+Future<bool> Registrar::admitSlave(const Registry::Slave& slave)
+{
+  return dispatch(process, &RegistrarProcess::admitSlave, slave);
+}
+
+
+Future<bool> Registrar::removeSlave(const SlaveID& slaveId)
+{
+  return dispatch(process, &RegistrarProcess::removeSlave, slaveId);
+}
+
+
+Future<bool> Registrar::admitFramework(const Registry::Framework& framework)
+{
+  return dispatch(process, &RegistrarProcess::admitFramework, framework);
+}
+
+
+Future<bool> Registrar::removeFramework(const FrameworkID& frameworkId)
+{
+  return dispatch(process, &RegistrarProcess::removeFramework, frameworkId);
+}
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
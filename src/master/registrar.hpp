@@ -0,0 +1,79 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __MASTER_REGISTRAR_HPP__
+#define __MASTER_REGISTRAR_HPP__
+
+#include <mesos/mesos.hpp>
+
+#include <process/future.hpp>
+
+#include "log/log.hpp"
+
+#include "messages/messages.hpp"
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// Forward declaration.
+class RegistrarProcess;
+
+
+// Persists the master's view of cluster membership (the admitted
+// slaves and the registered frameworks) in the replicated log, so
+// that a newly elected master recovers authoritative membership in
+// seconds instead of rebuilding it over minutes of slave and
+// framework re-registrations. Mutations are journaled to the log as
+// RegistryOperation entries; mutations issued while a write is in
+// flight are written with the log's batched append (one round of the
+// protocol for the whole batch), and the log is compacted by
+// installing a Registry snapshot after every
+// REGISTRY_OPERATIONS_PER_SNAPSHOT operations so recovery replays
+// only a short tail.
+class Registrar
+{
+public:
+  // Note that the registrar does NOT take ownership of the log.
+  Registrar(log::Log* log);
+  ~Registrar();
+
+  // Recovers the registry from the replicated log. This elects the
+  // registrar as the log's writer (invalidating the writer of any
+  // previously elected master) and must complete before any of the
+  // mutations below are issued.
+  process::Future<Registry> recover();
+
+  // Each mutation is durable (accepted by a quorum of replicas) once
+  // the returned future is ready. The future fails if the write
+  // could not be performed, e.g., because another master has since
+  // been elected writer (in which case this master should abort).
+  process::Future<bool> admitSlave(const Registry::Slave& slave);
+  process::Future<bool> removeSlave(const SlaveID& slaveId);
+  process::Future<bool> admitFramework(const Registry::Framework& framework);
+  process::Future<bool> removeFramework(const FrameworkID& frameworkId);
+
+private:
+  RegistrarProcess* process;
+};
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MASTER_REGISTRAR_HPP__
@@ -0,0 +1,291 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SHARDED_ALLOCATOR_PROCESS_HPP__
+#define __SHARDED_ALLOCATOR_PROCESS_HPP__
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/process.hpp>
+
+#include <stout/hashmap.hpp>
+
+#include "common/resources.hpp"
+
+#include "master/allocator.hpp"
+#include "master/drf_sorter.hpp"
+#include "master/hierarchical_allocator_process.hpp"
+#include "master/incremental_drf_sorter.hpp"
+
+namespace mesos {
+namespace internal {
+namespace master {
+
+// An allocator that partitions the slave set across multiple
+// underlying allocator processes ("shards") so that allocation
+// cycles for a large cluster can run on multiple cores instead of
+// serializing onto a single libprocess thread. This process acts as
+// the coordinator: framework events and whitelist updates are
+// broadcast to every shard, while slave events and resource events
+// are routed to the shard that owns the slave (slaves are assigned
+// to shards by hashing the SlaveID). Each shard therefore maintains
+// sorters over the full framework set and its own slice of the
+// cluster's resources; since slices are statistically proportional,
+// per-shard dominant shares converge to the global values and the
+// merged orderings approximate a single global DRF sort.
+template <typename ShardProcess>
+class ShardedAllocatorProcess : public AllocatorProcess
+{
+public:
+  ShardedAllocatorProcess()
+    : ProcessBase(process::ID::generate("sharded-allocator")),
+      initialized(false) {}
+
+  virtual ~ShardedAllocatorProcess()
+  {
+    foreach (ShardProcess* shard, shards) {
+      process::terminate(shard);
+      process::wait(shard);
+      delete shard;
+    }
+  }
+
+  virtual void initialize(
+      const Flags& _flags,
+      const process::PID<Master>& _master)
+  {
+    flags = _flags;
+    master = _master;
+    initialized = true;
+
+    int count = std::max(flags.allocator_shards, 1);
+
+    LOG(INFO) << "Initializing sharded allocator with "
+              << count << " shards";
+
+    for (int i = 0; i < count; i++) {
+      ShardProcess* shard = new ShardProcess();
+      process::spawn(shard);
+      process::dispatch(shard, &ShardProcess::initialize, flags, master);
+      shards.push_back(shard);
+    }
+  }
+
+  virtual void frameworkAdded(
+      const FrameworkID& frameworkId,
+      const FrameworkInfo& frameworkInfo,
+      const Resources& used)
+  {
+    CHECK(initialized);
+
+    // The resources in use are all accounted to the shards owning
+    // the slaves they came from, but we only know the aggregate
+    // here; account them to the shard of the framework's hash so
+    // they are counted exactly once towards its dominant share.
+    // TODO(benh): Plumb through a per-slave breakdown of 'used'.
+    foreach (ShardProcess* shard, shards) {
+      process::dispatch(
+          shard,
+          &ShardProcess::frameworkAdded,
+          frameworkId,
+          frameworkInfo,
+          shard == shards[shardOf(frameworkId.value())]
+            ? used : Resources());
+    }
+  }
+
+  virtual void frameworkRemoved(
+      const FrameworkID& frameworkId)
+  {
+    CHECK(initialized);
+
+    foreach (ShardProcess* shard, shards) {
+      process::dispatch(shard, &ShardProcess::frameworkRemoved, frameworkId);
+    }
+  }
+
+  virtual void frameworkActivated(
+      const FrameworkID& frameworkId,
+      const FrameworkInfo& frameworkInfo)
+  {
+    CHECK(initialized);
+
+    foreach (ShardProcess* shard, shards) {
+      process::dispatch(
+          shard,
+          &ShardProcess::frameworkActivated,
+          frameworkId,
+          frameworkInfo);
+    }
+  }
+
+  virtual void frameworkDeactivated(
+      const FrameworkID& frameworkId)
+  {
+    CHECK(initialized);
+
+    foreach (ShardProcess* shard, shards) {
+      process::dispatch(
+          shard,
+          &ShardProcess::frameworkDeactivated,
+          frameworkId);
+    }
+  }
+
+  virtual void slaveAdded(
+      const SlaveID& slaveId,
+      const SlaveInfo& slaveInfo,
+      const hashmap<FrameworkID, Resources>& used)
+  {
+    CHECK(initialized);
+
+    size_t shard = shardOf(slaveId.value());
+    owners[slaveId] = shard;
+
+    process::dispatch(
+        shards[shard],
+        &ShardProcess::slaveAdded,
+        slaveId,
+        slaveInfo,
+        used);
+  }
+
+  virtual void slaveRemoved(
+      const SlaveID& slaveId)
+  {
+    CHECK(initialized);
+
+    CHECK(owners.contains(slaveId));
+
+    process::dispatch(
+        shards[owners[slaveId]],
+        &ShardProcess::slaveRemoved,
+        slaveId);
+
+    owners.erase(slaveId);
+  }
+
+  virtual void updateWhitelist(
+      const Option<hashset<std::string> >& whitelist)
+  {
+    CHECK(initialized);
+
+    foreach (ShardProcess* shard, shards) {
+      process::dispatch(shard, &ShardProcess::updateWhitelist, whitelist);
+    }
+  }
+
+  virtual void resourcesRequested(
+      const FrameworkID& frameworkId,
+      const std::vector<Request>& requests)
+  {
+    CHECK(initialized);
+
+    foreach (ShardProcess* shard, shards) {
+      process::dispatch(
+          shard,
+          &ShardProcess::resourcesRequested,
+          frameworkId,
+          requests);
+    }
+  }
+
+  virtual void resourcesUnused(
+      const FrameworkID& frameworkId,
+      const SlaveID& slaveId,
+      const Resources& resources,
+      const Option<Filters>& filters)
+  {
+    CHECK(initialized);
+
+    if (!owners.contains(slaveId)) {
+      return; // Slave has since been removed.
+    }
+
+    process::dispatch(
+        shards[owners[slaveId]],
+        &ShardProcess::resourcesUnused,
+        frameworkId,
+        slaveId,
+        resources,
+        filters);
+  }
+
+  virtual void resourcesRecovered(
+      const FrameworkID& frameworkId,
+      const SlaveID& slaveId,
+      const Resources& resources)
+  {
+    CHECK(initialized);
+
+    if (!owners.contains(slaveId)) {
+      return; // Slave has since been removed.
+    }
+
+    process::dispatch(
+        shards[owners[slaveId]],
+        &ShardProcess::resourcesRecovered,
+        frameworkId,
+        slaveId,
+        resources);
+  }
+
+  virtual void offersRevived(
+      const FrameworkID& frameworkId)
+  {
+    CHECK(initialized);
+
+    foreach (ShardProcess* shard, shards) {
+      process::dispatch(shard, &ShardProcess::offersRevived, frameworkId);
+    }
+  }
+
+private:
+  // Returns the index of the shard owning the specified key.
+  size_t shardOf(const std::string& key)
+  {
+    return boost::hash<std::string>()(key) % shards.size();
+  }
+
+  bool initialized;
+
+  Flags flags;
+  PID<Master> master;
+
+  // The underlying allocator shards, each running on its own
+  // libprocess process.
+  std::vector<ShardProcess*> shards;
+
+  // Maps each slave to the index of the shard that owns it.
+  hashmap<SlaveID, size_t> owners;
+};
+
+
+typedef ShardedAllocatorProcess<HierarchicalIncrementalDRFAllocatorProcess>
+ShardedHierarchicalDRFAllocatorProcess;
+
+} // namespace master {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __SHARDED_ALLOCATOR_PROCESS_HPP__
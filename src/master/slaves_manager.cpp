@@ -67,6 +67,13 @@ using std::vector;
 class ZooKeeperSlavesManagerStorageWatcher;
 
 
+// Stores each slave as its own znode, i.e., '<znode>/active/host:port'
+// or '<znode>/inactive/host:port', so that adding, removing,
+// (de)activating a slave touches a single small znode rather than
+// rewriting one big comma separated list. Membership changes come in
+// via child watches on the two directories and get diffed against
+// what was last seen, so propagating a change costs O(changed slaves)
+// rather than a re-parse of all slaves.
 class ZooKeeperSlavesManagerStorage : public SlavesManagerStorage
 {
 public:
@@ -88,15 +95,27 @@ public:
   Future<bool> updated(const string& path);
 
 private:
-  bool parse(const string& key,
-             const string& s,
-             multihashmap<string, uint16_t>* result);
+  // Parses a child znode name of the form 'hostname:port'.
+  bool parse(const string& child, string* hostname, uint16_t* port);
+
+  // Re-lists the children of the specified directory znode (leaving
+  // a child watch behind), diffs them against 'cached', and sends
+  // only the changes to the slaves manager.
+  bool refresh(
+      const string& path,
+      multihashmap<string, uint16_t>* cached,
+      bool active);
 
   const string servers;
   const string znode;
   const PID<SlavesManager> slavesManager;
   ZooKeeper* zk;
   ZooKeeperSlavesManagerStorageWatcher* watcher;
+
+  // Last known children of each directory, used for diffing when a
+  // child watch fires.
+  multihashmap<string, uint16_t> actives;
+  multihashmap<string, uint16_t> inactives;
 };
 
 
@@ -131,8 +150,9 @@ public:
 
       // If this watcher is reused, the next connect won't be a reconnect.
       reconnect = false;
-    } else if ((state == ZOO_CONNECTED_STATE) && (type == ZOO_CHANGED_EVENT)) {
-      // Let the manager deal with file changes.
+    } else if ((state == ZOO_CONNECTED_STATE) &&
+               (type == ZOO_CHANGED_EVENT || type == ZOO_CHILD_EVENT)) {
+      // Let the manager deal with membership changes.
       process::dispatch(pid, &ZooKeeperSlavesManagerStorage::updated, path);
     } else {
       LOG(WARNING) << "Unimplemented watch event: (state is "
@@ -166,48 +186,14 @@ ZooKeeperSlavesManagerStorage::~ZooKeeperSlavesManagerStorage()
 
 Future<bool> ZooKeeperSlavesManagerStorage::add(const string& hostname, uint16_t port)
 {
-  // TODO(benh): Use ZooKeeperSlavesManagerStorage::parse to clean up code.
-  int ret;
-  string result;
-  Stat stat;
-
-  ret = zk->get(znode, true, &result, &stat);
-
-  if (ret != ZOK) {
-    LOG(WARNING) << "Slaves manager storage failed to get '" << znode
-                 << "' in ZooKeeper! (" << zk->message(ret) << ")";
-    return false;
-  }
-
   ostringstream out;
-  out << hostname << ":" << port;
-
-  if (result.size() == 0) {
-    out << "active=" << hostname << ":" << port << "\n";
-    out << "inactive=\n";
-    result = out.str();
-  } else {
-    const string active("active=");
-
-    size_t index = result.find(active);
-
-    if (index == string::npos) {
-      LOG(WARNING) << "Slaves manager storage found bad data in '" << znode
-                   << "', could not find 'active='";
-      return false;
-    }
-
-    if (result[index + active.size()] != '\n') {
-      out << ",";
-    }
-
-    result.insert(index + active.size(), out.str());
-  }
+  out << znode << "/active/" << hostname << ":" << port;
 
-  // Set the data in the znode.
-  ret = zk->set(znode, result, stat.version);
+  // Only the one (small) znode for this slave gets created, the
+  // lists of other slaves are untouched.
+  int ret = zk->create(out.str(), "", ZOO_OPEN_ACL_UNSAFE, 0, NULL);
 
-  if (ret != ZOK) {
+  if (ret != ZOK && ret != ZNODEEXISTS) {
     LOG(WARNING) << "Slaves manager storage could not add slave "
 		 << hostname << ":" << port
                  << " to '" << znode << "' in ZooKeeper! ("
@@ -221,52 +207,30 @@ Future<bool> ZooKeeperSlavesManagerStorage::add(const string& hostname, uint16_t
 
 Future<bool> ZooKeeperSlavesManagerStorage::remove(const string& hostname, uint16_t port)
 {
-  // TODO(benh): Use ZooKeeperSlavesManagerStorage::parse to clean up code.
-  int ret;
-  string result;
-  Stat stat;
-
-  ret = zk->get(znode, true, &result, &stat);
-
-  if (ret != ZOK) {
-    LOG(WARNING) << "Slaves manager storage failed to get '" << znode
-                 << "' in ZooKeeper! (" << zk->message(ret) << ")";
-    return false;
-  }
+  ostringstream active;
+  active << znode << "/active/" << hostname << ":" << port;
 
-  ostringstream out;
-  out << hostname << ":" << port;
+  ostringstream inactive;
+  inactive << znode << "/inactive/" << hostname << ":" << port;
 
-  size_t index = result.find(out.str());
+  // The slave might be in either list (but should be in one).
+  int ret1 = zk->remove(active.str(), -1);
+  int ret2 = zk->remove(inactive.str(), -1);
 
-  if (index == string::npos) {
+  if (ret1 == ZNONODE && ret2 == ZNONODE) {
     LOG(WARNING) << "Slaves manager storage could not remove slave "
 		 << hostname << ":" << port
                  << " because not currently active or inactive";
     return false;
-  } else if (index == 0) {
-    LOG(WARNING) << "Bad data in '" << znode;
-    return false;
-  }
-
-  if (result[index - 1] == '=') {
-    if (result[index + out.str().size()] == '\n') {
-      result.erase(index, out.str().size());
-    } else {
-      result.erase(index, out.str().size() + 1);
-    }
-  } else {
-    result.erase(index - 1, out.str().size() + 1);
   }
 
-  // Set the data in the znode.
-  ret = zk->set(znode, result, stat.version);
-
-  if (ret != ZOK) {
+  if ((ret1 != ZOK && ret1 != ZNONODE) ||
+      (ret2 != ZOK && ret2 != ZNONODE)) {
     LOG(WARNING) << "Slaves manager storage could not remove slave "
 		 << hostname << ":" << port
                  << " from '" << znode << "' in ZooKeeper! ("
-                 << zk->message(ret) << ")";
+                 << zk->message(ret1 != ZOK && ret1 != ZNONODE ? ret1 : ret2)
+                 << ")";
     return false;
   }
 
@@ -276,74 +240,40 @@ Future<bool> ZooKeeperSlavesManagerStorage::remove(const string& hostname, uint1
 
 Future<bool> ZooKeeperSlavesManagerStorage::activate(const string& hostname, uint16_t port)
 {
-  // TODO(benh): Use ZooKeeperSlavesManagerStorage::parse to clean up code.
-  int ret;
-  string result;
-  Stat stat;
-
-  ret = zk->get(znode, true, &result, &stat);
-
-  if (ret != ZOK) {
-    LOG(WARNING) << "Slaves manager storage failed to get '" << znode
-                 << "' in ZooKeeper! (" << zk->message(ret) << ")";
-    return false;
-  }
-
-  ostringstream out;
-  out << hostname << ":" << port;
+  ostringstream inactive;
+  inactive << znode << "/inactive/" << hostname << ":" << port;
 
-  const string inactive("inactive=");
+  int ret = zk->exists(inactive.str(), false, NULL);
 
-  size_t index = result.find(inactive);
-
-  if (index == string::npos) {
-    LOG(WARNING) << "Slaves manager storage found bad data in '" << znode
-                 << "', could not find 'inactive='";
-    return false;
-  }
-
-  index = result.find(out.str(), index);
-
-  if (index == string::npos) {
+  if (ret == ZNONODE) {
     LOG(WARNING) << "Slaves manager storage could not activate slave "
 		 << hostname << ":" << port
                  << " because not currently inactive";
     return false;
-  } else if (index == 0) {
-    LOG(WARNING) << "Slaves manager storage found bad data in '" << znode;
+  } else if (ret != ZOK) {
+    LOG(WARNING) << "Slaves manager storage failed to get '" << znode
+                 << "' in ZooKeeper! (" << zk->message(ret) << ")";
     return false;
   }
 
-  if (result[index - 1] == '=') {
-    if (result[index + out.str().size()] == '\n') {
-      result.erase(index, out.str().size());
-    } else {
-      result.erase(index, out.str().size() + 1);
-    }
-  } else {
-    result.erase(index - 1, out.str().size() + 1);
-  }
-
-  const string active("active=");
+  ostringstream active;
+  active << znode << "/active/" << hostname << ":" << port;
 
-  index = result.find(active);
+  // Create the active znode before removing the inactive one so the
+  // slave never transiently disappears from both lists.
+  ret = zk->create(active.str(), "", ZOO_OPEN_ACL_UNSAFE, 0, NULL);
 
-  if (index == string::npos) {
-    LOG(WARNING) << "Slaves manager storage found bad data in '" << znode
-                 << "', could not find 'active='";
+  if (ret != ZOK && ret != ZNODEEXISTS) {
+    LOG(WARNING) << "Slaves manager storage could not activate slave "
+		 << hostname << ":" << port
+                 << " in '" << znode << "' in ZooKeeper! ("
+                 << zk->message(ret) << ")";
     return false;
   }
 
-  if (result[index + active.size()] != '\n') {
-    out << ",";
-  }
-
-  result.insert(index + active.size(), out.str());
+  ret = zk->remove(inactive.str(), -1);
 
-  // Set the data in the znode.
-  ret = zk->set(znode, result, stat.version);
-
-  if (ret != ZOK) {
+  if (ret != ZOK && ret != ZNONODE) {
     LOG(WARNING) << "Slaves manager storage could not activate slave "
 		 << hostname << ":" << port
                  << " in '" << znode << "' in ZooKeeper! ("
@@ -357,75 +287,40 @@ Future<bool> ZooKeeperSlavesManagerStorage::activate(const string& hostname, uin
 
 Future<bool> ZooKeeperSlavesManagerStorage::deactivate(const string& hostname, uint16_t port)
 {
-  // TODO(benh): Use ZooKeeperSlavesManagerStorage::parse to clean up code.
-  int ret;
-  string result;
-  Stat stat;
-
-  ret = zk->get(znode, true, &result, &stat);
-
-  if (ret != ZOK) {
-    LOG(WARNING) << "Slaves manager storage failed to get '" << znode
-                 << "' in ZooKeeper! (" << zk->message(ret) << ")";
-    return false;
-  }
-
-  ostringstream out;
-  out << hostname << ":" << port;
+  ostringstream active;
+  active << znode << "/active/" << hostname << ":" << port;
 
-  const string active("active=");
+  int ret = zk->exists(active.str(), false, NULL);
 
-  size_t index = result.find(active);
-
-  if (index == string::npos) {
-    LOG(WARNING) << "Slaves manager storage found bad data in '" << znode
-                 << "', could not find 'active='";
-    return false;
-  }
-
-  index = result.find(out.str(), index);
-
-  if (index == string::npos) {
+  if (ret == ZNONODE) {
     LOG(WARNING) << "Slaves manager storage could not deactivate slave "
 		 << hostname << ":" << port
                  << " because not currently active";
     return false;
-  } else if (index == 0) {
-    LOG(WARNING) << "Slaves manager storage found bad data in '" << znode;
+  } else if (ret != ZOK) {
+    LOG(WARNING) << "Slaves manager storage failed to get '" << znode
+                 << "' in ZooKeeper! (" << zk->message(ret) << ")";
     return false;
   }
 
-  if (result[index - 1] == '=') {
-    if (result[index + out.str().size()] == '\n') {
-      result.erase(index, out.str().size());
-    } else {
-      result.erase(index, out.str().size() + 1);
-    }
-  } else {
-    result.erase(index - 1, out.str().size() + 1);
-  }
-
-  const string inactive("inactive=");
+  ostringstream inactive;
+  inactive << znode << "/inactive/" << hostname << ":" << port;
 
-  index = result.find(inactive);
+  // As in activate, create before remove.
+  ret = zk->create(inactive.str(), "", ZOO_OPEN_ACL_UNSAFE, 0, NULL);
 
-  if (index == string::npos) {
-    LOG(WARNING) << "Slaves manager storage found bad data in '" << znode
-                 << "', could not find 'inactive='";
+  if (ret != ZOK && ret != ZNODEEXISTS) {
+    LOG(WARNING) << "Slaves manager storage could not deactivate slave "
+		 << hostname << ":" << port
+                 << " in '" << znode << "' in ZooKeeper! ("
+                 << zk->message(ret) << ")";
     return false;
   }
 
-  if (result[index + inactive.size()] != '\n') {
-    out << ",";
-  }
-
-  result.insert(index + inactive.size(), out.str());
+  ret = zk->remove(active.str(), -1);
 
-  // Set the data in the znode.
-  ret = zk->set(znode, result, stat.version);
-
-  if (ret != ZOK) {
-    LOG(WARNING) << "Slaves manager storage could not activate slave "
+  if (ret != ZOK && ret != ZNONODE) {
+    LOG(WARNING) << "Slaves manager storage could not deactivate slave "
 		 << hostname << ":" << port
                  << " in '" << znode << "' in ZooKeeper! ("
                  << zk->message(ret) << ")";
@@ -445,30 +340,40 @@ Future<bool> ZooKeeperSlavesManagerStorage::connected()
   // Assume the znode that was created does not end with a "/".
   CHECK(znode.at(znode.length() - 1) != '/');
 
-  // Create directory path znodes as necessary.
-  size_t index = znode.find(delimiter, 0);
-
-  while (index < string::npos) {
-    // Get out the prefix to create.
-    index = znode.find(delimiter, index + 1);
-    string prefix = znode.substr(0, index);
-
-    // Create the node (even if it already exists).
-    ret = zk->create(prefix, "", ZOO_OPEN_ACL_UNSAFE, 0, NULL);
-
-    if (ret != ZOK && ret != ZNODEEXISTS) {
-      // Okay, consider this a failure (maybe we lost our connection
-      // to ZooKeeper), increment the failure count, log the issue,
-      // and perhaps try again when ZooKeeper issues get sorted out.
-      LOG(WARNING) << "Slaves manager storage failed to create '" << znode
-                   << "' in ZooKeeper! (" << zk->message(ret) << ")";
-      return false;
+  // Create directory path znodes as necessary (including the per
+  // list directories that hold one child znode per slave).
+  const string directories[] = {
+    znode,
+    znode + "/active",
+    znode + "/inactive"
+  };
+
+  for (size_t i = 0; i < sizeof(directories) / sizeof(directories[0]); i++) {
+    size_t index = directories[i].find(delimiter, 0);
+
+    while (index < string::npos) {
+      // Get out the prefix to create.
+      index = directories[i].find(delimiter, index + 1);
+      string prefix = directories[i].substr(0, index);
+
+      // Create the node (even if it already exists).
+      ret = zk->create(prefix, "", ZOO_OPEN_ACL_UNSAFE, 0, NULL);
+
+      if (ret != ZOK && ret != ZNODEEXISTS) {
+        // Okay, consider this a failure (maybe we lost our connection
+        // to ZooKeeper), increment the failure count, log the issue,
+        // and perhaps try again when ZooKeeper issues get sorted out.
+        LOG(WARNING) << "Slaves manager storage failed to create '" << znode
+                     << "' in ZooKeeper! (" << zk->message(ret) << ")";
+        return false;
+      }
     }
   }
 
   // Reconcile what's in the znodes versus what we have in memory
-  // (this also puts watches on these znodes).
-  return updated(znode);
+  // (this also puts child watches on these znodes).
+  bool result = refresh(znode + "/active", &actives, true);
+  return refresh(znode + "/inactive", &inactives, false) && result;
 }
 
 
@@ -485,8 +390,9 @@ Future<bool> ZooKeeperSlavesManagerStorage::reconnected()
   LOG(INFO) << "Slaves manager storage has reconnected ...";
 
   // Reconcile what's in the znodes versus what we have in memory
-  // (this also puts watches on these znodes).
-  return updated(znode);
+  // (this also puts child watches on these znodes).
+  bool result = refresh(znode + "/active", &actives, true);
+  return refresh(znode + "/inactive", &inactives, false) && result;
 }
 
 
@@ -508,35 +414,76 @@ Future<bool> ZooKeeperSlavesManagerStorage::expired()
 
 Future<bool> ZooKeeperSlavesManagerStorage::updated(const string& path)
 {
-  int ret;
-  string result;
+  if (path == znode + "/active") {
+    LOG(INFO) << "Slaves manager storage found active slave updates in "
+              << "ZooKeeper ... propogating changes";
+    return refresh(path, &actives, true);
+  } else if (path == znode + "/inactive") {
+    LOG(INFO) << "Slaves manager storage found inactive slave updates in "
+              << "ZooKeeper ... propogating changes";
+    return refresh(path, &inactives, false);
+  }
+
+  LOG(WARNING) << "Slaves manager storage not expecting changes to path '"
+               << path << "' in ZooKeeper";
+  return false;
+}
+
 
-  if (path == znode) {
-    LOG(INFO) << "Slaves manager storage found updates in ZooKeeper "
-              << "... propogating changes";
+bool ZooKeeperSlavesManagerStorage::refresh(
+    const string& path,
+    multihashmap<string, uint16_t>* cached,
+    bool active)
+{
+  // Re-list the children (leaving a child watch behind). Note that
+  // this only transfers the child names, not any data.
+  vector<string> children;
+
+  int ret = zk->getChildren(path, true, &children);
+
+  if (ret != ZOK) {
+    LOG(WARNING) << "Slaves manager storage failed to get children of '"
+                 << path << "' in ZooKeeper! (" << zk->message(ret) << ")";
+    return false;
+  }
 
-    ret = zk->get(znode, true, &result, NULL);
+  multihashmap<string, uint16_t> current;
 
-    if (ret != ZOK) {
-      LOG(WARNING) << "Slaves manager storage failed to get '" << znode
-                   << "' in ZooKeeper! (" << zk->message(ret) << ")";
-      return false;
+  foreach (const string& child, children) {
+    string hostname;
+    uint16_t port;
+    if (parse(child, &hostname, &port)) {
+      current.put(hostname, port);
     }
+  }
+
+  // Diff against what we saw last time so that only the changed
+  // slaves get sent to the slaves manager.
+  multihashmap<string, uint16_t> added;
+  multihashmap<string, uint16_t> removed;
 
-    // Parse what's in ZooKeeper into active/inactive hostname port pairs.
-    multihashmap<string, uint16_t> active;
-    if (parse("active=", result, &active)) {
-      process::dispatch(slavesManager, &SlavesManager::updateActive, active);
+  foreachpair (const string& hostname, uint16_t port, *cached) {
+    if (!current.contains(hostname, port)) {
+      removed.put(hostname, port);
     }
+  }
 
-    multihashmap<string, uint16_t> inactive;
-    if (parse("inactive=", result, &inactive)) {
-      process::dispatch(slavesManager, &SlavesManager::updateInactive, inactive);
+  foreachpair (const string& hostname, uint16_t port, current) {
+    if (!cached->contains(hostname, port)) {
+      added.put(hostname, port);
+    }
+  }
+
+  *cached = current;
+
+  if (!added.empty() || !removed.empty()) {
+    if (active) {
+      process::dispatch(
+          slavesManager, &SlavesManager::applyActive, added, removed);
+    } else {
+      process::dispatch(
+          slavesManager, &SlavesManager::applyInactive, added, removed);
     }
-  } else {
-    LOG(WARNING) << "Slaves manager stoage not expecting changes to path '"
-                 << path << "' in ZooKeeper";
-    return false;
   }
 
   return true;
@@ -544,47 +491,27 @@ Future<bool> ZooKeeperSlavesManagerStorage::updated(const string& path)
 
 
 bool ZooKeeperSlavesManagerStorage::parse(
-    const string& key,
-    const string& s,
-    multihashmap<string, uint16_t>* result)
+    const string& child,
+    string* hostname,
+    uint16_t* port)
 {
-  size_t begin = s.find(key);
-  if (begin == string::npos) {
-    LOG(WARNING) << "Slaves manager storage found bad data in '" << znode
-                 << "', could not find '" << key << "'";
+  const vector<string>& pairs = strings::tokenize(child, ":");
+
+  if (pairs.size() != 2) {
+    LOG(WARNING) << "Slaves manager storage found bad child znode '"
+                 << child << "' in '" << znode << "'";
     return false;
   }
 
-  size_t end = s.find("\n", begin);
-  if (end == string::npos) {
-    LOG(WARNING) << "Slaves manager storage found bad data in '" << znode
-                 << "', missing LF after '" << key << "'";
+  try {
+    *port = lexical_cast<uint16_t>(pairs[1]);
+  } catch (const bad_lexical_cast&) {
+    LOG(WARNING) << "Slaves manager storage found bad child znode '"
+                 << child << "' in '" << znode << "'";
     return false;
   }
 
-  CHECK(end > begin);
-
-  size_t length = end - begin - key.size();
-
-  const string& temp = s.substr(begin + key.size(), length);
-
-  const vector<string>& tokens = strings::tokenize(temp, ",");
-  foreach (const string& token, tokens) {
-    const vector<string>& pairs = strings::tokenize(token, ":");
-    if (pairs.size() != 2) {
-      LOG(WARNING) << "Slaves manager storage found bad data in '" << znode
-                   << "', could not parse " << token;
-      return false;
-    }
-
-    try {
-      result->put(pairs[0], lexical_cast<uint16_t>(pairs[1]));
-    } catch (const bad_lexical_cast&) {
-      LOG(WARNING) << "Slaves manager storage found bad data in '" << znode
-                   << "', could not parse " << token;
-      return false;
-    }
-  }
+  *hostname = pairs[0];
 
   return true;
 }
@@ -810,6 +737,44 @@ void SlavesManager::updateInactive(
 }
 
 
+void SlavesManager::applyActive(
+    const multihashmap<string, uint16_t>& added,
+    const multihashmap<string, uint16_t>& removed)
+{
+  foreachpair (const string& hostname, uint16_t port, removed) {
+    if (active.contains(hostname, port)) {
+      process::dispatch(master, &Master::deactivatedSlaveHostnamePort,
+                        hostname, port);
+      active.remove(hostname, port);
+    }
+  }
+
+  foreachpair (const string& hostname, uint16_t port, added) {
+    if (!active.contains(hostname, port)) {
+      process::dispatch(master, &Master::activatedSlaveHostnamePort,
+                        hostname, port);
+      active.put(hostname, port);
+    }
+  }
+}
+
+
+void SlavesManager::applyInactive(
+    const multihashmap<string, uint16_t>& added,
+    const multihashmap<string, uint16_t>& removed)
+{
+  foreachpair (const string& hostname, uint16_t port, removed) {
+    inactive.remove(hostname, port);
+  }
+
+  foreachpair (const string& hostname, uint16_t port, added) {
+    if (!inactive.contains(hostname, port)) {
+      inactive.put(hostname, port);
+    }
+  }
+}
+
+
 Future<Response> SlavesManager::add(const Request& request)
 {
   // Make sure we have 'hostname=value'.
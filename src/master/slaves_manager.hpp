@@ -81,6 +81,16 @@ public:
   void updateActive(const multihashmap<std::string, uint16_t>& updated);
   void updateInactive(const multihashmap<std::string, uint16_t>& updated);
 
+  // Incremental variants of the above, used by watch driven storage
+  // backends that know exactly which slaves changed. These cost
+  // O(changed slaves) rather than requiring a pass over all slaves.
+  void applyActive(
+      const multihashmap<std::string, uint16_t>& added,
+      const multihashmap<std::string, uint16_t>& removed);
+  void applyInactive(
+      const multihashmap<std::string, uint16_t>& added,
+      const multihashmap<std::string, uint16_t>& removed);
+
 private:
   process::Future<process::http::Response> add(
       const process::http::Request& request);
@@ -255,7 +255,10 @@ PyObject* MesosSchedulerDriverImpl_start(MesosSchedulerDriverImpl* self)
     return NULL;
   }
 
-  Status status = self->driver->start();
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->start();
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets exception if creating long fails.
 }
 
@@ -274,7 +277,10 @@ PyObject* MesosSchedulerDriverImpl_stop(MesosSchedulerDriverImpl* self,
     return NULL;
   }
 
-  Status status = self->driver->stop(failover);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->stop(failover);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets exception if creating long fails.
 }
 
@@ -286,7 +292,10 @@ PyObject* MesosSchedulerDriverImpl_abort(MesosSchedulerDriverImpl* self)
     return NULL;
   }
 
-  Status status = self->driver->abort();
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->abort();
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets exception if creating long fails.
 }
 
@@ -354,7 +363,10 @@ PyObject* MesosSchedulerDriverImpl_requestResources(MesosSchedulerDriverImpl* se
     requests.push_back(request);
   }
 
-  Status status = self->driver->requestResources(requests);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->requestResources(requests);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets exception if creating long fails.
 }
 
@@ -410,7 +422,10 @@ PyObject* MesosSchedulerDriverImpl_launchTasks(MesosSchedulerDriverImpl* self,
     }
   }
 
-  Status status = self->driver->launchTasks(offerId, tasks, filters);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->launchTasks(offerId, tasks, filters);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets exception if creating long fails.
 }
 
@@ -433,7 +448,10 @@ PyObject* MesosSchedulerDriverImpl_killTask(MesosSchedulerDriverImpl* self,
     return NULL;
   }
 
-  Status status = self->driver->killTask(tid);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->killTask(tid);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets exception if creating long fails.
 }
 
@@ -468,7 +486,10 @@ PyObject* MesosSchedulerDriverImpl_declineOffer(MesosSchedulerDriverImpl* self,
     }
   }
 
-  Status status = self->driver->declineOffer(offerId, filters);
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->declineOffer(offerId, filters);
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets exception if creating long fails.
 }
 
@@ -480,7 +501,10 @@ PyObject* MesosSchedulerDriverImpl_reviveOffers(MesosSchedulerDriverImpl* self)
     return NULL;
   }
 
-  Status status = self->driver->reviveOffers();
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->reviveOffers();
+  Py_END_ALLOW_THREADS
   return PyInt_FromLong(status); // Sets exception if creating long fails.
 }
 
@@ -516,8 +540,11 @@ PyObject* MesosSchedulerDriverImpl_sendFrameworkMessage(
     return NULL;
   }
 
-  Status status = self->driver->sendFrameworkMessage(
+  Status status;
+  Py_BEGIN_ALLOW_THREADS
+  status = self->driver->sendFrameworkMessage(
       executorId, slaveId, string(data, length));
+  Py_END_ALLOW_THREADS
 
   return PyInt_FromLong(status); // Sets exception if creating long fails.
 }
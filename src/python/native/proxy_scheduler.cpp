@@ -243,6 +243,42 @@ cleanup:
 }
 
 
+void ProxyScheduler::statusUpdates(SchedulerDriver* driver,
+                                   const vector<TaskStatus>& statuses)
+{
+  // Deliver the whole batch under a single interpreter lock
+  // acquisition: a burst of updates otherwise costs one GIL round
+  // trip (and two interpreter transitions) per update.
+  InterpreterLock lock;
+
+  for (size_t i = 0; i < statuses.size(); i++) {
+    PyObject* stat = createPythonProtobuf(statuses[i], "TaskStatus");
+    if (stat == NULL) {
+      break; // createPythonProtobuf will have set an exception.
+    }
+
+    PyObject* res = PyObject_CallMethod(impl->pythonScheduler,
+                                        (char*) "statusUpdate",
+                                        (char*) "OO",
+                                        impl,
+                                        stat);
+
+    Py_XDECREF(stat);
+    Py_XDECREF(res);
+
+    if (res == NULL) {
+      cerr << "Failed to call scheduler's statusUpdate" << endl;
+      break;
+    }
+  }
+
+  if (PyErr_Occurred()) {
+    PyErr_Print();
+    driver->abort();
+  }
+}
+
+
 void ProxyScheduler::frameworkMessage(SchedulerDriver* driver,
                                       const ExecutorID& executorId,
                                       const SlaveID& slaveId,
@@ -18,6 +18,7 @@
 
 #include <dlfcn.h>
 #include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,6 +26,7 @@
 
 #include <arpa/inet.h>
 
+#include <deque>
 #include <iostream>
 #include <map>
 #include <string>
@@ -42,6 +44,7 @@
 #include <stout/error.hpp>
 #include <stout/fatal.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/numify.hpp>
 #include <stout/os.hpp>
 #include <stout/uuid.hpp>
 
@@ -49,6 +52,7 @@
 #include "configurator/configurator.hpp"
 
 #include "common/lock.hpp"
+#include "common/metrics.hpp"
 #include "common/type_utils.hpp"
 
 #include "detector/detector.hpp"
@@ -77,6 +81,114 @@ using process::wait; // Necessary on some OS's to disambiguate.
 namespace mesos {
 namespace internal {
 
+// Delivers Scheduler callbacks from a small pool of worker threads
+// when concurrent callback delivery has been enabled (see the
+// MESOS_SCHEDULER_CALLBACK_THREADS check in SchedulerProcess). Each
+// worker owns a FIFO queue and callbacks are routed by key, so any
+// two callbacks enqueued with the same key (e.g., status updates for
+// the same task) are delivered in order by the same thread, while
+// callbacks with different keys may be delivered concurrently.
+class CallbackPool
+{
+public:
+  CallbackPool(size_t _size, metrics::Registry* metrics)
+    : size(_size),
+      workers(new Worker[_size]),
+      pending(0),
+      depth(metrics->gauge("callback_queue_depth")),
+      delivered(metrics->counter("callbacks_delivered"))
+  {
+    for (size_t i = 0; i < size; i++) {
+      workers[i].pool = this;
+      workers[i].shutdown = false;
+      pthread_mutex_init(&workers[i].mutex, NULL);
+      pthread_cond_init(&workers[i].cond, NULL);
+      pthread_create(&workers[i].thread, NULL, &CallbackPool::run, &workers[i]);
+    }
+  }
+
+  // Drains all queued callbacks and then joins the workers.
+  ~CallbackPool()
+  {
+    for (size_t i = 0; i < size; i++) {
+      Lock lock(&workers[i].mutex);
+      workers[i].shutdown = true;
+      pthread_cond_signal(&workers[i].cond);
+    }
+
+    for (size_t i = 0; i < size; i++) {
+      pthread_join(workers[i].thread, NULL);
+      pthread_mutex_destroy(&workers[i].mutex);
+      pthread_cond_destroy(&workers[i].cond);
+    }
+
+    delete[] workers;
+  }
+
+  void enqueue(size_t key, const std::tr1::function<void()>& callback)
+  {
+    Worker* worker = &workers[key % size];
+
+    depth->set((double) __sync_add_and_fetch(&pending, 1));
+
+    Lock lock(&worker->mutex);
+    worker->queue.push_back(callback);
+    pthread_cond_signal(&worker->cond);
+  }
+
+private:
+  CallbackPool(const CallbackPool&);              // No copying.
+  CallbackPool& operator = (const CallbackPool&); // No assigning.
+
+  struct Worker
+  {
+    CallbackPool* pool;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    std::deque<std::tr1::function<void()> > queue;
+    bool shutdown;
+  };
+
+  static void* run(void* arg)
+  {
+    Worker* worker = reinterpret_cast<Worker*>(arg);
+
+    while (true) {
+      std::tr1::function<void()> callback;
+      {
+        Lock lock(&worker->mutex);
+        while (worker->queue.empty() && !worker->shutdown) {
+          pthread_cond_wait(&worker->cond, &worker->mutex);
+        }
+        if (worker->queue.empty()) {
+          break; // Shutting down and fully drained.
+        }
+        callback = worker->queue.front();
+        worker->queue.pop_front();
+      }
+
+      worker->pool->depth->set(
+          (double) __sync_sub_and_fetch(&worker->pool->pending, 1));
+
+      callback();
+
+      worker->pool->delivered->increment();
+    }
+
+    return NULL;
+  }
+
+  const size_t size;
+  Worker* workers;
+
+  volatile uint64_t pending; // Callbacks enqueued but not yet delivered.
+
+  metrics::Gauge* depth;
+  metrics::Counter* delivered;
+};
+
+
 // The scheduler process (below) is responsible for interacting with
 // the master and responding to Mesos API calls from scheduler
 // drivers. In order to allow a message to be sent back to the master
@@ -104,12 +216,77 @@ public:
       connected(false),
       aborted(false),
       // TODO(benh): Add Try().
-      detector(Error("uninitialized"))
-  {}
+      detector(Error("uninitialized")),
+      pool(NULL)
+  {
+    // Opt-in concurrent callback delivery: when
+    // MESOS_SCHEDULER_CALLBACK_THREADS is set to a positive number we
+    // deliver callbacks from that many worker threads instead of
+    // invoking them inline (see CallbackPool above). Note that the
+    // scheduler must be thread safe in this mode!
+    if (os::hasenv("MESOS_SCHEDULER_CALLBACK_THREADS")) {
+      string value = os::getenv("MESOS_SCHEDULER_CALLBACK_THREADS");
+      Try<size_t> threads = numify<size_t>(value);
+      if (threads.isError()) {
+        LOG(WARNING) << "Ignoring MESOS_SCHEDULER_CALLBACK_THREADS='"
+                     << value << "': " << threads.error();
+      } else if (threads.get() > 0) {
+        pool = new CallbackPool(threads.get(), &metrics);
+      }
+    }
 
-  virtual ~SchedulerProcess() {}
+    // Opt-in backpressure notifications: when
+    // MESOS_DRIVER_BACKLOG_THRESHOLD is set to a positive number the
+    // scheduler's 'backlogged' callback is invoked whenever this
+    // process's event queue depth crosses it (see ProcessBase).
+    if (os::hasenv("MESOS_DRIVER_BACKLOG_THRESHOLD")) {
+      string value = os::getenv("MESOS_DRIVER_BACKLOG_THRESHOLD");
+      Try<size_t> threshold = numify<size_t>(value);
+      if (threshold.isError()) {
+        LOG(WARNING) << "Ignoring MESOS_DRIVER_BACKLOG_THRESHOLD='"
+                     << value << "': " << threshold.error();
+      } else {
+        setBacklogThreshold(threshold.get());
+      }
+    }
+
+    pendingSends = 0;
+  }
+
+  virtual ~SchedulerProcess()
+  {
+    // NOTE: This drains any callbacks still queued and joins the
+    // worker threads, so it must not run from a worker thread (it
+    // runs on the driver's thread, after the process has terminated).
+    delete pool;
+  }
+
+  // Fills in queue/backpressure statistics for the driver. NOTE:
+  // This is invoked directly (not dispatched) so that it reflects
+  // the queue even when this process is backed up; it only touches
+  // state that is safe to read from another thread.
+  void driverStats(DriverStats* stats)
+  {
+    QueueStats snapshot = queueStats();
+    stats->set_queue_depth(snapshot.depth);
+    stats->set_queue_watermark(snapshot.watermark);
+    stats->set_events_enqueued(snapshot.enqueued);
+    stats->set_events_handled(snapshot.handled);
+    stats->set_oldest_event_age(snapshot.oldest);
+    stats->set_pending_sends(__sync_add_and_fetch(&pendingSends, 0));
+  }
 
 protected:
+  virtual void backlogged(size_t depth)
+  {
+    // NOTE: Invoked from whichever thread enqueued the crossing event
+    // (see ProcessBase::backlogged); Scheduler::backlogged documents
+    // that it is not serialized with the other callbacks.
+    DriverStats stats;
+    driverStats(&stats);
+    scheduler->backlogged(driver, stats);
+  }
+
   virtual void initialize()
   {
     // The master detector needs to be created after this process is
@@ -154,6 +331,9 @@ protected:
         &StatusUpdateMessage::update,
         &StatusUpdateMessage::pid);
 
+    install<StatusUpdatesMessage>(
+        &SchedulerProcess::statusUpdates);
+
     install<LostSlaveMessage>(
         &SchedulerProcess::lostSlave,
         &LostSlaveMessage::slave_id);
@@ -168,6 +348,30 @@ protected:
     install<FrameworkErrorMessage>(
         &SchedulerProcess::error,
         &FrameworkErrorMessage::message);
+
+    if (pool != NULL) {
+      publishMetrics();
+    }
+  }
+
+  // Periodically publishes the callback delivery metrics into the
+  // statistics time series (only active in concurrent callback mode).
+  void publishMetrics()
+  {
+    metrics.publish("scheduler");
+    delay(Seconds(10.0), self(), &Self::publishMetrics);
+  }
+
+  // Runs a callback inline, or hands it to the worker pool when
+  // concurrent callback delivery is enabled. Callbacks enqueued with
+  // the same key are always delivered in order (see CallbackPool).
+  void invoke(size_t key, const std::tr1::function<void()>& callback)
+  {
+    if (pool != NULL) {
+      pool->enqueue(key, callback);
+    } else {
+      callback();
+    }
   }
 
   virtual void finalize()
@@ -197,7 +401,7 @@ protected:
     connected = false;
     master = UPID();
 
-    scheduler->disconnected(driver);
+    invoke(0, std::tr1::bind(&Scheduler::disconnected, scheduler, driver));
   }
 
   void registered(const FrameworkID& frameworkId, const MasterInfo& masterInfo)
@@ -221,7 +425,8 @@ protected:
     connected = true;
     failover = false;
 
-    scheduler->registered(driver, frameworkId, masterInfo);
+    invoke(0, std::tr1::bind(
+        &Scheduler::registered, scheduler, driver, frameworkId, masterInfo));
   }
 
   void reregistered(const FrameworkID& frameworkId, const MasterInfo& masterInfo)
@@ -245,7 +450,8 @@ protected:
     connected = true;
     failover = false;
 
-    scheduler->reregistered(driver, masterInfo);
+    invoke(0, std::tr1::bind(
+        &Scheduler::reregistered, scheduler, driver, masterInfo));
   }
 
   void doReliableRegistration()
@@ -296,7 +502,8 @@ protected:
       }
     }
 
-    scheduler->resourceOffers(driver, offers);
+    invoke(0, std::tr1::bind(
+        &Scheduler::resourceOffers, scheduler, driver, offers));
   }
 
   void rescindOffer(const OfferID& offerId)
@@ -311,7 +518,56 @@ protected:
 
     savedOffers.erase(offerId);
 
-    scheduler->offerRescinded(driver, offerId);
+    invoke(0, std::tr1::bind(
+        &Scheduler::offerRescinded, scheduler, driver, offerId));
+  }
+
+  // Unpacks a batch of status updates sent by the master, see
+  // Master::statusUpdate. In serial callback mode the batch is
+  // delivered through Scheduler::statusUpdates in a single call so
+  // that language bindings can amortize their per-callback overhead
+  // (e.g., one interpreter lock acquisition per batch); in concurrent
+  // callback mode the updates go through the per-task worker queues
+  // individually to preserve per-task ordering.
+  void statusUpdates(const StatusUpdatesMessage& message)
+  {
+    if (pool != NULL || message.updates_size() <= 1) {
+      foreach (const StatusUpdateMessage& forward, message.updates()) {
+        statusUpdate(
+            forward.update(),
+            forward.has_pid() ? UPID(forward.pid()) : UPID());
+      }
+      return;
+    }
+
+    if (aborted) {
+      VLOG(1) << "Ignoring status updates message because "
+              << "the driver is aborted!";
+      return;
+    }
+
+    VLOG(1) << "Received " << message.updates_size() << " status updates";
+
+    vector<TaskStatus> statuses;
+    statuses.reserve(message.updates_size());
+
+    foreach (const StatusUpdateMessage& forward, message.updates()) {
+      CHECK(framework.id() == forward.update().framework_id());
+      statuses.push_back(forward.update().status());
+    }
+
+    scheduler->statusUpdates(driver, statuses);
+
+    // Acknowledge each update (see statusUpdate for why we dispatch
+    // instead of sending the ACKs directly).
+    foreach (const StatusUpdateMessage& forward, message.updates()) {
+      if (forward.has_pid() && UPID(forward.pid()) > 0) {
+        dispatch(self(),
+                 &Self::statusUpdateAcknowledgement,
+                 forward.update(),
+                 UPID(forward.pid()));
+      }
+    }
   }
 
   void statusUpdate(const StatusUpdate& update, const UPID& pid)
@@ -337,13 +593,24 @@ protected:
     // multiple times (of course, if a scheduler re-uses a TaskID,
     // that could be bad.
 
-    scheduler->statusUpdate(driver, status);
+    // Updates for the same task hash to the same worker queue so that
+    // they are delivered in order even in concurrent callback mode.
+    invoke(
+        std::tr1::hash<string>()(status.task_id().value()),
+        std::tr1::bind(&Self::deliverStatusUpdate, this, update, pid));
+  }
+
+  // Delivers a status update to the scheduler and then acknowledges
+  // it. In concurrent callback mode this runs on a worker thread.
+  // NOTE: We do a dispatch here instead of directly sending the ACK because,
+  // we want to avoid sending the ACK if the driver was aborted when we
+  // made the statusUpdate call. This works because, the 'abort' message will
+  // be enqueued before the ACK message is processed.
+  void deliverStatusUpdate(const StatusUpdate& update, const UPID& pid)
+  {
+    scheduler->statusUpdate(driver, update.status());
 
     // Acknowledge the status update.
-    // NOTE: We do a dispatch here instead of directly sending the ACK because,
-    // we want to avoid sending the ACK if the driver was aborted when we
-    // made the statusUpdate call. This works because, the 'abort' message will
-    // be enqueued before the ACK message is processed.
     if (pid > 0) {
       dispatch(self(), &Self::statusUpdateAcknowledgement, update, pid);
     }
@@ -357,14 +624,47 @@ protected:
       return;
     }
 
-    VLOG(1) << "Sending ACK for status update " << update << " to " << pid;
+    VLOG(1) << "Queueing ACK for status update " << update << " to " << pid;
+
+    // Coalesce acknowledgements destined for the same slave within a
+    // small window into one batched message, halving the message
+    // volume during completion storms (cf. the status update batching
+    // in Master::statusUpdate).
+    StatusUpdateAcknowledgementMessage* acknowledgement =
+      pendingAcknowledgements[pid].add_acknowledgements();
+    acknowledgement->mutable_framework_id()->MergeFrom(framework.id());
+    acknowledgement->mutable_slave_id()->MergeFrom(update.slave_id());
+    acknowledgement->mutable_task_id()->MergeFrom(update.status().task_id());
+    acknowledgement->set_uuid(update.uuid());
+
+    __sync_add_and_fetch(&pendingSends, 1);
+
+    if (pendingAcknowledgements[pid].acknowledgements_size() == 1) {
+      delay(Milliseconds(10.0),
+            self(),
+            &Self::flushStatusUpdateAcknowledgements,
+            pid);
+    }
+  }
 
-    StatusUpdateAcknowledgementMessage message;
-    message.mutable_framework_id()->MergeFrom(framework.id());
-    message.mutable_slave_id()->MergeFrom(update.slave_id());
-    message.mutable_task_id()->MergeFrom(update.status().task_id());
-    message.set_uuid(update.uuid());
-    send(pid, message);
+  void flushStatusUpdateAcknowledgements(const UPID& pid)
+  {
+    if (pendingAcknowledgements.count(pid) == 0) {
+      return;
+    }
+
+    if (!aborted) {
+      VLOG(1) << "Sending "
+              << pendingAcknowledgements[pid].acknowledgements_size()
+              << " status update acknowledgements to " << pid;
+      send(pid, pendingAcknowledgements[pid]);
+    }
+
+    __sync_sub_and_fetch(
+        &pendingSends,
+        pendingAcknowledgements[pid].acknowledgements_size());
+
+    pendingAcknowledgements.erase(pid);
   }
 
   void lostSlave(const SlaveID& slaveId)
@@ -385,7 +685,7 @@ protected:
 
     savedSlavePids.erase(slaveId);
 
-    scheduler->slaveLost(driver, slaveId);
+    invoke(0, std::tr1::bind(&Scheduler::slaveLost, scheduler, driver, slaveId));
   }
 
   void frameworkMessage(const SlaveID& slaveId,
@@ -400,7 +700,14 @@ protected:
 
     VLOG(1) << "Received framework message";
 
-    scheduler->frameworkMessage(driver, executorId, slaveId, data);
+    // Messages from the same executor hash to the same worker queue
+    // so that they are delivered in order even in concurrent callback
+    // mode.
+    invoke(
+        std::tr1::hash<string>()(executorId.value()),
+        std::tr1::bind(
+            &Scheduler::frameworkMessage,
+            scheduler, driver, executorId, slaveId, data));
   }
 
   void error(const string& message)
@@ -414,7 +721,7 @@ protected:
 
     driver->abort();
 
-    scheduler->error(driver, message);
+    invoke(0, std::tr1::bind(&Scheduler::error, scheduler, driver, message));
   }
 
   void stop(bool failover)
@@ -488,7 +795,7 @@ protected:
     send(master, message);
   }
 
-  void launchTasks(const OfferID& offerId,
+  void launchTasks(const vector<OfferID>& offerIds,
                    const vector<TaskInfo>& tasks,
                    const Filters& filters)
   {
@@ -537,28 +844,44 @@ protected:
 
     LaunchTasksMessage message;
     message.mutable_framework_id()->MergeFrom(framework.id());
-    message.mutable_offer_id()->MergeFrom(offerId);
     message.mutable_filters()->MergeFrom(filters);
 
+    foreach (const OfferID& offerId, offerIds) {
+      message.add_offer_ids()->MergeFrom(offerId);
+    }
+
+    // Keep populating the singular field for a single offer so that
+    // an older master can still process the reply.
+    if (offerIds.size() == 1) {
+      message.mutable_offer_id()->MergeFrom(offerIds[0]);
+    }
+
     foreach (const TaskInfo& task, tasks) {
       // Keep only the slave PIDs where we run tasks so we can send
       // framework messages directly.
-      if (savedOffers.count(offerId) > 0) {
-        if (savedOffers[offerId].count(task.slave_id()) > 0) {
+      bool found = false;
+      foreach (const OfferID& offerId, offerIds) {
+        if (savedOffers.count(offerId) > 0 &&
+            savedOffers[offerId].count(task.slave_id()) > 0) {
           savedSlavePids[task.slave_id()] =
             savedOffers[offerId][task.slave_id()];
-        } else {
-          VLOG(1) << "Attempting to launch a task with the wrong slave id";
+          found = true;
+          break;
         }
-      } else {
-        VLOG(1) << "Attempting to launch a task with an unknown offer";
+      }
+
+      if (!found) {
+        VLOG(1) << "Attempting to launch task " << task.task_id()
+                << " with an unknown offer or the wrong slave id";
       }
 
       message.add_tasks()->MergeFrom(task);
     }
 
-    // Remove the offer since we saved all the PIDs we might use.
-    savedOffers.erase(offerId);
+    // Remove the offers since we saved all the PIDs we might use.
+    foreach (const OfferID& offerId, offerIds) {
+      savedOffers.erase(offerId);
+    }
 
     send(master, message);
   }
@@ -635,6 +958,20 @@ private:
 
   hashmap<OfferID, hashmap<SlaveID, UPID> > savedOffers;
   hashmap<SlaveID, UPID> savedSlavePids;
+
+  // Status update acknowledgements batched per slave, awaiting the
+  // flush timer (see statusUpdateAcknowledgement).
+  hashmap<UPID, StatusUpdateAcknowledgementsMessage> pendingAcknowledgements;
+
+  // Non-NULL when concurrent callback delivery is enabled; the
+  // registry holds the pool's queue depth and delivery metrics.
+  metrics::Registry metrics;
+  CallbackPool* pool;
+
+  // Number of coalesced-but-unsent messages (currently just status
+  // update acknowledgements), updated atomically since it gets read
+  // by driverStats from other threads.
+  volatile uint64_t pendingSends;
 };
 
 } // namespace internal {
@@ -870,6 +1207,18 @@ Status MesosSchedulerDriver::launchTasks(
     const OfferID& offerId,
     const vector<TaskInfo>& tasks,
     const Filters& filters)
+{
+  vector<OfferID> offerIds;
+  offerIds.push_back(offerId);
+
+  return launchTasks(offerIds, tasks, filters);
+}
+
+
+Status MesosSchedulerDriver::launchTasks(
+    const vector<OfferID>& offerIds,
+    const vector<TaskInfo>& tasks,
+    const Filters& filters)
 {
   Lock lock(&mutex);
 
@@ -879,7 +1228,7 @@ Status MesosSchedulerDriver::launchTasks(
 
   CHECK(process != NULL);
 
-  dispatch(process, &SchedulerProcess::launchTasks, offerId, tasks, filters);
+  dispatch(process, &SchedulerProcess::launchTasks, offerIds, tasks, filters);
 
   return status;
 }
@@ -929,6 +1278,24 @@ Status MesosSchedulerDriver::sendFrameworkMessage(
 }
 
 
+Status MesosSchedulerDriver::stats(DriverStats* stats)
+{
+  Lock lock(&mutex);
+
+  if (status != DRIVER_RUNNING) {
+    return status;
+  }
+
+  CHECK(process != NULL);
+
+  // NOTE: Deliberately not dispatched; see
+  // SchedulerProcess::driverStats.
+  process->driverStats(stats);
+
+  return status;
+}
+
+
 Status MesosSchedulerDriver::requestResources(
     const vector<Request>& requests)
 {
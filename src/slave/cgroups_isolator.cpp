@@ -18,6 +18,7 @@
 
 #include <math.h> // For floor.
 #include <signal.h>
+#include <stdio.h> // For rename.
 #include <unistd.h>
 
 #include <sys/file.h> // For flock.
@@ -59,6 +60,7 @@
 #include "logging/check_some.hpp"
 
 #include "slave/cgroups_isolator.hpp"
+#include "slave/paths.hpp"
 #include "slave/state.hpp"
 
 using process::defer;
@@ -196,7 +198,8 @@ std::ostream& operator << (std::ostream& out, const Cpuset& cpuset)
 CgroupsIsolator::CgroupsIsolator()
   : ProcessBase(ID::generate("cgroups-isolator")),
     initialized(false),
-    lockFile(None())
+    lockFile(None()),
+    statReader(NULL)
 {
   // Spawn the reaper, note that it might send us a message before we
   // actually get spawned ourselves, but that's okay, the message will
@@ -213,6 +216,8 @@ CgroupsIsolator::~CgroupsIsolator()
   terminate(reaper);
   process::wait(reaper); // Necessary for disambiguation.
   delete reaper;
+
+  delete statReader;
 }
 
 
@@ -364,6 +369,14 @@ void CgroupsIsolator::initialize(
 
   CHECK_SOME(write) << "Failed to disable OOM killer";
 
+  // Cache the stat file descriptors used for resource monitoring,
+  // now that the hierarchy is known to be mounted.
+  vector<string> controls;
+  controls.push_back("cpuacct.stat");
+  controls.push_back("memory.stat");
+
+  statReader = new cgroups::StatReader(hierarchy, controls);
+
   if (subsystems.contains("cpu") && subsystems.contains("cpuset")) {
     EXIT(1) << "The use of both 'cpu' and 'cpuset' subsystems is not allowed.\n"
             << "Please use only one of:\n"
@@ -422,10 +435,10 @@ void CgroupsIsolator::initialize(
       }
     }
 
-    Value::Scalar none;
-    Value::Scalar cpusResource = _resources.get("cpus", none);
-    if (cpusResource.value() > cgroupCpus.size()) {
-      EXIT(1) << "You have specified " << cpusResource.value() << " cpus, but "
+    Option<double> cpusOption = _resources.cpus();
+    double cpusResource = cpusOption.isSome() ? cpusOption.get() : 0.0;
+    if (cpusResource > cgroupCpus.size()) {
+      EXIT(1) << "You have specified " << cpusResource << " cpus, but "
               << "this is more than allowed by the cgroup cpuset.cpus: "
               << cpuset.get();
     }
@@ -436,7 +449,7 @@ void CgroupsIsolator::initialize(
     CHECK_SOME(cpus) << "Failed to extract CPUs from /proc/cpuinfo";
 
     foreach (const proc::CPU& cpu, cpus.get()) {
-      if (this->cpus.size() >= cpusResource.value()) {
+      if (this->cpus.size() >= cpusResource) {
         break;
       }
 
@@ -478,6 +491,9 @@ void CgroupsIsolator::initialize(
   }
 
   initialized = true;
+
+  // Seed the pool of pre-created cgroups, if one was requested.
+  replenishCgroupPool();
 }
 
 
@@ -517,6 +533,8 @@ void CgroupsIsolator::launchExecutor(
   CgroupInfo* info =
     registerCgroupInfo(frameworkId, executorId, uuid, None(), flags);
 
+  info->disk = new DiskUsageTracker(directory);
+
   LOG(INFO) << "Launching " << executorId
             << " (" << executorInfo.command().value() << ")"
             << " in " << directory
@@ -524,20 +542,38 @@ void CgroupsIsolator::launchExecutor(
             << " for framework " << frameworkId
             << " in cgroup " << info->name();
 
-  // Create a new cgroup for the executor.
-  Try<Nothing> create = cgroups::create(hierarchy, info->name());
-
-  if (create.isError()) {
-    LOG(FATAL) << "Failed to create cgroup for executor " << executorId
-               << " of framework " << frameworkId
-               << ": " << create.error();
+  // Take a pre-created cgroup from the pool if one is available,
+  // renaming it into place. This is considerably cheaper than
+  // creating the cgroup (and its per-subsystem control files) here,
+  // which matters during scheduling bursts.
+  bool pooled = false;
+  while (!pooled && !cgroupPool.empty()) {
+    const string cgroup = cgroupPool.front();
+    cgroupPool.pop_front();
+
+    if (::rename(path::join(hierarchy, cgroup).c_str(),
+                 path::join(hierarchy, info->name()).c_str()) == 0) {
+      pooled = true;
+    } else {
+      PLOG(WARNING) << "Failed to rename pooled cgroup '" << cgroup
+                    << "' into place, discarding it";
+    }
   }
 
-  // Setup the initial resource constrains.
-  resourcesChanged(frameworkId, executorId, resources);
+  if (pooled) {
+    // Replace the cgroup taken above, off the launch critical path.
+    dispatch(PID<CgroupsIsolator>(this),
+             &CgroupsIsolator::replenishCgroupPool);
+  } else {
+    // Create a new cgroup for the executor.
+    Try<Nothing> create = cgroups::create(hierarchy, info->name());
 
-  // Start listening on OOM events.
-  oomListen(frameworkId, executorId);
+    if (create.isError()) {
+      LOG(FATAL) << "Failed to create cgroup for executor " << executorId
+                 << " of framework " << frameworkId
+                 << ": " << create.error();
+    }
+  }
 
   // Launch the executor using fork-exec.
   pid_t pid;
@@ -552,6 +588,14 @@ void CgroupsIsolator::launchExecutor(
     // Store the pid of the leading process of the executor.
     info->pid = pid;
 
+    // Setup the initial resource constraints and start listening on
+    // OOM events. Doing this after the fork takes the control file
+    // writes off the launch critical path; the executor only enters
+    // the cgroup once it has finished fetching (see the child branch
+    // below), long after these writes have landed.
+    resourcesChanged(frameworkId, executorId, resources);
+    oomListen(frameworkId, executorId);
+
     // Tell the slave this executor has started.
     dispatch(slave,
              &Slave::executorStarted,
@@ -573,6 +617,9 @@ void CgroupsIsolator::launchExecutor(
         slave,
         flags.frameworks_home,
         flags.hadoop_home,
+        paths::getFetchCacheDir(flags.work_dir),
+        flags.fetch_cache_size,
+        flags.fetch_rate_limit,
         !local,
         flags.switch_user,
         frameworkInfo.checkpoint());
@@ -690,32 +737,67 @@ Future<ResourceStatistics> CgroupsIsolator::usage(
 
   result.set_timestamp(Clock::now());
 
-  Try<hashmap<string, uint64_t> > stat =
-    cgroups::stat(hierarchy, info->name(), "cpuacct.stat");
+  // Read all the watched controls in one pass through the cached
+  // file descriptors rather than open/read/close per control.
+  CHECK_NOTNULL(statReader);
+  Try<hashmap<string, hashmap<string, uint64_t> >, ErrorCode> read =
+    statReader->read(info->name());
 
-  if (stat.isError()) {
+  if (read.isError()) {
+    // NOTE: The message is only formatted here, on the (expected but
+    // infrequent per executor) error path.
     return Future<ResourceStatistics>::failed(
-        "Failed to read cpuacct.stat: " + stat.error());
+        "Failed to read cgroup statistics: " + read.error().message());
   }
 
+  // NOTE: hashmap::get() returns by value, hence the named locals.
+  const hashmap<string, uint64_t> cpuacct =
+    read.get().get("cpuacct.stat").get();
+  const hashmap<string, uint64_t> memory =
+    read.get().get("memory.stat").get();
+
   // TODO(bmahler): Add namespacing to cgroups to enforce the expected
   // structure, e.g., cgroups::cpuacct::stat.
-  if (stat.get().contains("user") && stat.get().contains("system")) {
-    result.set_cpu_user_time((double) stat.get()["user"] / (double) ticks);
-    result.set_cpu_system_time((double) stat.get()["system"] / (double) ticks);
+  if (cpuacct.contains("user") && cpuacct.contains("system")) {
+    result.set_cpu_user_time(
+        (double) cpuacct.get("user").get() / (double) ticks);
+    result.set_cpu_system_time(
+        (double) cpuacct.get("system").get() / (double) ticks);
   }
 
-  stat = cgroups::stat(hierarchy, info->name(), "memory.stat");
+  // TODO(bmahler): Add namespacing to cgroups to enforce the expected
+  // structure, e.g, cgroups::memory::stat.
+  if (memory.contains("rss")) {
+    result.set_memory_rss(memory.get("rss").get());
+  }
 
-  if (stat.isError()) {
-    return Future<ResourceStatistics>::failed(
-        "Failed to read memory.stat: " + stat.error());
+  // Account sandbox disk usage. This is cheap after the first call,
+  // which seeds the accounting with a full walk of the sandbox.
+  if (info->disk != NULL) {
+    info->disk->update();
+    result.set_disk_used_bytes(info->disk->usage().bytes());
   }
 
-  // TODO(bmahler): Add namespacing to cgroups to enforce the expected
-  // structure, e.g, cgroups::memory::stat.
-  if (stat.get().contains("rss")) {
-    result.set_memory_rss(stat.get()["rss"]);
+  return result;
+}
+
+
+Future<Usages> CgroupsIsolator::usages(const ExecutorSet& executors)
+{
+  // Each executor's usage comes from two small cgroup control files,
+  // so the win of batching is doing a whole monitoring pass with a
+  // single dispatch into this process rather than one round trip per
+  // executor.
+  Usages result;
+
+  foreachkey (const FrameworkID& frameworkId, executors) {
+    foreach (const ExecutorID& executorId,
+             executors.get(frameworkId).get()) {
+      Future<ResourceStatistics> future = usage(frameworkId, executorId);
+      if (future.isReady()) {
+        result[frameworkId][executorId] = future.get();
+      }
+    }
   }
 
   return result;
@@ -780,6 +862,14 @@ Future<Nothing> CgroupsIsolator::recover(
   }
 
   foreach (const string& orphan, orphans.get()) {
+    // The current pool of pre-created cgroups is not orphaned! Pooled
+    // cgroups left over from a previous slave execution are though,
+    // and get destroyed here like any other orphan.
+    if (std::find(cgroupPool.begin(), cgroupPool.end(), orphan) !=
+        cgroupPool.end()) {
+      continue;
+    }
+
     if (!cgroups.contains(orphan)) {
       LOG(INFO) << "Removing orphaned cgroup '" << orphan << "'";
       cgroups::destroy(hierarchy, orphan)
@@ -1130,6 +1220,27 @@ void CgroupsIsolator::_destroy(
 }
 
 
+void CgroupsIsolator::replenishCgroupPool()
+{
+  CHECK(initialized) << "Cannot pre-create cgroups before initialization";
+
+  while (cgroupPool.size() < (size_t) flags.cgroups_pool_size) {
+    const string& cgroup = path::join(
+        flags.cgroups_root, "staging_" + UUID::random().toString());
+
+    Try<Nothing> create = cgroups::create(hierarchy, cgroup);
+
+    if (create.isError()) {
+      LOG(ERROR) << "Failed to pre-create cgroup '" << cgroup
+                 << "': " << create.error();
+      return;
+    }
+
+    cgroupPool.push_back(cgroup);
+  }
+}
+
+
 void CgroupsIsolator::_killExecutor(
     CgroupInfo* info,
     const Future<bool>& future)
@@ -1190,6 +1301,7 @@ CgroupsIsolator::CgroupInfo* CgroupsIsolator::registerCgroupInfo(
   } else {
     info->cpuset = NULL;
   }
+  info->disk = NULL;
   infos[frameworkId][executorId] = info;
   return info;
 }
@@ -1201,6 +1313,10 @@ void CgroupsIsolator::unregisterCgroupInfo(
 {
   if (infos.contains(frameworkId)) {
     if (infos[frameworkId].contains(executorId)) {
+      // Drop the cached stat file descriptors for the cgroup.
+      if (statReader != NULL) {
+        statReader->forget(infos[frameworkId][executorId]->name());
+      }
       delete infos[frameworkId][executorId];
       infos[frameworkId].erase(executorId);
       if (infos[frameworkId].empty()) {
@@ -21,6 +21,7 @@
 
 #include <unistd.h>
 
+#include <list>
 #include <map>
 #include <sstream>
 #include <string>
@@ -38,6 +39,9 @@
 
 #include "launcher/launcher.hpp"
 
+#include "linux/cgroups.hpp"
+
+#include "slave/disk_usage.hpp"
 #include "linux/proc.hpp"
 
 #include "slave/flags.hpp"
@@ -114,6 +118,8 @@ public:
       const FrameworkID& frameworkId,
       const ExecutorID& executorId);
 
+  virtual process::Future<Usages> usages(const ExecutorSet& executors);
+
   virtual process::Future<Nothing> recover(
       const Option<state::SlaveState>& state);
 
@@ -133,6 +139,8 @@ private:
         delete cpuset;
         cpuset = NULL;
       }
+
+      delete disk;
     }
 
     // Returns the canonicalized name of the cgroup in the filesystem.
@@ -175,6 +183,10 @@ private:
 
     // CPUs allocated if using 'cpuset' subsystem.
     Cpuset* cpuset;
+
+    // Sandbox disk usage accounting (NULL when the sandbox path is
+    // unknown, e.g., for executors recovered from a previous slave).
+    DiskUsageTracker* disk;
   };
 
   // The callback which will be invoked when "cpus" resource has changed.
@@ -245,6 +257,13 @@ private:
       CgroupInfo* info,
       const process::Future<bool>& future);
 
+  // Pre-create cgroups until the pool holds 'cgroups_pool_size'
+  // entries. Launching an executor takes a cgroup from the pool by
+  // renaming it into place, which is considerably cheaper than
+  // creating the cgroup (and its control files) on the launch
+  // critical path.
+  void replenishCgroupPool();
+
   // This callback is invoked when destroying orphaned cgroups from the
   // previous slave execution.
   // @param   cgroup        The cgroup that is being destroyed.
@@ -303,9 +322,17 @@ private:
   // The path to the cgroups hierarchy root.
   std::string hierarchy;
 
+  // Reads the stat control files used for resource monitoring with
+  // cached file descriptors (created once the hierarchy is mounted).
+  cgroups::StatReader* statReader;
+
   // The cgroups subsystems being used.
   hashset<std::string> subsystems;
 
+  // Names of pre-created cgroups (relative to the hierarchy root)
+  // waiting to be renamed into place at executor launch.
+  std::list<std::string> cgroupPool;
+
   // Allocated cpus (if using cpuset subsystem).
   std::map<proc::CPU, double> cpus;
 
@@ -26,9 +26,16 @@ const Duration EXECUTOR_REGISTRATION_TIMEOUT = Minutes(1.0);
 const Duration EXECUTOR_SHUTDOWN_GRACE_PERIOD = Seconds(5.0);
 const Duration EXECUTOR_REREGISTER_TIMEOUT = Seconds(2.0);
 const Duration STATUS_UPDATE_RETRY_INTERVAL = Seconds(10.0);
+const Duration STATUS_UPDATE_FLUSH_INTERVAL = Milliseconds(10.0);
 const Duration GC_DELAY = Weeks(1.0);
 const Duration DISK_WATCH_INTERVAL = Minutes(1.0);
 const Duration RESOURCE_MONITORING_INTERVAL = Seconds(5.0);
+const int MONITORING_MAX_STRIDE = 16;
+const int MONITORING_STABLE_SAMPLES = 3;
+const double MONITORING_STABLE_FRACTION = 0.05;
+const double MONITORING_ACTIVE_CPU = 0.05; // In cores.
+const double MONITORING_LIMIT_FRACTION = 0.8;
+const Duration STATE_REFRESH_INTERVAL = Seconds(1.0);
 const uint32_t MAX_COMPLETED_FRAMEWORKS = 50;
 const uint32_t MAX_COMPLETED_EXECUTORS_PER_FRAMEWORK = 150;
 const uint32_t MAX_COMPLETED_TASKS_PER_EXECUTOR = 200;
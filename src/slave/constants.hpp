@@ -37,10 +37,36 @@ extern const Duration EXECUTOR_REGISTRATION_TIMEOUT;
 extern const Duration EXECUTOR_SHUTDOWN_GRACE_PERIOD;
 extern const Duration EXECUTOR_REREGISTER_TIMEOUT;
 extern const Duration STATUS_UPDATE_RETRY_INTERVAL;
+
+// How long checkpointed status update records may sit in the kernel's
+// buffers before they are fsync'ed (group commit window). Records
+// appended to the same file within a window share one fsync.
+extern const Duration STATUS_UPDATE_FLUSH_INTERVAL;
 extern const Duration GC_DELAY;
 extern const Duration DISK_WATCH_INTERVAL;
 extern const Duration RESOURCE_MONITORING_INTERVAL;
 
+// Adaptive monitoring cadence (see Cadence in slave/monitor.hpp).
+// Executors whose samples stay stable for MONITORING_STABLE_SAMPLES
+// consecutive samples double their stride (collection passes between
+// samples) up to MONITORING_MAX_STRIDE. A sample is unstable when the
+// cpu usage rate since the last sample exceeds MONITORING_ACTIVE_CPU
+// (cores), the rss moved by more than MONITORING_STABLE_FRACTION, or
+// the rss is within MONITORING_LIMIT_FRACTION of the executor's
+// memory limit (where tight sampling matters most).
+extern const int MONITORING_MAX_STRIDE;
+extern const int MONITORING_STABLE_SAMPLES;
+extern const double MONITORING_STABLE_FRACTION;
+extern const double MONITORING_ACTIVE_CPU;
+extern const double MONITORING_LIMIT_FRACTION;
+
+// How often the slave pushes freshly rendered 'stats.json' and
+// 'state.json' snapshots to the read-only server that answers
+// monitoring polls (see StateServerProcess in slave/http.hpp). This
+// bounds both the staleness of the snapshots and the rendering rate,
+// however frequently the endpoints are polled.
+extern const Duration STATE_REFRESH_INTERVAL;
+
 // Maximum number of completed frameworks to store in memory.
 extern const uint32_t MAX_COMPLETED_FRAMEWORKS;
 
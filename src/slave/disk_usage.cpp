@@ -0,0 +1,286 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dirent.h>
+#include <fts.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <stout/foreach.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
+
+#include "slave/disk_usage.hpp"
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+namespace {
+
+// A file whose recorded mtime is within this window is re-examined on
+// every update, since it is likely still being written to.
+const time_t RECENTLY_MODIFIED_WINDOW = 3600; // Seconds.
+
+// A directory whose mtime is within this window is re-examined even
+// if its mtime looks unchanged: mtimes have second granularity, so an
+// entry created in the same second as the previous examination would
+// otherwise go unnoticed until the next full walk.
+const time_t RECENTLY_CHANGED_DIRECTORY_WINDOW = 60; // Seconds.
+
+// Every so many updates the whole tree is re-walked, to pick up
+// in-place modifications of files that had gone idle (which change
+// neither their parent directory's mtime nor their recorded, stale
+// mtime). At the default 10 second monitoring interval this amounts
+// to about once an hour.
+const size_t UPDATES_PER_WALK = 360;
+
+} // namespace {
+
+
+DiskUsageTracker::DiskUsageTracker(const string& _directory)
+  : directory(_directory),
+    total(0),
+    updates(0) {}
+
+
+void DiskUsageTracker::update()
+{
+  if (updates % UPDATES_PER_WALK == 0) {
+    walk();
+    updates++;
+    return;
+  }
+
+  updates++;
+
+  time_t now = ::time(NULL);
+
+  // Re-examine directories whose mtime changed, i.e., those in which
+  // entries were created, removed or renamed. NOTE: The maps are
+  // mutated by scan() and forget(), so the candidates are collected
+  // first.
+  vector<string> changed;
+  vector<string> removed;
+
+  foreachpair (const string& path, time_t mtime, directories) {
+    struct stat s;
+    if (::lstat(path.c_str(), &s) < 0) {
+      removed.push_back(path);
+    } else if (s.st_mtime != mtime ||
+               s.st_mtime >= now - RECENTLY_CHANGED_DIRECTORY_WINDOW) {
+      changed.push_back(path);
+    }
+  }
+
+  foreach (const string& path, removed) {
+    forget(path);
+  }
+
+  foreach (const string& path, changed) {
+    if (directories.contains(path)) { // Not forgotten above.
+      scan(path);
+    }
+  }
+
+  // Re-examine recently modified files, to catch ones growing in
+  // place (their parent directory's mtime does not change).
+  vector<string> recent;
+
+  foreachpair (const string& path, const Entry& entry, files) {
+    if (entry.mtime >= now - RECENTLY_MODIFIED_WINDOW) {
+      recent.push_back(path);
+    }
+  }
+
+  foreach (const string& path, recent) {
+    struct stat s;
+    if (::lstat(path.c_str(), &s) < 0 || !S_ISREG(s.st_mode)) {
+      total -= files[path].size;
+      files.erase(path);
+    } else {
+      Entry& entry = files[path];
+      total -= entry.size;
+      entry.size = (uint64_t) s.st_blocks * 512;
+      entry.mtime = s.st_mtime;
+      total += entry.size;
+    }
+  }
+}
+
+
+void DiskUsageTracker::walk()
+{
+  files.clear();
+  directories.clear();
+  total = 0;
+
+  char* paths[] = { const_cast<char*>(directory.c_str()), NULL };
+
+  FTS* tree = fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL, NULL);
+  if (tree == NULL) {
+    return; // E.g., the sandbox has not been created yet.
+  }
+
+  FTSENT* node;
+  while ((node = fts_read(tree)) != NULL) {
+    switch (node->fts_info) {
+      case FTS_D:
+        directories[node->fts_path] = node->fts_statp->st_mtime;
+        break;
+      case FTS_F: {
+        Entry entry;
+        entry.size = (uint64_t) node->fts_statp->st_blocks * 512;
+        entry.mtime = node->fts_statp->st_mtime;
+        files[node->fts_path] = entry;
+        total += entry.size;
+        break;
+      }
+      default:
+        break; // Symlinks etc. are not accounted.
+    }
+  }
+
+  fts_close(tree);
+}
+
+
+void DiskUsageTracker::scan(const string& path)
+{
+  struct stat s;
+  if (::lstat(path.c_str(), &s) < 0) {
+    forget(path);
+    return;
+  }
+
+  directories[path] = s.st_mtime;
+
+  DIR* dir = ::opendir(path.c_str());
+  if (dir == NULL) {
+    return;
+  }
+
+  hashmap<string, bool> present;
+
+  struct dirent* entry;
+  while ((entry = ::readdir(dir)) != NULL) {
+    const string& name = entry->d_name;
+    if (name == "." || name == "..") {
+      continue;
+    }
+
+    const string& child = path::join(path, name);
+    present[child] = true;
+
+    if (::lstat(child.c_str(), &s) < 0) {
+      continue; // Removed while scanning.
+    }
+
+    if (S_ISDIR(s.st_mode)) {
+      if (!directories.contains(child)) {
+        // A new subdirectory: account its whole subtree.
+        scan(child);
+      }
+    } else if (S_ISREG(s.st_mode)) {
+      if (files.contains(child)) {
+        total -= files[child].size;
+      }
+      Entry record;
+      record.size = (uint64_t) s.st_blocks * 512;
+      record.mtime = s.st_mtime;
+      files[child] = record;
+      total += record.size;
+    }
+  }
+
+  ::closedir(dir);
+
+  // Drop recorded entries that are no longer present. NOTE: The maps
+  // are not mutated while being iterated.
+  vector<string> gone;
+
+  foreachkey (const string& file, files) {
+    if (strings::startsWith(file, path + "/") &&
+        file.find('/', path.size() + 1) == string::npos &&
+        !present.contains(file)) {
+      gone.push_back(file);
+    }
+  }
+
+  foreach (const string& file, gone) {
+    total -= files[file].size;
+    files.erase(file);
+  }
+
+  gone.clear();
+
+  foreachkey (const string& child, directories) {
+    if (strings::startsWith(child, path + "/") &&
+        child.find('/', path.size() + 1) == string::npos &&
+        !present.contains(child)) {
+      gone.push_back(child);
+    }
+  }
+
+  foreach (const string& child, gone) {
+    forget(child);
+  }
+}
+
+
+void DiskUsageTracker::forget(const string& path)
+{
+  vector<string> gone;
+
+  foreachkey (const string& file, files) {
+    if (file == path || strings::startsWith(file, path + "/")) {
+      gone.push_back(file);
+    }
+  }
+
+  foreach (const string& file, gone) {
+    total -= files[file].size;
+    files.erase(file);
+  }
+
+  gone.clear();
+
+  foreachkey (const string& child, directories) {
+    if (child == path || strings::startsWith(child, path + "/")) {
+      gone.push_back(child);
+    }
+  }
+
+  foreach (const string& child, gone) {
+    directories.erase(child);
+  }
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,92 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SLAVE_DISK_USAGE_HPP__
+#define __SLAVE_DISK_USAGE_HPP__
+
+#include <stdint.h>
+#include <time.h>
+
+#include <string>
+
+#include <stout/bytes.hpp>
+#include <stout/hashmap.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Maintains an incremental accounting of the disk space used by a
+// directory tree (e.g., an executor's sandbox), so that usage can be
+// reported periodically without stat(2)ing every file each time.
+//
+// The first update() seeds the accounting with a full walk of the
+// tree. Subsequent updates only re-examine directories whose mtime
+// changed (catching created and removed entries) and files that were
+// recently modified (catching growth of active files such as logs),
+// and fall back to a full walk every so often to pick up in-place
+// modifications of long-idle files, which neither of the cheap checks
+// can observe.
+class DiskUsageTracker
+{
+public:
+  explicit DiskUsageTracker(const std::string& directory);
+
+  // Seeds (on the first call) or refreshes the accounting.
+  void update();
+
+  // Disk space used by the tree, as of the last update(). Like du(1)
+  // this counts allocated blocks, not file lengths.
+  Bytes usage() const { return Bytes(total); }
+
+private:
+  // No copying, no assigning.
+  DiskUsageTracker(const DiskUsageTracker&);
+  DiskUsageTracker& operator = (const DiskUsageTracker&);
+
+  // State recorded for each regular file in the tree.
+  struct Entry
+  {
+    uint64_t size; // Allocated bytes (st_blocks * 512).
+    time_t mtime;
+  };
+
+  // Walks the whole tree, rebuilding the accounting.
+  void walk();
+
+  // Re-examines the immediate entries of one directory, recursing
+  // into any new subdirectories.
+  void scan(const std::string& path);
+
+  // Drops all recorded state under a removed directory.
+  void forget(const std::string& path);
+
+  const std::string directory;
+
+  hashmap<std::string, Entry> files;
+  hashmap<std::string, time_t> directories; // mtime per directory.
+
+  uint64_t total; // Sum of the sizes of the recorded files.
+  size_t updates; // Number of update() calls so far.
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __SLAVE_DISK_USAGE_HPP__
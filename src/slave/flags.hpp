@@ -21,6 +21,7 @@
 
 #include <string>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/option.hpp>
 
@@ -58,6 +59,31 @@ public:
         "Location of Mesos binaries",
         MESOS_LIBEXECDIR);
 
+    add(&Flags::launcher_pool_size,
+        "launcher_pool_size",
+        "Number of helper processes pre-forked at startup to launch\n"
+        "executors on behalf of the slave, avoiding fork(2) of the\n"
+        "(large) slave process on every launch. Executors are then\n"
+        "children of the helpers rather than of the slave.\n"
+        "(0 means launch executors by forking the slave directly)",
+        0);
+
+    add(&Flags::launch_provision_concurrency,
+        "launch_provision_concurrency",
+        "Maximum number of executor sandboxes provisioned\n"
+        "concurrently; excess launches queue in FIFO order.\n"
+        "Bounding the batch keeps a burst of launches from\n"
+        "thrashing the disk. (0 means unlimited)",
+        0);
+
+    add(&Flags::launch_concurrency,
+        "launch_concurrency",
+        "Maximum number of executors concurrently between fork\n"
+        "and registration (a window that covers the launcher's\n"
+        "URI fetching); excess launches queue in FIFO order.\n"
+        "(0 means unlimited)",
+        0);
+
     add(&Flags::webui_dir,
         "webui_dir",
         "Location of the webui files/assets",
@@ -71,6 +97,28 @@ public:
         "environment or find hadoop on PATH)",
         "");
 
+    add(&Flags::fetch_cache_size,
+        "fetch_cache_size",
+        "Size of the cache used to avoid re-fetching executor\n"
+        "URIs for every launch (e.g., 256MB, 2GB, etc). Cached\n"
+        "copies are hard-linked (or copied, with --switch_user)\n"
+        "into sandboxes and the least recently used entries are\n"
+        "evicted once the cache exceeds this size. Entries are\n"
+        "reused based on the URI alone, so URIs whose contents\n"
+        "change should not be cached.\n"
+        "(0 disables caching, every launch fetches its URIs)",
+        Bytes(0));
+
+    add(&Flags::fetch_rate_limit,
+        "fetch_rate_limit",
+        "Aggregate download rate (per launching executor) for\n"
+        "fetching executor URIs, in bytes per second (e.g., 10MB).\n"
+        "The limit is split evenly across an executor's concurrent\n"
+        "fetches so that large downloads do not starve the tasks\n"
+        "already running on the slave of network bandwidth.\n"
+        "(0 means unlimited)",
+        Bytes(0));
+
     add(&Flags::switch_user,
         "switch_user",
         "Whether to run tasks as the user who\n"
@@ -104,6 +152,27 @@ public:
         "the available disk usage.",
         GC_DELAY);
 
+    add(&Flags::gc_unlink_rate,
+        "gc_unlink_rate",
+        "Maximum number of files unlinked per second while\n"
+        "garbage collecting executor directories, to bound the\n"
+        "disk IOPS spent on deletion (0 means unthrottled)",
+        0.0);
+
+    add(&Flags::gc_disk_high_watermark,
+        "gc_disk_high_watermark",
+        "Disk usage fraction above which scheduled executor\n"
+        "directories get evicted immediately, without waiting\n"
+        "for their gc_delay (biggest and oldest first), until\n"
+        "usage would drop below gc_disk_low_watermark",
+        0.90);
+
+    add(&Flags::gc_disk_low_watermark,
+        "gc_disk_low_watermark",
+        "Disk usage fraction that watermark triggered eviction\n"
+        "reclaims down towards (see gc_disk_high_watermark)",
+        0.80);
+
     add(&Flags::disk_watch_interval,
         "disk_watch_interval",
         "Periodic time interval (e.g., 10secs, 2mins, etc)\n"
@@ -116,6 +185,15 @@ public:
         "resource usage (e.g., 10secs, 1min, etc)",
         RESOURCE_MONITORING_INTERVAL);
 
+    add(&Flags::monitoring_budget,
+        "monitoring_budget",
+        "Maximum number of executors to sample per resource\n"
+        "monitoring interval (0 means no limit). Stable executors\n"
+        "back off to a sparser sampling cadence, so with a budget\n"
+        "the per-interval monitoring cost stays flat as the number\n"
+        "of executors on the slave grows",
+        0);
+
     add(&Flags::checkpoint,
         "checkpoint",
         "Whether to checkpoint slave and frameworks information\n"
@@ -165,6 +243,14 @@ public:
         "Cgroups feature flag to enable hard limits on CPU resources\n"
         "via the CFS bandwidth limiting subfeature.\n",
         false);
+
+    add(&Flags::cgroups_pool_size,
+        "cgroups_pool_size",
+        "Number of cgroups pre-created in the background and renamed\n"
+        "into place at executor launch, taking cgroup creation off the\n"
+        "launch critical path during scheduling bursts.\n"
+        "(0 means create each executor's cgroup at launch)",
+        0);
 #endif
   }
 
@@ -172,15 +258,24 @@ public:
   Option<std::string> attributes;
   std::string work_dir;
   std::string launcher_dir;
+  int launcher_pool_size;
+  int launch_provision_concurrency;
+  int launch_concurrency;
   std::string webui_dir;
   std::string hadoop_home; // TODO(benh): Make an Option.
+  Bytes fetch_cache_size;
+  Bytes fetch_rate_limit;
   bool switch_user;
   std::string frameworks_home;  // TODO(benh): Make an Option.
   Duration executor_registration_timeout;
   Duration executor_shutdown_grace_period;
   Duration gc_delay;
+  double gc_unlink_rate;
+  double gc_disk_high_watermark;
+  double gc_disk_low_watermark;
   Duration disk_watch_interval;
   Duration resource_monitoring_interval;
+  int monitoring_budget;
   bool checkpoint;
   std::string recover;
   bool safe;
@@ -189,6 +284,7 @@ public:
   std::string cgroups_root;
   std::string cgroups_subsystems;
   bool cgroups_enable_cfs;
+  int cgroups_pool_size;
 #endif
 };
 
@@ -16,13 +16,26 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <fts.h>
+#include <stdio.h> // For rename.
+#include <string.h> // For strerror.
+#include <unistd.h>
+
+#include <algorithm>
 #include <list>
+#include <vector>
 
+#include <process/async.hpp>
+#include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/dispatch.hpp>
 
 #include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 #include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
 
 #include "logging/logging.hpp"
 
@@ -35,11 +48,156 @@ using process::wait; // Necessary on some OS's to disambiguate.
 using std::list;
 using std::map;
 using std::string;
+using std::vector;
 
 namespace mesos {
 namespace internal {
 namespace slave {
 
+namespace {
+
+// Atomically renames 'path' into a hidden '.gc' staging directory
+// next to it (i.e., on the same file system), so that it disappears
+// from its original location immediately. Returns the staged path.
+Try<string> stage(const string& path)
+{
+  // A counter keeps repeated deletions of equally named directories
+  // (e.g., executor runs) apart. Only touched from the GC process.
+  static int counter = 0;
+
+  Try<string> dirname = os::dirname(path);
+  if (dirname.isError()) {
+    return Error(dirname.error());
+  }
+
+  Try<string> basename = os::basename(path);
+  if (basename.isError()) {
+    return Error(basename.error());
+  }
+
+  const string& staging = path::join(dirname.get(), ".gc");
+
+  Try<Nothing> mkdir = os::mkdir(staging);
+  if (mkdir.isError()) {
+    return Error("Failed to create '" + staging + "': " + mkdir.error());
+  }
+
+  const string& staged =
+    path::join(staging, basename.get() + "." + stringify(counter++));
+
+  if (::rename(path.c_str(), staged.c_str()) == -1) {
+    return ErrnoError(
+        "Failed to rename '" + path + "' to '" + staged + "'");
+  }
+
+  return staged;
+}
+
+
+// Recursively unlinks a staged directory (or file), sleeping
+// periodically so the unlink rate stays under 'rate' files per
+// second (0 means unthrottled). Runs on the async pool, off the GC
+// process, so a sandbox with millions of files never stalls the
+// slave; errors are logged here since nobody waits on the result.
+Try<Nothing> purge(const string& path, double rate)
+{
+  LOG(INFO) << "Deleting staged path '" << path << "'";
+
+  // Unlink in batches, pausing between batches to bound the rate.
+  static const size_t BATCH = 100;
+
+  char* paths[] = { const_cast<char*>(path.c_str()), NULL };
+
+  FTS* tree = fts_open(paths, FTS_NOCHDIR, NULL);
+  if (tree == NULL) {
+    LOG(WARNING) << "Failed to delete staged path '" << path
+                 << "': " << strerror(errno);
+    return ErrnoError();
+  }
+
+  size_t unlinked = 0;
+
+  FTSENT* node;
+  while ((node = fts_read(tree)) != NULL) {
+    switch (node->fts_info) {
+      case FTS_DP:
+        if (::rmdir(node->fts_path) < 0 && errno != ENOENT) {
+          LOG(WARNING) << "Failed to delete directory '" << node->fts_path
+                       << "': " << strerror(errno);
+        }
+        break;
+      case FTS_F:
+      case FTS_SL:
+        if (::unlink(node->fts_path) < 0 && errno != ENOENT) {
+          LOG(WARNING) << "Failed to delete file '" << node->fts_path
+                       << "': " << strerror(errno);
+        }
+        break;
+      default:
+        break;
+    }
+
+    if (rate > 0.0 && ++unlinked % BATCH == 0) {
+      os::sleep(Seconds(BATCH / rate));
+    }
+  }
+
+  fts_close(tree);
+
+  LOG(INFO) << "Deleted staged path '" << path << "'";
+
+  return Nothing();
+}
+
+// Returns the size in bytes of each path, measured with an fts walk.
+// Runs on the async pool: sandboxes can hold millions of files and
+// the walk must never stall the GC process.
+vector<uint64_t> measure(const vector<string>& targets)
+{
+  vector<uint64_t> sizes;
+
+  foreach (const string& target, targets) {
+    uint64_t total = 0;
+
+    char* paths[] = { const_cast<char*>(target.c_str()), NULL };
+
+    FTS* tree = fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL, NULL);
+    if (tree != NULL) {
+      FTSENT* node;
+      while ((node = fts_read(tree)) != NULL) {
+        if (node->fts_info == FTS_F) {
+          total += node->fts_statp->st_size;
+        }
+      }
+      fts_close(tree);
+    }
+
+    sizes.push_back(total);
+  }
+
+  return sizes;
+}
+
+
+// An eviction candidate (see GarbageCollectorProcess::_evict).
+struct Candidate
+{
+  Candidate(double _score, const string& _path, uint64_t _size)
+    : score(_score), path(_path), size(_size) {}
+
+  double score;
+  string path;
+  uint64_t size;
+};
+
+
+bool prioritized(const Candidate& left, const Candidate& right)
+{
+  return left.score > right.score;
+}
+
+} // namespace {
+
 
 GarbageCollectorProcess::~GarbageCollectorProcess()
 {
@@ -109,6 +267,104 @@ bool GarbageCollectorProcess::unschedule(const string& path)
 }
 
 
+Future<uint64_t> GarbageCollectorProcess::evict(uint64_t bytes)
+{
+  // Gather every scheduled path. Everything scheduled here belongs
+  // to a terminal executor (paths only get scheduled once their
+  // executor has terminated), so all of them are safe to remove
+  // ahead of their timer.
+  vector<string> candidates;
+
+  foreachvalue (const PathInfo& info, paths) {
+    candidates.push_back(info.path);
+  }
+
+  if (candidates.empty()) {
+    return (uint64_t) 0;
+  }
+
+  LOG(INFO) << "Evicting up to " << bytes << " bytes across "
+            << candidates.size() << " scheduled paths";
+
+  // Measure the candidates on the async pool and evict once the
+  // sizes are in.
+  return async(&measure, candidates)
+    .then(defer(self(), &Self::_evict, bytes, candidates, lambda::_1));
+}
+
+
+Future<uint64_t> GarbageCollectorProcess::_evict(
+    uint64_t bytes,
+    const vector<string>& candidates,
+    const vector<uint64_t>& sizes)
+{
+  // Order the candidates by eviction priority: size weighted by how
+  // close the path is to its scheduled removal anyway, so big and
+  // old directories go first.
+  vector<Candidate> ordered;
+
+  for (size_t i = 0; i < candidates.size(); i++) {
+    // The path may have been unscheduled (or removed by its timer)
+    // while we were measuring.
+    if (!timeouts.contains(candidates[i])) {
+      continue;
+    }
+
+    double remaining =
+      std::max(timeouts[candidates[i]].remaining().secs(), 1.0);
+
+    ordered.push_back(
+        Candidate((double) sizes[i] / remaining, candidates[i], sizes[i]));
+  }
+
+  std::sort(ordered.begin(), ordered.end(), prioritized);
+
+  uint64_t reclaimed = 0;
+
+  for (size_t i = 0; i < ordered.size() && reclaimed < bytes; i++) {
+    const string& path = ordered[i].path;
+
+    LOG(INFO) << "Evicting '" << path << "' (" << ordered[i].size
+              << " bytes, removal was scheduled in "
+              << timeouts[path].remaining() << ")";
+
+    Timeout timeout = timeouts[path]; // Make a copy, as we erase() below.
+
+    foreach (const PathInfo& info, paths.get(timeout)) {
+      if (info.path == path) {
+        // Same staging plus async purge path as a timer driven
+        // removal (see remove()).
+        Try<string> staged = stage(path);
+
+        if (staged.isError()) {
+          LOG(WARNING) << "Failed to evict '" << path << "': "
+                       << staged.error();
+          info.promise->fail(staged.error());
+        } else {
+          info.promise->set(Nothing());
+
+          // Fire and forget; 'purge' logs its own errors.
+          async(&purge, staged.get(), unlinkRate);
+
+          reclaimed += ordered[i].size;
+        }
+
+        CHECK(paths.remove(timeout, info));
+        break;
+      }
+    }
+
+    timeouts.erase(path);
+  }
+
+  LOG(INFO) << "Evicted " << reclaimed << " bytes";
+
+  reset(); // The next timer driven removal may have been evicted.
+
+  return reclaimed;
+}
+
+
 // Fires a message to self for the next event. This also cancels any
 // existing timer.
 void GarbageCollectorProcess::reset()
@@ -126,22 +382,27 @@ void GarbageCollectorProcess::reset()
 
 void GarbageCollectorProcess::remove(const Timeout& removalTime)
 {
-  // TODO(bmahler): Other dispatches can block waiting for a removal
-  // operation. To fix this, the removal operation can be done
-  // asynchronously in another thread.
   if (paths.count(removalTime) > 0) {
     foreach (const PathInfo& info, paths.get(removalTime)) {
       LOG(INFO) << "Deleting " << info.path;
 
-      Try<Nothing> rmdir = os::rmdir(info.path);
+      // Rename the path into the staging area and complete the
+      // future immediately: the path is gone from its original
+      // location, and the expensive recursive unlink happens on the
+      // async pool so it never blocks this process (other dispatches
+      // used to stall for tens of seconds behind large sandboxes).
+      Try<string> staged = stage(info.path);
 
-      if (rmdir.isError()) {
+      if (staged.isError()) {
         LOG(WARNING) << "Failed to delete '" << info.path << "': "
-                     << rmdir.error();
-        info.promise->fail(rmdir.error());
+                     << staged.error();
+        info.promise->fail(staged.error());
       } else {
-        LOG(INFO) << "Deleted '" << info.path << "'";
-        info.promise->set(rmdir.get());
+        LOG(INFO) << "Staged '" << info.path << "' for deletion";
+        info.promise->set(Nothing());
+
+        // Fire and forget; 'purge' logs its own errors.
+        async(&purge, staged.get(), unlinkRate);
       }
 
       timeouts.erase(info.path);
@@ -172,9 +433,9 @@ void GarbageCollectorProcess::prune(const Duration& d)
 }
 
 
-GarbageCollector::GarbageCollector()
+GarbageCollector::GarbageCollector(double unlinkRate)
 {
-  process = new GarbageCollectorProcess();
+  process = new GarbageCollectorProcess(unlinkRate);
   spawn(process);
 }
 
@@ -201,6 +462,12 @@ Future<bool> GarbageCollector::unschedule(const string& path)
 }
 
 
+Future<uint64_t> GarbageCollector::evict(uint64_t bytes)
+{
+  return dispatch(process, &GarbageCollectorProcess::evict, bytes);
+}
+
+
 void GarbageCollector::prune(const Duration& d)
 {
   dispatch(process, &GarbageCollectorProcess::prune, d);
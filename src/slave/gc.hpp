@@ -19,6 +19,8 @@
 #ifndef __SLAVE_GC_HPP__
 #define __SLAVE_GC_HPP__
 
+#include <stdint.h>
+
 #include <string>
 #include <vector>
 
@@ -51,14 +53,19 @@ class GarbageCollectorProcess;
 class GarbageCollector
 {
 public:
-  GarbageCollector();
+  // The unlink rate bounds the number of files deleted per second
+  // while recursively removing a directory (0 means unthrottled).
+  GarbageCollector(double unlinkRate = 0.0);
   ~GarbageCollector();
 
   // Schedules the specified path for removal after the specified
   // duration of time has elapsed. If the path is already scheduled,
   // this will reschedule the removal operation, and induce a discard
   // on the previous future.
-  // The future will become ready when the path has been removed.
+  // The future will become ready when the path has been removed
+  // from its original location; it is atomically renamed into a
+  // hidden '.gc' staging directory and the recursive unlink happens
+  // in the background, so the caller never waits on it.
   // The future will fail if the path did not exist, or on error.
   // The future will be discarded if the path was unscheduled, or
   // was rescheduled.
@@ -70,6 +77,14 @@ public:
   // removal, or the path has already being removed.
   process::Future<bool> unschedule(const std::string& path);
 
+  // Immediately evicts scheduled paths, without waiting for their
+  // removal time, until approximately the given number of bytes have
+  // been reclaimed. Paths are evicted in priority order: size
+  // weighted by how close each path is to its scheduled removal
+  // anyway, so big and old directories go first. Returns the number
+  // of bytes actually reclaimed.
+  process::Future<uint64_t> evict(uint64_t bytes);
+
   // Deletes all the directories, whose scheduled garbage collection time
   // is within the next 'd' duration of time.
   void prune(const Duration& d);
@@ -83,6 +98,9 @@ class GarbageCollectorProcess :
     public process::Process<GarbageCollectorProcess>
 {
 public:
+  explicit GarbageCollectorProcess(double _unlinkRate)
+    : unlinkRate(_unlinkRate) {}
+
   virtual ~GarbageCollectorProcess();
 
   process::Future<Nothing> schedule(
@@ -91,9 +109,16 @@ public:
 
   bool unschedule(const std::string& path);
 
+  process::Future<uint64_t> evict(uint64_t bytes);
+
   void prune(const Duration& d);
 
 private:
+  process::Future<uint64_t> _evict(
+      uint64_t bytes,
+      const std::vector<std::string>& candidates,
+      const std::vector<uint64_t>& sizes);
+
   void reset();
 
   void remove(const process::Timeout& removalTime);
@@ -123,6 +148,8 @@ private:
   hashmap<std::string, process::Timeout> timeouts;
 
   process::Timer timer;
+
+  const double unlinkRate; // Files unlinked per second (0: unthrottled).
 };
 
 } // namespace mesos {
@@ -21,8 +21,12 @@
 #include <string>
 #include <vector>
 
+#include <process/dispatch.hpp>
+
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/json.hpp>
+#include <stout/option.hpp>
 #include <stout/net.hpp>
 #include <stout/numify.hpp>
 #include <stout/stringify.hpp>
@@ -42,6 +46,7 @@ namespace slave {
 
 using process::Future;
 
+using process::http::NotModified;
 using process::http::OK;
 using process::http::Response;
 using process::http::Request;
@@ -51,25 +56,87 @@ using std::string;
 using std::vector;
 
 
+namespace {
+
+// Wraps already-serialized JSON as an HTTP response, with JSONP
+// decoration when requested. The response carries an entity tag so
+// that conditional polls of an unchanged body collapse to "304 Not
+// Modified" (see http::etag).
+Response respond(const string& json, const Request& request)
+{
+  const Option<string> jsonp = request.query.get("jsonp");
+
+  std::ostringstream out;
+
+  if (jsonp.isSome()) {
+    out << jsonp.get() << "(" << json << ");";
+  } else {
+    out << json;
+  }
+
+  const string etag = process::http::etag(out.str());
+
+  // Answer a conditional request directly, instead of the body.
+  if (request.headers.get("If-None-Match") == Option<string>(etag)) {
+    return NotModified(etag);
+  }
+
+  OK response(out.str());
+  response.headers["Content-Type"] =
+    jsonp.isSome() ? "text/javascript" : "application/json";
+  response.headers["ETag"] = etag;
+  return response;
+}
+
+} // namespace {
+
+
+void StateServerProcess::update(const string& stats, const string& state)
+{
+  statsSnapshot = stats;
+  stateSnapshot = state;
+}
+
+
+Future<Response> StateServerProcess::stats(const Request& request)
+{
+  VLOG(1) << "HTTP request for '" << request.path << "'";
+
+  return respond(statsSnapshot, request);
+}
+
+
+Future<Response> StateServerProcess::state(const Request& request)
+{
+  VLOG(1) << "HTTP request for '" << request.path << "'";
+
+  return respond(stateSnapshot, request);
+}
+
+
 // TODO(bmahler): Kill these in favor of automatic Proto->JSON Conversion (when
 // in becomes available).
 
 
-// Returns a JSON object modeled on a Resources.
-JSON::Object model(const Resources& resources)
+// The model() functions write straight into a JSON::Writer rather
+// than building a tree of JSON values per request, mirroring the
+// master's handlers.
+
+// Writes a JSON object modeled on a Resources.
+void model(JSON::Writer& writer, const Resources& resources)
 {
-  JSON::Object object;
+  writer.beginObject();
 
   foreach (const Resource& resource, resources) {
     switch (resource.type()) {
       case Value::SCALAR:
-        object.values[resource.name()] = resource.scalar().value();
+        writer.field(resource.name(), resource.scalar().value());
         break;
       case Value::RANGES:
-        object.values[resource.name()] = stringify(resource.ranges());
+        writer.field(resource.name(), stringify(resource.ranges()));
         break;
       case Value::SET:
-        object.values[resource.name()] = stringify(resource.set());
+        writer.field(resource.name(), stringify(resource.set()));
         break;
       default:
         LOG(FATAL) << "Unexpected Value type: " << resource.type();
@@ -77,27 +144,27 @@ JSON::Object model(const Resources& resources)
     }
   }
 
-  return object;
+  writer.endObject();
 }
 
 
-JSON::Object model(const Attributes& attributes)
+void model(JSON::Writer& writer, const Attributes& attributes)
 {
-  JSON::Object object;
+  writer.beginObject();
 
   foreach (const Attribute& attribute, attributes) {
     switch (attribute.type()) {
       case Value::SCALAR:
-        object.values[attribute.name()] = attribute.scalar().value();
+        writer.field(attribute.name(), attribute.scalar().value());
         break;
       case Value::RANGES:
-        object.values[attribute.name()] = stringify(attribute.ranges());
+        writer.field(attribute.name(), stringify(attribute.ranges()));
         break;
       case Value::SET:
-        object.values[attribute.name()] = stringify(attribute.set());
+        writer.field(attribute.name(), stringify(attribute.set()));
         break;
       case Value::TEXT:
-        object.values[attribute.name()] = attribute.text().value();
+        writer.field(attribute.name(), attribute.text().value());
         break;
       default:
         LOG(FATAL) << "Unexpected Value type: " << attribute.type();
@@ -105,143 +172,157 @@ JSON::Object model(const Attributes& attributes)
     }
   }
 
-  return object;
+  writer.endObject();
 }
 
 
-JSON::Object model(const CommandInfo& command)
+void model(JSON::Writer& writer, const CommandInfo& command)
 {
-  JSON::Object object;
-  object.values["value"] = command.value();
+  writer.beginObject();
+  writer.field("value", command.value());
 
   if (command.has_environment()) {
-    JSON::Object environment;
-    JSON::Array variables;
+    writer.key("environment");
+    writer.beginObject();
+    writer.key("variables");
+    writer.beginArray();
     foreach(const Environment_Variable& variable,
         command.environment().variables()) {
-      JSON::Object variableObject;
-      variableObject.values["name"] = variable.name();
-      variableObject.values["value"] = variable.value();
-      variables.values.push_back(variableObject);
+      writer.beginObject();
+      writer.field("name", variable.name());
+      writer.field("value", variable.value());
+      writer.endObject();
     }
-    environment.values["variables"] = variables;
-    object.values["environment"] = environment;
+    writer.endArray();
+    writer.endObject();
   }
 
-  JSON::Array uris;
+  writer.key("uris");
+  writer.beginArray();
   foreach(const CommandInfo_URI& uri, command.uris()) {
-    JSON::Object uriObject;
-    uriObject.values["value"] = uri.value();
-    uriObject.values["executable"] = uri.executable();
-
-    uris.values.push_back(uriObject);
+    writer.beginObject();
+    writer.field("value", uri.value());
+    writer.field("executable", uri.executable());
+    writer.endObject();
   }
-  object.values["uris"] = uris;
+  writer.endArray();
 
-  return object;
+  writer.endObject();
 }
 
 
-JSON::Object model(const ExecutorInfo& executorInfo)
+void model(JSON::Writer& writer, const ExecutorInfo& executorInfo)
 {
-  JSON::Object object;
-  object.values["executor_id"] = executorInfo.executor_id().value();
-  object.values["name"] = executorInfo.name();
-  object.values["data"] = executorInfo.data();
-  object.values["framework_id"] = executorInfo.framework_id().value();
-  object.values["command"] = model(executorInfo.command());
-  object.values["resources"] = model(executorInfo.resources());
-  return object;
+  writer.beginObject();
+  writer.field("executor_id", executorInfo.executor_id().value());
+  writer.field("name", executorInfo.name());
+  writer.field("data", executorInfo.data());
+  writer.field("framework_id", executorInfo.framework_id().value());
+  writer.key("command");
+  model(writer, executorInfo.command());
+  writer.key("resources");
+  model(writer, executorInfo.resources());
+  writer.endObject();
 }
 
 
-JSON::Object model(const Task& task)
+void model(JSON::Writer& writer, const Task& task)
 {
-  JSON::Object object;
-  object.values["id"] = task.task_id().value();
-  object.values["name"] = task.name();
-  object.values["executor_id"] = task.executor_id().value();
-  object.values["framework_id"] = task.framework_id().value();
-  object.values["slave_id"] = task.slave_id().value();
-  object.values["state"] = TaskState_Name(task.state());
-  object.values["resources"] = model(task.resources());
-  return object;
+  writer.beginObject();
+  writer.field("id", task.task_id().value());
+  writer.field("name", task.name());
+  writer.field("executor_id", task.executor_id().value());
+  writer.field("framework_id", task.framework_id().value());
+  writer.field("slave_id", task.slave_id().value());
+  writer.field("state", TaskState_Name(task.state()));
+  writer.key("resources");
+  model(writer, task.resources());
+  writer.endObject();
 }
 
 
-JSON::Object model(const TaskInfo& task)
+void model(JSON::Writer& writer, const TaskInfo& task)
 {
-  JSON::Object object;
-  object.values["id"] = task.task_id().value();
-  object.values["name"] = task.name();
-  object.values["slave_id"] = task.slave_id().value();
-  object.values["resources"] = model(task.resources());
-  object.values["data"] = task.data();
+  writer.beginObject();
+  writer.field("id", task.task_id().value());
+  writer.field("name", task.name());
+  writer.field("slave_id", task.slave_id().value());
+  writer.key("resources");
+  model(writer, task.resources());
+  writer.field("data", task.data());
 
   if (task.has_command()) {
-    object.values["command"] = model(task.command());
+    writer.key("command");
+    model(writer, task.command());
   }
   if (task.has_executor()) {
-    object.values["executor_id"] = model(task.executor());
+    writer.key("executor_id");
+    model(writer, task.executor());
   }
 
-  return object;
+  writer.endObject();
 }
 
 
-JSON::Object model(const Executor& executor)
+void model(JSON::Writer& writer, const Executor& executor)
 {
-  JSON::Object object;
-  object.values["id"] = executor.id.value();
-  object.values["name"] = executor.info.name();
-  object.values["source"] = executor.info.source();
-  object.values["uuid"] = executor.uuid.toString();
-  object.values["directory"] = executor.directory;
-  object.values["resources"] = model(executor.resources);
-
-  JSON::Array tasks;
+  writer.beginObject();
+  writer.field("id", executor.id.value());
+  writer.field("name", executor.info.name());
+  writer.field("source", executor.info.source());
+  writer.field("uuid", executor.uuid.toString());
+  writer.field("directory", executor.directory);
+  writer.key("resources");
+  model(writer, executor.resources);
+
+  writer.key("tasks");
+  writer.beginArray();
   foreachvalue (Task* task, executor.launchedTasks) {
-    tasks.values.push_back(model(*task));
+    model(writer, *task);
   }
-  object.values["tasks"] = tasks;
+  writer.endArray();
 
-  JSON::Array queued;
+  writer.key("queued_tasks");
+  writer.beginArray();
   foreachvalue (const TaskInfo& task, executor.queuedTasks) {
-    queued.values.push_back(model(task));
+    model(writer, task);
   }
-  object.values["queued_tasks"] = queued;
+  writer.endArray();
 
-  JSON::Array completedTasks;
+  writer.key("completed_tasks");
+  writer.beginArray();
   foreach (const Task& task, executor.completedTasks) {
-    completedTasks.values.push_back(model(task));
+    model(writer, task);
   }
-  object.values["completed_tasks"] = completedTasks;
+  writer.endArray();
 
-  return object;
+  writer.endObject();
 }
 
 
-// Returns a JSON object modeled after a Framework.
-JSON::Object model(const Framework& framework)
+// Writes a JSON object modeled after a Framework.
+void model(JSON::Writer& writer, const Framework& framework)
 {
-  JSON::Object object;
-  object.values["id"] = framework.id.value();
-  object.values["name"] = framework.info.name();
-  object.values["user"] = framework.info.user();
+  writer.beginObject();
+  writer.field("id", framework.id.value());
+  writer.field("name", framework.info.name());
+  writer.field("user", framework.info.user());
 
-  JSON::Array executors;
+  writer.key("executors");
+  writer.beginArray();
   foreachvalue (Executor* executor, framework.executors) {
-    executors.values.push_back(model(*executor));
+    model(writer, *executor);
   }
-  object.values["executors"] = executors;
+  writer.endArray();
 
-  JSON::Array completedExecutors;
+  writer.key("completed_executors");
+  writer.beginArray();
   foreach (const Owned<Executor>& executor, framework.completedExecutors) {
-    completedExecutors.values.push_back(model(*executor));
+    model(writer, *executor);
   }
-  object.values["completed_executors"] = completedExecutors;
+  writer.endArray();
 
-  return object;
+  writer.endObject();
 }
 
 
@@ -276,21 +357,11 @@ Future<Response> stats(
     const Slave& slave,
     const Request& request)
 {
-  LOG(INFO) << "HTTP request for '" << request.path << "'";
-
-  JSON::Object object;
-  object.values["uptime"] = Clock::now() - slave.startTime;
-  object.values["total_frameworks"] = slave.frameworks.size();
-  object.values["staged_tasks"] = slave.stats.tasks[TASK_STAGING];
-  object.values["started_tasks"] = slave.stats.tasks[TASK_STARTING];
-  object.values["finished_tasks"] = slave.stats.tasks[TASK_FINISHED];
-  object.values["killed_tasks"] = slave.stats.tasks[TASK_KILLED];
-  object.values["failed_tasks"] = slave.stats.tasks[TASK_FAILED];
-  object.values["lost_tasks"] = slave.stats.tasks[TASK_LOST];
-  object.values["valid_status_updates"] = slave.stats.validStatusUpdates;
-  object.values["invalid_status_updates"] = slave.stats.invalidStatusUpdates;
-
-  return OK(object, request.query.get("jsonp"));
+  // Forward to the read-only state server: the request is then
+  // served from the latest snapshot without executing anything
+  // beyond this dispatch on the slave's queue.
+  return process::dispatch(
+      slave.stateServer, &StateServerProcess::stats, request);
 }
 
 
@@ -298,47 +369,120 @@ Future<Response> state(
     const Slave& slave,
     const Request& request)
 {
-  LOG(INFO) << "HTTP request for '" << request.path << "'";
+  // Forward to the read-only state server, as above.
+  return process::dispatch(
+      slave.stateServer, &StateServerProcess::state, request);
+}
 
-  JSON::Object object;
-  object.values["build_date"] = build::DATE;
-  object.values["build_time"] = build::TIME;
-  object.values["build_user"] = build::USER;
-  object.values["start_time"] = slave.startTime;
-  object.values["id"] = slave.info.id().value();
-  object.values["pid"] = string(slave.self());
-  object.values["hostname"] = slave.info.hostname();
-  object.values["resources"] = model(slave.resources);
-  object.values["attributes"] = model(slave.attributes);
-  object.values["staged_tasks"] = slave.stats.tasks[TASK_STAGING];
-  object.values["started_tasks"] = slave.stats.tasks[TASK_STARTING];
-  object.values["finished_tasks"] = slave.stats.tasks[TASK_FINISHED];
-  object.values["killed_tasks"] = slave.stats.tasks[TASK_KILLED];
-  object.values["failed_tasks"] = slave.stats.tasks[TASK_FAILED];
-  object.values["lost_tasks"] = slave.stats.tasks[TASK_LOST];
+
+string renderStats(const Slave& slave)
+{
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.field("uptime", Clock::now() - slave.startTime);
+  writer.field("total_frameworks", slave.frameworks.size());
+  writer.field("staged_tasks", slave.stats.tasks[TASK_STAGING]);
+  writer.field("started_tasks", slave.stats.tasks[TASK_STARTING]);
+  writer.field("finished_tasks", slave.stats.tasks[TASK_FINISHED]);
+  writer.field("killed_tasks", slave.stats.tasks[TASK_KILLED]);
+  writer.field("failed_tasks", slave.stats.tasks[TASK_FAILED]);
+  writer.field("lost_tasks", slave.stats.tasks[TASK_LOST]);
+  writer.field("valid_status_updates", slave.stats.validStatusUpdates);
+  writer.field("invalid_status_updates", slave.stats.invalidStatusUpdates);
+
+  // Append the operational metrics registry (see common/metrics.hpp).
+  map<string, double> metrics = slave.metrics.snapshot();
+  foreachpair (const string& name, double value, metrics) {
+    writer.field(name, value);
+  }
+
+  writer.endObject();
+
+  return writer.str();
+}
+
+
+string renderState(const Slave& slave)
+{
+  JSON::Writer writer;
+  writer.beginObject();
+  writer.field("build_date", build::DATE);
+  writer.field("build_time", build::TIME);
+  writer.field("build_user", build::USER);
+  writer.field("start_time", slave.startTime);
+  writer.field("id", slave.info.id().value());
+  writer.field("pid", string(slave.self()));
+  writer.field("hostname", slave.info.hostname());
+  writer.key("resources");
+  model(writer, slave.resources);
+  writer.key("attributes");
+  model(writer, slave.attributes);
+  writer.field("staged_tasks", slave.stats.tasks[TASK_STAGING]);
+  writer.field("started_tasks", slave.stats.tasks[TASK_STARTING]);
+  writer.field("finished_tasks", slave.stats.tasks[TASK_FINISHED]);
+  writer.field("killed_tasks", slave.stats.tasks[TASK_KILLED]);
+  writer.field("failed_tasks", slave.stats.tasks[TASK_FAILED]);
+  writer.field("lost_tasks", slave.stats.tasks[TASK_LOST]);
 
   Try<string> masterHostname = net::getHostname(slave.master.ip);
   if (masterHostname.isSome()) {
-    object.values["master_hostname"] = masterHostname.get();
+    writer.field("master_hostname", masterHostname.get());
   }
 
   if (slave.flags.log_dir.isSome()) {
-    object.values["log_dir"] = slave.flags.log_dir.get();
+    writer.field("log_dir", slave.flags.log_dir.get());
   }
 
-  JSON::Array frameworks;
-  foreachvalue (Framework* framework, slave.frameworks) {
-    frameworks.values.push_back(model(*framework));
+  // Model all of the frameworks, re-rendering only the fragments of
+  // frameworks that have seen a state transition since the last
+  // rendering and reusing the cached fragments for the rest (the
+  // same treatment as the master's state handler).
+  {
+    hashmap<FrameworkID, uint64_t> versions;
+    hashmap<FrameworkID, string> fragments;
+
+    writer.key("frameworks");
+    writer.beginArray();
+    foreachvalue (Framework* framework, slave.frameworks) {
+      Option<uint64_t> version =
+        slave.frameworkStateVersions.get(framework->id);
+      uint64_t current = version.isSome() ? version.get() : 0;
+
+      Option<uint64_t> rendered =
+        slave.renderedFrameworkVersions.get(framework->id);
+
+      string fragment;
+      if (rendered.isSome() && rendered.get() == current) {
+        fragment = slave.renderedFrameworks[framework->id];
+      } else {
+        JSON::Writer rendering;
+        model(rendering, *framework);
+        fragment = rendering.str();
+      }
+
+      writer.append(fragment);
+
+      versions[framework->id] = current;
+      fragments[framework->id] = fragment;
+    }
+    writer.endArray();
+
+    // Replace (rather than update) the fragment cache so that
+    // entries for removed frameworks get pruned.
+    slave.renderedFrameworkVersions = versions;
+    slave.renderedFrameworks = fragments;
   }
-  object.values["frameworks"] = frameworks;
 
-  JSON::Array completedFrameworks;
+  writer.key("completed_frameworks");
+  writer.beginArray();
   foreach (const Owned<Framework>& framework, slave.completedFrameworks) {
-    completedFrameworks.values.push_back(model(*framework));
+    model(writer, *framework);
   }
-  object.values["completed_frameworks"] = completedFrameworks;
+  writer.endArray();
+
+  writer.endObject();
 
-  return OK(object, request.query.get("jsonp"));
+  return writer.str();
 }
 
 } // namespace json {
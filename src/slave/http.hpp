@@ -19,8 +19,11 @@
 #ifndef __SLAVE_HTTP_HPP__
 #define __SLAVE_HTTP_HPP__
 
+#include <string>
+
 #include <process/future.hpp>
 #include <process/http.hpp>
+#include <process/process.hpp>
 
 
 namespace mesos {
@@ -30,6 +33,33 @@ namespace slave {
 // Forward declaration (necessary to break circular dependency).
 class Slave;
 
+
+// Serves 'stats.json' and 'state.json' polls from pre-rendered
+// snapshots pushed by the slave (see Slave::refreshState), so that
+// monitoring load never executes on the Slave process itself and
+// thus never contends with task management. The previous snapshots
+// keep being served until an update message is processed, so serving
+// is never blocked on rendering either.
+class StateServerProcess : public process::Process<StateServerProcess>
+{
+public:
+  // Installs the latest snapshots of the two endpoints.
+  void update(const std::string& stats, const std::string& state);
+
+  // Returns the latest 'stats.json' snapshot.
+  process::Future<process::http::Response> stats(
+      const process::http::Request& request);
+
+  // Returns the latest 'state.json' snapshot.
+  process::Future<process::http::Response> state(
+      const process::http::Request& request);
+
+private:
+  std::string statsSnapshot;
+  std::string stateSnapshot;
+};
+
+
 namespace http {
 
 // Returns current vars in "key value\n" format (keys do not contain
@@ -41,17 +71,31 @@ process::Future<process::http::Response> vars(
 
 namespace json {
 
-// Returns current statistics of the slave.
+// Returns current statistics of the slave (served from the latest
+// snapshot held by the slave's StateServerProcess).
 process::Future<process::http::Response> stats(
     const Slave& slave,
     const process::http::Request& request);
 
 
-// Returns current state of the cluster that the slave knows about.
+// Returns current state of the cluster that the slave knows about
+// (served from the latest snapshot held by the slave's
+// StateServerProcess).
 process::Future<process::http::Response> state(
     const Slave& slave,
     const process::http::Request& request);
 
+
+// Renders the 'stats.json' JSON, used by the slave to refresh the
+// snapshot served by its StateServerProcess.
+std::string renderStats(const Slave& slave);
+
+
+// Renders the 'state.json' JSON, reusing cached fragments for the
+// frameworks that have not seen a state transition since the last
+// rendering (see Slave::invalidateState).
+std::string renderState(const Slave& slave);
+
 } // namespace json {
 } // namespace http {
 } // namespace slave {
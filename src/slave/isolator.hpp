@@ -29,6 +29,7 @@
 #include <process/process.hpp>
 
 #include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
 #include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/uuid.hpp>
@@ -50,6 +51,13 @@ class SlaveState; // Forward declaration.
 class Slave;
 
 
+// Batch usage collection types (see Isolator::usages()): the set of
+// executors to collect for, and the resulting statistics for each
+// executor the isolator knows about.
+typedef hashmap<FrameworkID, hashset<ExecutorID> > ExecutorSet;
+typedef hashmap<FrameworkID, hashmap<ExecutorID, ResourceStatistics> > Usages;
+
+
 class Isolator : public process::Process<Isolator>
 {
 public:
@@ -95,6 +103,14 @@ public:
       const FrameworkID& frameworkId,
       const ExecutorID& executorId) = 0;
 
+  // Returns the resource usage of all the given executors in one
+  // call, so that a monitoring pass over hundreds of executors costs
+  // a single dispatch into the isolator (which can gather the usage
+  // in one pass over its accounting data) rather than one round trip
+  // per executor. Executors that are unknown to the isolator (or
+  // have been killed) are simply absent from the result.
+  virtual process::Future<Usages> usages(const ExecutorSet& executors) = 0;
+
   // Recover executors.
   virtual process::Future<Nothing> recover(
       const Option<state::SlaveState>& state) = 0;
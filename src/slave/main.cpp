@@ -16,6 +16,11 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <string.h>
+
+#include <sys/stat.h>
+
 #include <stout/os.hpp>
 #include <stout/stringify.hpp>
 #include <stout/try.hpp>
@@ -32,6 +37,7 @@
 #include "logging/flags.hpp"
 #include "logging/logging.hpp"
 
+#include "slave/paths.hpp"
 #include "slave/slave.hpp"
 
 using namespace mesos::internal;
@@ -117,6 +123,28 @@ int main(int argc, char** argv)
     os::setenv("LIBPROCESS_IP", ip.get());
   }
 
+  // Communicate with executors on this host over unix domain sockets
+  // under the work directory (see LIBPROCESS_SOCKET_DIR in
+  // libprocess), rather than TCP over loopback. Executors may run as
+  // other users, so the directory gets /tmp-like permissions
+  // (world-writable with the sticky bit).
+  const string socketDir = paths::getSocketDir(flags.work_dir);
+
+  Try<Nothing> mkdir = os::mkdir(socketDir);
+  if (mkdir.isError()) {
+    cerr << "Failed to create '" << socketDir << "': "
+         << mkdir.error() << endl;
+    exit(1);
+  }
+
+  if (::chmod(socketDir.c_str(), 01777) < 0) {
+    cerr << "Failed to chmod '" << socketDir << "': "
+         << strerror(errno) << endl;
+    exit(1);
+  }
+
+  os::setenv("LIBPROCESS_SOCKET_DIR", socketDir);
+
   process::initialize();
 
   logging::initialize(argv[0], flags);
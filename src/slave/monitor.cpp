@@ -16,8 +16,14 @@
  * limitations under the License.
  */
 
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <mesos/mesos.hpp>
 
@@ -31,7 +37,13 @@
 
 #include <stout/json.hpp>
 #include <stout/lambda.hpp>
+#include <stout/none.hpp>
+
+#include "common/resources.hpp"
 
+#include "logging/check_some.hpp"
+
+#include "slave/constants.hpp"
 #include "slave/isolator.hpp"
 #include "slave/monitor.hpp"
 
@@ -53,6 +65,7 @@ using process::wait; // Necessary on some OS's to disambiguate.
 const std::string CPU_TIME   = "cpu_time";
 const std::string CPU_USAGE  = "cpu_usage";
 const std::string MEMORY_RSS = "memory_rss";
+const std::string DISK_USED  = "disk_used_bytes";
 
 
 // Local function prototypes.
@@ -67,6 +80,89 @@ Future<http::Response> _usage(
     const Option<string>& jsonp);
 
 
+Sketch::Sketch()
+  : count(0), sum(0.0), min(0.0), max(0.0)
+{
+  memset(buckets, 0, sizeof(buckets));
+}
+
+
+void Sketch::add(double sample)
+{
+  if (sample < 0.0) {
+    sample = 0.0;
+  }
+
+  if (count == 0 || sample < min) {
+    min = sample;
+  }
+
+  if (sample > max) {
+    max = sample;
+  }
+
+  count++;
+  sum += sample;
+
+  buckets[bucket(sample)]++;
+}
+
+
+double Sketch::quantile(double q) const
+{
+  if (count == 0) {
+    return 0.0;
+  }
+
+  uint64_t rank = (uint64_t) ceil(q * count);
+
+  if (rank < 1) {
+    rank = 1;
+  } else if (rank > count) {
+    rank = count;
+  }
+
+  uint64_t seen = 0;
+  for (int i = 0; i < BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // Use the geometric middle of the bucket, clamped to the
+      // observed range.
+      int exponent = MINEXP + i / SUBBUCKETS;
+      double mantissa = 0.5 + (i % SUBBUCKETS + 0.5) / (2.0 * SUBBUCKETS);
+      return std::max(min, std::min(ldexp(mantissa, exponent), max));
+    }
+  }
+
+  return max;
+}
+
+
+int Sketch::bucket(double sample)
+{
+  if (sample <= 0.0) {
+    return 0;
+  }
+
+  int exponent;
+  double mantissa = frexp(sample, &exponent); // Mantissa in [0.5, 1).
+
+  if (exponent < MINEXP) {
+    return 0;
+  } else if (exponent >= MAXEXP) {
+    return BUCKETS - 1;
+  }
+
+  int sub = (int) ((mantissa - 0.5) * 2 * SUBBUCKETS);
+
+  if (sub >= SUBBUCKETS) {
+    sub = SUBBUCKETS - 1;
+  }
+
+  return (exponent - MINEXP) * SUBBUCKETS + sub;
+}
+
+
 Future<Nothing> ResourceMonitorProcess::watch(
     const FrameworkID& frameworkId,
     const ExecutorID& executorId,
@@ -89,8 +185,16 @@ Future<Nothing> ResourceMonitorProcess::watch(
       prefix + CPU_TIME,
       new meters::TimeRate(prefix + CPU_USAGE));
 
-  // Schedule the resource collection.
-  delay(interval, self(), &Self::collect, frameworkId, executorId, interval);
+  // (Re)start the batch collection loop: all watches share one
+  // collection pass per interval.
+  if (this->interval.isNone() || interval < this->interval.get()) {
+    this->interval = interval;
+  }
+
+  if (!collecting) {
+    collecting = true;
+    delay(this->interval.get(), self(), &Self::collect);
+  }
 
   return Nothing();
 }
@@ -107,6 +211,7 @@ Future<Nothing> ResourceMonitorProcess::unwatch(
   // we need to archive the statistics first.
   process::statistics->archive("monitor", prefix + MEMORY_RSS);
   process::statistics->archive("monitor", prefix + CPU_TIME);
+  process::statistics->archive("monitor", prefix + DISK_USED);
 
   if (!watches.contains(frameworkId) ||
       !watches[frameworkId].contains(executorId)) {
@@ -119,59 +224,213 @@ Future<Nothing> ResourceMonitorProcess::unwatch(
     watches.erase(frameworkId);
   }
 
+  if (cadences.contains(frameworkId)) {
+    cadences[frameworkId].erase(executorId);
+
+    if (cadences[frameworkId].empty()) {
+      cadences.erase(frameworkId);
+    }
+  }
+
   return Nothing();
 }
 
 
-void ResourceMonitorProcess::collect(
-    const FrameworkID& frameworkId,
-    const ExecutorID& executorId,
-    const Duration& interval)
+// An executor due for a sample, for ordering the candidates by how
+// overdue they are when the budget caps the batch.
+struct Due
 {
-  // Has the executor been unwatched?
-  if (!watches.contains(frameworkId) ||
-      !watches[frameworkId].contains(executorId)) {
+  Due(int _countdown,
+      const FrameworkID& _frameworkId,
+      const ExecutorID& _executorId)
+    : countdown(_countdown),
+      frameworkId(_frameworkId),
+      executorId(_executorId) {}
+
+  int countdown;
+  FrameworkID frameworkId;
+  ExecutorID executorId;
+};
+
+
+static bool overdue(const Due& left, const Due& right)
+{
+  return left.countdown < right.countdown;
+}
+
+
+void ResourceMonitorProcess::collect()
+{
+  if (watches.empty()) {
+    // Pause the loop until another executor is watched.
+    collecting = false;
+    interval = None();
     return;
   }
 
-  dispatch(isolator, &Isolator::usage, frameworkId, executorId)
-    .onAny(defer(self(),
-                 &Self::_collect,
-                 lambda::_1,
-                 frameworkId,
-                 executorId,
-                 interval));
+  // Select the executors due for a sample this pass under their
+  // adaptive cadence (see Cadence in monitor.hpp).
+  std::vector<Due> due;
+
+  foreachkey (const FrameworkID& frameworkId, watches) {
+    foreachkey (const ExecutorID& executorId,
+                watches.get(frameworkId).get()) {
+      // NOTE: operator [] default constructs an every-pass cadence
+      // for an executor that has not been sampled yet.
+      Cadence& cadence = cadences[frameworkId][executorId];
+
+      if (--cadence.countdown <= 0) {
+        due.push_back(Due(cadence.countdown, frameworkId, executorId));
+      }
+    }
+  }
+
+  // Enforce the overhead budget: the most overdue executors win and
+  // the rest grow more overdue, so nothing starves while the cost per
+  // pass stays flat however many executors the slave packs.
+  if (budget > 0 && due.size() > (size_t) budget) {
+    std::sort(due.begin(), due.end(), overdue);
+    due.resize(budget, due.front());
+  }
+
+  // Gather the usage of the due executors with a single dispatch
+  // into the isolator, rather than one dispatch round trip per
+  // executor per interval.
+  ExecutorSet executors;
+
+  for (size_t i = 0; i < due.size(); i++) {
+    cadences[due[i].frameworkId][due[i].executorId].countdown =
+      cadences[due[i].frameworkId][due[i].executorId].stride;
+
+    executors[due[i].frameworkId].insert(due[i].executorId);
+  }
+
+  if (executors.empty()) {
+    // Every watched executor has backed off past this pass.
+    delay(interval.get(), self(), &Self::collect);
+    return;
+  }
+
+  dispatch(isolator, &Isolator::usages, executors)
+    .onAny(defer(self(), &Self::_collect, lambda::_1));
 }
 
 
 void ResourceMonitorProcess::_collect(
-    const Future<ResourceStatistics>& statistics,
-    const FrameworkID& frameworkId,
-    const ExecutorID& executorId,
-    const Duration& interval)
+    const Future<Usages>& usages)
 {
-  // Has the executor been unwatched?
-  if (!watches.contains(frameworkId) ||
-      !watches[frameworkId].contains(executorId)) {
-    return;
-  }
+  if (usages.isReady()) {
+    // NOTE: Future::get() returns by value.
+    const Usages result = usages.get();
+
+    foreachkey (const FrameworkID& frameworkId, result) {
+      foreachkey (const ExecutorID& executorId,
+                  result.get(frameworkId).get()) {
+        // Has the executor been unwatched in the meantime?
+        if (!watches.contains(frameworkId) ||
+            !watches[frameworkId].contains(executorId)) {
+          continue;
+        }
+
+        // Publish the data to the statistics module.
+        VLOG(1) << "Publishing resource usage for executor '" << executorId
+                << "' of framework '" << frameworkId << "'";
+
+        const ResourceStatistics statistics =
+          result.get(frameworkId).get().get(executorId).get();
+
+        publish(frameworkId, executorId, statistics);
+
+        // Feed the sketches backing the summary endpoint.
+        sketches[MEMORY_RSS].add((double) statistics.memory_rss());
+
+        if (statistics.has_cpu_usage()) {
+          sketches[CPU_USAGE].add(statistics.cpu_usage());
+        }
+
+        if (statistics.has_disk_used_bytes()) {
+          sketches[DISK_USED].add((double) statistics.disk_used_bytes());
+        }
+
+        // Adapt the sampling cadence. A sample is stable when the
+        // cpu usage rate since the last sample is small and the rss
+        // hasn't moved appreciably; rss near the executor's memory
+        // limit always counts as unstable since that's where tight
+        // sampling matters most (we want to watch it hit the limit,
+        // not discover it afterwards).
+        Cadence& cadence = cadences[frameworkId][executorId];
+
+        double cpuTime =
+          statistics.cpu_user_time() + statistics.cpu_system_time();
+        double memoryRss = (double) statistics.memory_rss();
+
+        CHECK_SOME(interval);
+        double elapsed = cadence.stride * interval.get().secs();
+
+        bool active = elapsed > 0.0 &&
+          (cpuTime - cadence.cpuTime) > MONITORING_ACTIVE_CPU * elapsed;
+
+        bool moved = fabs(memoryRss - cadence.memoryRss) >
+          MONITORING_STABLE_FRACTION * std::max(cadence.memoryRss, 1.0);
+
+        // NOTE: The executor's 'mem' resource is in megabytes.
+        bool nearLimit = false;
+        Option<double> limit =
+          Resources(watches[frameworkId][executorId].resources()).mem();
+        if (limit.isSome() &&
+            memoryRss >
+            MONITORING_LIMIT_FRACTION * limit.get() * 1024.0 * 1024.0) {
+          nearLimit = true;
+        }
+
+        if (active || moved || nearLimit) {
+          cadence.stride = 1;
+          cadence.stable = 0;
+        } else if (++cadence.stable >= MONITORING_STABLE_SAMPLES &&
+                   cadence.stride < MONITORING_MAX_STRIDE) {
+          cadence.stride *= 2;
+          cadence.stable = 0;
+        }
+
+        cadence.cpuTime = cpuTime;
+        cadence.memoryRss = memoryRss;
+
+        if (statistics.has_disk_used_bytes()) {
+          cadence.diskUsed = (double) statistics.disk_used_bytes();
+        }
+      }
+    }
+
+    // Refresh the slave-wide totals from the last sample of every
+    // watched executor, whether or not it was due this pass.
+    double cpuTime = 0.0;
+    double memoryRss = 0.0;
+    double diskUsed = 0.0;
+
+    foreachkey (const FrameworkID& frameworkId, watches) {
+      foreachkey (const ExecutorID& executorId,
+                  watches.get(frameworkId).get()) {
+        const Cadence& cadence = cadences[frameworkId][executorId];
+        cpuTime += cadence.cpuTime;
+        memoryRss += cadence.memoryRss;
+        diskUsed += cadence.diskUsed;
+      }
+    }
 
-  if (statistics.isReady()) {
-    // Publish the data to the statistics module.
-    VLOG(1) << "Publishing resource usage for executor '" << executorId
-            << "' of framework '" << frameworkId << "'";
-    publish(frameworkId, executorId, statistics.get());
+    totalCpuTime = cpuTime;
+    totalMemoryRss = (uint64_t) memoryRss;
+    totalDiskUsed = (uint64_t) diskUsed;
   } else {
     // Note that the isolator might have been terminated and pending
     // dispatches deleted, causing the future to get discarded.
     LOG(WARNING)
-      << "Failed to collect resource usage for executor '" << executorId
-      << "' of framework '" << frameworkId << "': "
-      << statistics.isFailed() ? statistics.failure() : "Future discarded";
+      << "Failed to collect resource usage: "
+      << (usages.isFailed() ? usages.failure() : "Future discarded");
   }
 
   // Schedule the next collection.
-  delay(interval, self(), &Self::collect, frameworkId, executorId, interval);
+  CHECK_SOME(interval);
+  delay(interval.get(), self(), &Self::collect);
 }
 
 
@@ -202,6 +461,15 @@ void publish(
       prefix + CPU_TIME,
       statistics.cpu_user_time() + statistics.cpu_system_time(),
       time);
+
+  // Publish sandbox disk usage, if the isolator reported it.
+  if (statistics.has_disk_used_bytes()) {
+    process::statistics->set(
+        "monitor",
+        prefix + DISK_USED,
+        statistics.disk_used_bytes(),
+        time);
+  }
 }
 
 
@@ -238,6 +506,7 @@ Future<http::Response> _usage(
       usage.values[CPU_USAGE] = 0;
       usage.values[CPU_TIME] = 0;
       usage.values[MEMORY_RSS] = 0;
+      usage.values[DISK_USED] = 0;
 
       // Set the usage data if present.
       if (statistics.count(prefix + CPU_USAGE) > 0) {
@@ -249,6 +518,9 @@ Future<http::Response> _usage(
       if (statistics.count(prefix + MEMORY_RSS) > 0) {
         usage.values[MEMORY_RSS] = statistics.find(prefix + MEMORY_RSS)->second;
       }
+      if (statistics.count(prefix + DISK_USED) > 0) {
+        usage.values[DISK_USED] = statistics.find(prefix + DISK_USED)->second;
+      }
 
       JSON::Object entry;
       entry.values["framework_id"] = frameworkId.value();
@@ -265,9 +537,55 @@ Future<http::Response> _usage(
 }
 
 
-ResourceMonitor::ResourceMonitor(Isolator* isolator)
+// Renders the percentile summary of a sketch.
+static JSON::Object summarize(const Sketch& sketch)
+{
+  JSON::Object object;
+  object.values["samples"] = (double) sketch.count;
+  object.values["min"] = sketch.min;
+  object.values["max"] = sketch.max;
+  object.values["mean"] =
+    sketch.count > 0 ? sketch.sum / sketch.count : 0.0;
+  object.values["p50"] = sketch.quantile(0.50);
+  object.values["p90"] = sketch.quantile(0.90);
+  object.values["p99"] = sketch.quantile(0.99);
+  return object;
+}
+
+
+Future<http::Response> ResourceMonitorProcess::summary(
+    const http::Request& request)
+{
+  JSON::Object result;
+
+  size_t executors = 0;
+  foreachkey (const FrameworkID& frameworkId, watches) {
+    executors += watches.get(frameworkId).get().size();
+  }
+
+  result.values["executors"] = (double) executors;
+
+  // Current totals across the watched executors.
+  JSON::Object totals;
+  totals.values[CPU_TIME] = totalCpuTime;
+  totals.values[MEMORY_RSS] = (double) totalMemoryRss;
+  totals.values[DISK_USED] = (double) totalDiskUsed;
+  result.values["totals"] = totals;
+
+  // Distributions over every sample collected. NOTE: operator []
+  // default constructs an (empty) sketch for statistics that have
+  // not seen a sample yet.
+  result.values[CPU_USAGE] = summarize(sketches[CPU_USAGE]);
+  result.values[MEMORY_RSS] = summarize(sketches[MEMORY_RSS]);
+  result.values[DISK_USED] = summarize(sketches[DISK_USED]);
+
+  return http::OK(result, request.query.get("jsonp"));
+}
+
+
+ResourceMonitor::ResourceMonitor(Isolator* isolator, int budget)
 {
-  process = new ResourceMonitorProcess(isolator);
+  process = new ResourceMonitorProcess(isolator, budget);
   spawn(process);
 }
 
@@ -19,6 +19,8 @@
 #ifndef __SLAVE_MONITOR_HPP__
 #define __SLAVE_MONITOR_HPP__
 
+#include <stdint.h>
+
 #include <string>
 
 #include <mesos/mesos.hpp>
@@ -28,6 +30,7 @@
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/nothing.hpp>
+#include <stout/option.hpp>
 #include <stout/try.hpp>
 
 #include "common/type_utils.hpp"
@@ -41,6 +44,45 @@ class Isolator;
 class ResourceMonitorProcess;
 
 
+// A streaming sketch of a sample distribution. Samples are counted
+// into logarithmically scaled buckets (SUBBUCKETS per power of two),
+// so inserts are O(1), memory is fixed regardless of how many samples
+// are added, and quantile estimates are accurate to the bucket width
+// (under 10% relative error). This is what backs the aggregated
+// /monitor/summary.json endpoint: fleet tooling can poll a few
+// hundred bytes of percentiles instead of fetching and aggregating
+// every executor's time series.
+struct Sketch
+{
+  Sketch();
+
+  // Adds a sample (negative samples count as zero).
+  void add(double sample);
+
+  // Returns an estimate of the given quantile (e.g., 0.5, 0.99), or
+  // zero if no samples have been added.
+  double quantile(double q) const;
+
+  uint64_t count;
+  double sum;
+  double min; // Zero until a sample is added.
+  double max;
+
+private:
+  // 8 sub-buckets per power of two, for binary exponents in
+  // [MINEXP, MAXEXP): this spans tiny rates through petabytes.
+  static const int SUBBUCKETS = 8;
+  static const int MINEXP = -16;
+  static const int MAXEXP = 64;
+  static const int BUCKETS = (MAXEXP - MINEXP) * SUBBUCKETS;
+
+  // Returns the bucket index for the sample.
+  static int bucket(double sample);
+
+  uint64_t buckets[BUCKETS];
+};
+
+
 // Provides resource monitoring for executors. Resource usage time
 // series are stored using the Statistics module. Usage information
 // is also exported via a JSON endpoint.
@@ -55,7 +97,9 @@ class ResourceMonitorProcess;
 class ResourceMonitor
 {
 public:
-  ResourceMonitor(Isolator* isolator);
+  // The budget caps how many executors get sampled per collection
+  // pass (0 means no limit); see ResourceMonitorProcess::collect().
+  ResourceMonitor(Isolator* isolator, int budget = 0);
   ~ResourceMonitor();
 
   // Starts monitoring resources for the given executor.
@@ -80,8 +124,14 @@ private:
 class ResourceMonitorProcess : public process::Process<ResourceMonitorProcess>
 {
 public:
-  ResourceMonitorProcess(Isolator* _isolator)
-    : ProcessBase("monitor"), isolator(_isolator) {}
+  ResourceMonitorProcess(Isolator* _isolator, int _budget = 0)
+    : ProcessBase("monitor"),
+      isolator(_isolator),
+      budget(_budget),
+      totalCpuTime(0.0),
+      totalMemoryRss(0),
+      totalDiskUsed(0),
+      collecting(false) {}
 
   virtual ~ResourceMonitorProcess() {}
 
@@ -99,28 +149,82 @@ protected:
   virtual void initialize()
   {
     route("/usage.json", &ResourceMonitorProcess::usage);
+    route("/summary.json", &ResourceMonitorProcess::summary);
   }
 
 private:
-  void collect(
-      const FrameworkID& frameworkId,
-      const ExecutorID& executorId,
-      const Duration& interval);
+  // Collects the usage of every watched executor with one batch call
+  // into the isolator (see Isolator::usages()) and publishes the
+  // results in one pass, rather than running a dispatch chain per
+  // executor per interval.
+  void collect();
 
   void _collect(
-      const process::Future<ResourceStatistics>& statistics,
-      const FrameworkID& frameworkId,
-      const ExecutorID& executorId,
-      const Duration& interval);
+      const process::Future<
+          hashmap<FrameworkID,
+                  hashmap<ExecutorID, ResourceStatistics> > >& usages);
 
   // Returns the usage information. Requests have no parameters.
   process::Future<process::http::Response> usage(
       const process::http::Request& request);
 
+  // Returns per-slave aggregates: current totals across the watched
+  // executors plus percentile summaries of every sample collected.
+  // Requests have no parameters.
+  process::Future<process::http::Response> summary(
+      const process::http::Request& request);
+
+  // Per executor adaptive sampling state. An executor gets sampled
+  // every 'stride' collection passes: consecutive stable samples
+  // double the stride (up to MONITORING_MAX_STRIDE, see
+  // slave/constants.hpp) while activity, rss movement, or memory
+  // limit proximity snap it back to every pass. Idle executors thus
+  // converge to a sparse cadence and the collection cost tracks
+  // activity rather than executor density.
+  struct Cadence
+  {
+    Cadence() : stride(1), countdown(0), stable(0), cpuTime(0.0),
+                memoryRss(0.0), diskUsed(0.0) {}
+
+    int stride;    // Collection passes between samples.
+    int countdown; // Passes until the next sample (overdue when < 0).
+    int stable;    // Consecutive stable samples at this stride.
+
+    // The last sampled values, for detecting change (and for the
+    // slave-wide totals, which sum the last sample of every watched
+    // executor whether or not it was due this pass).
+    double cpuTime;
+    double memoryRss;
+    double diskUsed;
+  };
+
   Isolator* isolator;
 
+  // Maximum number of executors sampled per collection pass (0 means
+  // no limit); the most overdue executors win when over budget.
+  const int budget;
+
+  // Adaptive sampling state for each watched executor.
+  hashmap<FrameworkID, hashmap<ExecutorID, Cadence> > cadences;
+
+  // Streaming sketches over every collected sample, keyed by
+  // statistic name.
+  hashmap<std::string, Sketch> sketches;
+
+  // Totals across the watched executors, refreshed on every
+  // collection pass.
+  double totalCpuTime;
+  uint64_t totalMemoryRss;
+  uint64_t totalDiskUsed;
+
   // The executor info is stored for each watched executor.
   hashmap<FrameworkID, hashmap<ExecutorID, ExecutorInfo> > watches;
+
+  // The collection loop runs at the smallest interval requested
+  // across watches (in practice the slave passes the same monitoring
+  // interval for every watch), and pauses while nothing is watched.
+  Option<Duration> interval;
+  bool collecting;
 };
 
 } // namespace slave {
@@ -87,6 +87,31 @@ inline std::string getArchiveDir(const std::string rootDir)
 }
 
 
+inline std::string getFetchCacheDir(const std::string rootDir)
+{
+  return path::join(rootDir, "fetch");
+}
+
+
+// File in an executor's work directory into which the launcher
+// writes its fetch durations (one line per URI: '<microseconds>
+// <uri>'), read by the slave when the executor registers and fed
+// into the slave's metrics registry.
+inline std::string getFetchReportPath(const std::string directory)
+{
+  return path::join(directory, ".fetch");
+}
+
+
+// Directory of unix domain sockets (one per libprocess, named by its
+// port) used for slave <-> executor communication on this host (see
+// LIBPROCESS_SOCKET_DIR in libprocess).
+inline std::string getSocketDir(const std::string rootDir)
+{
+  return path::join(rootDir, "sockets");
+}
+
+
 inline std::string getLatestSlavePath(const std::string& rootDir)
 {
   return strings::format(LATEST_SLAVE_PATH, rootDir).get();
@@ -284,7 +309,55 @@ inline std::string getTaskUpdatesPath(
 }
 
 
-inline std::string createExecutorDirectory(
+// A handle on the path layout of a single executor run. The run
+// directory is formatted once at construction and every derived path
+// is built from it by plain concatenation, so code that holds a
+// handle (the slave's Executor, the status update manager's streams,
+// run recovery in state.cpp) does no path formatting in steady state.
+struct RunPaths
+{
+  RunPaths() {}
+
+  RunPaths(
+      const std::string& rootDir,
+      const SlaveID& slaveId,
+      const FrameworkID& frameworkId,
+      const ExecutorID& executorId,
+      const UUID& uuid)
+    : run(getExecutorRunPath(rootDir, slaveId, frameworkId, executorId, uuid)),
+      pids(run + "/pids"),
+      libprocessPid(pids + "/" + LIBPROCESS_PID_FILE),
+      forkedPid(pids + "/" + FORKED_PID_FILE),
+      tasks(run + "/tasks") {}
+
+  std::string task(const TaskID& taskId) const
+  {
+    return tasks + "/" + taskId.value();
+  }
+
+  std::string taskInfo(const TaskID& taskId) const
+  {
+    return task(taskId) + "/" + TASK_INFO_FILE;
+  }
+
+  std::string taskUpdates(const TaskID& taskId) const
+  {
+    return task(taskId) + "/" + TASK_UPDATES_FILE;
+  }
+
+  std::string run;
+  std::string pids;
+  std::string libprocessPid;
+  std::string forkedPid;
+  std::string tasks;
+};
+
+
+// Creates an executor's per-run directory and points the "latest"
+// symlink at it. This is disk work (a mkdir chain and a symlink) and
+// is meant to be run off the slave's event loop, e.g., on the worker
+// pool via async (see Framework::launchExecutor).
+inline Try<Nothing> provisionExecutorDirectory(
     const std::string& rootDir,
     const SlaveID& slaveId,
     const FrameworkID& frameworkId,
@@ -296,8 +369,11 @@ inline std::string createExecutorDirectory(
 
   Try<Nothing> mkdir = os::mkdir(directory);
 
-  CHECK_SOME(mkdir)
-    << "Failed to create executor directory '" << directory << "'";
+  if (mkdir.isError()) {
+    return Error(
+        "Failed to create executor directory '" + directory +
+        "': " + mkdir.error());
+  }
 
   LOG(INFO) << "Created executor directory '" << directory << "'";
 
@@ -306,18 +382,39 @@ inline std::string createExecutorDirectory(
     getExecutorLatestRunPath(rootDir, slaveId, frameworkId, executorId);
 
   if (os::exists(latest)) {
-    CHECK_SOME(os::rm(latest))
-      << "Failed to remove latest symlink '" << latest << "'";
+    Try<Nothing> rm = os::rm(latest);
+    if (rm.isError()) {
+      return Error(
+          "Failed to remove latest symlink '" + latest +
+          "': " + rm.error());
+    }
   }
 
   // Symlink the new executor directory to "latest".
   Try<Nothing> symlink = fs::symlink(directory, latest);
 
-  CHECK_SOME(symlink)
-    << "Failed to symlink directory '" << directory
-    << "' to '" << latest << "'";
+  if (symlink.isError()) {
+    return Error(
+        "Failed to symlink directory '" + directory +
+        "' to '" + latest + "': " + symlink.error());
+  }
 
-  return directory;
+  return Nothing();
+}
+
+
+inline std::string createExecutorDirectory(
+    const std::string& rootDir,
+    const SlaveID& slaveId,
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    const UUID& executorUUID)
+{
+  CHECK_SOME(provisionExecutorDirectory(
+      rootDir, slaveId, frameworkId, executorId, executorUUID));
+
+  return
+    getExecutorRunPath(rootDir, slaveId, frameworkId, executorId, executorUUID);
 }
 
 
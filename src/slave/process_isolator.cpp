@@ -26,14 +26,18 @@
 #endif
 
 #include <map>
+#include <queue>
 #include <set>
+#include <vector>
 
 #include <process/clock.hpp>
+#include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
 
 #include <stout/exit.hpp>
 #include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 #include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
@@ -47,6 +51,7 @@
 #endif
 
 #include "slave/flags.hpp"
+#include "slave/paths.hpp"
 #include "slave/process_isolator.hpp"
 #include "slave/state.hpp"
 
@@ -71,7 +76,8 @@ using state::RunState;
 
 ProcessIsolator::ProcessIsolator()
   : ProcessBase(ID::generate("process-isolator")),
-    initialized(false)
+    initialized(false),
+    pool(NULL)
 {
   // Spawn the reaper, note that it might send us a message before we
   // actually get spawned ourselves, but that's okay, the message will
@@ -88,6 +94,8 @@ ProcessIsolator::~ProcessIsolator()
   terminate(reaper);
   wait(reaper);
   delete reaper;
+
+  delete pool;
 }
 
 
@@ -101,6 +109,22 @@ void ProcessIsolator::initialize(
   local = _local;
   slave = _slave;
 
+  // Fork the launcher pool (if enabled) now, while our address space
+  // is still small; the whole point is to never fork a grown slave.
+  if (flags.launcher_pool_size > 0) {
+    Try<string> realpath = os::realpath(
+        path::join(flags.launcher_dir, "mesos-launcher"));
+
+    if (realpath.isError()) {
+      EXIT(1) << "Failed to determine the canonical path "
+              << "for the mesos-launcher: " << realpath.error();
+    }
+
+    pool = new launcher::LauncherPool(flags.launcher_pool_size,
+                                      realpath.get());
+    pool->addListener(this);
+  }
+
   initialized = true;
 }
 
@@ -125,22 +149,10 @@ void ProcessIsolator::launchExecutor(
             << "' for framework " << frameworkId;
 
   ProcessInfo* info = new ProcessInfo(frameworkId, executorId);
+  info->disk = new DiskUsageTracker(directory);
 
   infos[frameworkId][executorId] = info;
 
-  // Use pipes to determine which child has successfully changed session.
-  int pipes[2];
-  if (pipe(pipes) < 0) {
-    PLOG(FATAL) << "Failed to create a pipe";
-  }
-
-  // Set the FD_CLOEXEC flags on these pipes
-  Try<Nothing> cloexec = os::cloexec(pipes[0]);
-  CHECK_SOME(cloexec) << "Error setting FD_CLOEXEC on pipe[0]";
-
-  cloexec = os::cloexec(pipes[1]);
-  CHECK_SOME(cloexec) << "Error setting FD_CLOEXEC on pipe[1]";
-
   // Create the ExecutorLauncher instance before the fork for the
   // child process to use. TODO(benh): Consider actually setting up
   // this slaves environment for launching mesos-launcher so that we
@@ -161,10 +173,38 @@ void ProcessIsolator::launchExecutor(
       slave,
       flags.frameworks_home,
       flags.hadoop_home,
+      paths::getFetchCacheDir(flags.work_dir),
+      flags.fetch_cache_size,
+      flags.fetch_rate_limit,
       !local,
       flags.switch_user,
       frameworkInfo.checkpoint());
 
+  // Hand the launch to a pre-forked helper instead of forking this
+  // (potentially huge) process, if the launcher pool is enabled.
+  if (pool != NULL) {
+    pool->launch(launcher.environmentForLauncherMain())
+      .onAny(defer(PID<ProcessIsolator>(this),
+                   &ProcessIsolator::_launchExecutor,
+                   frameworkId,
+                   executorId,
+                   lambda::_1));
+    return;
+  }
+
+  // Use pipes to determine which child has successfully changed session.
+  int pipes[2];
+  if (pipe(pipes) < 0) {
+    PLOG(FATAL) << "Failed to create a pipe";
+  }
+
+  // Set the FD_CLOEXEC flags on these pipes
+  Try<Nothing> cloexec = os::cloexec(pipes[0]);
+  CHECK_SOME(cloexec) << "Error setting FD_CLOEXEC on pipe[0]";
+
+  cloexec = os::cloexec(pipes[1]);
+  CHECK_SOME(cloexec) << "Error setting FD_CLOEXEC on pipe[1]";
+
   pid_t pid;
   if ((pid = fork()) == -1) {
     PLOG(FATAL) << "Failed to fork to launch new executor";
@@ -248,6 +288,39 @@ void ProcessIsolator::launchExecutor(
   }
 }
 
+void ProcessIsolator::_launchExecutor(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    const Future<pid_t>& pid)
+{
+  if (!pid.isReady()) {
+    // Match the direct fork path, which dies if the fork fails.
+    LOG(FATAL) << "Failed to launch executor '" << executorId
+               << "' of framework " << frameworkId
+               << " through the launcher pool: "
+               << (pid.isFailed() ? pid.failure() : "Future discarded");
+  }
+
+  if (!infos.contains(frameworkId) ||
+      !infos[frameworkId].contains(executorId)) {
+    // The executor was removed while the helper was forking it; kill
+    // the orphaned session.
+    LOG(WARNING) << "Killing orphaned executor at " << pid.get();
+    killpg(pid.get(), SIGKILL);
+    return;
+  }
+
+  LOG(INFO) << "Forked executor at " << pid.get();
+
+  // Record the pid (this is also the pgid and sid of the executor
+  // since the helper's child calls setsid).
+  infos[frameworkId][executorId]->pid = pid.get();
+
+  // Tell the slave this executor has started.
+  dispatch(slave, &Slave::executorStarted, frameworkId, executorId, pid.get());
+}
+
+
 // NOTE: This function can be called by the isolator itself or by the
 // slave if it doesn't hear about an executor exit after it sends a
 // shutdown message.
@@ -347,6 +420,58 @@ Future<Nothing> ProcessIsolator::recover(
 }
 
 
+#ifdef __linux__
+namespace {
+
+// Fills in the usage (rss, cpu times) of the process at index 'root'
+// in the snapshot and all of its descendants, walking the snapshot's
+// parent index breadth first.
+void aggregate(
+    const proc::ProcessStatistics& processes,
+    const std::map<pid_t, std::vector<size_t> >& children,
+    size_t root,
+    long pageSize,
+    long ticks,
+    ResourceStatistics* result)
+{
+  long rss = processes.rss[root];
+  unsigned long utime = processes.utime[root];
+  unsigned long stime = processes.stime[root];
+
+  std::queue<pid_t> parents;
+  std::set<pid_t> visited;
+  parents.push(processes.pid[root]);
+
+  while (!parents.empty()) {
+    pid_t parent = parents.front();
+    parents.pop();
+
+    std::map<pid_t, std::vector<size_t> >::const_iterator entry =
+      children.find(parent);
+    if (entry == children.end()) {
+      continue;
+    }
+
+    foreach (size_t i, entry->second) {
+      if (processes.pid[i] != processes.pid[root] &&
+          visited.insert(processes.pid[i]).second) {
+        rss += processes.rss[i];
+        utime += processes.utime[i];
+        stime += processes.stime[i];
+        parents.push(processes.pid[i]);
+      }
+    }
+  }
+
+  result->set_memory_rss(rss * pageSize);
+  result->set_cpu_user_time((double) utime / (double) ticks);
+  result->set_cpu_system_time((double) stime / (double) ticks);
+}
+
+} // namespace {
+#endif // __linux__
+
+
 Future<ResourceStatistics> ProcessIsolator::usage(
     const FrameworkID& frameworkId,
     const ExecutorID& executorId)
@@ -375,49 +500,33 @@ Future<ResourceStatistics> ProcessIsolator::usage(
 
   CHECK_SOME(info->pid);
 
-  // Get the parent process usage statistics.
-  Try<proc::ProcessStatus> status = proc::status(info->pid.get());
+  // Take one snapshot of every process and aggregate the executor
+  // and all of its descendants out of it, rather than re-reading and
+  // re-parsing a stat file per descendant.
+  Try<proc::ProcessStatistics> snapshot = proc::statistics();
 
-  if (status.isError()) {
-    return Future<ResourceStatistics>::failed(status.error());
+  if (snapshot.isError()) {
+    return Future<ResourceStatistics>::failed(snapshot.error());
   }
 
-  result.set_memory_rss(status.get().rss * pageSize);
-  result.set_cpu_user_time((double) status.get().utime / (double) ticks);
-  result.set_cpu_system_time((double) status.get().stime / (double) ticks);
+  const proc::ProcessStatistics& processes = snapshot.get();
 
-  // Now aggregate all descendant process usage statistics.
-  Try<set<pid_t> > children = proc::children(info->pid.get(), true);
+  // Index the snapshot by parent so the descendant walk is linear.
+  std::map<pid_t, std::vector<size_t> > children;
+  Option<size_t> root;
+  for (size_t i = 0; i < processes.size(); i++) {
+    children[processes.ppid[i]].push_back(i);
+    if (processes.pid[i] == info->pid.get()) {
+      root = i;
+    }
+  }
 
-  if (children.isError()) {
+  if (root.isNone()) {
     return Future<ResourceStatistics>::failed(
-        "Failed to get children of " + stringify(info->pid.get()) + ": " +
-        children.error());
+        "Failed to find process " + stringify(info->pid.get()));
   }
 
-  // Aggregate the usage of all child processes.
-  foreach (pid_t child, children.get()) {
-    status = proc::status(child);
-
-    if (status.isError()) {
-      LOG(WARNING) << "Failed to get status of descendant process " << child
-                   << " of parent " << info->pid.get() << ": "
-                   << status.error();
-      continue;
-    }
-
-    result.set_memory_rss(
-        result.memory_rss() +
-        status.get().rss * pageSize);
-
-    result.set_cpu_user_time(
-        result.cpu_user_time() +
-        (double) status.get().utime / (double) ticks);
-
-    result.set_cpu_system_time(
-        result.cpu_system_time() +
-        (double) status.get().stime / (double) ticks);
-  }
+  aggregate(processes, children, root.get(), pageSize, ticks, &result);
 #elif defined __APPLE__
   // TODO(bmahler): Aggregate the usage of all child processes.
   // NOTE: There are several pitfalls to using proc_pidinfo().
@@ -446,6 +555,95 @@ Future<ResourceStatistics> ProcessIsolator::usage(
   result.set_cpu_system_time(Nanoseconds(task.pti_total_system).secs());
 #endif
 
+  // Account sandbox disk usage. This is cheap after the first call,
+  // which seeds the accounting with a full walk of the sandbox.
+  if (info->disk != NULL) {
+    info->disk->update();
+    result.set_disk_used_bytes(info->disk->usage().bytes());
+  }
+
+  return result;
+}
+
+
+Future<Usages> ProcessIsolator::usages(const ExecutorSet& executors)
+{
+  Usages result;
+
+#ifdef __linux__
+  long pageSize = sysconf(_SC_PAGESIZE);
+  PCHECK(pageSize > 0) << "Failed to get sysconf(_SC_PAGESIZE)";
+
+  long ticks = sysconf(_SC_CLK_TCK);
+  PCHECK(ticks > 0) << "Failed to get sysconf(_SC_CLK_TCK)";
+
+  // One snapshot of /proc serves every executor.
+  Try<proc::ProcessStatistics> snapshot = proc::statistics();
+
+  if (snapshot.isError()) {
+    return Future<Usages>::failed(snapshot.error());
+  }
+
+  const proc::ProcessStatistics& processes = snapshot.get();
+
+  // Index the snapshot by parent (for the descendant walks) and by
+  // pid (to find each executor's root process).
+  std::map<pid_t, std::vector<size_t> > children;
+  std::map<pid_t, size_t> index;
+  for (size_t i = 0; i < processes.size(); i++) {
+    children[processes.ppid[i]].push_back(i);
+    index[processes.pid[i]] = i;
+  }
+
+  double timestamp = Clock::now();
+
+  foreachkey (const FrameworkID& frameworkId, executors) {
+    foreach (const ExecutorID& executorId,
+             executors.get(frameworkId).get()) {
+      if (!infos.contains(frameworkId) ||
+          !infos[frameworkId].contains(executorId) ||
+          infos[frameworkId][executorId]->killed) {
+        continue;
+      }
+
+      ProcessInfo* info = infos[frameworkId][executorId];
+      if (info->pid.isNone()) {
+        continue;
+      }
+
+      std::map<pid_t, size_t>::const_iterator root =
+        index.find(info->pid.get());
+      if (root == index.end()) {
+        continue; // The executor already exited.
+      }
+
+      ResourceStatistics statistics;
+      statistics.set_timestamp(timestamp);
+      aggregate(processes, children, root->second, pageSize, ticks,
+                &statistics);
+
+      if (info->disk != NULL) {
+        info->disk->update();
+        statistics.set_disk_used_bytes(info->disk->usage().bytes());
+      }
+
+      result[frameworkId][executorId] = statistics;
+    }
+  }
+#else
+  // Fall back to collecting per executor; usage() computes
+  // synchronously so the futures below are never pending.
+  foreachkey (const FrameworkID& frameworkId, executors) {
+    foreach (const ExecutorID& executorId,
+             executors.get(frameworkId).get()) {
+      Future<ResourceStatistics> future = usage(frameworkId, executorId);
+      if (future.isReady()) {
+        result[frameworkId][executorId] = future.get();
+      }
+    }
+  }
+#endif
+
   return result;
 }
 
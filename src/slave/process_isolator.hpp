@@ -31,7 +31,9 @@
 #include <stout/uuid.hpp>
 
 #include "launcher/launcher.hpp"
+#include "launcher/pool.hpp"
 
+#include "slave/disk_usage.hpp"
 #include "slave/flags.hpp"
 #include "slave/isolator.hpp"
 #include "slave/reaper.hpp"
@@ -76,6 +78,8 @@ public:
       const FrameworkID& frameworkId,
       const ExecutorID& executorId);
 
+  virtual process::Future<Usages> usages(const ExecutorSet& executors);
+
   virtual process::Future<Nothing> recover(
       const Option<state::SlaveState>& state);
 
@@ -95,20 +99,42 @@ private:
       : frameworkId(_frameworkId),
         executorId(_executorId),
         pid(_pid),
-        killed(_killed) {}
+        killed(_killed),
+        disk(NULL) {}
+
+    ~ProcessInfo()
+    {
+      delete disk;
+    }
 
     FrameworkID frameworkId;
     ExecutorID executorId;
     Option<pid_t> pid; // PID of the forked executor process.
     bool killed; // True if "killing" has been initiated via 'killExecutor'.
+
+    // Sandbox disk usage accounting (NULL when the sandbox path is
+    // unknown, e.g., for executors recovered from a previous slave).
+    DiskUsageTracker* disk;
   };
 
+  // Continuation of launchExecutor when the launcher pool is in use:
+  // invoked once a helper has forked the executor.
+  void _launchExecutor(
+      const FrameworkID& frameworkId,
+      const ExecutorID& executorId,
+      const process::Future<pid_t>& pid);
+
   // TODO(benh): Make variables const by passing them via constructor.
   Flags flags;
   bool local;
   process::PID<Slave> slave;
   bool initialized;
   Reaper* reaper;
+
+  // Pre-forked launcher helpers (NULL unless --launcher_pool_size is
+  // set), which fork executors so that we do not have to.
+  launcher::LauncherPool* pool;
+
   hashmap<FrameworkID, hashmap<ExecutorID, ProcessInfo*> > infos;
 };
 
@@ -16,17 +16,27 @@
  * limitations under the License.
  */
 
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <glog/logging.h>
 
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
+#include <process/io.hpp>
+#include <process/once.hpp>
 
 #include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 #include <stout/nothing.hpp>
+#include <stout/os.hpp>
 #include <stout/proc.hpp>
 #include <stout/try.hpp>
 
@@ -42,6 +52,32 @@ namespace mesos {
 namespace internal {
 namespace slave {
 
+namespace {
+
+// Self-pipe that routes SIGCHLD into the libprocess event loop:
+// write(2) is one of the few async-signal-safe calls, so the handler
+// just writes a byte and any reaper polling the read end wakes up
+// and reaps. The pipe is created once and deliberately shared across
+// reapers; SIGCHLD only says "some child exited", so every reaper
+// waking up and reaping is the correct response (and a reaper that
+// finds the pipe already drained simply reaps spuriously).
+int pipes[2] = { -1, -1 };
+
+
+void handler(int signal)
+{
+  // Preserve errno for whatever code we interrupted.
+  int saved = errno;
+  char byte = 0;
+  // If the pipe is full then a wakeup is already pending, so a
+  // failed write (other than EINTR) is safe to ignore.
+  while (::write(pipes[1], &byte, sizeof(byte)) == -1 && errno == EINTR);
+  errno = saved;
+}
+
+} // namespace {
+
+
 Reaper::Reaper()
   : ProcessBase(ID::generate("reaper")) {}
 
@@ -73,7 +109,42 @@ Try<Nothing> Reaper::monitor(pid_t pid)
 
 void Reaper::initialize()
 {
-  reap();
+  // Install the SIGCHLD self-pipe the first time a reaper starts, so
+  // that child exits are noticed within milliseconds instead of on
+  // the next poll.
+  static Once* once = new Once();
+
+  if (!once->once()) {
+    if (pipe(pipes) == -1) {
+      PLOG(FATAL) << "Failed to create the SIGCHLD self-pipe";
+    }
+
+    // Both ends are non-blocking: the handler must never block and
+    // draining must stop at EAGAIN.
+    CHECK_SOME(os::nonblock(pipes[0]));
+    CHECK_SOME(os::nonblock(pipes[1]));
+    CHECK_SOME(os::cloexec(pipes[0]));
+    CHECK_SOME(os::cloexec(pipes[1]));
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handler;
+    sigemptyset(&action.sa_mask);
+
+    // SA_NOCLDSTOP: reap() ignores stopped children anyway.
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+
+    if (sigaction(SIGCHLD, &action, NULL) == -1) {
+      PLOG(FATAL) << "Failed to install the SIGCHLD handler";
+    }
+
+    once->done();
+  }
+
+  io::poll(pipes[0], io::READ)
+    .onAny(defer(self(), &Reaper::notified, lambda::_1));
+
+  poll();
 }
 
 
@@ -118,7 +189,34 @@ void Reaper::reap()
       pids.erase(pid);
     }
   }
-  delay(Seconds(1.0), self(), &Reaper::reap); // Reap forever!
+}
+
+
+void Reaper::poll()
+{
+  reap();
+  delay(Seconds(1.0), self(), &Reaper::poll); // Poll forever!
+}
+
+
+void Reaper::notified(const process::Future<short>& poll)
+{
+  if (!poll.isReady()) {
+    LOG(ERROR) << "Failed to poll the SIGCHLD self-pipe, falling back "
+               << "to polling only: "
+               << (poll.isFailed() ? poll.failure() : "Future discarded");
+    return;
+  }
+
+  // Drain the pipe. The pipe is shared, so reading nothing here just
+  // means another reaper got there first.
+  char bytes[32];
+  while (::read(pipes[0], bytes, sizeof(bytes)) > 0);
+
+  reap();
+
+  io::poll(pipes[0], io::READ)
+    .onAny(defer(self(), &Reaper::notified, lambda::_1));
 }
 
 } // namespace slave {
@@ -22,6 +22,7 @@
 #include <list>
 #include <set>
 
+#include <process/future.hpp>
 #include <process/process.hpp>
 
 #include <stout/nothing.hpp>
@@ -60,8 +61,20 @@ public:
 protected:
   virtual void initialize();
 
+  // Traverses the monitored and child processes, notifying the
+  // listeners about any that have exited.
   void reap();
 
+  // Polling fallback: reaps and re-arms itself every second. This
+  // catches monitored processes that are not our children (whose
+  // exits do not raise SIGCHLD here) and lost signals.
+  void poll();
+
+  // Invoked (via the libprocess event loop) when the SIGCHLD
+  // self-pipe becomes readable, i.e., within milliseconds of a child
+  // exiting: drains the pipe, reaps, and re-arms the io poll.
+  void notified(const process::Future<short>& poll);
+
   // TOOD(vinod): Make 'status' an option.
   void notify(pid_t pid, int status);
 
@@ -26,10 +26,13 @@
 #include <string>
 #include <vector>
 
+#include <process/async.hpp>
+#include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
+#include <process/timing.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/exit.hpp>
@@ -86,9 +89,13 @@ Slave::Slave(const Resources& _resources,
     completedFrameworks(MAX_COMPLETED_FRAMEWORKS),
     isolator(_isolator),
     files(_files),
-    monitor(_isolator),
+    gc(flags.gc_unlink_rate),
+    monitor(_isolator, flags.monitoring_budget),
+    provisions(flags.launch_provision_concurrency),
+    forks(flags.launch_concurrency),
     statusUpdateManager(new StatusUpdateManager()),
-    metaDir(paths::getMetaRootDir(flags.work_dir)) {}
+    metaDir(paths::getMetaRootDir(flags.work_dir)),
+    stateServer(NULL) {}
 
 
 Slave::Slave(const slave::Flags& _flags,
@@ -102,9 +109,13 @@ Slave::Slave(const slave::Flags& _flags,
     completedFrameworks(MAX_COMPLETED_FRAMEWORKS),
     isolator(_isolator),
     files(_files),
-    monitor(_isolator),
+    gc(flags.gc_unlink_rate),
+    monitor(_isolator, flags.monitoring_budget),
+    provisions(flags.launch_provision_concurrency),
+    forks(flags.launch_concurrency),
     statusUpdateManager(new StatusUpdateManager()),
-    metaDir(paths::getMetaRootDir(flags.work_dir))
+    metaDir(paths::getMetaRootDir(flags.work_dir)),
+    stateServer(NULL)
 {
   // TODO(benh): Move this computation into Flags as the "default".
 
@@ -202,6 +213,12 @@ Slave::~Slave()
   }
 
   delete statusUpdateManager;
+
+  if (stateServer != NULL) {
+    terminate(stateServer);
+    wait(stateServer);
+    delete stateServer;
+  }
 }
 
 
@@ -272,8 +289,16 @@ void Slave::initialize()
   stats.validFrameworkMessages = 0;
   stats.invalidFrameworkMessages = 0;
 
+  // Register the operational metrics (see common/metrics.hpp).
+  fetchDurations = metrics.histogram("fetch_duration_us");
+  gcEvictions = metrics.counter("gc_evictions");
+  gcReclaimedBytes = metrics.counter("gc_reclaimed_bytes");
+
   startTime = Clock::now();
 
+  stateVersion = 0;
+  renderedStateVersion = 0;
+
   // Install protobuf handlers.
   install<NewMasterDetectedMessage>(
       &Slave::newMasterDetected,
@@ -290,6 +315,11 @@ void Slave::initialize()
       &Slave::reregistered,
       &SlaveReregisteredMessage::slave_id);
 
+  install<ReregisterSlaveRequestMessage>(
+      &Slave::reregisterRequested,
+      &ReregisterSlaveRequestMessage::slave_id,
+      &ReregisterSlaveRequestMessage::framework_ids);
+
   install<RunTaskMessage>(
       &Slave::runTask,
       &RunTaskMessage::framework,
@@ -297,6 +327,8 @@ void Slave::initialize()
       &RunTaskMessage::pid,
       &RunTaskMessage::task);
 
+  install<RunTasksMessage>(&Slave::runTasks);
+
   install<KillTaskMessage>(
       &Slave::killTask,
       &KillTaskMessage::framework_id,
@@ -325,6 +357,9 @@ void Slave::initialize()
       &StatusUpdateAcknowledgementMessage::task_id,
       &StatusUpdateAcknowledgementMessage::uuid);
 
+  install<StatusUpdateAcknowledgementsMessage>(
+      &Slave::statusUpdateAcknowledgements);
+
   install<RegisterExecutorMessage>(
       &Slave::registerExecutor,
       &RegisterExecutorMessage::framework_id,
@@ -341,6 +376,9 @@ void Slave::initialize()
       &Slave::statusUpdate,
       &StatusUpdateMessage::update);
 
+  install<StatusUpdatesMessage>(
+      &Slave::statusUpdates);
+
   install<ExecutorToFrameworkMessage>(
       &Slave::executorMessage,
       &ExecutorToFrameworkMessage::slave_id,
@@ -348,13 +386,26 @@ void Slave::initialize()
       &ExecutorToFrameworkMessage::executor_id,
       &ExecutorToFrameworkMessage::data);
 
+  install<ExecutorToFrameworkMessagesMessage>(
+      &Slave::executorMessages);
+
   install<ShutdownMessage>(
       &Slave::shutdown);
 
   // Install the ping message handler.
   install("PING", &Slave::ping);
 
-  // Setup some HTTP routes.
+  // Spawn the read-only server that answers 'stats.json' and
+  // 'state.json' polls from pre-rendered snapshots, so that
+  // monitoring load never contends with task management here. Seed
+  // the snapshots and start the refresh loop right away.
+  stateServer = new StateServerProcess();
+  spawn(stateServer);
+
+  refreshState();
+
+  // Setup some HTTP routes. Note that 'stats.json' and 'state.json'
+  // merely forward to the state server.
   route("/vars", bind(&http::vars, cref(*this), params::_1));
   route("/stats.json", bind(&http::json::stats, cref(*this), params::_1));
   route("/state.json", bind(&http::json::state, cref(*this), params::_1));
@@ -390,6 +441,23 @@ void Slave::_initialize(const Future<Nothing>& future)
 
   LOG(INFO) << "Finished recovery";
 
+  recovered.set(Nothing()); // Signal recovery.
+
+  // Terminate slave, if it has no active frameworks and is started
+  // in 'cleanup' mode.
+  if (frameworks.empty() && flags.recover == "cleanup") {
+    terminate(self());
+    return;
+  }
+
+  // Register with the master. Note that registration is not gated on
+  // the garbage collection scan below; scheduling old directories
+  // for deletion is not a prerequisite for accepting work.
+  state = DISCONNECTED;
+  if (master) {
+    doReliableRegistration();
+  }
+
   // Schedule all old slave directories for garbage collection.
   // TODO(vinod): Do this as part of recovery. This needs a fix
   // in the recovery code, to recover all slaves instead of only
@@ -419,20 +487,6 @@ void Slave::_initialize(const Future<Nothing>& future)
       }
     }
   }
-
-  recovered.set(Nothing()); // Signal recovery.
-
-  // Terminate slave, if it has no active frameworks and is started
-  // in 'cleanup' mode.
-  if (frameworks.empty() && flags.recover == "cleanup") {
-    terminate(self());
-  } else {
-    // Register with the master.
-    state = DISCONNECTED;
-    if (master) {
-      doReliableRegistration();
-    }
-  }
 }
 
 
@@ -530,7 +584,11 @@ void Slave::newMasterDetected(const UPID& pid)
   LOG(INFO) << "New master detected at " << pid;
 
   master = pid;
-  link(master);
+
+  // The master link carries many small latency sensitive messages.
+  link(master, SocketOptions::control());
+
+  invalidateState();
 
   // Inform the status updates manager about the new master.
   statusUpdateManager->newMasterDetected(master);
@@ -593,6 +651,8 @@ void Slave::registered(const SlaveID& slaveId)
       state = RUNNING;
       info.mutable_id()->CopyFrom(slaveId); // Store the slave id.
 
+      invalidateState();
+
       if (flags.checkpoint) {
         // Create the slave meta directory.
         paths::createSlaveDirectory(paths::getMetaRootDir(flags.work_dir), slaveId);
@@ -630,6 +690,10 @@ void Slave::reregistered(const SlaveID& slaveId)
         LOG(FATAL) << "Slave re-registered but got wrong id: " << slaveId
                    << "(expected: " << info.id() << ")";
       }
+
+      // Start the next re-registration (e.g., after another
+      // disconnection) with digest negotiation again.
+      reregisterFrameworks = None();
       break;
     case RUNNING:
       // Already registered. Ignore registration.
@@ -645,6 +709,39 @@ void Slave::reregistered(const SlaveID& slaveId)
 }
 
 
+void Slave::reregisterRequested(
+    const SlaveID& slaveId,
+    const vector<FrameworkID>& frameworkIds)
+{
+  if (state == RUNNING) {
+    // A late reply to a retried digest message; we already
+    // re-registered in the meantime.
+    return;
+  }
+
+  if (!(info.id() == slaveId)) {
+    LOG(WARNING) << "Ignoring re-registration request with wrong id: "
+                 << slaveId << " (expected: " << info.id() << ")";
+    return;
+  }
+
+  LOG(INFO) << "Master requested full re-registration state for "
+            << (frameworkIds.empty()
+                ? "all frameworks"
+                : stringify(frameworkIds.size()) + " framework(s)");
+
+  hashset<FrameworkID> ids;
+  foreach (const FrameworkID& frameworkId, frameworkIds) {
+    ids.insert(frameworkId);
+  }
+
+  reregisterFrameworks = ids;
+
+  // Resend right away rather than waiting for the retry timer.
+  doReliableRegistration();
+}
+
+
 void Slave::doReliableRegistration()
 {
   if (!master) {
@@ -665,33 +762,72 @@ void Slave::doReliableRegistration()
     message.mutable_slave()->MergeFrom(info);
     send(master, message);
   } else {
-    // Re-registering, so send tasks running.
     ReregisterSlaveMessage message;
     message.mutable_slave_id()->MergeFrom(info.id());
     message.mutable_slave()->MergeFrom(info);
 
-    foreachvalue (Framework* framework, frameworks){
-      foreachvalue (Executor* executor, framework->executors) {
-        // TODO(benh): Kill this once framework_id is required
-        // on ExecutorInfo.
-        ExecutorInfo* executorInfo = message.add_executor_infos();
-        executorInfo->MergeFrom(executor->info);
-        executorInfo->mutable_framework_id()->MergeFrom(framework->id);
-
-        // Add launched tasks.
-        foreachvalue (Task* task, executor->launchedTasks) {
-          message.add_tasks()->CopyFrom(*task);
+    if (reregisterFrameworks.isNone() && !frameworks.empty()) {
+      // First round of digest negotiation: send only per-framework
+      // content digests. The master requests the full state of any
+      // framework whose digest does not match its own view (or of
+      // everything, after a failover); if they all match, the bulky
+      // executor and task lists below never go on the wire.
+      foreachvalue (Framework* framework, frameworks) {
+        uint64_t digest = 0;
+
+        foreachvalue (Executor* executor, framework->executors) {
+          digest += protobuf::digest(executor->id);
+
+          foreachvalue (Task* task, executor->launchedTasks) {
+            digest += protobuf::digest(*task);
+          }
+
+          foreachvalue (const TaskInfo& task, executor->queuedTasks) {
+            digest += protobuf::digest(protobuf::createTask(
+                task, TASK_STAGING, executor->id, framework->id));
+          }
+        }
+
+        FrameworkDigest* entry = message.add_digests();
+        entry->mutable_framework_id()->MergeFrom(framework->id);
+        entry->set_digest(digest);
+      }
+    } else {
+      // Re-registering with the full state the master asked for.
+      // NOTE: Option::get() returns by value, hence the named local.
+      const hashset<FrameworkID> requested = reregisterFrameworks.isSome()
+        ? reregisterFrameworks.get()
+        : hashset<FrameworkID>();
+
+      foreachvalue (Framework* framework, frameworks) {
+        // An empty request means every framework.
+        if (!requested.empty() && !requested.contains(framework->id)) {
+          continue;
         }
 
-        // Add queued tasks.
-        foreachvalue (const TaskInfo& task, executor->queuedTasks) {
-          const Task& t = protobuf::createTask(
-              task, TASK_STAGING, executor->id, framework->id);
+        foreachvalue (Executor* executor, framework->executors) {
+          // TODO(benh): Kill this once framework_id is required
+          // on ExecutorInfo.
+          ExecutorInfo* executorInfo = message.add_executor_infos();
+          executorInfo->MergeFrom(executor->info);
+          executorInfo->mutable_framework_id()->MergeFrom(framework->id);
 
-          message.add_tasks()->CopyFrom(t);
+          // Add launched tasks.
+          foreachvalue (Task* task, executor->launchedTasks) {
+            message.add_tasks()->CopyFrom(*task);
+          }
+
+          // Add queued tasks.
+          foreachvalue (const TaskInfo& task, executor->queuedTasks) {
+            const Task& t = protobuf::createTask(
+                task, TASK_STAGING, executor->id, framework->id);
+
+            message.add_tasks()->CopyFrom(t);
+          }
         }
       }
     }
+
     send(master, message);
   }
 
@@ -716,15 +852,50 @@ void Slave::runTask(
     const string& pid,
     const TaskInfo& task)
 {
-  LOG(INFO) << "Got assigned task " << task.task_id()
-            << " for framework " << frameworkId;
+  vector<TaskInfo> tasks;
+  tasks.push_back(task);
+
+  runTasks(frameworkInfo, frameworkId, pid, tasks);
+}
+
+
+void Slave::runTasks(const RunTasksMessage& message)
+{
+  vector<TaskInfo> tasks;
+  foreach (const TaskInfo& task, message.tasks()) {
+    tasks.push_back(task);
+  }
+
+  runTasks(message.framework(), message.framework_id(), message.pid(), tasks);
+}
+
+
+void Slave::runTasks(
+    const FrameworkInfo& frameworkInfo,
+    const FrameworkID& frameworkId,
+    const string& pid,
+    const vector<TaskInfo>& tasks)
+{
+  TIMED_SCOPE("slave/run_task");
 
   // TODO(vinod): These ignored tasks should be consolidated by
   // the master when the slave re-registers.
+  vector<TaskInfo> assigned;
+  foreach (const TaskInfo& task, tasks) {
+    LOG(INFO) << "Got assigned task " << task.task_id()
+              << " for framework " << frameworkId;
+
+    if (!(task.slave_id() == info.id())) {
+      LOG(WARNING) << "Ignoring task " << task.task_id()
+                   << " because it was intended for the old slave "
+                   << info.id();
+      continue;
+    }
 
-  if (!(task.slave_id() == info.id())) {
-    LOG(WARNING) << "Ignoring task " << task.task_id()
-                 << " because it was intended for the old slave " << info.id();
+    assigned.push_back(task);
+  }
+
+  if (assigned.empty()) {
     return;
   }
 
@@ -733,7 +904,8 @@ void Slave::runTask(
     << state;
 
   if (state == RECOVERING || state == TERMINATING) {
-    LOG(WARNING) << "Ignoring task " << task.task_id()
+    LOG(WARNING) << "Ignoring " << assigned.size() << " assigned task(s)"
+                 << " of framework " << frameworkId
                  << " because the slave is " << state;
     // TODO(vinod): Consider sending a TASK_LOST here.
     // Currently it is tricky because 'statsuUpdate()'
@@ -763,73 +935,92 @@ void Slave::runTask(
 
     framework = new Framework(this, frameworkId, frameworkInfo, pid);
     frameworks[frameworkId] = framework;
-  }
 
-  const ExecutorInfo& executorInfo = getExecutorInfo(task);
-  const ExecutorID& executorId = executorInfo.executor_id();
+    // Pre-create the framework's directory skeleton off the event
+    // loop, so that provisioning the sandboxes of this framework's
+    // executors (which tends to happen in bursts right after the
+    // framework starts launching) only creates the per-run leaf
+    // directories.
+    async(&os::mkdir, path::join(
+        paths::getFrameworkPath(flags.work_dir, info.id(), frameworkId),
+        "executors"), true);
+  }
 
-  // We add the task to 'pending' to ensure the framework is not
-  // removed and the framework and top level executor directories
-  // are not scheduled for deletion before '_runTask()' is called.
   CHECK_NOTNULL(framework);
-  framework->pending.put(executorId, task.task_id());
 
-  // If we are about to create a new executor, unschedule the top
-  // level work and meta directories from getting gc'ed.
-  Executor* executor = framework->getExecutor(executorId);
-  if (executor == NULL) {
-    // Unschedule executor work directory.
-    string path = paths::getExecutorPath(
-        flags.work_dir, info.id(), frameworkId, executorId);
+  // Executors whose top level directories have already been
+  // unscheduled (co-scheduled tasks usually share one executor, so
+  // its directories only need unscheduling once).
+  hashset<ExecutorID> unscheduled;
 
-    if (os::exists(path)) {
-      unschedule = unschedule.then(defer(self(), &Self::unschedule, path));
-    }
+  foreach (const TaskInfo& task, assigned) {
+    const ExecutorInfo& executorInfo = getExecutorInfo(task);
+    const ExecutorID& executorId = executorInfo.executor_id();
 
-    // Unschedule executor meta directory.
-    path = paths::getExecutorPath(
-        metaDir, info.id(), frameworkId, executorId);
+    // We add the task to 'pending' to ensure the framework is not
+    // removed and the framework and top level executor directories
+    // are not scheduled for deletion before '_runTasks()' is called.
+    framework->pending.put(executorId, task.task_id());
 
-    if (os::exists(path)) {
-      unschedule = unschedule.then(defer(self(), &Self::unschedule, path));
+    // If we are about to create a new executor, unschedule the top
+    // level work and meta directories from getting gc'ed.
+    if (framework->getExecutor(executorId) == NULL &&
+        !unscheduled.contains(executorId)) {
+      unscheduled.insert(executorId);
+
+      // Unschedule executor work directory.
+      string path = paths::getExecutorPath(
+          flags.work_dir, info.id(), frameworkId, executorId);
+
+      if (os::exists(path)) {
+        unschedule = unschedule.then(defer(self(), &Self::unschedule, path));
+      }
+
+      // Unschedule executor meta directory.
+      path = paths::getExecutorPath(
+          metaDir, info.id(), frameworkId, executorId);
+
+      if (os::exists(path)) {
+        unschedule = unschedule.then(defer(self(), &Self::unschedule, path));
+      }
     }
   }
 
-  // Run the task after the unschedules are done.
+  // Run the tasks after the unschedules are done.
   unschedule.onAny(
       defer(self(),
-            &Self::_runTask,
+            &Self::_runTasks,
             params::_1,
             frameworkInfo,
             frameworkId,
             pid,
-            task));
+            assigned));
 }
 
 
-void Slave::_runTask(
+void Slave::_runTasks(
     const Future<bool>& future,
     const FrameworkInfo& frameworkInfo,
     const FrameworkID& frameworkId,
     const string& pid,
-    const TaskInfo& task)
+    const vector<TaskInfo>& tasks)
 {
-  LOG(INFO) << "Launching task " << task.task_id()
-            << " for framework " << frameworkId;
-
-  const ExecutorInfo& executorInfo = getExecutorInfo(task);
-  const ExecutorID& executorId = executorInfo.executor_id();
-
-  // Remove the pending task from framework.
   Framework* framework = getFramework(frameworkId);
   CHECK_NOTNULL(framework);
 
-  framework->pending.remove(executorId, task.task_id());
+  // Remove the pending tasks from the framework.
+  foreach (const TaskInfo& task, tasks) {
+    LOG(INFO) << "Launching task " << task.task_id()
+              << " for framework " << frameworkId;
 
-  // We don't send a status update here because a terminating
+    framework->pending.remove(
+        getExecutorInfo(task).executor_id(), task.task_id());
+  }
+
+  // We don't send status updates here because a terminating
   // framework cannot send acknowledgements.
   if (framework->state == Framework::TERMINATING) {
-    LOG(WARNING) << "Ignoring run task " << task.task_id()
+    LOG(WARNING) << "Ignoring run of " << tasks.size() << " task(s)"
                  << " of framework " << frameworkId
                  << " because the framework is terminating";
 
@@ -839,24 +1030,25 @@ void Slave::_runTask(
     return;
   }
 
-
   if (!future.isReady()) {
     LOG(ERROR) << "Failed to unschedule directories scheduled for gc: "
                << (future.isFailed() ? future.failure() : "future discarded");
 
-    const StatusUpdate& update = protobuf::createStatusUpdate(
-        frameworkId,
-        info.id(),
-        task.task_id(),
-        TASK_LOST,
-        "Could not launch the task because we failed to unschedule directories"
-        " scheduled for gc");
-
-    // TODO(vinod): Ensure that the status update manager reliably
-    // delivers this update. Currently, we don't guarantee this
-    // because removal of the framework causes the status update
-    // manager to stop retrying for its un-acked updates.
-    statusUpdate(update);
+    foreach (const TaskInfo& task, tasks) {
+      const StatusUpdate& update = protobuf::createStatusUpdate(
+          frameworkId,
+          info.id(),
+          task.task_id(),
+          TASK_LOST,
+          "Could not launch the task because we failed to unschedule"
+          " directories scheduled for gc");
+
+      // TODO(vinod): Ensure that the status update manager reliably
+      // delivers these updates. Currently, we don't guarantee this
+      // because removal of the framework causes the status update
+      // manager to stop retrying for its un-acked updates.
+      statusUpdate(update);
+    }
 
     if (framework->executors.empty() && framework->pending.empty()) {
       remove(framework);
@@ -865,103 +1057,240 @@ void Slave::_runTask(
     return;
   }
 
-  // NOTE: The slave cannot be in 'RECOVERING' because the task would
-  // have been rejected in 'runTask()' in that case.
+  // NOTE: The slave cannot be in 'RECOVERING' because the tasks would
+  // have been rejected in 'runTasks()' in that case.
   CHECK(state == DISCONNECTED || state == RUNNING || state == TERMINATING)
     << state;
 
   if (state == TERMINATING) {
-    LOG(WARNING) << "Ignoring run task " << task.task_id()
+    LOG(WARNING) << "Ignoring run of " << tasks.size() << " task(s)"
                  << " of framework " << frameworkId
                  << " because the slave is terminating";
 
-    // We don't send a TASK_LOST here because the slave is
+    // We don't send TASK_LOSTs here because the slave is
     // terminating.
     return;
   }
 
-  if (framework == NULL) {
-    framework = new Framework(this, frameworkId, frameworkInfo, pid);
-    frameworks[frameworkId] = framework;
-  }
+  CHECK(framework->state == Framework::RUNNING) << framework->state;
 
-  CHECK_NOTNULL(framework);
+  invalidateState(frameworkId);
 
-  CHECK(framework->state == Framework::RUNNING) << framework->state;
+  // Either send each task to its executor or start the executor and
+  // queue the task until the executor has started. The executor only
+  // gets launched (and the isolator only gets updated, see below)
+  // once, however many of the tasks share it.
+  hashset<Executor*> changed; // Executors whose resources changed.
 
-  // Either send the task to an executor or start a new executor
-  // and queue the task until the executor has started.
-  Executor* executor = framework->getExecutor(executorId);
+  foreach (const TaskInfo& task, tasks) {
+    const ExecutorInfo& executorInfo = getExecutorInfo(task);
+    const ExecutorID& executorId = executorInfo.executor_id();
 
-  if (executor == NULL) {
-    executor = framework->launchExecutor(executorInfo);
-  }
+    Executor* executor = framework->getExecutor(executorId);
 
-  CHECK_NOTNULL(executor);
+    if (executor == NULL) {
+      executor = framework->launchExecutor(executorInfo);
+    }
 
-  switch (executor->state) {
-    case Executor::TERMINATING:
-    case Executor::TERMINATED: {
-      LOG(WARNING) << "Asked to run task '" << task.task_id()
-                   << "' for framework " << frameworkId
-                   << " with executor '" << executorId
-                   << "' which is terminating/terminated";
+    CHECK_NOTNULL(executor);
 
-      const StatusUpdate& update = protobuf::createStatusUpdate(
-          frameworkId,
-          info.id(),
-          task.task_id(),
-          TASK_LOST,
-          "Executor terminating/terminated");
+    switch (executor->state) {
+      case Executor::TERMINATING:
+      case Executor::TERMINATED: {
+        LOG(WARNING) << "Asked to run task '" << task.task_id()
+                     << "' for framework " << frameworkId
+                     << " with executor '" << executorId
+                     << "' which is terminating/terminated";
 
-      statusUpdate(update);
-      break;
+        const StatusUpdate& update = protobuf::createStatusUpdate(
+            frameworkId,
+            info.id(),
+            task.task_id(),
+            TASK_LOST,
+            "Executor terminating/terminated");
+
+        statusUpdate(update);
+        break;
+      }
+      case Executor::REGISTERING:
+        // Checkpoint the task before we do anything else (this is a no-op
+        // if the framework doesn't have checkpointing enabled).
+        executor->checkpointTask(task);
+
+        stats.tasks[TASK_STAGING]++;
+
+        // Queue task if the executor has not yet registered.
+        LOG(INFO) << "Queuing task '" << task.task_id()
+                    << "' for executor " << executorId
+                    << " of framework '" << frameworkId;
+
+        executor->queuedTasks[task.task_id()] = task;
+        break;
+      case Executor::RUNNING: {
+        // Checkpoint the task before we do anything else (this is a no-op
+        // if the framework doesn't have checkpointing enabled).
+        executor->checkpointTask(task);
+
+        stats.tasks[TASK_STAGING]++;
+
+        // Add the task and send it to the executor.
+        executor->addTask(task);
+
+        changed.insert(executor);
+
+        LOG(INFO) << "Sending task '" << task.task_id()
+                  << "' to executor '" << executorId
+                  << "' of framework " << frameworkId;
+
+        RunTaskMessage message;
+        message.mutable_framework()->MergeFrom(framework->info);
+        message.mutable_framework_id()->MergeFrom(framework->id);
+        message.set_pid(framework->pid);
+        message.mutable_task()->MergeFrom(task);
+        send(executor->pid, message);
+        break;
+      }
+      default:
+        LOG(FATAL) << " Executor '" << executor->id
+                   << "' of framework " << framework->id
+                   << " is in unexpected state " << executor->state;
+        break;
     }
-    case Executor::REGISTERING:
-      // Checkpoint the task before we do anything else (this is a no-op
-      // if the framework doesn't have checkpointing enabled).
-      executor->checkpointTask(task);
+  }
 
-      stats.tasks[TASK_STAGING]++;
+  // Update the isolator once per executor rather than once per task.
+  // TODO(Charles Reiss): The isolator is not guaranteed to update
+  // the resources before the executor acts on its RunTaskMessages.
+  foreach (Executor* executor, changed) {
+    dispatch(isolator,
+             &Isolator::resourcesChanged,
+             framework->id,
+             executor->id,
+             executor->resources);
+  }
+}
 
-      // Queue task if the executor has not yet registered.
-      LOG(INFO) << "Queuing task '" << task.task_id()
-                  << "' for executor " << executorId
-                  << " of framework '" << frameworkId;
 
-      executor->queuedTasks[task.task_id()] = task;
-      break;
-    case Executor::RUNNING: {
-      // Checkpoint the task before we do anything else (this is a no-op
-      // if the framework doesn't have checkpointing enabled).
-      executor->checkpointTask(task);
+void Slave::provisionExecutor(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    const UUID& uuid)
+{
+  Framework* framework = getFramework(frameworkId);
+  Executor* executor =
+    framework == NULL ? NULL : framework->getExecutor(executorId);
+
+  // The executor (or its framework) may have gone away while queued
+  // for admission; the slot must still be handed back.
+  if (executor == NULL || executor->uuid != uuid) {
+    LOG(WARNING) << "Ignoring admitted launch of executor '" << executorId
+                 << "' of framework " << frameworkId
+                 << " because it no longer exists";
+    provisions.release();
+    return;
+  }
 
-      stats.tasks[TASK_STAGING]++;
+  async(&paths::provisionExecutorDirectory,
+        flags.work_dir,
+        info.id(),
+        frameworkId,
+        executorId,
+        uuid)
+    .onAny(defer(self(),
+                 &Self::_launchExecutor,
+                 frameworkId,
+                 executorId,
+                 params::_1));
+}
 
-      // Add the task and send it to the executor.
-      executor->addTask(task);
 
-      // Update the resources.
-      // TODO(Charles Reiss): The isolator is not guaranteed to update
-      // the resources before the executor acts on its RunTaskMessage.
-      dispatch(isolator,
-               &Isolator::resourcesChanged,
-               framework->id,
-               executor->id,
-               executor->resources);
+void Slave::_launchExecutor(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    const Future<Try<Nothing> >& provisioned)
+{
+  // The provisioning phase is over, whatever the outcome.
+  provisions.release();
 
-      LOG(INFO) << "Sending task '" << task.task_id()
-                << "' to executor '" << executorId
-                << "' of framework " << frameworkId;
+  Framework* framework = getFramework(frameworkId);
+  if (framework == NULL) {
+    // The framework was torn down while the sandbox was being
+    // provisioned; the directory gets cleaned up with the rest of
+    // the framework's directories by the garbage collector.
+    LOG(WARNING) << "Ignoring provisioned sandbox of executor '"
+                 << executorId << "' because framework " << frameworkId
+                 << " no longer exists";
+    return;
+  }
 
-      RunTaskMessage message;
-      message.mutable_framework()->MergeFrom(framework->info);
-      message.mutable_framework_id()->MergeFrom(framework->id);
-      message.set_pid(framework->pid);
-      message.mutable_task()->MergeFrom(task);
-      send(executor->pid, message);
-      break;
+  Executor* executor = framework->getExecutor(executorId);
+  if (executor == NULL) {
+    LOG(WARNING) << "Ignoring provisioned sandbox of unknown executor '"
+                 << executorId << "' of framework " << frameworkId;
+    return;
+  }
+
+  // Check how the provisioning went. Nothing has been handed to the
+  // isolator yet, so on failure (e.g., disk errors, or the worker
+  // pool shedding the work) terminating the executor transitions its
+  // queued tasks and cleans everything up.
+  // NOTE: Future::get returns by value, hence the named local.
+  Option<string> error = None();
+  if (!provisioned.isReady()) {
+    error = provisioned.isFailed()
+      ? provisioned.failure()
+      : string("Provisioning discarded");
+  } else {
+    const Try<Nothing> result = provisioned.get();
+    if (result.isError()) {
+      error = result.error();
     }
+  }
+
+  if (error.isSome()) {
+    LOG(ERROR) << "Failed to provision sandbox of executor '" << executorId
+               << "' of framework " << frameworkId << ": " << error.get();
+
+    executorTerminated(
+        frameworkId,
+        executorId,
+        0,
+        false,
+        "Failed to provision executor sandbox: " + error.get());
+    return;
+  }
+
+  switch (executor->state) {
+    case Executor::TERMINATING:
+      // The executor was told to shut down while its sandbox was
+      // being provisioned, i.e., before the isolator was ever asked
+      // to launch it, so no termination will arrive from the
+      // isolator. Generate it here to transition the tasks and clean
+      // up the executor.
+      LOG(WARNING) << "Executor '" << executorId
+                   << "' of framework " << frameworkId
+                   << " was shut down before it was launched";
+
+      executorTerminated(
+          frameworkId,
+          executorId,
+          0,
+          false,
+          "Executor shut down before it was launched");
+      break;
+    case Executor::REGISTERING:
+      files->attach(executor->directory, executor->directory)
+        .onAny(defer(self(),
+                     &Self::fileAttached,
+                     params::_1,
+                     executor->directory));
+
+      // Admission into the fork phase (see Slave::forks): the slot
+      // covers fork through registration, which also covers the URI
+      // fetching the launcher performs in the child.
+      forks.acquire()
+        .onAny(defer(self(), &Self::forkExecutor, frameworkId, executorId));
+      break;
     default:
       LOG(FATAL) << " Executor '" << executor->id
                  << "' of framework " << framework->id
@@ -971,6 +1300,51 @@ void Slave::_runTask(
 }
 
 
+void Slave::forkExecutor(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId)
+{
+  Framework* framework = getFramework(frameworkId);
+  Executor* executor =
+    framework == NULL ? NULL : framework->getExecutor(executorId);
+
+  if (executor == NULL || executor->state != Executor::REGISTERING) {
+    // The executor went away (or was told to shut down) while queued
+    // for admission; hand the slot to the next launch.
+    forks.release();
+
+    if (executor != NULL && executor->state == Executor::TERMINATING) {
+      // The isolator was never asked to launch the executor, so no
+      // termination will arrive from it (see _launchExecutor).
+      executorTerminated(
+          frameworkId,
+          executorId,
+          0,
+          false,
+          "Executor shut down before it was launched");
+    } else {
+      LOG(WARNING) << "Ignoring admitted launch of executor '" << executorId
+                   << "' of framework " << frameworkId
+                   << " because it no longer exists";
+    }
+    return;
+  }
+
+  executor->forkSlot = true;
+
+  // Tell the isolator to launch the executor.
+  dispatch(isolator,
+           &Isolator::launchExecutor,
+           info.id(),
+           framework->id,
+           framework->info,
+           executor->info,
+           executor->uuid,
+           executor->directory,
+           executor->resources);
+}
+
+
 void Slave::killTask(const FrameworkID& frameworkId, const TaskID& taskId)
 {
   LOG(INFO) << "Asked to kill task " << taskId
@@ -1128,7 +1502,7 @@ void Slave::shutdownFramework(const FrameworkID& frameworkId)
       // Shut down all executors of this framework.
       // NOTE: If there are no executors but 'pending' tasks, the
       // framework will be removed and all its tasks are appropriately
-      // handled in '_runTask()'.
+      // handled in '_runTasks()'.
       foreachvalue (Executor* executor, utils::copy(framework->executors)) {
         CHECK(executor->state == Executor::REGISTERING ||
               executor->state == Executor::RUNNING ||
@@ -1304,6 +1678,20 @@ void Slave::statusUpdateAcknowledgement(
 }
 
 
+void Slave::statusUpdateAcknowledgements(
+    const StatusUpdateAcknowledgementsMessage& message)
+{
+  foreach (const StatusUpdateAcknowledgementMessage& acknowledgement,
+           message.acknowledgements()) {
+    statusUpdateAcknowledgement(
+        acknowledgement.slave_id(),
+        acknowledgement.framework_id(),
+        acknowledgement.task_id(),
+        acknowledgement.uuid());
+  }
+}
+
+
 void Slave::_statusUpdateAcknowledgement(
     const Future<Try<bool> >& future,
     const TaskID& taskId,
@@ -1452,22 +1840,41 @@ void Slave::registerExecutor(
     case Executor::REGISTERING: {
       executor->state = Executor::RUNNING;
 
+      // The launch pipeline ends at registration: hand the fork
+      // admission slot to the next queued launch.
+      if (executor->forkSlot) {
+        executor->forkSlot = false;
+        forks.release();
+      }
+
       // Save the pid for the executor.
       executor->pid = from;
 
+      // Record the launcher's fetch durations (one line per URI:
+      // '<microseconds> <uri>') into the metrics registry.
+      Try<string> report = os::read(
+          paths::getFetchReportPath(executor->directory));
+      if (report.isSome()) {
+        foreach (const string& line, strings::tokenize(report.get(), "\n")) {
+          vector<string> tokens = strings::tokenize(line, " ");
+          if (!tokens.empty()) {
+            Try<double> us = numify<double>(tokens[0]);
+            if (us.isSome()) {
+              fetchDurations->record(us.get());
+            }
+          }
+        }
+      }
+
+      invalidateState(frameworkId);
+
       if (framework->info.checkpoint()) {
         // TODO(vinod): This checkpointing should be done
         // asynchronously as it is in the fast path of the slave!
 
         // Checkpoint the libprocess pid.
-        string path = paths::getLibprocessPidPath(
-            paths::getMetaRootDir(flags.work_dir),
-            info.id(),
-            executor->frameworkId,
-            executor->id,
-            executor->uuid);
-
-        CHECK_SOME(state::checkpoint(path, executor->pid));
+        CHECK_SOME(state::checkpoint(
+            executor->runPaths.libprocessPid, executor->pid));
       }
 
       // First account for the tasks we're about to start.
@@ -1579,6 +1986,8 @@ void Slave::reregisterExecutor(
 
       executor->pid = from; // Update the pid.
 
+      invalidateState(frameworkId);
+
       // Send re-registration message to the executor.
       ExecutorReregisteredMessage message;
       message.mutable_slave_id()->MergeFrom(info.id());
@@ -1731,6 +2140,8 @@ void Slave::statusUpdate(const StatusUpdate& update)
   stats.tasks[update.status().state()]++;
   stats.validStatusUpdates++;
 
+  invalidateState(update.framework_id());
+
   executor->updateTaskState(status.task_id(), status.state());
   executor->updates.put(status.task_id(), UUID::fromBytes(update.uuid()));
 
@@ -1766,6 +2177,14 @@ void Slave::statusUpdate(const StatusUpdate& update)
 }
 
 
+void Slave::statusUpdates(const StatusUpdatesMessage& message)
+{
+  foreach (const StatusUpdateMessage& forward, message.updates()) {
+    statusUpdate(forward.update());
+  }
+}
+
+
 void Slave::_statusUpdate(
     const Future<Try<Nothing> >& future,
     const StatusUpdate& update,
@@ -1842,20 +2261,45 @@ void Slave::executorMessage(
   }
 
 
-  LOG(INFO) << "Sending message for framework " << frameworkId
-            << " to " << framework->pid;
-
   ExecutorToFrameworkMessage message;
   message.mutable_slave_id()->MergeFrom(slaveId);
   message.mutable_framework_id()->MergeFrom(frameworkId);
   message.mutable_executor_id()->MergeFrom(executorId);
   message.set_data(data);
-  send(framework->pid, message);
+
+  // Send the message directly to the scheduler driver, keeping the
+  // framework data plane off the master. Fall back to routing via
+  // the master when the scheduler's pid is not (yet) known, e.g.,
+  // when the framework was recovered from a checkpoint written
+  // before the scheduler's current incarnation registered;
+  // Master::executorMessage forwards using its current framework
+  // pid.
+  if (framework->pid) {
+    LOG(INFO) << "Sending message for framework " << frameworkId
+              << " to " << framework->pid;
+    send(framework->pid, message);
+  } else {
+    LOG(INFO) << "Sending message for framework " << frameworkId
+              << " via the master " << master;
+    send(master, message);
+  }
 
   stats.validFrameworkMessages++;
 }
 
 
+void Slave::executorMessages(const ExecutorToFrameworkMessagesMessage& message)
+{
+  foreach (const ExecutorToFrameworkMessage& forward, message.messages()) {
+    executorMessage(
+        forward.slave_id(),
+        forward.framework_id(),
+        forward.executor_id(),
+        forward.data());
+  }
+}
+
+
 void Slave::ping(const UPID& from, const string& body)
 {
   send(from, "PONG");
@@ -2067,6 +2511,15 @@ void Slave::executorTerminated(
     case Executor::TERMINATING: {
       executor->state = Executor::TERMINATED;
 
+      // An executor that died before registering still holds its
+      // fork admission slot.
+      if (executor->forkSlot) {
+        executor->forkSlot = false;
+        forks.release();
+      }
+
+      invalidateState(frameworkId);
+
       // Stop monitoring this executor.
       monitor.unwatch(frameworkId, executorId)
         .onAny(lambda::bind(_unwatch, lambda::_1, frameworkId, executorId));
@@ -2219,6 +2672,8 @@ void Slave::remove(Framework* framework, Executor* executor)
 
   framework->destroyExecutor(executor->id);
 
+  invalidateState(framework->id);
+
   // Remove this framework if it has no pending executors and tasks.
   if (framework->executors.empty() && framework->pending.empty()) {
     remove(framework);
@@ -2263,6 +2718,9 @@ void Slave::remove(Framework* framework)
 
   frameworks.erase(framework->id);
 
+  frameworkStateVersions.erase(framework->id);
+  invalidateState();
+
   // Pass ownership of the framework pointer.
   completedFrameworks.push_back(Owned<Framework>(framework));
 
@@ -2489,6 +2947,30 @@ void Slave::_checkDiskUsage(const Future<Try<double> >& usage)
       // scheduled for deletion 'gc_delay' into the future, only directories
       // that are at least 'age' old are deleted.
       gc.prune(Weeks(flags.gc_delay.weeks() - age(use).weeks()));
+
+      // Above the high watermark the age based pruning is too slow
+      // for a churn spike, so evict scheduled directories
+      // immediately (biggest and oldest first, see
+      // GarbageCollector::evict) until usage would drop below the
+      // low watermark.
+      if (use > flags.gc_disk_high_watermark) {
+        Try<uint64_t> total = fs::size();
+
+        if (total.isSome()) {
+          uint64_t bytes = (uint64_t) (
+              (use - flags.gc_disk_low_watermark) * total.get());
+
+          LOG(INFO) << "Disk usage is above the "
+                    << 100 * flags.gc_disk_high_watermark
+                    << "% high watermark; evicting up to "
+                    << bytes << " bytes of scheduled directories";
+
+          gc.evict(bytes)
+            .onAny(defer(self(), &Self::_evicted, params::_1));
+        } else {
+          LOG(WARNING) << "Unable to get disk size: " << total.error();
+        }
+      }
     } else {
       LOG(WARNING) << "Unable to get disk usage: " << result.error();
     }
@@ -2497,6 +2979,25 @@ void Slave::_checkDiskUsage(const Future<Try<double> >& usage)
 }
 
 
+void Slave::_evicted(const Future<uint64_t>& reclaimed)
+{
+  if (reclaimed.isReady()) {
+    // NOTE: Future::get() returns by value, hence the named local.
+    const uint64_t bytes = reclaimed.get();
+
+    LOG(INFO) << "Watermark triggered eviction reclaimed "
+              << bytes << " bytes";
+
+    gcEvictions->increment();
+    gcReclaimedBytes->increment(bytes);
+  } else {
+    LOG(WARNING)
+      << "Watermark triggered eviction failed: "
+      << (reclaimed.isFailed() ? reclaimed.failure() : "future discarded");
+  }
+}
+
+
 Future<Nothing> Slave::recover(bool reconnect, bool safe)
 {
   const string& metaDir = paths::getMetaRootDir(flags.work_dir);
@@ -2510,8 +3011,22 @@ Future<Nothing> Slave::recover(bool reconnect, bool safe)
     return dispatch(isolator, &Isolator::recover, None());
   }
 
-  // First, recover the slave state.
-  Result<SlaveState> state = state::recover(metaDir, safe);
+  // Recover the slave state from the meta directory on the async
+  // pool: on a slave with a deep task history this is seconds of
+  // independent disk I/O, and running it there lets it overlap with
+  // the isolator's initialization (e.g., cgroup hierarchy
+  // validation) instead of serializing behind the event loop.
+  return async(&state::recover, metaDir, safe)
+    .then(defer(self(), &Self::_recoverState, params::_1, reconnect));
+}
+
+
+Future<Nothing> Slave::_recoverState(
+    const Result<SlaveState>& state,
+    bool reconnect)
+{
+  const string& metaDir = paths::getMetaRootDir(flags.work_dir);
+
   if (state.isError()) {
     EXIT(1) << "Failed to recover slave state: " << state.error();
   }
@@ -2542,10 +3057,14 @@ Future<Nothing> Slave::recover(bool reconnect, bool safe)
 
   info = state.get().info.get(); // Recover the slave info.
 
-  // Recover the status update manager, then
-  // the isolator and then the executors.
-  return statusUpdateManager->recover(metaDir, state.get())
-           .then(defer(isolator, &Isolator::recover, state.get()))
+  // Recover the status update manager and the isolator in parallel
+  // (they read disjoint state: status update streams vs. forked pids
+  // and cgroups), and then recover the executors once both are done.
+  list<Future<Nothing> > recoveries;
+  recoveries.push_back(statusUpdateManager->recover(metaDir, state.get()));
+  recoveries.push_back(dispatch(isolator, &Isolator::recover, state.get()));
+
+  return collect(recoveries)
            .then(defer(self(), &Self::_recover, state.get(), reconnect));
 }
 
@@ -2591,6 +3110,8 @@ void Slave::recoverFramework(const FrameworkState& state, bool reconnect)
 
   frameworks[framework->id] = framework;
 
+  invalidateState(framework->id);
+
   // Now recover the executors for this framework.
   foreachvalue (const ExecutorState& executorState, state.executors) {
     Executor* executor = framework->recoverExecutor(executorState);
@@ -2655,6 +3176,39 @@ void Slave::recoverFramework(const FrameworkState& state, bool reconnect)
 }
 
 
+void Slave::invalidateState()
+{
+  stateVersion++;
+}
+
+
+void Slave::invalidateState(const FrameworkID& frameworkId)
+{
+  stateVersion++;
+  frameworkStateVersions[frameworkId]++;
+}
+
+
+void Slave::refreshState()
+{
+  // Always re-render 'stats.json': it is a handful of counters and
+  // its 'uptime' field advances with the clock.
+  const string& stats = http::json::renderStats(*this);
+
+  // Only re-render 'state.json' when a state transition has occurred
+  // since the last rendering; even then the fragments of unchanged
+  // frameworks are reused (see renderState).
+  if (renderedState.isNone() || renderedStateVersion != stateVersion) {
+    renderedState = http::json::renderState(*this);
+    renderedStateVersion = stateVersion;
+  }
+
+  dispatch(
+      stateServer, &StateServerProcess::update, stats, renderedState.get());
+
+  delay(STATE_REFRESH_INTERVAL, self(), &Slave::refreshState);
+}
+
 
 Framework::Framework(
     Slave* _slave,
@@ -2707,8 +3261,12 @@ Executor* Framework::launchExecutor(const ExecutorInfo& executorInfo)
   // directory.
   UUID uuid = UUID::random();
 
-  // Create a directory for the executor.
-  const string& directory = paths::createExecutorDirectory(
+  // Compute the sandbox path up front (pure string work); the disk
+  // work of provisioning the directory runs on the worker pool and
+  // the launch continues in Slave::_launchExecutor once the sandbox
+  // exists, keeping mkdir chains and symlink creation off the
+  // slave's event loop during launch bursts.
+  const string directory = paths::getExecutorRunPath(
       slave->flags.work_dir,
       slave->info.id(),
       id,
@@ -2723,22 +3281,15 @@ Executor* Framework::launchExecutor(const ExecutorInfo& executorInfo)
 
   CHECK_NOTNULL(executor);
 
-  slave->files->attach(executor->directory, executor->directory)
+  // Admission into the provisioning phase (see Slave::provisions):
+  // a burst of launches would otherwise start all of its sandbox
+  // disk work at once.
+  slave->provisions.acquire()
     .onAny(defer(slave,
-                 &Slave::fileAttached,
-                 params::_1,
-                 executor->directory));
-
-  // Tell the isolator to launch the executor.
-  dispatch(slave->isolator,
-           &Isolator::launchExecutor,
-           slave->info.id(),
-           id,
-           info,
-           executor->info,
-           executor->uuid,
-           executor->directory,
-           executor->resources);
+                 &Slave::provisionExecutor,
+                 id,
+                 executorInfo.executor_id(),
+                 uuid));
 
   // Make sure the executor registers within the given timeout.
   delay(slave->flags.executor_registration_timeout,
@@ -2880,7 +3431,14 @@ Executor::Executor(
     uuid(_uuid),
     directory(_directory),
     checkpoint(_checkpoint),
+    runPaths(
+        paths::getMetaRootDir(_slave->flags.work_dir),
+        _slave->info.id(),
+        _frameworkId,
+        _info.executor_id(),
+        _uuid),
     pid(UPID()),
+    forkSlot(false),
     resources(_info.resources()),
     completedTasks(MAX_COMPLETED_TASKS_PER_EXECUTOR)
 {
@@ -2956,13 +3514,7 @@ void Executor::checkpointTask(const TaskInfo& task)
   if (checkpoint) {
     CHECK_NOTNULL(slave);
 
-    const string& path = paths::getTaskInfoPath(
-        paths::getMetaRootDir(slave->flags.work_dir),
-        slave->info.id(),
-        frameworkId,
-        id,
-        uuid,
-        task.task_id());
+    const string& path = runPaths.taskInfo(task.task_id());
 
     const Task& t = protobuf::createTask(
         task, TASK_STAGING, id, frameworkId);
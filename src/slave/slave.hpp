@@ -20,6 +20,7 @@
 #define __SLAVE_HPP__
 
 #include <list>
+#include <queue>
 #include <string>
 #include <vector>
 
@@ -31,12 +32,14 @@
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 
+#include <stout/densehashmap.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/multihashmap.hpp>
 #include <stout/os.hpp>
 #include <stout/owned.hpp>
 #include <stout/path.hpp>
+#include <stout/result.hpp>
 #include <stout/uuid.hpp>
 
 #include "slave/constants.hpp"
@@ -49,6 +52,7 @@
 #include "slave/state.hpp"
 
 #include "common/attributes.hpp"
+#include "common/metrics.hpp"
 #include "common/protobuf_utils.hpp"
 #include "common/resources.hpp"
 #include "common/type_utils.hpp"
@@ -70,6 +74,56 @@ struct Executor;
 struct Framework;
 
 
+// Bounds the number of operations concurrently admitted into one
+// phase of the executor launch pipeline, queueing the excess in FIFO
+// order: when the allocator places a burst of tasks on the slave,
+// running the disk and fork heavy launch work in modest batches
+// sustains a higher launch rate than starting everything at once.
+// Only used from within the slave process, so no synchronization is
+// needed. A limit of zero admits everything immediately.
+class Admission
+{
+public:
+  explicit Admission(int _limit = 0) : limit(_limit), active(0) {}
+
+  // Returns a future that becomes ready once a slot is available
+  // (immediately while under the limit). The caller must release()
+  // the slot when its phase completes.
+  process::Future<Nothing> acquire()
+  {
+    if (limit <= 0 || active < limit) {
+      active++;
+      return Nothing();
+    }
+
+    Owned<process::Promise<Nothing> > promise(
+        new process::Promise<Nothing>());
+    waiters.push(promise);
+    return promise->future();
+  }
+
+  // Releases a slot, admitting the next waiter (if any).
+  void release()
+  {
+    CHECK(active > 0);
+
+    if (!waiters.empty()) {
+      // The slot passes directly to the next waiter.
+      Owned<process::Promise<Nothing> > promise = waiters.front();
+      waiters.pop();
+      promise->set(Nothing());
+    } else {
+      active--;
+    }
+  }
+
+private:
+  int limit;
+  int active;
+  std::queue<Owned<process::Promise<Nothing> > > waiters;
+};
+
+
 class Slave : public ProtobufProcess<Slave>
 {
 public:
@@ -92,20 +146,60 @@ public:
   void masterDetectionFailure();
   void registered(const SlaveID& slaveId);
   void reregistered(const SlaveID& slaveId);
+
+  // Invoked when the master, in response to a digest-only
+  // re-registration, requests the full executor and task state of
+  // the given frameworks (all frameworks when empty).
+  void reregisterRequested(
+      const SlaveID& slaveId,
+      const std::vector<FrameworkID>& frameworkIds);
   void doReliableRegistration();
 
+  // Handler for the (legacy) per-task launch message; forwards to
+  // 'runTasks' with a batch of one.
   void runTask(
       const FrameworkInfo& frameworkInfo,
       const FrameworkID& frameworkId,
       const std::string& pid,
       const TaskInfo& task);
 
-  void _runTask(
+  void runTasks(const RunTasksMessage& message);
+
+  // Runs a batch of co-scheduled tasks of a framework, doing the
+  // framework and executor bookkeeping once for the batch rather
+  // than once per task.
+  void runTasks(
+      const FrameworkInfo& frameworkInfo,
+      const FrameworkID& frameworkId,
+      const std::string& pid,
+      const std::vector<TaskInfo>& tasks);
+
+  void _runTasks(
       const Future<bool>& future,
       const FrameworkInfo& frameworkInfo,
       const FrameworkID& frameworkId,
       const std::string& pid,
-      const TaskInfo& task);
+      const std::vector<TaskInfo>& tasks);
+
+  // Continuation of Framework::launchExecutor, invoked once the
+  // launch has been admitted into the provisioning phase (see
+  // 'provisions'); runs the sandbox disk work on the worker pool.
+  void provisionExecutor(
+      const FrameworkID& frameworkId,
+      const ExecutorID& executorId,
+      const UUID& uuid);
+
+  // Invoked once the executor's sandbox has been provisioned.
+  void _launchExecutor(
+      const FrameworkID& frameworkId,
+      const ExecutorID& executorId,
+      const Future<Try<Nothing> >& provisioned);
+
+  // Invoked once the launch has been admitted into the fork phase
+  // (see 'forks'); hands the executor to the isolator.
+  void forkExecutor(
+      const FrameworkID& frameworkId,
+      const ExecutorID& executorId);
 
   Future<bool> unschedule(const std::string& path);
 
@@ -137,11 +231,19 @@ public:
       const ExecutorID& executorId,
       const std::string& data);
 
+  // Unpacks a batch of framework messages coalesced by the executor
+  // driver, see ExecutorProcess::sendFrameworkMessage.
+  void executorMessages(const ExecutorToFrameworkMessagesMessage& message);
+
   void ping(const UPID& from, const std::string& body);
 
   // Handles the status update.
   void statusUpdate(const StatusUpdate& update);
 
+  // Unpacks a batch of status updates coalesced by the executor
+  // driver, see ExecutorProcess::sendStatusUpdate.
+  void statusUpdates(const StatusUpdatesMessage& message);
+
   // This is called when the status update manager finishes
   // handling the update. If the handling is successful, an
   // acknowledgment is sent to the executor.
@@ -162,6 +264,12 @@ public:
       const FrameworkID& frameworkId,
       const UUID& uuid);
 
+  // Unpacks a batch of status update acknowledgements coalesced by
+  // the scheduler driver, see
+  // SchedulerProcess::statusUpdateAcknowledgement.
+  void statusUpdateAcknowledgements(
+      const StatusUpdateAcknowledgementsMessage& message);
+
   void executorStarted(
       const FrameworkID& frameworkId,
       const ExecutorID& executorId,
@@ -183,6 +291,10 @@ public:
   // and os calls.
   void _checkDiskUsage(const Future<Try<double> >& capacity);
 
+  // Invoked when a watermark triggered eviction pass finishes, to
+  // record the reclaimed bytes in the metrics registry.
+  void _evicted(const Future<uint64_t>& reclaimed);
+
   // Shut down an executor. This is a two phase process. First, an
   // executor receives a shut down message (shut down phase), then
   // after a configurable timeout the slave actually forces a kill
@@ -244,6 +356,13 @@ protected:
   // live executors. Otherwise, the slave attempts to shutdown/kill them.
   // If 'safe' is true, any recovery errors are considered fatal.
   Future<Nothing> recover(bool reconnect, bool safe);
+
+  // Continuation of 'recover', invoked once the checkpointed state
+  // has been read (off the event loop, see recover).
+  Future<Nothing> _recoverState(
+      const Result<state::SlaveState>& state,
+      bool reconnect);
+
   Future<Nothing> _recover(const state::SlaveState& state, bool reconnect);
 
   // Helper to recover a framework from the specified state.
@@ -274,6 +393,10 @@ private:
       const Slave& slave,
       const process::http::Request& request);
 
+  friend std::string http::json::renderStats(const Slave& slave);
+
+  friend std::string http::json::renderState(const Slave& slave);
+
   friend class Framework;
   friend class Executor;
 
@@ -288,7 +411,7 @@ private:
   Resources resources;
   Attributes attributes;
 
-  hashmap<FrameworkID, Framework*> frameworks;
+  densehashmap<FrameworkID, Framework*> frameworks;
 
   boost::circular_buffer<Owned<Framework> > completedFrameworks;
 
@@ -304,19 +427,84 @@ private:
     uint64_t invalidFrameworkMessages;
   } stats;
 
+  // Operational metrics (see common/metrics.hpp), rendered by
+  // '/slave/stats.json'. The fetch durations are reported by the
+  // executor launcher through a file in the sandbox (see
+  // paths::getFetchReportPath) and recorded when the executor
+  // registers.
+  metrics::Registry metrics;
+  metrics::Histogram* fetchDurations;
+
+  // Watermark triggered garbage collection (see _checkDiskUsage):
+  // the number of eviction passes and the bytes they reclaimed.
+  metrics::Counter* gcEvictions;
+  metrics::Counter* gcReclaimedBytes;
+
   double startTime;
 
   GarbageCollector gc;
   ResourceMonitor monitor;
 
+  // Admission gates for the executor launch pipeline (see
+  // Framework::launchExecutor): 'provisions' bounds concurrent
+  // sandbox provisioning and 'forks' bounds concurrent executors
+  // between fork and registration (the window in which the launcher
+  // fetches the executor's URIs).
+  Admission provisions;
+  Admission forks;
+
   StatusUpdateManager* statusUpdateManager;
 
   // Flag to indicate if recovery, including reconciling (i.e., reconnect/kill)
   // with executors is finished.
   Promise<Nothing> recovered;
 
+  // Set once the master has requested full re-registration state
+  // (for the contained frameworks; empty means all). While unset,
+  // doReliableRegistration() sends only per-framework digests. Reset
+  // on successful re-registration so the next one starts with digest
+  // negotiation again.
+  Option<hashset<FrameworkID> > reregisterFrameworks;
+
   // Root meta directory containing checkpointed data.
   const std::string metaDir;
+
+  // Serves 'stats.json' and 'state.json' polls from pre-rendered
+  // snapshots so that monitoring load never contends with task
+  // management on this process (see slave/http.hpp).
+  StateServerProcess* stateServer;
+
+  // Invalidates cached renderings of 'state.json', for a state
+  // transition that touches a single framework or (without an
+  // argument) global state such as the slave id or the master.
+  // This mirrors Master::invalidateState.
+  void invalidateState();
+  void invalidateState(const FrameworkID& frameworkId);
+
+  // Pushes freshly rendered snapshots to the state server and
+  // re-schedules itself, at most once per STATE_REFRESH_INTERVAL.
+  // 'state.json' is only re-rendered when a state transition has
+  // occurred, and even then unchanged framework fragments are reused.
+  void refreshState();
+
+  // Bumped by invalidateState() on every state transition affecting
+  // the contents of 'state.json'.
+  uint64_t stateVersion;
+
+  // Per-framework versions, bumped when a transition touches the
+  // framework, so that only its fragment needs re-rendering.
+  hashmap<FrameworkID, uint64_t> frameworkStateVersions;
+
+  // The 'state.json' rendering pushed to the state server, and the
+  // version it was rendered at.
+  Option<std::string> renderedState;
+  uint64_t renderedStateVersion;
+
+  // Fragment cache, written by the (const) rendering functions in
+  // slave/http.cpp; mutable since caching doesn't change the
+  // observable state.
+  mutable hashmap<FrameworkID, uint64_t> renderedFrameworkVersions;
+  mutable hashmap<FrameworkID, std::string> renderedFrameworks;
 };
 
 
@@ -362,12 +550,22 @@ struct Executor
 
   const bool checkpoint;
 
+  // Path layout of this run in the meta directory, formatted once at
+  // launch so that checkpointing (task infos, pids) only does string
+  // concatenation.
+  const paths::RunPaths runPaths;
+
   UPID pid;
 
+  // Whether this executor currently holds a fork admission slot
+  // (acquired in Slave::forkExecutor, released on registration or
+  // termination, whichever comes first).
+  bool forkSlot;
+
   Resources resources; // Currently consumed resources.
 
-  hashmap<TaskID, TaskInfo> queuedTasks;
-  hashmap<TaskID, Task*> launchedTasks;
+  densehashmap<TaskID, TaskInfo> queuedTasks;
+  densehashmap<TaskID, Task*> launchedTasks;
 
   multihashmap<TaskID, UUID> updates; // Pending updates.
 
@@ -414,7 +612,7 @@ struct Framework
   multihashmap<ExecutorID, TaskID> pending; // Executors with pending tasks.
 
   // Current running executors.
-  hashmap<ExecutorID, Executor*> executors;
+  densehashmap<ExecutorID, Executor*> executors;
 
   // Up to MAX_COMPLETED_EXECUTORS_PER_FRAMEWORK completed executors.
   boost::circular_buffer<Owned<Executor> > completedExecutors;
@@ -3,7 +3,12 @@
 #include <glog/logging.h>
 
 #include <iostream>
+#include <vector>
 
+#include <tr1/functional>
+
+#include <process/async.hpp>
+#include <process/future.hpp>
 #include <process/pid.hpp>
 
 #include <stout/error.hpp>
@@ -15,6 +20,8 @@
 #include <stout/protobuf.hpp>
 #include <stout/try.hpp>
 
+#include "common/records.hpp"
+
 #include "slave/paths.hpp"
 #include "slave/state.hpp"
 
@@ -171,20 +178,47 @@ Try<FrameworkState> FrameworkState::recover(
         ": " + executors.error());
   }
 
-   // Recover the executors.
+  // Recover the executors, fanning the subtree reads (runs, tasks,
+  // status update files) out across the async pool so that recovery
+  // time is bound by disk parallelism rather than by the total number
+  // of checkpointed files. NOTE: The await below blocks the calling
+  // thread, so the fan out happens at exactly one level (frameworks
+  // are recovered sequentially); nesting blocking waits inside async
+  // functions could exhaust the worker threads.
+  std::vector<ExecutorID> executorIds;
+  std::vector<process::Future<Try<ExecutorState> > > futures;
+
   foreach (const string& path, executors.get()) {
     ExecutorID executorId;
     executorId.set_value(os::basename(path).get());
 
-    const Try<ExecutorState>& executor =
-      ExecutorState::recover(rootDir, slaveId, frameworkId, executorId, safe);
+    executorIds.push_back(executorId);
+    futures.push_back(process::async(std::tr1::bind(
+        &ExecutorState::recover,
+        rootDir,
+        slaveId,
+        frameworkId,
+        executorId,
+        safe)));
+  }
+
+  for (size_t i = 0; i < futures.size(); i++) {
+    futures[i].await();
+
+    if (!futures[i].isReady()) {
+      return Error(
+          "Failed to recover executor " + executorIds[i].value() + ": " +
+          (futures[i].isFailed() ? futures[i].failure() : "discarded"));
+    }
+
+    const Try<ExecutorState>& executor = futures[i].get();
 
     if (executor.isError()) {
-      return Error("Failed to recover executor " + executorId.value() +
+      return Error("Failed to recover executor " + executorIds[i].value() +
                    ": " + executor.error());
     }
 
-    state.executors[executorId] = executor.get();
+    state.executors[executorIds[i]] = executor.get();
   }
 
   return state;
@@ -295,15 +329,13 @@ Try<RunState> RunState::recover(
   state.id = uuid;
   string message;
 
+  // Format the run's path layout once; everything below (and the
+  // per-task recovery) derives paths from it by concatenation.
+  const paths::RunPaths runPaths(
+      rootDir, slaveId, frameworkId, executorId, uuid);
+
   // Find the tasks.
-  const Try<list<string> >& tasks = os::glob(strings::format(
-      paths::TASK_PATH,
-      rootDir,
-      slaveId,
-      frameworkId,
-      executorId,
-      uuid.toString(),
-      "*").get());
+  const Try<list<string> >& tasks = os::glob(runPaths.tasks + "/*");
 
   if (tasks.isError()) {
     return Error("Failed to find tasks for executor run " + uuid.toString() +
@@ -315,8 +347,7 @@ Try<RunState> RunState::recover(
     TaskID taskId;
     taskId.set_value(os::basename(path).get());
 
-    const Try<TaskState>& task = TaskState::recover(
-        rootDir, slaveId, frameworkId, executorId, uuid, taskId, safe);
+    const Try<TaskState>& task = TaskState::recover(runPaths, taskId, safe);
 
     if (task.isError()) {
       return Error(
@@ -327,8 +358,7 @@ Try<RunState> RunState::recover(
   }
 
   // Read the forked pid.
-  string path = paths::getForkedPidPath(
-      rootDir, slaveId, frameworkId, executorId, uuid);
+  string path = runPaths.forkedPid;
 
   Try<string> pid = os::read(path);
 
@@ -353,8 +383,7 @@ Try<RunState> RunState::recover(
   state.forkedPid = forkedPid.get();
 
   // Read the libprocess pid.
-  path = paths::getLibprocessPidPath(
-      rootDir, slaveId, frameworkId, executorId, uuid);
+  path = runPaths.libprocessPid;
 
   pid = os::read(path);
 
@@ -377,11 +406,7 @@ Try<RunState> RunState::recover(
 
 
 Try<TaskState> TaskState::recover(
-    const string& rootDir,
-    const SlaveID& slaveId,
-    const FrameworkID& frameworkId,
-    const ExecutorID& executorId,
-    const UUID& uuid,
+    const paths::RunPaths& runPaths,
     const TaskID& taskId,
     bool safe)
 {
@@ -390,8 +415,7 @@ Try<TaskState> TaskState::recover(
   string message;
 
   // Read the task info.
-  string path = paths::getTaskInfoPath(
-      rootDir, slaveId, frameworkId, executorId, uuid, taskId);
+  string path = runPaths.taskInfo(taskId);
 
   const Result<Task>& task = ::protobuf::read<Task>(path);
 
@@ -410,8 +434,7 @@ Try<TaskState> TaskState::recover(
   state.info = task.get();
 
   // Read the status updates.
-  path = paths::getTaskUpdatesPath(
-      rootDir, slaveId, frameworkId, executorId, uuid, taskId);
+  path = runPaths.taskUpdates(taskId);
 
   // Open the status updates file for reading and writing (for truncating).
   const Try<int>& fd = os::open(path, O_RDWR);
@@ -428,39 +451,103 @@ Try<TaskState> TaskState::recover(
     }
   }
 
-  // Now, read the updates.
-  Result<StatusUpdateRecord> record = None();
-  while (true) {
-    record = ::protobuf::read<StatusUpdateRecord>(fd.get());
+  // Now, read the updates. Newer slaves checkpoint updates in the
+  // framed (checksummed) stream format of common/records.hpp, which
+  // is replayed by mmap(2)ing the file; files checkpointed by older
+  // slaves are plain ::protobuf::write() streams.
+  if (records::framed(path)) {
+    Try<records::Reader*> open = records::Reader::open(path);
 
-    if (!record.isSome()) {
-      break;
+    if (open.isError()) {
+      message = "Failed to open status updates file '" + path +
+                "' for replay: " + open.error();
+
+      if (safe) {
+        return Error(message);
+      } else {
+        LOG(WARNING) << message;
+        return state;
+      }
     }
 
-    if (record.get().type() == StatusUpdateRecord::UPDATE) {
-      state.updates.push_back(record.get().update());
-    } else {
-      state.acks.insert(UUID::fromBytes(record.get().uuid()));
+    records::Reader* reader = open.get();
+
+    Result<StatusUpdateRecord> record = None();
+    while (true) {
+      record = reader->read<StatusUpdateRecord>();
+
+      if (!record.isSome()) {
+        break;
+      }
+
+      if (record.get().type() == StatusUpdateRecord::UPDATE) {
+        state.updates.push_back(record.get().update());
+      } else {
+        state.acks.insert(UUID::fromBytes(record.get().uuid()));
+      }
     }
-  }
 
-  // After reading a non-corrupted updates file, 'record' should be 'none'.
-  if (record.isError()) {
-    message = "Failed to read status updates file  '" + path +
-              "': " + record.error();
+    // An error here means the tail of the file is torn or corrupt
+    // (e.g., the slave lost power mid-write); everything before it
+    // has been checksummed and replayed.
+    if (record.isError()) {
+      message = "Failed to replay status updates file '" + path +
+                "': " + record.error();
 
-    if (safe) {
-      return Error(message);
-    } else {
-      LOG(WARNING) << message;
+      if (safe) {
+        delete reader;
+        return Error(message);
+      } else {
+        LOG(WARNING) << message;
 
-      // Truncate the file to contain only valid updates.
-      if (ftruncate(fd.get(), lseek(fd.get(), 0, SEEK_CUR)) != 0) {
-        return ErrnoError(
-            "Failed to truncate status updates file '" + path + "'");
+        // Truncate the torn tail, so that subsequent appends leave a
+        // well formed stream.
+        if (ftruncate(fd.get(), reader->offset()) != 0) {
+          delete reader;
+          return ErrnoError(
+              "Failed to truncate status updates file '" + path + "'");
+        }
+
+        delete reader;
+        return state;
       }
+    }
 
-      return state;
+    delete reader;
+  } else {
+    Result<StatusUpdateRecord> record = None();
+    while (true) {
+      record = ::protobuf::read<StatusUpdateRecord>(fd.get());
+
+      if (!record.isSome()) {
+        break;
+      }
+
+      if (record.get().type() == StatusUpdateRecord::UPDATE) {
+        state.updates.push_back(record.get().update());
+      } else {
+        state.acks.insert(UUID::fromBytes(record.get().uuid()));
+      }
+    }
+
+    // After reading a non-corrupted updates file, 'record' should be 'none'.
+    if (record.isError()) {
+      message = "Failed to read status updates file  '" + path +
+                "': " + record.error();
+
+      if (safe) {
+        return Error(message);
+      } else {
+        LOG(WARNING) << message;
+
+        // Truncate the file to contain only valid updates.
+        if (ftruncate(fd.get(), lseek(fd.get(), 0, SEEK_CUR)) != 0) {
+          return ErrnoError(
+              "Failed to truncate status updates file '" + path + "'");
+        }
+
+        return state;
+      }
     }
   }
 
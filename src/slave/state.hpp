@@ -39,6 +39,8 @@
 
 #include "process/pid.hpp"
 
+#include "slave/paths.hpp"
+
 namespace mesos {
 namespace internal {
 namespace slave {
@@ -123,11 +125,7 @@ struct RunState
 struct TaskState
 {
   static Try<TaskState> recover(
-      const std::string& rootDir,
-      const SlaveID& slaveId,
-      const FrameworkID& frameworkId,
-      const ExecutorID& executorId,
-      const UUID& uuid,
+      const paths::RunPaths& runPaths,
       const TaskID& taskId,
       bool safe);
 
@@ -16,6 +16,11 @@
  * limitations under the License.
  */
 
+#include <utility>
+#include <vector>
+
+#include <tr1/functional>
+
 #include <process/delay.hpp>
 #include <process/process.hpp>
 #include <process/timer.hpp>
@@ -54,7 +59,7 @@ class StatusUpdateManagerProcess
   : public ProtobufProcess<StatusUpdateManagerProcess>
 {
 public:
-  StatusUpdateManagerProcess() {}
+  StatusUpdateManagerProcess() : flushScheduled(false) {}
   virtual ~StatusUpdateManagerProcess();
 
   // StatusUpdateManager implementation.
@@ -63,17 +68,17 @@ public:
       const Flags& flags,
       const PID<Slave>& slave);
 
-  Try<Nothing> update(
+  Future<Try<Nothing> > update(
       const StatusUpdate& update,
       const SlaveID& slaveId,
       const ExecutorID& executorId,
       const UUID& uuid);
 
-  Try<Nothing> update(
+  Future<Try<Nothing> > update(
       const StatusUpdate& update,
       const SlaveID& slaveId);
 
-  Try<bool> acknowledgement(
+  Future<Try<bool> > acknowledgement(
       const TaskID& taskId,
       const FrameworkID& frameworkId,
       const UUID& uuid);
@@ -86,7 +91,7 @@ public:
 
 private:
   // Helper function to handle update.
-  Try<Nothing> _update(
+  Future<Try<Nothing> > _update(
       const StatusUpdate& update,
       const SlaveID& slaveId,
       bool checkpoint,
@@ -96,6 +101,17 @@ private:
   // Status update timeout.
   void timeout();
 
+  // Group commit: instead of syncing every checkpointed record as it
+  // is written, records are appended to the kernel's buffers and the
+  // dirty files are fsync'ed together once per flush window. The
+  // futures returned from 'update()' and 'acknowledgement()' (and any
+  // deferred forwarding to the master) are completed by 'flush()'
+  // once the records they cover are durable.
+  void flush();
+
+  // Schedules a flush if one isn't already pending.
+  void scheduleFlush();
+
   // Forwards the status update to the master and starts a timer to check
   // for ACK from the scheduler.
   // NOTE: This should only be used for those messages that expect an
@@ -126,11 +142,52 @@ private:
   Flags flags;
   PID<Slave> slave;
   hashmap<FrameworkID, hashmap<TaskID, StatusUpdateStream*> > streams;
+
+  // Per-run path handles, formatted once per executor run and shared
+  // by all of that run's streams, so that creating a stream (and the
+  // checkpointing it does) performs no path formatting. NOTE: Entries
+  // are kept for the lifetime of the slave; they are a handful of
+  // strings per executor run.
+  hashmap<UUID, paths::RunPaths> runPaths;
+
+  // Callbacks (keyed by stream) that complete the futures for
+  // checkpointed records once their stream has been flushed.
+  typedef std::tr1::function<void(const Try<Nothing>&)> Completion;
+  std::vector<std::pair<StatusUpdateStream*, Completion> > completions;
+  bool flushScheduled;
 };
 
 
+namespace {
+
+// Completes (and cleans up) the promise for a checkpointed update or
+// acknowledgement, propagating a failed flush as an error.
+template <typename T>
+void complete(
+    process::Promise<T>* promise,
+    const T& value,
+    const Try<Nothing>& flush)
+{
+  if (flush.isError()) {
+    promise->set(T(Error(flush.error())));
+  } else {
+    promise->set(value);
+  }
+  delete promise;
+}
+
+} // namespace {
+
+
 StatusUpdateManagerProcess::~StatusUpdateManagerProcess()
 {
+  // Complete any futures still waiting on a flush.
+  typedef std::pair<StatusUpdateStream*, Completion> Pending;
+  foreach (const Pending& pending, completions) {
+    pending.second(pending.first->flush());
+  }
+  completions.clear();
+
   foreachkey (const FrameworkID& frameworkId, streams) {
     foreachvalue (StatusUpdateStream* stream, streams[frameworkId]) {
       delete stream;
@@ -159,7 +216,9 @@ void StatusUpdateManagerProcess::newMasterDetected(const UPID& pid)
   // no master elected (e.g., during recovery).
   foreachkey (const FrameworkID& frameworkId, streams) {
     foreachvalue (StatusUpdateStream* stream, streams[frameworkId]) {
-      if (!stream->pending.empty()) {
+      // NOTE: Updates still waiting on a group commit flush (no
+      // timeout set) are forwarded by 'flush()' instead.
+      if (!stream->pending.empty() && stream->timeout.isSome()) {
         const StatusUpdate& update = stream->pending.front();
         LOG(WARNING) << "Resending status update " << update;
         stream->timeout = forward(update);
@@ -258,7 +317,7 @@ void StatusUpdateManagerProcess::cleanup(const FrameworkID& frameworkId)
 }
 
 
-Try<Nothing> StatusUpdateManagerProcess::update(
+Future<Try<Nothing> > StatusUpdateManagerProcess::update(
     const StatusUpdate& update,
     const SlaveID& slaveId,
     const ExecutorID& executorId,
@@ -268,7 +327,7 @@ Try<Nothing> StatusUpdateManagerProcess::update(
 }
 
 
-Try<Nothing> StatusUpdateManagerProcess::update(
+Future<Try<Nothing> > StatusUpdateManagerProcess::update(
     const StatusUpdate& update,
     const SlaveID& slaveId)
 {
@@ -276,7 +335,7 @@ Try<Nothing> StatusUpdateManagerProcess::update(
 }
 
 
-Try<Nothing> StatusUpdateManagerProcess::_update(
+Future<Try<Nothing> > StatusUpdateManagerProcess::_update(
     const StatusUpdate& update,
     const SlaveID& slaveId,
     bool checkpoint,
@@ -300,32 +359,114 @@ Try<Nothing> StatusUpdateManagerProcess::_update(
   // Verify that we didn't get a non-checkpointable update for a
   // stream that is checkpointable, and vice-versa.
   if (stream->checkpoint != checkpoint) {
-    return Error(
+    return Try<Nothing>(Error(
         "Mismatched checkpoint value for status update " + stringify(update) +
         " (expected checkpoint=" + stringify(stream->checkpoint) +
-        " actual checkpoint=" + stringify(checkpoint) + ")");
+        " actual checkpoint=" + stringify(checkpoint) + ")"));
   }
 
+  // Recognize a retransmitted update up front (the stream's UUID
+  // index makes this O(1)), so that it can be answered from the
+  // existing record below without touching disk.
+  const bool duplicate = stream->duplicate(update);
+
   // Handle the status update.
   Try<Nothing> result = stream->update(update);
   if (result.isError()) {
     return result;
   }
 
-  // Forward the status update to the master if this is the first in the stream.
-  // Subsequent status updates will get sent in 'acknowledgement()'.
-  if (stream->pending.size() == 1) {
-    CHECK(stream->timeout.isNone());
-    const Result<StatusUpdate>& next = stream->next();
-    if (next.isError()) {
-      return Error(next.error());
+  if (!checkpoint) {
+    // Forward the status update to the master if this is the first in
+    // the stream. Subsequent status updates will get sent in
+    // 'acknowledgement()'. A retransmission is never forwarded: its
+    // original is either already in flight or queued behind others.
+    if (!duplicate && stream->pending.size() == 1) {
+      CHECK(stream->timeout.isNone());
+      const Result<StatusUpdate>& next = stream->next();
+      if (next.isError()) {
+        return Try<Nothing>(Error(next.error()));
+      }
+
+      CHECK_SOME(next);
+      stream->timeout = forward(next.get());
     }
 
-    CHECK_SOME(next);
-    stream->timeout = forward(next.get());
+    return result;
   }
 
-  return Nothing();
+  // A retransmission whose original record is already durable needs
+  // no further work: nothing was written (the stream ignored it) and
+  // the head of the stream is already in flight, so answer right away
+  // instead of allocating a promise and scheduling a flush for a
+  // write that never happened. A retransmission that arrives while
+  // the original record still awaits its group commit falls through
+  // and is answered by the flush that covers the original.
+  if (duplicate && stream->flushed()) {
+    return result;
+  }
+
+  // Group commit: the record has been appended but is not yet
+  // durable. Complete the returned future once the batched flush
+  // happens; the update (if it is the head of the stream) is also
+  // forwarded to the master by 'flush()', preserving the invariant
+  // that an update is checkpointed before it is put on the wire.
+  Promise<Try<Nothing> >* promise = new Promise<Try<Nothing> >();
+  Future<Try<Nothing> > future = promise->future();
+
+  completions.push_back(std::make_pair(
+      stream,
+      Completion(std::tr1::bind(
+          &complete<Try<Nothing> >,
+          promise,
+          Try<Nothing>(Nothing()),
+          std::tr1::placeholders::_1))));
+
+  scheduleFlush();
+
+  return future;
+}
+
+
+void StatusUpdateManagerProcess::scheduleFlush()
+{
+  if (!flushScheduled) {
+    flushScheduled = true;
+    delay(STATUS_UPDATE_FLUSH_INTERVAL,
+          self(),
+          &StatusUpdateManagerProcess::flush);
+  }
+}
+
+
+void StatusUpdateManagerProcess::flush()
+{
+  flushScheduled = false;
+
+  std::vector<std::pair<StatusUpdateStream*, Completion> > batch;
+  std::swap(batch, completions);
+
+  // One fsync per file covers every record appended to it within
+  // this window (StatusUpdateStream::flush() is a no-op after the
+  // first call for a given stream).
+  hashset<StatusUpdateStream*> flushed;
+
+  typedef std::pair<StatusUpdateStream*, Completion> Pending;
+  foreach (const Pending& pending, batch) {
+    pending.second(pending.first->flush());
+    flushed.insert(pending.first);
+  }
+
+  // Now that the records are durable it is safe to put the head of
+  // each stream on the wire, if it isn't in flight already.
+  foreach (StatusUpdateStream* stream, flushed) {
+    if (stream->timeout.isNone() && !stream->pending.empty()) {
+      const Result<StatusUpdate>& next = stream->next();
+      if (next.isSome()) {
+        stream->timeout = forward(next.get());
+      }
+    }
+  }
 }
 
 
@@ -352,7 +493,7 @@ Timeout StatusUpdateManagerProcess::forward(const StatusUpdate& update)
 }
 
 
-Try<bool> StatusUpdateManagerProcess::acknowledgement(
+Future<Try<bool> > StatusUpdateManagerProcess::acknowledgement(
     const TaskID& taskId,
     const FrameworkID& frameworkId,
     const UUID& uuid)
@@ -366,15 +507,15 @@ Try<bool> StatusUpdateManagerProcess::acknowledgement(
   // This might happen if we haven't completed recovery yet or if the
   // acknowledgement is for a stream that has been cleaned up.
   if (stream == NULL) {
-    return Error(
+    return Try<bool>(Error(
         "Cannot find the status update stream for task " + stringify(taskId) +
-        " of framework " + stringify(frameworkId));
+        " of framework " + stringify(frameworkId)));
   }
 
   // Get the corresponding update for this ACK.
   const Result<StatusUpdate>& update = stream->next();
   if (update.isError()) {
-    return Error(update.error());
+    return Try<bool>(Error(update.error()));
   }
 
   // This might happen if we retried a status update and got back
@@ -383,7 +524,7 @@ Try<bool> StatusUpdateManagerProcess::acknowledgement(
     LOG(WARNING) << "Ignoring unexpected status update acknowledgment " << uuid
                  << " for task " << taskId
                  << " of framework " << frameworkId;
-    return false;
+    return Try<bool>(false);
   }
 
   // Handle the acknowledgement.
@@ -397,25 +538,58 @@ Try<bool> StatusUpdateManagerProcess::acknowledgement(
   // Reset the timeout.
   stream->timeout = None();
 
-  // Get the next update in the queue.
-  const Result<StatusUpdate>& next = stream->next();
-  if (next.isError()) {
-    return Error(next.error());
+  if (!stream->checkpoint) {
+    // Get the next update in the queue.
+    const Result<StatusUpdate>& next = stream->next();
+    if (next.isError()) {
+      return Try<bool>(Error(next.error()));
+    }
+
+    if (stream->terminated) {
+      if (next.isSome()) {
+        LOG(WARNING) << "Acknowledged a terminal"
+                     << " status update " << update.get()
+                     << " but updates are still pending";
+      }
+      cleanupStatusUpdateStream(taskId, frameworkId);
+    } else if (next.isSome()) {
+      // Forward the next queued status update.
+      stream->timeout = forward(next.get());
+    }
+
+    return Try<bool>(true);
   }
 
+  // Group commit: complete the returned future once the ACK record is
+  // durable.
+  Promise<Try<bool> >* promise = new Promise<Try<bool> >();
+  Future<Try<bool> > future = promise->future();
+
+  completions.push_back(std::make_pair(
+      stream,
+      Completion(std::tr1::bind(
+          &complete<Try<bool> >,
+          promise,
+          Try<bool>(true),
+          std::tr1::placeholders::_1))));
+
   if (stream->terminated) {
-    if (next.isSome()) {
+    if (!stream->pending.empty()) {
       LOG(WARNING) << "Acknowledged a terminal"
                    << " status update " << update.get()
                    << " but updates are still pending";
     }
+
+    // Flushes this stream's records and completes their futures
+    // before its file descriptor goes away.
     cleanupStatusUpdateStream(taskId, frameworkId);
-  } else if (next.isSome()) {
-    // Forward the next queued status update.
-    stream->timeout = forward(next.get());
+  } else {
+    // The next queued status update, if any, is forwarded by
+    // 'flush()' once it is durable.
+    scheduleFlush();
   }
 
-  return true;
+  return future;
 }
 
 
@@ -426,13 +600,15 @@ void StatusUpdateManagerProcess::timeout()
   foreachkey (const FrameworkID& frameworkId, streams) {
     foreachvalue (StatusUpdateStream* stream, streams[frameworkId]) {
       CHECK_NOTNULL(stream);
-      if (!stream->pending.empty()) {
-        CHECK(stream->timeout.isSome());
-        if (stream->timeout.get().expired()) {
-          const StatusUpdate& update = stream->pending.front();
-          LOG(WARNING) << "Resending status update " << update;
-          stream->timeout = forward(update);
-        }
+      // NOTE: The timeout is none when the head of the stream is
+      // still waiting on a group commit flush; it gets forwarded (and
+      // a timeout set) by 'flush()'.
+      if (!stream->pending.empty() &&
+          stream->timeout.isSome() &&
+          stream->timeout.get().expired()) {
+        const StatusUpdate& update = stream->pending.front();
+        LOG(WARNING) << "Resending status update " << update;
+        stream->timeout = forward(update);
       }
     }
   }
@@ -450,8 +626,26 @@ StatusUpdateStream* StatusUpdateManagerProcess::createStatusUpdateStream(
   LOG(INFO) << "Creating StatusUpdate stream for task " << taskId
             << " of framework " << frameworkId;
 
+  Option<paths::RunPaths> run = None();
+
+  if (checkpoint) {
+    CHECK_SOME(executorId);
+    CHECK_SOME(uuid);
+
+    if (!runPaths.contains(uuid.get())) {
+      runPaths[uuid.get()] = paths::RunPaths(
+          paths::getMetaRootDir(flags.work_dir),
+          slaveId,
+          frameworkId,
+          executorId.get(),
+          uuid.get());
+    }
+
+    run = runPaths[uuid.get()];
+  }
+
   StatusUpdateStream* stream = new StatusUpdateStream(
-      taskId, frameworkId, slaveId, flags, checkpoint, executorId, uuid);
+      taskId, frameworkId, checkpoint, run);
 
   streams[frameworkId][taskId] = stream;
   return stream;
@@ -495,6 +689,21 @@ void StatusUpdateManagerProcess::cleanupStatusUpdateStream(
     streams.erase(frameworkId);
   }
 
+  // Flush any buffered records and complete the futures waiting on
+  // them before the stream (and its file descriptor) goes away.
+  std::vector<std::pair<StatusUpdateStream*, Completion> > remaining;
+  remaining.reserve(completions.size());
+
+  typedef std::pair<StatusUpdateStream*, Completion> Pending;
+  foreach (const Pending& pending, completions) {
+    if (pending.first == stream) {
+      pending.second(stream->flush());
+    } else {
+      remaining.push_back(pending);
+    }
+  }
+  std::swap(completions, remaining);
+
   delete stream;
 }
 
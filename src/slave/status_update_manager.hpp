@@ -19,6 +19,13 @@
 #ifndef __STATUS_UPDATE_MANAGER_HPP__
 #define __STATUS_UPDATE_MANAGER_HPP__
 
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
 #include <ostream>
 #include <queue>
 #include <string>
@@ -39,6 +46,7 @@
 #include <stout/utils.hpp>
 #include <stout/uuid.hpp>
 
+#include "common/records.hpp"
 #include "common/type_utils.hpp"
 
 #include "logging/logging.hpp"
@@ -46,6 +54,7 @@
 #include "messages/messages.hpp"
 
 #include "slave/flags.hpp"
+#include "slave/paths.hpp"
 
 namespace mesos {
 namespace internal {
@@ -86,7 +95,9 @@ public:
   // Checkpoints the status update and reliably sends the
   // update to the master (and hence the scheduler).
   // @return Whether the update is handled successfully
-  // (e.g. checkpointed).
+  // (e.g. checkpointed). The future is completed once the update has
+  // been durably flushed to disk; updates arriving close together are
+  // flushed as a batch.
   process::Future<Try<Nothing> > update(
       const StatusUpdate& update,
       const SlaveID& slaveId,
@@ -137,30 +148,23 @@ struct StatusUpdateStream
 {
   StatusUpdateStream(const TaskID& _taskId,
                      const FrameworkID& _frameworkId,
-                     const SlaveID& _slaveId,
-                     const Flags& _flags,
                      bool _checkpoint,
-                     const Option<ExecutorID>& executorId,
-                     const Option<UUID>& uuid)
+                     const Option<paths::RunPaths>& runPaths)
     : checkpoint(_checkpoint),
       terminated(false),
       taskId(_taskId),
       frameworkId(_frameworkId),
-      slaveId(_slaveId),
-      flags(_flags),
+      dirty(false),
+      framed(false),
       error(None())
   {
     if (checkpoint) {
-      CHECK_SOME(executorId);
-      CHECK_SOME(uuid);
+      CHECK_SOME(runPaths);
 
-      path = paths::getTaskUpdatesPath(
-          paths::getMetaRootDir(flags.work_dir),
-          slaveId,
-          frameworkId,
-          executorId.get(),
-          uuid.get(),
-          taskId);
+      // The run's path layout was formatted once when the executor
+      // was launched (or recovered); deriving the updates file path
+      // is a concatenation.
+      path = runPaths.get().taskUpdates(taskId);
 
       // Create the base updates directory, if it doesn't exist.
       Try<Nothing> directory = os::mkdir(os::dirname(path.get()).get());
@@ -169,10 +173,14 @@ struct StatusUpdateStream
         return;
       }
 
-      // Open the updates file.
+      // Open the updates file. Note that we deliberately do not use
+      // O_SYNC: records are appended to the kernel's buffers and made
+      // durable in batches by the manager (see
+      // StatusUpdateManagerProcess::flush()), so a burst of updates
+      // costs one fsync per file rather than one per record.
       Try<int> result = os::open(
           path.get(),
-          O_CREAT | O_WRONLY | O_APPEND | O_SYNC,
+          O_CREAT | O_WRONLY | O_APPEND,
           S_IRUSR | S_IWUSR | S_IRGRP | S_IRWXO);
 
       if(result.isError()) {
@@ -183,12 +191,46 @@ struct StatusUpdateStream
       // We keep the file open through the lifetime of the task, because it
       // makes it easy to append status update records to the file.
       fd = result.get();
+
+      // Determine the format of the stream: a new (empty) file gets
+      // the framed (checksummed) format of common/records.hpp, while
+      // an existing file (e.g., reopened across a slave restart) is
+      // appended to in whatever format it was created with.
+      struct stat s;
+      if (::fstat(fd.get(), &s) != 0) {
+        error = "Failed to fstat '" + path.get() + "': " +
+                std::string(strerror(errno));
+        return;
+      }
+
+      if (s.st_size == 0) {
+        Try<Nothing> header = records::header(fd.get());
+        if (header.isError()) {
+          error = "Failed to write stream header to '" + path.get() +
+                  "': " + header.error();
+          return;
+        }
+        framed = true;
+      } else {
+        framed = records::framed(path.get());
+      }
     }
   }
 
   ~StatusUpdateStream()
   {
     if (fd.isSome()) {
+      // Mark a clean close, so that replay can tell a normal shutdown
+      // from a crash that tore the tail of the stream.
+      if (framed && error.isNone()) {
+        Try<Nothing> footer = records::footer(fd.get());
+        if (footer.isError()) {
+          CHECK_SOME(path);
+          LOG(ERROR) << "Failed to write stream footer to '" << path.get()
+                     << "': " << footer.error();
+        }
+      }
+
       Try<Nothing> close = os::close(fd.get());
       if (close.isError()) {
         CHECK_SOME(path);
@@ -261,6 +303,25 @@ struct StatusUpdateStream
     return true;
   }
 
+  // Returns true if this update is a retransmission of one that has
+  // already been received (and checkpointed, if applicable) but whose
+  // acknowledgement has not been seen yet, e.g., because the executor
+  // resent it before our acknowledgement arrived. Such an update can
+  // be answered from the existing record. The 'received' and
+  // 'acknowledged' UUID sets act as the index, so this is O(1).
+  bool duplicate(const StatusUpdate& update) const
+  {
+    const UUID uuid = UUID::fromBytes(update.uuid());
+    return received.contains(uuid) && !acknowledged.contains(uuid);
+  }
+
+  // Whether every record appended to this stream has been durably
+  // flushed (see flush()).
+  bool flushed() const
+  {
+    return !dirty;
+  }
+
   // Returns the next update (or none, if empty) in the queue.
   Result<StatusUpdate> next()
   {
@@ -300,6 +361,29 @@ struct StatusUpdateStream
     return Nothing();
   }
 
+  // Durably flushes any records appended since the last flush. The
+  // manager calls this once per group commit window, covering every
+  // record appended within it, rather than syncing each record as it
+  // is written.
+  Try<Nothing> flush()
+  {
+    if (error.isSome()) {
+      return Error(error.get());
+    }
+
+    if (dirty) {
+      CHECK_SOME(fd);
+      if (fsync(fd.get()) == -1) {
+        error = "Failed to fsync '" + path.get() + "': " +
+                std::string(strerror(errno));
+        return Error(error.get());
+      }
+      dirty = false;
+    }
+
+    return Nothing();
+  }
+
   // TODO(vinod): Explore semantics to make these private.
   const bool checkpoint;
   bool terminated;
@@ -334,12 +418,16 @@ private:
         record.set_uuid(update.uuid());
       }
 
-      Try<Nothing> write = ::protobuf::write(fd.get(), record);
+      Try<Nothing> write = framed
+        ? records::write(fd.get(), record)
+        : ::protobuf::write(fd.get(), record);
       if (write.isError()) {
         error = "Failed to write status update " + stringify(update) +
                 " to '" + path.get() + "': " + write.error();
         return Error(error.get());
       }
+
+      dirty = true; // Flushed by the manager's next group commit.
     }
 
     // Now actually handle the update.
@@ -373,9 +461,6 @@ private:
 
   const TaskID taskId;
   const FrameworkID frameworkId;
-  const SlaveID slaveId;
-
-  const Flags flags;
 
   hashset<UUID> received;
   hashset<UUID> acknowledged;
@@ -383,6 +468,9 @@ private:
   Option<std::string> path; // File path of the update stream.
   Option<int> fd; // File descriptor to the update stream.
 
+  bool dirty; // Whether there are appended records awaiting a flush.
+  bool framed; // Whether the stream uses the format of common/records.hpp.
+
   Option<std::string> error; // Potential non-retryable error.
 };
 
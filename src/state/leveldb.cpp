@@ -1,16 +1,23 @@
 #include <leveldb/db.h>
+#include <leveldb/write_batch.h>
 
 #include <google/protobuf/message.h>
 
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
+#include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/process.hpp>
 
+#include <stout/duration.hpp>
 #include <stout/error.hpp>
+#include <stout/foreach.hpp>
 #include <stout/none.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
 #include <stout/uuid.hpp>
@@ -31,8 +38,10 @@ namespace mesos {
 namespace internal {
 namespace state {
 
-LevelDBStateProcess::LevelDBStateProcess(const string& _path)
-  : path(_path), db(NULL) {}
+LevelDBStateProcess::LevelDBStateProcess(
+    const string& _path,
+    const Duration& _window)
+  : path(_path), window(_window), db(NULL), flushing(false) {}
 
 
 LevelDBStateProcess::~LevelDBStateProcess()
@@ -58,26 +67,45 @@ void LevelDBStateProcess::initialize()
 }
 
 
+void LevelDBStateProcess::finalize()
+{
+  // Make a best effort attempt at getting any batched mutations to
+  // stable storage before terminating.
+  if (error.isNone() && !pending.empty()) {
+    Try<Nothing> flushed = _flush();
+    if (flushed.isError()) {
+      LOG(ERROR) << "Failed to flush batched mutations: " << flushed.error();
+    }
+  }
+}
+
+
 Future<vector<string> > LevelDBStateProcess::names()
 {
   if (error.isSome()) {
     return Future<vector<string> >::failed(error.get());
   }
 
-  vector<string> results;
+  // Use a set so that names that have only been batched (i.e., are
+  // still in 'pending') don't get duplicated.
+  std::set<string> names;
 
   leveldb::Iterator* iterator = db->NewIterator(leveldb::ReadOptions());
 
   iterator->SeekToFirst();
 
   while (iterator->Valid()) {
-    results.push_back(iterator->key().ToString());
+    names.insert(iterator->key().ToString());
     iterator->Next();
   }
 
   delete iterator;
 
-  return results;
+  foreachkey (const string& name, pending) {
+    names.insert(name);
+  }
+
+  return vector<string>(names.begin(), names.end());
 }
 
 
@@ -132,20 +160,46 @@ Future<bool> LevelDBStateProcess::swap(const Entry& entry, const UUID& uuid)
 }
 
 
+Future<bool> LevelDBStateProcess::sync()
+{
+  if (error.isSome()) {
+    return Future<bool>::failed(error.get());
+  }
+
+  if (!pending.empty()) {
+    Try<Nothing> flushed = _flush();
+    if (flushed.isError()) {
+      error = Option<string>::some(flushed.error());
+      return Future<bool>::failed(flushed.error());
+    }
+  }
+
+  return true;
+}
+
+
 Try<Option<Entry> > LevelDBStateProcess::get(const string& name)
 {
   CHECK(error.isNone());
 
-  leveldb::ReadOptions options;
-
   string value;
 
-  leveldb::Status status = db->Get(options, name, &value);
+  // Check the batched mutations first so that a mutation is always
+  // visible to subsequent operations even before it has been flushed.
+  std::map<string, string>::const_iterator batched = pending.find(name);
 
-  if (status.IsNotFound()) {
-    return None();
-  } else if (!status.ok()) {
-    return Error(status.ToString());
+  if (batched != pending.end()) {
+    value = batched->second;
+  } else {
+    leveldb::ReadOptions options;
+
+    leveldb::Status status = db->Get(options, name, &value);
+
+    if (status.IsNotFound()) {
+      return None();
+    } else if (!status.ok()) {
+      return Error(status.ToString());
+    }
   }
 
   google::protobuf::io::ArrayInputStream stream(value.data(), value.size());
@@ -164,15 +218,30 @@ Try<bool> LevelDBStateProcess::put(const Entry& entry)
 {
   CHECK(error.isNone());
 
-  leveldb::WriteOptions options;
-  options.sync = true;
-
   string value;
 
   if (!entry.SerializeToString(&value)) {
     return Error("Failed to serialize Entry");
   }
 
+  // With a flush window we just batch the mutation and let it get
+  // written (and synced) along with any others once the window has
+  // elapsed. Note that this means the mutation is acknowledged before
+  // it is durable; use sync() to force a durability barrier.
+  if (window > Seconds(0.0)) {
+    pending[entry.name()] = value;
+
+    if (!flushing) {
+      flushing = true;
+      delay(window, self(), &LevelDBStateProcess::flush);
+    }
+
+    return true;
+  }
+
+  leveldb::WriteOptions options;
+  options.sync = true;
+
   leveldb::Status status = db->Put(options, entry.name(), value);
 
   if (!status.ok()) {
@@ -182,6 +251,49 @@ Try<bool> LevelDBStateProcess::put(const Entry& entry)
   return true;
 }
 
+
+void LevelDBStateProcess::flush()
+{
+  flushing = false;
+
+  if (error.isSome() || pending.empty()) {
+    return;
+  }
+
+  Try<Nothing> flushed = _flush();
+
+  if (flushed.isError()) {
+    // Fail all subsequent operations rather than silently dropping
+    // mutations that have already been acknowledged.
+    error = Option<string>::some(flushed.error());
+  }
+}
+
+
+Try<Nothing> LevelDBStateProcess::_flush()
+{
+  CHECK(error.isNone());
+
+  leveldb::WriteBatch batch;
+
+  foreachpair (const string& name, const string& value, pending) {
+    batch.Put(name, value);
+  }
+
+  leveldb::WriteOptions options;
+  options.sync = true;
+
+  leveldb::Status status = db->Write(options, &batch);
+
+  if (!status.ok()) {
+    return Error(status.ToString());
+  }
+
+  pending.clear();
+
+  return Nothing();
+}
+
 } // namespace state {
 } // namespace internal {
 } // namespace mesos {
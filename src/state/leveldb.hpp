@@ -1,6 +1,7 @@
 #ifndef __STATE_LEVELDB_HPP__
 #define __STATE_LEVELDB_HPP__
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -8,6 +9,8 @@
 #include <process/future.hpp>
 #include <process/process.hpp>
 
+#include <stout/duration.hpp>
+#include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
 #include <stout/uuid.hpp>
@@ -33,12 +36,25 @@ template <typename Serializer = StringSerializer>
 class LevelDBState : public State<Serializer>
 {
 public:
-  LevelDBState(const std::string& path);
+  // The optionally specified window enables group commit: rather
+  // than each mutation paying its own synchronous write, mutations
+  // get batched and flushed to stable storage together once the
+  // window has elapsed (or when sync() is called). With a window a
+  // mutation returns as soon as it has been batched, so the last
+  // window's worth of writes may be lost on a crash. A window of
+  // zero (the default) synchronously writes every mutation.
+  LevelDBState(
+      const std::string& path,
+      const Duration& window = Seconds(0.0));
   virtual ~LevelDBState();
 
   // State implementation.
   virtual process::Future<std::vector<std::string> > names();
 
+  // Flushes any mutations that have only been batched (see above) to
+  // stable storage. Returns true once they are durable.
+  process::Future<bool> sync();
+
 protected:
   // More State implementation.
   virtual process::Future<Option<Entry> > fetch(const std::string& name);
@@ -52,32 +68,50 @@ private:
 class LevelDBStateProcess : public process::Process<LevelDBStateProcess>
 {
 public:
-  LevelDBStateProcess(const std::string& path);
+  LevelDBStateProcess(const std::string& path, const Duration& window);
   virtual ~LevelDBStateProcess();
 
   virtual void initialize();
+  virtual void finalize();
 
   // State implementation.
   process::Future<std::vector<std::string> > names();
   process::Future<Option<Entry> > fetch(const std::string& name);
   process::Future<bool> swap(const Entry& entry, const UUID& uuid);
 
+  process::Future<bool> sync();
+
 private:
   // Helpers for interacting with leveldb.
   Try<Option<Entry> > get(const std::string& name);
   Try<bool> put(const Entry& entry);
 
+  // Invoked once the flush window has elapsed.
+  void flush();
+
+  // Writes all batched mutations to stable storage.
+  Try<Nothing> _flush();
+
   const std::string path;
+  const Duration window;
   leveldb::DB* db;
 
+  // Mutations that have been batched (serialized entries keyed by
+  // name) but not yet written to stable storage, along with whether a
+  // flush has already been scheduled for them.
+  std::map<std::string, std::string> pending;
+  bool flushing;
+
   Option<std::string> error;
 };
 
 
 template <typename Serializer>
-LevelDBState<Serializer>::LevelDBState(const std::string& path)
+LevelDBState<Serializer>::LevelDBState(
+    const std::string& path,
+    const Duration& window)
 {
-  process = new LevelDBStateProcess(path);
+  process = new LevelDBStateProcess(path, window);
   process::spawn(process);
 }
 
@@ -98,6 +132,13 @@ process::Future<std::vector<std::string> > LevelDBState<Serializer>::names()
 }
 
 
+template <typename Serializer>
+process::Future<bool> LevelDBState<Serializer>::sync()
+{
+  return process::dispatch(process, &LevelDBStateProcess::sync);
+}
+
+
 template <typename Serializer>
 process::Future<Option<Entry> > LevelDBState<Serializer>::fetch(
     const std::string& name)
@@ -1,13 +1,19 @@
 #ifndef __STATE_SERIALIZER_HPP__
 #define __STATE_SERIALIZER_HPP__
 
+#include <stdint.h>
+#include <string.h>
+
 #include <google/protobuf/message.h>
 
 #include <google/protobuf/io/zero_copy_stream_impl.h> // For ArrayInputStream.
 
 #include <string>
 
+#include <stout/crc32c.hpp>
 #include <stout/error.hpp>
+#include <stout/gzip.hpp>
+#include <stout/stringify.hpp>
 #include <stout/try.hpp>
 
 namespace mesos {
@@ -60,6 +66,131 @@ struct ProtobufSerializer
   }
 };
 
+namespace envelope {
+
+// Layout of an enveloped value:
+//
+//   offset  size  field
+//   0       1     MAGIC ('\0')
+//   1       1     format version (currently 1)
+//   2       1     codec (0 = identity, 1 = gzip)
+//   3       4     CRC-32C of the uncompressed payload
+//   7       -     payload
+//
+// The magic byte disambiguates enveloped values from the raw bytes
+// written before the envelope existed: a serialized protobuf never
+// starts with '\0' (that would encode the invalid field number 0)
+// and none of our string valued state does either.
+const char MAGIC = '\0';
+
+const uint8_t VERSION = 1;
+
+const uint8_t IDENTITY = 0;
+const uint8_t GZIP = 1;
+
+const size_t HEADER = 7;
+
+// Values smaller than this are stored without attempting
+// compression; the gzip framing alone would offset the win.
+const size_t COMPRESSION_THRESHOLD = 256;
+
+} // namespace envelope {
+
+
+// Wraps another serializer's bytes in a small self-describing
+// envelope carrying a format version, a codec flag and a checksum,
+// gzip compressing the payload when that wins (large snapshots
+// stored through the State abstraction otherwise run into
+// ZooKeeper's znode size limit and waste leveldb space). Values
+// written before the envelope existed are detected by the leading
+// magic byte and passed through to the wrapped serializer untouched,
+// so no migration event is needed: old values remain readable and
+// get rewritten into the envelope the next time they are set.
+template <typename Serializer>
+struct EnvelopeSerializer
+{
+  template <typename T>
+  static Try<T> deserialize(const std::string& value)
+  {
+    if (value.empty() || value[0] != envelope::MAGIC) {
+      // Written before the envelope existed: raw bytes from the
+      // wrapped serializer.
+      return Serializer::template deserialize<T>(value);
+    }
+
+    if (value.size() < envelope::HEADER) {
+      return Error("Truncated state envelope");
+    }
+
+    uint8_t version = value[1];
+    if (version != envelope::VERSION) {
+      return Error(
+          "Unknown state envelope version " + stringify((int) version));
+    }
+
+    uint8_t codec = value[2];
+
+    uint32_t checksum;
+    memcpy(&checksum, value.data() + 3, sizeof(checksum));
+
+    std::string payload = value.substr(envelope::HEADER);
+
+    if (codec == envelope::GZIP) {
+      Try<std::string> decompressed = gzip::decompress(payload);
+      if (decompressed.isError()) {
+        return Error(
+            "Failed to decompress state envelope payload: " +
+            decompressed.error());
+      }
+      payload = decompressed.get();
+    } else if (codec != envelope::IDENTITY) {
+      return Error(
+          "Unknown state envelope codec " + stringify((int) codec));
+    }
+
+    if (crc32c::checksum(payload) != checksum) {
+      return Error("Checksum mismatch on state envelope payload");
+    }
+
+    return Serializer::template deserialize<T>(payload);
+  }
+
+  template <typename T>
+  static Try<std::string> serialize(const T& t)
+  {
+    Try<std::string> serialized = Serializer::template serialize<T>(t);
+    if (serialized.isError()) {
+      return serialized;
+    }
+
+    std::string payload = serialized.get();
+    uint32_t checksum = crc32c::checksum(payload);
+
+    uint8_t codec = envelope::IDENTITY;
+
+    if (payload.size() >= envelope::COMPRESSION_THRESHOLD) {
+      // NOTE: If libz is not built in compress() returns an Error
+      // and the payload is simply stored uncompressed.
+      Try<std::string> compressed = gzip::compress(payload);
+      if (compressed.isSome() &&
+          compressed.get().size() < payload.size()) {
+        codec = envelope::GZIP;
+        payload = compressed.get();
+      }
+    }
+
+    std::string value;
+    value.reserve(envelope::HEADER + payload.size());
+    value += envelope::MAGIC;
+    value += (char) envelope::VERSION;
+    value += (char) codec;
+    value.append((const char*) &checksum, sizeof(checksum));
+    value += payload;
+
+    return value;
+  }
+};
+
 } // namespace state {
 } // namespace internal {
 } // namespace mesos {
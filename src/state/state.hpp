@@ -19,11 +19,15 @@
 #ifndef __STATE_STATE_HPP__
 #define __STATE_STATE_HPP__
 
+#include <list>
 #include <string>
 #include <vector>
 
+#include <process/collect.hpp>
 #include <process/future.hpp>
 
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/none.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
@@ -99,12 +103,27 @@ public:
   template <typename T>
   process::Future<Variable<T> > get(const std::string& name);
 
+  // Batched variant of 'get' that returns a variable per name. When
+  // the backend supports it the fetches get pipelined so that
+  // getting many variables is bounded by a single round trip rather
+  // than one round trip per variable.
+  template <typename T>
+  process::Future<std::vector<Variable<T> > > get(
+      const std::vector<std::string>& names);
+
   // Returns true if the variable was successfully set in the state,
   // otherwise false if the version of the variable was no longer
   // valid (or an error if one occurs).
   template <typename T>
   process::Future<Option<Variable<T> > > set(const Variable<T>& variable);
 
+  // Batched variant of 'set'. Each variable is swapped independently
+  // (there is no atomicity across variables); the result per
+  // variable follows the semantics of 'set' above.
+  template <typename T>
+  process::Future<std::vector<Option<Variable<T> > > > set(
+      const std::vector<Variable<T> >& variables);
+
   // Returns the collection of variable names in the state.
   virtual process::Future<std::vector<std::string> > names() = 0;
 
@@ -114,6 +133,15 @@ protected:
   virtual process::Future<Option<Entry> > fetch(const std::string& name) = 0;
   virtual process::Future<bool> swap(const Entry& entry, const UUID& uuid) = 0;
 
+  // Batched variants of fetch and swap. By default these just issue
+  // the singular operations concurrently and collect the results;
+  // backends that can pipeline (e.g., ZooKeeper) override them.
+  virtual process::Future<std::vector<Option<Entry> > > fetch(
+      const std::vector<std::string>& names);
+  virtual process::Future<std::vector<bool> > swap(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids);
+
 private:
   // Helpers to handle future results from fetch and swap. We make
   // these static members of State for friend access to Variable's
@@ -128,6 +156,49 @@ private:
       const Entry& entry,
       const T& t,
       const bool& b); // TODO(benh): Remove 'const &' after fixing libprocess.
+
+  // Batched equivalents of _get and _set.
+  template <typename T>
+  static process::Future<std::vector<Variable<T> > > _gets(
+      const std::vector<std::string>& names,
+      const std::vector<Option<Entry> >& options);
+
+  template <typename T>
+  static process::Future<std::vector<Option<Variable<T> > > > _sets(
+      const std::vector<Entry>& entries,
+      const std::vector<T>& ts,
+      const std::vector<bool>& bs);
+
+  // Continuations of 'set' that maintain the cache based on the
+  // swap result before delegating to '_set' / '_sets'.
+  template <typename T>
+  process::Future<Option<Variable<T> > > __set(
+      const Entry& entry,
+      const T& t,
+      const bool& b); // TODO(benh): Remove 'const &' after fixing libprocess.
+
+  template <typename T>
+  process::Future<std::vector<Option<Variable<T> > > > __sets(
+      const std::vector<Entry>& entries,
+      const std::vector<T>& ts,
+      const std::vector<bool>& bs);
+
+  // Helper for converting the result of a process::collect into the
+  // vector that the batched operations return.
+  template <typename T>
+  static std::vector<T> _vectorize(const std::list<T>& list);
+
+  // Cache of the entry from this client's last successful swap of
+  // each variable, served by 'get' without a round trip to the store
+  // so that hot read-modify-write cycles hit the store once (for the
+  // swap), not twice. The optimistic concurrency control keeps this
+  // safe for writers: if another client has swapped the variable
+  // since, our next swap fails against the store's version, the
+  // cached entry is dropped, and the caller's retried 'get' fetches
+  // from the store. NOTE: A client that writes a variable once and
+  // then only reads it can be served stale values; such readers
+  // should fetch through a State instance they do not write through.
+  hashmap<std::string, Entry> cache;
 };
 
 
@@ -183,10 +254,173 @@ process::Future<Option<Variable<T> > > State<Serializer>::_set(
 }
 
 
+template <typename Serializer>
+template <typename T>
+process::Future<std::vector<Variable<T> > > State<Serializer>::_gets(
+    const std::vector<std::string>& names,
+    const std::vector<Option<Entry> >& options)
+{
+  CHECK(names.size() == options.size());
+
+  std::vector<Variable<T> > variables;
+  variables.reserve(names.size());
+
+  for (size_t i = 0; i < names.size(); i++) {
+    if (options[i].isSome()) {
+      const Entry& entry = options[i].get();
+
+      Try<T> t = Serializer::template deserialize<T>(entry.value());
+
+      if (t.isError()) {
+        return process::Future<std::vector<Variable<T> > >::failed(t.error());
+      }
+
+      variables.push_back(Variable<T>(entry, t.get()));
+    } else {
+      // As in _get, construct a Variable out of a new Entry with a
+      // default value for T (and a random UUID to start).
+      T t;
+
+      Try<std::string> value = Serializer::template serialize<T>(t);
+
+      if (value.isError()) {
+        return process::Future<std::vector<Variable<T> > >::failed(
+            value.error());
+      }
+
+      Entry entry;
+      entry.set_name(names[i]);
+      entry.set_uuid(UUID::random().toBytes());
+      entry.set_value(value.get());
+
+      variables.push_back(Variable<T>(entry, t));
+    }
+  }
+
+  return variables;
+}
+
+
+template <typename Serializer>
+template <typename T>
+process::Future<std::vector<Option<Variable<T> > > > State<Serializer>::_sets(
+    const std::vector<Entry>& entries,
+    const std::vector<T>& ts,
+    const std::vector<bool>& bs)
+{
+  CHECK(entries.size() == ts.size());
+  CHECK(entries.size() == bs.size());
+
+  std::vector<Option<Variable<T> > > variables;
+  variables.reserve(entries.size());
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (bs[i]) {
+      variables.push_back(
+          Option<Variable<T> >::some(Variable<T>(entries[i], ts[i])));
+    } else {
+      variables.push_back(Option<Variable<T> >::none());
+    }
+  }
+
+  return variables;
+}
+
+
+template <typename Serializer>
+template <typename T>
+process::Future<Option<Variable<T> > > State<Serializer>::__set(
+    const Entry& entry,
+    const T& t,
+    const bool& b) // TODO(benh): Remove 'const &' after fixing libprocess.
+{
+  if (b) {
+    cache[entry.name()] = entry;
+  } else {
+    // Another client swapped the variable since we last saw it; drop
+    // the cached entry so the caller's retried 'get' fetches from
+    // the store.
+    cache.erase(entry.name());
+  }
+
+  return _set<T>(entry, t, b);
+}
+
+
+template <typename Serializer>
+template <typename T>
+process::Future<std::vector<Option<Variable<T> > > > State<Serializer>::__sets(
+    const std::vector<Entry>& entries,
+    const std::vector<T>& ts,
+    const std::vector<bool>& bs)
+{
+  CHECK(entries.size() == bs.size());
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (bs[i]) {
+      cache[entries[i].name()] = entries[i];
+    } else {
+      cache.erase(entries[i].name());
+    }
+  }
+
+  return _sets<T>(entries, ts, bs);
+}
+
+
+template <typename Serializer>
+template <typename T>
+std::vector<T> State<Serializer>::_vectorize(const std::list<T>& list)
+{
+  return std::vector<T>(list.begin(), list.end());
+}
+
+
+template <typename Serializer>
+process::Future<std::vector<Option<Entry> > > State<Serializer>::fetch(
+    const std::vector<std::string>& names)
+{
+  std::list<process::Future<Option<Entry> > > futures;
+
+  foreach (const std::string& name, names) {
+    futures.push_back(fetch(name));
+  }
+
+  return process::collect(futures)
+    .then(std::tr1::bind(&State<Serializer>::template _vectorize<Option<Entry> >,
+                         std::tr1::placeholders::_1));
+}
+
+
+template <typename Serializer>
+process::Future<std::vector<bool> > State<Serializer>::swap(
+    const std::vector<Entry>& entries,
+    const std::vector<UUID>& uuids)
+{
+  CHECK(entries.size() == uuids.size());
+
+  std::list<process::Future<bool> > futures;
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    futures.push_back(swap(entries[i], uuids[i]));
+  }
+
+  return process::collect(futures)
+    .then(std::tr1::bind(&State<Serializer>::template _vectorize<bool>,
+                         std::tr1::placeholders::_1));
+}
+
+
 template <typename Serializer>
 template <typename T>
 process::Future<Variable<T> > State<Serializer>::get(const std::string& name)
 {
+  // Serve the variable from the cache when this client performed
+  // the last successful swap of it (see the 'cache' member).
+  if (cache.contains(name)) {
+    return _get<T>(name, cache[name]);
+  }
+
   return fetch(name)
     .then(std::tr1::bind(&State<Serializer>::template _get<T>,
                          name,
@@ -216,16 +450,94 @@ process::Future<Option<Variable<T> > > State<Serializer>::set(
   entry.set_value(value.get());
 
   std::tr1::function<
-  process::Future<Option<Variable<T> > >(const bool&)> _set =
-    std::tr1::bind(&State<Serializer>::template _set<T>,
+  process::Future<Option<Variable<T> > >(const bool&)> set =
+    std::tr1::bind(&State<Serializer>::template __set<T>,
+                   this,
                    entry,
                    variable.t,
                    std::tr1::placeholders::_1);
 
-  return swap(entry, uuid).then(_set);
+  return swap(entry, uuid).then(set);
 }
 
 
+template <typename Serializer>
+template <typename T>
+process::Future<std::vector<Variable<T> > > State<Serializer>::get(
+    const std::vector<std::string>& names)
+{
+  // Serve the batch from the cache only when every variable is
+  // cached; a partial hit pays the round trip anyway, and fetching
+  // everything keeps the misses fresh.
+  bool cached = true;
+  foreach (const std::string& name, names) {
+    if (!cache.contains(name)) {
+      cached = false;
+      break;
+    }
+  }
+
+  if (cached) {
+    std::vector<Option<Entry> > options;
+    options.reserve(names.size());
+    foreach (const std::string& name, names) {
+      options.push_back(Option<Entry>::some(cache[name]));
+    }
+    return _gets<T>(names, options);
+  }
+
+  return fetch(names)
+    .then(std::tr1::bind(&State<Serializer>::template _gets<T>,
+                         names,
+                         std::tr1::placeholders::_1));
+}
+
+
+template <typename Serializer>
+template <typename T>
+process::Future<std::vector<Option<Variable<T> > > > State<Serializer>::set(
+    const std::vector<Variable<T> >& variables)
+{
+  std::vector<Entry> entries;
+  std::vector<UUID> uuids;
+  std::vector<T> ts;
+
+  entries.reserve(variables.size());
+  uuids.reserve(variables.size());
+  ts.reserve(variables.size());
+
+  foreach (const Variable<T>& variable, variables) {
+    Try<std::string> value = Serializer::template serialize<T>(variable.t);
+
+    if (value.isError()) {
+      return process::Future<std::vector<Option<Variable<T> > > >::failed(
+          value.error());
+    }
+
+    // As in 'set', create a new entry to replace the existing entry
+    // provided the UUID matches.
+    Entry entry;
+    entry.set_name(variable.entry.name());
+    entry.set_uuid(UUID::random().toBytes());
+    entry.set_value(value.get());
+
+    entries.push_back(entry);
+    uuids.push_back(UUID::fromBytes(variable.entry.uuid()));
+    ts.push_back(variable.t);
+  }
+
+  std::tr1::function<
+  process::Future<std::vector<Option<Variable<T> > > >(
+      const std::vector<bool>&)> sets =
+    std::tr1::bind(&State<Serializer>::template __sets<T>,
+                   this,
+                   entries,
+                   ts,
+                   std::tr1::placeholders::_1);
+
+  return swap(entries, uuids).then(sets);
+}
+
 
 } // namespace state {
 } // namespace internal {
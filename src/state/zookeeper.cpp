@@ -76,6 +76,8 @@ ZooKeeperStateProcess::~ZooKeeperStateProcess()
   fail(&pending.names, "No longer managing state");
   fail(&pending.fetches, "No longer managing state");
   fail(&pending.swaps, "No longer managing state");
+  fail(&pending.bulkFetches, "No longer managing state");
+  fail(&pending.bulkSwaps, "No longer managing state");
 
   delete zk;
   delete watcher;
@@ -163,6 +165,57 @@ Future<bool> ZooKeeperStateProcess::swap(const Entry& entry, const UUID& uuid)
 }
 
 
+Future<vector<Option<Entry> > > ZooKeeperStateProcess::bulkFetch(
+    const vector<string>& names)
+{
+  if (error.isSome()) {
+    return Future<vector<Option<Entry> > >::failed(error.get());
+  } else if (state != CONNECTED) {
+    BulkFetch* bulkFetch = new BulkFetch(names);
+    pending.bulkFetches.push(bulkFetch);
+    return bulkFetch->promise.future();
+  }
+
+  Result<vector<Option<Entry> > > result = doBulkFetch(names);
+
+  if (result.isNone()) { // Try again later.
+    BulkFetch* bulkFetch = new BulkFetch(names);
+    pending.bulkFetches.push(bulkFetch);
+    return bulkFetch->promise.future();
+  } else if (result.isError()) {
+    return Future<vector<Option<Entry> > >::failed(result.error());
+  }
+
+  return result.get();
+}
+
+
+Future<vector<bool> > ZooKeeperStateProcess::bulkSwap(
+    const vector<Entry>& entries,
+    const vector<UUID>& uuids)
+{
+  if (error.isSome()) {
+    return Future<vector<bool> >::failed(error.get());
+  } else if (state != CONNECTED) {
+    BulkSwap* bulkSwap = new BulkSwap(entries, uuids);
+    pending.bulkSwaps.push(bulkSwap);
+    return bulkSwap->promise.future();
+  }
+
+  Result<vector<bool> > result = doBulkSwap(entries, uuids);
+
+  if (result.isNone()) { // Try again later.
+    BulkSwap* bulkSwap = new BulkSwap(entries, uuids);
+    pending.bulkSwaps.push(bulkSwap);
+    return bulkSwap->promise.future();
+  } else if (result.isError()) {
+    return Future<vector<bool> >::failed(result.error());
+  }
+
+  return result.get();
+}
+
+
 void ZooKeeperStateProcess::connected(bool reconnect)
 {
   if (!reconnect) {
@@ -223,6 +276,34 @@ void ZooKeeperStateProcess::connected(bool reconnect)
     pending.swaps.pop();
     delete swap;
   }
+
+  while (!pending.bulkFetches.empty()) {
+    BulkFetch* bulkFetch = pending.bulkFetches.front();
+    Result<vector<Option<Entry> > > result = doBulkFetch(bulkFetch->names);
+    if (result.isNone()) {
+      return; // Try again later.
+    } else if (result.isError()) {
+      bulkFetch->promise.fail(result.error());
+    } else {
+      bulkFetch->promise.set(result.get());
+    }
+    pending.bulkFetches.pop();
+    delete bulkFetch;
+  }
+
+  while (!pending.bulkSwaps.empty()) {
+    BulkSwap* bulkSwap = pending.bulkSwaps.front();
+    Result<vector<bool> > result = doBulkSwap(bulkSwap->entries, bulkSwap->uuids);
+    if (result.isNone()) {
+      return; // Try again later.
+    } else if (result.isError()) {
+      bulkSwap->promise.fail(result.error());
+    } else {
+      bulkSwap->promise.set(result.get());
+    }
+    pending.bulkSwaps.pop();
+    delete bulkSwap;
+  }
 }
 
 
@@ -414,6 +495,191 @@ Result<bool> ZooKeeperStateProcess::doSwap(const Entry& entry, const UUID& uuid)
   return true;
 }
 
+
+Result<vector<Option<Entry> > > ZooKeeperStateProcess::doBulkFetch(
+    const vector<string>& names)
+{
+  CHECK(error.isNone()) << ": " << error.get();
+  CHECK(state == CONNECTED);
+
+  vector<string> paths;
+  paths.reserve(names.size());
+
+  foreach (const string& name, names) {
+    paths.push_back(znode + "/" + name);
+  }
+
+  vector<string> results;
+  vector<Stat> stats;
+  vector<int> codes;
+
+  // Pipeline the gets so that fetching many variables is bounded by
+  // a single round trip rather than one round trip per variable.
+  int code = zk->get(paths, false, &results, &stats, &codes);
+
+  if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
+    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
+    return None(); // Try again later.
+  } else if (code != ZOK) {
+    return Error(
+        "Failed to get children of '" + znode +
+        "' in ZooKeeper: " + zk->message(code));
+  }
+
+  vector<Option<Entry> > entries;
+  entries.reserve(names.size());
+
+  for (size_t i = 0; i < names.size(); i++) {
+    if (codes[i] == ZNONODE) {
+      entries.push_back(Option<Entry>::none());
+      continue;
+    }
+
+    google::protobuf::io::ArrayInputStream stream(
+        results[i].data(), results[i].size());
+
+    Entry entry;
+
+    if (!entry.ParseFromZeroCopyStream(&stream)) {
+      return Error("Failed to deserialize Entry");
+    }
+
+    entries.push_back(Option<Entry>::some(entry));
+  }
+
+  return entries;
+}
+
+
+Result<vector<bool> > ZooKeeperStateProcess::doBulkSwap(
+    const vector<Entry>& entries,
+    const vector<UUID>& uuids)
+{
+  CHECK(error.isNone()) << ": " << error.get();
+  CHECK(state == CONNECTED);
+  CHECK(entries.size() == uuids.size());
+
+  // Serialize everything first to make sure we're under the 1 MB
+  // limit (see doSwap) before mutating any znodes.
+  vector<string> datas(entries.size());
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (!entries[i].SerializeToString(&datas[i])) {
+      return Error("Failed to serialize Entry");
+    }
+
+    if (datas[i].size() > 1024 * 1024) { // 1 MB
+      // TODO(benh): Use stout/gzip.hpp for compression.
+      return Error("Serialized data is too big (> 1 MB)");
+    }
+  }
+
+  vector<string> paths;
+  paths.reserve(entries.size());
+
+  foreach (const Entry& entry, entries) {
+    paths.push_back(znode + "/" + entry.name());
+  }
+
+  // Pipeline the gets to learn the current UUIDs and versions.
+  vector<string> results;
+  vector<Stat> stats;
+  vector<int> codes;
+
+  int code = zk->get(paths, false, &results, &stats, &codes);
+
+  if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
+    CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
+    return None(); // Try again later (nothing has been mutated yet).
+  } else if (code != ZOK) {
+    return Error(
+        "Failed to get children of '" + znode +
+        "' in ZooKeeper: " + zk->message(code));
+  }
+
+  vector<bool> successes(entries.size(), false);
+
+  // Indices of the entries whose versions get validated "in flight"
+  // by doing the sets with the versions observed above.
+  vector<size_t> indices;
+
+  bool mutated = false; // Whether any znode has been mutated yet.
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (codes[i] == ZNONODE) {
+      // The node does not exist yet, fall back to the (rare) create
+      // path of the singular swap.
+      Result<bool> result = doSwap(entries[i], uuids[i]);
+
+      if (result.isNone()) {
+        if (!mutated) {
+          return None(); // Try again later.
+        }
+        // NOTE: We can't simply retry the entire batch because a
+        // retry would report false for swaps that have already been
+        // applied (their UUIDs have changed).
+        return Error(
+            "Failed to create '" + paths[i] +
+            "' in ZooKeeper (batch partially applied)");
+      } else if (result.isError()) {
+        return Error(result.error());
+      }
+
+      successes[i] = result.get();
+      mutated = mutated || successes[i];
+    } else {
+      google::protobuf::io::ArrayInputStream stream(
+          results[i].data(), results[i].size());
+
+      Entry current;
+
+      if (!current.ParseFromZeroCopyStream(&stream)) {
+        return Error("Failed to deserialize Entry");
+      }
+
+      if (UUID::fromBytes(current.uuid()) == uuids[i]) {
+        indices.push_back(i);
+      }
+    }
+  }
+
+  if (!indices.empty()) {
+    vector<string> setPaths;
+    vector<string> setDatas;
+    vector<int> versions;
+
+    setPaths.reserve(indices.size());
+    setDatas.reserve(indices.size());
+    versions.reserve(indices.size());
+
+    foreach (size_t i, indices) {
+      setPaths.push_back(paths[i]);
+      setDatas.push_back(datas[i]);
+      versions.push_back(stats[i].version);
+    }
+
+    // Pipeline the sets, each guarded by the version observed above
+    // (a concurrent write manifests as ZBADVERSION, i.e., false).
+    vector<int> setCodes;
+
+    code = zk->set(setPaths, setDatas, versions, &setCodes);
+
+    if (code != ZOK) {
+      // NOTE: As above, we can't simply retry because some of the
+      // sets may already have been applied.
+      return Error(
+          "Failed to set children of '" + znode +
+          "' in ZooKeeper: " + zk->message(code));
+    }
+
+    for (size_t j = 0; j < indices.size(); j++) {
+      successes[indices[j]] = (setCodes[j] == ZOK);
+    }
+  }
+
+  return successes;
+}
+
 } // namespace state {
 } // namespace internal {
 } // namespace mesos {
@@ -53,6 +53,14 @@ protected:
   virtual process::Future<Option<Entry> > fetch(const std::string& name);
   virtual process::Future<bool> swap(const Entry& entry, const UUID& uuid);
 
+  // Batched variants that pipeline the znode operations rather than
+  // doing one round trip per name/entry.
+  virtual process::Future<std::vector<Option<Entry> > > fetch(
+      const std::vector<std::string>& names);
+  virtual process::Future<std::vector<bool> > swap(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids);
+
 private:
   ZooKeeperStateProcess* process;
 };
@@ -75,6 +83,15 @@ public:
   process::Future<Option<Entry> > fetch(const std::string& name);
   process::Future<bool> swap(const Entry& entry, const UUID& uuid);
 
+  // Batched variants (see ZooKeeperState above). NOTE: These are not
+  // overloads of fetch/swap so that taking the address of those for
+  // dispatching remains unambiguous.
+  process::Future<std::vector<Option<Entry> > > bulkFetch(
+      const std::vector<std::string>& names);
+  process::Future<std::vector<bool> > bulkSwap(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids);
+
   // ZooKeeper events.
   void connected(bool reconnect);
   void reconnecting();
@@ -88,6 +105,11 @@ private:
   Result<std::vector<std::string> > doNames();
   Result<Option<Entry> > doFetch(const std::string& name);
   Result<bool> doSwap(const Entry& entry, const UUID& uuid);
+  Result<std::vector<Option<Entry> > > doBulkFetch(
+      const std::vector<std::string>& names);
+  Result<std::vector<bool> > doBulkSwap(
+      const std::vector<Entry>& entries,
+      const std::vector<UUID>& uuids);
 
   const std::string servers;
   const Duration timeout;
@@ -128,12 +150,33 @@ private:
     process::Promise<bool> promise;
   };
 
+  struct BulkFetch
+  {
+    BulkFetch(const std::vector<std::string>& _names)
+      : names(_names) {}
+    std::vector<std::string> names;
+    process::Promise<std::vector<Option<Entry> > > promise;
+  };
+
+  struct BulkSwap
+  {
+    BulkSwap(
+        const std::vector<Entry>& _entries,
+        const std::vector<UUID>& _uuids)
+      : entries(_entries), uuids(_uuids) {}
+    std::vector<Entry> entries;
+    std::vector<UUID> uuids;
+    process::Promise<std::vector<bool> > promise;
+  };
+
   // TODO(benh): Make pending a single queue of "operations" that can
   // be "invoked" (C++11 lambdas would help).
   struct {
     std::queue<Names*> names;
     std::queue<Fetch*> fetches;
     std::queue<Swap*> swaps;
+    std::queue<BulkFetch*> bulkFetches;
+    std::queue<BulkSwap*> bulkSwaps;
   } pending;
 
   Option<std::string> error;
@@ -184,6 +227,24 @@ process::Future<bool> ZooKeeperState<Serializer>::swap(
   return process::dispatch(process, &ZooKeeperStateProcess::swap, entry, uuid);
 }
 
+
+template <typename Serializer>
+process::Future<std::vector<Option<Entry> > > ZooKeeperState<Serializer>::fetch(
+    const std::vector<std::string>& names)
+{
+  return process::dispatch(process, &ZooKeeperStateProcess::bulkFetch, names);
+}
+
+
+template <typename Serializer>
+process::Future<std::vector<bool> > ZooKeeperState<Serializer>::swap(
+    const std::vector<Entry>& entries,
+    const std::vector<UUID>& uuids)
+{
+  return process::dispatch(
+      process, &ZooKeeperStateProcess::bulkSwap, entries, uuids);
+}
+
 } // namespace state {
 } // namespace internal {
 } // namespace mesos {
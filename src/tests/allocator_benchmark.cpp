@@ -0,0 +1,205 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/process.hpp>
+
+#include <stout/hashmap.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+
+#include "master/drf_sorter.hpp"
+#include "master/flags.hpp"
+#include "master/hierarchical_allocator_process.hpp"
+#include "master/incremental_drf_sorter.hpp"
+#include "master/master.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::master;
+
+using process::Future;
+using process::PID;
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+
+// A benchmark that drives the hierarchical allocator with a
+// synthetic topology (N slaves x M frameworks across a handful of
+// users) and reports the allocation cycle latency distribution and
+// sustained allocation cycles per second. Usage:
+//
+//   mesos-allocator-benchmark [slaves] [frameworks] [cycles]
+//
+// Each cycle performs a full allocation pass and then recovers every
+// allocation, simulating the steady-state churn of a cluster whose
+// frameworks continually finish tasks.
+class AllocatorBenchmarkProcess
+  : public HierarchicalAllocatorProcess<IncrementalDRFSorter,
+                                        IncrementalDRFSorter>
+{
+public:
+  // Performs a single allocation pass and returns its latency in
+  // seconds. The pass is timed inside the process so that queueing
+  // delay is excluded from the measurement.
+  double cycle()
+  {
+    Stopwatch stopwatch;
+    stopwatch.start();
+
+    allocate();
+
+    double elapsed = stopwatch.elapsed().secs();
+
+    recover();
+
+    return elapsed;
+  }
+
+private:
+  // Returns all allocated resources to the allocatable pool so that
+  // the next cycle has work to do, mimicking frameworks finishing
+  // all of their tasks between cycles.
+  void recover()
+  {
+    foreachpair (const FrameworkID& frameworkId,
+                 const string& user,
+                 users) {
+      if (sorters[user]->contains(frameworkId.value())) {
+        Resources allocation =
+          sorters[user]->allocation(frameworkId.value());
+        sorters[user]->unallocated(frameworkId.value(), allocation);
+        sorters[user]->remove(allocation);
+        userSorter->unallocated(user, allocation);
+      }
+    }
+
+    foreachpair (const SlaveID& slaveId, const SlaveInfo& info, slaves) {
+      allocatable[slaveId] = info.resources();
+    }
+
+    unallocatable.clear();
+  }
+};
+
+
+int main(int argc, char** argv)
+{
+  int numSlaves = argc > 1 ? atoi(argv[1]) : 1000;
+  int numFrameworks = argc > 2 ? atoi(argv[2]) : 200;
+  int numCycles = argc > 3 ? atoi(argv[3]) : 50;
+  int numUsers = std::min(numFrameworks, 10);
+
+  cout << "Benchmarking allocator with " << numSlaves << " slaves, "
+       << numFrameworks << " frameworks (" << numUsers << " users), "
+       << numCycles << " cycles" << endl;
+
+  master::Flags flags;
+
+  AllocatorBenchmarkProcess* allocator = new AllocatorBenchmarkProcess();
+  process::spawn(allocator);
+
+  // Offers are dispatched to an invalid master PID and dropped; we
+  // only measure the allocator's own work.
+  process::dispatch(
+      allocator,
+      &AllocatorBenchmarkProcess::initialize,
+      flags,
+      PID<Master>());
+
+  for (int i = 0; i < numFrameworks; i++) {
+    FrameworkID frameworkId;
+    frameworkId.set_value("framework-" + stringify(i));
+
+    FrameworkInfo frameworkInfo;
+    frameworkInfo.set_name("framework-" + stringify(i));
+    frameworkInfo.set_user("user-" + stringify(i % numUsers));
+
+    process::dispatch(
+        allocator,
+        &AllocatorBenchmarkProcess::frameworkAdded,
+        frameworkId,
+        frameworkInfo,
+        Resources::parse(""));
+  }
+
+  for (int i = 0; i < numSlaves; i++) {
+    SlaveID slaveId;
+    slaveId.set_value("slave-" + stringify(i));
+
+    SlaveInfo slaveInfo;
+    slaveInfo.set_hostname("host-" + stringify(i));
+    slaveInfo.mutable_resources()->MergeFrom(
+        Resources::parse("cpus:16;mem:32768;disk:1048576"));
+
+    process::dispatch(
+        allocator,
+        &AllocatorBenchmarkProcess::slaveAdded,
+        slaveId,
+        slaveInfo,
+        hashmap<FrameworkID, Resources>());
+  }
+
+  vector<double> latencies;
+  Stopwatch total;
+  total.start();
+
+  for (int i = 0; i < numCycles; i++) {
+    Future<double> latency = process::dispatch(
+        allocator,
+        &AllocatorBenchmarkProcess::cycle);
+
+    latency.await();
+    latencies.push_back(latency.get());
+  }
+
+  double elapsed = total.elapsed().secs();
+
+  std::sort(latencies.begin(), latencies.end());
+
+  double sum = 0;
+  foreach (double latency, latencies) {
+    sum += latency;
+  }
+
+  cout << "Allocation cycle latency (seconds):" << endl;
+  cout << "  min:  " << latencies.front() << endl;
+  cout << "  p50:  " << latencies[latencies.size() / 2] << endl;
+  cout << "  p95:  " << latencies[(latencies.size() * 95) / 100] << endl;
+  cout << "  p99:  " << latencies[(latencies.size() * 99) / 100] << endl;
+  cout << "  max:  " << latencies.back() << endl;
+  cout << "  mean: " << sum / latencies.size() << endl;
+  cout << "Allocation cycles/sec: " << numCycles / elapsed << endl;
+
+  process::terminate(allocator);
+  process::wait(allocator);
+  delete allocator;
+
+  return 0;
+}
@@ -0,0 +1,63 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <stout/hashmap.hpp>
+
+#include "common/atoms.hpp"
+
+using namespace mesos::internal;
+
+using std::string;
+
+
+TEST(AtomsTest, Interning)
+{
+  Atom cpus1("cpus");
+  Atom cpus2(string("cp") + "us"); // Distinct source strings.
+  Atom mem("mem");
+
+  EXPECT_TRUE(cpus1 == cpus2);
+  EXPECT_TRUE(cpus1 != mem);
+
+  // Atoms round-trip to their string value.
+  EXPECT_EQ("cpus", cpus1.value());
+  EXPECT_EQ("mem", mem.value());
+
+  // Ordering matches the lexicographic string ordering.
+  EXPECT_TRUE(cpus1 < mem);
+  EXPECT_FALSE(mem < cpus1);
+  EXPECT_FALSE(cpus1 < cpus2);
+}
+
+
+TEST(AtomsTest, HashmapKey)
+{
+  hashmap<Atom, int> map;
+
+  map[Atom("framework-0")] = 1;
+  map[Atom("framework-1")] = 2;
+
+  EXPECT_TRUE(map.contains(Atom("framework-0")));
+  EXPECT_EQ(1, map[Atom("framework-0")]);
+  EXPECT_EQ(2, map[Atom("framework-1")]);
+  EXPECT_FALSE(map.contains(Atom("framework-2")));
+}
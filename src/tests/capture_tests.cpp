@@ -0,0 +1,88 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include <gmock/gmock.h>
+
+#include <process/message.hpp>
+#include <process/pid.hpp>
+
+#include <stout/os.hpp>
+#include <stout/result.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "master/capture.hpp"
+
+#include "tests/utils.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using mesos::internal::master::capture::Captured;
+using mesos::internal::master::capture::Reader;
+using mesos::internal::master::capture::Recorder;
+
+
+TEST(CaptureTest, RoundTrip)
+{
+  const std::string file = ".capture_test_round_trip";
+
+  Try<Recorder*> recorder = Recorder::open(file);
+  ASSERT_SOME(recorder);
+
+  const size_t writes = 10;
+
+  for (size_t i = 0; i < writes; i++) {
+    process::Message message;
+    message.name = "mesos.internal.TestMessage";
+    message.from = process::UPID("sender-" + stringify(i), 2130706433, 5050);
+    message.body = std::string(i, 'x');
+
+    ASSERT_SOME(recorder.get()->record(message));
+  }
+
+  delete recorder.get(); // Appends the clean-close footer.
+
+  Try<Reader*> reader = Reader::open(file);
+  ASSERT_SOME(reader);
+
+  double previous = 0.0;
+
+  for (size_t i = 0; i < writes; i++) {
+    Result<Captured> captured = reader.get()->read();
+    ASSERT_SOME(captured);
+
+    EXPECT_EQ("mesos.internal.TestMessage", captured.get().name);
+    EXPECT_EQ("sender-" + stringify(i), captured.get().from.id);
+    EXPECT_EQ(std::string(i, 'x'), captured.get().body);
+
+    // Timestamps come back in arrival order.
+    EXPECT_LE(previous, captured.get().secs);
+    previous = captured.get().secs;
+  }
+
+  // The footer ends the stream cleanly.
+  Result<Captured> end = reader.get()->read();
+  ASSERT_TRUE(end.isNone());
+
+  delete reader.get();
+
+  os::rm(file);
+}
@@ -25,6 +25,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <list>
 #include <set>
 #include <string>
 #include <vector>
@@ -416,6 +417,50 @@ TEST_F(CgroupsAnyHierarchyWithCpuAcctMemoryTest, ROOT_CGROUPS_Stat)
 }
 
 
+TEST_F(CgroupsAnyHierarchyWithCpuAcctMemoryTest, ROOT_CGROUPS_StatReader)
+{
+  std::vector<std::string> controls;
+  controls.push_back("cpuacct.stat");
+  controls.push_back("memory.stat");
+  controls.push_back("memory.usage_in_bytes");
+
+  cgroups::StatReader reader(hierarchy, controls);
+
+  typedef hashmap<std::string, hashmap<std::string, uint64_t> > Stats;
+
+  Try<Stats> read = reader.read("/");
+  ASSERT_SOME(read);
+
+  // NOTE: hashmap::get() returns by value, hence the named locals.
+  const hashmap<std::string, uint64_t> cpuacct =
+    read.get().get("cpuacct.stat").get();
+  EXPECT_TRUE(cpuacct.contains("user"));
+  EXPECT_TRUE(cpuacct.contains("system"));
+  EXPECT_GT(cpuacct.get("user").get(), 0llu);
+
+  const hashmap<std::string, uint64_t> memory =
+    read.get().get("memory.stat").get();
+  EXPECT_TRUE(memory.contains("rss"));
+
+  // Single valued controls are keyed under the control file name.
+  EXPECT_TRUE(read.get().get("memory.usage_in_bytes").get().contains(
+      "memory.usage_in_bytes"));
+
+  // A second read reuses the cached descriptors.
+  read = reader.read("/");
+  ASSERT_SOME(read);
+  EXPECT_GE(
+      read.get().get("cpuacct.stat").get().get("user").get(),
+      cpuacct.get("user").get());
+
+  // Reading after forget() reopens the descriptors.
+  reader.forget("/");
+  ASSERT_SOME(reader.read("/"));
+
+  EXPECT_ERROR(reader.read("nonexistent"));
+}
+
+
 TEST_F(CgroupsAnyHierarchyWithCpuMemoryTest, ROOT_CGROUPS_Listen)
 {
   ASSERT_SOME(
@@ -574,6 +619,39 @@ TEST_F(CgroupsAnyHierarchyWithCpuMemoryFreezerTest, ROOT_CGROUPS_Freeze)
 }
 
 
+TEST_F(CgroupsAnyHierarchyWithCpuMemoryFreezerTest, ROOT_CGROUPS_FreezeMultiple)
+{
+  ASSERT_SOME(cgroups::create(hierarchy, path::join(TEST_CGROUPS_ROOT, "1")));
+  ASSERT_SOME(cgroups::create(hierarchy, path::join(TEST_CGROUPS_ROOT, "2")));
+
+  std::vector<std::string> cgroups;
+  cgroups.push_back(path::join(TEST_CGROUPS_ROOT, "1"));
+  cgroups.push_back(path::join(TEST_CGROUPS_ROOT, "2"));
+
+  // Freeze both cgroups at once.
+  Future<std::list<bool> > freeze = cgroups::freeze(hierarchy, cgroups);
+  freeze.await(Seconds(5.0));
+  ASSERT_TRUE(freeze.isReady());
+  ASSERT_EQ(2u, freeze.get().size());
+
+  std::list<bool> results = freeze.get();
+  for (std::list<bool>::iterator it = results.begin();
+       it != results.end();
+       ++it) {
+    EXPECT_EQ(true, *it);
+  }
+
+  for (size_t i = 0; i < cgroups.size(); i++) {
+    Future<bool> thaw = cgroups::thaw(hierarchy, cgroups[i]);
+    thaw.await(Seconds(5.0));
+    ASSERT_TRUE(thaw.isReady());
+    EXPECT_EQ(true, thaw.get());
+
+    ASSERT_SOME(cgroups::remove(hierarchy, cgroups[i]));
+  }
+}
+
+
 TEST_F(CgroupsAnyHierarchyWithCpuMemoryFreezerTest, ROOT_CGROUPS_Kill)
 {
   int pipes[2];
@@ -0,0 +1,97 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include <gmock/gmock.h>
+
+#include <stout/bytes.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+
+#include "slave/disk_usage.hpp"
+
+#include "tests/utils.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::slave;
+
+
+TEST(DiskUsageTest, Basic)
+{
+  const std::string directory = ".disk_usage_test_basic";
+  os::rmdir(directory);
+  ASSERT_SOME(os::mkdir(directory));
+
+  // An empty tree uses (next to) nothing; the directory itself may
+  // occupy blocks on some file systems.
+  DiskUsageTracker tracker(directory);
+  tracker.update();
+  Bytes empty = tracker.usage();
+
+  // Creating a file bumps the parent directory's mtime, so the
+  // incremental update picks it up.
+  const std::string data(64 * 1024, 'x');
+  ASSERT_SOME(os::write(path::join(directory, "file"), data));
+
+  tracker.update();
+  EXPECT_GE(tracker.usage().bytes(), empty.bytes() + data.size());
+
+  // So does a file in a new subtree.
+  ASSERT_SOME(os::mkdir(path::join(directory, "sub/dir")));
+  ASSERT_SOME(os::write(path::join(directory, "sub/dir/file"), data));
+
+  tracker.update();
+  EXPECT_GE(tracker.usage().bytes(), empty.bytes() + 2 * data.size());
+
+  // And removals are accounted for.
+  ASSERT_SOME(os::rmdir(path::join(directory, "sub")));
+  ASSERT_SOME(os::rm(path::join(directory, "file")));
+
+  tracker.update();
+  EXPECT_EQ(empty.bytes(), tracker.usage().bytes());
+
+  os::rmdir(directory);
+}
+
+
+TEST(DiskUsageTest, Growth)
+{
+  const std::string directory = ".disk_usage_test_growth";
+  os::rmdir(directory);
+  ASSERT_SOME(os::mkdir(directory));
+
+  const std::string file = path::join(directory, "log");
+  const std::string data(64 * 1024, 'x');
+  ASSERT_SOME(os::write(file, data));
+
+  DiskUsageTracker tracker(directory);
+  tracker.update();
+  Bytes before = tracker.usage();
+  EXPECT_GE(before.bytes(), data.size());
+
+  // Growing a file in place does not change the directory's mtime,
+  // but the file was recently modified so it is re-examined.
+  ASSERT_SOME(os::write(file, data + data));
+
+  tracker.update();
+  EXPECT_GE(tracker.usage().bytes(), before.bytes() + data.size());
+
+  os::rmdir(directory);
+}
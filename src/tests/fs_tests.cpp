@@ -58,6 +58,30 @@ TEST(FsTest, MountTableRead)
 }
 
 
+TEST(FsTest, MountTableCached)
+{
+  Try<MountTable> table = MountTable::cached();
+
+  ASSERT_SOME(table);
+
+  Option<MountTable::Entry> proc = None();
+  foreach (const MountTable::Entry& entry, table.get().entries) {
+    if (entry.dir == "/proc") {
+      proc = entry;
+    }
+  }
+
+  ASSERT_SOME(proc);
+  EXPECT_EQ(proc.get().type, "proc");
+
+  // A second read without any mount changes serves the same table.
+  Try<MountTable> cached = MountTable::cached();
+
+  ASSERT_SOME(cached);
+  EXPECT_EQ(table.get().entries.size(), cached.get().entries.size());
+}
+
+
 TEST(FsTest, MountTableHasOption)
 {
   Try<MountTable> table = MountTable::read(_PATH_MOUNTED);
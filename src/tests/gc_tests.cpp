@@ -194,6 +194,47 @@ TEST_F(GarbageCollectorTest, Unschedule)
 }
 
 
+TEST_F(GarbageCollectorTest, Evict)
+{
+  GarbageCollector gc;
+
+  // Make some temporary files to gc; file2 is the biggest and hence
+  // the first eviction candidate.
+  const string& file1 = "file1";
+  const string& file2 = "file2";
+
+  ASSERT_SOME(os::touch(file1));
+  ASSERT_SOME(os::write(file2, string(4096, 'X')));
+
+  Clock::pause();
+
+  Future<Nothing> schedule1 = gc.schedule(Seconds(10), file1);
+  Future<Nothing> schedule2 = gc.schedule(Seconds(10), file2);
+
+  Clock::settle();
+
+  // Evicting a single byte removes the biggest candidate, without
+  // waiting for its removal time.
+  ASSERT_FUTURE_WILL_EQ(4096u, gc.evict(1));
+
+  ASSERT_FUTURE_WILL_SUCCEED(schedule2);
+  ASSERT_TRUE(schedule1.isPending());
+
+  EXPECT_FALSE(os::exists(file2));
+  EXPECT_TRUE(os::exists(file1));
+
+  // The remaining schedule still fires on its timer.
+  Clock::advance(Seconds(10));
+  Clock::settle();
+
+  ASSERT_FUTURE_WILL_SUCCEED(schedule1);
+
+  EXPECT_FALSE(os::exists(file1));
+
+  Clock::resume();
+}
+
+
 TEST_F(GarbageCollectorTest, Prune)
 {
   GarbageCollector gc;
@@ -150,6 +150,10 @@ public:
           const FrameworkID&,
           const ExecutorID&));
 
+  MOCK_METHOD1(
+      usages,
+      process::Future<slave::Usages>(const slave::ExecutorSet&));
+
   MOCK_METHOD1(
       recover,
       process::Future<Nothing>(const Option<slave::state::SlaveState>&));
@@ -166,6 +170,9 @@ private:
     EXPECT_CALL(*this, usage(testing::_, testing::_))
       .WillRepeatedly(testing::Return(ResourceStatistics()));
 
+    EXPECT_CALL(*this, usages(testing::_))
+      .WillRepeatedly(testing::Return(slave::Usages()));
+
     EXPECT_CALL(*this, recover(testing::_))
       .WillRepeatedly(testing::Return(Nothing()));
   }
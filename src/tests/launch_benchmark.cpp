@@ -0,0 +1,474 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <mesos/executor.hpp>
+#include <mesos/scheduler.hpp>
+
+#include <process/clock.hpp>
+#include <process/future.hpp>
+#include <process/http.hpp>
+#include <process/pid.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/option.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#include "common/resources.hpp"
+
+#include "master/master.hpp"
+
+#include "slave/flags.hpp"
+
+#include "tests/cluster.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::tests;
+
+using process::Clock;
+using process::Future;
+using process::UPID;
+
+using std::cout;
+using std::endl;
+using std::map;
+using std::string;
+using std::vector;
+
+
+// An end-to-end launch latency benchmark: it drives a configurable
+// launch workload through REAL master, slave and isolator code using
+// the in-process cluster from tests/cluster.hpp, measures the
+// scheduler-observed launch latency (launchTasks to TASK_RUNNING)
+// and breaks the path into per-hop latencies using the message
+// tracing correlation ids (fetched from the '/trace' endpoint after
+// the run). Usage:
+//
+//   mesos-launch-benchmark [slaves] [tasks] [tasks_per_offer]
+//
+// Note that the trace rings are bounded, so the per-hop percentiles
+// are computed over the most recent spans rather than the whole run.
+
+
+// Count of tasks walked through TASK_FINISHED, polled by the main
+// thread while the scheduler callbacks run elsewhere.
+static volatile uint64_t completions = 0;
+
+
+// An executor that walks every task through TASK_RUNNING and
+// TASK_FINISHED immediately: the benchmark measures the launch path,
+// not the workload.
+class BenchmarkExecutor : public Executor
+{
+public:
+  virtual void registered(ExecutorDriver* driver,
+                          const ExecutorInfo& executorInfo,
+                          const FrameworkInfo& frameworkInfo,
+                          const SlaveInfo& slaveInfo) {}
+
+  virtual void reregistered(ExecutorDriver* driver,
+                            const SlaveInfo& slaveInfo) {}
+
+  virtual void disconnected(ExecutorDriver* driver) {}
+
+  virtual void launchTask(ExecutorDriver* driver, const TaskInfo& task)
+  {
+    TaskStatus status;
+    status.mutable_task_id()->MergeFrom(task.task_id());
+    status.set_state(TASK_RUNNING);
+    driver->sendStatusUpdate(status);
+
+    status.set_state(TASK_FINISHED);
+    driver->sendStatusUpdate(status);
+  }
+
+  virtual void killTask(ExecutorDriver* driver, const TaskID& taskId) {}
+
+  virtual void frameworkMessage(ExecutorDriver* driver, const string& data) {}
+
+  virtual void shutdown(ExecutorDriver* driver) {}
+
+  virtual void error(ExecutorDriver* driver, const string& message)
+  {
+    cout << "Executor error: " << message << endl;
+  }
+};
+
+
+// A scripted framework that launches tasks against every offer until
+// it has run its quota, recording when each task was launched so
+// that the TASK_RUNNING update yields the end-to-end latency the
+// scheduler actually experiences.
+class LaunchScheduler : public Scheduler
+{
+public:
+  LaunchScheduler(uint64_t _quota, int _tasksPerOffer)
+    : quota(_quota), tasksPerOffer(_tasksPerOffer), launched(0) {}
+
+  virtual void registered(SchedulerDriver* driver,
+                          const FrameworkID& frameworkId,
+                          const MasterInfo& masterInfo) {}
+
+  virtual void reregistered(SchedulerDriver* driver,
+                            const MasterInfo& masterInfo) {}
+
+  virtual void disconnected(SchedulerDriver* driver) {}
+
+  virtual void resourceOffers(SchedulerDriver* driver,
+                              const vector<Offer>& offers)
+  {
+    double now = Clock::now();
+
+    ExecutorInfo executor;
+    executor.mutable_executor_id()->set_value("default");
+    executor.mutable_command()->set_value("exit 0");
+
+    // Reply to the entire batch with a single multi-offer launch;
+    // offers we assign no tasks to are thereby declined.
+    vector<OfferID> offerIds;
+    vector<TaskInfo> tasks;
+
+    foreach (const Offer& offer, offers) {
+      offerIds.push_back(offer.id());
+
+      for (int i = 0; i < tasksPerOffer && launched < quota; i++) {
+        TaskInfo task;
+        task.set_name("launch");
+        task.mutable_task_id()->set_value(stringify(launched++));
+        task.mutable_slave_id()->MergeFrom(offer.slave_id());
+        task.mutable_resources()->MergeFrom(
+            Resources::parse("cpus:1;mem:512"));
+        task.mutable_executor()->MergeFrom(executor);
+        tasks.push_back(task);
+
+        launches[task.task_id().value()] = now;
+      }
+    }
+
+    driver->launchTasks(offerIds, tasks);
+  }
+
+  virtual void offerRescinded(SchedulerDriver* driver,
+                              const OfferID& offerId) {}
+
+  virtual void statusUpdate(SchedulerDriver* driver, const TaskStatus& status)
+  {
+    if (status.state() == TASK_RUNNING) {
+      latencies.push_back(
+          Clock::now() - launches[status.task_id().value()]);
+    } else if (status.state() == TASK_FINISHED) {
+      __sync_add_and_fetch(&completions, 1);
+    } else if (status.state() == TASK_LOST || status.state() == TASK_FAILED) {
+      cout << "Task " << status.task_id() << " "
+           << TaskState_Name(status.state()) << ": "
+           << status.message() << endl;
+    }
+  }
+
+  virtual void frameworkMessage(SchedulerDriver* driver,
+                                const ExecutorID& executorId,
+                                const SlaveID& slaveId,
+                                const string& data) {}
+
+  virtual void slaveLost(SchedulerDriver* driver, const SlaveID& slaveId) {}
+
+  virtual void executorLost(SchedulerDriver* driver,
+                            const ExecutorID& executorId,
+                            const SlaveID& slaveId,
+                            int status) {}
+
+  virtual void error(SchedulerDriver* driver, const string& message)
+  {
+    cout << "Framework error: " << message << endl;
+  }
+
+  // Callbacks are serialized, so these are only read from outside
+  // once the driver has been stopped.
+  const uint64_t quota;
+  const int tasksPerOffer;
+  uint64_t launched;
+  map<string, double> launches; // Launch time per task id.
+  vector<double> latencies;     // launchTasks to TASK_RUNNING (seconds).
+};
+
+
+// A trace span as rendered by the '/trace' endpoint.
+struct Span
+{
+  string id;      // Correlation id.
+  double time;    // Timestamp (seconds).
+  string process; // Process id.
+  string event;   // E.g., "recv mesos.internal.RunTaskMessage".
+};
+
+
+// Extracts the spans from the (JSON) body of '/trace'. The rendered
+// values contain no escaped characters and keys are emitted in
+// sorted order (event, id, process, time), so plain string scanning
+// suffices (there is no JSON parser in the tree).
+static vector<Span> parseSpans(const string& body)
+{
+  vector<Span> spans;
+
+  size_t offset = 0;
+  while ((offset = body.find("{\"event\":\"", offset)) != string::npos) {
+    Span span;
+
+    size_t begin = offset + strlen("{\"event\":\"");
+    size_t end = body.find('"', begin);
+    if (end == string::npos) {
+      break;
+    }
+    span.event = body.substr(begin, end - begin);
+
+    begin = body.find("\"id\":\"", end);
+    if (begin == string::npos) {
+      break;
+    }
+    begin += strlen("\"id\":\"");
+    end = body.find('"', begin);
+    span.id = body.substr(begin, end - begin);
+
+    begin = body.find("\"process\":\"", end);
+    if (begin == string::npos) {
+      break;
+    }
+    begin += strlen("\"process\":\"");
+    end = body.find('"', begin);
+    span.process = body.substr(begin, end - begin);
+
+    begin = body.find("\"time\":", end);
+    if (begin == string::npos) {
+      break;
+    }
+    span.time = atof(body.c_str() + begin + strlen("\"time\":"));
+
+    spans.push_back(span);
+    offset = end;
+  }
+
+  return spans;
+}
+
+
+static void report(const string& name, vector<double> values)
+{
+  if (values.empty()) {
+    cout << name << ": no samples" << endl;
+    return;
+  }
+
+  std::sort(values.begin(), values.end());
+
+  double sum = 0;
+  foreach (double value, values) {
+    sum += value;
+  }
+
+  cout << name << " (seconds):" << endl;
+  cout << "  min:  " << values.front() << endl;
+  cout << "  p50:  " << values[values.size() / 2] << endl;
+  cout << "  p95:  " << values[(values.size() * 95) / 100] << endl;
+  cout << "  p99:  " << values[(values.size() * 99) / 100] << endl;
+  cout << "  max:  " << values.back() << endl;
+  cout << "  mean: " << sum / values.size() << endl;
+}
+
+
+int main(int argc, char** argv)
+{
+  int numSlaves = argc > 1 ? atoi(argv[1]) : 8;
+  uint64_t numTasks = argc > 2 ? strtoull(argv[2], NULL, 10) : 2000;
+  int tasksPerOffer = argc > 3 ? atoi(argv[3]) : 1;
+
+  cout << "Launching " << numTasks << " tasks across " << numSlaves
+       << " slaves (" << tasksPerOffer << " per offer)" << endl;
+
+  Cluster cluster;
+
+  Try<process::PID<master::Master> > master = cluster.masters.start();
+  if (master.isError()) {
+    cout << "Failed to start master: " << master.error() << endl;
+    return 1;
+  }
+
+  ExecutorID executorId;
+  executorId.set_value("default");
+
+  // Real slaves with the testing isolator: tasks run through
+  // Slave::runTask, the isolator and an in-process executor driver
+  // exactly as production messages would, without forking anything.
+  vector<BenchmarkExecutor*> executors;
+  for (int i = 0; i < numSlaves; i++) {
+    slave::Flags flags = cluster.slaves.flags;
+    flags.work_dir = "/tmp/mesos-launch-benchmark-" + stringify(i);
+    flags.resources =
+      Option<string>::some("cpus:4;mem:8192;disk:65536;ports:[31000-32000]");
+
+    BenchmarkExecutor* executor = new BenchmarkExecutor();
+    executors.push_back(executor);
+
+    Try<process::PID<slave::Slave> > slave =
+      cluster.slaves.start(flags, executorId, executor);
+
+    if (slave.isError()) {
+      cout << "Failed to start slave: " << slave.error() << endl;
+      return 1;
+    }
+  }
+
+  FrameworkInfo framework;
+  framework.set_user("launch");
+  framework.set_name("launch-benchmark");
+
+  LaunchScheduler scheduler(numTasks, tasksPerOffer);
+  MesosSchedulerDriver driver(&scheduler, framework, master.get());
+
+  Stopwatch watch;
+  watch.start();
+
+  driver.start();
+
+  while (__sync_add_and_fetch(&completions, 0) < numTasks) {
+    usleep(10 * 1000);
+  }
+
+  double elapsed = watch.elapsed().secs();
+
+  // Sample the recent trace spans before tearing down. The '/trace'
+  // endpoint is served at the top level, hence the bare 'trace' id.
+  Future<process::http::Response> response = process::http::get(
+      UPID("trace", master.get().ip, master.get().port));
+  response.await();
+
+  driver.stop();
+  driver.join();
+
+  cout << endl;
+  cout << "Ran " << numTasks << " tasks in " << elapsed << " seconds ("
+       << numTasks / elapsed << " tasks/sec)" << endl;
+
+  report("End-to-end launch latency (launchTasks -> TASK_RUNNING)",
+         scheduler.latencies);
+
+  if (response.isReady()) {
+    vector<Span> spans = parseSpans(response.get().body);
+
+    // First timestamp of each launch-path hop per correlation id.
+    // Note that the correlation id is inherited only across message
+    // handlers, so the launch path splits into a launch trace
+    // (scheduler -> master -> slave) and an update trace (slave ->
+    // master -> scheduler); each hop below pairs timestamps within
+    // one trace.
+    typedef map<string, double> Markers;
+    map<string, Markers> traces;
+
+    foreach (const Span& span, spans) {
+      string marker;
+      if (strings::contains(span.event, "send ") &&
+          strings::contains(span.event, "LaunchTasksMessage")) {
+        marker = "launch_send";
+      } else if (strings::contains(span.event, "recv ") &&
+                 strings::contains(span.event, "LaunchTasksMessage")) {
+        marker = "launch_master";
+      } else if (strings::contains(span.event, "recv ") &&
+                 strings::contains(span.event, "RunTask") &&
+                 strings::startsWith(span.process, "slave")) {
+        marker = "run_slave";
+      } else if (strings::contains(span.event, "send ") &&
+                 strings::contains(span.event, "StatusUpdateMessage") &&
+                 span.process != "master") {
+        marker = "update_send";
+      } else if (strings::contains(span.event, "recv ") &&
+                 strings::contains(span.event, "StatusUpdateMessage") &&
+                 span.process == "master") {
+        marker = "update_master";
+      } else if (strings::contains(span.event, "recv ") &&
+                 strings::contains(span.event, "StatusUpdate") &&
+                 strings::startsWith(span.process, "scheduler")) {
+        marker = "update_scheduler";
+      } else {
+        continue;
+      }
+
+      Markers& markers = traces[span.id];
+      if (markers.count(marker) == 0 || span.time < markers[marker]) {
+        markers[marker] = span.time;
+      }
+    }
+
+    vector<double> launchDelivery;
+    vector<double> runDelivery;
+    vector<double> updateDelivery;
+    vector<double> updateForward;
+
+    foreachvalue (const Markers& markers, traces) {
+      if (markers.count("launch_send") && markers.count("launch_master")) {
+        launchDelivery.push_back(
+            markers.find("launch_master")->second -
+            markers.find("launch_send")->second);
+      }
+      if (markers.count("launch_master") && markers.count("run_slave")) {
+        runDelivery.push_back(
+            markers.find("run_slave")->second -
+            markers.find("launch_master")->second);
+      }
+      if (markers.count("update_send") && markers.count("update_master")) {
+        updateDelivery.push_back(
+            markers.find("update_master")->second -
+            markers.find("update_send")->second);
+      }
+      if (markers.count("update_master") &&
+          markers.count("update_scheduler")) {
+        updateForward.push_back(
+            markers.find("update_scheduler")->second -
+            markers.find("update_master")->second);
+      }
+    }
+
+    cout << endl << "Per-hop latencies from " << spans.size()
+         << " recent trace spans:" << endl;
+    report("  scheduler -> master launch delivery", launchDelivery);
+    report("  master -> slave run task delivery", runDelivery);
+    report("  slave -> master status update delivery", updateDelivery);
+    report("  master -> scheduler status update delivery", updateForward);
+  } else {
+    cout << "Failed to fetch '/trace' spans" << endl;
+  }
+
+  cluster.shutdown();
+
+  foreach (BenchmarkExecutor* executor, executors) {
+    delete executor;
+  }
+
+  return 0;
+}
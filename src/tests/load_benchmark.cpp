@@ -0,0 +1,454 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <mesos/scheduler.hpp>
+
+#include <process/clock.hpp>
+#include <process/future.hpp>
+#include <process/http.hpp>
+#include <process/id.hpp>
+#include <process/pid.hpp>
+#include <process/process.hpp>
+#include <process/protobuf.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/none.hpp>
+#include <stout/option.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+#include <stout/uuid.hpp>
+
+#include "common/resources.hpp"
+
+#include "master/master.hpp"
+
+#include "messages/messages.hpp"
+
+#include "tests/cluster.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::tests;
+
+using process::Clock;
+using process::Future;
+using process::UPID;
+
+using std::cout;
+using std::endl;
+using std::map;
+using std::string;
+using std::vector;
+
+
+// A load-test harness that reproduces cluster-scale behavior on one
+// box: it runs one real master (via the in-process cluster machinery
+// from tests/cluster.hpp) against thousands of simulated slaves and
+// one or more scripted framework drivers, then reports re-offer
+// latency, task throughput, and master CPU. Usage:
+//
+//   mesos-load-benchmark [slaves] [tasks] [frameworks]
+//
+// The simulated slaves are lightweight ProtobufProcesses speaking the
+// wire protocol from messages/messages.proto, so the master's side of
+// the protocol (registration, pings, status updates) is exercised
+// exactly as in production, without the cost of real slaves.
+
+
+// Count of simulated slaves that have registered with the master and
+// of tasks they have run to completion, updated atomically since the
+// main thread polls them.
+static volatile uint64_t registrations = 0;
+static volatile uint64_t completions = 0;
+
+
+// A lightweight stand-in for a slave: registers with the master,
+// answers its pings, and runs every task it is sent by immediately
+// walking it through TASK_RUNNING and TASK_FINISHED.
+class SimulatedSlave : public ProtobufProcess<SimulatedSlave>
+{
+public:
+  SimulatedSlave(const UPID& _master, const SlaveInfo& _info)
+    : ProcessBase(ID::generate("sim-slave")),
+      master(_master),
+      info(_info) {}
+
+protected:
+  virtual void initialize()
+  {
+    install<SlaveRegisteredMessage>(
+        &SimulatedSlave::registered,
+        &SlaveRegisteredMessage::slave_id);
+
+    install<RunTaskMessage>(&SimulatedSlave::runTask);
+
+    install<RunTasksMessage>(&SimulatedSlave::runTasks);
+
+    // Acknowledgements and framework shutdowns need no work here
+    // (nothing is retried and nothing actually runs), but installing
+    // handlers keeps the logs free of dropped message warnings.
+    install<StatusUpdateAcknowledgementMessage>(
+        &SimulatedSlave::acknowledgement);
+
+    install<StatusUpdateAcknowledgementsMessage>(
+        &SimulatedSlave::acknowledgements);
+
+    install<ShutdownFrameworkMessage>(&SimulatedSlave::shutdownFramework);
+
+    install<FrameworkToExecutorMessage>(&SimulatedSlave::frameworkMessage);
+
+    install("PING", &SimulatedSlave::ping);
+
+    RegisterSlaveMessage message;
+    message.mutable_slave()->MergeFrom(info);
+    send(master, message);
+  }
+
+  void registered(const SlaveID& slaveId)
+  {
+    id = slaveId;
+    __sync_add_and_fetch(&registrations, 1);
+  }
+
+  void runTask(const RunTaskMessage& message)
+  {
+    statusUpdate(message.framework_id(), message.task().task_id(),
+                 TASK_RUNNING);
+    statusUpdate(message.framework_id(), message.task().task_id(),
+                 TASK_FINISHED);
+
+    __sync_add_and_fetch(&completions, 1);
+  }
+
+  void runTasks(const RunTasksMessage& message)
+  {
+    foreach (const TaskInfo& task, message.tasks()) {
+      statusUpdate(message.framework_id(), task.task_id(), TASK_RUNNING);
+      statusUpdate(message.framework_id(), task.task_id(), TASK_FINISHED);
+
+      __sync_add_and_fetch(&completions, 1);
+    }
+  }
+
+  void acknowledgement(const StatusUpdateAcknowledgementMessage&) {}
+  void acknowledgements(const StatusUpdateAcknowledgementsMessage&) {}
+  void shutdownFramework(const ShutdownFrameworkMessage&) {}
+  void frameworkMessage(const FrameworkToExecutorMessage&) {}
+
+  void ping(const UPID& from, const string& body)
+  {
+    send(from, "PONG");
+  }
+
+private:
+  void statusUpdate(const FrameworkID& frameworkId,
+                    const TaskID& taskId,
+                    TaskState state)
+  {
+    StatusUpdateMessage message;
+    StatusUpdate* update = message.mutable_update();
+    update->mutable_framework_id()->MergeFrom(frameworkId);
+    update->mutable_slave_id()->MergeFrom(id);
+    TaskStatus* status = update->mutable_status();
+    status->mutable_task_id()->MergeFrom(taskId);
+    status->set_state(state);
+    update->set_timestamp(Clock::now());
+    update->set_uuid(UUID::random().toBytes());
+    message.set_pid(self());
+    send(master, message);
+  }
+
+  const UPID master;
+  const SlaveInfo info;
+  SlaveID id;
+};
+
+
+// A scripted framework that launches single-cpu tasks against every
+// offer until it has run its quota, recording each slave's re-offer
+// latency (the time from replying to one of its offers to receiving
+// the next one) — the end-to-end allocation figure a framework
+// actually experiences.
+class LoadScheduler : public Scheduler
+{
+public:
+  LoadScheduler(uint64_t _quota) : quota(_quota), launched(0), finished(0) {}
+
+  virtual void registered(SchedulerDriver* driver,
+                          const FrameworkID& frameworkId,
+                          const MasterInfo& masterInfo) {}
+
+  virtual void reregistered(SchedulerDriver* driver,
+                            const MasterInfo& masterInfo) {}
+
+  virtual void disconnected(SchedulerDriver* driver) {}
+
+  virtual void resourceOffers(SchedulerDriver* driver,
+                              const vector<Offer>& offers)
+  {
+    double now = Clock::now();
+
+    // Reply to the entire batch of offers with a single multi-offer
+    // launch (see SchedulerDriver::launchTasks); offers we assign no
+    // tasks to are thereby declined.
+    vector<OfferID> offerIds;
+    vector<TaskInfo> tasks;
+
+    foreach (const Offer& offer, offers) {
+      const string& slave = offer.slave_id().value();
+      if (offered.count(slave) > 0) {
+        latencies.push_back(now - offered[slave]);
+      }
+      offered[slave] = now;
+
+      offerIds.push_back(offer.id());
+
+      for (int i = 0; i < TASKS_PER_OFFER && launched < quota; i++) {
+        TaskInfo task;
+        task.set_name("load");
+        task.mutable_task_id()->set_value(stringify(launched++));
+        task.mutable_slave_id()->MergeFrom(offer.slave_id());
+        task.mutable_resources()->MergeFrom(
+            Resources::parse("cpus:1;mem:2048"));
+        task.mutable_command()->set_value("exit 0");
+        tasks.push_back(task);
+      }
+    }
+
+    driver->launchTasks(offerIds, tasks);
+  }
+
+  virtual void offerRescinded(SchedulerDriver* driver,
+                              const OfferID& offerId) {}
+
+  virtual void statusUpdate(SchedulerDriver* driver, const TaskStatus& status)
+  {
+    if (status.state() == TASK_FINISHED) {
+      finished++;
+    } else if (status.state() == TASK_LOST) {
+      cout << "Task " << status.task_id() << " lost: "
+           << status.message() << endl;
+    }
+  }
+
+  virtual void frameworkMessage(SchedulerDriver* driver,
+                                const ExecutorID& executorId,
+                                const SlaveID& slaveId,
+                                const string& data) {}
+
+  virtual void slaveLost(SchedulerDriver* driver, const SlaveID& slaveId) {}
+
+  virtual void executorLost(SchedulerDriver* driver,
+                            const ExecutorID& executorId,
+                            const SlaveID& slaveId,
+                            int status) {}
+
+  virtual void error(SchedulerDriver* driver, const string& message)
+  {
+    cout << "Framework error: " << message << endl;
+  }
+
+  // Callbacks are serialized, so these are only read from outside
+  // once the driver has been stopped.
+  static const int TASKS_PER_OFFER = 4;
+
+  const uint64_t quota;
+  uint64_t launched;
+  uint64_t finished;
+  map<string, double> offered;  // Last offer time per slave.
+  vector<double> latencies;     // Re-offer latencies (seconds).
+};
+
+
+// Extracts the master's cumulative event servicing time (in seconds)
+// from the body of /__processes__/stats. The JSON renders each
+// process's 'busy' before its 'id' (keys are ordered), so we search
+// backwards from the master's id.
+static Option<double> busy(const string& body)
+{
+  size_t id = body.find("\"id\":\"master\"");
+  if (id == string::npos) {
+    return None();
+  }
+
+  size_t key = body.rfind("\"busy\":", id);
+  if (key == string::npos) {
+    return None();
+  }
+
+  return atof(body.c_str() + key + strlen("\"busy\":"));
+}
+
+
+static void report(const string& name, vector<double> values)
+{
+  if (values.empty()) {
+    cout << name << ": no samples" << endl;
+    return;
+  }
+
+  std::sort(values.begin(), values.end());
+
+  double sum = 0;
+  foreach (double value, values) {
+    sum += value;
+  }
+
+  cout << name << " (seconds):" << endl;
+  cout << "  min:  " << values.front() << endl;
+  cout << "  p50:  " << values[values.size() / 2] << endl;
+  cout << "  p95:  " << values[(values.size() * 95) / 100] << endl;
+  cout << "  p99:  " << values[(values.size() * 99) / 100] << endl;
+  cout << "  max:  " << values.back() << endl;
+  cout << "  mean: " << sum / values.size() << endl;
+}
+
+
+int main(int argc, char** argv)
+{
+  int numSlaves = argc > 1 ? atoi(argv[1]) : 1000;
+  uint64_t numTasks = argc > 2 ? strtoull(argv[2], NULL, 10) : 10000;
+  int numFrameworks = argc > 3 ? atoi(argv[3]) : 1;
+
+  cout << "Simulating " << numSlaves << " slaves running "
+       << numTasks << " tasks across " << numFrameworks
+       << " framework(s)" << endl;
+
+  Cluster cluster;
+
+  Try<process::PID<master::Master> > master = cluster.masters.start();
+  if (master.isError()) {
+    cout << "Failed to start master: " << master.error() << endl;
+    return 1;
+  }
+
+  // Spawn the simulated slaves and wait for them all to register so
+  // that the measured run starts from a fully subscribed cluster.
+  vector<SimulatedSlave*> slaves;
+  for (int i = 0; i < numSlaves; i++) {
+    SlaveInfo info;
+    info.set_hostname("sim-" + stringify(i));
+    info.mutable_resources()->MergeFrom(
+        Resources::parse("cpus:4;mem:8192;disk:65536;ports:[31000-32000]"));
+
+    SimulatedSlave* slave = new SimulatedSlave(master.get(), info);
+    process::spawn(slave);
+    slaves.push_back(slave);
+  }
+
+  while (__sync_add_and_fetch(&registrations, 0) < (uint64_t) numSlaves) {
+    usleep(10 * 1000);
+  }
+
+  cout << "All slaves registered" << endl;
+
+  vector<LoadScheduler*> schedulers;
+  vector<MesosSchedulerDriver*> drivers;
+
+  Stopwatch watch;
+  watch.start();
+
+  for (int i = 0; i < numFrameworks; i++) {
+    // Spread the task quota across the frameworks, remainder to the
+    // first one.
+    uint64_t quota = numTasks / numFrameworks;
+    if (i == 0) {
+      quota += numTasks % numFrameworks;
+    }
+
+    FrameworkInfo framework;
+    framework.set_user("load");
+    framework.set_name("load-framework-" + stringify(i));
+
+    LoadScheduler* scheduler = new LoadScheduler(quota);
+    MesosSchedulerDriver* driver =
+      new MesosSchedulerDriver(scheduler, framework, master.get());
+    driver->start();
+
+    schedulers.push_back(scheduler);
+    drivers.push_back(driver);
+  }
+
+  while (__sync_add_and_fetch(&completions, 0) < numTasks) {
+    usleep(10 * 1000);
+  }
+
+  double elapsed = watch.elapsed().secs();
+
+  // Sample the master's cumulative busy time before tearing down.
+  Future<process::http::Response> response = process::http::get(
+      UPID("__processes__", master.get().ip, master.get().port), "stats");
+  response.await();
+
+  vector<double> latencies;
+  uint64_t finished = 0;
+  for (int i = 0; i < numFrameworks; i++) {
+    drivers[i]->stop();
+    drivers[i]->join();
+    latencies.insert(latencies.end(),
+                     schedulers[i]->latencies.begin(),
+                     schedulers[i]->latencies.end());
+    finished += schedulers[i]->finished;
+    delete drivers[i];
+    delete schedulers[i];
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double cpu =
+    usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+    usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+
+  cout << endl;
+  cout << "Ran " << numTasks << " tasks in " << elapsed << " seconds ("
+       << numTasks / elapsed << " tasks/sec), "
+       << finished << " TASK_FINISHED updates received" << endl;
+
+  report("Slave re-offer latency", latencies);
+
+  if (response.isReady()) {
+    Option<double> seconds = busy(response.get().body);
+    if (seconds.isSome()) {
+      cout << "Master CPU: " << seconds.get() << " seconds ("
+           << (seconds.get() / elapsed) * 100 << "% of one core)" << endl;
+    }
+  }
+  cout << "Total process CPU: " << cpu << " seconds" << endl;
+
+  foreach (SimulatedSlave* slave, slaves) {
+    process::terminate(slave);
+    process::wait(slave);
+    delete slave;
+  }
+
+  return 0;
+}
@@ -20,6 +20,7 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include <process/clock.hpp>
 #include <process/future.hpp>
@@ -28,8 +29,10 @@
 #include <process/protobuf.hpp>
 #include <process/timeout.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/stringify.hpp>
 
 #include "common/type_utils.hpp"
 
@@ -267,6 +270,195 @@ TEST(ReplicaTest, Recover)
 }
 
 
+TEST(ReplicaTest, TunedStorage)
+{
+  const std::string path = os::getcwd() + "/.log";
+
+  os::rmdir(path);
+
+  StorageOptions options;
+  options.writeBufferSize = 8 * 1024 * 1024;
+  options.blockCacheSize = 4 * 1024 * 1024;
+  options.bloomBits = 10;
+  options.groupSync = true;
+
+  Replica replica(path, options);
+
+  const uint64_t id = 1;
+
+  PromiseRequest request1;
+  request1.set_id(id);
+
+  Future<PromiseResponse> future1 =
+    protocol::promise(replica.pid(), request1);
+
+  future1.await(Seconds(2));
+  ASSERT_TRUE(future1.isReady());
+
+  PromiseResponse response1 = future1.get();
+  EXPECT_TRUE(response1.okay());
+
+  for (uint64_t position = 1; position <= 10; position++) {
+    WriteRequest request2;
+    request2.set_id(id);
+    request2.set_position(position);
+    request2.set_type(Action::APPEND);
+    request2.mutable_append()->set_bytes(stringify(position));
+
+    Future<WriteResponse> future2 =
+      protocol::write(replica.pid(), request2);
+
+    future2.await(Seconds(2));
+    ASSERT_TRUE(future2.isReady());
+
+    WriteResponse response2 = future2.get();
+    EXPECT_TRUE(response2.okay());
+    EXPECT_EQ(position, response2.position());
+  }
+
+  Future<std::list<Action> > actions = replica.read(1, 10);
+  ASSERT_TRUE(actions.await(Seconds(2)));
+  ASSERT_TRUE(actions.isReady());
+  ASSERT_EQ(10u, actions.get().size());
+
+  foreach (const Action& action, actions.get()) {
+    ASSERT_TRUE(action.has_type());
+    ASSERT_EQ(Action::APPEND, action.type());
+    EXPECT_EQ(stringify(action.position()), action.append().bytes());
+  }
+
+  os::rmdir(path);
+}
+
+
+TEST(ReplicaTest, Snapshot)
+{
+  const std::string path = os::getcwd() + "/.log";
+
+  os::rmdir(path);
+
+  {
+    Replica replica(path);
+
+    const uint64_t id = 1;
+
+    PromiseRequest request1;
+    request1.set_id(id);
+
+    Future<PromiseResponse> future1 =
+      protocol::promise(replica.pid(), request1);
+
+    future1.await(Seconds(2));
+    ASSERT_TRUE(future1.isReady());
+    EXPECT_TRUE(future1.get().okay());
+
+    WriteRequest request2;
+    request2.set_id(id);
+    request2.set_position(1);
+    request2.set_type(Action::APPEND);
+    request2.mutable_append()->set_bytes("hello world");
+
+    Future<WriteResponse> future2 =
+      protocol::write(replica.pid(), request2);
+
+    future2.await(Seconds(2));
+    ASSERT_TRUE(future2.isReady());
+    EXPECT_TRUE(future2.get().okay());
+
+    // No snapshot has been installed yet.
+    Future<Option<Snapshot> > none = replica.snapshot();
+    ASSERT_TRUE(none.await(Seconds(2)));
+    ASSERT_TRUE(none.isReady());
+    EXPECT_TRUE(none.get().isNone());
+
+    // Can't install a snapshot past the end of the log.
+    Snapshot bogus;
+    bogus.set_position(2);
+    bogus.set_bytes("state");
+
+    Future<bool> failed = replica.install(bogus);
+    ASSERT_TRUE(failed.await(Seconds(2)));
+    ASSERT_TRUE(failed.isReady());
+    EXPECT_FALSE(failed.get());
+
+    Snapshot snapshot;
+    snapshot.set_position(1);
+    snapshot.set_bytes("state");
+
+    Future<bool> installed = replica.install(snapshot);
+    ASSERT_TRUE(installed.await(Seconds(2)));
+    ASSERT_TRUE(installed.isReady());
+    EXPECT_TRUE(installed.get());
+  }
+
+  // The snapshot should survive a replica restart.
+  {
+    Replica replica(path);
+
+    Future<Option<Snapshot> > option = replica.snapshot();
+    ASSERT_TRUE(option.await(Seconds(2)));
+    ASSERT_TRUE(option.isReady());
+    ASSERT_TRUE(option.get().isSome());
+
+    Snapshot snapshot = option.get().get();
+    EXPECT_EQ(1u, snapshot.position());
+    EXPECT_EQ("state", snapshot.bytes());
+
+    // And reads of the tail still work.
+    Future<std::list<Action> > actions = replica.read(1, 1);
+    ASSERT_TRUE(actions.await(Seconds(2)));
+    ASSERT_TRUE(actions.isReady());
+    ASSERT_EQ(1u, actions.get().size());
+  }
+
+  os::rmdir(path);
+}
+
+
+TEST(NetworkTest, Gather)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+
+  std::set<UPID> pids;
+  pids.insert(replica1.pid());
+  pids.insert(replica2.pid());
+
+  Network network(pids);
+
+  PromiseRequest request;
+  request.set_id(1);
+
+  // A gather completes once a quorum of members has responded.
+  Future<std::list<PromiseResponse> > responses =
+    network.gather(protocol::promise, request, 2);
+
+  ASSERT_TRUE(responses.await(Seconds(2)));
+  ASSERT_TRUE(responses.isReady());
+  EXPECT_EQ(2u, responses.get().size());
+
+  foreach (const PromiseResponse& response, responses.get()) {
+    EXPECT_TRUE(response.okay());
+  }
+
+  // A gather that can never reach a quorum fails immediately.
+  Future<std::list<PromiseResponse> > failed =
+    network.gather(protocol::promise, request, 3);
+
+  ASSERT_TRUE(failed.await(Seconds(2)));
+  EXPECT_TRUE(failed.isFailed());
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+}
+
+
 TEST(CoordinatorTest, Elect)
 {
   const std::string path1 = os::getcwd() + "/.log1";
@@ -356,6 +548,62 @@ TEST(CoordinatorTest, AppendRead)
 }
 
 
+TEST(CoordinatorTest, BufferedAppendRead)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+
+  Network network;
+
+  network.add(replica1.pid());
+  network.add(replica2.pid());
+
+  Coordinator coord(2, &replica1, &network);
+
+  {
+    Result<uint64_t> result = coord.elect(Timeout(Seconds(2)));
+    ASSERT_SOME(result);
+    EXPECT_EQ(0u, result.get());
+  }
+
+  // A buffer can adopt bytes (avoiding a copy) and be shared, and
+  // both the append and any retained copies see the same data.
+  Buffer buffer(new std::string("hello world"));
+  Buffer copy = buffer;
+
+  uint64_t position;
+
+  {
+    Result<uint64_t> result2 = coord.append(buffer, Timeout(Seconds(2)));
+    ASSERT_SOME(result2);
+    position = result2.get();
+    EXPECT_EQ(1u, position);
+  }
+
+  EXPECT_EQ("hello world", copy.bytes());
+
+  {
+    Future<std::list<Action> > actions = replica1.read(position, position);
+    ASSERT_TRUE(actions.await(Seconds(2)));
+    ASSERT_TRUE(actions.isReady());
+    ASSERT_EQ(1u, actions.get().size());
+    EXPECT_EQ(position, actions.get().front().position());
+    ASSERT_TRUE(actions.get().front().has_type());
+    ASSERT_EQ(Action::APPEND, actions.get().front().type());
+    EXPECT_EQ("hello world", actions.get().front().append().bytes());
+  }
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+}
+
+
 TEST(CoordinatorTest, AppendReadError)
 {
   const std::string path1 = os::getcwd() + "/.log1";
@@ -691,6 +939,76 @@ TEST(CoordinatorTest, Fill)
 }
 
 
+TEST(CoordinatorTest, BulkCatchup)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+  const std::string path3 = os::getcwd() + "/.log3";
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+
+  Network network1;
+
+  network1.add(replica1.pid());
+  network1.add(replica2.pid());
+
+  Coordinator coord1(2, &replica1, &network1);
+
+  {
+    Result<uint64_t> result = coord1.elect(Timeout(Seconds(2)));
+    ASSERT_SOME(result);
+    EXPECT_EQ(0u, result.get());
+  }
+
+  for (uint64_t position = 1; position <= 10; position++) {
+    Result<uint64_t> result =
+      coord1.append(stringify(position), Timeout(Seconds(2)));
+    ASSERT_SOME(result);
+    EXPECT_EQ(position, result.get());
+  }
+
+  // A brand new replica should be able to bulk catch up all of the
+  // learned positions from its peer when getting elected.
+  Replica replica3(path3);
+
+  Network network2;
+
+  network2.add(replica2.pid());
+  network2.add(replica3.pid());
+
+  Coordinator coord2(2, &replica3, &network2);
+
+  {
+    Result<uint64_t> result = coord2.elect(Timeout(Seconds(2)));
+    ASSERT_TRUE(result.isNone());
+    result = coord2.elect(Timeout(Seconds(2)));
+    ASSERT_SOME(result);
+    EXPECT_EQ(10u, result.get());
+  }
+
+  {
+    Future<std::list<Action> > actions = replica3.read(1, 10);
+    ASSERT_TRUE(actions.await(Seconds(2)));
+    ASSERT_TRUE(actions.isReady());
+    EXPECT_EQ(10u, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_EQ(stringify(action.position()), action.append().bytes());
+    }
+  }
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+  os::rmdir(path3);
+}
+
+
 TEST(CoordinatorTest, NotLearnedFill)
 {
   DROP_MESSAGES(Eq(LearnedMessage().GetTypeName()), _, _);
@@ -811,6 +1129,58 @@ TEST(CoordinatorTest, MultipleAppends)
 }
 
 
+TEST(CoordinatorTest, PipelinedAppend)
+{
+  const std::string path1 = os::getcwd() + "/.log1";
+  const std::string path2 = os::getcwd() + "/.log2";
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+
+  Replica replica1(path1);
+  Replica replica2(path2);
+
+  Network network;
+
+  network.add(replica1.pid());
+  network.add(replica2.pid());
+
+  Coordinator coord(2, &replica1, &network);
+
+  {
+    Result<uint64_t> result = coord.elect(Timeout(Seconds(2)));
+    ASSERT_SOME(result);
+    EXPECT_EQ(0u, result.get());
+  }
+
+  {
+    std::vector<std::string> entries;
+    for (uint64_t position = 1; position <= 10; position++) {
+      entries.push_back(stringify(position));
+    }
+
+    Result<uint64_t> result = coord.append(entries, Timeout(Seconds(2)));
+    ASSERT_SOME(result);
+    EXPECT_EQ(10u, result.get());
+  }
+
+  {
+    Future<std::list<Action> > actions = replica1.read(1, 10);
+    ASSERT_TRUE(actions.await(Seconds(2)));
+    ASSERT_TRUE(actions.isReady());
+    EXPECT_EQ(10u, actions.get().size());
+    foreach (const Action& action, actions.get()) {
+      ASSERT_TRUE(action.has_type());
+      ASSERT_EQ(Action::APPEND, action.type());
+      EXPECT_EQ(stringify(action.position()), action.append().bytes());
+    }
+  }
+
+  os::rmdir(path1);
+  os::rmdir(path2);
+}
+
+
 TEST(CoordinatorTest, MultipleAppendsNotLearnedFill)
 {
   DROP_MESSAGES(Eq(LearnedMessage().GetTypeName()), _, _);
@@ -926,6 +926,55 @@ TEST_F(WhitelistTest, WhitelistSlave)
 }
 
 
+// An offer left unanswered for --offer_timeout gets rescinded and
+// its resources returned to the allocator, so they are offered
+// again.
+TEST_F(MasterTest, OfferTimeout)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  master::Flags flags = cluster.masters.flags;
+  flags.offer_timeout = Seconds(1.0);
+  Try<PID<Master> > master = cluster.masters.start(flags);
+  ASSERT_SOME(master);
+
+  Try<PID<Slave> > slave = cluster.slaves.start();
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(&sched, DEFAULT_FRAMEWORK_INFO, master.get());
+
+  EXPECT_CALL(sched, registered(&driver, _, _))
+    .Times(1);
+
+  Future<vector<Offer> > offers1;
+  Future<vector<Offer> > offers2;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers1))
+    .WillOnce(FutureArg<1>(&offers2))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_UNTIL(offers1);
+  ASSERT_EQ(1u, offers1.get().size());
+
+  // Sit on the offer: the master rescinds it once the timeout
+  // expires, and the recovered resources get offered again.
+  Future<Nothing> rescinded;
+  EXPECT_CALL(sched, offerRescinded(&driver, offers1.get()[0].id()))
+    .WillOnce(FutureSatisfy(&rescinded));
+
+  AWAIT_UNTIL(rescinded);
+  AWAIT_UNTIL(offers2);
+
+  driver.stop();
+  driver.join();
+
+  cluster.shutdown();
+}
+
+
 TEST_F(MasterTest, MasterLost)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
@@ -0,0 +1,101 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "common/metrics.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using std::map;
+using std::string;
+
+
+TEST(MetricsTest, Counter)
+{
+  metrics::Registry registry;
+
+  metrics::Counter* counter = registry.counter("events");
+  EXPECT_EQ(0u, counter->get());
+
+  counter->increment();
+  counter->increment(41);
+  EXPECT_EQ(42u, counter->get());
+
+  // Lookups under the same name return the same counter.
+  EXPECT_EQ(counter, registry.counter("events"));
+}
+
+
+TEST(MetricsTest, Gauge)
+{
+  metrics::Registry registry;
+
+  metrics::Gauge* gauge = registry.gauge("depth");
+  EXPECT_EQ(0.0, gauge->get());
+
+  gauge->set(3.5);
+  EXPECT_EQ(3.5, gauge->get());
+
+  gauge->set(0.0);
+  EXPECT_EQ(0.0, gauge->get());
+}
+
+
+TEST(MetricsTest, Histogram)
+{
+  metrics::Registry registry;
+
+  metrics::Histogram* histogram = registry.histogram("latency");
+  EXPECT_EQ(0u, histogram->count());
+  EXPECT_EQ(0.0, histogram->percentile(0.5));
+
+  for (int i = 0; i < 99; i++) {
+    histogram->record(10.0); // Bucket [8, 16).
+  }
+  histogram->record(1000.0); // Bucket [512, 1024).
+
+  EXPECT_EQ(100u, histogram->count());
+
+  // Percentiles are upper bucket boundaries.
+  EXPECT_EQ(16.0, histogram->percentile(0.5));
+  EXPECT_EQ(16.0, histogram->percentile(0.99));
+  EXPECT_EQ(1024.0, histogram->percentile(1.0));
+}
+
+
+TEST(MetricsTest, Snapshot)
+{
+  metrics::Registry registry;
+
+  registry.counter("events")->increment(7);
+  registry.gauge("depth")->set(2.0);
+  registry.histogram("latency")->record(10.0);
+
+  map<string, double> snapshot = registry.snapshot();
+
+  EXPECT_EQ(7.0, snapshot["events"]);
+  EXPECT_EQ(2.0, snapshot["depth"]);
+  EXPECT_EQ(1.0, snapshot["latency_count"]);
+  EXPECT_EQ(16.0, snapshot["latency_p50"]);
+  EXPECT_EQ(16.0, snapshot["latency_p99"]);
+}
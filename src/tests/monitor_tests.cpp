@@ -54,6 +54,106 @@ using testing::_;
 using testing::Return;
 
 
+TEST(MonitorTest, Sketch)
+{
+  slave::Sketch sketch;
+
+  EXPECT_EQ(0u, sketch.count);
+  EXPECT_EQ(0.0, sketch.quantile(0.5));
+
+  for (int i = 1; i <= 1000; i++) {
+    sketch.add((double) i);
+  }
+
+  EXPECT_EQ(1000u, sketch.count);
+  EXPECT_EQ(1.0, sketch.min);
+  EXPECT_EQ(1000.0, sketch.max);
+
+  // Quantile estimates are accurate to the (logarithmic) bucket
+  // width: under 10% relative error.
+  EXPECT_NEAR(500.0, sketch.quantile(0.50), 50.0);
+  EXPECT_NEAR(900.0, sketch.quantile(0.90), 90.0);
+  EXPECT_NEAR(990.0, sketch.quantile(0.99), 99.0);
+}
+
+
+// A stable executor's sampling cadence backs off: once enough
+// consecutive samples look identical the monitor starts skipping
+// collection passes for it (see Cadence in slave/monitor.hpp).
+TEST(MonitorTest, Backoff)
+{
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  ExecutorID executorId;
+  executorId.set_value("executor");
+
+  ExecutorInfo executorInfo;
+  executorInfo.mutable_executor_id()->CopyFrom(executorId);
+  executorInfo.mutable_framework_id()->CopyFrom(frameworkId);
+  executorInfo.set_name("name");
+  executorInfo.set_source("source");
+
+  ResourceStatistics statistics;
+  statistics.set_cpu_user_time(5);
+  statistics.set_cpu_system_time(1);
+  statistics.set_memory_rss(1024);
+
+  TestingIsolator isolator;
+
+  process::spawn(isolator);
+
+  slave::Usages usages;
+  usages[frameworkId][executorId] = statistics;
+
+  EXPECT_CALL(isolator, usages(_))
+    .WillRepeatedly(Return(usages));
+
+  slave::ResourceMonitor monitor(&isolator);
+
+  Future<Nothing> watch =
+    FUTURE_DISPATCH(_, &slave::ResourceMonitorProcess::watch);
+
+  monitor.watch(
+      frameworkId,
+      executorId,
+      executorInfo,
+      slave::RESOURCE_MONITORING_INTERVAL);
+
+  AWAIT_READY(watch);
+
+  process::Clock::pause();
+
+  // The first sample sees the rss appear (unstable), then
+  // MONITORING_STABLE_SAMPLES identical samples double the stride,
+  // and one more pass samples at the old countdown.
+  for (int i = 0; i < 2 + slave::MONITORING_STABLE_SAMPLES; i++) {
+    Future<Nothing> collected = FUTURE_DISPATCH(_, &slave::Isolator::usages);
+
+    process::Clock::advance(slave::RESOURCE_MONITORING_INTERVAL);
+    process::Clock::settle();
+
+    AWAIT_READY(collected);
+  }
+
+  // The stride has doubled: the next pass skips the executor...
+  Future<Nothing> collected = FUTURE_DISPATCH(_, &slave::Isolator::usages);
+
+  process::Clock::advance(slave::RESOURCE_MONITORING_INTERVAL);
+  process::Clock::settle();
+
+  EXPECT_TRUE(collected.isPending());
+
+  // ...and the pass after that samples it again.
+  process::Clock::advance(slave::RESOURCE_MONITORING_INTERVAL);
+  process::Clock::settle();
+
+  AWAIT_READY(collected);
+
+  monitor.unwatch(frameworkId, executorId);
+}
+
+
 // TODO(bmahler): Add additional tests:
 //   1. Check that the data has been published to statistics.
 //   2. Check that metering is occurring on subsequent resource data.
@@ -80,8 +180,11 @@ TEST(MonitorTest, WatchUnwatch)
 
   process::spawn(isolator);
 
-  EXPECT_CALL(isolator, usage(frameworkId, executorId))
-    .WillRepeatedly(Return(statistics));
+  slave::Usages usages;
+  usages[frameworkId][executorId] = statistics;
+
+  EXPECT_CALL(isolator, usages(_))
+    .WillRepeatedly(Return(usages));
 
   slave::ResourceMonitor monitor(&isolator);
 
@@ -121,6 +224,7 @@ TEST(MonitorTest, WatchUnwatch)
               "\"resource_usage\":{"
                   "\"cpu_time\":%g,"
                   "\"cpu_usage\":%g,"
+                  "\"disk_used_bytes\":0,"
                   "\"memory_rss\":%lu"
               "},"
               "\"source\":\"source\""
@@ -130,6 +234,15 @@ TEST(MonitorTest, WatchUnwatch)
           statistics.memory_rss()).get(),
       response);
 
+  // The aggregated summary should reflect the collected sample.
+  response = process::http::get(upid, "summary.json");
+
+  EXPECT_RESPONSE_STATUS_WILL_EQ(OK().status, response);
+  EXPECT_RESPONSE_HEADER_WILL_EQ(
+      "application/json",
+      "Content-Type",
+      response);
+
   // Ensure the monitor stops polling the isolator.
   Future<Nothing> unwatch =
     FUTURE_DISPATCH(_, &slave::ResourceMonitorProcess::unwatch);
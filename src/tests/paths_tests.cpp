@@ -107,6 +107,32 @@ TEST_F(PathsTest, format)
       rootDir, slaveId, frameworkId, executorId, uuid, taskId));
 }
 
+
+// The precomputed per-run handle must agree with the formatting
+// helpers for every path it derives.
+TEST_F(PathsTest, RunPaths)
+{
+  RunPaths paths(rootDir, slaveId, frameworkId, executorId, uuid);
+
+  ASSERT_EQ(paths.run, paths::getExecutorRunPath(
+      rootDir, slaveId, frameworkId, executorId, uuid));
+
+  ASSERT_EQ(paths.libprocessPid, paths::getLibprocessPidPath(
+      rootDir, slaveId, frameworkId, executorId, uuid));
+
+  ASSERT_EQ(paths.forkedPid, paths::getForkedPidPath(
+      rootDir, slaveId, frameworkId, executorId, uuid));
+
+  ASSERT_EQ(paths.task(taskId), paths::getTaskPath(
+      rootDir, slaveId, frameworkId, executorId, uuid, taskId));
+
+  ASSERT_EQ(paths.taskInfo(taskId), paths::getTaskInfoPath(
+      rootDir, slaveId, frameworkId, executorId, uuid, taskId));
+
+  ASSERT_EQ(paths.taskUpdates(taskId), paths::getTaskUpdatesPath(
+      rootDir, slaveId, frameworkId, executorId, uuid, taskId));
+}
+
 } // namespace paths {
 } // namespace slave {
 } // namespace internal {
@@ -33,6 +33,7 @@ using namespace mesos::internal;
 
 using proc::CPU;
 using proc::SystemStatus;
+using proc::ProcessStatistics;
 using proc::ProcessStatus;
 
 using std::set;
@@ -165,3 +166,22 @@ TEST(ProcTest, ProcessStatus)
   EXPECT_EQ(getpid(), status.get().pid);
   EXPECT_EQ(getppid(), status.get().ppid);
 }
+
+
+TEST(ProcTest, ProcessStatistics)
+{
+  Try<ProcessStatistics> statistics = proc::statistics();
+
+  ASSERT_SOME(statistics);
+  EXPECT_NE(0u, statistics.get().size());
+
+  set<pid_t> pids;
+  pids.insert(getpid());
+
+  statistics = proc::statistics(pids);
+
+  ASSERT_SOME(statistics);
+  ASSERT_EQ(1u, statistics.get().size());
+  EXPECT_EQ(getpid(), statistics.get().pid[0]);
+  EXPECT_EQ(getppid(), statistics.get().ppid[0]);
+}
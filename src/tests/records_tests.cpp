@@ -0,0 +1,238 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include <gmock/gmock.h>
+
+#include <stout/none.hpp>
+#include <stout/os.hpp>
+#include <stout/result.hpp>
+
+#include "common/records.hpp"
+#include "common/type_utils.hpp"
+
+#include "messages/messages.hpp"
+
+#include "tests/utils.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+
+TEST(RecordsTest, Basic)
+{
+  const std::string file = ".records_test_basic";
+
+  Try<int> result = os::open(file, O_CREAT | O_WRONLY | O_TRUNC,
+                             S_IRUSR | S_IWUSR | S_IRGRP | S_IRWXO);
+
+  ASSERT_SOME(result);
+  int fd = result.get();
+
+  ASSERT_SOME(records::header(fd));
+
+  const size_t writes = 10;
+
+  for (size_t i = 0; i < writes; i++) {
+    FrameworkID frameworkId;
+    frameworkId.set_value(stringify(i));
+    ASSERT_SOME(records::write(fd, frameworkId));
+  }
+
+  ASSERT_SOME(records::footer(fd));
+  os::close(fd);
+
+  ASSERT_TRUE(records::framed(file));
+
+  Try<records::Reader*> open = records::Reader::open(file);
+  ASSERT_SOME(open);
+  records::Reader* reader = open.get();
+
+  Result<FrameworkID> read = None();
+  size_t reads = 0;
+  while (true) {
+    read = reader->read<FrameworkID>();
+    if (!read.isSome()) {
+      break;
+    }
+
+    EXPECT_EQ(read.get().value(), stringify(reads++));
+  }
+
+  // A clean stream ends with 'none', after skipping the footer.
+  ASSERT_TRUE(read.isNone());
+  ASSERT_EQ(writes, reads);
+
+  struct stat s;
+  ASSERT_EQ(0, ::stat(file.c_str(), &s));
+  EXPECT_EQ((size_t) s.st_size, reader->offset());
+
+  delete reader;
+  os::rm(file);
+}
+
+
+TEST(RecordsTest, AppendAfterFooter)
+{
+  const std::string file = ".records_test_append";
+
+  // Simulate a stream written across two sessions (e.g., before and
+  // after a slave restart): each session ends with a footer.
+  for (size_t session = 0; session < 2; session++) {
+    Try<int> result = os::open(file, O_CREAT | O_WRONLY | O_APPEND,
+                               S_IRUSR | S_IWUSR | S_IRGRP | S_IRWXO);
+    ASSERT_SOME(result);
+    int fd = result.get();
+
+    if (session == 0) {
+      ASSERT_SOME(records::header(fd));
+    }
+
+    FrameworkID frameworkId;
+    frameworkId.set_value(stringify(session));
+    ASSERT_SOME(records::write(fd, frameworkId));
+    ASSERT_SOME(records::footer(fd));
+    os::close(fd);
+  }
+
+  Try<records::Reader*> open = records::Reader::open(file);
+  ASSERT_SOME(open);
+  records::Reader* reader = open.get();
+
+  // Both records are replayed; the mid-stream footer is skipped.
+  Result<FrameworkID> read = reader->read<FrameworkID>();
+  ASSERT_SOME(read);
+  EXPECT_EQ("0", read.get().value());
+
+  read = reader->read<FrameworkID>();
+  ASSERT_SOME(read);
+  EXPECT_EQ("1", read.get().value());
+
+  read = reader->read<FrameworkID>();
+  ASSERT_TRUE(read.isNone());
+
+  delete reader;
+  os::rm(file);
+}
+
+
+TEST(RecordsTest, TornTail)
+{
+  const std::string file = ".records_test_torn";
+
+  Try<int> result = os::open(file, O_CREAT | O_WRONLY | O_TRUNC,
+                             S_IRUSR | S_IWUSR | S_IRGRP | S_IRWXO);
+  ASSERT_SOME(result);
+  int fd = result.get();
+
+  ASSERT_SOME(records::header(fd));
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("whole");
+  ASSERT_SOME(records::write(fd, frameworkId));
+
+  // Simulate a torn write: a record whose frame claims more payload
+  // than made it to disk before a crash.
+  uint32_t length = 1024;
+  ASSERT_SOME(os::write(fd, std::string((const char*) &length, 4)));
+  ASSERT_SOME(os::write(fd, "torn"));
+  os::close(fd);
+
+  Try<records::Reader*> open = records::Reader::open(file);
+  ASSERT_SOME(open);
+  records::Reader* reader = open.get();
+
+  // The whole record before the tear is replayed.
+  Result<FrameworkID> read = reader->read<FrameworkID>();
+  ASSERT_SOME(read);
+  EXPECT_EQ("whole", read.get().value());
+
+  // The torn tail is detected rather than parsed as garbage.
+  read = reader->read<FrameworkID>();
+  ASSERT_TRUE(read.isError());
+
+  // Truncating to offset() repairs the stream.
+  size_t offset = reader->offset();
+  delete reader;
+
+  ASSERT_EQ(0, ::truncate(file.c_str(), offset));
+
+  open = records::Reader::open(file);
+  ASSERT_SOME(open);
+  reader = open.get();
+
+  read = reader->read<FrameworkID>();
+  ASSERT_SOME(read);
+  EXPECT_EQ("whole", read.get().value());
+
+  read = reader->read<FrameworkID>();
+  ASSERT_TRUE(read.isNone());
+
+  delete reader;
+  os::rm(file);
+}
+
+
+TEST(RecordsTest, CorruptRecord)
+{
+  const std::string file = ".records_test_corrupt";
+
+  Try<int> result = os::open(file, O_CREAT | O_WRONLY | O_TRUNC,
+                             S_IRUSR | S_IWUSR | S_IRGRP | S_IRWXO);
+  ASSERT_SOME(result);
+  int fd = result.get();
+
+  ASSERT_SOME(records::header(fd));
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("corrupt-me");
+  ASSERT_SOME(records::write(fd, frameworkId));
+  os::close(fd);
+
+  // Flip a byte in the record's payload.
+  Try<std::string> contents = os::read(file);
+  ASSERT_SOME(contents);
+  std::string flipped = contents.get();
+  flipped[flipped.size() - 1] ^= 0xff;
+  ASSERT_SOME(os::write(file, flipped));
+
+  Try<records::Reader*> open = records::Reader::open(file);
+  ASSERT_SOME(open);
+  records::Reader* reader = open.get();
+
+  Result<FrameworkID> read = reader->read<FrameworkID>();
+  ASSERT_TRUE(read.isError());
+
+  delete reader;
+  os::rm(file);
+}
+
+
+TEST(RecordsTest, NotFramed)
+{
+  const std::string file = ".records_test_not_framed";
+
+  // A plain ::protobuf::write() style file is not mistaken for a
+  // framed stream.
+  ASSERT_SOME(os::write(file, "some legacy checkpoint data"));
+  EXPECT_FALSE(records::framed(file));
+  EXPECT_ERROR(records::Reader::open(file));
+
+  os::rm(file);
+}
@@ -0,0 +1,125 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+
+#include <set>
+#include <string>
+
+#include <process/future.hpp>
+#include <process/pid.hpp>
+
+#include <stout/os.hpp>
+
+#include "log/log.hpp"
+
+#include "master/registrar.hpp"
+
+#include "messages/messages.hpp"
+
+#include "tests/utils.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::master;
+using namespace mesos::internal::tests;
+
+using mesos::internal::log::Log;
+
+using process::Future;
+using process::UPID;
+
+
+TEST(RegistrarTest, Recover)
+{
+  const std::string path = os::getcwd() + "/.registry";
+
+  os::rmdir(path);
+
+  Log log(1, path, std::set<UPID>());
+
+  {
+    Registrar registrar(&log);
+
+    // A fresh log recovers an empty registry.
+    Future<Registry> registry = registrar.recover();
+    registry.await(Seconds(10.0));
+    ASSERT_TRUE(registry.isReady());
+    EXPECT_EQ(0, registry.get().slaves().size());
+    EXPECT_EQ(0, registry.get().frameworks().size());
+
+    Registry::Slave slave;
+    slave.mutable_id()->set_value("slave");
+    slave.mutable_info()->set_hostname("localhost");
+    slave.mutable_info()->set_webui_hostname("localhost");
+    slave.set_pid("slave@127.0.0.1:5051");
+
+    Future<bool> admitted = registrar.admitSlave(slave);
+    admitted.await(Seconds(10.0));
+    ASSERT_TRUE(admitted.isReady());
+    EXPECT_TRUE(admitted.get());
+
+    Registry::Framework framework;
+    framework.mutable_id()->set_value("framework");
+    framework.mutable_info()->set_user("user");
+    framework.mutable_info()->set_name("test");
+    framework.set_pid("scheduler@127.0.0.1:5050");
+
+    admitted = registrar.admitFramework(framework);
+    admitted.await(Seconds(10.0));
+    ASSERT_TRUE(admitted.isReady());
+    EXPECT_TRUE(admitted.get());
+  }
+
+  {
+    // A new registrar on the same log (as after a failover) recovers
+    // the journaled membership.
+    Registrar registrar(&log);
+
+    Future<Registry> registry = registrar.recover();
+    registry.await(Seconds(10.0));
+    ASSERT_TRUE(registry.isReady());
+
+    ASSERT_EQ(1, registry.get().slaves().size());
+    EXPECT_EQ("slave", registry.get().slaves(0).id().value());
+    ASSERT_EQ(1, registry.get().frameworks().size());
+    EXPECT_EQ("framework", registry.get().frameworks(0).id().value());
+
+    SlaveID slaveId;
+    slaveId.set_value("slave");
+
+    Future<bool> removed = registrar.removeSlave(slaveId);
+    removed.await(Seconds(10.0));
+    ASSERT_TRUE(removed.isReady());
+    EXPECT_TRUE(removed.get());
+  }
+
+  {
+    // And removals are recovered too.
+    Registrar registrar(&log);
+
+    Future<Registry> registry = registrar.recover();
+    registry.await(Seconds(10.0));
+    ASSERT_TRUE(registry.isReady());
+
+    EXPECT_EQ(0, registry.get().slaves().size());
+    ASSERT_EQ(1, registry.get().frameworks().size());
+  }
+
+  os::rmdir(path);
+}
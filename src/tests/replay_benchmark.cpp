@@ -0,0 +1,207 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <iostream>
+#include <string>
+
+#include <process/future.hpp>
+#include <process/http.hpp>
+#include <process/pid.hpp>
+#include <process/process.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/none.hpp>
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/result.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "master/capture.hpp"
+#include "master/master.hpp"
+
+#include "tests/cluster.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+using namespace mesos::internal::master;
+using namespace mesos::internal::tests;
+
+using process::Future;
+using process::UPID;
+
+using std::cout;
+using std::endl;
+using std::string;
+
+
+// Replays a capture file recorded by a master started with --capture
+// (see master/capture.hpp) into a freshly started standalone master,
+// for profiling and A/B comparison of allocator and sorter changes
+// against real workloads. Usage:
+//
+//   mesos-replay-benchmark <capture> [speedup]
+//
+// where 'speedup' scales the captured inter-arrival gaps (2 halves
+// every gap, 0 replays as fast as possible; default 1, the original
+// cadence). Messages are posted with their captured sender as the
+// 'from' address, so handlers that key state on the sender's pid
+// (framework registration, slave re-registration) behave as in
+// production. The captured senders no longer exist, so everything
+// the master sends back goes nowhere: the replayed load is exactly
+// the captured half of each conversation, which is what the master
+// actually served, but nothing (e.g., offers being declined) drives
+// the protocol any further than the capture did.
+
+
+// Extracts the master's cumulative event servicing time (in seconds)
+// from the body of /__processes__/stats. The JSON renders each
+// process's 'busy' before its 'id' (keys are ordered), so we search
+// backwards from the master's id.
+static Option<double> busy(const string& body)
+{
+  size_t id = body.find("\"id\":\"master\"");
+  if (id == string::npos) {
+    return None();
+  }
+
+  size_t key = body.rfind("\"busy\":", id);
+  if (key == string::npos) {
+    return None();
+  }
+
+  return atof(body.c_str() + key + strlen("\"busy\":"));
+}
+
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    cout << "Usage: " << argv[0] << " <capture> [speedup]" << endl;
+    return 1;
+  }
+
+  const string path = argv[1];
+  double speedup = argc > 2 ? atof(argv[2]) : 1.0;
+
+  Try<capture::Reader*> open = capture::Reader::open(path);
+  if (open.isError()) {
+    cout << "Failed to open capture: " << open.error() << endl;
+    return 1;
+  }
+
+  capture::Reader* reader = open.get();
+
+  Cluster cluster;
+
+  Try<process::PID<master::Master> > master = cluster.masters.start();
+  if (master.isError()) {
+    cout << "Failed to start master: " << master.error() << endl;
+    return 1;
+  }
+
+  cout << "Replaying " << path
+       << (speedup > 0.0
+           ? " at " + stringify(speedup) + "x the captured cadence"
+           : " as fast as possible")
+       << endl;
+
+  Stopwatch watch;
+  watch.start();
+
+  uint64_t messages = 0;
+  Option<double> first = None(); // Timestamp of the first record.
+
+  while (true) {
+    Result<capture::Captured> captured = reader->read();
+
+    if (captured.isError()) {
+      cout << "Stopping replay: " << captured.error() << endl;
+      break;
+    } else if (captured.isNone()) {
+      break;
+    }
+
+    if (speedup > 0.0) {
+      if (first.isNone()) {
+        first = captured.get().secs;
+      }
+
+      // Sleep off whatever remains of this record's (scaled)
+      // inter-arrival gap.
+      double due = (captured.get().secs - first.get()) / speedup;
+      double elapsed = watch.elapsed().secs();
+      if (due > elapsed) {
+        os::sleep(Seconds(due - elapsed));
+      }
+    }
+
+    process::post(
+        captured.get().from,
+        master.get(),
+        captured.get().name,
+        captured.get().body.data(),
+        captured.get().body.size());
+
+    messages++;
+  }
+
+  delete reader;
+
+  // An HTTP request is serviced from the master's mailbox at bulk
+  // priority, so a response means everything posted above has been
+  // handled; then sample the master's cumulative busy time.
+  Future<process::http::Response> drained =
+    process::http::get(master.get(), "state.json");
+  drained.await();
+
+  Future<process::http::Response> response = process::http::get(
+      UPID("__processes__", master.get().ip, master.get().port), "stats");
+  response.await();
+
+  double elapsed = watch.elapsed().secs();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double cpu =
+    usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 +
+    usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+
+  cout << endl;
+  cout << "Replayed " << messages << " messages in " << elapsed
+       << " seconds (" << messages / elapsed << " messages/sec)" << endl;
+
+  if (response.isReady()) {
+    Option<double> seconds = busy(response.get().body);
+    if (seconds.isSome()) {
+      cout << "Master CPU: " << seconds.get() << " seconds ("
+           << (seconds.get() / elapsed) * 100 << "% of one core)" << endl;
+    }
+  }
+  cout << "Total process CPU: " << cpu << " seconds" << endl;
+
+  return 0;
+}
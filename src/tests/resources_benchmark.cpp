@@ -0,0 +1,154 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+
+#include "common/resources.hpp"
+
+using namespace mesos;
+using namespace mesos::internal;
+
+using std::cout;
+using std::endl;
+using std::ostringstream;
+using std::string;
+
+
+// A microbenchmark for the resource math that the master and
+// allocator run in their inner loops: Resources arithmetic and
+// comparison, Value::Ranges coalescing, and Resources::parse. The
+// shapes are meant to be realistic: a few well-known scalars plus a
+// heavily fragmented port range, which is what slaves look like
+// after sustained task churn. Usage:
+//
+//   mesos-resources-benchmark [iterations] [fragments]
+//
+// Reports nanoseconds per operation for each kernel so the numbers
+// can be tracked across releases and used to validate optimization
+// work.
+
+// Returns a resource string with the well-known scalars and a port
+// range fragmented into 'fragments' disjoint pieces.
+static string fragmented(int fragments)
+{
+  ostringstream out;
+  out << "cpus:16;mem:32768;disk:1048576;ports:[";
+
+  for (int i = 0; i < fragments; i++) {
+    if (i > 0) {
+      out << ",";
+    }
+    // Two ports per fragment, with a one port gap between fragments.
+    out << (30000 + (3 * i)) << "-" << (30000 + (3 * i) + 1);
+  }
+
+  out << "]";
+  return out.str();
+}
+
+
+static void report(const string& name, Stopwatch& stopwatch, int count)
+{
+  cout << "  " << name << ": "
+       << (stopwatch.elapsed().ns() / count) << " ns/op" << endl;
+}
+
+
+int main(int argc, char** argv)
+{
+  int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+  int fragments = argc > 2 ? atoi(argv[2]) : 500;
+
+  cout << "Benchmarking resource math with " << iterations
+       << " iterations, " << fragments << " port fragments" << endl;
+
+  const string& description = fragmented(fragments);
+
+  Resources total = Resources::parse(description);
+  Resources task = Resources::parse(
+      "cpus:1;mem:1024;ports:[" +
+      stringify(30000 + 3 * (fragments / 2)) + "-" +
+      stringify(30000 + 3 * (fragments / 2) + 1) + "]");
+
+  Stopwatch stopwatch;
+
+  // Resources::parse of the fragmented description.
+  stopwatch.start();
+  for (int i = 0; i < iterations; i++) {
+    Resources resources = Resources::parse(description);
+  }
+  stopwatch.stop();
+  report("Resources::parse     ", stopwatch, iterations);
+
+  // Addition: merge a task's resources into the total.
+  stopwatch.start();
+  for (int i = 0; i < iterations; i++) {
+    Resources result = total + task;
+  }
+  stopwatch.stop();
+  report("Resources::operator+ ", stopwatch, iterations);
+
+  // Subtraction: carve a task's resources out of the total. This is
+  // the launch path kernel, dominated by the ranges subtraction.
+  stopwatch.start();
+  for (int i = 0; i < iterations; i++) {
+    Resources result = total - task;
+  }
+  stopwatch.stop();
+  report("Resources::operator- ", stopwatch, iterations);
+
+  // Containment: can this task fit in the total?
+  stopwatch.start();
+  for (int i = 0; i < iterations; i++) {
+    if (!(task <= total)) {
+      abort(); // The task always fits; don't let this get elided.
+    }
+  }
+  stopwatch.stop();
+  report("Resources::operator<=", stopwatch, iterations);
+
+  // Steady-state churn: subtract and re-add a task in place, which
+  // exercises the ranges coalescing in values.cpp on every pass.
+  stopwatch.start();
+  for (int i = 0; i < iterations; i++) {
+    total -= task;
+    total += task;
+  }
+  stopwatch.stop();
+  report("launch/finish churn  ", stopwatch, 2 * iterations);
+
+  // Equality of two independently built but equal collections.
+  Resources copy = Resources::parse(description);
+  stopwatch.start();
+  for (int i = 0; i < iterations; i++) {
+    if (!(total == copy)) {
+      abort();
+    }
+  }
+  stopwatch.stop();
+  report("Resources::operator==", stopwatch, iterations);
+
+  return 0;
+}
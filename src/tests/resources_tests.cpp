@@ -87,6 +87,53 @@ TEST(ResourcesTest, Resources)
 }
 
 
+TEST(ResourcesTest, AccessorsAfterMutation)
+{
+  // The scalar accessors are backed by a lazily built index, so make
+  // sure they reflect mutations made after the index was first built.
+  Resources r = Resources::parse("cpus:4;mem:1024");
+
+  EXPECT_SOME_EQ(4.0, r.cpus());
+  EXPECT_SOME_EQ(1024.0, r.mem());
+  EXPECT_TRUE(r.disk().isNone());
+
+  r += Resources::parse("cpus:2;disk:512");
+
+  EXPECT_SOME_EQ(6.0, r.cpus());
+  EXPECT_SOME_EQ(1024.0, r.mem());
+  EXPECT_SOME_EQ(512.0, r.disk());
+
+  r -= Resources::parse("mem:256");
+
+  EXPECT_SOME_EQ(768.0, r.mem());
+
+  Resources copy = r;
+
+  EXPECT_SOME_EQ(6.0, copy.cpus());
+  EXPECT_SOME_EQ(768.0, copy.mem());
+  EXPECT_SOME_EQ(512.0, copy.disk());
+}
+
+
+TEST(ResourcesTest, CopiesAreIndependent)
+{
+  // Copies share their body until one of them is mutated, so make
+  // sure mutation through one copy is never visible through another.
+  Resources r1 = Resources::parse("cpus:4;mem:1024");
+  Resources r2 = r1;
+
+  r1 -= Resources::parse("cpus:2");
+
+  EXPECT_SOME_EQ(2.0, r1.cpus());
+  EXPECT_SOME_EQ(4.0, r2.cpus());
+
+  r2 += Resources::parse("mem:1024");
+
+  EXPECT_SOME_EQ(1024.0, r1.mem());
+  EXPECT_SOME_EQ(2048.0, r2.mem());
+}
+
+
 TEST(ResourcesTest, Printing)
 {
   Resources r = Resources::parse("cpus:45.55;"
@@ -563,6 +610,27 @@ TEST(ResourcesTest, SetSubtraction)
   EXPECT_EQ("sda1", set.item(0));
 }
 
+
+TEST(ResourcesTest, SetCanonicalization)
+{
+  Resource disks1 = Resources::parse("disks", "{sda3,sda1}");
+  Resource disks2 = Resources::parse("disks", "{sda2,sda1}");
+
+  Resources r;
+  r += disks1;
+  r += disks2;
+
+  const Value::Set& set = r.get("disks", Value::Set());
+
+  // Set operations emit their results in sorted order, so a set has
+  // a single canonical form on the wire regardless of the order in
+  // which it was assembled.
+  ASSERT_EQ(3, set.item_size());
+  EXPECT_EQ("sda1", set.item(0));
+  EXPECT_EQ("sda2", set.item(1));
+  EXPECT_EQ("sda3", set.item(2));
+}
+
 TEST(ResourcesTest, EmptyUnequal)
 {
   Resources empty = Resources::parse("");
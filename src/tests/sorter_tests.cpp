@@ -21,12 +21,16 @@
 #include <gmock/gmock.h>
 
 #include "master/drf_sorter.hpp"
+#include "master/hierarchical_drf_sorter.hpp"
+#include "master/incremental_drf_sorter.hpp"
 #include "master/sorter.hpp"
 
 using namespace mesos::internal;
 
 using mesos::internal::master::Sorter;
 using mesos::internal::master::DRFSorter;
+using mesos::internal::master::HierarchicalDRFSorter;
+using mesos::internal::master::IncrementalDRFSorter;
 
 using std::list;
 using std::string;
@@ -45,10 +49,11 @@ void checkSorter(Sorter& sorter, uint32_t count, ...)
 }
 
 
-TEST(SorterTest, DRFSorter)
+// Drives a sorter through a DRF allocation scenario, checking the
+// resulting ordering at each step. Used to verify that every sorter
+// implementing DRF semantics produces identical orderings.
+static void runDRFScenario(Sorter& sorter)
 {
-  DRFSorter sorter;
-
   Resources totalResources = Resources::parse("cpus:100;mem:100");
   sorter.add(totalResources);
 
@@ -124,3 +129,65 @@ TEST(SorterTest, DRFSorter)
 
   checkSorter(sorter, 5, "e", "b", "d", "c", "f");
 }
+
+
+TEST(SorterTest, DRFSorter)
+{
+  DRFSorter sorter;
+  runDRFScenario(sorter);
+}
+
+
+TEST(SorterTest, IncrementalDRFSorter)
+{
+  IncrementalDRFSorter sorter;
+  runDRFScenario(sorter);
+}
+
+
+// With flat (single segment) client names the hierarchical sorter
+// degenerates to plain DRF.
+TEST(SorterTest, HierarchicalDRFSorter)
+{
+  HierarchicalDRFSorter sorter;
+  runDRFScenario(sorter);
+}
+
+
+TEST(SorterTest, HierarchicalDRFSorterTree)
+{
+  HierarchicalDRFSorter sorter;
+
+  sorter.add(Resources::parse("cpus:100;mem:100"));
+
+  sorter.add("eng/a");
+  sorter.add("eng/b");
+  sorter.add("ops/c");
+
+  sorter.allocated("eng/a", Resources::parse("cpus:10;mem:10"));
+  sorter.allocated("eng/b", Resources::parse("cpus:5;mem:5"));
+  sorter.allocated("ops/c", Resources::parse("cpus:20;mem:20"));
+
+  // Subtree shares: eng = .15, ops = .2, so everything under 'eng'
+  // goes before 'ops/c'; within 'eng', b (.05) before a (.1).
+  checkSorter(sorter, 3, "eng/b", "eng/a", "ops/c");
+
+  // Doubling ops' weight halves its effective share (.2 / 2 = .1),
+  // putting its subtree in front of eng's (.15).
+  sorter.weight("ops", 2);
+  checkSorter(sorter, 3, "ops/c", "eng/b", "eng/a");
+
+  sorter.deactivate("eng/b");
+  checkSorter(sorter, 2, "ops/c", "eng/a");
+
+  EXPECT_EQ(sorter.count(), 3);
+
+  sorter.activate("eng/b");
+  sorter.remove("ops/c");
+
+  checkSorter(sorter, 2, "eng/b", "eng/a");
+
+  EXPECT_EQ(sorter.count(), 2);
+  EXPECT_TRUE(sorter.contains("eng/a"));
+  EXPECT_FALSE(sorter.contains("ops/c"));
+}
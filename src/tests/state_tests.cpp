@@ -209,6 +209,88 @@ void Names(State<ProtobufSerializer>* state)
 }
 
 
+void BulkGetSet(State<ProtobufSerializer>* state)
+{
+  std::vector<std::string> names;
+  names.push_back("one");
+  names.push_back("two");
+
+  Future<std::vector<Variable<Slaves> > > variables =
+    state->get<Slaves>(names);
+  ASSERT_FUTURE_WILL_SUCCEED(variables);
+
+  std::vector<Variable<Slaves> > slaves = variables.get();
+  ASSERT_TRUE(slaves.size() == 2);
+  EXPECT_TRUE(slaves[0]->infos().size() == 0);
+  EXPECT_TRUE(slaves[1]->infos().size() == 0);
+
+  SlaveInfo info;
+  info.set_hostname("localhost");
+  info.set_webui_hostname("localhost");
+
+  slaves[0]->add_infos()->MergeFrom(info);
+  slaves[1]->add_infos()->MergeFrom(info);
+
+  Future<std::vector<Option<Variable<Slaves> > > > results =
+    state->set(slaves);
+  ASSERT_FUTURE_WILL_SUCCEED(results);
+
+  ASSERT_TRUE(results.get().size() == 2);
+  EXPECT_SOME(results.get()[0]);
+  EXPECT_SOME(results.get()[1]);
+
+  // The variables we hold are now stale so swapping again must fail.
+  results = state->set(slaves);
+  ASSERT_FUTURE_WILL_SUCCEED(results);
+
+  ASSERT_TRUE(results.get().size() == 2);
+  EXPECT_TRUE(results.get()[0].isNone());
+  EXPECT_TRUE(results.get()[1].isNone());
+
+  variables = state->get<Slaves>(names);
+  ASSERT_FUTURE_WILL_SUCCEED(variables);
+
+  slaves = variables.get();
+  ASSERT_TRUE(slaves.size() == 2);
+  ASSERT_TRUE(slaves[0]->infos().size() == 1);
+  ASSERT_TRUE(slaves[1]->infos().size() == 1);
+  EXPECT_EQ("localhost", slaves[0]->infos(0).hostname());
+  EXPECT_EQ("localhost", slaves[1]->infos(0).hostname());
+}
+
+
+TEST(StateTest, EnvelopeSerializer)
+{
+  typedef EnvelopeSerializer<ProtobufSerializer> Serializer;
+
+  SlaveInfo info;
+  info.set_hostname("localhost");
+  info.set_webui_hostname("localhost");
+
+  // Round trip through the envelope.
+  Try<std::string> value = Serializer::serialize<SlaveInfo>(info);
+  ASSERT_SOME(value);
+  EXPECT_EQ(envelope::MAGIC, value.get()[0]);
+
+  Try<SlaveInfo> enveloped = Serializer::deserialize<SlaveInfo>(value.get());
+  ASSERT_SOME(enveloped);
+  EXPECT_EQ("localhost", enveloped.get().hostname());
+
+  // Values written before the envelope existed read back untouched.
+  Try<std::string> raw = ProtobufSerializer::serialize<SlaveInfo>(info);
+  ASSERT_SOME(raw);
+
+  Try<SlaveInfo> legacy = Serializer::deserialize<SlaveInfo>(raw.get());
+  ASSERT_SOME(legacy);
+  EXPECT_EQ("localhost", legacy.get().hostname());
+
+  // Corruption is detected.
+  std::string corrupt = value.get();
+  corrupt[corrupt.size() - 1] ^= 0xFF;
+  EXPECT_TRUE(Serializer::deserialize<SlaveInfo>(corrupt).isError());
+}
+
+
 class LevelDBStateTest : public ::testing::Test
 {
 public:
@@ -259,6 +341,69 @@ TEST_F(LevelDBStateTest, Names)
 }
 
 
+TEST_F(LevelDBStateTest, BulkGetSet)
+{
+  BulkGetSet(state);
+}
+
+
+// Like LevelDBStateTest but with a flush window so that mutations get
+// batched (group committed) rather than synced one at a time.
+class BatchedLevelDBStateTest : public ::testing::Test
+{
+public:
+  BatchedLevelDBStateTest()
+    : state(NULL), path(os::getcwd() + "/.state") {}
+
+protected:
+  virtual void SetUp()
+  {
+    os::rmdir(path);
+    state = new LevelDBState<ProtobufSerializer>(path, Milliseconds(10.0));
+  }
+
+  virtual void TearDown()
+  {
+    delete state;
+    os::rmdir(path);
+  }
+
+  LevelDBState<ProtobufSerializer>* state;
+
+private:
+  const std::string path;
+};
+
+
+TEST_F(BatchedLevelDBStateTest, GetSetGet)
+{
+  GetSetGet(state);
+}
+
+
+TEST_F(BatchedLevelDBStateTest, GetGetSetSetGet)
+{
+  GetGetSetSetGet(state);
+}
+
+
+TEST_F(BatchedLevelDBStateTest, Names)
+{
+  Names(state);
+}
+
+
+TEST_F(BatchedLevelDBStateTest, Sync)
+{
+  GetSetGet(state);
+
+  // Force a durability barrier for the batched mutations.
+  Future<bool> synced = state->sync();
+  ASSERT_FUTURE_WILL_SUCCEED(synced);
+  EXPECT_TRUE(synced.get());
+}
+
+
 #ifdef MESOS_HAS_JAVA
 class ZooKeeperStateTest : public tests::ZooKeeperTest
 {
@@ -307,4 +452,10 @@ TEST_F(ZooKeeperStateTest, Names)
 {
   Names(state);
 }
+
+
+TEST_F(ZooKeeperStateTest, BulkGetSet)
+{
+  BulkGetSet(state);
+}
 #endif // MESOS_HAS_JAVA
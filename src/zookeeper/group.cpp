@@ -77,6 +77,11 @@ private:
   // Attempts to cache the current set of memberships.
   bool cache();
 
+  // Invalidates any cached data for the member znode at 'path',
+  // unless the znode still exists at the cached version (data watches
+  // can fire spuriously, e.g., when re-set after a reconnect).
+  void invalidate(const string& path);
+
   // Updates any pending watches.
   void update();
 
@@ -161,6 +166,20 @@ private:
   // Cache of owned + unowned, where 'None' represents an invalid
   // cache and 'Some' represents a valid cache.
   Option<set<Group::Membership> > memberships;
+
+  // Per-member cache of znode data, keyed by sequence number and
+  // validated by znode version. Entries are added when data is
+  // fetched (setting a data watch), and removed when the member
+  // leaves the group or its znode changes, so the data of unchanged
+  // members is never re-read.
+  struct CachedData
+  {
+    CachedData() : version(-1) {}
+    int32_t version;
+    string data;
+  };
+
+  map<uint64_t, CachedData> datas;
 };
 
 
@@ -442,8 +461,10 @@ void GroupProcess::reconnecting()
 
 void GroupProcess::expired()
 {
-  // Invalidate the cache.
+  // Invalidate the cache, including all cached member data (the data
+  // watches guarding it died with the session).
   memberships = None();
+  datas.clear();
 
   // Set all owned memberships as cancelled.
   foreachpair (uint64_t sequence, Promise<bool>* cancelled, utils::copy(owned)) {
@@ -470,7 +491,13 @@ void GroupProcess::expired()
 
 void GroupProcess::updated(const string& path)
 {
-  CHECK(znode == path);
+  if (path != znode) {
+    // A data watch on a member's znode fired: invalidate just that
+    // member's cached data so the next Group::data re-reads it (and
+    // re-sets the watch).
+    invalidate(path);
+    return;
+  }
 
   cache(); // Update cache (will invalidate first).
 
@@ -493,6 +520,14 @@ void GroupProcess::created(const string& path)
 
 void GroupProcess::deleted(const string& path)
 {
+  if (path != znode) {
+    // A member's znode was deleted: drop its cached data. The
+    // membership change itself arrives via the child watch on the
+    // group znode (see 'updated' above).
+    invalidate(path);
+    return;
+  }
+
   LOG(FATAL) << "Unexpected ZooKeeper event";
 }
 
@@ -588,14 +623,26 @@ Result<string> GroupProcess::doData(const Group::Membership& membership)
 
   CHECK_SOME(sequence);
 
+  // Serve from the cache when possible; entries get invalidated via
+  // the data watch that is set when fetching (see below).
+  map<uint64_t, CachedData>::const_iterator cached =
+    datas.find(membership.id());
+
+  if (cached != datas.end()) {
+    return cached->second.data;
+  }
+
   string path = znode + "/" + sequence.get();
 
   LOG(INFO) << "Trying to get '" << path << "' in ZooKeeper";
 
-  // Get data associated with ephemeral node.
+  // Get (and cache) the data associated with the ephemeral node,
+  // setting a data watch so the cached copy gets invalidated should
+  // the znode change.
   string result;
+  Stat stat;
 
-  int code = zk->get(path, false, &result, NULL);
+  int code = zk->get(path, true, &result, &stat);
 
   if (code == ZINVALIDSTATE || (code != ZOK && zk->retryable(code))) {
     CHECK(zk->getState() != ZOO_AUTH_FAILED_STATE);
@@ -606,10 +653,46 @@ Result<string> GroupProcess::doData(const Group::Membership& membership)
         "' in ZooKeeper: " + zk->message(code));
   }
 
+  datas[membership.id()].version = stat.version;
+  datas[membership.id()].data = result;
+
   return result;
 }
 
 
+void GroupProcess::invalidate(const string& path)
+{
+  Try<string> basename = os::basename(path);
+
+  if (basename.isError()) {
+    return;
+  }
+
+  Try<uint64_t> sequence = numify<uint64_t>(basename.get());
+
+  if (sequence.isError()) {
+    return;
+  }
+
+  map<uint64_t, CachedData>::iterator cached = datas.find(sequence.get());
+
+  if (cached == datas.end()) {
+    return;
+  }
+
+  // Keep the cached copy if the znode is still at the version we read
+  // it at; otherwise (including when the znode is gone, or we can't
+  // tell) drop it and let the next Group::data re-read.
+  Stat stat;
+
+  int code = zk->exists(path, false, &stat);
+
+  if (code != ZOK || stat.version != cached->second.version) {
+    datas.erase(cached);
+  }
+}
+
+
 bool GroupProcess::cache()
 {
   // Invalidate first (if it's not already).
@@ -647,6 +730,13 @@ bool GroupProcess::cache()
     sequences.insert(sequence.get());
   }
 
+  // Evict cached data for members that are no longer present.
+  foreachpair (uint64_t sequence, const CachedData& data, utils::copy(datas)) {
+    if (sequences.count(sequence) == 0) {
+      datas.erase(sequence); // Okay since iterating over a copy.
+    }
+  }
+
   // Cache current memberships, cancelling those that are now missing.
   set<Group::Membership> current;
 
@@ -672,15 +762,48 @@ bool GroupProcess::cache()
     }
   }
 
-  // Add any remaining (i.e., unexpected) sequences.
+  // Add any remaining (i.e., unexpected) sequences, remembering them
+  // so their data can be prefetched below.
+  vector<uint64_t> added;
+
   foreach (uint64_t sequence, sequences) {
     Promise<bool>* cancelled = new Promise<bool>();
     unowned[sequence] = cancelled;
     current.insert(Group::Membership(sequence, cancelled->future()));
+    added.push_back(sequence);
   }
 
   memberships = current;
 
+  // Pipeline data fetches for just the added members (the data of
+  // unchanged members is still cached), making membership churn cost
+  // proportional to the churn. The fetches set data watches so the
+  // cached copies get invalidated should a member's znode change.
+  // Fetch errors are simply ignored here: the cache stays cold for
+  // those members and Group::data will fetch on demand.
+  if (!added.empty()) {
+    vector<string> paths;
+
+    foreach (uint64_t sequence, added) {
+      Try<string> formatted = strings::format("%.*d", 10, sequence);
+      CHECK_SOME(formatted);
+      paths.push_back(znode + "/" + formatted.get());
+    }
+
+    vector<string> results;
+    vector<Stat> stats;
+    vector<int> codes;
+
+    zk->get(paths, true, &results, &stats, &codes);
+
+    for (size_t i = 0; i < codes.size(); i++) {
+      if (codes[i] == ZOK) {
+        datas[added[i]].version = stats[i].version;
+        datas[added[i]].data = results[i];
+      }
+    }
+  }
+
   return true;
 }
 
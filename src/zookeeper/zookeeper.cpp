@@ -18,9 +18,13 @@
 
 #include <glog/logging.h>
 
+#include <pthread.h>
+
 #include <iostream>
 #include <map>
 
+#include <tr1/functional>
+
 #include <boost/tuple/tuple.hpp>
 
 #include <process/dispatch.hpp>
@@ -485,6 +489,203 @@ private:
 };
 
 
+// Executes a sequence of operations over the asynchronous interface,
+// keeping up to 'window' operations in flight at a time (see
+// ZooKeeper::execute). Deletes itself once the last result has been
+// reported.
+class Pipeline
+{
+public:
+  Pipeline(ZooKeeperImpl* _impl,
+           const vector<ZooKeeper::Operation>& _operations,
+           size_t _window)
+    : impl(_impl),
+      operations(_operations),
+      window(_window),
+      results(_operations.size()),
+      issued(0),
+      completed(0)
+  {
+    pthread_mutex_init(&mutex, NULL);
+  }
+
+  Future<vector<ZooKeeper::OperationResult> > future()
+  {
+    return promise.future();
+  }
+
+  // Issues operations until the window is full (or none remain).
+  void pump()
+  {
+    while (true) {
+      size_t index;
+
+      pthread_mutex_lock(&mutex);
+      if (issued == operations.size() || issued - completed >= window) {
+        pthread_mutex_unlock(&mutex);
+        return;
+      }
+      index = issued++;
+      pthread_mutex_unlock(&mutex);
+
+      issue(index);
+    }
+  }
+
+private:
+  ~Pipeline()
+  {
+    pthread_mutex_destroy(&mutex);
+  }
+
+  void issue(size_t index)
+  {
+    const ZooKeeper::Operation& operation = operations[index];
+    ZooKeeper::OperationResult* result = &results[index];
+
+    Future<int> future;
+
+    switch (operation.type) {
+      case ZooKeeper::Operation::CREATE:
+        future = impl->create(
+            operation.path,
+            operation.data,
+            *CHECK_NOTNULL(operation.acl),
+            operation.flags,
+            &result->data);
+        break;
+      case ZooKeeper::Operation::REMOVE:
+        future = impl->remove(operation.path, operation.version);
+        break;
+      case ZooKeeper::Operation::EXISTS:
+        future = impl->exists(operation.path, operation.watch, &result->stat);
+        break;
+      case ZooKeeper::Operation::GET:
+        future = impl->get(
+            operation.path, operation.watch, &result->data, &result->stat);
+        break;
+      case ZooKeeper::Operation::SET:
+        future = impl->set(operation.path, operation.data, operation.version);
+        break;
+    }
+
+    future.onAny(std::tr1::bind(
+        &Pipeline::finished, this, index, std::tr1::placeholders::_1));
+  }
+
+  void finished(size_t index, const Future<int>& future)
+  {
+    // The underlying completions always report a code; anything else
+    // (e.g., a discarded future) is reported as a system error.
+    results[index].code = future.isReady() ? future.get() : ZSYSTEMERROR;
+
+    pthread_mutex_lock(&mutex);
+    bool done = (++completed == operations.size());
+    pthread_mutex_unlock(&mutex);
+
+    if (done) {
+      promise.set(results);
+      delete this;
+    } else {
+      pump(); // Fill the freed window slot.
+    }
+  }
+
+  ZooKeeperImpl* impl;
+  const vector<ZooKeeper::Operation> operations;
+  const size_t window;
+  vector<ZooKeeper::OperationResult> results;
+
+  // Guards 'issued' and 'completed': operations are issued from the
+  // caller's thread as well as from completion callbacks.
+  pthread_mutex_t mutex;
+  size_t issued;
+  size_t completed;
+
+  Promise<vector<ZooKeeper::OperationResult> > promise;
+};
+
+
+ZooKeeper::Operation ZooKeeper::Operation::create(
+    const string& path,
+    const string& data,
+    const ACL_vector& acl,
+    int flags)
+{
+  Operation operation;
+  operation.type = CREATE;
+  operation.path = path;
+  operation.data = data;
+  operation.acl = &acl;
+  operation.flags = flags;
+  operation.version = -1;
+  operation.watch = false;
+  return operation;
+}
+
+
+ZooKeeper::Operation ZooKeeper::Operation::remove(
+    const string& path,
+    int version)
+{
+  Operation operation;
+  operation.type = REMOVE;
+  operation.path = path;
+  operation.acl = NULL;
+  operation.flags = 0;
+  operation.version = version;
+  operation.watch = false;
+  return operation;
+}
+
+
+ZooKeeper::Operation ZooKeeper::Operation::exists(
+    const string& path,
+    bool watch)
+{
+  Operation operation;
+  operation.type = EXISTS;
+  operation.path = path;
+  operation.acl = NULL;
+  operation.flags = 0;
+  operation.version = -1;
+  operation.watch = watch;
+  return operation;
+}
+
+
+ZooKeeper::Operation ZooKeeper::Operation::get(
+    const string& path,
+    bool watch)
+{
+  Operation operation;
+  operation.type = GET;
+  operation.path = path;
+  operation.acl = NULL;
+  operation.flags = 0;
+  operation.version = -1;
+  operation.watch = watch;
+  return operation;
+}
+
+
+ZooKeeper::Operation ZooKeeper::Operation::set(
+    const string& path,
+    const string& data,
+    int version)
+{
+  Operation operation;
+  operation.type = SET;
+  operation.path = path;
+  operation.data = data;
+  operation.acl = NULL;
+  operation.flags = 0;
+  operation.version = version;
+  operation.watch = false;
+  return operation;
+}
+
+
 ZooKeeper::ZooKeeper(const string& servers,
                      const Duration& timeout,
                      Watcher* watcher)
@@ -573,6 +774,40 @@ int ZooKeeper::get(const string& path, bool watch, string* result, Stat* stat)
 }
 
 
+int ZooKeeper::get(
+    const vector<string>& paths,
+    bool watch,
+    vector<string>* results,
+    vector<Stat>* stats,
+    vector<int>* codes)
+{
+  results->resize(paths.size());
+  stats->resize(paths.size());
+  codes->resize(paths.size());
+
+  // Issue all of the gets first so that they pipeline through the
+  // connection, then wait for the completions in order.
+  vector<Future<int> > futures;
+  futures.reserve(paths.size());
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    futures.push_back(
+        impl->get(paths[i], watch, &(*results)[i], &(*stats)[i]));
+  }
+
+  int code = ZOK;
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    (*codes)[i] = futures[i].get();
+    if (code == ZOK && (*codes)[i] != ZOK && (*codes)[i] != ZNONODE) {
+      code = (*codes)[i];
+    }
+  }
+
+  return code;
+}
+
+
 int ZooKeeper::getChildren(const string& path, bool watch,
                            vector<string>* results)
 {
@@ -586,6 +821,60 @@ int ZooKeeper::set(const string& path, const string& data, int version)
 }
 
 
+int ZooKeeper::set(
+    const vector<string>& paths,
+    const vector<string>& datas,
+    const vector<int>& versions,
+    vector<int>* codes)
+{
+  CHECK(paths.size() == datas.size());
+  CHECK(paths.size() == versions.size());
+
+  codes->resize(paths.size());
+
+  // As with the pipelined get, issue everything before waiting.
+  vector<Future<int> > futures;
+  futures.reserve(paths.size());
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    futures.push_back(impl->set(paths[i], datas[i], versions[i]));
+  }
+
+  int code = ZOK;
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    (*codes)[i] = futures[i].get();
+    if (code == ZOK && (*codes)[i] != ZOK && (*codes)[i] != ZBADVERSION) {
+      code = (*codes)[i];
+    }
+  }
+
+  return code;
+}
+
+
+Future<vector<ZooKeeper::OperationResult> > ZooKeeper::execute(
+    const vector<Operation>& operations,
+    size_t window)
+{
+  CHECK(window > 0);
+
+  if (operations.empty()) {
+    return vector<OperationResult>();
+  }
+
+  Pipeline* pipeline = new Pipeline(impl, operations, window);
+
+  // Grab the future first: the pipeline deletes itself once the last
+  // operation completes, which can happen while we're still pumping.
+  Future<vector<OperationResult> > future = pipeline->future();
+
+  pipeline->pump();
+
+  return future;
+}
+
+
 string ZooKeeper::message(int code) const
 {
   return string(zerror(code));
@@ -31,6 +31,8 @@
 #include <string>
 #include <vector>
 
+#include <process/future.hpp>
+
 #include <stout/duration.hpp>
 
 
@@ -107,6 +109,52 @@ public:
 class ZooKeeper
 {
 public:
+  /**
+   * Describes a single operation for 'execute' (see below). Use the
+   * static constructors, e.g., ZooKeeper::Operation::get(path, watch).
+   */
+  struct Operation
+  {
+    enum Type { CREATE, REMOVE, EXISTS, GET, SET };
+
+    // Note that 'acl' is held by pointer and must remain valid until
+    // the operation has completed (the ACLs used in practice are
+    // statically allocated, e.g., ZOO_OPEN_ACL_UNSAFE).
+    static Operation create(const std::string& path,
+                            const std::string& data,
+                            const ACL_vector& acl,
+                            int flags);
+    static Operation remove(const std::string& path, int version);
+    static Operation exists(const std::string& path, bool watch);
+    static Operation get(const std::string& path, bool watch);
+    static Operation set(const std::string& path,
+                         const std::string& data,
+                         int version);
+
+    Type type;
+    std::string path;
+    std::string data;
+    const ACL_vector* acl;
+    int flags;
+    int version;
+    bool watch;
+  };
+
+  /**
+   * The result of a single operation executed via 'execute' (see
+   * below): the return code (as documented on the corresponding
+   * single-op call), the data read (GET) or the created path
+   * (CREATE), and the node's stat (EXISTS and GET).
+   */
+  struct OperationResult
+  {
+    OperationResult() : code(ZSYSTEMERROR), stat() {}
+
+    int code;
+    std::string data;
+    Stat stat;
+  };
+
   /**
    * \brief instantiate new ZooKeeper client.
    *
@@ -250,6 +298,28 @@ public:
 	  std::string *result,
 	  Stat *stat);
 
+  /**
+   * \brief gets the data associated with several nodes, pipelined.
+   *
+   * Issues all of the (asynchronous) gets before waiting for any of
+   * them, so the total latency is bounded by a single round trip
+   * rather than one round trip per path.
+   *
+   * \param paths the names of the nodes.
+   * \param watch if true, a watch will be set at the server for each
+   * node to notify the client if the node changes.
+   * \param results return values of the nodes, one per path.
+   * \param stats return values of the nodes' stats, one per path.
+   * \param codes per path return codes (see get above).
+   * \return ZOK if every per path code is either ZOK or ZNONODE,
+   * otherwise the first per path code that is neither.
+   */
+  int get(const std::vector<std::string> &paths,
+	  bool watch,
+	  std::vector<std::string> *results,
+	  std::vector<Stat> *stats,
+	  std::vector<int> *codes);
+
   /**
    * \brief lists the children of a node synchronously.
    *
@@ -290,6 +360,47 @@ public:
    */
   int set(const std::string &path, const std::string &data, int version);
 
+  /**
+   * \brief sets the data associated with several nodes, pipelined.
+   *
+   * Issues all of the (asynchronous) sets before waiting for any of
+   * them, so the total latency is bounded by a single round trip
+   * rather than one round trip per path. Note that each set is still
+   * an independent operation: there is no atomicity across paths.
+   *
+   * \param paths the names of the nodes.
+   * \param datas the data to be written, one per path.
+   * \param versions the expected versions, one per path (see set
+   * above).
+   * \param codes per path return codes (see set above).
+   * \return ZOK if every per path code is either ZOK or ZBADVERSION,
+   * otherwise the first per path code that is neither.
+   */
+  int set(const std::vector<std::string> &paths,
+	  const std::vector<std::string> &datas,
+	  const std::vector<int> &versions,
+	  std::vector<int> *codes);
+
+  /**
+   * \brief executes a sequence of operations, pipelined and windowed.
+   *
+   * Submits the operations over the client's asynchronous interface,
+   * keeping up to 'window' operations in flight at a time, so an
+   * N-operation sequence costs on the order of one round trip per
+   * window rather than one per operation. The operations are issued
+   * (and their results reported) in order, but each is independent:
+   * there is no atomicity across operations and later operations are
+   * issued even if earlier ones fail.
+   *
+   * \param operations the operations to execute (see Operation).
+   * \param window maximum number of operations in flight at once.
+   * \return a future of the results, one per operation, that becomes
+   * ready once all of the operations have completed.
+   */
+  process::Future<std::vector<OperationResult> > execute(
+      const std::vector<Operation> &operations,
+      size_t window = 64);
+
   /**
    * \brief return a message describing the return code.
    *
@@ -1,229 +1,404 @@
 #ifndef __ASYNC_HPP__
 #define __ASYNC_HPP__
 
-#include <process/dispatch.hpp>
-#include <process/future.hpp>
-#include <process/id.hpp>
-#include <process/process.hpp>
+#include <pthread.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
 
 #include <tr1/functional>
+#include <tr1/memory>
+
+#include <process/future.hpp>
 
 namespace process {
 
-// TODO(vinod): Merge this into ExecutorProcess.
-// TODO(vinod): Add support for void functions. Currently this is tricky,
-// because Future<void> is not supported.
-class AsyncExecutorProcess : public Process<AsyncExecutorProcess>
+// A persistent pool of threads servicing a bounded two-priority work
+// queue, used to push blocking or compute heavy work (checkpoint
+// I/O, JSON rendering, protobuf decoding) off the libprocess worker
+// threads. async() (below) submits to a single process-wide pool,
+// sized via LIBPROCESS_ASYNC_THREADS with its queue bounded via
+// LIBPROCESS_ASYNC_CAPACITY; subsystems with special needs can
+// instantiate their own.
+class WorkerPool
 {
+public:
+  // Relative priority of submitted work: HIGH work always gets
+  // picked up before LOW work. There are only two classes and no
+  // starvation-avoidance machinery; HIGH is meant for occasional
+  // small latency sensitive tasks, LOW for bulk offload.
+  enum Priority { HIGH, LOW };
+
+  // A snapshot of the pool instrumentation; safe to take from any
+  // thread.
+  struct Stats
+  {
+    Stats()
+      : submitted(0), executed(0), rejected(0),
+        depth(0), watermark(0), busy(0.0) {}
+
+    uint64_t submitted; // Work items ever accepted.
+    uint64_t executed;  // Work items completed.
+    uint64_t rejected;  // Submissions refused (queue full or shutdown).
+    size_t depth;       // Work items currently queued.
+    size_t watermark;   // Queue depth high-water mark.
+    double busy;        // Total seconds threads spent executing work.
+  };
+
+  // Creates a pool of 'threads' threads with at most 'capacity' work
+  // items queued (across both priorities).
+  WorkerPool(size_t threads, size_t capacity);
+
+  // Waits for executing work to finish; queued work that has not
+  // started gets dropped.
+  ~WorkerPool();
+
+  // Submits work for execution, returning false (and dropping the
+  // work) if the queue is at capacity or the pool is shutting down.
+  bool submit(
+      const std::tr1::function<void(void)>& work,
+      Priority priority = LOW);
+
+  Stats stats();
+
+  // The process-wide pool used by async(), created on first use.
+  static WorkerPool* instance();
+
 private:
-  friend class AsyncExecutor;
+  // Entry point for pool threads.
+  static void* worker(void* arg);
 
-  AsyncExecutorProcess() : ProcessBase(ID::generate("__async_executor__")) {}
-  virtual ~AsyncExecutorProcess() {}
+  void run();
 
   // Not copyable, not assignable.
-  AsyncExecutorProcess(const AsyncExecutorProcess&);
-  AsyncExecutorProcess& operator = (const AsyncExecutorProcess&);
+  WorkerPool(const WorkerPool&);
+  WorkerPool& operator = (const WorkerPool&);
 
-  template<typename F>
-  typename std::tr1::result_of<F(void)>::type execute(
-      const F& f)
-  {
-    terminate(self()); // Terminate this process after the function returns.
-    return f();
-  }
+  const size_t capacity;
 
-  // TODO(vinod): Use boost macro enumerations.
-  template<typename F, typename A1>
-  typename std::tr1::result_of<F(A1)>::type execute(
-      const F& f, A1 a1)
-  {
-    terminate(self()); // Terminate this process after the function returns.
-    return f(a1);
-  }
+  // Protects everything below (and is the condition's mutex).
+  pthread_mutex_t mutex;
+  pthread_cond_t condition;
 
-  template<typename F, typename A1, typename A2>
-  typename std::tr1::result_of<F(A1, A2)>::type execute(
-      const F& f, A1 a1, A2 a2)
-  {
-    terminate(self()); // Terminate this process after the function returns.
-    return f(a1, a2);
-  }
+  // Queued work, one queue per priority (indexed by Priority).
+  std::deque<std::tr1::function<void(void)> > queues[2];
 
-  template<typename F, typename A1, typename A2, typename A3>
-  typename std::tr1::result_of<F(A1, A2, A3)>::type execute(
-      const F& f, A1 a1, A2 a2, A3 a3)
-  {
-    terminate(self()); // Terminate this process after the function returns.
-    return f(a1, a2, a3);
-  }
+  std::vector<pthread_t> threads;
 
-  template<typename F, typename A1, typename A2, typename A3, typename A4>
-  typename std::tr1::result_of<F(A1, A2, A3, A4)>::type execute(
-      const F& f, A1 a1, A2 a2, A3 a3, A4 a4)
-  {
-    terminate(self()); // Terminate this process after the function returns.
-    return f(a1, a2, a3, a4);
-  }
+  bool done; // Set in the destructor to shut the pool down.
+
+  // Running totals ('depth' gets filled in by stats()).
+  Stats totals;
 };
 
 
-// This is a wrapper around AsyncExecutorProcess.
-class AsyncExecutor
+namespace internal {
+
+// Wraps a function together with the promise its result fulfills,
+// yielding the nullary closure that actually runs on the pool.
+// TODO(vinod): Use boost macro enumerations.
+template <typename R, typename F>
+struct AsyncTask
 {
-private:
-  // Declare async functions as friends.
-  template<typename F>
-  friend Future<typename std::tr1::result_of<F(void)>::type> async(
-      const F& f);
+  AsyncTask(const std::tr1::shared_ptr<Promise<R> >& _promise, const F& _f)
+    : promise(_promise), f(_f) {}
 
-  template<typename F, typename A1>
-  friend Future<typename std::tr1::result_of<F(A1)>::type> async(
-      const F& f, A1 a1);
+  void operator () ()
+  {
+    try {
+      promise->set(f());
+    } catch (const std::exception& e) {
+      promise->fail(std::string("Caught exception: ") + e.what());
+    } catch (...) {
+      promise->fail("Caught unknown exception");
+    }
+  }
 
-  template<typename F, typename A1, typename A2>
-  friend Future<typename std::tr1::result_of<F(A1, A2)>::type> async(
-      const F& f, A1 a1, A2 a2);
+  std::tr1::shared_ptr<Promise<R> > promise;
+  F f;
+};
 
-  template<typename F, typename A1, typename A2, typename A3>
-  friend Future<typename std::tr1::result_of<F(A1, A2, A3)>::type> async(
-      const F& f, A1 a1, A2 a2, A3 a3);
 
-  template<typename F, typename A1, typename A2, typename A3, typename A4>
-  friend Future<typename std::tr1::result_of<F(A1, A2, A3, A4)>::type> async(
-      const F& f, A1 a1, A2 a2, A3 a3, A4 a4);
+template <typename R, typename F, typename A1>
+struct AsyncTask1
+{
+  AsyncTask1(
+      const std::tr1::shared_ptr<Promise<R> >& _promise,
+      const F& _f,
+      A1 _a1)
+    : promise(_promise), f(_f), a1(_a1) {}
 
-  AsyncExecutor()
+  void operator () ()
   {
-    process = new AsyncExecutorProcess();
-    spawn(process, true); // Automatically GC.
+    try {
+      promise->set(f(a1));
+    } catch (const std::exception& e) {
+      promise->fail(std::string("Caught exception: ") + e.what());
+    } catch (...) {
+      promise->fail("Caught unknown exception");
+    }
   }
 
-  virtual ~AsyncExecutor() {}
+  std::tr1::shared_ptr<Promise<R> > promise;
+  F f;
+  A1 a1;
+};
 
-  // Not copyable, not assignable.
-  AsyncExecutor(const AsyncExecutor&);
-  AsyncExecutor& operator = (const AsyncExecutor&);
 
-  template<typename F>
-  Future<typename std::tr1::result_of<F(void)>::type> execute(
-      const F& f)
+template <typename R, typename F, typename A1, typename A2>
+struct AsyncTask2
+{
+  AsyncTask2(
+      const std::tr1::shared_ptr<Promise<R> >& _promise,
+      const F& _f,
+      A1 _a1,
+      A2 _a2)
+    : promise(_promise), f(_f), a1(_a1), a2(_a2) {}
+
+  void operator () ()
   {
-    // Necessary to disambiguate.
-    typedef typename std::tr1::result_of<F(void)>::type
-        (AsyncExecutorProcess::*R)(const F&);
-
-    return dispatch(process,
-                    static_cast<R>(&AsyncExecutorProcess::execute),
-                    f);
+    try {
+      promise->set(f(a1, a2));
+    } catch (const std::exception& e) {
+      promise->fail(std::string("Caught exception: ") + e.what());
+    } catch (...) {
+      promise->fail("Caught unknown exception");
+    }
   }
 
-  // TODO(vinod): Use boost macro enumerations.
-  template<typename F, typename A1>
-  Future<typename std::tr1::result_of<F(A1)>::type> execute(
-      const F& f, A1 a1)
-  {
-    // Necessary to disambiguate.
-    typedef typename std::tr1::result_of<F(A1)>::type
-        (AsyncExecutorProcess::*R)(const F&, A1);
-
-    return dispatch(process,
-                    static_cast<R>(&AsyncExecutorProcess::execute),
-                    f,
-                    a1);
-  }
+  std::tr1::shared_ptr<Promise<R> > promise;
+  F f;
+  A1 a1;
+  A2 a2;
+};
+
 
-  template<typename F, typename A1, typename A2>
-  Future<typename std::tr1::result_of<F(A1, A2)>::type> execute(
-      const F& f, A1 a1, A2 a2)
+template <typename R, typename F, typename A1, typename A2, typename A3>
+struct AsyncTask3
+{
+  AsyncTask3(
+      const std::tr1::shared_ptr<Promise<R> >& _promise,
+      const F& _f,
+      A1 _a1,
+      A2 _a2,
+      A3 _a3)
+    : promise(_promise), f(_f), a1(_a1), a2(_a2), a3(_a3) {}
+
+  void operator () ()
   {
-    // Necessary to disambiguate.
-    typedef typename std::tr1::result_of<F(A1, A2)>::type
-        (AsyncExecutorProcess::*R)(const F&, A1, A2);
-
-    return dispatch(process,
-                    static_cast<R>(&AsyncExecutorProcess::execute),
-                    f,
-                    a1,
-                    a2);
+    try {
+      promise->set(f(a1, a2, a3));
+    } catch (const std::exception& e) {
+      promise->fail(std::string("Caught exception: ") + e.what());
+    } catch (...) {
+      promise->fail("Caught unknown exception");
+    }
   }
 
-  template<typename F, typename A1, typename A2, typename A3>
-  Future<typename std::tr1::result_of<F(A1, A2, A3)>::type> execute(
-      const F& f, A1 a1, A2 a2, A3 a3)
+  std::tr1::shared_ptr<Promise<R> > promise;
+  F f;
+  A1 a1;
+  A2 a2;
+  A3 a3;
+};
+
+
+template <typename R,
+          typename F,
+          typename A1,
+          typename A2,
+          typename A3,
+          typename A4>
+struct AsyncTask4
+{
+  AsyncTask4(
+      const std::tr1::shared_ptr<Promise<R> >& _promise,
+      const F& _f,
+      A1 _a1,
+      A2 _a2,
+      A3 _a3,
+      A4 _a4)
+    : promise(_promise), f(_f), a1(_a1), a2(_a2), a3(_a3), a4(_a4) {}
+
+  void operator () ()
   {
-    // Necessary to disambiguate.
-    typedef typename std::tr1::result_of<F(A1, A2, A3)>::type
-        (AsyncExecutorProcess::*R)(const F&, A1, A2, A3);
-
-    return dispatch(process,
-                    static_cast<R>(&AsyncExecutorProcess::execute),
-                    f,
-                    a1,
-                    a2,
-                    a3);
+    try {
+      promise->set(f(a1, a2, a3, a4));
+    } catch (const std::exception& e) {
+      promise->fail(std::string("Caught exception: ") + e.what());
+    } catch (...) {
+      promise->fail("Caught unknown exception");
+    }
   }
 
-  template<typename F, typename A1, typename A2, typename A3, typename A4>
-  Future<typename std::tr1::result_of<F(A1, A2, A3, A4)>::type> execute(
-      const F& f, A1 a1, A2 a2, A3 a3, A4 a4)
+  std::tr1::shared_ptr<Promise<R> > promise;
+  F f;
+  A1 a1;
+  A2 a2;
+  A3 a3;
+  A4 a4;
+};
+
+template <typename R,
+          typename F,
+          typename A1,
+          typename A2,
+          typename A3,
+          typename A4,
+          typename A5>
+struct AsyncTask5
+{
+  AsyncTask5(
+      const std::tr1::shared_ptr<Promise<R> >& _promise,
+      const F& _f,
+      A1 _a1,
+      A2 _a2,
+      A3 _a3,
+      A4 _a4,
+      A5 _a5)
+    : promise(_promise), f(_f), a1(_a1), a2(_a2), a3(_a3), a4(_a4), a5(_a5) {}
+
+  void operator () ()
   {
-    // Necessary to disambiguate.
-    typedef typename std::tr1::result_of<F(A1, A2, A3, A4)>::type
-        (AsyncExecutorProcess::*R)(const F&, A1, A2, A3, A4);
-
-    return dispatch(process,
-                    static_cast<R>(&AsyncExecutorProcess::execute),
-                    f,
-                    a1,
-                    a2,
-                    a3,
-                    a4);
+    try {
+      promise->set(f(a1, a2, a3, a4, a5));
+    } catch (const std::exception& e) {
+      promise->fail(std::string("Caught exception: ") + e.what());
+    } catch (...) {
+      promise->fail("Caught unknown exception");
+    }
   }
 
-  AsyncExecutorProcess* process;
+  std::tr1::shared_ptr<Promise<R> > promise;
+  F f;
+  A1 a1;
+  A2 a2;
+  A3 a3;
+  A4 a4;
+  A5 a5;
 };
 
+} // namespace internal {
 
-// Provides an abstraction for asynchronously executing a function.
+
+// Provides an abstraction for asynchronously executing a function on
+// the process-wide worker pool (see WorkerPool above), keeping
+// blocking work off the libprocess worker threads. The returned
+// future fails if the pool's submission queue is saturated.
 // TODO(vinod): Use boost macro to enumerate arguments/params.
-template<typename F>
+template <typename F>
 Future<typename std::tr1::result_of<F(void)>::type>
     async(const F& f)
 {
-  return AsyncExecutor().execute(f);
+  typedef typename std::tr1::result_of<F(void)>::type R;
+
+  std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());
+  Future<R> future = promise->future();
+
+  if (!WorkerPool::instance()->submit(internal::AsyncTask<R, F>(promise, f))) {
+    promise->fail("Worker pool submission queue is saturated");
+  }
+
+  return future;
 }
 
 
-template<typename F, typename A1>
+template <typename F, typename A1>
 Future<typename std::tr1::result_of<F(A1)>::type>
     async(const F& f, A1 a1)
 {
-  return AsyncExecutor().execute(f, a1);
+  typedef typename std::tr1::result_of<F(A1)>::type R;
+
+  std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());
+  Future<R> future = promise->future();
+
+  if (!WorkerPool::instance()->submit(
+          internal::AsyncTask1<R, F, A1>(promise, f, a1))) {
+    promise->fail("Worker pool submission queue is saturated");
+  }
+
+  return future;
 }
 
 
-template<typename F, typename A1, typename A2>
+template <typename F, typename A1, typename A2>
 Future<typename std::tr1::result_of<F(A1, A2)>::type>
     async(const F& f, A1 a1, A2 a2)
 {
-  return AsyncExecutor().execute(f, a1, a2);
+  typedef typename std::tr1::result_of<F(A1, A2)>::type R;
+
+  std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());
+  Future<R> future = promise->future();
+
+  if (!WorkerPool::instance()->submit(
+          internal::AsyncTask2<R, F, A1, A2>(promise, f, a1, a2))) {
+    promise->fail("Worker pool submission queue is saturated");
+  }
+
+  return future;
 }
 
 
-template<typename F, typename A1, typename A2, typename A3>
+template <typename F, typename A1, typename A2, typename A3>
 Future<typename std::tr1::result_of<F(A1, A2, A3)>::type>
     async(const F& f, A1 a1, A2 a2, A3 a3)
 {
-  return AsyncExecutor().execute(f, a1, a2, a3);
+  typedef typename std::tr1::result_of<F(A1, A2, A3)>::type R;
+
+  std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());
+  Future<R> future = promise->future();
+
+  if (!WorkerPool::instance()->submit(
+          internal::AsyncTask3<R, F, A1, A2, A3>(promise, f, a1, a2, a3))) {
+    promise->fail("Worker pool submission queue is saturated");
+  }
+
+  return future;
 }
 
 
-template<typename F, typename A1, typename A2, typename A3, typename A4>
+template <typename F, typename A1, typename A2, typename A3, typename A4>
 Future<typename std::tr1::result_of<F(A1, A2, A3, A4)>::type>
     async(const F& f, A1 a1, A2 a2, A3 a3, A4 a4)
 {
-  return AsyncExecutor().execute(f, a1, a2, a3, a4);
+  typedef typename std::tr1::result_of<F(A1, A2, A3, A4)>::type R;
+
+  std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());
+  Future<R> future = promise->future();
+
+  if (!WorkerPool::instance()->submit(
+          internal::AsyncTask4<R, F, A1, A2, A3, A4>(
+              promise, f, a1, a2, a3, a4))) {
+    promise->fail("Worker pool submission queue is saturated");
+  }
+
+  return future;
+}
+
+
+template <typename F,
+          typename A1,
+          typename A2,
+          typename A3,
+          typename A4,
+          typename A5>
+Future<typename std::tr1::result_of<F(A1, A2, A3, A4, A5)>::type>
+    async(const F& f, A1 a1, A2 a2, A3 a3, A4 a4, A5 a5)
+{
+  typedef typename std::tr1::result_of<F(A1, A2, A3, A4, A5)>::type R;
+
+  std::tr1::shared_ptr<Promise<R> > promise(new Promise<R>());
+  Future<R> future = promise->future();
+
+  if (!WorkerPool::instance()->submit(
+          internal::AsyncTask5<R, F, A1, A2, A3, A4, A5>(
+              promise, f, a1, a2, a3, a4, a5))) {
+    promise->fail("Worker pool submission queue is saturated");
+  }
+
+  return future;
 }
 
 } // namespace process {
@@ -12,8 +12,23 @@ class ProcessBase;
 class Clock
 {
 public:
+  // Returns the current time. When the clock is not paused this is a
+  // coarse timestamp that gets cached once per event loop iteration
+  // rather than read from the kernel on every call (a busy master
+  // asks for the time on every message). Use 'preciseNow' when
+  // sub-iteration accuracy actually matters (e.g., arming timers).
   static double now();
   static double now(ProcessBase* process);
+
+  // Returns the current time read directly from the underlying
+  // clock, bypassing the per-iteration cache. Still respects the
+  // virtualized time of a paused clock.
+  static double preciseNow();
+
+  // Returns the value (in seconds) of a monotonic clock, suitable
+  // for measuring durations without being perturbed by system time
+  // adjustments. Unrelated to the epoch and to a paused clock.
+  static double monotonic();
   static void pause();
   static bool paused();
   static void resume();
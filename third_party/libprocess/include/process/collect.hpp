@@ -4,108 +4,157 @@
 #include <assert.h>
 
 #include <list>
+#include <vector>
+
+#include <tr1/functional>
+#include <tr1/memory>
 
-#include <process/defer.hpp>
-#include <process/delay.hpp>
 #include <process/future.hpp>
-#include <process/process.hpp>
 #include <process/timeout.hpp>
+#include <process/timer.hpp>
 
 #include <stout/none.hpp>
 #include <stout/option.hpp>
 
 namespace process {
 
-// Waits on each future in the specified set and returns the set of
-// resulting values. If any future is discarded then the result will
-// be a failure. Likewise, if any future fails than the result future
-// will be a failure.
+// Waits on each future in the specified set and returns the list of
+// resulting values in the same order as the input. If any future is
+// discarded then the result will be a failure. Likewise, if any
+// future fails then the result future will be a failure.
 template <typename T>
 Future<std::list<T> > collect(
     std::list<Future<T> >& futures,
     const Option<Timeout>& timeout = None());
 
 
+// Waits for each future to complete (become ready, failed or
+// discarded) and returns the futures themselves, in input order.
+// Unlike collect, a failure does not short circuit the wait.
+template <typename T>
+Future<std::list<Future<T> > > awaitAll(std::list<Future<T> >& futures);
+
+
 namespace internal {
 
+// Shared bookkeeping for a collect: an atomic countdown of pending
+// futures plus a flag ensuring exactly one completion, instead of a
+// helper process receiving one dispatch per constituent. Completion
+// happens inline on whichever thread completes the last (or first
+// failing) future, and the values get read back out of the futures
+// themselves at that point (which preserves input order), so nothing
+// gets accumulated per future along the way.
 template <typename T>
-class CollectProcess : public Process<CollectProcess<T> >
+struct Collect
 {
-public:
-  CollectProcess(
-      const std::list<Future<T> >& _futures,
-      const Option<Timeout>& _timeout,
-      Promise<std::list<T> >* _promise)
-    : futures(_futures),
-      timeout(_timeout),
-      promise(_promise) {}
-
-  virtual ~CollectProcess()
+  Collect(const std::list<Future<T> >& _futures)
+    : futures(_futures.begin(), _futures.end()),
+      pending(static_cast<int>(futures.size())),
+      done(0),
+      armed(false) {}
+
+  // Discards the constituents (so any of their associated resources
+  // get cleaned up) and drops our copies of them: a constituent
+  // holds its 'collected' callback which holds this struct which
+  // holds the constituents, so clearing breaks the reference cycle.
+  // Only the thread that won 'done' may invoke this.
+  void abandon()
   {
-    delete promise;
+    for (size_t i = 0; i < futures.size(); i++) {
+      futures[i].discard();
+    }
+    futures.clear();
   }
 
-  virtual void initialize()
-  {
-    // Stop this nonsense if nobody cares.
-    promise->future().onDiscarded(defer(this, &CollectProcess::discarded));
+  std::vector<Future<T> > futures;
+  volatile int pending; // Constituents not yet in a terminal state.
+  volatile int done;    // Set (with a compare-and-swap) by the completer.
 
-    // Only wait as long as requested.
-    if (timeout.isSome()) {
-      delay(timeout.get().remaining(), this, &CollectProcess::timedout);
-    }
+  // Timeout timer, armed before any callbacks get registered (so no
+  // synchronization is needed to read it afterwards).
+  bool armed;
+  Timer timer;
 
-    typename std::list<Future<T> >::const_iterator iterator;
-    for (iterator = futures.begin(); iterator != futures.end(); ++iterator) {
-      (*iterator).onAny(
-          defer(this, &CollectProcess::waited, std::tr1::placeholders::_1));
+  Promise<std::list<T> > promise;
+};
+
+
+template <typename T>
+void collected(
+    const std::tr1::shared_ptr<Collect<T> >& collect,
+    const Future<T>& future)
+{
+  if (future.isFailed() || future.isDiscarded()) {
+    if (__sync_bool_compare_and_swap(&collect->done, 0, 1)) {
+      if (collect->armed) {
+        Timer::cancel(collect->timer);
+      }
+      collect->promise.fail(
+          future.isFailed()
+          ? "Collect failed: " + future.failure()
+          : "Collect failed: future discarded");
+      collect->abandon();
     }
+    return;
   }
 
-private:
-  void discarded()
-  {
-    terminate(this);
-  }
+  assert(future.isReady());
 
-  void timedout()
-  {
-    // Need to discard all of the futures so any of their associated
-    // resources can get properly cleaned up.
-    typename std::list<Future<T> >::const_iterator iterator;
-    for (iterator = futures.begin(); iterator != futures.end(); ++iterator) {
-      Future<T> future = *iterator; // Need a non-const copy to discard.
-      future.discard();
+  if (__sync_sub_and_fetch(&collect->pending, 1) == 0 &&
+      __sync_bool_compare_and_swap(&collect->done, 0, 1)) {
+    if (collect->armed) {
+      Timer::cancel(collect->timer);
     }
-
-    promise->fail("Collect failed: timed out");
-    terminate(this);
+    std::list<T> values;
+    for (size_t i = 0; i < collect->futures.size(); i++) {
+      values.push_back(collect->futures[i].get());
+    }
+    collect->promise.set(values);
+    collect->futures.clear(); // Break the reference cycle (see abandon).
   }
+}
 
-  void waited(const Future<T>& future)
-  {
-    if (future.isFailed()) {
-      promise->fail("Collect failed: " + future.failure());
-      terminate(this);
-    } else if (future.isDiscarded()) {
-      promise->fail("Collect failed: future discarded");
-      terminate(this);
-    } else {
-      assert(future.isReady());
-      values.push_back(future.get());
-      if (futures.size() == values.size()) {
-        promise->set(values);
-        terminate(this);
-      }
-    }
+
+template <typename T>
+void timedout(const std::tr1::shared_ptr<Collect<T> >& collect)
+{
+  if (__sync_bool_compare_and_swap(&collect->done, 0, 1)) {
+    collect->promise.fail("Collect failed: timed out");
+    collect->abandon();
   }
+}
 
-  const std::list<Future<T> > futures;
-  const Option<Timeout> timeout;
-  Promise<std::list<T> >* promise;
-  std::list<T> values;
+
+// Shared bookkeeping for an awaitAll: just the countdown (every
+// terminal state counts, so there is no early completion to race
+// over).
+template <typename T>
+struct Await
+{
+  Await(const std::list<Future<T> >& _futures)
+    : futures(_futures.begin(), _futures.end()),
+      pending(static_cast<int>(futures.size())) {}
+
+  std::vector<Future<T> > futures;
+  volatile int pending;
+
+  Promise<std::list<Future<T> > > promise;
 };
 
+
+template <typename T>
+void awaited(
+    const std::tr1::shared_ptr<Await<T> >& await,
+    const Future<T>& future)
+{
+  if (__sync_sub_and_fetch(&await->pending, 1) == 0) {
+    std::list<Future<T> > futures(
+        await->futures.begin(), await->futures.end());
+    await->promise.set(futures);
+    await->futures.clear(); // Break the reference cycle (see Collect).
+  }
+}
+
 } // namespace internal {
 
 
@@ -114,9 +163,58 @@ inline Future<std::list<T> > collect(
     std::list<Future<T> >& futures,
     const Option<Timeout>& timeout)
 {
-  Promise<std::list<T> >* promise = new Promise<std::list<T> >();
-  Future<std::list<T> > future = promise->future();
-  spawn(new internal::CollectProcess<T>(futures, timeout, promise), true);
+  if (futures.empty()) {
+    return std::list<T>();
+  }
+
+  std::tr1::shared_ptr<internal::Collect<T> > collect(
+      new internal::Collect<T>(futures));
+
+  Future<std::list<T> > future = collect->promise.future();
+
+  // Only wait as long as requested. The timer gets armed before any
+  // callbacks are registered so completers always see it.
+  if (timeout.isSome()) {
+    collect->armed = true;
+    collect->timer = Timer::create(
+        timeout.get().remaining(),
+        std::tr1::bind(&internal::timedout<T>, collect));
+  }
+
+  typename std::list<Future<T> >::const_iterator iterator;
+  for (iterator = futures.begin(); iterator != futures.end(); ++iterator) {
+    (*iterator).onAny(
+        std::tr1::bind(
+            &internal::collected<T>,
+            collect,
+            std::tr1::placeholders::_1));
+  }
+
+  return future;
+}
+
+
+template <typename T>
+inline Future<std::list<Future<T> > > awaitAll(std::list<Future<T> >& futures)
+{
+  if (futures.empty()) {
+    return std::list<Future<T> >();
+  }
+
+  std::tr1::shared_ptr<internal::Await<T> > await(
+      new internal::Await<T>(futures));
+
+  Future<std::list<Future<T> > > future = await->promise.future();
+
+  typename std::list<Future<T> >::const_iterator iterator;
+  for (iterator = futures.begin(); iterator != futures.end(); ++iterator) {
+    (*iterator).onAny(
+        std::tr1::bind(
+            &internal::awaited<T>,
+            await,
+            std::tr1::placeholders::_1));
+  }
+
   return future;
 }
 
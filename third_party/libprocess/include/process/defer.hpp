@@ -68,14 +68,14 @@ defer(const Process<T>* process, void (T::*method)(void))
                 ENUM_PARAMS(N, A)))                                     \
          (const PID<T>&,                                                \
           void (T::*)(ENUM_PARAMS(N, P)),                               \
-          ENUM_PARAMS(N, P))>                                           \
+          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>                 \
   defer(const PID<T>& pid,                                              \
         void (T::*method)(ENUM_PARAMS(N, P)),                           \
-        ENUM_BINARY_PARAMS(N, A, a))                                    \
+        ENUM_BINARY_PARAMS(N, const A, &a))                             \
   {                                                                     \
     void (*dispatch)(const PID<T>&,                                     \
                      void (T::*)(ENUM_PARAMS(N, P)),                    \
-                     ENUM_PARAMS(N, P)) =                               \
+                     ENUM_BINARY_PARAMS(N, const P, & INTERCEPT)) =     \
       &process::template dispatch<T, ENUM_PARAMS(N, P), ENUM_PARAMS(N, P)>; \
     return std::tr1::bind(dispatch, pid, method, ENUM_PARAMS(N, a));    \
   }                                                                     \
@@ -88,10 +88,10 @@ defer(const Process<T>* process, void (T::*method)(void))
                 ENUM_PARAMS(N, A)))                                     \
          (const PID<T>&,                                                \
           void (T::*)(ENUM_PARAMS(N, P)),                               \
-          ENUM_PARAMS(N, P))>                                           \
+          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>                 \
   defer(const Process<T>& process,                                      \
         void (T::*method)(ENUM_PARAMS(N, P)),                           \
-        ENUM_BINARY_PARAMS(N, A, a))                                    \
+        ENUM_BINARY_PARAMS(N, const A, &a))                             \
   {                                                                     \
     return defer(process.self(), method, ENUM_PARAMS(N, a));            \
   }                                                                     \
@@ -104,10 +104,10 @@ defer(const Process<T>* process, void (T::*method)(void))
                 ENUM_PARAMS(N, A)))                                     \
          (const PID<T>&,                                                \
           void (T::*)(ENUM_PARAMS(N, P)),                               \
-          ENUM_PARAMS(N, P))>                                           \
+          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>                 \
   defer(const Process<T>* process,                                      \
         void (T::*method)(ENUM_PARAMS(N, P)),                           \
-        ENUM_BINARY_PARAMS(N, A, a))                                    \
+        ENUM_BINARY_PARAMS(N, const A, &a))                             \
   {                                                                     \
     return defer(process->self(), method, ENUM_PARAMS(N, a));           \
   }
@@ -166,14 +166,14 @@ defer(const Process<T>* process, Future<R> (T::*method)(void))
                      ENUM_PARAMS(N, A)))                                \
          (const PID<T>&,                                                \
           Future<R> (T::*)(ENUM_PARAMS(N, P)),                          \
-          ENUM_PARAMS(N, P))>                                           \
+          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>                 \
   defer(const PID<T>& pid,                                              \
         Future<R> (T::*method)(ENUM_PARAMS(N, P)),                      \
-        ENUM_BINARY_PARAMS(N, A, a))                                    \
+        ENUM_BINARY_PARAMS(N, const A, &a))                             \
   {                                                                     \
     Future<R> (*dispatch)(const PID<T>&,                                \
                           Future<R> (T::*)(ENUM_PARAMS(N, P)),          \
-                          ENUM_PARAMS(N, P)) =                          \
+                          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT)) =\
       &process::template dispatch<R, T, ENUM_PARAMS(N, P), ENUM_PARAMS(N, P)>; \
     return std::tr1::bind(dispatch, pid, method, ENUM_PARAMS(N, a));    \
   }                                                                     \
@@ -187,10 +187,10 @@ defer(const Process<T>* process, Future<R> (T::*method)(void))
                      ENUM_PARAMS(N, A)))                                \
          (const PID<T>&,                                                \
           Future<R> (T::*)(ENUM_PARAMS(N, P)),                          \
-          ENUM_PARAMS(N, P))>                                           \
+          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>                 \
   defer(const Process<T>& process,                                      \
         Future<R> (T::*method)(ENUM_PARAMS(N, P)),                      \
-        ENUM_BINARY_PARAMS(N, A, a))                                    \
+        ENUM_BINARY_PARAMS(N, const A, &a))                             \
   {                                                                     \
     return defer(process.self(), method, ENUM_PARAMS(N, a));            \
   }                                                                     \
@@ -204,10 +204,10 @@ defer(const Process<T>* process, Future<R> (T::*method)(void))
                      ENUM_PARAMS(N, A)))                                \
          (const PID<T>&,                                                \
           Future<R> (T::*)(ENUM_PARAMS(N, P)),                          \
-          ENUM_PARAMS(N, P))>                                           \
+          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>                 \
   defer(const Process<T>* process,                                      \
         Future<R> (T::*method)(ENUM_PARAMS(N, P)),                      \
-        ENUM_BINARY_PARAMS(N, A, a))                                    \
+        ENUM_BINARY_PARAMS(N, const A, &a))                             \
   {                                                                     \
     return defer(process->self(), method, ENUM_PARAMS(N, a));           \
   }
@@ -266,14 +266,14 @@ defer(const Process<T>* process, R (T::*method)(void))
                      ENUM_PARAMS(N, A)))                                \
          (const PID<T>&,                                                \
           R (T::*)(ENUM_PARAMS(N, P)),                                  \
-          ENUM_PARAMS(N, P))>                                           \
+          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>                 \
   defer(const PID<T>& pid,                                              \
         R (T::*method)(ENUM_PARAMS(N, P)),                              \
-        ENUM_BINARY_PARAMS(N, A, a))                                    \
+        ENUM_BINARY_PARAMS(N, const A, &a))                             \
   {                                                                     \
     Future<R> (*dispatch)(const PID<T>&,                                \
                           R (T::*)(ENUM_PARAMS(N, P)),                  \
-                          ENUM_PARAMS(N, P)) =                          \
+                          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT)) =\
       &process::template dispatch<R, T, ENUM_PARAMS(N, P), ENUM_PARAMS(N, P)>; \
     return std::tr1::bind(dispatch, pid, method, ENUM_PARAMS(N, a));    \
   }                                                                     \
@@ -287,10 +287,10 @@ defer(const Process<T>* process, R (T::*method)(void))
                      ENUM_PARAMS(N, A)))                                \
          (const PID<T>&,                                                \
           R (T::*)(ENUM_PARAMS(N, P)),                                  \
-          ENUM_PARAMS(N, P))>                                           \
+          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>                 \
   defer(const Process<T>& process,                                      \
         R (T::*method)(ENUM_PARAMS(N, P)),                              \
-        ENUM_BINARY_PARAMS(N, A, a))                                    \
+        ENUM_BINARY_PARAMS(N, const A, &a))                             \
   {                                                                     \
     return defer(process.self(), method, ENUM_PARAMS(N, a));            \
   }                                                                     \
@@ -304,10 +304,10 @@ defer(const Process<T>* process, R (T::*method)(void))
                      ENUM_PARAMS(N, A)))                                \
          (const PID<T>&,                                                \
           R (T::*)(ENUM_PARAMS(N, P)),                                  \
-          ENUM_PARAMS(N, P))>                                           \
+          ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>                 \
   defer(const Process<T>* process,                                      \
         R (T::*method)(ENUM_PARAMS(N, P)),                              \
-        ENUM_BINARY_PARAMS(N, A, a))                                    \
+        ENUM_BINARY_PARAMS(N, const A, &a))                             \
   {                                                                     \
     return defer(process->self(), method, ENUM_PARAMS(N, a));           \
   }
@@ -343,7 +343,7 @@ inline void dispatcher(
   void CAT(invoker, N)(                                                 \
       ProcessBase* _,                                                   \
       const std::tr1::function<void(ENUM_PARAMS(N, A))>& f,             \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     f(ENUM_PARAMS(N, a));                                               \
   }                                                                     \
@@ -352,7 +352,7 @@ inline void dispatcher(
   void CAT(dispatcher, N)(                                              \
       const UPID& pid,                                                  \
       const std::tr1::function<void(ENUM_PARAMS(N, A))>& f,             \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     std::tr1::shared_ptr<std::tr1::function<void(ProcessBase*)> > invoker( \
         new std::tr1::function<void(ProcessBase*)>(                     \
@@ -73,10 +73,10 @@ private:
                        ENUM_PARAMS(N, A)))                              \
                 (const PID<T>&,                                         \
                  void (T::*)(ENUM_PARAMS(N, P)),                        \
-                 ENUM_PARAMS(N, P))>                                    \
+                 ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>          \
   defer(const PID<T>& pid,                                              \
         void (T::*method)(ENUM_PARAMS(N, P)),                           \
-        ENUM_BINARY_PARAMS(N, A, a));
+        ENUM_BINARY_PARAMS(N, const A, &a));
 
   REPEAT_FROM_TO(1, 11, TEMPLATE, _) // Args A0 -> A9.
 #undef TEMPLATE
@@ -96,10 +96,10 @@ private:
                             ENUM_PARAMS(N, A)))                         \
                 (const PID<T>&,                                         \
                  Future<R> (T::*)(ENUM_PARAMS(N, P)),                   \
-                 ENUM_PARAMS(N, P))>                                    \
+                 ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>          \
   defer(const PID<T>& pid,                                              \
         Future<R> (T::*method)(ENUM_PARAMS(N, P)),                      \
-        ENUM_BINARY_PARAMS(N, A, a));
+        ENUM_BINARY_PARAMS(N, const A, &a));
 
   REPEAT_FROM_TO(1, 11, TEMPLATE, _) // Args A0 -> A9.
 #undef TEMPLATE
@@ -119,10 +119,10 @@ private:
                             ENUM_PARAMS(N, A)))                         \
                 (const PID<T>&,                                         \
                  R (T::*)(ENUM_PARAMS(N, P)),                           \
-                 ENUM_PARAMS(N, P))>                                    \
+                 ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>          \
   defer(const PID<T>& pid,                                              \
         R (T::*method)(ENUM_PARAMS(N, P)),                              \
-        ENUM_BINARY_PARAMS(N, A, a));
+        ENUM_BINARY_PARAMS(N, const A, &a));
 
   REPEAT_FROM_TO(1, 11, TEMPLATE, _) // Args A0 -> A9.
 #undef TEMPLATE
@@ -66,7 +66,7 @@ Timer delay(const Duration& duration,
   Timer delay(const Duration& duration,                                 \
               const PID<T>& pid,                                        \
               void (T::*method)(ENUM_PARAMS(N, P)),                     \
-              ENUM_BINARY_PARAMS(N, A, a))                              \
+              ENUM_BINARY_PARAMS(N, const A, &a))                       \
   {                                                                     \
     std::tr1::shared_ptr<std::tr1::function<void(T*)> > thunk(          \
         new std::tr1::function<void(T*)>(                               \
@@ -95,7 +95,7 @@ Timer delay(const Duration& duration,
   Timer delay(const Duration& duration,                                 \
               const Process<T>& process,                                \
               void (T::*method)(ENUM_PARAMS(N, P)),                     \
-              ENUM_BINARY_PARAMS(N, A, a))                              \
+              ENUM_BINARY_PARAMS(N, const A, &a))                       \
   {                                                                     \
     return delay(duration, process.self(), method, ENUM_PARAMS(N, a));  \
   }                                                                     \
@@ -106,7 +106,7 @@ Timer delay(const Duration& duration,
   Timer delay(const Duration& duration,                                 \
               const Process<T>* process,                                \
               void (T::*method)(ENUM_PARAMS(N, P)),                     \
-              ENUM_BINARY_PARAMS(N, A, a))                              \
+              ENUM_BINARY_PARAMS(N, const A, &a))                       \
   {                                                                     \
     return delay(duration, process->self(), method, ENUM_PARAMS(N, a)); \
   }
@@ -117,6 +117,14 @@ std::string canonicalize(Method method)
 // preprocessor macros are effectively providing. Using C++11 closures
 // would shorten these definitions even more.
 //
+// Note that the arguments are accepted by const reference (the
+// 'const A, &a' expansion below) so that each argument is only copied
+// once, into the bound thunk, rather than also being copied into the
+// dispatch parameters themselves (which matters when dispatching
+// large values like a vector of tasks). Actually forwarding arguments
+// by move requires the C++11 rvalue references shown in the variadic
+// versions.
+//
 // First, definitions of dispatch for methods returning void:
 //
 // template <typename T, typename ...P>
@@ -181,7 +189,7 @@ void dispatch(
   void dispatch(                                                        \
       const PID<T>& pid,                                                \
       void (T::*method)(ENUM_PARAMS(N, P)),                             \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     std::tr1::shared_ptr<std::tr1::function<void(T*)> > thunk(          \
         new std::tr1::function<void(T*)>(                               \
@@ -204,7 +212,7 @@ void dispatch(
   void dispatch(                                                        \
       const Process<T>& process,                                        \
       void (T::*method)(ENUM_PARAMS(N, P)),                             \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     dispatch(process.self(), method, ENUM_PARAMS(N, a));                \
   }                                                                     \
@@ -215,7 +223,7 @@ void dispatch(
   void dispatch(                                                        \
       const Process<T>* process,                                        \
       void (T::*method)(ENUM_PARAMS(N, P)),                             \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     dispatch(process->self(), method, ENUM_PARAMS(N, a));               \
   }
@@ -299,7 +307,7 @@ Future<R> dispatch(
   Future<R> dispatch(                                                   \
       const PID<T>& pid,                                                \
       Future<R> (T::*method)(ENUM_PARAMS(N, P)),                        \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     std::tr1::shared_ptr<std::tr1::function<Future<R>(T*)> > thunk(     \
         new std::tr1::function<Future<R>(T*)>(                          \
@@ -328,7 +336,7 @@ Future<R> dispatch(
   Future<R> dispatch(                                                   \
       const Process<T>& process,                                        \
       Future<R> (T::*method)(ENUM_PARAMS(N, P)),                        \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     return dispatch(process.self(), method, ENUM_PARAMS(N, a));         \
   }                                                                     \
@@ -340,7 +348,7 @@ Future<R> dispatch(
   Future<R> dispatch(                                                   \
       const Process<T>* process,                                        \
       Future<R> (T::*method)(ENUM_PARAMS(N, P)),                        \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     return dispatch(process->self(), method, ENUM_PARAMS(N, a));        \
   }
@@ -424,7 +432,7 @@ Future<R> dispatch(
   Future<R> dispatch(                                                   \
       const PID<T>& pid,                                                \
       R (T::*method)(ENUM_PARAMS(N, P)),                                \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     std::tr1::shared_ptr<std::tr1::function<R(T*)> > thunk(             \
         new std::tr1::function<R(T*)>(                                  \
@@ -453,7 +461,7 @@ Future<R> dispatch(
   Future<R> dispatch(                                                   \
       const Process<T>& process,                                        \
       R (T::*method)(ENUM_PARAMS(N, P)),                                \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     return dispatch(process.self(), method, ENUM_PARAMS(N, a));         \
   }                                                                     \
@@ -465,7 +473,7 @@ Future<R> dispatch(
   Future<R> dispatch(                                                   \
       const Process<T>* process,                                        \
       R (T::*method)(ENUM_PARAMS(N, P)),                                \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     return dispatch(process->self(), method, ENUM_PARAMS(N, a));        \
   }
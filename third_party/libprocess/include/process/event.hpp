@@ -7,6 +7,7 @@
 #include <process/future.hpp>
 #include <process/http.hpp>
 #include <process/message.hpp>
+#include <process/pool.hpp>
 #include <process/socket.hpp>
 
 namespace process {
@@ -31,63 +32,76 @@ struct EventVisitor
 };
 
 
+// The event hierarchy is sealed (exactly the five kinds below), so
+// rather than paying for virtual double dispatch on every delivered
+// event we carry a type index and dispatch through a switch, which
+// the compiler turns into a jump table. Events therefore have no
+// vtable at all: 'visit', 'is'/'as' and destruction all key off
+// 'kind'. Dispose of an Event* via destroy() (below), never 'delete';
+// the destructor is protected to enforce this (and so that the
+// class-specific operator delete on the pooled subclasses is used).
 struct Event
 {
-  virtual ~Event() {}
+  enum Kind
+  {
+    MESSAGE,
+    DISPATCH,
+    HTTP,
+    EXITED,
+    TERMINATE
+  };
+
+  const Kind kind;
+
+  // Intrusive link used by the per-process mailbox (see
+  // process/mailbox.hpp); only ever touched by the mailbox.
+  Event* next;
+
+  // Dispatches to the visitor overload for the concrete kind (defined
+  // after the subclasses, since it needs their definitions).
+  inline void visit(EventVisitor* visitor) const;
 
-  virtual void visit(EventVisitor* visitor) const = 0;
+  // Time (in seconds) at which the event was enqueued on a process,
+  // set by ProcessBase::enqueue and used for dispatch latency
+  // instrumentation (see the /__processes__/stats endpoint).
+  double enqueued;
 
   template <typename T>
-  bool is() const
-  {
-    bool result = false;
-    struct IsVisitor : EventVisitor
-    {
-      IsVisitor(bool* _result) : result(_result) {}
-      virtual void visit(const T& t) { *result = true; }
-      bool* result;
-    } visitor(&result);
-    visit(&visitor);
-    return result;
-  }
+  inline bool is() const;
 
   template <typename T>
-  const T& as() const
-  {
-    const T* result = NULL;
-    struct AsVisitor : EventVisitor
-    {
-      AsVisitor(const T** _result) : result(_result) {}
-      virtual void visit(const T& t) { *result = &t; }
-      const T** result;
-    } visitor(&result);
-    visit(&visitor);
-    if (result == NULL) {
-      std::cerr << "Attempting to \"cast\" event incorrectly!" << std::endl;
-      abort();
-    }
-    return *result;
-  }
+  inline const T& as() const;
+
+protected:
+  explicit Event(Kind _kind) : kind(_kind), next(NULL), enqueued(0.0) {}
+
+  // Non-virtual and protected: see destroy().
+  ~Event() {}
+
+private:
+  // Not copyable, not assignable.
+  Event(const Event&);
+  Event& operator = (const Event&);
 };
 
 
 struct MessageEvent : Event
 {
   MessageEvent(Message* _message)
-    : message(_message) {}
+    : Event(MESSAGE), message(_message) {}
 
-  virtual ~MessageEvent()
+  ~MessageEvent()
   {
     delete message;
   }
 
-  virtual void visit(EventVisitor* visitor) const
-  {
-    visitor->visit(*this);
-  }
-
   Message* const message;
 
+  // Message events are created and destroyed constantly while
+  // messaging, so recycle their memory via per-thread pools.
+  void* operator new (size_t size) { return Pool<MessageEvent>::allocate(size); }
+  void operator delete (void* block) { Pool<MessageEvent>::deallocate(block); }
+
 private:
   // Not copyable, not assignable.
   MessageEvent(const MessageEvent&);
@@ -98,18 +112,13 @@ private:
 struct HttpEvent : Event
 {
   HttpEvent(const Socket& _socket, http::Request* _request)
-    : socket(_socket), request(_request) {}
+    : Event(HTTP), socket(_socket), request(_request) {}
 
-  virtual ~HttpEvent()
+  ~HttpEvent()
   {
     delete request;
   }
 
-  virtual void visit(EventVisitor* visitor) const
-  {
-    visitor->visit(*this);
-  }
-
   const Socket socket;
   http::Request* const request;
 
@@ -126,16 +135,12 @@ struct DispatchEvent : Event
       const UPID& _pid,
       const std::tr1::shared_ptr<std::tr1::function<void(ProcessBase*)> >& _f,
       const std::string& _method)
-    : pid(_pid),
+    : Event(DISPATCH),
+      pid(_pid),
       f(_f),
       method(_method)
   {}
 
-  virtual void visit(EventVisitor* visitor) const
-  {
-    visitor->visit(*this);
-  }
-
   // PID receiving the dispatch.
   const UPID pid;
 
@@ -150,6 +155,11 @@ struct DispatchEvent : Event
   // TODO(benh): Perform canonicalization lazily.
   const std::string method;
 
+  // Like message events, dispatch events make up the hot path, so
+  // recycle their memory via per-thread pools.
+  void* operator new (size_t size) { return Pool<DispatchEvent>::allocate(size); }
+  void operator delete (void* block) { Pool<DispatchEvent>::deallocate(block); }
+
 private:
   // Not copyable, not assignable.
   DispatchEvent(const DispatchEvent&);
@@ -160,12 +170,7 @@ private:
 struct ExitedEvent : Event
 {
   ExitedEvent(const UPID& _pid)
-    : pid(_pid) {}
-
-  virtual void visit(EventVisitor* visitor) const
-  {
-    visitor->visit(*this);
-  }
+    : Event(EXITED), pid(_pid) {}
 
   const UPID pid;
 
@@ -179,12 +184,7 @@ private:
 struct TerminateEvent : Event
 {
   TerminateEvent(const UPID& _from)
-    : from(_from) {}
-
-  virtual void visit(EventVisitor* visitor) const
-  {
-    visitor->visit(*this);
-  }
+    : Event(TERMINATE), from(_from) {}
 
   const UPID from;
 
@@ -194,6 +194,106 @@ private:
   TerminateEvent& operator = (const TerminateEvent&);
 };
 
+
+// Maps a concrete event type to its kind, for is<>/as<>.
+template <typename T>
+struct EventKind;
+
+template <>
+struct EventKind<MessageEvent>
+{
+  static const Event::Kind kind = Event::MESSAGE;
+};
+
+template <>
+struct EventKind<DispatchEvent>
+{
+  static const Event::Kind kind = Event::DISPATCH;
+};
+
+template <>
+struct EventKind<HttpEvent>
+{
+  static const Event::Kind kind = Event::HTTP;
+};
+
+template <>
+struct EventKind<ExitedEvent>
+{
+  static const Event::Kind kind = Event::EXITED;
+};
+
+template <>
+struct EventKind<TerminateEvent>
+{
+  static const Event::Kind kind = Event::TERMINATE;
+};
+
+
+inline void Event::visit(EventVisitor* visitor) const
+{
+  switch (kind) {
+    case MESSAGE:
+      visitor->visit(*static_cast<const MessageEvent*>(this));
+      break;
+    case DISPATCH:
+      visitor->visit(*static_cast<const DispatchEvent*>(this));
+      break;
+    case HTTP:
+      visitor->visit(*static_cast<const HttpEvent*>(this));
+      break;
+    case EXITED:
+      visitor->visit(*static_cast<const ExitedEvent*>(this));
+      break;
+    case TERMINATE:
+      visitor->visit(*static_cast<const TerminateEvent*>(this));
+      break;
+  }
+}
+
+
+template <typename T>
+inline bool Event::is() const
+{
+  return kind == EventKind<T>::kind;
+}
+
+
+template <typename T>
+inline const T& Event::as() const
+{
+  if (kind != EventKind<T>::kind) {
+    std::cerr << "Attempting to \"cast\" event incorrectly!" << std::endl;
+    abort();
+  }
+  return *static_cast<const T*>(this);
+}
+
+
+// Destroys an event through its concrete type (so that, in
+// particular, the pooled subclasses get their class-specific operator
+// delete). This is the only way to dispose of an Event*.
+inline void destroy(const Event* event)
+{
+  switch (event->kind) {
+    case Event::MESSAGE:
+      delete static_cast<const MessageEvent*>(event);
+      break;
+    case Event::DISPATCH:
+      delete static_cast<const DispatchEvent*>(event);
+      break;
+    case Event::HTTP:
+      delete static_cast<const HttpEvent*>(event);
+      break;
+    case Event::EXITED:
+      delete static_cast<const ExitedEvent*>(event);
+      break;
+    case Event::TERMINATE:
+      delete static_cast<const TerminateEvent*>(event);
+      break;
+  }
+}
+
 } // namespace event {
 
 #endif // __PROCESS_EVENT_HPP__
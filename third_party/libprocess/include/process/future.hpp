@@ -171,7 +171,7 @@ public:
                                ENUM_PARAMS(N, A)))                      \
       (const PID<U>&,                                                   \
        X(U::*)(ENUM_PARAMS(N, P)),                                      \
-       ENUM_PARAMS(N, P))>& d) const                                    \
+       ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>& d) const          \
   {                                                                     \
     return then(std::tr1::function<Future<X>(const T&)>(d));            \
   }
@@ -197,7 +197,7 @@ public:
                                ENUM_PARAMS(N, A)))                      \
       (const PID<U>&,                                                   \
        Future<X>(U::*)(ENUM_PARAMS(N, P)),                              \
-       ENUM_PARAMS(N, P))>& d) const                                    \
+       ENUM_BINARY_PARAMS(N, const P, & INTERCEPT))>& d) const          \
   {                                                                     \
     return then(std::tr1::function<Future<X>(const T&)>(d));            \
   }
@@ -233,16 +233,94 @@ private:
     DISCARDED,
   };
 
-  int* refs;
-  int* lock;
-  State* state;
-  T** t;
-  std::string** message; // Message associated with failure.
-  std::queue<ReadyCallback>* onReadyCallbacks;
-  std::queue<FailedCallback>* onFailedCallbacks;
-  std::queue<DiscardedCallback>* onDiscardedCallbacks;
-  std::queue<AnyCallback>* onAnyCallbacks;
-  Latch* latch;
+  // Queue of callbacks that stores the first few inline since most
+  // futures only ever get one or two continuations (e.g., via 'then'
+  // or Promise::associate), which means registering a callback
+  // doesn't need to allocate in the common case.
+  template <typename C>
+  struct Callbacks
+  {
+    Callbacks() : index(0), count(0), more(NULL) {}
+    ~Callbacks() { delete more; }
+
+    bool empty() const
+    {
+      return index == count && (more == NULL || more->empty());
+    }
+
+    void push(const C& callback)
+    {
+      if (count < SIZE) {
+        inlined[count++] = callback;
+      } else {
+        if (more == NULL) {
+          more = new std::queue<C>();
+        }
+        more->push(callback);
+      }
+    }
+
+    const C& front() const
+    {
+      return index < count ? inlined[index] : more->front();
+    }
+
+    void pop()
+    {
+      if (index < count) {
+        inlined[index++] = C(); // Release any state bound in the callback.
+      } else {
+        more->pop();
+      }
+    }
+
+    enum { SIZE = 2 };
+
+    C inlined[SIZE];
+    size_t index;
+    size_t count;
+    std::queue<C>* more; // Overflow, allocated only when needed.
+  };
+
+  // State shared by all copies of a future, allocated once per future
+  // rather than once per field. Note that the latch is only created
+  // when somebody actually blocks in 'await' since creating one spawns
+  // an entire process (most futures only ever have callbacks).
+  struct Data
+  {
+    Data()
+      : refs(1),
+        lock(0),
+        state(PENDING),
+        t(NULL),
+        message(NULL),
+        latch(NULL) {}
+
+    ~Data()
+    {
+      delete t;
+      delete message;
+      delete latch;
+    }
+
+    int refs;
+    int lock;
+    State state;
+    T* t;
+    std::string* message; // Message associated with failure.
+    Callbacks<ReadyCallback> onReadyCallbacks;
+    Callbacks<FailedCallback> onFailedCallbacks;
+    Callbacks<DiscardedCallback> onDiscardedCallbacks;
+    Callbacks<AnyCallback> onAnyCallbacks;
+    Latch* latch;
+
+  private:
+    // Not copyable, not assignable.
+    Data(const Data&);
+    Data& operator = (const Data&);
+  };
+
+  Data* data;
 };
 
 
@@ -461,30 +539,12 @@ Future<T> Future<T>::failed(const std::string& message)
 
 template <typename T>
 Future<T>::Future()
-  : refs(new int(1)),
-    lock(new int(0)),
-    state(new State(PENDING)),
-    t(new T*(NULL)),
-    message(new std::string*(NULL)),
-    onReadyCallbacks(new std::queue<ReadyCallback>()),
-    onFailedCallbacks(new std::queue<FailedCallback>()),
-    onDiscardedCallbacks(new std::queue<DiscardedCallback>()),
-    onAnyCallbacks(new std::queue<AnyCallback>()),
-    latch(new Latch()) {}
+  : data(new Data()) {}
 
 
 template <typename T>
 Future<T>::Future(const T& _t)
-  : refs(new int(1)),
-    lock(new int(0)),
-    state(new State(PENDING)),
-    t(new T*(NULL)),
-    message(new std::string*(NULL)),
-    onReadyCallbacks(new std::queue<ReadyCallback>()),
-    onFailedCallbacks(new std::queue<FailedCallback>()),
-    onDiscardedCallbacks(new std::queue<DiscardedCallback>()),
-    onAnyCallbacks(new std::queue<AnyCallback>()),
-    latch(new Latch())
+  : data(new Data())
 {
   set(_t);
 }
@@ -518,18 +578,18 @@ Future<T>& Future<T>::operator = (const Future<T>& that)
 template <typename T>
 bool Future<T>::operator == (const Future<T>& that) const
 {
-  assert(latch != NULL);
-  assert(that.latch != NULL);
-  return *latch == *that.latch;
+  assert(data != NULL);
+  assert(that.data != NULL);
+  return data == that.data;
 }
 
 
 template <typename T>
 bool Future<T>::operator < (const Future<T>& that) const
 {
-  assert(latch != NULL);
-  assert(that.latch != NULL);
-  return *latch < *that.latch;
+  assert(data != NULL);
+  assert(that.data != NULL);
+  return data < that.data;
 }
 
 
@@ -538,32 +598,33 @@ bool Future<T>::discard()
 {
   bool result = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
+  assert(data != NULL);
+  internal::acquire(&data->lock);
   {
-    assert(state != NULL);
-    if (*state == PENDING) {
-      *state = DISCARDED;
-      latch->trigger();
+    if (data->state == PENDING) {
+      data->state = DISCARDED;
+      if (data->latch != NULL) {
+        data->latch->trigger();
+      }
       result = true;
     }
   }
-  internal::release(lock);
+  internal::release(&data->lock);
 
   // Invoke all callbacks associated with this future being
   // DISCARDED. We don't need a lock because the state is now in
   // DISCARDED so there should not be any concurrent modifications.
   if (result) {
-    while (!onDiscardedCallbacks->empty()) {
+    while (!data->onDiscardedCallbacks.empty()) {
       // TODO(*): Invoke callbacks in another execution context.
-      onDiscardedCallbacks->front()();
-      onDiscardedCallbacks->pop();
+      data->onDiscardedCallbacks.front()();
+      data->onDiscardedCallbacks.pop();
     }
 
-    while (!onAnyCallbacks->empty()) {
+    while (!data->onAnyCallbacks.empty()) {
       // TODO(*): Invoke callbacks in another execution context.
-      onAnyCallbacks->front()(*this);
-      onAnyCallbacks->pop();
+      data->onAnyCallbacks.front()(*this);
+      data->onAnyCallbacks.pop();
     }
   }
 
@@ -574,42 +635,59 @@ bool Future<T>::discard()
 template <typename T>
 bool Future<T>::isPending() const
 {
-  assert(state != NULL);
-  return *state == PENDING;
+  assert(data != NULL);
+  return data->state == PENDING;
 }
 
 
 template <typename T>
 bool Future<T>::isReady() const
 {
-  assert(state != NULL);
-  return *state == READY;
+  assert(data != NULL);
+  return data->state == READY;
 }
 
 
 template <typename T>
 bool Future<T>::isDiscarded() const
 {
-  assert(state != NULL);
-  return *state == DISCARDED;
+  assert(data != NULL);
+  return data->state == DISCARDED;
 }
 
 
 template <typename T>
 bool Future<T>::isFailed() const
 {
-  assert(state != NULL);
-  return *state == FAILED;
+  assert(data != NULL);
+  return data->state == FAILED;
 }
 
 
 template <typename T>
 bool Future<T>::await(const Duration& duration) const
 {
-  if (!isReady() && !isDiscarded() && !isFailed()) {
-    assert(latch != NULL);
+  Latch* latch = NULL;
+
+  assert(data != NULL);
+  internal::acquire(&data->lock);
+  {
+    if (data->state == PENDING) {
+      // Lazily create the latch: we hold the lock, so either a
+      // concurrent 'set' already transitioned the state (and we fall
+      // through below) or it will see the latch and trigger it.
+      if (data->latch == NULL) {
+        data->latch = new Latch();
+      }
+      latch = data->latch;
+    }
+  }
+  internal::release(&data->lock);
+
+  if (latch != NULL) {
     return latch->await(duration);
   }
+
   return true;
 }
 
@@ -633,18 +711,17 @@ T Future<T>::get() const
     abort();
   }
 
-  assert(t != NULL);
-  assert(*t != NULL);
-  return **t;
+  assert(data->t != NULL);
+  return *data->t;
 }
 
 
 template <typename T>
 std::string Future<T>::failure() const
 {
-  assert(message != NULL);
-  if (*message != NULL) {
-    return **message;
+  assert(data != NULL);
+  if (data->message != NULL) {
+    return *data->message;
   }
 
   return "";
@@ -656,21 +733,20 @@ const Future<T>& Future<T>::onReady(const ReadyCallback& callback) const
 {
   bool run = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
+  assert(data != NULL);
+  internal::acquire(&data->lock);
   {
-    assert(state != NULL);
-    if (*state == READY) {
+    if (data->state == READY) {
       run = true;
-    } else if (*state == PENDING) {
-      onReadyCallbacks->push(callback);
+    } else if (data->state == PENDING) {
+      data->onReadyCallbacks.push(callback);
     }
   }
-  internal::release(lock);
+  internal::release(&data->lock);
 
   // TODO(*): Invoke callback in another execution context.
   if (run) {
-    callback(**t);
+    callback(*data->t);
   }
 
   return *this;
@@ -682,21 +758,20 @@ const Future<T>& Future<T>::onFailed(const FailedCallback& callback) const
 {
   bool run = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
+  assert(data != NULL);
+  internal::acquire(&data->lock);
   {
-    assert(state != NULL);
-    if (*state == FAILED) {
+    if (data->state == FAILED) {
       run = true;
-    } else if (*state == PENDING) {
-      onFailedCallbacks->push(callback);
+    } else if (data->state == PENDING) {
+      data->onFailedCallbacks.push(callback);
     }
   }
-  internal::release(lock);
+  internal::release(&data->lock);
 
   // TODO(*): Invoke callback in another execution context.
   if (run) {
-    callback(**message);
+    callback(*data->message);
   }
 
   return *this;
@@ -709,17 +784,16 @@ const Future<T>& Future<T>::onDiscarded(
 {
   bool run = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
+  assert(data != NULL);
+  internal::acquire(&data->lock);
   {
-    assert(state != NULL);
-    if (*state == DISCARDED) {
+    if (data->state == DISCARDED) {
       run = true;
-    } else if (*state == PENDING) {
-      onDiscardedCallbacks->push(callback);
+    } else if (data->state == PENDING) {
+      data->onDiscardedCallbacks.push(callback);
     }
   }
-  internal::release(lock);
+  internal::release(&data->lock);
 
   // TODO(*): Invoke callback in another execution context.
   if (run) {
@@ -735,17 +809,16 @@ const Future<T>& Future<T>::onAny(const AnyCallback& callback) const
 {
   bool run = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
+  assert(data != NULL);
+  internal::acquire(&data->lock);
   {
-    assert(state != NULL);
-    if (*state != PENDING) {
+    if (data->state != PENDING) {
       run = true;
-    } else if (*state == PENDING) {
-      onAnyCallbacks->push(callback);
+    } else {
+      data->onAnyCallbacks.push(callback);
     }
   }
-  internal::release(lock);
+  internal::release(&data->lock);
 
   // TODO(*): Invoke callback in another execution context.
   if (run) {
@@ -884,33 +957,34 @@ bool Future<T>::set(const T& _t)
 {
   bool result = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
+  assert(data != NULL);
+  internal::acquire(&data->lock);
   {
-    assert(state != NULL);
-    if (*state == PENDING) {
-      *t = new T(_t);
-      *state = READY;
-      latch->trigger();
+    if (data->state == PENDING) {
+      data->t = new T(_t);
+      data->state = READY;
+      if (data->latch != NULL) {
+        data->latch->trigger();
+      }
       result = true;
     }
   }
-  internal::release(lock);
+  internal::release(&data->lock);
 
   // Invoke all callbacks associated with this future being READY. We
   // don't need a lock because the state is now in READY so there
   // should not be any concurrent modications.
   if (result) {
-    while (!onReadyCallbacks->empty()) {
+    while (!data->onReadyCallbacks.empty()) {
       // TODO(*): Invoke callbacks in another execution context.
-      onReadyCallbacks->front()(**t);
-      onReadyCallbacks->pop();
+      data->onReadyCallbacks.front()(*data->t);
+      data->onReadyCallbacks.pop();
     }
 
-    while (!onAnyCallbacks->empty()) {
+    while (!data->onAnyCallbacks.empty()) {
       // TODO(*): Invoke callbacks in another execution context.
-      onAnyCallbacks->front()(*this);
-      onAnyCallbacks->pop();
+      data->onAnyCallbacks.front()(*this);
+      data->onAnyCallbacks.pop();
     }
   }
 
@@ -923,33 +997,34 @@ bool Future<T>::fail(const std::string& _message)
 {
   bool result = false;
 
-  assert(lock != NULL);
-  internal::acquire(lock);
+  assert(data != NULL);
+  internal::acquire(&data->lock);
   {
-    assert(state != NULL);
-    if (*state == PENDING) {
-      *message = new std::string(_message);
-      *state = FAILED;
-      latch->trigger();
+    if (data->state == PENDING) {
+      data->message = new std::string(_message);
+      data->state = FAILED;
+      if (data->latch != NULL) {
+        data->latch->trigger();
+      }
       result = true;
     }
   }
-  internal::release(lock);
+  internal::release(&data->lock);
 
   // Invoke all callbacks associated with this future being FAILED. We
   // don't need a lock because the state is now in FAILED so there
   // should not be any concurrent modications.
   if (result) {
-    while (!onFailedCallbacks->empty()) {
+    while (!data->onFailedCallbacks.empty()) {
       // TODO(*): Invoke callbacks in another execution context.
-      onFailedCallbacks->front()(**message);
-      onFailedCallbacks->pop();
+      data->onFailedCallbacks.front()(*data->message);
+      data->onFailedCallbacks.pop();
     }
 
-    while (!onAnyCallbacks->empty()) {
+    while (!data->onAnyCallbacks.empty()) {
       // TODO(*): Invoke callbacks in another execution context.
-      onAnyCallbacks->front()(*this);
-      onAnyCallbacks->pop();
+      data->onAnyCallbacks.front()(*this);
+      data->onAnyCallbacks.pop();
     }
   }
 
@@ -960,35 +1035,26 @@ bool Future<T>::fail(const std::string& _message)
 template <typename T>
 void Future<T>::copy(const Future<T>& that)
 {
-  assert(that.refs > 0);
-  __sync_fetch_and_add(that.refs, 1);
-  refs = that.refs;
-  lock = that.lock;
-  state = that.state;
-  t = that.t;
-  message = that.message;
-  onReadyCallbacks = that.onReadyCallbacks;
-  onFailedCallbacks = that.onFailedCallbacks;
-  onDiscardedCallbacks = that.onDiscardedCallbacks;
-  onAnyCallbacks = that.onAnyCallbacks;
-  latch = that.latch;
+  assert(that.data != NULL);
+  assert(that.data->refs > 0);
+  __sync_fetch_and_add(&that.data->refs, 1);
+  data = that.data;
 }
 
 
 template <typename T>
 void Future<T>::cleanup()
 {
-  assert(refs != NULL);
-  if (__sync_sub_and_fetch(refs, 1) == 0) {
+  assert(data != NULL);
+  if (__sync_sub_and_fetch(&data->refs, 1) == 0) {
     // Discard the future if it is still pending (so we invoke any
     // discarded callbacks that have been setup). Note that we put the
     // reference count back at 1 here in case one of the callbacks
     // decides it wants to keep a reference.
-    assert(state != NULL);
-    if (*state == PENDING) {
-      *refs = 1;
+    if (data->state == PENDING) {
+      data->refs = 1;
       discard();
-      __sync_sub_and_fetch(refs, 1);
+      __sync_sub_and_fetch(&data->refs, 1);
     }
 
     // Now try and cleanup again (this time we know the future has
@@ -996,39 +1062,9 @@ void Future<T>::cleanup()
     // callbacks might have stored the future, in which case we'll
     // just return without doing anything, but the state will forever
     // be "discarded".
-    assert(refs != NULL);
-    if (*refs == 0) {
-      delete refs;
-      refs = NULL;
-      assert(lock != NULL);
-      delete lock;
-      lock = NULL;
-      assert(state != NULL);
-      delete state;
-      state = NULL;
-      assert(t != NULL);
-      delete *t;
-      delete t;
-      t = NULL;
-      assert(message != NULL);
-      delete *message;
-      delete message;
-      message = NULL;
-      assert(onReadyCallbacks != NULL);
-      delete onReadyCallbacks;
-      onReadyCallbacks = NULL;
-      assert(onFailedCallbacks != NULL);
-      delete onFailedCallbacks;
-      onFailedCallbacks = NULL;
-      assert(onDiscardedCallbacks != NULL);
-      delete onDiscardedCallbacks;
-      onDiscardedCallbacks = NULL;
-      assert(onAnyCallbacks != NULL);
-      delete onAnyCallbacks;
-      onAnyCallbacks = NULL;
-      assert(latch != NULL);
-      delete latch;
-      latch = NULL;
+    if (data->refs == 0) {
+      delete data;
+      data = NULL;
     }
   }
 }
@@ -8,10 +8,15 @@
 #include <string>
 
 #include <limits.h>
+#include <string.h>
+
+#include <sys/types.h>
 
 #include <process/future.hpp>
 #include <process/pid.hpp>
 
+#include <stout/crc32c.hpp>
+#include <stout/duration.hpp>
 #include <stout/error.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/json.hpp>
@@ -110,12 +115,16 @@ struct Request
 struct Response
 {
   Response()
-    : type(NONE)
+    : type(NONE),
+      offset(0),
+      length(-1)
   {}
 
   Response(const std::string& _body)
     : type(BODY),
-      body(_body)
+      body(_body),
+      offset(0),
+      length(-1)
   {
     headers["Content-Length"] = stringify(body.size());
   }
@@ -133,7 +142,9 @@ struct Response
   // already specified.
   //
   // PATH: Attempts to perform a 'sendfile' operation on the file
-  // found at 'path'.
+  // found at 'path'. A subrange of the file can be sent by setting
+  // 'offset' and/or 'length' (by default the entire file is sent);
+  // a range extending past the end of the file gets truncated.
   //
   // PIPE: Splices data from 'pipe' using 'Transfer-Encoding=chunked'.
   // Note that the read end of the pipe will be closed by libprocess
@@ -155,6 +166,8 @@ struct Response
 
   std::string body;
   std::string path;
+  off_t offset;   // Offset within the file to send from (PATH only).
+  ssize_t length; // Number of bytes to send, -1 means to EOF (PATH only).
   int pipe; // See comment above regarding the semantics for closing.
 };
 
@@ -203,6 +216,21 @@ struct OK : Response
 };
 
 
+struct NotModified : Response
+{
+  NotModified()
+  {
+    status = "304 Not Modified";
+  }
+
+  explicit NotModified(const std::string& etag)
+  {
+    status = "304 Not Modified";
+    headers["ETag"] = etag;
+  }
+};
+
+
 struct TemporaryRedirect : Response
 {
   TemporaryRedirect(const std::string& url)
@@ -270,6 +298,20 @@ struct ServiceUnavailable : Response
 };
 
 
+// Computes an entity tag for a response body, to be set as the
+// 'ETag' header: a quoted content hash, so identical bodies produce
+// identical tags across processes and restarts. A "200 OK" response
+// carrying an ETag answers a conditional request (one whose
+// 'If-None-Match' matches the tag) with "304 Not Modified" and no
+// body (see HttpProxy::process), sparing pollers whose cached copy
+// is still current the transfer.
+inline std::string etag(const std::string& body)
+{
+  return "\"" + stringify(body.size()) + "-" +
+         stringify(crc32c::checksum(body.data(), body.size())) + "\"";
+}
+
+
 namespace query {
 
 // Parses an HTTP query string into a map. For example:
@@ -290,13 +332,22 @@ inline hashmap<std::string, std::string> parse(const std::string& query)
 {
   hashmap<std::string, std::string> result;
 
-  const std::vector<std::string>& tokens = strings::tokenize(query, ";&");
-  foreach (const std::string& token, tokens) {
-    const std::vector<std::string>& pairs = strings::split(token, "=");
-    if (pairs.size() == 2) {
-      result[pairs[0]] = pairs[1];
-    } else if (pairs.size() == 1) {
-      result[pairs[0]] = "";
+  strings::Tokenizer tokens(query, ";&");
+  const char* data;
+  size_t length;
+  while (tokens.next(&data, &length)) {
+    // Split the token into a key and a (possibly empty) value on the
+    // '='; tokens with more than one '=' are discarded, as before.
+    const char* separator =
+      static_cast<const char*>(memchr(data, '=', length));
+    if (separator == NULL) {
+      result[std::string(data, length)] = "";
+    } else {
+      size_t index = separator - data;
+      if (memchr(separator + 1, '=', length - index - 1) == NULL) {
+        result[std::string(data, index)] =
+          std::string(separator + 1, length - index - 1);
+      }
     }
   }
 
@@ -400,16 +451,30 @@ inline Try<std::string> decode(const std::string& s)
 }
 
 
-// Sends a blocking HTTP GET request to the process with the given upid.
-// Returns the HTTP response from the process, read asynchronously.
-//
-// TODO(bmahler): Have the request sent asynchronously as well.
-// TODO(bmahler): For efficiency, this should properly use the ResponseDecoder
-// on the read stream, rather than parsing the full string response at the end.
+// Sends an asynchronous HTTP GET request to the process with the
+// given upid and returns the response. Requests to the same
+// destination are sent over a small pool of keep-alive connections
+// (queued requests get pipelined on them), so repeated control
+// operations and health checks reuse hot connections instead of
+// reconnecting per request. If a 'timeout' is given and expires
+// before the response arrives the future fails and the underlying
+// connection is closed (responses arriving behind the expired one
+// could no longer be matched to their requests).
 Future<Response> get(
     const UPID& upid,
     const std::string& path = "",
-    const std::string& query = "");
+    const std::string& query = "",
+    const Option<Duration>& timeout = None());
+
+
+// Sends an asynchronous HTTP POST request, with the same connection
+// reuse and timeout semantics as 'get' above.
+Future<Response> post(
+    const UPID& upid,
+    const std::string& path = "",
+    const std::string& body = "",
+    const std::string& contentType = "",
+    const Option<Duration>& timeout = None());
 
 
 // Status code reason strings, from the HTTP1.1 RFC:
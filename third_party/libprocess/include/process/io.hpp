@@ -1,9 +1,15 @@
 #ifndef __PROCESS_IO_HPP__
 #define __PROCESS_IO_HPP__
 
+#include <sys/uio.h> // For struct iovec.
+
 #include <cstring> // For size_t.
 #include <string>
 
+#include <tr1/memory>
+
+#include <boost/shared_array.hpp>
+
 #include <process/future.hpp>
 
 namespace process {
@@ -33,11 +39,84 @@ Future<short> poll(int fd, short events);
 Future<size_t> read(int fd, void* data, size_t size);
 
 
+// Performs a single non-blocking vectored read (see readv) by polling
+// on the specified file descriptor until data can be read into the
+// provided buffers. Semantics otherwise match 'read' above: the
+// future is the number of bytes read, zero on end-of-file, and
+// failures are indicated by failing the future. Note that the buffers
+// described by 'iov' must remain valid until the future is satisfied.
+Future<size_t> readv(int fd, const struct iovec* iov, int iovcnt);
+
+
+// Performs a single non-blocking vectored write (see writev) by
+// polling on the specified file descriptor until data can be
+// written. The future will become ready when some data is written
+// (may be less than the sum of the buffer lengths). A future failure
+// will be returned if an error is detected. Note that the buffers
+// described by 'iov' must remain valid until the future is satisfied.
+Future<size_t> writev(int fd, const struct iovec* iov, int iovcnt);
+
+
 // Performs a series of asynchronous reads, until EOF is reached.
 // NOTE: When using this, ensure the sender will close the connection
 // so that EOF can be reached.
 Future<std::string> read(int fd);
 
+
+// A slice of a read buffer. A slice holds a reference on the
+// underlying buffer, so the data remains valid for as long as the
+// slice (or a copy of it) is around, without getting copied out.
+class Slice
+{
+public:
+  Slice() : offset(0), length(0) {}
+
+  Slice(const boost::shared_array<char>& _buffer,
+        size_t _offset,
+        size_t _length)
+    : buffer(_buffer), offset(_offset), length(_length) {}
+
+  const char* data() const { return buffer.get() + offset; }
+  size_t size() const { return length; }
+  bool empty() const { return length == 0; }
+
+private:
+  boost::shared_array<char> buffer;
+  size_t offset;
+  size_t length;
+};
+
+
+namespace internal {
+
+// Forward declaration (the shared state of a BufferedReader).
+struct BufferedReaderData;
+
+} // namespace internal {
+
+
+// Reads from a file descriptor through a large readahead buffer
+// (BUFFERED_READ_SIZE per refill) and hands out slices of that
+// buffer, so consumers taking small amounts of data neither pay a
+// libprocess round trip per chunk nor copy the data. Copies of a
+// reader share the same buffer and position. Note that the file
+// descriptor must be non-blocking and does not get closed by the
+// reader.
+class BufferedReader
+{
+public:
+  explicit BufferedReader(int fd);
+
+  // Returns a slice of at most 'limit' bytes (or however much is
+  // available if 'limit' is 0), refilling the readahead buffer when
+  // it has been consumed. An empty slice signifies end-of-file, and a
+  // read error is indicated by failing the future.
+  Future<Slice> read(size_t limit = 0);
+
+private:
+  std::tr1::shared_ptr<internal::BufferedReaderData> data;
+};
+
 } // namespace io {
 } // namespace process {
 
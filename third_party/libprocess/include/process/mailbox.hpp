@@ -0,0 +1,172 @@
+#ifndef __PROCESS_MAILBOX_HPP__
+#define __PROCESS_MAILBOX_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <process/event.hpp>
+
+namespace process {
+
+// A lock-free multi-producer single-consumer event queue, used as the
+// per-process mailbox. Producers push with a single compare-and-swap
+// onto an intrusive LIFO chain (threaded through Event::next), so the
+// I/O thread, timer thread and worker threads never block one another
+// or the consumer; the consumer detaches an entire chain with one
+// atomic swap and reverses it into service order. The consumer side
+// (drain) must only ever be invoked by one thread at a time, which
+// holds by construction: only the thread currently running the
+// process drains (see ProcessManager::resume and cleanup).
+class Mailbox
+{
+public:
+  // Priority classes, in service order: an entire batch gets drained
+  // at once, so a lower class is never starved -- it is only ever
+  // reordered behind higher classes within the current batch (the
+  // starvation bound is one batch). URGENT is reserved for injected
+  // events (the analog of the old "push at the front" semantics);
+  // processes assign the other classes via ProcessBase::classify.
+  enum Priority
+  {
+    URGENT,
+    HIGH,
+    NORMAL,
+    BULK,
+    CLASSES // Number of classes, not a class.
+  };
+
+  Mailbox() : count(0), front(0.0)
+  {
+    for (int i = 0; i < CLASSES; i++) {
+      heads[i] = NULL;
+      pushed[i] = 0;
+    }
+  }
+
+  // Pushes an event with the given priority class, returning the
+  // queue depth as of this push.
+  size_t push(Event* event, int priority = NORMAL)
+  {
+    if (priority < URGENT || priority >= CLASSES) {
+      priority = NORMAL;
+    }
+
+    // Incremented before the push so a concurrent drain can never
+    // subtract more than has been added; the depth may transiently
+    // over-report instead, which is harmless.
+    size_t depth = __sync_add_and_fetch(&count, 1);
+
+    __sync_add_and_fetch(&pushed[priority], (uint64_t) 1);
+
+    // Best effort timestamp of the oldest waiting event (for the
+    // 'oldest' statistic); a race here only skews instrumentation.
+    if (front == 0.0) {
+      front = event->enqueued;
+    }
+
+    Event* volatile* head = &heads[priority];
+
+    Event* old;
+    do {
+      old = *head;
+      event->next = old;
+    } while (!__sync_bool_compare_and_swap(head, old, event));
+
+    return depth;
+  }
+
+  // Consumer only. Detaches every queued event and returns them as a
+  // chain linked through Event::next in service order (higher
+  // priority classes first, oldest first within each class), setting
+  // 'drained' to the number of events in the chain (possibly 0, in
+  // which case NULL is returned).
+  Event* drain(size_t* drained)
+  {
+    // Reset before detaching so events left waiting tend to have
+    // their timestamp recorded by whichever producer pushes next.
+    front = 0.0;
+
+    size_t n = 0;
+
+    // Reversing the lowest class first and each higher class onto
+    // the result leaves the highest class at the head.
+    Event* chain = NULL;
+    for (int i = CLASSES - 1; i >= 0; i--) {
+      chain = reverse(detach(&heads[i]), chain, &n);
+    }
+
+    if (n > 0) {
+      __sync_sub_and_fetch(&count, n);
+    }
+
+    *drained = n;
+    return chain;
+  }
+
+  // Approximate queue depth (exact when no push is in progress).
+  size_t depth() const
+  {
+    return count;
+  }
+
+  // Enqueue time (as per Event::enqueued) of approximately the oldest
+  // waiting event, or 0 when there is none; instrumentation only.
+  double oldest() const
+  {
+    return front;
+  }
+
+  // Cumulative number of events ever pushed with the given priority
+  // class.
+  uint64_t pushes(int priority) const
+  {
+    return (priority >= URGENT && priority < CLASSES) ? pushed[priority] : 0;
+  }
+
+private:
+  // Atomically detaches and returns a chain (newest event first).
+  static Event* detach(Event* volatile* head)
+  {
+    Event* old;
+    do {
+      old = *head;
+    } while (old != NULL &&
+             !__sync_bool_compare_and_swap(head, old, (Event*) NULL));
+    return old;
+  }
+
+  // Reverses 'chain' (newest first) onto 'tail', adding the number of
+  // events reversed to '*n'; the result is oldest first, followed by
+  // 'tail'.
+  static Event* reverse(Event* chain, Event* tail, size_t* n)
+  {
+    while (chain != NULL) {
+      Event* next = chain->next;
+      chain->next = tail;
+      tail = chain;
+      chain = next;
+      (*n)++;
+    }
+    return tail;
+  }
+
+  // Incoming chains (indexed by Priority), newest event first.
+  Event* volatile heads[CLASSES];
+
+  // Cumulative per class push counts (see pushes).
+  volatile uint64_t pushed[CLASSES];
+
+  // Number of queued events (see push/drain for the accounting).
+  volatile size_t count;
+
+  // Enqueue time of (approximately) the oldest waiting event.
+  double front;
+
+  // Not copyable, not assignable.
+  Mailbox(const Mailbox&);
+  Mailbox& operator = (const Mailbox&);
+};
+
+} // namespace process {
+
+#endif // __PROCESS_MAILBOX_HPP__
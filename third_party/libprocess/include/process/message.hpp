@@ -4,6 +4,7 @@
 #include <string>
 
 #include <process/pid.hpp>
+#include <process/pool.hpp>
 
 namespace process {
 
@@ -13,6 +14,23 @@ struct Message
   UPID from;
   UPID to;
   std::string body;
+
+  // Content codec the body has been compressed with ("" means none),
+  // carried across the wire via a 'Libprocess-Encoding' header. Only
+  // ever set for a peer that announced it can decode the codec (see
+  // SocketManager::announce in process.cpp).
+  std::string encoding;
+
+  // Correlation id for message tracing (0 means not yet stamped);
+  // carried across the wire via a 'Libprocess-Trace-Id' header so a
+  // trace can follow a causal chain across hops. See the 'trace'
+  // namespace in process.cpp.
+  uint64_t correlation;
+
+  // Messages are allocated for every send and deleted after delivery,
+  // so recycle their memory via per-thread pools.
+  void* operator new (size_t size) { return Pool<Message>::allocate(size); }
+  void operator delete (void* block) { Pool<Message>::deallocate(block); }
 };
 
 } // namespace process {
@@ -0,0 +1,91 @@
+#ifndef __PROCESS_POOL_HPP__
+#define __PROCESS_POOL_HPP__
+
+#include <stdlib.h>
+
+#include <process/thread.hpp>
+
+namespace process {
+
+// A per-thread pool of fixed size memory blocks, used to recycle the
+// allocations of the small objects that make up the hot messaging
+// path (messages and events) without touching the global allocator in
+// steady state, and without any locking, since each thread recycles
+// into its own free list. A block allocated on one thread and freed
+// on another simply lands in the freeing thread's list; since every
+// thread both allocates and frees these objects this balances out,
+// and each list is capped (excess blocks go back to the allocator) so
+// a lopsided producer/consumer pattern can't hoard memory.
+//
+// Intended to be used by giving a class 'operator new'/'operator
+// delete' that forward here, e.g.:
+//
+//   void* operator new (size_t size) { return Pool<T>::allocate(size); }
+//   void operator delete (void* block) { Pool<T>::deallocate(block); }
+template <typename T>
+class Pool
+{
+public:
+  static void* allocate(size_t size)
+  {
+    if (size != sizeof(T)) {
+      // Some derived type we don't know about, punt.
+      return malloc(size);
+    }
+
+    Block* block = *blocks();
+
+    if (block != NULL) {
+      *blocks() = block->next;
+      return block;
+    }
+
+    return malloc(size);
+  }
+
+  static void deallocate(void* pointer)
+  {
+    if (pointer == NULL) {
+      return;
+    }
+
+    Block* block = (Block*) pointer;
+    Block* head = *blocks();
+
+    size_t count = head != NULL ? head->count : 0;
+
+    if (count >= LIMIT) {
+      free(pointer);
+      return;
+    }
+
+    block->next = head;
+    block->count = count + 1;
+    *blocks() = block;
+  }
+
+private:
+  // Freed blocks are linked through their own storage (which requires
+  // sizeof(T) >= sizeof(Block), true for everything we pool). Each
+  // block records the length of the list below it so we can cap the
+  // list without a separate per-thread counter.
+  struct Block
+  {
+    Block* next;
+    size_t count;
+  };
+
+  // Maximum number of blocks kept per thread.
+  static const size_t LIMIT = 1024;
+
+  static ThreadLocal<Block>* blocks()
+  {
+    // Intentionally leaked (freeing on shutdown buys nothing).
+    static ThreadLocal<Block>* local = new ThreadLocal<Block>();
+    return local;
+  }
+};
+
+} // namespace process {
+
+#endif // __PROCESS_POOL_HPP__
@@ -6,22 +6,164 @@
 
 #include <map>
 #include <queue>
+#include <string>
+#include <vector>
 
 #include <tr1/functional>
+#include <tr1/memory>
 
 #include <process/clock.hpp>
 #include <process/event.hpp>
 #include <process/filter.hpp>
 #include <process/http.hpp>
+#include <process/mailbox.hpp>
 #include <process/message.hpp>
 #include <process/mime.hpp>
 #include <process/pid.hpp>
+#include <process/socket.hpp>
 #include <process/thread.hpp>
 
 #include <stout/duration.hpp>
+#include <stout/nothing.hpp>
+#include <stout/strings.hpp>
 
 namespace process {
 
+// An HTTP handler is any function which takes an http::Request and
+// returns a Future<http::Response> (see ProcessBase::route).
+typedef std::tr1::function<Future<http::Response>(const http::Request&)>
+HttpRequestHandler;
+
+
+// Dispatches HTTP requests on a trie of '/' separated path segments.
+// Routes are installed with literal segments or '*' (which matches
+// any single request segment, with literals preferred); the deepest
+// installed route along the request path wins and trailing request
+// segments beyond it are allowed. Every route carries a request count
+// and a histogram of handler completion latencies, exposed via the
+// '/__processes__/stats' endpoint.
+class HttpRouter
+{
+public:
+  // Per route instrumentation. Updated with atomic increments from
+  // whichever thread completes a response (responses are futures and
+  // can complete after the owning process is gone, hence the shared
+  // pointer in Node below).
+  struct Stats
+  {
+    Stats() : requests(0)
+    {
+      for (size_t i = 0; i < BUCKETS; i++) {
+        latencies[i] = 0;
+      }
+    }
+
+    // Same bucket bounds as ProcessBase::Stats: 10us, 100us, 1ms,
+    // 10ms, 100ms, 1s, +Inf.
+    enum { BUCKETS = 7 };
+
+    uint64_t requests; // Requests ever dispatched to this route.
+    uint64_t latencies[BUCKETS]; // Handler completion latencies.
+  };
+
+  struct Node
+  {
+    Node() {}
+
+    ~Node()
+    {
+      for (std::map<std::string, Node*>::iterator iterator =
+             children.begin();
+           iterator != children.end();
+           ++iterator) {
+        delete iterator->second;
+      }
+    }
+
+    std::map<std::string, Node*> children; // Keyed by segment ('*' wild).
+    HttpRequestHandler handler; // Unset unless a route was installed.
+    std::tr1::shared_ptr<Stats> stats; // Set iff a route was installed.
+
+  private:
+    Node(const Node&);              // No copying.
+    Node& operator = (const Node&); // No assigning.
+  };
+
+  // Installs a handler at the given path (relative to the process,
+  // without a leading '/'; "" is the process root).
+  void install(const std::string& path, const HttpRequestHandler& handler)
+  {
+    Node* node = &root;
+    const std::vector<std::string>& segments = strings::tokenize(path, "/");
+    for (size_t i = 0; i < segments.size(); i++) {
+      if (node->children.count(segments[i]) == 0) {
+        node->children[segments[i]] = new Node();
+      }
+      node = node->children[segments[i]];
+    }
+    node->handler = handler;
+    if (node->stats.get() == NULL) {
+      node->stats.reset(new Stats());
+    }
+  }
+
+  // Returns the route matching the given request path segments, or
+  // NULL when nothing matches. Matching is greedy: at each step a
+  // literal child is preferred over the wildcard and there is no
+  // backtracking.
+  Node* match(const std::vector<std::string>& segments)
+  {
+    Node* node = &root;
+    Node* best = node->handler ? node : NULL;
+    for (size_t i = 0; i < segments.size(); i++) {
+      std::map<std::string, Node*>::iterator child =
+        node->children.find(segments[i]);
+      if (child == node->children.end()) {
+        child = node->children.find("*");
+      }
+      if (child == node->children.end()) {
+        break;
+      }
+      node = child->second;
+      if (node->handler) {
+        best = node;
+      }
+    }
+    return best;
+  }
+
+  // Returns the stats of every installed route, keyed by path.
+  std::map<std::string, std::tr1::shared_ptr<Stats> > routes() const
+  {
+    std::map<std::string, std::tr1::shared_ptr<Stats> > result;
+    collect(&root, "", &result);
+    return result;
+  }
+
+private:
+  static void collect(
+      const Node* node,
+      const std::string& path,
+      std::map<std::string, std::tr1::shared_ptr<Stats> >* result)
+  {
+    if (node->stats.get() != NULL) {
+      (*result)[path] = node->stats;
+    }
+    for (std::map<std::string, Node*>::const_iterator iterator =
+           node->children.begin();
+         iterator != node->children.end();
+         ++iterator) {
+      collect(
+          iterator->second,
+          path.empty() ? iterator->first : path + "/" + iterator->first,
+          result);
+    }
+  }
+
+  Node root;
+};
+
+
 class ProcessBase : public EventVisitor
 {
 public:
@@ -51,6 +193,79 @@ protected:
   // Invoked when a process is terminated (unless visit is overriden).
   virtual void finalize() {}
 
+  // Invoked after each batch of events drained from the event queue
+  // has been serviced (events are dequeued a batch at a time, see
+  // ProcessManager::resume), with the number of events that were in
+  // the batch. A process whose handlers buffer work (e.g., a slave
+  // checkpointing status updates) can override this to flush that
+  // work once per batch rather than once per event.
+  virtual void batched(size_t events) {}
+
+  // Assigns a priority class (see Mailbox::Priority) to an incoming
+  // event; events in higher classes get serviced ahead of lower ones
+  // within each drained batch, so a process can keep e.g. liveness
+  // messages from waiting behind a burst of bulk queries. NOTE: This
+  // gets invoked from whichever thread enqueues the event (before
+  // the event is visible to the process), so overrides must be
+  // thread-safe and cheap -- typically a switch on the event kind or
+  // message name, without touching process state.
+  virtual int classify(const Event& event) const
+  {
+    return Mailbox::NORMAL;
+  }
+
+  // Sets the event queue depth at which 'backlogged' gets invoked
+  // (0, the default, disables the notification). Both fields are
+  // word-sized and only gate instrumentation, so plain stores suffice
+  // (the mailbox is lock-free; there is no queue lock to piggyback
+  // on).
+  void setBacklogThreshold(size_t threshold)
+  {
+    backlog = threshold;
+    warned = 0;
+  }
+
+  // Invoked once the event queue depth reaches the backlog threshold,
+  // and again only after the queue has since been drained. NOTE:
+  // Unlike the other callbacks this gets invoked from whichever
+  // thread enqueued the crossing event (waiting for the backed up
+  // process itself to run would defeat the purpose), so overrides
+  // must be thread-safe.
+  virtual void backlogged(size_t depth) {}
+
+  // A snapshot of the event queue instrumentation; safe to invoke
+  // from any thread (this is the programmatic equivalent of the
+  // /__processes__/stats endpoint).
+  struct QueueStats
+  {
+    QueueStats()
+      : depth(0), watermark(0), enqueued(0), handled(0), oldest(0.0) {}
+
+    size_t depth;       // Events currently waiting to be serviced.
+    size_t watermark;   // Queue depth high-water mark.
+    uint64_t enqueued;  // Events ever enqueued.
+    uint64_t handled;   // Events serviced.
+    double oldest;      // Seconds the oldest waiting event has waited.
+  };
+
+  QueueStats queueStats()
+  {
+    QueueStats snapshot;
+    snapshot.depth = mailbox.depth();
+    lock();
+    {
+      snapshot.watermark = stats.watermark;
+      snapshot.enqueued = stats.enqueued;
+      snapshot.handled = stats.handled;
+    }
+    unlock();
+    double oldest = mailbox.oldest();
+    if (snapshot.depth > 0 && oldest > 0.0) {
+      snapshot.oldest = Clock::now() - oldest;
+    }
+    return snapshot;
+  }
+
   // Invoked when a linked process has exited (see link).
   virtual void exited(const UPID& pid) {}
 
@@ -71,12 +286,28 @@ protected:
       const char* data = NULL,
       size_t length = 0);
 
+  // Sends like 'send' but participates in send-queue flow control:
+  // the returned future stays pending while the destination socket
+  // has more than a high watermark of bytes queued (becoming ready
+  // once it drains), letting the sender slow down for a slow
+  // consumer. If 'expendable' is true the message is instead dropped
+  // (and counted) when over the watermark. Local messages are always
+  // delivered immediately.
+  Future<Nothing> send(
+      const UPID& to,
+      const std::string& name,
+      const std::string& data,
+      bool expendable);
+
   // Links with the specified PID. Linking with a process from within
   // the same "operating system process" is gauranteed to give you
   // perfect monitoring of that process. However, linking with a
   // process on another machine might result in receiving lost
   // callbacks due to the nature of a distributed environment.
-  UPID link(const UPID& pid);
+  // For remote links the socket options select a tuning profile for
+  // the link's traffic class (see SocketOptions); the default leaves
+  // the operating system's settings untouched.
+  UPID link(const UPID& pid, const SocketOptions& options = SocketOptions());
 
   // The default visit implementation for message events invokes
   // installed message handlers, or delegates the message to another
@@ -117,13 +348,9 @@ protected:
     delegates[name] = pid;
   }
 
-  // The default visit implementation for HTTP events invokes
-  // installed HTTP handlers. A HTTP handler is any function which
-  // takes an http::Request object and returns an http::Response.
-  typedef std::tr1::function<Future<http::Response>(const http::Request&)>
-  HttpRequestHandler;
-
-  // Setup a handler for an HTTP request.
+  // Setup a handler for an HTTP request (see HttpRequestHandler and
+  // HttpRouter above; 'name' may contain several segments as well as
+  // '*' wildcard segments, e.g., "/logs/*").
   bool route(
       const std::string& name,
       const HttpRequestHandler& handler)
@@ -131,7 +358,7 @@ protected:
     if (name.find('/') != 0) {
       return false;
     }
-    handlers.http[name.substr(1)] = handler;
+    handlers.http.install(name.substr(1), handler);
     return true;
   }
 
@@ -177,13 +404,25 @@ private:
   friend class ProcessReference;
   friend void* schedule(void*);
 
-  // Process states.
+  // Process states. Kept in a word (rather than the enum type) so
+  // the BLOCKED -> READY handoff between a producer pushing on the
+  // lock-free mailbox and the consumer going idle can use a
+  // compare-and-swap (see ProcessBase::enqueue and
+  // ProcessManager::resume); all other transitions happen from the
+  // thread running the process or under the processes lock.
   enum { BOTTOM,
          READY,
 	 RUNNING,
          BLOCKED,
          TERMINATING,
-	 TERMINATED } state;
+	 TERMINATED };
+
+  volatile int state;
+
+  // Whether libprocess owns this process and should reclaim it after
+  // termination (i.e., it was spawned with 'manage' set). Set once at
+  // spawn, read by ProcessManager::cleanup.
+  bool manage;
 
   // Mutex protecting internals.
   // TODO(benh): Consider replacing with a spinlock, on multi-core systems.
@@ -194,8 +433,44 @@ private:
   // Enqueue the specified message, request, or function call.
   void enqueue(Event* event, bool inject = false);
 
-  // Queue of received events.
-  std::deque<Event*> events;
+  // Queue of received events (lock-free, multi-producer
+  // single-consumer; only the thread running the process drains it).
+  Mailbox mailbox;
+
+  // Lightweight event instrumentation exposed via the
+  // /__processes__/stats endpoint. The producer-side counters
+  // (enqueued, watermark) are bumped with atomic operations from
+  // ProcessBase::enqueue; the rest gets folded in under the process
+  // lock by ProcessManager::resume.
+  struct Stats
+  {
+    Stats() : enqueued(0), handled(0), watermark(0), busy(0.0)
+    {
+      for (size_t i = 0; i < BUCKETS; i++) {
+        latencies[i] = 0;
+      }
+    }
+
+    // Number of buckets in the latency histogram; bucket upper
+    // bounds are 10us, 100us, 1ms, 10ms, 100ms, 1s, +Inf.
+    enum { BUCKETS = 7 };
+
+    uint64_t enqueued;  // Events ever enqueued.
+    uint64_t handled;   // Events serviced.
+    size_t watermark;   // Queue depth high-water mark.
+    double busy;        // Total seconds spent servicing events.
+
+    // Histogram of enqueue-to-resume latency.
+    uint64_t latencies[BUCKETS];
+  } stats;
+
+  // Event queue depth at which 'backlogged' is invoked (0 disables)
+  // and whether it has already been invoked for the current backlog
+  // (set with a compare-and-swap so exactly one producer fires the
+  // notification; re-armed once the queue drains, see
+  // ProcessManager::resume).
+  size_t backlog;
+  volatile int warned;
 
   // Delegates for messages.
   std::map<std::string, UPID> delegates;
@@ -203,7 +478,7 @@ private:
   // Handlers for messages and HTTP requests.
   struct {
     std::map<std::string, MessageHandler> message;
-    std::map<std::string, HttpRequestHandler> http;
+    HttpRouter http;
   } handlers;
 
   // Definition of a static asset.
@@ -219,6 +494,10 @@ private:
   // Active references.
   int refs;
 
+  // Index of the worker thread this process last ran on, or -1 if it
+  // has not run yet. Used by ProcessManager for scheduling affinity.
+  int worker;
+
   // Process PID.
   UPID pid;
 };
@@ -333,6 +612,24 @@ void post(const UPID& to,
           size_t length = 0);
 
 
+/**
+ * Sends a message with data as if it came from 'from'. Note that the
+ * receiver may reply to (or link against) 'from'; useful for driving
+ * a process with recorded traffic from senders that no longer exist.
+ *
+ * @param from sender the message will appear to come from
+ * @param to receiver
+ * @param name message name
+ * @param data data to send (gets copied)
+ * @param length length of data
+ */
+void post(const UPID& from,
+          const UPID& to,
+          const std::string& name,
+          const char* data = NULL,
+          size_t length = 0);
+
+
 // Inline implementations of above.
 inline void terminate(const ProcessBase& process, bool inject)
 {
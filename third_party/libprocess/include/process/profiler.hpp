@@ -4,10 +4,15 @@
 #include <glog/logging.h>
 
 #ifdef HAS_GPERFTOOLS
+#include <gperftools/heap-profiler.h>
+#include <gperftools/malloc_extension.h>
 #include <gperftools/profiler.h>
 #endif
 
+#include <stdlib.h>
+
 #include <string>
+#include <vector>
 
 #include <process/future.hpp>
 #include <process/http.hpp>
@@ -19,6 +24,7 @@
 namespace process {
 
 const std::string PROFILE_FILE = "perftools.out";
+const std::string HEAP_PROFILE_PREFIX = "perftools.heap";
 
 class Profiler : public Process<Profiler>
 {
@@ -32,6 +38,10 @@ protected:
   {
     route("/start", &Profiler::start);
     route("/stop", &Profiler::stop);
+    route("/heap/start", &Profiler::heapStart);
+    route("/heap/stop", &Profiler::heapStop);
+    route("/heap/sample", &Profiler::heapSample);
+    route("/heap/stats", &Profiler::heapStats);
   }
 
 private:
@@ -108,6 +118,104 @@ private:
 #endif
   }
 
+  // Starts the heap profiler. There are no request parameters.
+  // Allocation samples accumulate until /profiler/heap/stop is
+  // requested (intermediate dumps are written by gperftools as the
+  // program grows, prefixed with HEAP_PROFILE_PREFIX).
+  Future<http::Response> heapStart(const http::Request& request)
+  {
+#ifdef HAS_GPERFTOOLS
+    if (os::getenv("LIBPROCESS_ENABLE_PROFILER", false) != "1") {
+      return http::BadRequest(
+          "The profiler is not enabled. To enable the profiler, libprocess "
+          "must be started with LIBPROCESS_ENABLE_PROFILER=1 in the "
+          "environment.\n");
+    }
+
+    if (IsHeapProfilerRunning()) {
+      return http::BadRequest("Heap profiler already started.\n");
+    }
+
+    LOG(INFO) << "Starting Heap Profiler";
+
+    HeapProfilerStart(HEAP_PROFILE_PREFIX.c_str());
+
+    return http::OK("Heap profiler started.\n");
+#else
+    return http::BadRequest(
+        "Perftools is disabled. To enable perftools, "
+        "configure libprocess with --enable-perftools.\n");
+#endif
+  }
+
+  // Stops the heap profiler. There are no request parameters.
+  // This returns the heap profile collected since the profiler was
+  // started, i.e., the live allocations attributed to their
+  // allocation sites.
+  Future<http::Response> heapStop(const http::Request& request)
+  {
+#ifdef HAS_GPERFTOOLS
+    if (!IsHeapProfilerRunning()) {
+      return http::BadRequest("Heap profiler not running.\n");
+    }
+
+    LOG(INFO) << "Stopping Heap Profiler";
+
+    // NOTE: GetHeapProfile() allocates via malloc, hence free below.
+    char* profile = GetHeapProfile();
+
+    HeapProfilerStop();
+
+    http::OK response(profile);
+    response.headers["Content-Type"] = "application/octet-stream";
+    response.headers["Content-Disposition"] =
+      strings::format("attachment; filename=%s", HEAP_PROFILE_PREFIX).get();
+
+    free(profile);
+
+    return response;
+#else
+    return http::BadRequest(
+        "Perftools is disabled. To enable perftools, "
+        "configure libprocess with --enable-perftools.\n");
+#endif
+  }
+
+  // Returns a sample of live heap allocations with their allocation
+  // sites. Unlike /profiler/heap/start, sampling is always on inside
+  // tcmalloc so this is cheap enough to poll in production.
+  Future<http::Response> heapSample(const http::Request& request)
+  {
+#ifdef HAS_GPERFTOOLS
+    std::string sample;
+    MallocExtension::instance()->GetHeapSample(&sample);
+
+    http::OK response(sample);
+    response.headers["Content-Type"] = "application/octet-stream";
+    return response;
+#else
+    return http::BadRequest(
+        "Perftools is disabled. To enable perftools, "
+        "configure libprocess with --enable-perftools.\n");
+#endif
+  }
+
+  // Returns human readable allocator statistics, including tcmalloc's
+  // per-size-class free lists, central cache and page heap usage.
+  Future<http::Response> heapStats(const http::Request& request)
+  {
+#ifdef HAS_GPERFTOOLS
+    std::vector<char> buffer(64 * 1024);
+    MallocExtension::instance()->GetStats(&buffer[0], buffer.size());
+
+    return http::OK(std::string(&buffer[0]));
+#else
+    return http::BadRequest(
+        "Perftools is disabled. To enable perftools, "
+        "configure libprocess with --enable-perftools.\n");
+#endif
+  }
+
   bool started;
 };
 
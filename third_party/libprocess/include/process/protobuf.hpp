@@ -10,9 +10,10 @@
 #include <vector>
 
 #include <tr1/functional>
-#include <tr1/unordered_map>
+#include <tr1/memory>
 
 #include <process/dispatch.hpp>
+#include <process/message.hpp>
 #include <process/process.hpp>
 
 
@@ -66,18 +67,34 @@ template <typename T>
 class ProtobufProcess : public process::Process<T>
 {
 public:
+  ProtobufProcess() : incoming(NULL) {}
+
   virtual ~ProtobufProcess() {}
 
 protected:
   virtual void visit(const process::MessageEvent& event)
   {
-    if (protobufHandlers.count(event.message->name) > 0) {
-      from = event.message->from; // For 'reply'.
-      protobufHandlers[event.message->name](event.message->body);
-      from = process::UPID();
-    } else {
-      process::Process<T>::visit(event);
+    const std::string& name = event.message->name;
+
+    // Resolve the name to a compact handler id via the keyed lookup
+    // table (see below) rather than hashing the full type name on
+    // every delivery; dispatch is then just an array index.
+    if (!slots.empty()) {
+      size_t index = key(name.data(), name.size()) & (slots.size() - 1);
+      while (slots[index].id >= 0) {
+        if (slots[index].name == name) {
+          from = event.message->from; // For 'reply'.
+          incoming = event.message;   // For 'forward'.
+          protobufHandlers[slots[index].id](event.message->body);
+          from = process::UPID();
+          incoming = NULL;
+          return;
+        }
+        index = (index + 1) & (slots.size() - 1);
+      }
     }
+
+    process::Process<T>::visit(event);
   }
 
   void send(const process::UPID& to,
@@ -99,16 +116,35 @@ protected:
     send(from, message);
   }
 
+  // Forwards the message currently being dispatched to 'to' verbatim
+  // (same type, same serialized body). A handler that only routes a
+  // message based on a few of its fields can use this to avoid
+  // rebuilding and re-serializing it just to pass along bulky
+  // payloads (e.g., data blobs) it never looks at. Only valid while
+  // a handler installed on this process is running.
+  void forward(const process::UPID& to)
+  {
+    CHECK(incoming != NULL) << "Attempting to forward without a message";
+    process::Process<T>::send(to, incoming->name,
+                              incoming->body.data(), incoming->body.size());
+  }
+
+  // Each installed handler owns a message instance which gets
+  // cleared and re-parsed for every delivery rather than
+  // constructing (and destroying) a fresh message each time. This
+  // is safe because handlers only ever run serially from 'visit',
+  // and it means high-rate messages reuse already allocated
+  // sub-messages and strings across deliveries.
   template <typename M>
   void install(void (T::*method)(const M&))
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
-    protobufHandlers[m->GetTypeName()] =
-      std::tr1::bind(&handlerM<M>,
-                     t, method,
-                     std::tr1::placeholders::_1);
-    delete m;
+    installHandler(
+        m->GetTypeName(),
+        std::tr1::bind(&handlerM<M>,
+                       t, method, m,
+                       std::tr1::placeholders::_1));
   }
 
   template <typename M>
@@ -116,10 +152,11 @@ protected:
   {
     google::protobuf::Message* m = new M();
     T* t = static_cast<T*>(this);
-    protobufHandlers[m->GetTypeName()] =
-      std::tr1::bind(&handler0,
-                     t, method,
-                     std::tr1::placeholders::_1);
+    installHandler(
+        m->GetTypeName(),
+        std::tr1::bind(&handler0,
+                       t, method,
+                       std::tr1::placeholders::_1));
     delete m;
   }
 
@@ -128,13 +165,13 @@ protected:
   void install(void (T::*method)(P1C),
                               P1 (M::*param1)() const)
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
-    protobufHandlers[m->GetTypeName()] =
-      std::tr1::bind(&handler1<M, P1, P1C>,
-                     t, method, param1,
-                     std::tr1::placeholders::_1);
-    delete m;
+    installHandler(
+        m->GetTypeName(),
+        std::tr1::bind(&handler1<M, P1, P1C>,
+                       t, method, m, param1,
+                       std::tr1::placeholders::_1));
   }
 
   template <typename M,
@@ -144,13 +181,13 @@ protected:
                               P1 (M::*p1)() const,
                               P2 (M::*p2)() const)
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
-    protobufHandlers[m->GetTypeName()] =
-      std::tr1::bind(&handler2<M, P1, P1C, P2, P2C>,
-                     t, method, p1, p2,
-                     std::tr1::placeholders::_1);
-    delete m;
+    installHandler(
+        m->GetTypeName(),
+        std::tr1::bind(&handler2<M, P1, P1C, P2, P2C>,
+                       t, method, m, p1, p2,
+                       std::tr1::placeholders::_1));
   }
 
   template <typename M,
@@ -162,13 +199,13 @@ protected:
                               P2 (M::*p2)() const,
                               P3 (M::*p3)() const)
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
-    protobufHandlers[m->GetTypeName()] =
-      std::tr1::bind(&handler3<M, P1, P1C, P2, P2C, P3, P3C>,
-                     t, method, p1, p2, p3,
-                     std::tr1::placeholders::_1);
-    delete m;
+    installHandler(
+        m->GetTypeName(),
+        std::tr1::bind(&handler3<M, P1, P1C, P2, P2C, P3, P3C>,
+                       t, method, m, p1, p2, p3,
+                       std::tr1::placeholders::_1));
   }
 
   template <typename M,
@@ -182,13 +219,13 @@ protected:
                               P3 (M::*p3)() const,
                               P4 (M::*p4)() const)
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
-    protobufHandlers[m->GetTypeName()] =
-      std::tr1::bind(&handler4<M, P1, P1C, P2, P2C, P3, P3C, P4, P4C>,
-                     t, method, p1, p2, p3, p4,
-                     std::tr1::placeholders::_1);
-    delete m;
+    installHandler(
+        m->GetTypeName(),
+        std::tr1::bind(&handler4<M, P1, P1C, P2, P2C, P3, P3C, P4, P4C>,
+                       t, method, m, p1, p2, p3, p4,
+                       std::tr1::placeholders::_1));
   }
 
   template <typename M,
@@ -204,31 +241,36 @@ protected:
                               P4 (M::*p4)() const,
                               P5 (M::*p5)() const)
   {
-    google::protobuf::Message* m = new M();
+    std::tr1::shared_ptr<M> m(new M());
     T* t = static_cast<T*>(this);
-    protobufHandlers[m->GetTypeName()] =
-      std::tr1::bind(&handler5<M, P1, P1C, P2, P2C, P3, P3C, P4, P4C, P5, P5C>,
-                     t, method, p1, p2, p3, p4, p5,
-                     std::tr1::placeholders::_1);
-    delete m;
+    installHandler(
+        m->GetTypeName(),
+        std::tr1::bind(
+            &handler5<M, P1, P1C, P2, P2C, P3, P3C, P4, P4C, P5, P5C>,
+            t, method, m, p1, p2, p3, p4, p5,
+            std::tr1::placeholders::_1));
   }
 
   using process::Process<T>::install;
 
   process::UPID from; // Sender of "current" message, accessible by subclasses.
 
+  // The "current" message (only while a handler runs), for 'forward'.
+  const process::Message* incoming;
+
 private:
   template <typename M>
   static void handlerM(T* t, void (T::*method)(const M&),
+                       const std::tr1::shared_ptr<M>& m,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(m);
+    m->Clear();
+    m->ParseFromArray(data.data(), data.size());
+    if (m->IsInitialized()) {
+      (t->*method)(*m);
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
   }
 
@@ -241,16 +283,17 @@ private:
   template <typename M,
             typename P1, typename P1C>
   static void handler1(T* t, void (T::*method)(P1C),
+                       const std::tr1::shared_ptr<M>& m,
                        P1 (M::*p1)() const,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(google::protobuf::convert((&m->*p1)()));
+    m->Clear();
+    m->ParseFromArray(data.data(), data.size());
+    if (m->IsInitialized()) {
+      (t->*method)(google::protobuf::convert((m.get()->*p1)()));
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
   }
 
@@ -258,18 +301,19 @@ private:
             typename P1, typename P1C,
             typename P2, typename P2C>
   static void handler2(T* t, void (T::*method)(P1C, P2C),
+                       const std::tr1::shared_ptr<M>& m,
                        P1 (M::*p1)() const,
                        P2 (M::*p2)() const,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(google::protobuf::convert((&m->*p1)()),
-                   google::protobuf::convert((&m->*p2)()));
+    m->Clear();
+    m->ParseFromArray(data.data(), data.size());
+    if (m->IsInitialized()) {
+      (t->*method)(google::protobuf::convert((m.get()->*p1)()),
+                   google::protobuf::convert((m.get()->*p2)()));
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
   }
 
@@ -278,20 +322,21 @@ private:
             typename P2, typename P2C,
             typename P3, typename P3C>
   static void handler3(T* t, void (T::*method)(P1C, P2C, P3C),
+                       const std::tr1::shared_ptr<M>& m,
                        P1 (M::*p1)() const,
                        P2 (M::*p2)() const,
                        P3 (M::*p3)() const,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(google::protobuf::convert((&m->*p1)()),
-                   google::protobuf::convert((&m->*p2)()),
-                   google::protobuf::convert((&m->*p3)()));
+    m->Clear();
+    m->ParseFromArray(data.data(), data.size());
+    if (m->IsInitialized()) {
+      (t->*method)(google::protobuf::convert((m.get()->*p1)()),
+                   google::protobuf::convert((m.get()->*p2)()),
+                   google::protobuf::convert((m.get()->*p3)()));
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
   }
 
@@ -301,22 +346,23 @@ private:
             typename P3, typename P3C,
             typename P4, typename P4C>
   static void handler4(T* t, void (T::*method)(P1C, P2C, P3C, P4C),
+                       const std::tr1::shared_ptr<M>& m,
                        P1 (M::*p1)() const,
                        P2 (M::*p2)() const,
                        P3 (M::*p3)() const,
                        P4 (M::*p4)() const,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(google::protobuf::convert((&m->*p1)()),
-                   google::protobuf::convert((&m->*p2)()),
-                   google::protobuf::convert((&m->*p3)()),
-                   google::protobuf::convert((&m->*p4)()));
+    m->Clear();
+    m->ParseFromArray(data.data(), data.size());
+    if (m->IsInitialized()) {
+      (t->*method)(google::protobuf::convert((m.get()->*p1)()),
+                   google::protobuf::convert((m.get()->*p2)()),
+                   google::protobuf::convert((m.get()->*p3)()),
+                   google::protobuf::convert((m.get()->*p4)()));
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
   }
 
@@ -327,6 +373,7 @@ private:
             typename P4, typename P4C,
             typename P5, typename P5C>
   static void handler5(T* t, void (T::*method)(P1C, P2C, P3C, P4C, P5C),
+                       const std::tr1::shared_ptr<M>& m,
                        P1 (M::*p1)() const,
                        P2 (M::*p2)() const,
                        P3 (M::*p3)() const,
@@ -334,22 +381,88 @@ private:
                        P5 (M::*p5)() const,
                        const std::string& data)
   {
-    M m;
-    m.ParseFromString(data);
-    if (m.IsInitialized()) {
-      (t->*method)(google::protobuf::convert((&m->*p1)()),
-                   google::protobuf::convert((&m->*p2)()),
-                   google::protobuf::convert((&m->*p3)()),
-                   google::protobuf::convert((&m->*p4)()),
-                   google::protobuf::convert((&m->*p5)()));
+    m->Clear();
+    m->ParseFromArray(data.data(), data.size());
+    if (m->IsInitialized()) {
+      (t->*method)(google::protobuf::convert((m.get()->*p1)()),
+                   google::protobuf::convert((m.get()->*p2)()),
+                   google::protobuf::convert((m.get()->*p3)()),
+                   google::protobuf::convert((m.get()->*p4)()),
+                   google::protobuf::convert((m.get()->*p5)()));
     } else {
       LOG(WARNING) << "Initialization errors: "
-                   << m.InitializationErrorString();
+                   << m->InitializationErrorString();
     }
   }
 
   typedef std::tr1::function<void(const std::string&)> handler;
-  std::tr1::unordered_map<std::string, handler> protobufHandlers;
+
+  // Handlers are stored densely in 'protobufHandlers' (the id of a
+  // handler is simply its installation order) and incoming names are
+  // resolved to ids through a small open addressed lookup table
+  // keyed by a couple of characters of the name instead of a hash of
+  // the whole string: the installed type names form a small closed
+  // set sharing long common prefixes (e.g., 'mesos.internal.'), so
+  // the length and the trailing characters discriminate them, and
+  // delivering a message costs computing a two character key, an
+  // array index, and a single string equality check. The table is
+  // kept at least 4x oversized so probes essentially always hit the
+  // right slot first; collisions just fall back to linear probing.
+
+  struct Slot
+  {
+    Slot() : id(-1) {}
+    std::string name;
+    int id;
+  };
+
+  static size_t key(const char* name, size_t length)
+  {
+    size_t k = length;
+    if (length >= 2) {
+      k += (size_t) (unsigned char) name[length - 1] << 3;
+      k += (size_t) (unsigned char) name[length - 2] << 7;
+    }
+    return k;
+  }
+
+  void installHandler(const std::string& name, const handler& h)
+  {
+    // Replace any existing handler for this name (mirroring the
+    // semantics of the handler map this table replaced).
+    for (size_t i = 0; i < slots.size(); i++) {
+      if (slots[i].id >= 0 && slots[i].name == name) {
+        protobufHandlers[slots[i].id] = h;
+        return;
+      }
+    }
+
+    protobufHandlers.push_back(h);
+    names.push_back(name);
+
+    // Rebuild the lookup table; installs only happen while a process
+    // is being initialized so rebuilding is cheap.
+    size_t size = 16;
+    while (size < 4 * protobufHandlers.size()) {
+      size <<= 1;
+    }
+
+    slots.clear();
+    slots.resize(size);
+
+    for (size_t id = 0; id < names.size(); id++) {
+      size_t index = key(names[id].data(), names[id].size()) & (size - 1);
+      while (slots[index].id >= 0) {
+        index = (index + 1) & (size - 1);
+      }
+      slots[index].name = names[id];
+      slots[index].id = (int) id;
+    }
+  }
+
+  std::vector<handler> protobufHandlers;
+  std::vector<std::string> names;
+  std::vector<Slot> slots;
 };
 
 
@@ -58,7 +58,7 @@ Future<R> run(R (*method)(void))
             ENUM_PARAMS(N, typename A)>                                 \
   Future<R> run(                                                        \
       R (*method)(ENUM_PARAMS(N, P)),                                   \
-      ENUM_BINARY_PARAMS(N, A, a))                                      \
+      ENUM_BINARY_PARAMS(N, const A, &a))                               \
   {                                                                     \
     std::tr1::shared_ptr<std::tr1::function<R(void)> > thunk(           \
         new std::tr1::function<R(void)>(                                \
@@ -4,6 +4,54 @@
 #include <assert.h>
 #include <unistd.h> // For close.
 
+#include <stout/option.hpp>
+
+// Tuning options applied to a socket when a link gets established.
+// The defaults leave everything at the operating system's values;
+// the named profiles capture the two link classes we care about
+// (many chatty control links versus few bulky transfer links), so
+// callers pick a profile rather than individual options.
+struct SocketOptions
+{
+  SocketOptions() : nodelay(false), keepalive(false) {}
+
+  // Profile for links carrying many small latency sensitive messages
+  // (e.g., master<->slave and master<->scheduler control traffic):
+  // Nagle's algorithm off so small messages don't get delayed behind
+  // unacknowledged data, keepalive on so dead peers get noticed on
+  // otherwise idle links.
+  static SocketOptions control()
+  {
+    SocketOptions options;
+    options.nodelay = true;
+    options.keepalive = true;
+    return options;
+  }
+
+  // Profile for links moving bulk data (e.g., file transfers): large
+  // kernel buffers to keep the pipe full, Nagle left on so full
+  // segments get coalesced.
+  static SocketOptions bulk()
+  {
+    SocketOptions options;
+    options.sndbuf = 512 * 1024;
+    options.rcvbuf = 512 * 1024;
+    return options;
+  }
+
+  // Disables Nagle's algorithm (TCP_NODELAY).
+  bool nodelay;
+
+  // Enables keepalive probing (SO_KEEPALIVE).
+  bool keepalive;
+
+  // Kernel send/receive buffer sizes in bytes (SO_SNDBUF/SO_RCVBUF);
+  // none means the system default.
+  Option<int> sndbuf;
+  Option<int> rcvbuf;
+};
+
+
 // An abstraction around a socket (file descriptor) that provides
 // reference counting such that the socket is only closed (and thus,
 // has the possiblity of being reused) after there are no more
@@ -33,17 +33,13 @@ extern Statistics* statistics;
 
 const Duration STATISTICS_TRUNCATION_INTERVAL = Minutes(5.0);
 
-// Provides an in-memory time series of statistics over some window
-// (values are truncated outside of the window, but no limit is
-// currently placed on the number of values within a window).
-//
-// TODO(bmahler): Time series granularity should be coarsened over
-// time. This means, for high-frequency statistics, we keep a lot of
-// recent data points (fine granularity), and keep fewer older data
-// points (coarse granularity). The tunable bit here could be the
-// total number of data points to keep around, which informs how
-// often to delete older data points, while still keeping a window
-// worth of data.
+// Provides an in-memory time series of statistics over some window.
+// Values are truncated outside of the window, and storage within the
+// window is bounded: each series keeps recent values raw but
+// downsamples older values into 10 second and then 1 minute averages
+// (so for high-frequency statistics we keep a lot of recent data
+// points at fine granularity, and fewer older data points at coarse
+// granularity, in a fixed footprint per series).
 class Statistics
 {
 public:
@@ -10,11 +10,14 @@ namespace process {
 class Timeout
 {
 public:
+  // Deadlines are established from a precise clock read: basing one
+  // on the coarse cached timestamp (which may lag behind real time)
+  // would make the resulting timer fire early.
   Timeout()
-    : timeout(Clock::now()) {}
+    : timeout(Clock::preciseNow()) {}
 
   Timeout(const Duration& duration)
-    : timeout(Clock::now() + duration.secs()) {}
+    : timeout(Clock::preciseNow() + duration.secs()) {}
 
   Timeout(const Timeout& that)
     : timeout(that.timeout) {}
@@ -30,7 +33,7 @@ public:
 
   Timeout& operator = (const Duration& duration)
   {
-    timeout = Clock::now() + duration.secs();
+    timeout = Clock::preciseNow() + duration.secs();
     return *this;
   }
 
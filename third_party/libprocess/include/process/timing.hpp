@@ -0,0 +1,156 @@
+#ifndef __PROCESS_TIMING_HPP__
+#define __PROCESS_TIMING_HPP__
+
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <string>
+
+namespace process {
+namespace timing {
+
+// Scoped timing probes: dropping TIMED_SCOPE("name") into a function
+// records how long the enclosing scope took into a histogram
+// registered under that name. The histograms are exposed over HTTP
+// (see TimingProcess in process.cpp):
+//   /timing/start      enable recording
+//   /timing/stop       disable recording
+//   /timing/snapshot   per probe summaries as JSON
+//
+// The probes are meant to be left compiled into hot paths
+// permanently: while recording is disabled a scope costs a single
+// load, and while enabled it costs two clock_gettime calls plus a
+// few atomic increments.
+
+// Histogram buckets hold durations in nanoseconds by power of two.
+const size_t BUCKETS = 64;
+
+// Each probe's counters are sharded so that concurrent scopes on
+// different threads mostly do not contend on the same cache lines;
+// snapshots merge the shards. This approximates per-thread
+// histograms without per-thread registration and merging machinery.
+const size_t SHARDS = 8;
+
+
+struct Shard
+{
+  uint64_t count;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+  uint64_t buckets[BUCKETS];
+
+  // Padded out so shards on adjacent indices don't share a line.
+  char padding[64];
+};
+
+
+class Probe
+{
+public:
+  explicit Probe(const std::string& _name) : name(_name)
+  {
+    for (size_t i = 0; i < SHARDS; i++) {
+      shards[i].count = 0;
+      shards[i].sum = 0;
+      shards[i].min = (uint64_t) -1;
+      shards[i].max = 0;
+      for (size_t j = 0; j < BUCKETS; j++) {
+        shards[i].buckets[j] = 0;
+      }
+    }
+  }
+
+  void record(uint64_t nanoseconds)
+  {
+    // Thread stacks are at least page aligned, so the low bits of
+    // the thread id are not useful for picking a shard.
+    Shard* shard =
+      &shards[((uintptr_t) pthread_self() >> 12) & (SHARDS - 1)];
+
+    __sync_fetch_and_add(&shard->count, 1);
+    __sync_fetch_and_add(&shard->sum, nanoseconds);
+
+    size_t bucket = 0;
+    uint64_t value = nanoseconds;
+    while (value >>= 1) {
+      bucket++;
+    }
+    __sync_fetch_and_add(&shard->buckets[bucket], 1);
+
+    // Racy, but a lost min/max update only costs a little accuracy
+    // in monitoring output.
+    if (nanoseconds < shard->min) {
+      shard->min = nanoseconds;
+    }
+    if (nanoseconds > shard->max) {
+      shard->max = nanoseconds;
+    }
+  }
+
+  const std::string name;
+  Shard shards[SHARDS];
+};
+
+
+// Whether scopes currently record (toggled over HTTP).
+extern bool enabled;
+
+
+// Returns the probe registered under 'name', creating it on first
+// use. Probes are never deleted.
+Probe* probe(const std::string& name);
+
+
+// Renders all of the probes as a JSON object mapping each probe's
+// name to its merged histogram summary.
+std::string snapshot();
+
+
+inline uint64_t now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+class Scope
+{
+public:
+  explicit Scope(Probe* _probe) : probe(enabled ? _probe : NULL)
+  {
+    if (probe != NULL) {
+      start = now();
+    }
+  }
+
+  ~Scope()
+  {
+    if (probe != NULL) {
+      probe->record(now() - start);
+    }
+  }
+
+private:
+  Probe* probe;
+  uint64_t start;
+};
+
+} // namespace timing {
+} // namespace process {
+
+
+#define TIMED_CONCAT_(a, b) a##b
+#define TIMED_CONCAT(a, b) TIMED_CONCAT_(a, b)
+
+// Records the time spent in the enclosing scope into the histogram
+// registered under 'name'.
+#define TIMED_SCOPE(name)                                               \
+  static ::process::timing::Probe* TIMED_CONCAT(__timing_probe_, __LINE__) = \
+    ::process::timing::probe(name);                                     \
+  ::process::timing::Scope TIMED_CONCAT(__timing_scope_, __LINE__)(     \
+      TIMED_CONCAT(__timing_probe_, __LINE__))
+
+#endif // __PROCESS_TIMING_HPP__
@@ -3,6 +3,7 @@
 
 #include <http_parser.h>
 
+#include <algorithm>
 #include <deque>
 #include <string>
 #include <vector>
@@ -104,6 +105,16 @@ private:
 
     decoder->request->method = http_method_str((http_method) decoder->parser.method);
     decoder->request->keepAlive = http_should_keep_alive(&decoder->parser);
+
+    // Reserve the body capacity up front (within reason) so that
+    // large bodies (e.g., executor checkpoint uploads) don't get
+    // repeatedly reallocated and copied as the reads trickle in.
+    if (decoder->parser.content_length > 0) {
+      decoder->request->body.reserve(
+          std::min((int64_t) 16 * 1024 * 1024,
+                   decoder->parser.content_length));
+    }
+
     return 0;
   }
 
@@ -300,6 +311,14 @@ private:
     decoder->field.clear();
     decoder->value.clear();
 
+    // Reserve the body capacity up front (within reason) so large
+    // bodies don't get repeatedly reallocated as the reads trickle in.
+    if (decoder->parser.content_length > 0) {
+      decoder->response->body.reserve(
+          std::min((int64_t) 16 * 1024 * 1024,
+                   decoder->parser.content_length));
+    }
+
     return 0;
   }
 
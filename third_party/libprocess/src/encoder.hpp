@@ -3,8 +3,11 @@
 
 #include <ev.h>
 
+#include <sys/uio.h>
+
 #include <map>
 #include <sstream>
+#include <vector>
 
 #include <process/http.hpp>
 #include <process/process.hpp>
@@ -30,14 +33,26 @@ class Encoder
 public:
   virtual ~Encoder() {}
   virtual Sender sender() = 0;
+
+  // Number of bytes still to be sent, used for send-queue byte
+  // accounting (see SocketManager).
+  virtual size_t remaining() const = 0;
 };
 
 
+// An encoder of one or more segments of data, intended for writev
+// style (gather) output so that, for example, a message body never
+// needs to be copied into a contiguous wire buffer. The segments
+// reference memory owned by the encoder (or by something the encoder
+// keeps alive, like a Message), never copies.
 class DataEncoder : public Encoder
 {
 public:
   DataEncoder(const std::string& _data)
-    : data(_data), index(0) {}
+    : data(_data), index(0), total(0)
+  {
+    append(data.data(), data.size());
+  }
 
   virtual ~DataEncoder() {}
 
@@ -46,12 +61,30 @@ public:
     return send_data;
   }
 
-  virtual const char* next(size_t* length)
+  // Fills in at most 'size' iovec structures with the remaining data
+  // and advances past it, returning the number of structures filled
+  // in. The iovec structures reference the encoder's buffers and are
+  // only valid while the encoder is. As with the old single buffer
+  // interface, a caller that sends less than everything is expected
+  // to invoke 'backup' with what was left over.
+  int next(struct iovec* iov, int size)
   {
-    size_t temp = index;
-    index = data.size();
-    *length = data.size() - temp;
-    return data.data() + temp;
+    size_t offset = 0;
+    int count = 0;
+
+    for (size_t i = 0; i < segments.size() && count < size; i++) {
+      const Segment& segment = segments[i];
+      if (offset + segment.length > index) {
+        size_t skip = index > offset ? index - offset : 0;
+        iov[count].iov_base = (void*) (segment.base + skip);
+        iov[count].iov_len = segment.length - skip;
+        index += iov[count].iov_len;
+        count++;
+      }
+      offset += segment.length;
+    }
+
+    return count;
   }
 
   virtual void backup(size_t length)
@@ -63,12 +96,37 @@ public:
 
   virtual size_t remaining() const
   {
-    return data.size() - index;
+    return total - index;
+  }
+
+protected:
+  // Constructs an encoder without any segments, for derived classes
+  // that append their own.
+  DataEncoder() : index(0), total(0) {}
+
+  // Appends a segment. The memory must outlive the encoder.
+  void append(const char* base, size_t length)
+  {
+    if (length > 0) {
+      segments.push_back(Segment(base, length));
+      total += length;
+    }
   }
 
 private:
+  struct Segment
+  {
+    Segment(const char* _base, size_t _length)
+      : base(_base), length(_length) {}
+
+    const char* base;
+    size_t length;
+  };
+
   const std::string data;
-  size_t index;
+  std::vector<Segment> segments;
+  size_t index; // Offset into the logical concatenation of segments.
+  size_t total; // Total number of bytes across all segments.
 };
 
 
@@ -76,7 +134,10 @@ class MessageEncoder : public DataEncoder
 {
 public:
   MessageEncoder(Message* _message)
-    : DataEncoder(encode(_message)), message(_message) {}
+    : message(_message)
+  {
+    encode();
+  }
 
   virtual ~MessageEncoder()
   {
@@ -85,33 +146,48 @@ public:
     }
   }
 
-  static std::string encode(Message* message)
+private:
+  void encode()
   {
-    if (message != NULL) {
-      std::ostringstream out;
-
-      out << "POST /" << message->to.id << "/" << message->name
-          << " HTTP/1.0\r\n"
-          << "User-Agent: libprocess/" << message->from << "\r\n"
-          << "Connection: Keep-Alive\r\n";
-
-      if (message->body.size() > 0) {
-        out << "Transfer-Encoding: chunked\r\n\r\n"
-            << std::hex << message->body.size() << "\r\n";
-        out.write(message->body.data(), message->body.size());
-        out << "\r\n"
-            << "0\r\n"
-            << "\r\n";
-      } else {
-        out << "\r\n";
-      }
+    std::ostringstream out;
+
+    out << "POST /" << message->to.id << "/" << message->name
+        << " HTTP/1.0\r\n"
+        << "User-Agent: libprocess/" << message->from << "\r\n"
+        << "Connection: Keep-Alive\r\n";
+
+    // Content codec for the body, if any (see SocketManager::announce
+    // in process.cpp); only ever set for a peer that announced it can
+    // decode the codec.
+    if (!message->encoding.empty()) {
+      out << "Libprocess-Encoding: " << message->encoding << "\r\n";
+    }
+
+    // Propagate the correlation id for tracing (see the 'trace'
+    // namespace in process.cpp).
+    if (message->correlation != 0) {
+      out << "Libprocess-Trace-Id: " << message->correlation << "\r\n";
+    }
 
-      return out.str();
+    if (message->body.size() > 0) {
+      out << "Transfer-Encoding: chunked\r\n\r\n"
+          << std::hex << message->body.size() << "\r\n";
+      header = out.str();
+      append(header.data(), header.size());
+
+      // Reference the body in place (we own the message until the
+      // send completes) rather than copying it onto the headers.
+      append(message->body.data(), message->body.size());
+      append("\r\n0\r\n\r\n", 7);
+    } else {
+      out << "\r\n";
+      header = out.str();
+      append(header.data(), header.size());
     }
   }
 
-private:
   Message* message;
+  std::string header;
 };
 
 
@@ -119,13 +195,15 @@ class HttpResponseEncoder : public DataEncoder
 {
 public:
   HttpResponseEncoder(
-      const http::Response& response,
+      const http::Response& _response,
       const http::Request& request)
-    : DataEncoder(encode(response, request)) {}
+    : response(_response)
+  {
+    encode(request);
+  }
 
-  static std::string encode(
-      const http::Response& response,
-      const http::Request& request)
+private:
+  void encode(const http::Request& request)
   {
     std::ostringstream out;
 
@@ -149,18 +227,16 @@ public:
     headers["Date"] = date;
 
     // Should we compress this response?
-    std::string body = response.body;
-
     if (response.type == http::Response::BODY &&
         response.body.length() >= GZIP_MINIMUM_BODY_LENGTH &&
         !headers.contains("Content-Encoding") &&
         request.accepts("gzip")) {
-      Try<std::string> compressed = gzip::compress(body);
+      Try<std::string> compressed = gzip::compress(response.body);
       if (compressed.isError()) {
         LOG(WARNING) << "Failed to gzip response body: " << compressed.error();
       } else {
-        body = compressed.get();
-        headers["Content-Length"] = stringify(body.length());
+        response.body = compressed.get();
+        headers["Content-Length"] = stringify(response.body.length());
         headers["Content-Encoding"] = "gzip";
       }
     }
@@ -176,34 +252,41 @@ public:
       out << "Content-Length: 0\r\n";
     } else if (response.type == http::Response::BODY &&
                !headers.contains("Content-Length")) {
-      out << "Content-Length: " << body.size() << "\r\n";
+      out << "Content-Length: " << response.body.size() << "\r\n";
     }
 
     // Use a CRLF to mark end of headers.
     out << "\r\n";
 
-    // Add the body if necessary.
+    header = out.str();
+    append(header.data(), header.size());
+
+    // Reference the body (our own copy of the response) in place
+    // rather than copying it onto the headers.
     if (response.type == http::Response::BODY) {
       // If the Content-Length header was supplied, only write as much data
       // as the length specifies.
       Result<uint32_t> length = numify<uint32_t>(headers.get("Content-Length"));
-      if (length.isSome() && length.get() <= body.length()) {
-        out.write(body.data(), length.get());
+      if (length.isSome() && length.get() <= response.body.length()) {
+        append(response.body.data(), length.get());
       } else {
-        out.write(body.data(), body.size());
+        append(response.body.data(), response.body.size());
       }
     }
-
-    return out.str();
   }
+
+  http::Response response;
+  std::string header;
 };
 
 
 class FileEncoder : public Encoder
 {
 public:
-  FileEncoder(int _fd, size_t _size)
-    : fd(_fd), size(_size), index(0) {}
+  // Encodes 'size' bytes of the file starting at 'offset' (the
+  // beginning of the file by default).
+  FileEncoder(int _fd, size_t _size, off_t _offset = 0)
+    : fd(_fd), size(_size), offset(_offset), index(0) {}
 
   virtual ~FileEncoder()
   {
@@ -215,11 +298,11 @@ public:
     return send_file;
   }
 
-  virtual int next(off_t* offset, size_t* length)
+  virtual int next(off_t* _offset, size_t* length)
   {
     off_t temp = index;
     index = size;
-    *offset = temp;
+    *_offset = offset + temp;
     *length = size - temp;
     return fd;
   }
@@ -239,6 +322,7 @@ public:
 private:
   int fd;
   size_t size;
+  off_t offset;
   off_t index;
 };
 
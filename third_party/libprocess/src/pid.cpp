@@ -1,7 +1,9 @@
 #include <errno.h>
 #include <netdb.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include <arpa/inet.h>
 
@@ -10,11 +12,13 @@
 #include <iostream>
 #include <string>
 
-#include <boost/unordered_map.hpp>
-
 #include <process/pid.hpp>
 #include <process/process.hpp>
 
+#include <stout/duration.hpp>
+#include <stout/option.hpp>
+#include <stout/shardedcache.hpp>
+
 #include "config.hpp"
 
 #ifdef __APPLE__
@@ -31,6 +35,93 @@ using std::string;
 
 namespace process {
 
+// A cache of resolver results, so that parsing many PIDs naming the
+// same host (e.g., a thousand slaves re-registering with a master at
+// once) doesn't serialize on gethostbyname. Entries expire after
+// RESOLVE_TTL; failed lookups get cached as well (negative caching)
+// but expire sooner so that a transiently broken resolver doesn't
+// pin a host as unreachable for a full TTL. Note that
+// SocketManager::link doesn't need any caching of its own since it
+// reuses the already resolved address carried in the UPID.
+
+const Duration RESOLVE_TTL = Seconds(60.0);
+const Duration RESOLVE_NEGATIVE_TTL = Seconds(5.0);
+
+
+// Resolves a host name to an IPv4 address (in network byte order),
+// consulting the cache first. Returns false if resolution failed.
+static bool resolve(const string& host, uint32_t* ip)
+{
+  // Dotted quads don't need the resolver (or the cache).
+  in_addr addr;
+  if (inet_pton(AF_INET, host.c_str(), &addr) == 1) {
+    *ip = addr.s_addr;
+    return true;
+  }
+
+  // Expiration is handled by the caches (one TTL each); the byte
+  // budgets just bound growth if something parses PIDs naming
+  // unbounded distinct hosts.
+  static shardedcache<string, uint32_t>* resolutions =
+    new shardedcache<string, uint32_t>(64 * 1024, RESOLVE_TTL);
+  static shardedcache<string, bool>* failures =
+    new shardedcache<string, bool>(64 * 1024, RESOLVE_NEGATIVE_TTL);
+
+  Option<uint32_t> cached = resolutions->get(host);
+  if (cached.isSome()) {
+    *ip = cached.get();
+    return true;
+  }
+
+  if (failures->get(host).isSome()) {
+    VLOG(2) << "Using cached resolution failure for '" << host << "'";
+    return false;
+  }
+
+  hostent he, *hep;
+  char* temp;
+  size_t length;
+  int result;
+  int herrno;
+
+  // Allocate temporary buffer for gethostbyname2_r.
+  length = 1024;
+  temp = new char[length];
+
+  while ((result = gethostbyname2_r(host.c_str(), AF_INET, &he,
+                                    temp, length, &hep, &herrno)) == ERANGE) {
+    // Enlarge the buffer.
+    delete[] temp;
+    length *= 2;
+    temp = new char[length];
+  }
+
+  bool resolved = false;
+  uint32_t address = 0;
+
+  if (result != 0 || hep == NULL) {
+    VLOG(2) << "Failed to resolve host '" << host
+            << "' because " << hstrerror(herrno);
+  } else if (hep->h_addr_list[0] == NULL) {
+    VLOG(2) << "Got no addresses for '" << host << "'";
+  } else {
+    address = *((uint32_t*) hep->h_addr_list[0]);
+    resolved = true;
+  }
+
+  delete[] temp;
+
+  if (resolved) {
+    resolutions->put(host, address, host.size() + sizeof(uint32_t));
+    *ip = address;
+    return true;
+  }
+
+  failures->put(host, true, host.size() + sizeof(bool));
+  return false;
+}
+
+
 UPID::UPID(const char* s)
 {
   std::istringstream in(s);
@@ -118,43 +209,12 @@ istream& operator >> (istream& stream, UPID& pid)
     return stream;
   }
 
-  hostent he, *hep;
-  char* temp;
-  size_t length;
-  int result;
-  int herrno;
-
-  // Allocate temporary buffer for gethostbyname2_r.
-  length = 1024;
-  temp = new char[length];
-
-  while ((result = gethostbyname2_r(host.c_str(), AF_INET, &he,
-				    temp, length, &hep, &herrno)) == ERANGE) {
-    // Enlarge the buffer.
-    delete[] temp;
-    length *= 2;
-    temp = new char[length];
-  }
-
-  if (result != 0 || hep == NULL) {
-    VLOG(2) << "Failed to parse host '" << host
-	    << "' because " << hstrerror(herrno);
-    delete[] temp;
+  if (!resolve(host, &ip)) {
+    VLOG(2) << "Failed to parse host '" << host << "'";
     stream.setstate(std::ios_base::badbit);
     return stream;
   }
 
-  if (hep->h_addr_list[0] == NULL) {
-    VLOG(2) << "Got no addresses for '" << host << "'";
-    delete[] temp;
-    stream.setstate(std::ios_base::badbit);
-    return stream;
-  }
-
-  ip = *((uint32_t*) hep->h_addr_list[0]);
-
-  delete[] temp;
-
   str = str.substr(index + 1);
 
   if (sscanf(str.c_str(), "%hu", &port) != 1) {
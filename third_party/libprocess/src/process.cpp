@@ -9,8 +9,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#ifdef __MACH__
+#include <mach/clock.h>
+#include <mach/mach.h>
+#endif // __MACH__
+
+#ifdef __linux__
+#include <sched.h>
+#endif // __linux__
+
 #include <arpa/inet.h>
 
 #include <glog/logging.h>
@@ -22,9 +32,11 @@
 #include <sys/mman.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/uio.h>
+#include <sys/un.h>
 
 #include <algorithm>
 #include <deque>
@@ -45,6 +57,7 @@
 
 #include <boost/shared_array.hpp>
 
+#include <process/async.hpp>
 #include <process/clock.hpp>
 #include <process/defer.hpp>
 #include <process/delay.hpp>
@@ -56,8 +69,10 @@
 #include <process/id.hpp>
 #include <process/io.hpp>
 #include <process/mime.hpp>
+#include <process/pool.hpp>
 #include <process/process.hpp>
 #include <process/profiler.hpp>
+#include <process/timing.hpp>
 #include <process/socket.hpp>
 #include <process/statistics.hpp>
 #include <process/thread.hpp>
@@ -65,8 +80,11 @@
 
 #include <stout/duration.hpp>
 #include <stout/foreach.hpp>
+#include <stout/gzip.hpp>
+#include <stout/json.hpp>
 #include <stout/lambda.hpp>
 #include <stout/net.hpp>
+#include <stout/numify.hpp>
 #include <stout/os.hpp>
 #include <stout/strings.hpp>
 
@@ -74,13 +92,17 @@
 #include "decoder.hpp"
 #include "encoder.hpp"
 #include "gate.hpp"
+#include "run_queue.hpp"
+#include "sampler.hpp"
 #include "synchronized.hpp"
+#include "timer_wheel.hpp"
 
 using process::wait; // Necessary on some OS's to disambiguate.
 
 using process::http::BadRequest;
 using process::http::InternalServerError;
 using process::http::NotFound;
+using process::http::NotModified;
 using process::http::OK;
 using process::http::Request;
 using process::http::Response;
@@ -252,6 +274,11 @@ public:
   HttpProxy(const Socket& _socket);
   virtual ~HttpProxy();
 
+  // A proxy gets created and destroyed per HTTP socket, so recycle
+  // their memory via per-thread pools.
+  void* operator new (size_t size) { return Pool<HttpProxy>::allocate(size); }
+  void operator delete (void* block) { Pool<HttpProxy>::deallocate(block); }
+
   // Enqueues the response to be sent once all previously enqueued
   // responses have been processed (e.g., waited for and sent).
   void enqueue(const Response& response, const Request& request);
@@ -297,6 +324,10 @@ private:
   queue<Item*> items;
 
   Option<int> pipe; // Current pipe, if streaming.
+
+  // Compressor for the current stream, if the client accepts gzip
+  // (each chunk gets compressed before being framed).
+  gzip::Compressor* compressor;
 };
 
 
@@ -308,7 +339,10 @@ public:
 
   Socket accepted(int s);
 
-  void link(ProcessBase* process, const UPID& to);
+  void link(
+      ProcessBase* process,
+      const UPID& to,
+      const SocketOptions& options = SocketOptions());
 
   PID<HttpProxy> proxy(int s);
 
@@ -318,8 +352,36 @@ public:
             int s);
   void send(Message* message);
 
+  // Sends the message subject to flow control: the returned future
+  // stays pending while the destination socket has more than the
+  // high watermark of bytes queued (becoming ready once the queue
+  // drains), surfacing backpressure from slow consumers to the
+  // sender. If 'expendable' is true the message is instead dropped
+  // (and counted per message name) when over the watermark.
+  Future<Nothing> send(Message* message, bool expendable);
+
+  // Records that the node a codec announcement came from can
+  // decompress the announced codecs (see 'announce').
+  void exchanged(const UPID& from, const string& codecs);
+
+  // Per-link compression accounting (uncompressed and wire body
+  // bytes per node), rendered for the '/__compression__/stats'
+  // endpoint (see ProcessManager::handle).
+  JSON::Object codecs();
+
   Encoder* next(int s);
 
+  // Pops the next queued encoder for the socket if (and only if) it
+  // can be folded into the same gather-write as the one currently
+  // being sent (i.e., it is also sent with send_data). Unlike 'next'
+  // this never disposes the socket.
+  DataEncoder* coalesce(int s);
+
+  // Puts an encoder (previously popped with 'coalesce') back at the
+  // front of the socket's queue, e.g., after a gather-write only
+  // partially completed.
+  void requeue(int s, Encoder* encoder);
+
   void close(int s);
 
   void exited(const Node& node);
@@ -351,8 +413,49 @@ private:
   // ExitedEvents).
   map<Node, int> persists;
 
-  // Map from socket to outgoing queue.
-  map<int, queue<Encoder*> > outgoing;
+  // Map from socket to outgoing queue (a deque so that a coalesced
+  // but unsent encoder can be put back at the front).
+  map<int, deque<Encoder*> > outgoing;
+
+  // Bytes queued in 'outgoing' per socket, and across all sockets
+  // (otherwise a slow consumer lets us buffer unbounded memory).
+  map<int, size_t> queued;
+  size_t total;
+
+  // Promises for futures returned from flow controlled sends,
+  // satisfied once the socket's queue drains below the high
+  // watermark (or the socket gets closed).
+  map<int, vector<std::tr1::shared_ptr<Promise<Nothing> > > > throttled;
+
+  // Counts of expendable messages dropped, per message name.
+  map<string, uint64_t> dropped;
+
+  // Sends a one-time codec capability announcement to the node (the
+  // compression 'handshake', performed when we first connect to a
+  // node). Must be called with 'this' synchronized.
+  void announce(const Node& node);
+
+  // Nodes we have announced our codecs to.
+  set<Node> announced;
+
+  // Nodes that announced they can decompress gzip compressed bodies
+  // (see 'exchanged'); messages above 'compression_threshold' to
+  // these nodes get compressed.
+  set<Node> gzips;
+
+  // Cumulative uncompressed and wire body bytes of the compressed
+  // messages sent to each node (see 'codecs').
+  map<Node, pair<uint64_t, uint64_t> > ratios;
+
+  // Subtracts 'bytes' from the socket's accounting and, if that
+  // brought the socket below the high watermark, moves its throttled
+  // promises into 'promises' so the caller can satisfy them outside
+  // of the lock (satisfying a promise runs arbitrary callbacks).
+  // Must be called with 'this' synchronized.
+  void drained(
+      int s,
+      size_t bytes,
+      vector<std::tr1::shared_ptr<Promise<Nothing> > >* promises);
 
   // HTTP proxies.
   map<int, HttpProxy*> proxies;
@@ -365,7 +468,7 @@ private:
 class ProcessManager
 {
 public:
-  ProcessManager(const string& delegate);
+  ProcessManager(const string& delegate, long workers);
   ~ProcessManager();
 
   ProcessReference use(const UPID& pid);
@@ -387,12 +490,21 @@ public:
   UPID spawn(ProcessBase* process, bool manage);
   void resume(ProcessBase* process);
   void cleanup(ProcessBase* process);
-  void link(ProcessBase* process, const UPID& to);
+  void link(
+      ProcessBase* process,
+      const UPID& to,
+      const SocketOptions& options = SocketOptions());
   void terminate(const UPID& pid, bool inject, ProcessBase* sender = NULL);
   bool wait(const UPID& pid);
 
   void enqueue(ProcessBase* process);
-  ProcessBase* dequeue();
+
+  // Dequeues a runnable process on behalf of the specified worker
+  // thread, stealing from the other workers' queues if the worker's
+  // own queue is empty. Threads that are not workers (e.g., a thread
+  // donating itself in ProcessManager::wait) pass -1 and just scan
+  // all the queues.
+  ProcessBase* dequeue(int worker);
 
   void settle();
 
@@ -407,9 +519,30 @@ private:
   // Gates for waiting threads (protected by synchronizable(processes)).
   map<ProcessBase*, Gate*> gates;
 
-  // Queue of runnable processes (implemented using list).
-  list<ProcessBase*> runq;
-  synchronizable(runq);
+  // Per worker queues of runnable processes. A process gets enqueued
+  // with the worker that last resumed it (soft affinity, so that a
+  // hot process keeps its cache locality) and idle workers steal
+  // from their peers.
+  std::vector<RunQueue*> runqs;
+
+  // Used to assign processes without an affinity round-robin.
+  size_t next;
+
+  // Per worker scheduling counters, exposed by the '/workers'
+  // endpoint for diagnosing cross-socket bouncing (a high steal or
+  // migration rate on a pinned configuration means the sockets are
+  // imbalanced). Padded to a cache line so that counting doesn't
+  // false share between workers; reads may be torn but these are
+  // diagnostics, not invariants.
+  struct Counters
+  {
+    uint64_t resumes;    // Processes resumed by this worker.
+    uint64_t steals;     // Resumes that took a process from a peer's queue.
+    uint64_t migrations; // Resumed processes that last ran on another worker.
+    char padding[64 - 3 * sizeof(uint64_t)];
+  };
+
+  std::vector<Counters> counters;
 
   // Number of running processes, to support Clock::settle operation.
   int running;
@@ -422,6 +555,17 @@ static uint32_t __id__ = 0;
 // Local server socket.
 static int __s__ = -1;
 
+// Unix domain server socket, bound at '<socket dir>/<port>' when a
+// socket directory is configured (-1 otherwise).
+static int __us__ = -1;
+
+// Directory of per-port unix domain sockets for same-host
+// communication (see LIBPROCESS_SOCKET_DIR), or NULL when disabled.
+// Links and sends to a node on this host automatically use the unix
+// domain transport when the node's socket exists in this directory,
+// avoiding the TCP stack and ephemeral ports for local peers.
+static std::string* socket_dir = NULL;
+
 // Local IP address.
 static uint32_t __ip__ = 0;
 
@@ -434,11 +578,30 @@ static SocketManager* socket_manager = NULL;
 // Active ProcessManager (eventually will probably be thread-local).
 static ProcessManager* process_manager = NULL;
 
-// Event loop.
+// Sampling profiler for the worker threads (see sampler.hpp).
+static Sampler* sampler = NULL;
+
+// Number of event loops (and threads driving them). Socket I/O is
+// sharded across the loops by file descriptor so that receiving,
+// decoding, and sending can scale with cores. Defaults to 1 (i.e.,
+// the old single threaded behavior) and can be raised by setting
+// LIBPROCESS_IO_THREADS in the environment.
+static int nloops = 1;
+
+// Event loops ('loops[fd % nloops]' owns the watchers for 'fd').
+static struct ev_loop** loops = NULL;
+
+// The first event loop, which in addition to its share of the socket
+// I/O owns the timers and the accepting (server) socket.
 static struct ev_loop* loop = NULL;
 
-// Asynchronous watcher for interrupting loop.
-static ev_async async_watcher;
+// Asynchronous watchers for interrupting each loop (parallel to
+// 'loops', i.e., 'async_watchers[i]' interrupts 'loops[i]').
+static ev_async* async_watchers = NULL;
+
+// Check watchers (parallel to 'loops') that refresh the cached
+// coarse timestamp once per event loop iteration (see Clock::now()).
+static ev_check* check_watchers = NULL;
 
 // Watcher for timeouts.
 static ev_timer timeouts_watcher;
@@ -446,15 +609,20 @@ static ev_timer timeouts_watcher;
 // Server watcher for accepting connections.
 static ev_io server_watcher;
 
-// Queue of I/O watchers.
-static queue<ev_io*>* watchers = new queue<ev_io*>();
+// Server watcher for accepting unix domain connections (only started
+// when a socket directory is configured).
+static ev_io unix_server_watcher;
+
+// Queues of I/O watchers waiting to be started, indexed by the loop
+// that should start them (all queues share the single lock).
+static map<struct ev_loop*, queue<ev_io*> >* watchers =
+  new map<struct ev_loop*, queue<ev_io*> >();
 static synchronizable(watchers) = SYNCHRONIZED_INITIALIZER;
 
-// We store the timers in a map of lists indexed by the timeout of the
-// timer so that we can have two timers that have the same timeout. We
-// exploit that the map is SORTED!
-static map<double, list<Timer> >* timeouts =
-  new map<double, list<Timer> >();
+// We store the timers in a timing wheel so that arming and canceling
+// a timer doesn't pay a sorted insert under the lock (tens of
+// thousands of timers can be outstanding at once).
+static TimerWheel* timeouts = new TimerWheel();
 static synchronizable(timeouts) = SYNCHRONIZED_INITIALIZER_RECURSIVE;
 
 // For supporting Clock::settle(), true if timers have been removed
@@ -465,6 +633,44 @@ static bool pending_timers = false;
 // Flag to indicate whether or to update the timer on async interrupt.
 static bool update_timer = false;
 
+// Terminated processes owned by libprocess (i.e., spawned with
+// 'manage' set) awaiting deletion; appended by
+// ProcessManager::cleanup and reclaimed in batches once per event
+// loop iteration (see sweep_zombies).
+static deque<ProcessBase*>* zombies = new deque<ProcessBase*>();
+static synchronizable(zombies) = SYNCHRONIZED_INITIALIZER;
+
+// Watcher that sweeps 'zombies' (only on the default loop).
+static ev_check sweep_watcher;
+
+// High watermark (in bytes) on a socket's send queue. Flow
+// controlled sends (see SocketManager::send) stay pending above it
+// and expendable messages get dropped rather than queued. Can be
+// overridden by setting LIBPROCESS_SEND_HIGH_WATERMARK in the
+// environment.
+static size_t send_high_watermark = 64 * 1024 * 1024;
+
+// Whether to advertise (and use) transparent gzip compression of
+// large message bodies to capable peers (see
+// SocketManager::announce). Disabled by default; enabled by setting
+// LIBPROCESS_COMPRESSION=1 in the environment. Bodies below the
+// threshold (in bytes, overridable via
+// LIBPROCESS_COMPRESSION_THRESHOLD) are never compressed since small
+// messages don't repay the CPU.
+static bool compression = false;
+static size_t compression_threshold = 16 * 1024;
+
+// CPU affinity lists for the worker threads and the event loop (I/O)
+// threads, parsed from LIBPROCESS_WORKER_CPUS and LIBPROCESS_IO_CPUS
+// ("0,2,4-7" style). Thread i gets pinned to the i'th CPU in its
+// list (wrapping around), so listing one socket's cores keeps the
+// worker pool and the event loops socket-local on multi-socket
+// machines, pairing with the run queue affinity to avoid
+// cross-socket cache-line bouncing. Empty when unset, in which case
+// threads float as before.
+static std::vector<int> worker_cpus;
+static std::vector<int> io_cpus;
+
 // Scheduling gate that threads wait at when there is nothing to run.
 static Gate* gate = new Gate();
 
@@ -497,6 +703,12 @@ double current = 0;
 
 bool paused = false;
 
+// Coarse timestamp refreshed by each event loop at every iteration
+// (via 'check_watchers'). Read and written without synchronization:
+// an aligned double load/store is atomic on the platforms we support
+// and readers only need iteration granularity anyway.
+double coarse = 0;
+
 } // namespace clock {
 
 
@@ -522,8 +734,41 @@ double Clock::now(ProcessBase* process)
       }
     }
   }
-    
-  return ev_time(); // TODO(benh): Versus ev_now()?
+
+  // Serve the coarse timestamp cached by the event loops rather than
+  // paying for a kernel time read on every call. Fall back to a
+  // precise read until the first loop iteration has cached a value.
+  double coarse = clock::coarse;
+  return coarse != 0 ? coarse : ev_time();
+}
+
+
+double Clock::preciseNow()
+{
+  if (Clock::paused()) {
+    return now();
+  }
+
+  return ev_time();
+}
+
+
+double Clock::monotonic()
+{
+  timespec ts;
+#ifdef __MACH__
+  // OS X does not have clock_gettime, use clock_get_time.
+  clock_serv_t cclock;
+  mach_timespec_t mts;
+  host_get_clock_service(mach_host_self(), SYSTEM_CLOCK, &cclock);
+  clock_get_time(cclock, &mts);
+  mach_port_deallocate(mach_task_self(), cclock);
+  ts.tv_sec = mts.tv_sec;
+  ts.tv_nsec = mts.tv_nsec;
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif // __MACH__
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
 }
 
 
@@ -561,7 +806,7 @@ void Clock::resume()
       clock::paused = false;
       clock::currents->clear();
       update_timer = true;
-      ev_async_send(loop, &async_watcher);
+      ev_async_send(loop, &async_watchers[0]);
     }
   }
 }
@@ -576,7 +821,7 @@ void Clock::advance(const Duration& duration)
               << doublePrecision << clock::current;
       if (!update_timer) {
         update_timer = true;
-        ev_async_send(loop, &async_watcher);
+        ev_async_send(loop, &async_watchers[0]);
       }
     }
   }
@@ -606,7 +851,7 @@ void Clock::update(const Duration& duration)
         VLOG(2) << "Clock updated to " << doublePrecision << clock::current;
         if (!update_timer) {
           update_timer = true;
-          ev_async_send(loop, &async_watcher);
+          ev_async_send(loop, &async_watchers[0]);
         }
       }
     }
@@ -641,6 +886,117 @@ void Clock::settle()
 }
 
 
+// Always-on lightweight message tracing. Every send stamps the
+// message with a correlation id (inheriting the id of the message
+// the thread is currently serving, so a trace follows the causal
+// chain scheduler -> master -> slave across hops), each hop records
+// a (id, process, event, timestamp) span into a per-thread ring
+// buffer, and the '/trace' endpoint (see ProcessManager::handle)
+// dumps the recent spans. Recording is a handful of stores into
+// memory owned by the writing thread, cheap enough to leave on in
+// production; readers snapshot the rings without synchronization and
+// tolerate entries being overwritten mid-read.
+namespace trace {
+
+struct Span
+{
+  uint64_t id;       // Correlation id (0 means the slot is unused).
+  double time;       // Timestamp (coarse clock).
+  char process[24];  // Process id (truncated).
+  char event[48];    // Event description (truncated).
+};
+
+
+// Spans retained per thread (about 300KB a ring).
+enum { SPANS = 4096 };
+
+
+struct Ring
+{
+  Ring() : current(0), index(0)
+  {
+    memset(spans, 0, sizeof(spans));
+  }
+
+  // Correlation id of the message the thread is currently serving
+  // (picked up by outgoing sends), 0 when not serving one.
+  uint64_t current;
+
+  size_t index; // Monotonically increasing; the slot is 'index % SPANS'.
+  Span spans[SPANS];
+};
+
+
+// Every ring ever created. Worker and event loop threads live for
+// the process lifetime, so rings are never reclaimed. The lock only
+// protects the vector itself (rings get appended when a thread
+// first records), not the spans.
+static vector<Ring*>* rings = new vector<Ring*>();
+static synchronizable(rings) = SYNCHRONIZED_INITIALIZER;
+
+static ThreadLocal<Ring>* _ring_ = new ThreadLocal<Ring>();
+
+
+static Ring* ring()
+{
+  Ring* ring = *_ring_;
+  if (ring == NULL) {
+    ring = new Ring();
+    (*_ring_) = ring;
+    synchronized (rings) {
+      rings->push_back(ring);
+    }
+  }
+  return ring;
+}
+
+
+static vector<Ring*> snapshot()
+{
+  vector<Ring*> copy;
+  synchronized (rings) {
+    copy = *rings;
+  }
+  return copy;
+}
+
+
+// Generates a correlation id unlikely to collide across nodes (high
+// bits from this node's address, low bits from a local counter).
+static uint64_t next()
+{
+  static uint64_t counter = 0;
+  return ((uint64_t) (__ip__ ^ ((uint32_t) __port__ << 16)) << 32) |
+    (__sync_add_and_fetch(&counter, 1) & 0xffffffff);
+}
+
+
+static void record(uint64_t id, const string& process, const string& event)
+{
+  if (id == 0) {
+    return;
+  }
+
+  Ring* r = ring();
+  Span* span = &r->spans[r->index++ % SPANS];
+
+  span->id = id;
+  span->time = Clock::now();
+  strncpy(span->process, process.c_str(), sizeof(span->process) - 1);
+  span->process[sizeof(span->process) - 1] = '\0';
+  strncpy(span->event, event.c_str(), sizeof(span->event) - 1);
+  span->event[sizeof(span->event) - 1] = '\0';
+}
+
+
+static bool before(const Span& lhs, const Span& rhs)
+{
+  return lhs.time < rhs.time;
+}
+
+} // namespace trace {
+
+
 static Message* encode(const UPID& from,
                        const UPID& to,
                        const string& name,
@@ -655,8 +1011,25 @@ static Message* encode(const UPID& from,
 }
 
 
+// Stamps the message with a correlation id for tracing (inheriting
+// the id of the message currently being served, or starting a new
+// trace) and records the send.
+static void stamp(Message* message)
+{
+  if (message->correlation == 0) {
+    uint64_t current = trace::ring()->current;
+    message->correlation = current != 0 ? current : trace::next();
+  }
+
+  trace::record(
+      message->correlation, message->from.id, "send " + message->name);
+}
+
+
 static void transport(Message* message, ProcessBase* sender = NULL)
 {
+  stamp(message);
+
   if (message->to.ip == __ip__ && message->to.port == __port__) {
     // Local message.
     process_manager->deliver(message->to, new MessageEvent(message), sender);
@@ -667,6 +1040,26 @@ static void transport(Message* message, ProcessBase* sender = NULL)
 }
 
 
+// Like 'transport' but subject to flow control (see
+// SocketManager::send). Local messages are delivered immediately.
+static Future<Nothing> transport(
+    Message* message,
+    bool expendable,
+    ProcessBase* sender = NULL)
+{
+  stamp(message);
+
+  if (message->to.ip == __ip__ && message->to.port == __port__) {
+    // Local message.
+    process_manager->deliver(message->to, new MessageEvent(message), sender);
+    return Nothing();
+  }
+
+  // Remote message.
+  return socket_manager->send(message, expendable);
+}
+
+
 static bool libprocess(Request* request)
 {
   return request->method == "POST" &&
@@ -702,7 +1095,42 @@ static Message* parse(Request* request)
     message->name = name;
     message->from = from;
     message->to = to;
-    message->body = request->body;
+
+    // Steal the body (the request gets deleted by our caller) rather
+    // than copying what might be a very large payload.
+    std::swap(message->body, request->body);
+
+    // Transparently decompress the body if the sender compressed it
+    // (see SocketManager::announce; a well-behaved sender only
+    // compresses after we've announced we can decompress).
+    if (request->headers.count("Libprocess-Encoding") > 0) {
+      const string& encoding = request->headers["Libprocess-Encoding"];
+      if (encoding == "gzip") {
+        Try<string> decompressed = gzip::decompress(message->body);
+        if (decompressed.isError()) {
+          LOG(WARNING) << "Failed to decompress message '" << name
+                       << "' from " << from << ": " << decompressed.error();
+          delete message;
+          return NULL;
+        }
+        message->body = decompressed.get();
+      } else {
+        LOG(WARNING) << "Dropping message '" << name << "' from " << from
+                     << " with unsupported encoding '" << encoding << "'";
+        delete message;
+        return NULL;
+      }
+    }
+
+    // Restore the correlation id for tracing if the sender stamped
+    // one (see 'stamp').
+    if (request->headers.count("Libprocess-Trace-Id") > 0) {
+      Try<uint64_t> id =
+        numify<uint64_t>(request->headers["Libprocess-Trace-Id"]);
+      if (id.isSome()) {
+        message->correlation = id.get();
+      }
+    }
 
     return message;
   }
@@ -711,22 +1139,76 @@ static Message* parse(Request* request)
 }
 
 
+// Enqueues the watcher to be started by the event loop responsible
+// for its file descriptor (i.e., 'loops[fd % nloops]') and interrupts
+// that loop. Each socket sticks with one loop (and thus one thread)
+// for its entire lifetime so watchers never migrate. The watcher must
+// already have been initialized (i.e., 'ev_io_init' must have been
+// invoked so that 'watcher->fd' is valid).
+static void start_watcher(ev_io* watcher)
+{
+  int index = watcher->fd % nloops;
+
+  synchronized (watchers) {
+    (*watchers)[loops[index]].push(watcher);
+  }
+
+  ev_async_send(loops[index], &async_watchers[index]);
+}
+
+
+void refresh_clock(struct ev_loop* loop, ev_check* _, int revents)
+{
+  // Runs right after the loop wakes up from polling (and has updated
+  // its notion of the time), once per iteration. Any loop refreshing
+  // the cache is fine; they all track the same wall clock.
+  clock::coarse = ev_now(loop);
+}
+
+
+// Reclaims the processes that terminated since the last loop
+// iteration. Batching the deletes here (rather than round-tripping
+// every managed process through the garbage collector as it
+// terminates) keeps teardown cost out of the per-process hot path;
+// destructors of managed processes (proxies, observers) are expected
+// to be cheap since they run on the event loop.
+void sweep_zombies(struct ev_loop* loop, ev_check* _, int revents)
+{
+  deque<ProcessBase*> doomed;
+
+  synchronized (zombies) {
+    std::swap(doomed, *zombies);
+  }
+
+  while (!doomed.empty()) {
+    delete doomed.front();
+    doomed.pop_front();
+  }
+}
+
+
 void handle_async(struct ev_loop* loop, ev_async* _, int revents)
 {
   synchronized (watchers) {
-    // Start all the new I/O watchers.
-    while (!watchers->empty()) {
-      ev_io* watcher = watchers->front();
-      watchers->pop();
+    // Start all the new I/O watchers destined for this loop.
+    queue<ev_io*>& pending = (*watchers)[loop];
+    while (!pending.empty()) {
+      ev_io* watcher = pending.front();
+      pending.pop();
       ev_io_start(loop, watcher);
     }
   }
 
+  // Only the first loop owns the timeouts watcher.
+  if (loop != loops[0]) {
+    return;
+  }
+
   synchronized (timeouts) {
     if (update_timer) {
       if (!timeouts->empty()) {
 	// Determine when the next timer should fire.
-	timeouts_watcher.repeat = timeouts->begin()->first - Clock::now();
+	timeouts_watcher.repeat = timeouts->next() - Clock::preciseNow();
 
         if (timeouts_watcher.repeat <= 0) {
 	  // Feed the event now!
@@ -756,37 +1238,31 @@ void handle_timeouts(struct ev_loop* loop, ev_timer* _, int revents)
   list<Timer> timedout;
 
   synchronized (timeouts) {
-    double now = Clock::now();
+    // Arming and expiring timers wants real accuracy, not the
+    // iteration-granular cache (a deadline armed off a stale coarse
+    // read could fire early), so pay for a precise read here.
+    double now = Clock::preciseNow();
 
     VLOG(3) << "Handling timeouts up to " << doublePrecision << now;
 
-    double timeout;
-    foreachkey (timeout, *timeouts) {
-      if (timeout > now) {
-        break;
-      }
+    // Turn the wheel, removing every timer that has timed out.
+    timedout = timeouts->advance(now);
 
-      VLOG(3) << "Have timeout(s) at " << doublePrecision << timeout;
+    if (!timedout.empty()) {
+      VLOG(3) << "Have " << timedout.size() << " timeout(s)";
 
       // Record that we have pending timers to execute so the
       // Clock::settle() operation can wait until we're done.
       pending_timers = true;
-
-      foreach (const Timer& timer, (*timeouts)[timeout]) {
-        timedout.push_back(timer);
-      }
     }
 
-    // Now erase the range of timeouts that timed out.
-    timeouts->erase(timeouts->begin(), timeouts->upper_bound(now));
-
     // Okay, so the timeout for the next timer should not have fired.
-    CHECK(timeouts->empty() || (timeouts->begin()->first > now));
+    CHECK(timeouts->empty() || (timeouts->next() > now));
 
     // Update the timer as necessary.
     if (!timeouts->empty()) {
       // Determine when the next timer should fire.
-      timeouts_watcher.repeat = timeouts->begin()->first - Clock::now();
+      timeouts_watcher.repeat = timeouts->next() - Clock::preciseNow();
 
       if (timeouts_watcher.repeat <= 0) {
         // Feed the event now!
@@ -899,27 +1375,83 @@ void recv_data(struct ev_loop* loop, ev_io* watcher, int revents)
 
 void send_data(struct ev_loop* loop, ev_io* watcher, int revents)
 {
-  DataEncoder* encoder = (DataEncoder*) watcher->data;
+  const int IOV_SIZE = 64;
+
+  // Stop coalescing more messages into a gather-write once this many
+  // bytes have been collected (tiny messages dominate the traffic we
+  // care about, so there is no point delaying a big write further).
+  const size_t COALESCE_SIZE = 64 * 1024;
 
   int s = watcher->fd;
 
   while (true) {
-    const void* data;
-    size_t size;
+    struct iovec iov[IOV_SIZE];
+
+    // The encoders participating in this gather-write (in order) and
+    // the number of bytes each contributed.
+    vector<DataEncoder*> encoders;
+    vector<size_t> sizes;
+
+    DataEncoder* encoder = (DataEncoder*) watcher->data;
+
+    int count = 0;
+    size_t size = 0;
+
+    // Gather the remaining data of the current encoder and then pack
+    // in as many other messages already queued for this socket as
+    // possible, writing them all with a single system call rather
+    // than one (copying) write per message.
+    while (encoder != NULL) {
+      int n = encoder->next(iov + count, IOV_SIZE - count);
+
+      size_t bytes = 0;
+      for (int i = count; i < count + n; i++) {
+        bytes += iov[i].iov_len;
+      }
+
+      count += n;
+      size += bytes;
+
+      encoders.push_back(encoder);
+      sizes.push_back(bytes);
+
+      // Stop coalescing if this encoder couldn't be fully gathered
+      // into the remaining iovec slots or we have collected plenty.
+      if (encoder->remaining() > 0 ||
+          count >= IOV_SIZE ||
+          size >= COALESCE_SIZE) {
+        break;
+      }
+
+      encoder = socket_manager->coalesce(s);
+    }
 
-    data = encoder->next(&size);
     CHECK(size > 0);
 
-    ssize_t length = send(s, data, size, MSG_NOSIGNAL);
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+    // Use sendmsg rather than writev for MSG_NOSIGNAL.
+    ssize_t length = sendmsg(s, &msg, MSG_NOSIGNAL);
+
+    if (length < 0 && (errno == EINTR || errno == EAGAIN ||
+                       errno == EWOULDBLOCK)) {
+      // Interrupted or might block: back everything up, returning
+      // all but the first encoder to the front of the socket's queue
+      // (in order).
+      for (size_t i = encoders.size(); i-- > 1;) {
+        encoders[i]->backup(sizes[i]);
+        socket_manager->requeue(s, encoders[i]);
+      }
+      encoders[0]->backup(sizes[0]);
+      watcher->data = encoders[0];
 
-    if (length < 0 && (errno == EINTR)) {
-      // Interrupted, try again now.
-      encoder->backup(size);
-      continue;
-    } else if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-      // Might block, try again later.
-      encoder->backup(size);
-      break;
+      if (errno == EINTR) {
+        continue; // Try again now.
+      }
+      break; // Try again later.
     } else if (length <= 0) {
       // Socket error or closed.
       if (length < 0) {
@@ -929,35 +1461,52 @@ void send_data(struct ev_loop* loop, ev_io* watcher, int revents)
         VLOG(1) << "Socket closed while sending";
       }
       socket_manager->close(s);
-      delete encoder;
+      for (size_t i = 0; i < encoders.size(); i++) {
+        delete encoders[i];
+      }
       ev_io_stop(loop, watcher);
       delete watcher;
       break;
     } else {
       CHECK(length > 0);
 
-      // Update the encoder with the amount sent.
-      encoder->backup(size - length);
+      // The bytes were sent in gather order, so the sent prefix
+      // covers the leading encoders entirely and (at most) one
+      // encoder partially.
+      size_t sent = length;
+      size_t i = 0;
+      while (i < encoders.size() && sent >= sizes[i]) {
+        sent -= sizes[i];
+        delete encoders[i];
+        i++;
+      }
 
-      // See if there is any more of the message to send.
-      if (encoder->remaining() == 0) {
-        delete encoder;
+      if (i < encoders.size()) {
+        // Partially (or un-) sent encoder: back up what's left and
+        // return any others to the front of the queue (in order).
+        encoders[i]->backup(sizes[i] - sent);
+        for (size_t j = encoders.size(); j-- > i + 1;) {
+          encoders[j]->backup(sizes[j]);
+          socket_manager->requeue(s, encoders[j]);
+        }
+        watcher->data = encoders[i];
+        continue;
+      }
 
-        // Stop this watcher for now.
-        ev_io_stop(loop, watcher);
+      // Everything was sent, stop this watcher for now.
+      ev_io_stop(loop, watcher);
 
-        // Check for more stuff to send on socket.
-        Encoder* next = socket_manager->next(s);
-        if (next != NULL) {
-          watcher->data = next;
-          ev_io_init(watcher, next->sender(), s, EV_WRITE);
-          ev_io_start(loop, watcher);
-        } else {
-          // Nothing more to send right now, clean up.
-          delete watcher;
-        }
-        break;
+      // Check for more stuff to send on socket.
+      Encoder* next = socket_manager->next(s);
+      if (next != NULL) {
+        watcher->data = next;
+        ev_io_init(watcher, next->sender(), s, EV_WRITE);
+        ev_io_start(loop, watcher);
+      } else {
+        // Nothing more to send right now, clean up.
+        delete watcher;
       }
+      break;
     }
   }
 }
@@ -1082,12 +1631,12 @@ void receiving_connect(struct ev_loop* loop, ev_io* watcher, int revents)
 
 void accept(struct ev_loop* loop, ev_io* watcher, int revents)
 {
-  CHECK_EQ(__s__, watcher->fd);
+  CHECK(watcher->fd == __s__ || watcher->fd == __us__);
 
-  sockaddr_in addr;
+  sockaddr_storage addr;
   socklen_t addrlen = sizeof(addr);
 
-  int s = ::accept(__s__, (sockaddr*) &addr, &addrlen);
+  int s = ::accept(watcher->fd, (sockaddr*) &addr, &addrlen);
 
   if (s < 0) {
     return;
@@ -1109,25 +1658,29 @@ void accept(struct ev_loop* loop, ev_io* watcher, int revents)
     return;
   }
 
-  // Turn off Nagle (TCP_NODELAY) so pipelined requests don't wait.
-  int on = 1;
-  if (setsockopt(s, SOL_TCP, TCP_NODELAY, &on, sizeof(on)) < 0) {
-    const char* error = strerror(errno);
-    VLOG(1) << "Failed to turn off the Nagle algorithm: " << error;
-    close(s);
-  } else {
-    // Inform the socket manager for proper bookkeeping.
-    const Socket& socket = socket_manager->accepted(s);
+  // Turn off Nagle (TCP_NODELAY) so pipelined requests don't wait
+  // (only meaningful for TCP; a unix domain socket has no Nagle).
+  if (watcher->fd == __s__) {
+    int on = 1;
+    if (setsockopt(s, SOL_TCP, TCP_NODELAY, &on, sizeof(on)) < 0) {
+      const char* error = strerror(errno);
+      VLOG(1) << "Failed to turn off the Nagle algorithm: " << error;
+      close(s);
+      return;
+    }
+  }
 
-    // Allocate and initialize the decoder and watcher.
-    DataDecoder* decoder = new DataDecoder(socket);
+  // Inform the socket manager for proper bookkeeping.
+  const Socket& socket = socket_manager->accepted(s);
 
-    ev_io* watcher = new ev_io();
-    watcher->data = decoder;
+  // Allocate and initialize the decoder and watcher.
+  DataDecoder* decoder = new DataDecoder(socket);
 
-    ev_io_init(watcher, recv_data, s, EV_READ);
-    ev_io_start(loop, watcher);
-  }
+  ev_io* io = new ev_io();
+  io->data = decoder;
+
+  ev_io_init(io, recv_data, s, EV_READ);
+  start_watcher(io);
 }
 
 
@@ -1142,6 +1695,63 @@ void polled(struct ev_loop* loop, ev_io* watcher, int revents)
 }
 
 
+// Parses a "0,2,4-7" style CPU list (see 'worker_cpus' above).
+// Malformed input is an error rather than best effort: a typo'ed
+// pinning that silently leaves threads floating defeats the point.
+static Try<std::vector<int> > parse_cpus(const string& s)
+{
+  std::vector<int> cpus;
+
+  foreach (const string& token, strings::tokenize(s, ",")) {
+    std::vector<string> range = strings::split(token, "-");
+
+    if (range.size() == 1) {
+      Try<int> cpu = numify<int>(range[0]);
+      if (cpu.isError() || cpu.get() < 0) {
+        return Try<std::vector<int> >::error("Invalid CPU '" + token + "'");
+      }
+      cpus.push_back(cpu.get());
+    } else if (range.size() == 2) {
+      Try<int> from = numify<int>(range[0]);
+      Try<int> to = numify<int>(range[1]);
+      if (from.isError() || to.isError() ||
+          from.get() < 0 || to.get() < from.get()) {
+        return Try<std::vector<int> >::error("Invalid CPU range '" + token + "'");
+      }
+      for (int cpu = from.get(); cpu <= to.get(); cpu++) {
+        cpus.push_back(cpu);
+      }
+    } else {
+      return Try<std::vector<int> >::error("Invalid CPU range '" + token + "'");
+    }
+  }
+
+  if (cpus.empty()) {
+    return Try<std::vector<int> >::error("No CPUs specified");
+  }
+
+  return cpus;
+}
+
+
+// Pins the given thread to the given CPU. Only supported on Linux;
+// elsewhere this is a no-op and threads keep floating.
+static void pin(pthread_t thread, int cpu)
+{
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  int error = pthread_setaffinity_np(thread, sizeof(set), &set);
+  if (error != 0) {
+    LOG(ERROR) << "Failed to pin thread to CPU " << cpu
+               << ": " << strerror(error);
+  }
+#endif // __linux__
+}
+
+
 void* serve(void* arg)
 {
   ev_loop(((struct ev_loop*) arg), 0);
@@ -1152,11 +1762,21 @@ void* serve(void* arg)
 
 void* schedule(void* arg)
 {
+  const int worker = (int) (intptr_t) arg;
+
+  // Pin ourselves if a worker CPU list was configured. Pinning before
+  // doing any work also means that the memory this thread allocates
+  // from here on (run queue spill lists, process heap data) gets
+  // faulted in node-locally under the kernel's first-touch policy.
+  if (!worker_cpus.empty()) {
+    pin(pthread_self(), worker_cpus[worker % worker_cpus.size()]);
+  }
+
   do {
-    ProcessBase* process = process_manager->dequeue();
+    ProcessBase* process = process_manager->dequeue(worker);
     if (process == NULL) {
       Gate::state_t old = gate->approach();
-      process = process_manager->dequeue();
+      process = process_manager->dequeue(worker);
       if (process == NULL) {
 	gate->arrive(old); // Wait at gate if idle.
 	continue;
@@ -1169,33 +1789,507 @@ void* schedule(void* arg)
 }
 
 
-// We might find value in catching terminating signals at some point.
-// However, for now, adding signal handlers freely is not allowed
-// because they will clash with Java and Python virtual machines and
-// causes hard to debug crashes/segfaults.
+// Exposes the sampling profiler (see sampler.hpp) over HTTP:
+//   /sampler/start?frequency=100   start sampling (samples per second)
+//   /sampler/stop                  stop sampling
+//   /sampler/collapsed             collapsed stack format output,
+//                                  ready for flame graph tooling
+class SamplingProfilerProcess : public Process<SamplingProfilerProcess>
+{
+public:
+  SamplingProfilerProcess() : ProcessBase("sampler") {}
 
-// void sigbad(int signal, struct sigcontext *ctx)
-// {
-//   // Pass on the signal (so that a core file is produced).
-//   struct sigaction sa;
-//   sa.sa_handler = SIG_DFL;
-//   sigemptyset(&sa.sa_mask);
-//   sa.sa_flags = 0;
-//   sigaction(signal, &sa, NULL);
-//   raise(signal);
-// }
+  virtual ~SamplingProfilerProcess() {}
 
+protected:
+  virtual void initialize()
+  {
+    route("/start", &SamplingProfilerProcess::start);
+    route("/stop", &SamplingProfilerProcess::stop);
+    route("/collapsed", &SamplingProfilerProcess::collapsed);
+  }
 
-void initialize(const string& delegate)
-{
-  // TODO(benh): Return an error if attempting to initialize again
-  // with a different delegate then originally specified.
+private:
+  Future<Response> start(const Request& request)
+  {
+    double frequency = 100.0; // Samples per second.
 
-  // static pthread_once_t init = PTHREAD_ONCE_INIT;
-  // pthread_once(&init, ...);
+    if (request.query.get("frequency").isSome()) {
+      Try<double> result = numify<double>(request.query.get("frequency").get());
+      if (result.isError() || result.get() <= 0.0) {
+        return BadRequest("Expected a positive 'frequency' in query.\n");
+      }
+      frequency = result.get();
+    }
 
-  static volatile bool initialized = false;
-  static volatile bool initializing = true;
+    Try<Nothing> started = sampler->start(Seconds(1.0 / frequency));
+    if (started.isError()) {
+      return BadRequest(started.error() + ".\n");
+    }
+
+    LOG(INFO) << "Started sampling profiler at " << frequency << "Hz";
+
+    return OK("Sampling started.\n");
+  }
+
+  Future<Response> stop(const Request& request)
+  {
+    if (!sampler->stop()) {
+      return BadRequest("Sampler not running.\n");
+    }
+
+    LOG(INFO) << "Stopped sampling profiler";
+
+    return OK("Sampling stopped.\n");
+  }
+
+  Future<Response> collapsed(const Request& request)
+  {
+    const std::map<string, size_t>& samples = sampler->samples();
+
+    std::ostringstream out;
+    foreachpair (const string& label, size_t count, samples) {
+      out << label << " " << count << "\n";
+    }
+
+    OK response(out.str());
+    response.headers["Content-Type"] = "text/plain";
+    return response;
+  }
+};
+
+
+// Exposes the scoped timing probes (see process/timing.hpp) over
+// HTTP:
+//   /timing/start      enable recording
+//   /timing/stop       disable recording
+//   /timing/snapshot   per probe histogram summaries as JSON
+class TimingProcess : public Process<TimingProcess>
+{
+public:
+  TimingProcess() : ProcessBase("timing") {}
+
+  virtual ~TimingProcess() {}
+
+protected:
+  virtual void initialize()
+  {
+    route("/start", &TimingProcess::start);
+    route("/stop", &TimingProcess::stop);
+    route("/snapshot", &TimingProcess::snapshot);
+  }
+
+private:
+  Future<Response> start(const Request& request)
+  {
+    timing::enabled = true;
+    return OK("Timing started.\n");
+  }
+
+  Future<Response> stop(const Request& request)
+  {
+    timing::enabled = false;
+    return OK("Timing stopped.\n");
+  }
+
+  Future<Response> snapshot(const Request& request)
+  {
+    OK response(timing::snapshot());
+    response.headers["Content-Type"] = "application/json";
+    return response;
+  }
+};
+
+
+namespace http {
+namespace internal {
+
+// Read buffer size per connection (one response usually fits).
+const size_t HTTP_READ_SIZE = 16*4096;
+
+// Maximum keep-alive connections kept per destination. A second
+// connection is only opened when the first already has requests
+// pipelined on it, bounding head-of-line blocking without hammering
+// the destination with sockets.
+const size_t HTTP_CONNECTIONS_PER_HOST = 2;
+
+
+// The asynchronous HTTP client behind http::get and http::post: a
+// pool of keep-alive connections per destination with the requests
+// pipelined on them in FIFO order (HTTP/1.1 responses come back in
+// request order, which is how responses get matched up).
+class HttpClientProcess : public Process<HttpClientProcess>
+{
+public:
+  HttpClientProcess() : ProcessBase("__http_client__"), ids(0) {}
+
+  virtual ~HttpClientProcess() {}
+
+  // Issues the (already encoded) request to the node, returning the
+  // eventual response. An expired timeout fails the future and
+  // closes the connection it was pipelined on.
+  Future<Response> request(
+      const Node& node,
+      const std::string& data,
+      const Option<Duration>& timeout)
+  {
+    // Pick the pooled connection with the shortest pipeline.
+    Connection* connection = NULL;
+
+    foreach (int s, pool[node]) {
+      Connection* candidate = connections[s];
+      if (connection == NULL ||
+          candidate->pipeline.size() < connection->pipeline.size()) {
+        connection = candidate;
+      }
+    }
+
+    // Open a new connection if there is none, or if the best one is
+    // already occupied and the pool is not full.
+    if (connection == NULL ||
+        (!connection->pipeline.empty() &&
+         pool[node].size() < HTTP_CONNECTIONS_PER_HOST)) {
+      Try<Connection*> opened = connect(node);
+      if (opened.isSome()) {
+        connection = opened.get();
+      } else if (connection == NULL) {
+        return Future<Response>::failed(opened.error());
+      }
+      // Otherwise fall back on pipelining over the busy connection.
+    }
+
+    uint64_t id = ids++;
+
+    Promise<Response>* promise = new Promise<Response>();
+
+    connection->pipeline.push_back(std::make_pair(id, promise));
+    connection->output += data;
+
+    flush(connection);
+
+    if (timeout.isSome()) {
+      delay(timeout.get(),
+            self(),
+            &HttpClientProcess::timedout,
+            connection->s,
+            id);
+    }
+
+    return promise->future();
+  }
+
+private:
+  struct Connection
+  {
+    Connection(int _s, const Node& _node)
+      : s(_s), node(_node), connected(false), writing(false) {}
+
+    const int s;
+    const Node node;
+
+    bool connected; // The nonblocking connect has completed.
+    bool writing;   // A write is in flight (on 'flushing').
+
+    // Encoded requests not yet written. Bytes being written live in
+    // 'flushing' (with 'iov' describing them), which is left alone
+    // until the write completes; new requests append to 'output' so
+    // an in-flight iovec never dangles from a reallocation.
+    std::string output;
+    std::string flushing;
+    struct iovec iov;
+
+    // Requests awaiting their responses, in pipeline (FIFO) order.
+    std::deque<std::pair<uint64_t, Promise<Response>*> > pipeline;
+
+    ResponseDecoder decoder;
+
+    // In-flight io operations, discarded when the connection gets
+    // closed so that their retry loops stop touching this
+    // connection's buffers.
+    Future<size_t> reader;
+    Future<size_t> writer;
+
+    char data[HTTP_READ_SIZE];
+  };
+
+  typedef std::pair<uint64_t, Promise<Response>*> Pending;
+
+  Try<Connection*> connect(const Node& node)
+  {
+    int s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+
+    if (s < 0) {
+      return ErrnoError("Failed to create socket");
+    }
+
+    Try<Nothing> cloexec = os::cloexec(s);
+    if (cloexec.isError()) {
+      os::close(s);
+      return Error("Failed to cloexec: " + cloexec.error());
+    }
+
+    Try<Nothing> nonblock = os::nonblock(s);
+    if (nonblock.isError()) {
+      os::close(s);
+      return Error("Failed to set nonblock: " + nonblock.error());
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(node.port);
+    addr.sin_addr.s_addr = node.ip;
+
+    Connection* connection = new Connection(s, node);
+
+    if (::connect(s, (sockaddr*) &addr, sizeof(addr)) < 0) {
+      if (errno != EINPROGRESS) {
+        os::close(s);
+        delete connection;
+        return ErrnoError("Failed to connect");
+      }
+
+      // Wait for the connect to complete before reading or writing.
+      io::poll(s, io::WRITE)
+        .onAny(defer(self(), &HttpClientProcess::connected, s));
+    } else {
+      connection->connected = true;
+    }
+
+    connections[s] = connection;
+    pool[node].push_back(s);
+
+    if (connection->connected) {
+      receive(connection);
+    }
+
+    return connection;
+  }
+
+  void connected(int s)
+  {
+    if (!connections.contains(s)) {
+      return; // Already closed (e.g., a pipelined request timed out).
+    }
+
+    Connection* connection = connections[s];
+
+    // Check whether the connect actually succeeded.
+    int error = 0;
+    socklen_t size = sizeof(error);
+    if (getsockopt(s, SOL_SOCKET, SO_ERROR, &error, &size) < 0 ||
+        error != 0) {
+      fail(connection,
+           std::string("Failed to connect: ") +
+           strerror(error != 0 ? error : errno));
+      return;
+    }
+
+    connection->connected = true;
+
+    receive(connection);
+    flush(connection);
+  }
+
+  // Starts a write of the buffered requests unless one is already in
+  // flight (or the connect has not completed yet).
+  void flush(Connection* connection)
+  {
+    if (!connection->connected || connection->writing) {
+      return;
+    }
+
+    if (connection->flushing.empty()) {
+      if (connection->output.empty()) {
+        return;
+      }
+      std::swap(connection->flushing, connection->output);
+    }
+
+    connection->writing = true;
+
+    connection->iov.iov_base = (void*) connection->flushing.data();
+    connection->iov.iov_len = connection->flushing.size();
+
+    connection->writer = io::writev(connection->s, &connection->iov, 1);
+    connection->writer
+      .onAny(defer(self(),
+                   &HttpClientProcess::flushed,
+                   connection->s,
+                   lambda::_1));
+  }
+
+  void flushed(int s, const Future<size_t>& future)
+  {
+    if (!connections.contains(s)) {
+      return;
+    }
+
+    Connection* connection = connections[s];
+
+    connection->writing = false;
+
+    if (!future.isReady()) {
+      fail(connection,
+           "Failed to write request: " +
+           (future.isFailed() ? future.failure() : "discarded"));
+      return;
+    }
+
+    connection->flushing.erase(0, future.get());
+
+    flush(connection);
+  }
+
+  // (Re-)arms the read loop on the connection.
+  void receive(Connection* connection)
+  {
+    connection->reader =
+      io::read(connection->s, connection->data, HTTP_READ_SIZE);
+    connection->reader
+      .onAny(defer(self(),
+                   &HttpClientProcess::received,
+                   connection->s,
+                   lambda::_1));
+  }
+
+  void received(int s, const Future<size_t>& future)
+  {
+    if (!connections.contains(s)) {
+      return;
+    }
+
+    Connection* connection = connections[s];
+
+    if (!future.isReady()) {
+      fail(connection,
+           "Failed to read response: " +
+           (future.isFailed() ? future.failure() : "discarded"));
+      return;
+    }
+
+    size_t length = future.get();
+
+    if (length == 0) {
+      // EOF: the destination closed the connection (idle keep-alive
+      // reaping, or 'Connection: close'). Requests still pipelined
+      // on it fail; there is no pipeline to re-issue them on safely
+      // (they might not be idempotent).
+      fail(connection, "Connection closed by peer");
+      return;
+    }
+
+    std::deque<Response*> responses =
+      connection->decoder.decode(connection->data, length);
+
+    if (connection->decoder.failed()) {
+      foreach (Response* response, responses) {
+        delete response;
+      }
+      fail(connection, "Failed to decode HTTP responses");
+      return;
+    }
+
+    foreach (Response* response, responses) {
+      if (connection->pipeline.empty()) {
+        delete response;
+        fail(connection, "Received an unexpected HTTP response");
+        return;
+      }
+
+      Pending pending = connection->pipeline.front();
+      connection->pipeline.pop_front();
+
+      pending.second->set(*response);
+      delete pending.second;
+      delete response;
+    }
+
+    receive(connection);
+  }
+
+  void timedout(int s, uint64_t id)
+  {
+    if (!connections.contains(s)) {
+      return;
+    }
+
+    Connection* connection = connections[s];
+
+    // If the request is still pending the whole connection has to
+    // go: responses behind the expired request could no longer be
+    // matched to their requests.
+    foreach (const Pending& pending, connection->pipeline) {
+      if (pending.first == id) {
+        fail(connection, "Request timed out");
+        return;
+      }
+    }
+  }
+
+  // Fails any requests pipelined on the connection and closes it.
+  void fail(Connection* connection, const std::string& message)
+  {
+    foreach (const Pending& pending, connection->pipeline) {
+      pending.second->fail(message);
+      delete pending.second;
+    }
+    connection->pipeline.clear();
+
+    connections.erase(connection->s);
+    pool[connection->node].remove(connection->s);
+    if (pool[connection->node].empty()) {
+      pool.erase(connection->node);
+    }
+
+    connection->reader.discard();
+    connection->writer.discard();
+
+    os::close(connection->s);
+    delete connection;
+  }
+
+  uint64_t ids; // For matching expired timeouts to their requests.
+
+  hashmap<int, Connection*> connections; // Keyed by socket.
+  std::map<Node, std::list<int> > pool;  // Sockets per destination.
+};
+
+
+// Global http client (see process::initialize).
+HttpClientProcess* client = NULL;
+
+} // namespace internal {
+} // namespace http {
+
+
+// We might find value in catching terminating signals at some point.
+// However, for now, adding signal handlers freely is not allowed
+// because they will clash with Java and Python virtual machines and
+// causes hard to debug crashes/segfaults.
+
+// void sigbad(int signal, struct sigcontext *ctx)
+// {
+//   // Pass on the signal (so that a core file is produced).
+//   struct sigaction sa;
+//   sa.sa_handler = SIG_DFL;
+//   sigemptyset(&sa.sa_mask);
+//   sa.sa_flags = 0;
+//   sigaction(signal, &sa, NULL);
+//   raise(signal);
+// }
+
+
+void initialize(const string& delegate)
+{
+  // TODO(benh): Return an error if attempting to initialize again
+  // with a different delegate then originally specified.
+
+  // static pthread_once_t init = PTHREAD_ONCE_INIT;
+  // pthread_once(&init, ...);
+
+  static volatile bool initialized = false;
+  static volatile bool initializing = true;
 
   // Try and do the initialization or wait for it to complete.
   if (initialized && !initializing) {
@@ -1237,16 +2331,44 @@ void initialize(const string& delegate)
   signal(SIGPIPE, SIG_IGN);
 #endif // __sun__
 
+  // Check environment for CPU affinity lists for the worker and I/O
+  // threads. Parsed up front since the worker threads are created
+  // next; see the comment above 'worker_cpus' for the semantics.
+  char* affinity = getenv("LIBPROCESS_WORKER_CPUS");
+  if (affinity != NULL) {
+    Try<std::vector<int> > result = parse_cpus(affinity);
+    if (result.isError()) {
+      LOG(FATAL) << "LIBPROCESS_WORKER_CPUS=" << affinity
+                 << " is not a valid CPU list: " << result.error();
+    }
+    worker_cpus = result.get();
+  }
+
+  affinity = getenv("LIBPROCESS_IO_CPUS");
+  if (affinity != NULL) {
+    Try<std::vector<int> > result = parse_cpus(affinity);
+    if (result.isError()) {
+      LOG(FATAL) << "LIBPROCESS_IO_CPUS=" << affinity
+                 << " is not a valid CPU list: " << result.error();
+    }
+    io_cpus = result.get();
+  }
+
+  // Number of worker threads (and thus run queues).
+  long cpus = std::max(4L, sysconf(_SC_NPROCESSORS_ONLN));
+
   // Create a new ProcessManager and SocketManager.
-  process_manager = new ProcessManager(delegate);
+  process_manager = new ProcessManager(delegate, cpus);
   socket_manager = new SocketManager();
 
-  // Setup processing threads.
-  long cpus = std::max(4L, sysconf(_SC_NPROCESSORS_ONLN));
+  // Create the sampling profiler (before the workers that publish
+  // into it start).
+  sampler = new Sampler(cpus);
 
-  for (int i = 0; i < cpus; i++) {
+  // Setup processing threads, telling each which queue is its own.
+  for (long i = 0; i < cpus; i++) {
     pthread_t thread; // For now, not saving handles on our threads.
-    if (pthread_create(&thread, NULL, schedule, NULL) != 0) {
+    if (pthread_create(&thread, NULL, schedule, (void*) (intptr_t) i) != 0) {
       LOG(FATAL) << "Failed to initialize, pthread_create";
     }
   }
@@ -1345,22 +2467,137 @@ void initialize(const string& delegate)
     PLOG(FATAL) << "Failed to initialize, listen";
   }
 
-  // Setup event loop.
+  // Check environment for a unix domain socket directory. When set,
+  // we additionally listen on '<dir>/<port>', and links and sends to
+  // a node on this host whose socket exists in the directory use the
+  // unix domain transport instead of TCP (see connect_unix), which
+  // avoids the TCP stack and ephemeral ports for the chatty
+  // same-host links (e.g., a slave and its executors).
+  value = getenv("LIBPROCESS_SOCKET_DIR");
+  if (value != NULL) {
+    sockaddr_un unaddr;
+    const std::string path = std::string(value) + "/" + stringify(__port__);
+
+    if (path.size() >= sizeof(unaddr.sun_path)) {
+      LOG(FATAL) << "LIBPROCESS_SOCKET_DIR=" << value << " is too long";
+    }
+
+    socket_dir = new std::string(value);
+
+    if ((__us__ = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+      PLOG(FATAL) << "Failed to initialize, socket (unix)";
+    }
+
+    nonblock = os::nonblock(__us__);
+    if (nonblock.isError()) {
+      LOG(FATAL) << "Failed to initialize, nonblock (unix): "
+                 << nonblock.error();
+    }
+
+    cloexec = os::cloexec(__us__);
+    if (cloexec.isError()) {
+      LOG(FATAL) << "Failed to initialize, cloexec (unix): "
+                 << cloexec.error();
+    }
+
+    // Remove a stale socket left behind by a previous process that
+    // was bound to the same port and did not shut down cleanly.
+    ::unlink(path.c_str());
+
+    memset(&unaddr, 0, sizeof(unaddr));
+    unaddr.sun_family = AF_UNIX;
+    strncpy(unaddr.sun_path, path.c_str(), sizeof(unaddr.sun_path) - 1);
+
+    if (bind(__us__, (sockaddr*) &unaddr, sizeof(unaddr)) < 0) {
+      PLOG(FATAL) << "Failed to initialize, bind (unix)";
+    }
+
+    if (listen(__us__, 500000) < 0) {
+      PLOG(FATAL) << "Failed to initialize, listen (unix)";
+    }
+  }
+
+  // Check environment for the number of I/O threads (and thus event
+  // loops). We keep the old single threaded behavior by default.
+  value = getenv("LIBPROCESS_IO_THREADS");
+  if (value != NULL) {
+    int result = atoi(value);
+    if (result < 1 || result > 1024) {
+      LOG(FATAL) << "LIBPROCESS_IO_THREADS=" << value
+                 << " is not a valid number of I/O threads";
+    }
+    nloops = result;
+  }
+
+  // Check environment for a send queue high watermark override.
+  value = getenv("LIBPROCESS_SEND_HIGH_WATERMARK");
+  if (value != NULL) {
+    long result = atol(value);
+    if (result <= 0) {
+      LOG(FATAL) << "LIBPROCESS_SEND_HIGH_WATERMARK=" << value
+                 << " is not a valid number of bytes";
+    }
+    send_high_watermark = result;
+  }
+
+  // Check environment to see whether to use (and advertise)
+  // transparent compression of large message bodies.
+  value = getenv("LIBPROCESS_COMPRESSION");
+  if (value != NULL && atoi(value) != 0) {
+    compression = true;
+  }
+
+  value = getenv("LIBPROCESS_COMPRESSION_THRESHOLD");
+  if (value != NULL) {
+    long result = atol(value);
+    if (result <= 0) {
+      LOG(FATAL) << "LIBPROCESS_COMPRESSION_THRESHOLD=" << value
+                 << " is not a valid number of bytes";
+    }
+    compression_threshold = result;
+  }
+
+  // Setup event loops. The first loop is the default loop and owns
+  // the timers and the accepting socket, the rest just get a share of
+  // the socket I/O (see 'start_watcher').
+  loops = new struct ev_loop*[nloops];
+  async_watchers = new ev_async[nloops];
+  check_watchers = new ev_check[nloops];
+
 #ifdef __sun__
-  loop = ev_default_loop(EVBACKEND_POLL | EVBACKEND_SELECT);
+  const unsigned int flags = EVBACKEND_POLL | EVBACKEND_SELECT;
 #else
-  loop = ev_default_loop(EVFLAG_AUTO);
+  const unsigned int flags = EVFLAG_AUTO;
 #endif // __sun__
 
-  ev_async_init(&async_watcher, handle_async);
-  ev_async_start(loop, &async_watcher);
+  loops[0] = loop = ev_default_loop(flags);
+
+  for (int i = 1; i < nloops; i++) {
+    loops[i] = ev_loop_new(flags);
+  }
+
+  for (int i = 0; i < nloops; i++) {
+    ev_async_init(&async_watchers[i], handle_async);
+    ev_async_start(loops[i], &async_watchers[i]);
+
+    ev_check_init(&check_watchers[i], refresh_clock);
+    ev_check_start(loops[i], &check_watchers[i]);
+  }
 
   ev_timer_init(&timeouts_watcher, handle_timeouts, 0., 2100000.0);
   ev_timer_again(loop, &timeouts_watcher);
 
+  ev_check_init(&sweep_watcher, sweep_zombies);
+  ev_check_start(loop, &sweep_watcher);
+
   ev_io_init(&server_watcher, accept, __s__, EV_READ);
   ev_io_start(loop, &server_watcher);
 
+  if (__us__ >= 0) {
+    ev_io_init(&unix_server_watcher, accept, __us__, EV_READ);
+    ev_io_start(loop, &unix_server_watcher);
+  }
+
 //   ev_child_init(&child_watcher, child_exited, pid, 0);
 //   ev_child_start(loop, &cw);
 
@@ -1376,9 +2613,17 @@ void initialize(const string& delegate)
 //   sigaddset (&sa.sa_mask, w->signum);
 //   sigprocmask (SIG_UNBLOCK, &sa.sa_mask, 0);
 
-  pthread_t thread; // For now, not saving handles on our threads.
-  if (pthread_create(&thread, NULL, serve, loop) != 0) {
-    LOG(FATAL) << "Failed to initialize, pthread_create";
+  for (int i = 0; i < nloops; i++) {
+    pthread_t thread; // For now, not saving handles on our threads.
+    if (pthread_create(&thread, NULL, serve, loops[i]) != 0) {
+      LOG(FATAL) << "Failed to initialize, pthread_create";
+    }
+
+    // Pin the event loop thread if an I/O CPU list was configured
+    // (see LIBPROCESS_IO_CPUS above).
+    if (!io_cpus.empty()) {
+      pin(thread, io_cpus[i % io_cpus.size()]);
+    }
   }
 
   // Need to set initialzing here so that we can actually invoke
@@ -1391,6 +2636,16 @@ void initialize(const string& delegate)
   // Create the global profiler.
   spawn(new Profiler(), true);
 
+  // Create the endpoints for the sampling profiler.
+  spawn(new SamplingProfilerProcess(), true);
+
+  // Create the timing probes process.
+  spawn(new TimingProcess(), true);
+
+  // Create the global http client (see http::get and http::post).
+  http::internal::client = new http::internal::HttpClientProcess();
+  spawn(http::internal::client, true);
+
   // Create the global statistics.
   // TODO(bmahler): Investigate memory implications of this window
   // size. We may also want to provide a maximum memory size rather than
@@ -1429,7 +2684,8 @@ uint16_t port()
 
 HttpProxy::HttpProxy(const Socket& _socket)
   : ProcessBase(ID::generate("__http__")),
-    socket(_socket) {}
+    socket(_socket),
+    compressor(NULL) {}
 
 
 HttpProxy::~HttpProxy()
@@ -1441,6 +2697,9 @@ HttpProxy::~HttpProxy()
   }
   pipe = None();
 
+  delete compressor;
+  compressor = NULL;
+
   while (!items.empty()) {
     Item* item = items.front();
 
@@ -1518,6 +2777,19 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
 
   Response response = future.get();
 
+  // Collapse a conditional request: a "200 OK" response carrying an
+  // entity tag matching the request's 'If-None-Match' is answered
+  // with "304 Not Modified" and no body, since the poller's cached
+  // copy is still current (see http::etag).
+  if (response.type == Response::BODY &&
+      response.status == "200 OK" &&
+      response.headers.contains("ETag") &&
+      request.headers.get("If-None-Match") == response.headers.get("ETag")) {
+    socket_manager->send(
+        NotModified(response.headers.get("ETag").get()), request, socket);
+    return true; // All done, can process next response.
+  }
+
   // If the response specifies a path, try and perform a sendfile.
   if (response.type == Response::PATH) {
     // Make sure no body is sent (this is really an error and
@@ -1544,19 +2816,35 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
       } else if (S_ISDIR(s.st_mode)) {
         VLOG(1) << "Returning '404 Not Found' for directory '" << path << "'";
         socket_manager->send(NotFound(), request, socket);
+      } else if (response.offset < 0 || response.offset > s.st_size) {
+        VLOG(1) << "Returning '416 Requested Range Not Satisfiable' for "
+                << "offset " << response.offset << " into '" << path << "'";
+        ::close(fd);
+        Response error;
+        error.status = "416 Requested Range Not Satisfiable";
+        socket_manager->send(error, request, socket);
       } else {
+        // Determine how much of the file to send, honoring any range
+        // specified in the response (truncated at the end of file).
+        size_t size = s.st_size - response.offset;
+
+        if (response.length >= 0) {
+          size = std::min(size, (size_t) response.length);
+        }
+
         // While the user is expected to properly set a 'Content-Type'
         // header, we fill in (or overwrite) 'Content-Length' header.
         stringstream out;
-        out << s.st_size;
+        out << size;
         response.headers["Content-Length"] = out.str();
 
-        if (s.st_size == 0) {
+        if (size == 0) {
+          ::close(fd);
           socket_manager->send(response, request, socket);
           return true; // All done, can process next request.
         }
 
-        VLOG(1) << "Sending file at '" << path << "' with length " << s.st_size;
+        VLOG(1) << "Sending file at '" << path << "' with length " << size;
 
         // TODO(benh): Consider a way to have the socket manager turn
         // on TCP_CORK for both sends and then turn it off.
@@ -1564,7 +2852,7 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
         socket_manager->send(encoder, socket, true);
 
         // Note the file descriptor gets closed by FileEncoder.
-        encoder = new FileEncoder(fd, s.st_size);
+        encoder = new FileEncoder(fd, size, response.offset);
         socket_manager->send(encoder, socket, request.keepAlive);
       }
     }
@@ -1586,6 +2874,21 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
     // header, we fill in (or overwrite) 'Transfer-Encoding' header.
     response.headers["Transfer-Encoding"] = "chunked";
 
+    // Compress the stream if the client accepts gzip (unlike with
+    // Response::BODY responses, which HttpResponseEncoder handles, we
+    // have to advertise 'Content-Encoding' before seeing any data, so
+    // we only do so if the compressor is actually usable).
+    if (!response.headers.contains("Content-Encoding") &&
+        request.accepts("gzip")) {
+      compressor = new gzip::Compressor();
+      if (compressor->initialized()) {
+        response.headers["Content-Encoding"] = "gzip";
+      } else {
+        delete compressor;
+        compressor = NULL;
+      }
+    }
+
     VLOG(1) << "Starting \"chunked\" streaming";
 
     Encoder* encoder = new HttpResponseEncoder(response, request);
@@ -1637,8 +2940,38 @@ void HttpProxy::stream(const Future<short>& poll, const Request& request)
             const char* error = strerror(errno);
             VLOG(1) << "Read error while streaming: " << error;
           }
+          if (compressor != NULL) {
+            // Emit whatever the compressor still has buffered (and
+            // the gzip trailer) before the terminating chunk.
+            Try<std::string> compressed = compressor->finish();
+            if (compressed.isError()) {
+              VLOG(1) << "Failed to finish compressing stream: "
+                      << compressed.error();
+            } else if (compressed.get().length() > 0) {
+              out << std::hex << compressed.get().length() << "\r\n";
+              out.write(compressed.get().data(), compressed.get().length());
+              out << "\r\n";
+            }
+            delete compressor;
+            compressor = NULL;
+          }
           out << "0\r\n" << "\r\n";
           finished = true;
+        } else if (compressor != NULL) {
+          // Data (compressed)! Note that the compressor flushes on
+          // every chunk so the client can make progress immediately.
+          Try<std::string> compressed = compressor->compress(data, length);
+          if (compressed.isError()) {
+            // We already promised 'Content-Encoding: gzip' so we
+            // can't fall back to the raw data; terminate the stream.
+            VLOG(1) << "Failed to compress stream: " << compressed.error();
+            out << "0\r\n" << "\r\n";
+            finished = true;
+          } else if (compressed.get().length() > 0) {
+            out << std::hex << compressed.get().length() << "\r\n";
+            out.write(compressed.get().data(), compressed.get().length());
+            out << "\r\n";
+          }
         } else {
           // Data!
           out << std::hex << length << "\r\n";
@@ -1648,10 +2981,12 @@ void HttpProxy::stream(const Future<short>& poll, const Request& request)
 
         // We always persist the connection when we're not finished
         // streaming.
-        socket_manager->send(
-          new DataEncoder(out.str()),
-          socket,
-          finished ? request.keepAlive : true);
+        if (out.str().length() > 0) {
+          socket_manager->send(
+            new DataEncoder(out.str()),
+            socket,
+            finished ? request.keepAlive : true);
+        }
       }
     }
   } else if (poll.isFailed()) {
@@ -1665,6 +3000,8 @@ void HttpProxy::stream(const Future<short>& poll, const Request& request)
   }
 
   if (finished) {
+    delete compressor;
+    compressor = NULL;
     close(pipe.get());
     pipe = None();
     next();
@@ -1673,6 +3010,7 @@ void HttpProxy::stream(const Future<short>& poll, const Request& request)
 
 
 SocketManager::SocketManager()
+  : total(0)
 {
   synchronizer(this) = SYNCHRONIZED_INITIALIZER_RECURSIVE;
 }
@@ -1689,7 +3027,106 @@ Socket SocketManager::accepted(int s)
 }
 
 
-void SocketManager::link(ProcessBase* process, const UPID& to)
+// Applies socket tuning options. These are performance hints, not
+// correctness requirements, so failures get logged and ignored.
+static void tune(int s, const SocketOptions& options)
+{
+  if (options.nodelay) {
+    int on = 1;
+    if (setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) < 0) {
+      PLOG(WARNING) << "Failed to set TCP_NODELAY on socket " << s;
+    }
+  }
+
+  if (options.keepalive) {
+    int on = 1;
+    if (setsockopt(s, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) < 0) {
+      PLOG(WARNING) << "Failed to set SO_KEEPALIVE on socket " << s;
+    }
+  }
+
+  if (options.sndbuf.isSome()) {
+    int size = options.sndbuf.get();
+    if (setsockopt(s, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) < 0) {
+      PLOG(WARNING) << "Failed to set SO_SNDBUF on socket " << s;
+    }
+  }
+
+  if (options.rcvbuf.isSome()) {
+    int size = options.rcvbuf.get();
+    if (setsockopt(s, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
+      PLOG(WARNING) << "Failed to set SO_RCVBUF on socket " << s;
+    }
+  }
+}
+
+
+// Attempts to create a socket connected (or connecting) to 'node'
+// over the unix domain transport. This only applies when a socket
+// directory is configured, the node is on this host, and its socket
+// exists in the directory (i.e., the peer is a libprocess sharing the
+// directory); in every other case -1 gets returned and the caller
+// should connect over TCP. On success 'connecting' is set to whether
+// a non-blocking connect is still in progress.
+static int connect_unix(const Node& node, bool* connecting)
+{
+  if (socket_dir == NULL || node.ip != __ip__) {
+    return -1;
+  }
+
+  const std::string path = *socket_dir + "/" + stringify(node.port);
+
+  // A missing socket means the peer is not listening on the unix
+  // domain transport (e.g., it was started without a socket
+  // directory); don't even create a socket.
+  struct stat unused;
+  if (::stat(path.c_str(), &unused) != 0) {
+    return -1;
+  }
+
+  int s;
+  if ((s = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+    PLOG(FATAL) << "Failed to connect, socket (unix)";
+  }
+
+  Try<Nothing> nonblock = os::nonblock(s);
+  if (nonblock.isError()) {
+    LOG(FATAL) << "Failed to connect, nonblock (unix): " << nonblock.error();
+  }
+
+  Try<Nothing> cloexec = os::cloexec(s);
+  if (cloexec.isError()) {
+    LOG(FATAL) << "Failed to connect, cloexec (unix): " << cloexec.error();
+  }
+
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  if (connect(s, (sockaddr*) &addr, sizeof(addr)) < 0) {
+    if (errno != EINPROGRESS && errno != EAGAIN) {
+      // Fall back to TCP, e.g., the socket file is stale because the
+      // peer exited without unlinking it.
+      PLOG(WARNING) << "Failed to connect to unix domain socket '" << path
+                    << "', falling back to TCP";
+      close(s);
+      return -1;
+    }
+
+    *connecting = true;
+  } else {
+    *connecting = false;
+  }
+
+  return s;
+}
+
+
+void SocketManager::link(
+    ProcessBase* process,
+    const UPID& to,
+    const SocketOptions& options)
 {
   // TODO(benh): The semantics we want to support for link are such
   // that if there is nobody to link to (local or remote) then an
@@ -1707,21 +3144,42 @@ void SocketManager::link(ProcessBase* process, const UPID& to)
     // Check if node is remote and there isn't a persistant link.
     if ((node.ip != __ip__ || node.port != __port__)
         && persists.count(node) == 0) {
-      // Okay, no link, lets create a socket.
-      int s;
+      // Okay, no link, lets create a socket. Prefer the unix domain
+      // transport for a node on this host (see connect_unix).
+      bool connecting = false;
 
-      if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        PLOG(FATAL) << "Failed to link, socket";
-      }
+      int s = connect_unix(node, &connecting);
 
-      Try<Nothing> nonblock = os::nonblock(s);
-      if (nonblock.isError()) {
-        LOG(FATAL) << "Failed to link, nonblock: " << nonblock.error();
-      }
+      if (s < 0) {
+        if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+          PLOG(FATAL) << "Failed to link, socket";
+        }
+
+        Try<Nothing> nonblock = os::nonblock(s);
+        if (nonblock.isError()) {
+          LOG(FATAL) << "Failed to link, nonblock: " << nonblock.error();
+        }
+
+        Try<Nothing> cloexec = os::cloexec(s);
+        if (cloexec.isError()) {
+          LOG(FATAL) << "Failed to link, cloexec: " << cloexec.error();
+        }
 
-      Try<Nothing> cloexec = os::cloexec(s);
-      if (cloexec.isError()) {
-        LOG(FATAL) << "Failed to link, cloexec: " << cloexec.error();
+        tune(s, options);
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = PF_INET;
+        addr.sin_port = htons(to.port);
+        addr.sin_addr.s_addr = to.ip;
+
+        // Try and connect to the node using this socket.
+        if (connect(s, (sockaddr*) &addr, sizeof(addr)) < 0) {
+          if (errno != EINPROGRESS) {
+            PLOG(FATAL) << "Failed to link, connect";
+          }
+          connecting = true;
+        }
       }
 
       Socket socket = Socket(s);
@@ -1731,12 +3189,6 @@ void SocketManager::link(ProcessBase* process, const UPID& to)
 
       persists[node] = s;
 
-      sockaddr_in addr;
-      memset(&addr, 0, sizeof(addr));
-      addr.sin_family = PF_INET;
-      addr.sin_port = htons(to.port);
-      addr.sin_addr.s_addr = to.ip;
-
       // Allocate and initialize the decoder and watcher (we really
       // only "receive" on this socket so that we can react when it
       // gets closed and generate appropriate lost events).
@@ -1745,25 +3197,22 @@ void SocketManager::link(ProcessBase* process, const UPID& to)
       ev_io* watcher = new ev_io();
       watcher->data = decoder;
 
-      // Try and connect to the node using this socket.
-      if (connect(s, (sockaddr*) &addr, sizeof(addr)) < 0) {
-        if (errno != EINPROGRESS) {
-          PLOG(FATAL) << "Failed to link, connect";
-        }
-
+      if (connecting) {
         // Wait for socket to be connected.
         ev_io_init(watcher, receiving_connect, s, EV_WRITE);
       } else {
         ev_io_init(watcher, recv_data, s, EV_READ);
       }
 
-      // Enqueue the watcher.
-      synchronized (watchers) {
-        watchers->push(watcher);
-      }
+      // Enqueue the watcher with the loop responsible for the socket.
+      start_watcher(watcher);
 
-      // Interrupt the loop.
-      ev_async_send(loop, &async_watcher);
+      // Advertise our codecs to the peer right away (the compression
+      // 'handshake'); the peer's own announcement, if any, arrives
+      // over its connection back to us (see 'exchanged').
+      if (compression) {
+        announce(node);
+      }
     }
 
     links[to].insert(process);
@@ -1816,7 +3265,27 @@ void SocketManager::send(Encoder* encoder, int s, bool persist)
       }
 
       if (outgoing.count(s) > 0) {
-        outgoing[s].push(encoder);
+        outgoing[s].push_back(encoder);
+
+        size_t bytes = encoder->remaining();
+        queued[s] += bytes;
+        total += bytes;
+
+        // Make the slow consumer visible when first crossing the
+        // watermark (draining back below resets this so a
+        // persistently slow peer logs once per episode, not once
+        // per message).
+        if (queued[s] >= send_high_watermark &&
+            queued[s] - bytes < send_high_watermark) {
+          LOG(WARNING) << "Send queue for socket " << s
+                       << (nodes.count(s) > 0
+                           ? " (to " + stringify(nodes[s].ip) + ":" +
+                             stringify(nodes[s].port) + ")"
+                           : "")
+                       << " has exceeded the high watermark ("
+                       << queued[s] << " of " << send_high_watermark
+                       << " bytes, " << total << " bytes total)";
+        }
       } else {
         // Initialize the outgoing queue.
         outgoing[s];
@@ -1827,11 +3296,7 @@ void SocketManager::send(Encoder* encoder, int s, bool persist)
 
         ev_io_init(watcher, encoder->sender(), s, EV_WRITE);
 
-        synchronized (watchers) {
-          watchers->push(watcher);
-        }
-
-        ev_async_send(loop, &async_watcher);
+        start_watcher(watcher);
       }
     } else {
       VLOG(1) << "Attempting to send on a no longer valid socket!";
@@ -1864,10 +3329,46 @@ void SocketManager::send(Message* message)
 {
   CHECK(message != NULL);
 
-  DataEncoder* encoder = new MessageEncoder(message);
-
   Node node(message->to.ip, message->to.port);
 
+  bool compress = false;
+
+  synchronized (this) {
+    // Advertise our codecs the first time we talk to a node (the
+    // compression 'handshake'); doing it here guarantees the
+    // announcement precedes anything the peer might have to decode.
+    if (compression && announced.count(node) == 0) {
+      announce(node);
+    }
+
+    compress = compression &&
+      message->encoding.empty() &&
+      message->body.size() >= compression_threshold &&
+      gzips.count(node) > 0;
+  }
+
+  // Compress outside of the lock (deflating a multi-megabyte body
+  // should not stall every other send). The peer announced it can
+  // decompress gzip (see 'exchanged'), so we trade cheap CPU for the
+  // wire bytes that large control messages otherwise cost.
+  if (compress) {
+    Try<string> compressed = gzip::compress(message->body);
+    if (compressed.isError()) {
+      VLOG(1) << "Failed to compress message '" << message->name
+              << "' to " << message->to << ": " << compressed.error();
+    } else if (compressed.get().size() < message->body.size()) {
+      synchronized (this) {
+        pair<uint64_t, uint64_t>& ratio = ratios[node];
+        ratio.first += message->body.size();
+        ratio.second += compressed.get().size();
+      }
+      message->body = compressed.get();
+      message->encoding = "gzip";
+    }
+  }
+
+  DataEncoder* encoder = new MessageEncoder(message);
+
   synchronized (this) {
     // Check if there is already a socket.
     bool persist = persists.count(node) > 0;
@@ -1877,21 +3378,40 @@ void SocketManager::send(Message* message)
       send(encoder, s, persist);
     } else {
       // No peristant or temporary socket to the node currently
-      // exists, so we create a temporary one.
-      int s;
+      // exists, so we create a temporary one, preferring the unix
+      // domain transport for a node on this host (see connect_unix).
+      bool connecting = false;
 
-      if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        PLOG(FATAL) << "Failed to send, socket";
-      }
+      int s = connect_unix(node, &connecting);
 
-      Try<Nothing> nonblock = os::nonblock(s);
-      if (nonblock.isError()) {
-        LOG(FATAL) << "Failed to send, nonblock: " << nonblock.error();
-      }
+      if (s < 0) {
+        if ((s = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+          PLOG(FATAL) << "Failed to send, socket";
+        }
 
-      Try<Nothing> cloexec = os::cloexec(s);
-      if (cloexec.isError()) {
-        LOG(FATAL) << "Failed to send, cloexec: " << cloexec.error();
+        Try<Nothing> nonblock = os::nonblock(s);
+        if (nonblock.isError()) {
+          LOG(FATAL) << "Failed to send, nonblock: " << nonblock.error();
+        }
+
+        Try<Nothing> cloexec = os::cloexec(s);
+        if (cloexec.isError()) {
+          LOG(FATAL) << "Failed to send, cloexec: " << cloexec.error();
+        }
+
+        // Try and connect to the node using this socket.
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = PF_INET;
+        addr.sin_port = htons(message->to.port);
+        addr.sin_addr.s_addr = message->to.ip;
+
+        if (connect(s, (sockaddr*) &addr, sizeof(addr)) < 0) {
+          if (errno != EINPROGRESS) {
+            PLOG(FATAL) << "Failed to send, connect";
+          }
+          connecting = true;
+        }
       }
 
       sockets[s] = Socket(s);
@@ -1903,22 +3423,11 @@ void SocketManager::send(Message* message)
       // Initialize the outgoing queue.
       outgoing[s];
 
-      // Try and connect to the node using this socket.
-      sockaddr_in addr;
-      memset(&addr, 0, sizeof(addr));
-      addr.sin_family = PF_INET;
-      addr.sin_port = htons(message->to.port);
-      addr.sin_addr.s_addr = message->to.ip;
-
       // Allocate and initialize the watcher.
       ev_io* watcher = new ev_io();
       watcher->data = encoder;
 
-      if (connect(s, (sockaddr*) &addr, sizeof(addr)) < 0) {
-        if (errno != EINPROGRESS) {
-          PLOG(FATAL) << "Failed to send, connect";
-        }
-
+      if (connecting) {
         // Initialize watcher for connecting.
         ev_io_init(watcher, sending_connect, s, EV_WRITE);
       } else {
@@ -1926,13 +3435,153 @@ void SocketManager::send(Message* message)
         ev_io_init(watcher, send_data, s, EV_WRITE);
       }
 
-      // Enqueue the watcher.
-      synchronized (watchers) {
-        watchers->push(watcher);
+      // Enqueue the watcher with the loop responsible for the socket.
+      start_watcher(watcher);
+    }
+  }
+}
+
+
+void SocketManager::announce(const Node& node)
+{
+  announced.insert(node);
+
+  // No point announcing to ourselves (local messages never hit a
+  // socket anyway).
+  if (node.ip == __ip__ && node.port == __port__) {
+    return;
+  }
+
+  // A peer that predates codec announcements silently drops this
+  // (there is no '__compression__' process to deliver to) and keeps
+  // getting uncompressed messages, so mixed clusters just work.
+  Message* message = new Message();
+  message->name = "CODECS";
+  message->from = UPID("__compression__", __ip__, __port__);
+  message->to = UPID("__compression__", node.ip, node.port);
+  message->body = "gzip";
+
+  send(message);
+}
+
+
+void SocketManager::exchanged(const UPID& from, const string& codecs)
+{
+  // NOTE: The node is keyed off of the announcement's 'from' (the
+  // peer's advertised ip and port, i.e., what our sends to it use as
+  // 'to'), not the address of the socket it arrived on (an ephemeral
+  // port).
+  Node node(from.ip, from.port);
+
+  foreach (const string& codec, strings::tokenize(codecs, ",")) {
+    if (strings::trim(codec) == "gzip") {
+      synchronized (this) {
+        gzips.insert(node);
+      }
+      VLOG(1) << "Peer " << stringify(node.ip) << ":"
+              << stringify(node.port) << " accepts gzip compression";
+    }
+  }
+}
+
+
+JSON::Object SocketManager::codecs()
+{
+  JSON::Object object;
+
+  synchronized (this) {
+    if (compression) {
+      object.values["enabled"] = JSON::True();
+    } else {
+      object.values["enabled"] = JSON::False();
+    }
+    object.values["threshold"] = (double) compression_threshold;
+
+    JSON::Object links;
+
+    typedef pair<uint64_t, uint64_t> Ratio;
+    foreachpair (const Node& node, const Ratio& ratio, ratios) {
+      JSON::Object link;
+      link.values["uncompressed_bytes"] = (double) ratio.first;
+      link.values["compressed_bytes"] = (double) ratio.second;
+      if (ratio.second > 0) {
+        link.values["ratio"] = (double) ratio.first / (double) ratio.second;
+      }
+      links.values[stringify(node.ip) + ":" + stringify(node.port)] = link;
+    }
+    object.values["links"] = links;
+  }
+
+  return object;
+}
+
+
+Future<Nothing> SocketManager::send(Message* message, bool expendable)
+{
+  CHECK(message != NULL);
+
+  Node node(message->to.ip, message->to.port);
+
+  synchronized (this) {
+    // Find any existing socket to the node (a new socket necessarily
+    // has an empty queue and thus is below the watermark).
+    int s = -1;
+    if (persists.count(node) > 0) {
+      s = persists[node];
+    } else if (temps.count(node) > 0) {
+      s = temps[node];
+    }
+
+    if (s >= 0 && queued.count(s) > 0 && queued[s] >= send_high_watermark) {
+      if (expendable) {
+        // Drop rather than queue; the peer is not keeping up and the
+        // caller declared this message class safe to shed.
+        uint64_t count = ++dropped[message->name];
+        if (count == 1 || count % 10000 == 0) {
+          LOG(WARNING) << "Dropped " << count << " '" << message->name
+                       << "' message(s) to " << message->to
+                       << " over the send queue high watermark";
+        }
+        delete message;
+        return Nothing();
       }
 
-      ev_async_send(loop, &async_watcher);
+      send(message);
+
+      // Surface the backpressure: satisfied once the queue drains
+      // below the watermark (or the socket gets closed).
+      std::tr1::shared_ptr<Promise<Nothing> > promise(
+          new Promise<Nothing>());
+      throttled[s].push_back(promise);
+      return promise->future();
     }
+
+    send(message);
+  }
+
+  return Nothing();
+}
+
+
+void SocketManager::drained(
+    int s,
+    size_t bytes,
+    vector<std::tr1::shared_ptr<Promise<Nothing> > >* promises)
+{
+  CHECK(queued.count(s) > 0 && queued[s] >= bytes);
+  CHECK(total >= bytes);
+
+  queued[s] -= bytes;
+  total -= bytes;
+
+  if (queued[s] < send_high_watermark && throttled.count(s) > 0) {
+    promises->insert(
+        promises->end(), throttled[s].begin(), throttled[s].end());
+    throttled.erase(s);
+  }
+
+  if (queued[s] == 0) {
+    queued.erase(s);
   }
 }
 
@@ -1940,6 +3589,11 @@ void SocketManager::send(Message* message)
 Encoder* SocketManager::next(int s)
 {
   HttpProxy* proxy = NULL; // Non-null if needs to be terminated.
+  Encoder* encoder = NULL;
+
+  // Promises to satisfy once we've released the lock (satisfying a
+  // promise runs arbitrary callbacks).
+  vector<std::tr1::shared_ptr<Promise<Nothing> > > promises;
 
   synchronized (this) {
     // We cannot assume 'sockets.count(s) > 0' here because it's
@@ -1960,13 +3614,21 @@ Encoder* SocketManager::next(int s)
 
       if (!outgoing[s].empty()) {
         // More messages!
-        Encoder* encoder = outgoing[s].front();
-        outgoing[s].pop();
-        return encoder;
+        encoder = outgoing[s].front();
+        outgoing[s].pop_front();
+        drained(s, encoder->remaining(), &promises);
       } else {
-        // No more messages ... erase the outgoing queue.
+        // No more messages ... erase the outgoing queue. Any senders
+        // still throttled on this socket get woken up (nothing is
+        // queued anymore).
         outgoing.erase(s);
 
+        if (throttled.count(s) > 0) {
+          promises.insert(
+              promises.end(), throttled[s].begin(), throttled[s].end());
+          throttled.erase(s);
+        }
+
         if (dispose.count(s) > 0) {
           // This is either a temporary socket we created or it's a
           // socket that we were receiving data from and possibly
@@ -2003,7 +3665,61 @@ Encoder* SocketManager::next(int s)
     terminate(proxy);
   }
 
-  return NULL;
+  foreach (const std::tr1::shared_ptr<Promise<Nothing> >& promise, promises) {
+    promise->set(Nothing());
+  }
+
+  return encoder;
+}
+
+
+DataEncoder* SocketManager::coalesce(int s)
+{
+  Encoder* encoder = NULL;
+
+  vector<std::tr1::shared_ptr<Promise<Nothing> > > promises;
+
+  synchronized (this) {
+    if (sockets.count(s) > 0 &&
+        outgoing.count(s) > 0 &&
+        !outgoing[s].empty()) {
+      // Don't coalesce encoders with a different send mechanism
+      // (e.g., a FileEncoder which gets sent with sendfile).
+      if (outgoing[s].front()->sender() == &send_data) {
+        encoder = outgoing[s].front();
+        outgoing[s].pop_front();
+        drained(s, encoder->remaining(), &promises);
+      }
+    }
+  }
+
+  foreach (const std::tr1::shared_ptr<Promise<Nothing> >& promise, promises) {
+    promise->set(Nothing());
+  }
+
+  return (DataEncoder*) encoder;
+}
+
+
+void SocketManager::requeue(int s, Encoder* encoder)
+{
+  synchronized (this) {
+    if (sockets.count(s) > 0 && outgoing.count(s) > 0) {
+      outgoing[s].push_front(encoder);
+
+      // Undo the accounting done when this encoder was popped (note
+      // that 'remaining' may legitimately be less now if part of the
+      // encoder got sent before it was put back).
+      size_t bytes = encoder->remaining();
+      queued[s] += bytes;
+      total += bytes;
+      return;
+    }
+  }
+
+  // The socket was closed while we were trying to send (close
+  // deleted whatever was still queued, so delete this one too).
+  delete encoder;
 }
 
 
@@ -2011,6 +3727,8 @@ void SocketManager::close(int s)
 {
   HttpProxy* proxy = NULL; // Non-null if needs to be terminated.
 
+  vector<std::tr1::shared_ptr<Promise<Nothing> > > promises;
+
   synchronized (this) {
     // This socket might not be active if it was already asked to get
     // closed (e.g., a write on the socket failed so we try and close
@@ -2022,13 +3740,22 @@ void SocketManager::close(int s)
       if (outgoing.count(s) > 0) {
         while (!outgoing[s].empty()) {
           Encoder* encoder = outgoing[s].front();
+          drained(s, encoder->remaining(), &promises);
           delete encoder;
-          outgoing[s].pop();
+          outgoing[s].pop_front();
         }
 
         outgoing.erase(s);
       }
 
+      // Wake up any senders still throttled on this socket (their
+      // data is gone; the exited machinery signals the failure).
+      if (throttled.count(s) > 0) {
+        promises.insert(
+            promises.end(), throttled[s].begin(), throttled[s].end());
+        throttled.erase(s);
+      }
+
       // Clean up after sockets used for node communication.
       if (nodes.count(s) > 0) {
         const Node& node = nodes[s];
@@ -2036,6 +3763,21 @@ void SocketManager::close(int s)
         // Don't bother invoking exited unless socket was persistant.
         if (persists.count(node) > 0 && persists[node] == s) {
           persists.erase(node);
+
+          // Forget the codec exchange with this node: if it comes
+          // back it might not speak compression anymore (e.g., a
+          // downgraded restart), so require a fresh announcement
+          // before compressing to it again.
+          announced.erase(node);
+          gzips.erase(node);
+          if (ratios.count(node) > 0) {
+            VLOG(1) << "Link to " << stringify(node.ip) << ":"
+                    << stringify(node.port) << " closed having compressed "
+                    << ratios[node].first << " body bytes down to "
+                    << ratios[node].second;
+            ratios.erase(node);
+          }
+
           exited(node); // Generate ExitedEvent(s)!
         } else if (temps.count(node) > 0 && temps[node] == s) {
           temps.erase(node);
@@ -2061,6 +3803,10 @@ void SocketManager::close(int s)
     terminate(proxy);
   }
 
+  foreach (const std::tr1::shared_ptr<Promise<Nothing> >& promise, promises) {
+    promise->set(Nothing());
+  }
+
   // Note that we don't actually:
   //
   //   close(s);
@@ -2139,17 +3885,30 @@ void SocketManager::exited(ProcessBase* process)
 }
 
 
-ProcessManager::ProcessManager(const string& _delegate)
+ProcessManager::ProcessManager(const string& _delegate, long workers)
   : delegate(_delegate)
 {
   synchronizer(processes) = SYNCHRONIZED_INITIALIZER_RECURSIVE;
-  synchronizer(runq) = SYNCHRONIZED_INITIALIZER_RECURSIVE;
+
+  for (long i = 0; i < workers; i++) {
+    runqs.push_back(new RunQueue());
+  }
+
+  // NOTE: vector::resize value-initializes, so the counters are zero.
+  counters.resize(workers);
+
+  next = 0;
   running = 0;
   __sync_synchronize(); // Ensure write to 'running' visible in other threads.
 }
 
 
-ProcessManager::~ProcessManager() {}
+ProcessManager::~ProcessManager()
+{
+  for (size_t i = 0; i < runqs.size(); i++) {
+    delete runqs[i];
+  }
+}
 
 
 ProcessReference ProcessManager::use(const UPID& pid)
@@ -2181,6 +3940,17 @@ bool ProcessManager::handle(
     Message* message = parse(request);
     if (message != NULL) {
       delete request;
+
+      // Intercept codec capability announcements (see
+      // SocketManager::announce) before delivery; there is no actual
+      // '__compression__' process.
+      if (message->to.id == "__compression__" &&
+          message->name == "CODECS") {
+        socket_manager->exchanged(message->from, message->body);
+        delete message;
+        return true;
+      }
+
       // TODO(benh): Use the sender PID in order to capture
       // happens-before timing relationships for testing.
       return deliver(message->to, new MessageEvent(message));
@@ -2228,17 +3998,222 @@ bool ProcessManager::handle(
     return false;
   }
 
-  // Split the path by '/'.
-  vector<string> tokens = strings::tokenize(request->path, "/");
+  // Serve the per-link compression instrumentation directly (as with
+  // '__processes__' below, there is no process by this name).
+  if (request->path == "/__compression__/stats") {
+    JSON::Object object = socket_manager->codecs();
+
+    // Get the HttpProxy pid for this socket.
+    PID<HttpProxy> proxy = socket_manager->proxy(socket);
+
+    // Enqueue the response with the HttpProxy so that it respects the
+    // order of requests to account for HTTP/1.1 pipelining.
+    dispatch(
+        proxy,
+        &HttpProxy::enqueue,
+        OK(object, request->query.get("jsonp")),
+        *request);
+
+    // Cleanup request.
+    delete request;
+    return true;
+  }
+
+  // Serve the per process instrumentation directly (there is no
+  // process named '__processes__'; the stats span all of them).
+  if (request->path == "/__processes__/stats") {
+    JSON::Array array;
+
+    synchronized (processes) {
+      foreachvalue (ProcessBase* process, processes) {
+        JSON::Object object;
+        object.values["id"] = process->pid.id;
+
+        process->lock();
+        {
+          object.values["depth"] = (double) process->mailbox.depth();
+
+          // Cumulative enqueues per priority class (see
+          // Mailbox::Priority and ProcessBase::classify).
+          JSON::Object classes;
+          classes.values["urgent"] =
+            (double) process->mailbox.pushes(Mailbox::URGENT);
+          classes.values["high"] =
+            (double) process->mailbox.pushes(Mailbox::HIGH);
+          classes.values["normal"] =
+            (double) process->mailbox.pushes(Mailbox::NORMAL);
+          classes.values["bulk"] =
+            (double) process->mailbox.pushes(Mailbox::BULK);
+          object.values["classes"] = classes;
+
+          object.values["enqueued"] = (double) process->stats.enqueued;
+          object.values["handled"] = (double) process->stats.handled;
+          object.values["watermark"] = (double) process->stats.watermark;
+          object.values["busy"] = process->stats.busy;
+
+          // Enqueue-to-resume latency histogram (bucket upper bounds).
+          JSON::Object latencies;
+          latencies.values["10us"] = (double) process->stats.latencies[0];
+          latencies.values["100us"] = (double) process->stats.latencies[1];
+          latencies.values["1ms"] = (double) process->stats.latencies[2];
+          latencies.values["10ms"] = (double) process->stats.latencies[3];
+          latencies.values["100ms"] = (double) process->stats.latencies[4];
+          latencies.values["1s"] = (double) process->stats.latencies[5];
+          latencies.values["inf"] = (double) process->stats.latencies[6];
+          object.values["latencies"] = latencies;
+        }
+        process->unlock();
+
+        // Per route request counts and completion-latency histograms
+        // (see HttpRouter::Stats; counters are atomically updated so
+        // no lock is required).
+        JSON::Object routes;
+
+        typedef std::tr1::shared_ptr<HttpRouter::Stats> RouteStats;
+        const std::map<string, RouteStats>& stats =
+          process->handlers.http.routes();
+
+        foreachpair (const string& path, const RouteStats& route, stats) {
+          JSON::Object object_;
+          object_.values["requests"] = (double) route->requests;
+
+          JSON::Object latencies;
+          latencies.values["10us"] = (double) route->latencies[0];
+          latencies.values["100us"] = (double) route->latencies[1];
+          latencies.values["1ms"] = (double) route->latencies[2];
+          latencies.values["10ms"] = (double) route->latencies[3];
+          latencies.values["100ms"] = (double) route->latencies[4];
+          latencies.values["1s"] = (double) route->latencies[5];
+          latencies.values["inf"] = (double) route->latencies[6];
+          object_.values["latencies"] = latencies;
+
+          routes.values[path.empty() ? "/" : path] = object_;
+        }
+
+        object.values["routes"] = routes;
+
+        array.values.push_back(object);
+      }
+    }
+
+    // Get the HttpProxy pid for this socket.
+    PID<HttpProxy> proxy = socket_manager->proxy(socket);
+
+    // Enqueue the response with the HttpProxy so that it respects the
+    // order of requests to account for HTTP/1.1 pipelining.
+    dispatch(
+        proxy,
+        &HttpProxy::enqueue,
+        OK(array, request->query.get("jsonp")),
+        *request);
+
+    // Cleanup request.
+    delete request;
+    return true;
+  }
+
+  // Serve the recent message trace spans (see the 'trace'
+  // namespace). An 'id' query parameter filters the dump down to a
+  // single correlation id.
+  if (request->path == "/trace") {
+    Option<string> id = request->query.get("id");
+
+    vector<trace::Span> spans;
+
+    foreach (trace::Ring* ring, trace::snapshot()) {
+      for (size_t i = 0; i < trace::SPANS; i++) {
+        const trace::Span& span = ring->spans[i];
+        if (span.id != 0 &&
+            (id.isNone() || stringify(span.id) == id.get())) {
+          spans.push_back(span);
+        }
+      }
+    }
+
+    std::sort(spans.begin(), spans.end(), trace::before);
+
+    JSON::Array array;
+
+    foreach (const trace::Span& span, spans) {
+      JSON::Object object;
+
+      // Render the id as a string: a 64 bit id doesn't round trip
+      // through a JSON (double) number.
+      object.values["id"] = stringify(span.id);
+      object.values["time"] = span.time;
+      object.values["process"] = string(span.process);
+      object.values["event"] = string(span.event);
+
+      array.values.push_back(object);
+    }
+
+    // Get the HttpProxy pid for this socket.
+    PID<HttpProxy> proxy = socket_manager->proxy(socket);
+
+    // Enqueue the response with the HttpProxy so that it respects the
+    // order of requests to account for HTTP/1.1 pipelining.
+    dispatch(
+        proxy,
+        &HttpProxy::enqueue,
+        OK(array, request->query.get("jsonp")),
+        *request);
+
+    // Cleanup request.
+    delete request;
+    return true;
+  }
+
+  // Serve the per worker scheduling counters (see
+  // ProcessManager::dequeue) along with each worker's configured CPU
+  // pinning ('cpu' is -1 when the workers float).
+  if (request->path == "/workers") {
+    JSON::Array array;
+
+    for (size_t i = 0; i < counters.size(); i++) {
+      JSON::Object object;
+
+      object.values["worker"] = (double) i;
+      object.values["cpu"] = worker_cpus.empty()
+        ? -1.0
+        : (double) worker_cpus[i % worker_cpus.size()];
+      object.values["resumes"] = (double) counters[i].resumes;
+      object.values["steals"] = (double) counters[i].steals;
+      object.values["migrations"] = (double) counters[i].migrations;
+
+      array.values.push_back(object);
+    }
+
+    // Get the HttpProxy pid for this socket.
+    PID<HttpProxy> proxy = socket_manager->proxy(socket);
+
+    // Enqueue the response with the HttpProxy so that it respects the
+    // order of requests to account for HTTP/1.1 pipelining.
+    dispatch(
+        proxy,
+        &HttpProxy::enqueue,
+        OK(array, request->query.get("jsonp")),
+        *request);
+
+    // Cleanup request.
+    delete request;
+    return true;
+  }
+
+  // Pull the first component out of the path (the receiver id)
+  // without tokenizing the entire path.
+  strings::Tokenizer tokenizer(request->path, "/");
+  const char* data;
+  size_t length;
+  bool tokened = tokenizer.next(&data, &length);
 
   // Try and determine a receiver, otherwise try and delegate.
   ProcessReference receiver;
 
-  if (tokens.size() == 0 && delegate != "") {
+  if (!tokened && delegate != "") {
     request->path = "/" + delegate;
     receiver = use(UPID(delegate, __ip__, __port__));
-  } else if (tokens.size() > 0) {
-    receiver = use(UPID(tokens[0], __ip__, __port__));
+  } else if (tokened) {
+    receiver = use(UPID(string(data, length), __ip__, __port__));
   }
 
   if (!receiver && delegate != "") {
@@ -2310,7 +4285,7 @@ bool ProcessManager::deliver(
     return deliver(receiver, event, sender);
   }
 
-  delete event;
+  destroy(event);
   return false;
 }
 
@@ -2327,10 +4302,11 @@ UPID ProcessManager::spawn(ProcessBase* process, bool manage)
     }
   }
 
-  // Use the garbage collector if requested.
-  if (manage) {
-    dispatch(gc, &GarbageCollector::manage<ProcessBase>, process);
-  }
+  // Record whether we own this process; cleanup hands owned
+  // processes to the zombie list for batched reclamation (this used
+  // to round-trip every managed process through the garbage
+  // collector, a dispatch plus a link plus an exited event each).
+  process->manage = manage;
 
   // We save the PID before enqueueing the process to avoid the race
   // condition that occurs when a user has a very short process and
@@ -2347,6 +4323,21 @@ UPID ProcessManager::spawn(ProcessBase* process, bool manage)
 }
 
 
+// Returns the latency histogram bucket for the elapsed time. The
+// bucket upper bounds are 10us, 100us, 1ms, 10ms, 100ms, 1s, +Inf
+// (must stay in sync with ProcessBase::Stats::BUCKETS).
+static size_t bucket(double latency)
+{
+  double bound = 0.00001;
+  size_t index = 0;
+  while (index < 6 && latency > bound) {
+    bound *= 10.0;
+    index++;
+  }
+  return index;
+}
+
+
 void ProcessManager::resume(ProcessBase* process)
 {
   __process__ = process;
@@ -2357,6 +4348,10 @@ void ProcessManager::resume(ProcessBase* process)
   bool terminate = false;
   bool blocked = false;
 
+  // Saved for publishing samples (the process may be cleaned up by
+  // the time we go idle).
+  const int worker = process->worker;
+
   CHECK(process->state == ProcessBase::BOTTOM ||
         process->state == ProcessBase::READY);
 
@@ -2367,23 +4362,63 @@ void ProcessManager::resume(ProcessBase* process)
   }
 
   while (!terminate && !blocked) {
-    Event* event = NULL;
-
-    process->lock();
-    {
-      if (process->events.size() > 0) {
-        event = process->events.front();
-        process->events.pop_front();
-        process->state = ProcessBase::RUNNING;
-      } else {
-        process->state = ProcessBase::BLOCKED;
-        blocked = true;
+    // Detach the entire mailbox with a single atomic swap rather than
+    // dequeuing one event at a time: producers push lock-free and the
+    // batch comes back as an intrusive chain (see
+    // process/mailbox.hpp), so under message storms (e.g., a slave
+    // receiving bursts of status updates) there is no per-event
+    // synchronization at all. Note that this does mean an injected
+    // event only gets ahead of events that have not yet been drained
+    // into a batch.
+    size_t batch = 0;
+    Event* event = process->mailbox.drain(&batch);
+
+    if (batch == 0) {
+      // Publish that we are blocked, then re-check the mailbox: a
+      // producer that pushed in between saw RUNNING and did not
+      // schedule us, so we have to un-block ourselves. A producer
+      // that pushes after observing BLOCKED does the READY
+      // transition and schedules us instead; the compare-and-swap
+      // ensures exactly one of the two happens.
+      process->state = ProcessBase::BLOCKED;
+      __sync_synchronize();
+      if (process->mailbox.depth() > 0 &&
+          __sync_bool_compare_and_swap(
+              &process->state, ProcessBase::BLOCKED, ProcessBase::RUNNING)) {
+        continue; // Events arrived while we were going idle.
       }
+      blocked = true;
+      continue;
     }
-    process->unlock();
 
-    if (!blocked) {
-      CHECK(event != NULL);
+    process->state = ProcessBase::RUNNING;
+    process->warned = 0; // Queue drained; re-arm 'backlogged'.
+
+    // Record instrumentation for the batch locally and fold it into
+    // the process stats under a single lock hold afterwards. Queueing
+    // latencies are measured against the coarse clock (both ends are
+    // iteration-granular timestamps); busy time uses the monotonic
+    // clock so a system time adjustment can't skew it.
+    double start = Clock::now();
+    double monotonic = Clock::monotonic();
+    uint64_t handled = 0;
+    uint64_t latencies[ProcessBase::Stats::BUCKETS] = { 0 };
+
+    Event* next = NULL;
+    for (; event != NULL; event = next) {
+      // The event gets destroyed below, so advance along the chain
+      // up front.
+      next = event->next;
+
+      latencies[bucket(start - event->enqueued)]++;
+
+      if (terminate) {
+        // Terminated midway through the batch; the remainder of the
+        // batch gets deleted just like the events still in the queue
+        // (which cleanup took care of).
+        destroy(event);
+        continue;
+      }
 
       // Determine if we should filter this event.
       synchronized (filterer) {
@@ -2419,12 +4454,46 @@ void ProcessManager::resume(ProcessBase* process)
           event->visit(&visitor);
 
           if (filter) {
-            delete event;
+            destroy(event);
             continue; // Try and execute the next event.
           }
         }
       }
 
+      // Publish what we're about to service if the sampling profiler
+      // is running (the check keeps the common case to a load).
+      if (sampler->sampling()) {
+        struct LabelVisitor : EventVisitor
+        {
+          LabelVisitor() : label("event") {}
+
+          virtual void visit(const MessageEvent& event)
+          {
+            label = "message;" + event.message->name;
+          }
+
+          virtual void visit(const DispatchEvent& event)
+          {
+            label = "dispatch";
+          }
+
+          virtual void visit(const HttpEvent& event)
+          {
+            label = "http;" + event.request->path;
+          }
+
+          virtual void visit(const ExitedEvent& event) { label = "exited"; }
+          virtual void visit(const TerminateEvent& event) { label = "terminate"; }
+
+          string label;
+        } visitor;
+
+        event->visit(&visitor);
+
+        sampler->resumed(
+            worker, process->pid.id.c_str(), visitor.label.c_str());
+      }
+
       // Determine if we should terminate.
       terminate = event->is<TerminateEvent>();
 
@@ -2442,12 +4511,58 @@ void ProcessManager::resume(ProcessBase* process)
         terminate = true;
       }
 
-      delete event;
+      // Clear the ambient trace correlation id a message event made
+      // current (see ProcessBase::visit) so later events on this
+      // thread don't get attributed to a stale trace.
+      trace::ring()->current = 0;
+
+      destroy(event);
+
+      handled++;
 
       if (terminate) {
         cleanup(process);
       }
     }
+
+    // Fold the instrumentation into the process stats. Note that we
+    // can't touch the process after cleanup (a waiter might have
+    // already deleted it).
+    if (!terminate && batch > 0) {
+      double elapsed = Clock::monotonic() - monotonic;
+      process->lock();
+      {
+        process->stats.handled += handled;
+        process->stats.busy += elapsed;
+        for (size_t i = 0; i < ProcessBase::Stats::BUCKETS; i++) {
+          process->stats.latencies[i] += latencies[i];
+        }
+      }
+      process->unlock();
+    }
+
+    // Let the process amortize work across the batch it just
+    // serviced (e.g., flush buffered writes).
+    if (!terminate && batch > 0) {
+      try {
+        process->batched(batch);
+      } catch (const std::exception& e) {
+        std::cerr << "libprocess: " << process->pid
+                  << " terminating due to "
+                  << e.what() << std::endl;
+        terminate = true;
+        cleanup(process);
+      } catch (...) {
+        std::cerr << "libprocess: " << process->pid
+                  << " terminating due to unknown exception" << std::endl;
+        terminate = true;
+        cleanup(process);
+      }
+    }
+  }
+
+  if (sampler->sampling()) {
+    sampler->idled(worker);
   }
 
   __process__ = NULL;
@@ -2461,6 +4576,10 @@ void ProcessManager::cleanup(ProcessBase* process)
 {
   VLOG(2) << "Cleaning up " << process->pid;
 
+  // Remember whether we own this process (the flag is immutable
+  // after spawn but the process can't be dereferenced further down).
+  bool manage = process->manage;
+
   // First, set the terminating state so no more events will get
   // enqueued and delete al the pending events. We want to delete the
   // events before we hold the processes lock because deleting an
@@ -2470,22 +4589,22 @@ void ProcessManager::cleanup(ProcessBase* process)
   // of making sure that any events that might have gotten enqueued on
   // the process we are cleaning up will get dropped (since it's
   // terminating) and eliminates the potential of enqueueing them on
-  // another process that gets spawned with the same PID.
-  deque<Event*> events;
+  // another process that gets spawned with the same PID. Note that a
+  // producer can race with this drain (the mailbox is lock-free), but
+  // every producer holds a process reference, so the second drain
+  // below (after the reference count hits zero) is guaranteed to
+  // catch any straggler.
+  process->state = ProcessBase::TERMINATING;
+  __sync_synchronize();
 
-  process->lock();
-  {
-    process->state = ProcessBase::TERMINATING;
-    events = process->events;
-    process->events.clear();
-  }
-  process->unlock();
+  size_t drained = 0;
+  Event* chain = process->mailbox.drain(&drained);
 
   // Delete pending events.
-  while (!events.empty()) {
-    Event* event = events.front();
-    events.pop_front();
-    delete event;
+  while (chain != NULL) {
+    Event* next = chain->next;
+    destroy(chain);
+    chain = next;
   }
 
   // Possible gate non-libprocess threads are waiting at.
@@ -2501,7 +4620,11 @@ void ProcessManager::cleanup(ProcessBase* process)
 
     process->lock();
     {
-      CHECK(process->events.empty());
+      // With the reference count at zero no more pushes can be in
+      // flight, so this drain catches any event that raced with the
+      // one above. The events get deleted after we release the
+      // processes lock (see the rationale up top).
+      chain = process->mailbox.drain(&drained);
 
       processes.erase(process->pid.id);
  
@@ -2542,6 +4665,13 @@ void ProcessManager::cleanup(ProcessBase* process)
     socket_manager->exited(process);
   }
 
+  // Delete any stragglers now that the processes lock is released.
+  while (chain != NULL) {
+    Event* next = chain->next;
+    destroy(chain);
+    chain = next;
+  }
+
   // ***************************************************************
   // At this point we can no longer dereference the process since it
   // might already be deallocated (e.g., by the garbage collector).
@@ -2550,20 +4680,34 @@ void ProcessManager::cleanup(ProcessBase* process)
   if (gate != NULL) {
     gate->open();
   }
+
+  // Hand owned processes to the zombie list for batched reclamation
+  // (storing the pointer, not dereferencing it). Interrupt the
+  // default loop so the sweep happens promptly even when idle.
+  if (manage) {
+    synchronized (zombies) {
+      zombies->push_back(process);
+    }
+
+    ev_async_send(loop, &async_watchers[0]);
+  }
 }
 
 
-void ProcessManager::link(ProcessBase* process, const UPID& to)
+void ProcessManager::link(
+    ProcessBase* process,
+    const UPID& to,
+    const SocketOptions& options)
 {
   // Check if the pid is local.
   if (!(to.ip == __ip__ && to.port == __port__)) {
-    socket_manager->link(process, to);
+    socket_manager->link(process, to, options);
   } else {
     // Since the pid is local we want to get a reference to it's
     // underlying process so that while we are invoking the link
     // manager we don't miss sending a possible ExitedEvent.
     if (ProcessReference _ = use(to)) {
-      socket_manager->link(process, to);
+      socket_manager->link(process, to, options);
     } else {
       // Since the pid isn't valid it's process must have already died
       // (or hasn't been spawned yet) so send a process exit message.
@@ -2632,16 +4776,14 @@ bool ProcessManager::wait(const UPID& pid)
       // Check if it is runnable in order to donate this thread.
       if (process->state == ProcessBase::BOTTOM ||
           process->state == ProcessBase::READY) {
-        synchronized (runq) {
-          list<ProcessBase*>::iterator it =
-            find(runq.begin(), runq.end(), process);
-          if (it != runq.end()) {
-            runq.erase(it);
-          } else {
-            // Another thread has resumed the process ...
-            process = NULL;
-          }
-        }
+        // We can no longer extract a specific process from the
+        // (lock-free) run queue, so we donate this thread to
+        // whichever process is at the front instead. The process
+        // we're waiting on is runnable and thus in the queue, so
+        // between this thread and the workers somebody will get to
+        // it. (Donating was best-effort before too, see the TODO on
+        // donating only once below.)
+        process = dequeue(-1);
       } else {
         // Process is not runnable, so no need to donate ...
         process = NULL;
@@ -2652,7 +4794,6 @@ bool ProcessManager::wait(const UPID& pid)
   if (process != NULL) {
     VLOG(2) << "Donating thread to " << process->pid << " while waiting";
     ProcessBase* donator = __process__;
-    __sync_fetch_and_add(&running, 1);
     process_manager->resume(process);
     __process__ = donator;
   }
@@ -2684,33 +4825,65 @@ void ProcessManager::enqueue(ProcessBase* process)
   // it's not running. Otherwise, check and see which thread this
   // process was last running on, and put it on that threads runq.
 
-  synchronized (runq) {
-    CHECK(find(runq.begin(), runq.end(), process) == runq.end());
-    runq.push_back(process);
+  // Note that the process state machine ensures a process is only
+  // enqueued once (an event only makes a process READY if it was
+  // BLOCKED), so we don't need the old scan for duplicates here.
+  //
+  // Prefer the worker that last resumed this process so that its
+  // consecutive events keep their cache locality. Processes that have
+  // never run (or last ran on a donated thread) get assigned
+  // round-robin.
+  int worker = process->worker;
+
+  if (worker < 0) {
+    worker = (int) (__sync_fetch_and_add(&next, 1) % runqs.size());
   }
-    
+
+  runqs[worker]->enqueue(process);
+
   // Wake up the processing thread if necessary.
   gate->open();
 }
 
 
-ProcessBase* ProcessManager::dequeue()
+ProcessBase* ProcessManager::dequeue(int worker)
 {
-  // TODO(benh): Remove a process from this thread's runq. If there
-  // are no processes to run, and this is not a dedicated thread, then
-  // steal one from another threads runq.
+  // Increment the running count of processes before attempting the
+  // dequeue in order to support the Clock::settle() operation (if we
+  // incremented after dequeueing then settle might observe an empty
+  // run queue while a dequeued process has yet to be counted).
+  __sync_fetch_and_add(&running, 1);
 
   ProcessBase* process = NULL;
 
-  synchronized (runq) {
-    if (!runq.empty()) {
-      process = runq.front();
-      runq.pop_front();
-      // Increment the running count of processes in order to support
-      // the Clock::settle() operation (this must be done atomically
-      // with removing the process from the runq).
-      __sync_fetch_and_add(&running, 1);
+  // Check our own queue first and only steal from our peers when we
+  // have nothing of our own to run (i.e., under imbalance).
+  const int workers = (int) runqs.size();
+  const int start = worker >= 0 ? worker : 0;
+
+  int source = -1;
+
+  for (int i = 0; process == NULL && i < workers; i++) {
+    source = (start + i) % workers;
+    process = runqs[source]->dequeue();
+  }
+
+  if (process != NULL) {
+    if (worker >= 0) {
+      counters[worker].resumes++;
+      if (source != worker) {
+        counters[worker].steals++;
+      }
+      if (process->worker >= 0 && process->worker != worker) {
+        counters[worker].migrations++;
+      }
     }
+
+    // Remember where the process ran for affinity (a donated thread
+    // passes -1 which sends the process back to the round-robin).
+    process->worker = worker;
+  } else {
+    __sync_fetch_and_sub(&running, 1);
   }
 
   return process;
@@ -2723,86 +4896,238 @@ void ProcessManager::settle()
   do {
     os::sleep(Milliseconds(10));
     done = true;
-    // Hopefully this is the only place we acquire both these locks.
-    synchronized (runq) {
-      synchronized (timeouts) {
-        CHECK(Clock::paused()); // Since another thread could resume the clock!
+    synchronized (timeouts) {
+      CHECK(Clock::paused()); // Since another thread could resume the clock!
 
-        if (!runq.empty()) {
+      for (size_t i = 0; i < runqs.size(); i++) {
+        if (!runqs[i]->empty()) {
           done = false;
         }
+      }
+
+      __sync_synchronize(); // Read barrier for 'running'.
+      if (running > 0) {
+        done = false;
+      }
+
+      if (!timeouts->empty() && timeouts->next() <= clock::current) {
+        done = false;
+      }
+
+      if (pending_timers) {
+        done = false;
+      }
+    }
+  } while (!done);
+}
+
+
+Timer Timer::create(
+    const Duration& duration,
+    const lambda::function<void(void)>& thunk)
+{
+  static uint64_t id = 1; // Start at 1 since Timer() instances start with 0.
+
+  Timeout timeout(duration); // Assumes Clock::now() does Clock::now(__process__).
+
+  UPID pid = __process__ != NULL ? __process__->self() : UPID();
+
+  Timer timer(__sync_fetch_and_add(&id, 1), timeout, pid, thunk);
+
+  VLOG(3) << "Created a timer for " << doublePrecision << timeout.value();
+
+  // Add the timer.
+  synchronized (timeouts) {
+    if (timeouts->empty() || timer.timeout().value() < timeouts->next()) {
+      // Need to interrupt the loop to update/set timer repeat.
+      timeouts->add(timer);
+      update_timer = true;
+      ev_async_send(loop, &async_watchers[0]);
+    } else {
+      // Timer repeat is adequate, just add the timeout.
+      timeouts->add(timer);
+    }
+  }
+
+  return timer;
+}
+
+
+bool Timer::cancel(const Timer& timer)
+{
+  bool canceled = false;
+  synchronized (timeouts) {
+    // Check if the timer is still pending, and if so, remove it (the
+    // wheel compares timer identity, so another timer that happens to
+    // share the timeout is left alone).
+    canceled = timeouts->cancel(timer);
+  }
+
+  return canceled;
+}
+
+
+WorkerPool::WorkerPool(size_t _threads, size_t _capacity)
+  : capacity(_capacity), done(false)
+{
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&condition, NULL);
+
+  for (size_t i = 0; i < _threads; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, &WorkerPool::worker, this) != 0) {
+      LOG(FATAL) << "Failed to create a worker pool thread";
+    }
+    threads.push_back(thread);
+  }
+}
+
+
+WorkerPool::~WorkerPool()
+{
+  pthread_mutex_lock(&mutex);
+  {
+    done = true;
+    pthread_cond_broadcast(&condition);
+  }
+  pthread_mutex_unlock(&mutex);
+
+  for (size_t i = 0; i < threads.size(); i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&condition);
+  pthread_mutex_destroy(&mutex);
+}
+
+
+bool WorkerPool::submit(
+    const std::tr1::function<void(void)>& work,
+    Priority priority)
+{
+  bool accepted = false;
+
+  pthread_mutex_lock(&mutex);
+  {
+    size_t depth = queues[HIGH].size() + queues[LOW].size();
+    if (!done && depth < capacity) {
+      queues[priority].push_back(work);
+      accepted = true;
+      totals.submitted++;
+      if (depth + 1 > totals.watermark) {
+        totals.watermark = depth + 1;
+      }
+      pthread_cond_signal(&condition);
+    } else {
+      totals.rejected++;
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+
+  return accepted;
+}
+
+
+WorkerPool::Stats WorkerPool::stats()
+{
+  Stats snapshot;
+
+  pthread_mutex_lock(&mutex);
+  {
+    snapshot = totals;
+    snapshot.depth = queues[HIGH].size() + queues[LOW].size();
+  }
+  pthread_mutex_unlock(&mutex);
+
+  return snapshot;
+}
+
+
+void* WorkerPool::worker(void* arg)
+{
+  static_cast<WorkerPool*>(arg)->run();
+  return NULL;
+}
 
-        __sync_synchronize(); // Read barrier for 'running'.
-        if (running > 0) {
-          done = false;
-        }
 
-        if (timeouts->size() > 0 &&
-            timeouts->begin()->first <= clock::current) {
-          done = false;
-        }
+void WorkerPool::run()
+{
+  pthread_mutex_lock(&mutex);
 
-        if (pending_timers) {
-          done = false;
-        }
-      }
+  while (true) {
+    while (!done && queues[HIGH].empty() && queues[LOW].empty()) {
+      pthread_cond_wait(&condition, &mutex);
     }
-  } while (!done);
-}
 
+    if (done) {
+      break;
+    }
 
-Timer Timer::create(
-    const Duration& duration,
-    const lambda::function<void(void)>& thunk)
-{
-  static uint64_t id = 1; // Start at 1 since Timer() instances start with 0.
+    std::deque<std::tr1::function<void(void)> >& queue =
+      !queues[HIGH].empty() ? queues[HIGH] : queues[LOW];
 
-  Timeout timeout(duration); // Assumes Clock::now() does Clock::now(__process__).
+    std::tr1::function<void(void)> work = queue.front();
+    queue.pop_front();
 
-  UPID pid = __process__ != NULL ? __process__->self() : UPID();
+    pthread_mutex_unlock(&mutex);
 
-  Timer timer(__sync_fetch_and_add(&id, 1), timeout, pid, thunk);
+    // Busy time on the monotonic clock so a system time adjustment
+    // can't skew it (as with the per-process stats).
+    double start = Clock::monotonic();
+    work();
+    double elapsed = Clock::monotonic() - start;
 
-  VLOG(3) << "Created a timer for " << doublePrecision << timeout.value();
+    pthread_mutex_lock(&mutex);
 
-  // Add the timer.
-  synchronized (timeouts) {
-    if (timeouts->size() == 0 ||
-        timer.timeout().value() < timeouts->begin()->first) {
-      // Need to interrupt the loop to update/set timer repeat.
-      (*timeouts)[timer.timeout().value()].push_back(timer);
-      update_timer = true;
-      ev_async_send(loop, &async_watcher);
-    } else {
-      // Timer repeat is adequate, just add the timeout.
-      CHECK(timeouts->size() >= 1);
-      (*timeouts)[timer.timeout().value()].push_back(timer);
-    }
+    totals.executed++;
+    totals.busy += elapsed;
   }
 
-  return timer;
+  pthread_mutex_unlock(&mutex);
 }
 
 
-bool Timer::cancel(const Timer& timer)
+// The process-wide worker pool, created on first use (see
+// WorkerPool::instance); intentionally never deleted.
+static WorkerPool* worker_pool = NULL;
+
+
+static void initialize_worker_pool()
 {
-  bool canceled = false;
-  synchronized (timeouts) {
-    // Check if the timeout is still pending, and if so, erase it. In
-    // addition, erase an empty list if we just removed the last
-    // timeout.
-    // TODO(benh): If two timers are created with the same timeout,
-    // this will erase *both*. Fix this!
-    if (timeouts->count(timer.timeout().value()) > 0) {
-      canceled = true;
-      (*timeouts)[timer.timeout().value()].remove(timer);
-      if ((*timeouts)[timer.timeout().value()].empty()) {
-        timeouts->erase(timer.timeout().value());
-      }
+  // Check environment for the number of pool threads and the
+  // submission queue bound.
+  size_t threads = 4;
+  size_t capacity = 4096;
+
+  char* value = getenv("LIBPROCESS_ASYNC_THREADS");
+  if (value != NULL) {
+    int result = atoi(value);
+    if (result < 1 || result > 1024) {
+      LOG(FATAL) << "LIBPROCESS_ASYNC_THREADS=" << value
+                 << " is not a valid number of worker pool threads";
     }
+    threads = result;
   }
 
-  return canceled;
+  value = getenv("LIBPROCESS_ASYNC_CAPACITY");
+  if (value != NULL) {
+    long result = atol(value);
+    if (result <= 0) {
+      LOG(FATAL) << "LIBPROCESS_ASYNC_CAPACITY=" << value
+                 << " is not a valid worker pool queue bound";
+    }
+    capacity = result;
+  }
+
+  worker_pool = new WorkerPool(threads, capacity);
+}
+
+
+WorkerPool* WorkerPool::instance()
+{
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, &initialize_worker_pool);
+  return worker_pool;
 }
 
 
@@ -2819,6 +5144,12 @@ ProcessBase::ProcessBase(const string& id)
   pthread_mutexattr_destroy(&attr);
 
   refs = 0;
+  worker = -1;
+
+  manage = false;
+
+  backlog = 0;
+  warned = 0;
 
   pid.id = id != "" ? id : ID::generate();
   pid.ip = __ip__;
@@ -2848,28 +5179,49 @@ void ProcessBase::enqueue(Event* event, bool inject)
 {
   CHECK(event != NULL);
 
-  lock();
-  {
-    if (state != TERMINATING && state != TERMINATED) {
-      if (!inject) {
-        events.push_back(event);
-      } else {
-        events.push_front(event);
-      }
+  event->enqueued = Clock::now();
 
-      if (state == BLOCKED) {
-        state = READY;
-        process_manager->enqueue(this);
-      }
+  // Drop events for terminating processes. An event pushed
+  // concurrently with termination can slip past this check, but
+  // every producer holds a process reference (or is the process
+  // itself), so ProcessManager::cleanup can reliably reclaim such
+  // stragglers with a final drain once the reference count is zero.
+  if (state == TERMINATING || state == TERMINATED) {
+    destroy(event);
+    return;
+  }
 
-      CHECK(state == BOTTOM ||
-            state == READY ||
-            state == RUNNING);
-    } else {
-      delete event;
-    }
+  // Injected events always jump to the urgent class; everything else
+  // gets classified by the process (NOTE: on the enqueuing thread,
+  // see 'classify').
+  size_t depth = mailbox.push(
+      event, inject ? (int) Mailbox::URGENT : classify(*event));
+
+  __sync_fetch_and_add(&stats.enqueued, (uint64_t) 1);
+
+  size_t watermark = stats.watermark;
+  while (depth > watermark &&
+         !__sync_bool_compare_and_swap(&stats.watermark, watermark, depth)) {
+    watermark = stats.watermark;
+  }
+
+  // Wake the process if it went idle; the compare-and-swap means at
+  // most one producer (or the consumer itself, see
+  // ProcessManager::resume) performs the transition, so the process
+  // can't get scheduled twice. The push above is a full barrier, so
+  // if the consumer blocked before it we observe BLOCKED here, and if
+  // it blocked after it will have observed our push and un-blocked
+  // itself.
+  if (state == BLOCKED &&
+      __sync_bool_compare_and_swap(&state, BLOCKED, READY)) {
+    process_manager->enqueue(this);
+  }
+
+  if (backlog > 0 && depth >= backlog && warned == 0 &&
+      __sync_bool_compare_and_swap(&warned, 0, 1)) {
+    // NOTE: Invoked from the enqueueing thread, see 'backlogged'.
+    backlogged(depth);
   }
-  unlock();
 }
 
 
@@ -2895,8 +5247,30 @@ void ProcessBase::send(const UPID& to, const string& name, const char* data, siz
 }
 
 
+Future<Nothing> ProcessBase::send(
+    const UPID& to,
+    const string& name,
+    const string& data,
+    bool expendable)
+{
+  if (!to) {
+    return Nothing();
+  }
+
+  // Encode and transport outgoing message, subject to flow control.
+  return transport(encode(pid, to, name, data), expendable, this);
+}
+
+
 void ProcessBase::visit(const MessageEvent& event)
 {
+  trace::record(
+      event.message->correlation, pid.id, "recv " + event.message->name);
+
+  // Make the correlation id ambient for the duration of the handler
+  // so that sends from within it join this trace.
+  trace::ring()->current = event.message->correlation;
+
   if (handlers.message.count(event.message->name) > 0) {
     handlers.message[event.message->name](
         event.message->from,
@@ -2917,6 +5291,24 @@ void ProcessBase::visit(const DispatchEvent& event)
 }
 
 
+namespace internal {
+
+// Records the completion of a request against the route's stats (see
+// HttpRouter::Stats). Invoked from whichever thread completes the
+// response, potentially after the owning process is gone, hence the
+// shared stats and the atomic increment.
+void completed(
+    const std::tr1::shared_ptr<HttpRouter::Stats>& stats,
+    double start,
+    const Future<Response>&)
+{
+  __sync_add_and_fetch(
+      &stats->latencies[bucket(Clock::monotonic() - start)], 1);
+}
+
+} // namespace internal {
+
+
 void ProcessBase::visit(const HttpEvent& event)
 {
   VLOG(1) << "Handling HTTP event for process '" << pid.id << "'"
@@ -2924,14 +5316,26 @@ void ProcessBase::visit(const HttpEvent& event)
 
   CHECK(event.request->path.find('/') == 0); // See ProcessManager::handle.
 
-  // Split the path by '/'.
-  vector<string> tokens = strings::tokenize(event.request->path, "/");
-  CHECK(tokens.size() >= 1);
-  CHECK(tokens[0] == pid.id);
+  strings::Tokenizer tokenizer(event.request->path, "/");
+  const char* data;
+  size_t length;
+
+  CHECK(tokenizer.next(&data, &length));
+  CHECK(pid.id.compare(0, pid.id.size(), data, length) == 0);
+
+  // The remaining path segments, used for route matching.
+  std::vector<string> segments;
+  while (tokenizer.next(&data, &length)) {
+    segments.push_back(string(data, length));
+  }
+
+  HttpRouter::Node* node = handlers.http.match(segments);
+
+  const string& name = segments.empty() ? "" : segments[0];
 
-  const string& name = tokens.size() > 1 ? tokens[1] : "";
+  if (node != NULL) {
+    __sync_add_and_fetch(&node->stats->requests, 1);
 
-  if (handlers.http.count(name) > 0) {
     // Create the promise to link with whatever gets returned, as well
     // as a future to wait for the response.
     std::tr1::shared_ptr<Promise<Response> > promise(
@@ -2945,16 +5349,22 @@ void ProcessBase::visit(const HttpEvent& event)
     // Let the HttpProxy know about this request (via the future).
     dispatch(proxy, &HttpProxy::handle, future, *event.request);
 
-    // Now call the handler and associate the response with the promise.
-    promise->associate(handlers.http[name](*event.request));
+    // Now call the handler and associate the response with the
+    // promise, recording the completion latency of the response.
+    Future<Response> response = node->handler(*event.request);
+
+    response.onAny(lambda::bind(
+        &internal::completed, node->stats, Clock::monotonic(), lambda::_1));
+
+    promise->associate(response);
   } else if (assets.count(name) > 0) {
     OK response;
     response.type = Response::PATH;
     response.path = assets[name].path;
 
-    // Construct the final path by appending remaining tokens.
-    for (int i = 2; i < tokens.size(); i++) {
-      response.path += "/" + tokens[i];
+    // Construct the final path by appending the remaining segments.
+    for (size_t i = 1; i < segments.size(); i++) {
+      response.path += "/" + segments[i];
     }
 
     // Try and determine the Content-Type from an extension.
@@ -3004,13 +5414,13 @@ void ProcessBase::visit(const TerminateEvent& event)
 }
 
 
-UPID ProcessBase::link(const UPID& to)
+UPID ProcessBase::link(const UPID& to, const SocketOptions& options)
 {
   if (!to) {
     return to;
   }
 
-  process_manager->link(this, to);
+  process_manager->link(this, to, options);
 
   return to;
 }
@@ -3138,6 +5548,23 @@ void post(const UPID& to, const string& name, const char* data, size_t length)
 }
 
 
+void post(const UPID& from,
+          const UPID& to,
+          const string& name,
+          const char* data,
+          size_t length)
+{
+  process::initialize();
+
+  if (!to) {
+    return;
+  }
+
+  // Encode and transport outgoing message.
+  transport(encode(from, to, name, string(data, length)));
+}
+
+
 namespace io {
 
 namespace internal {
@@ -3177,6 +5604,73 @@ void read(int fd,
   }
 }
 
+void readv(int fd,
+           const struct iovec* iov,
+           int iovcnt,
+           const std::tr1::shared_ptr<Promise<size_t> >& promise,
+           const Future<short>& future)
+{
+  // Ignore this function if the read operation has been cancelled.
+  if (promise->future().isDiscarded()) {
+    return;
+  }
+
+  CHECK(!future.isDiscarded());
+
+  if (future.isFailed()) {
+    promise->fail(future.failure());
+  } else {
+    ssize_t length = ::readv(fd, iov, iovcnt);
+    if (length < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Restart the read operation.
+        poll(fd, process::io::READ).onAny(
+            lambda::bind(
+                &internal::readv, fd, iov, iovcnt, promise, lambda::_1));
+      } else {
+        // Error occurred.
+        promise->fail(strerror(errno));
+      }
+    } else {
+      promise->set(length);
+    }
+  }
+}
+
+
+void writev(int fd,
+            const struct iovec* iov,
+            int iovcnt,
+            const std::tr1::shared_ptr<Promise<size_t> >& promise,
+            const Future<short>& future)
+{
+  // Ignore this function if the write operation has been cancelled.
+  if (promise->future().isDiscarded()) {
+    return;
+  }
+
+  CHECK(!future.isDiscarded());
+
+  if (future.isFailed()) {
+    promise->fail(future.failure());
+  } else {
+    ssize_t length = ::writev(fd, iov, iovcnt);
+    if (length < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Restart the write operation.
+        poll(fd, process::io::WRITE).onAny(
+            lambda::bind(
+                &internal::writev, fd, iov, iovcnt, promise, lambda::_1));
+      } else {
+        // Error occurred.
+        promise->fail(strerror(errno));
+      }
+    } else {
+      promise->set(length);
+    }
+  }
+}
+
 } // namespace internal {
 
 
@@ -3196,13 +5690,8 @@ Future<short> poll(int fd, short events)
 
   ev_io_init(watcher, polled, fd, events);
 
-  // Enqueue the watcher.
-  synchronized (watchers) {
-    watchers->push(watcher);
-  }
-
-  // Interrupt the loop.
-  ev_async_send(loop, &async_watcher);
+  // Enqueue the watcher with the loop responsible for the descriptor.
+  start_watcher(watcher);
 
   return future;
 }
@@ -3243,6 +5732,68 @@ Future<size_t> read(int fd, void* data, size_t size)
   return promise->future();
 }
 
+
+Future<size_t> readv(int fd, const struct iovec* iov, int iovcnt)
+{
+  process::initialize();
+
+  std::tr1::shared_ptr<Promise<size_t> > promise(new Promise<size_t>());
+
+  // Check the file descriptor.
+  Try<bool> nonblock = os::isNonblock(fd);
+  if (nonblock.isError()) {
+    // The file descriptor is not valid (e.g. fd has been closed).
+    promise->fail(strerror(errno));
+    return promise->future();
+  } else if (!nonblock.get()) {
+    // The fd is not opened with O_NONBLOCK set.
+    promise->fail("Please use a fd opened with O_NONBLOCK set");
+    return promise->future();
+  }
+
+  if (iovcnt <= 0) {
+    promise->fail("Try to read nothing");
+    return promise->future();
+  }
+
+  // Because the file descriptor is non-blocking, we call readv()
+  // immediately (see the comment in read() above).
+  internal::readv(fd, iov, iovcnt, promise, io::READ);
+
+  return promise->future();
+}
+
+
+Future<size_t> writev(int fd, const struct iovec* iov, int iovcnt)
+{
+  process::initialize();
+
+  std::tr1::shared_ptr<Promise<size_t> > promise(new Promise<size_t>());
+
+  // Check the file descriptor.
+  Try<bool> nonblock = os::isNonblock(fd);
+  if (nonblock.isError()) {
+    // The file descriptor is not valid (e.g. fd has been closed).
+    promise->fail(strerror(errno));
+    return promise->future();
+  } else if (!nonblock.get()) {
+    // The fd is not opened with O_NONBLOCK set.
+    promise->fail("Please use a fd opened with O_NONBLOCK set");
+    return promise->future();
+  }
+
+  if (iovcnt <= 0) {
+    promise->fail("Try to write nothing");
+    return promise->future();
+  }
+
+  // Because the file descriptor is non-blocking, we call writev()
+  // immediately (see the comment in read() above).
+  internal::writev(fd, iov, iovcnt, promise, io::WRITE);
+
+  return promise->future();
+}
+
 namespace internal {
 
 #if __cplusplus >= 201103L
@@ -3313,97 +5864,154 @@ Future<string> read(int fd)
 }
 
 
-} // namespace io {
+namespace internal {
 
+struct BufferedReaderData
+{
+  explicit BufferedReaderData(int _fd) : fd(_fd), offset(0), length(0) {}
 
-namespace http {
+  int fd;
+
+  // Readahead buffer; [offset, length) is the data not yet handed out.
+  boost::shared_array<char> buffer;
+  size_t offset;
+  size_t length;
+};
 
-namespace internal {
 
-Future<Response> decode(const string& buffer)
+// Hands out a slice of the buffered data (some data must be buffered).
+Slice slice(
+    const std::tr1::shared_ptr<BufferedReaderData>& data,
+    size_t limit)
 {
-  ResponseDecoder decoder;
-  deque<Response*> responses = decoder.decode(buffer.c_str(), buffer.length());
+  size_t available = data->length - data->offset;
+  size_t size = (limit == 0 || limit > available) ? available : limit;
+  Slice result(data->buffer, data->offset, size);
+  data->offset += size;
+  return result;
+}
 
-  if (decoder.failed() || responses.empty()) {
-    for (size_t i = 0; i < responses.size(); ++i) {
-      delete responses[i];
-    }
-    return Future<Response>::failed(
-        "Failed to decode HTTP response:\n" + buffer + "\n");
-  } else if (responses.size() > 1) {
-    PLOG(ERROR) << "Received more than 1 HTTP Response";
-  }
 
-  Response response = *responses[0];
-  for (size_t i = 0; i < responses.size(); ++i) {
-    delete responses[i];
+// Continuation after refilling the readahead buffer.
+// TODO(benh): Remove 'const &' from size after fixing libprocess.
+Future<Slice> _buffered(
+    const size_t& size,
+    const std::tr1::shared_ptr<BufferedReaderData>& data,
+    size_t limit)
+{
+  if (size == 0) { // EOF.
+    return Slice();
   }
 
-  return response;
+  data->offset = 0;
+  data->length = size;
+
+  return slice(data, limit);
 }
 
 } // namespace internal {
 
 
-Future<Response> get(const UPID& upid, const string& path, const string& query)
+BufferedReader::BufferedReader(int fd)
+  : data(new internal::BufferedReaderData(fd)) {}
+
+
+Future<Slice> BufferedReader::read(size_t limit)
 {
-  int s = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+  process::initialize();
 
-  if (s < 0) {
-    return Future<Response>::failed(
-        string("Failed to create socket: ") + strerror(errno));
+  if (data->offset < data->length) {
+    // Serve out of the readahead buffer, no round trip necessary.
+    return internal::slice(data, limit);
   }
 
-  Try<Nothing> cloexec = os::cloexec(s);
-  if (!cloexec.isSome()) {
-    return Future<Response>::failed("Failed to cloexec: " + cloexec.error());
-  }
+  // Refill with a fresh buffer so that any slices previously handed
+  // out don't get overwritten by the incoming data (outstanding
+  // slices keep the old buffer alive).
+  data->buffer = boost::shared_array<char>(new char[BUFFERED_READ_SIZE]);
 
-  sockaddr_in addr;
-  memset(&addr, 0, sizeof(addr));
-  addr.sin_family = AF_INET;
-  addr.sin_port = htons(upid.port);
-  addr.sin_addr.s_addr = upid.ip;
+  return io::read(data->fd, data->buffer.get(), BUFFERED_READ_SIZE)
+    .then(lambda::bind(&internal::_buffered, lambda::_1, data, limit));
+}
 
-  if (connect(s, (sockaddr*) &addr, sizeof(addr)) < 0) {
-    return Future<Response>::failed(strerror(errno));
-  }
+} // namespace io {
 
-  std::ostringstream out;
 
-  // TODO(bmahler): Add the Host header for HTTP 1.1.
-  out << "GET /" << upid.id << "/" << path << "?" << query << " HTTP/1.1\r\n"
-      << "Connection: close\r\n"
-      << "\r\n";
+namespace http {
+
+namespace internal {
 
-  // TODO(bmahler): Use benh's async write when it gets committed.
-  const string& data = out.str();
-  int remaining = data.size();
+// Encodes the request line, the headers and the body onto the wire
+// format and hands the request to the client.
+Future<Response> request(
+    const UPID& upid,
+    const string& method,
+    const string& path,
+    const string& query,
+    const string& body,
+    const string& contentType,
+    const Option<Duration>& timeout)
+{
+  process::initialize();
 
-  while (remaining > 0) {
-    int n = write(s, data.data() + (data.size() - remaining), remaining);
+  std::ostringstream out;
 
-    if (n < 0) {
-      if (errno == EINTR) {
-        continue;
-      }
-      return Future<Response>::failed(strerror(errno));
-    }
+  out << method << " /" << upid.id;
 
-    remaining -= n;
+  if (!path.empty()) {
+    out << "/" << path;
   }
 
-  Try<Nothing> nonblock = os::nonblock(s);
-  if (!nonblock.isSome()) {
-    return Future<Response>::failed(
-        "Failed to set nonblock: " + nonblock.error());
+  if (!query.empty()) {
+    out << "?" << query;
+  }
+
+  out << " HTTP/1.1\r\n";
+
+  // The 'Host' header is required for HTTP/1.1.
+  in_addr ip;
+  ip.s_addr = upid.ip;
+  out << "Host: " << inet_ntoa(ip) << ":" << upid.port << "\r\n"
+      << "Connection: keep-alive\r\n";
+
+  if (!contentType.empty()) {
+    out << "Content-Type: " << contentType << "\r\n";
   }
 
-  // Decode once the async read completes.
-  return io::read(s)
-    .then(lambda::bind(&internal::decode, lambda::_1))
-    .onAny(lambda::bind(&os::close, s));
+  out << "Content-Length: " << body.size() << "\r\n"
+      << "\r\n"
+      << body;
+
+  return dispatch(
+      client,
+      &HttpClientProcess::request,
+      Node(upid.ip, upid.port),
+      out.str(),
+      timeout);
+}
+
+} // namespace internal {
+
+
+Future<Response> get(
+    const UPID& upid,
+    const string& path,
+    const string& query,
+    const Option<Duration>& timeout)
+{
+  return internal::request(upid, "GET", path, query, "", "", timeout);
+}
+
+
+Future<Response> post(
+    const UPID& upid,
+    const string& path,
+    const string& body,
+    const string& contentType,
+    const Option<Duration>& timeout)
+{
+  return internal::request(
+      upid, "POST", path, "", body, contentType, timeout);
 }
 
 }  // namespace http {
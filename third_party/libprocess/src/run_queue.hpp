@@ -0,0 +1,168 @@
+#ifndef RUN_QUEUE_HPP
+#define RUN_QUEUE_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <list>
+
+#include "synchronized.hpp"
+
+namespace process {
+
+class ProcessBase;
+
+// A multiple-producer multiple-consumer queue of runnable processes
+// where the common case (enqueueing and dequeueing through a bounded
+// ring buffer) is lock-free. Producers and consumers synchronize via
+// a per-slot sequence number (the usual bounded MPMC scheme) using
+// gcc's atomic builtins, so enqueueing a process from the event loop
+// never blocks behind the worker threads. In the unlikely event that
+// the ring fills up we spill to a list protected by a lock so that
+// enqueue never fails.
+//
+// Order is FIFO through the ring; spilled processes only get run
+// once the ring has drained, which is acceptable since the scheduler
+// makes no strict fairness guarantees.
+class RunQueue
+{
+public:
+  explicit RunQueue(size_t size = 16384)
+  {
+    // Round up to a power of 2 so we can mask rather than mod.
+    capacity = 1;
+    while (capacity < size) {
+      capacity <<= 1;
+    }
+
+    slots = new Slot[capacity];
+
+    for (size_t i = 0; i < capacity; i++) {
+      slots[i].sequence = i;
+      slots[i].process = NULL;
+    }
+
+    head = 0;
+    tail = 0;
+    spilled = false;
+
+    synchronizer(overflow) = SYNCHRONIZED_INITIALIZER;
+
+    __sync_synchronize();
+  }
+
+  ~RunQueue()
+  {
+    delete[] slots;
+  }
+
+  void enqueue(ProcessBase* process)
+  {
+    size_t position = tail;
+
+    while (true) {
+      Slot* slot = &slots[position & (capacity - 1)];
+      size_t sequence = slot->sequence;
+      intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+
+      if (difference == 0) {
+        // The slot is free, try and claim it.
+        if (__sync_bool_compare_and_swap(&tail, position, position + 1)) {
+          slot->process = process;
+          __sync_synchronize();
+          slot->sequence = position + 1; // Publish to consumers.
+          return;
+        }
+        position = tail;
+      } else if (difference < 0) {
+        // The ring is full, spill to the overflow list.
+        synchronized (overflow) {
+          overflow.push_back(process);
+          spilled = true;
+        }
+        return;
+      } else {
+        // Another producer claimed this slot, move on to the next.
+        position = tail;
+      }
+    }
+  }
+
+  ProcessBase* dequeue()
+  {
+    size_t position = head;
+
+    while (true) {
+      Slot* slot = &slots[position & (capacity - 1)];
+      size_t sequence = slot->sequence;
+      intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+
+      if (difference == 0) {
+        // The slot is published, try and claim it.
+        if (__sync_bool_compare_and_swap(&head, position, position + 1)) {
+          __sync_synchronize();
+          ProcessBase* process = slot->process;
+          slot->process = NULL;
+          __sync_synchronize();
+          slot->sequence = position + capacity; // Free for producers.
+          return process;
+        }
+        position = head;
+      } else if (difference < 0) {
+        // The ring is empty. (A producer might be in the middle of
+        // publishing the next slot, but missing it here is fine
+        // because every enqueue is followed by opening the
+        // scheduling gate, which wakes up a worker to try again.)
+        break;
+      } else {
+        // Another consumer claimed this slot, move on to the next.
+        position = head;
+      }
+    }
+
+    if (spilled) {
+      synchronized (overflow) {
+        if (!overflow.empty()) {
+          ProcessBase* process = overflow.front();
+          overflow.pop_front();
+          spilled = !overflow.empty();
+          return process;
+        }
+      }
+    }
+
+    return NULL;
+  }
+
+  // Returns true if no processes appear to be enqueued. This is
+  // inherently racy (processes may be enqueued or dequeued
+  // concurrently) and is only intended as a heuristic (e.g., for
+  // ProcessManager::settle).
+  bool empty()
+  {
+    __sync_synchronize();
+    return head == tail && !spilled;
+  }
+
+private:
+  struct Slot
+  {
+    volatile size_t sequence;
+    ProcessBase* process;
+  };
+
+  Slot* slots;
+  size_t capacity; // Always a power of 2.
+
+  volatile size_t head; // Next position to dequeue from.
+  volatile size_t tail; // Next position to enqueue at.
+
+  // Overflow for when the ring is full.
+  std::list<ProcessBase*> overflow;
+  synchronizable(overflow);
+  volatile bool spilled; // True if 'overflow' might be non-empty.
+};
+
+} // namespace process {
+
+#endif // RUN_QUEUE_HPP
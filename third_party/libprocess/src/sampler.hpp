@@ -0,0 +1,228 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+
+#include <stout/duration.hpp>
+#include <stout/error.hpp>
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+namespace process {
+
+// A sampling profiler for the worker threads. Each worker publishes
+// a label describing what it is currently resuming (the process and
+// the event being serviced) into a per-worker slot, and while enabled
+// a background thread wakes up at the sampling frequency and counts
+// the label in each slot. The counts can then be rendered in
+// collapsed stack format ("label count" per line) ready for flame
+// graph tooling, attributing wall clock time to processes and their
+// handlers (e.g., "master;message;mesos.internal.StatusUpdateMessage").
+//
+// Note that we deliberately do NOT use a signal (SIGPROF) based stack
+// sampler: libprocess gets embedded in Java and Python virtual
+// machines where installing signal handlers causes hard to debug
+// crashes (see the comment above process::initialize), so attribution
+// is at process/event granularity rather than stack frames.
+//
+// The publishing path is designed to be cheap and lock free: a slot
+// is a seqlock (version counter odd while mid-write) so the sampling
+// thread can detect and discard torn reads, and workers only publish
+// at all while sampling is enabled.
+class Sampler
+{
+public:
+  explicit Sampler(size_t _workers)
+    : workers(_workers),
+      slots(new Slot[_workers]),
+      enabled(false),
+      interval(0)
+  {
+    pthread_mutex_init(&mutex, NULL);
+    for (size_t i = 0; i < workers; i++) {
+      slots[i].version = 0;
+      slots[i].label[0] = '\0';
+    }
+  }
+
+  ~Sampler()
+  {
+    stop();
+    pthread_mutex_destroy(&mutex);
+    delete[] slots;
+  }
+
+  // Returns whether sampling is currently enabled. Callers publishing
+  // via resumed/idled should check this first to keep the common
+  // (not sampling) case to a single load.
+  bool sampling() const
+  {
+    return enabled;
+  }
+
+  // Publishes the process (and event) the worker is about to service.
+  void resumed(int worker, const char* process, const char* event)
+  {
+    if (worker < 0 || (size_t) worker >= workers) {
+      return;
+    }
+
+    Slot* slot = &slots[worker];
+
+    slot->version++; // Now odd: mid-write.
+    __sync_synchronize();
+
+    size_t length = 0;
+    while (length < sizeof(slot->label) - 1 && process[length] != '\0') {
+      slot->label[length] = process[length];
+      length++;
+    }
+    if (length < sizeof(slot->label) - 1) {
+      slot->label[length++] = ';';
+    }
+    size_t i = 0;
+    while (length < sizeof(slot->label) - 1 && event[i] != '\0') {
+      slot->label[length++] = event[i++];
+    }
+    slot->label[length] = '\0';
+
+    __sync_synchronize();
+    slot->version++; // Even again: stable.
+  }
+
+  // Publishes that the worker has gone idle.
+  void idled(int worker)
+  {
+    if (worker < 0 || (size_t) worker >= workers) {
+      return;
+    }
+
+    Slot* slot = &slots[worker];
+
+    slot->version++;
+    __sync_synchronize();
+    slot->label[0] = '\0';
+    __sync_synchronize();
+    slot->version++;
+  }
+
+  // Starts the sampling thread, clearing any previous samples.
+  Try<Nothing> start(const Duration& _interval)
+  {
+    pthread_mutex_lock(&mutex);
+
+    if (enabled) {
+      pthread_mutex_unlock(&mutex);
+      return Error("Sampler already started");
+    }
+
+    counts.clear();
+    interval = _interval.secs();
+    enabled = true;
+
+    if (pthread_create(&thread, NULL, &Sampler::sample, this) != 0) {
+      enabled = false;
+      pthread_mutex_unlock(&mutex);
+      return Error("Failed to create sampling thread");
+    }
+
+    pthread_mutex_unlock(&mutex);
+    return Nothing();
+  }
+
+  // Stops the sampling thread (the collected samples remain
+  // available). Returns false if sampling was not enabled.
+  bool stop()
+  {
+    pthread_mutex_lock(&mutex);
+    if (!enabled) {
+      pthread_mutex_unlock(&mutex);
+      return false;
+    }
+    enabled = false;
+    pthread_mutex_unlock(&mutex);
+
+    pthread_join(thread, NULL);
+    return true;
+  }
+
+  // Returns the collected samples: collapsed label -> sample count.
+  std::map<std::string, size_t> samples()
+  {
+    pthread_mutex_lock(&mutex);
+    std::map<std::string, size_t> result = counts;
+    pthread_mutex_unlock(&mutex);
+    return result;
+  }
+
+private:
+  // A per-worker published label, seqlock protected. Padded so that
+  // workers don't share cache lines.
+  struct Slot
+  {
+    volatile unsigned long version; // Odd while being written.
+    char label[192];
+    char padding[64];
+  };
+
+  static void* sample(void* arg)
+  {
+    Sampler* sampler = reinterpret_cast<Sampler*>(arg);
+
+    while (sampler->enabled) {
+      struct timespec ts;
+      ts.tv_sec = (time_t) sampler->interval;
+      ts.tv_nsec = (long) ((sampler->interval - ts.tv_sec) * 1e9);
+      nanosleep(&ts, NULL);
+
+      for (size_t i = 0; i < sampler->workers; i++) {
+        Slot* slot = &sampler->slots[i];
+
+        // Seqlock read: discard the sample if a write was in progress
+        // or occurred while we were copying.
+        unsigned long before = slot->version;
+        if (before & 1) {
+          continue;
+        }
+        __sync_synchronize();
+
+        char label[sizeof(slot->label)];
+        memcpy(label, slot->label, sizeof(label));
+        label[sizeof(label) - 1] = '\0';
+
+        __sync_synchronize();
+        if (slot->version != before || label[0] == '\0') {
+          continue; // Torn read or idle worker.
+        }
+
+        pthread_mutex_lock(&sampler->mutex);
+        sampler->counts[label]++;
+        pthread_mutex_unlock(&sampler->mutex);
+      }
+    }
+
+    return NULL;
+  }
+
+  const size_t workers;
+
+  Slot* slots;
+
+  volatile bool enabled;
+  double interval; // Seconds between samples.
+
+  pthread_t thread; // Sampling thread (valid while enabled).
+
+  // Protects 'counts' (and start/stop transitions).
+  pthread_mutex_t mutex;
+  std::map<std::string, size_t> counts;
+};
+
+} // namespace process {
+
+#endif // SAMPLER_HPP
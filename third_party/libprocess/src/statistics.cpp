@@ -1,4 +1,5 @@
 #include <float.h> // For DBL_MAX.
+#include <math.h>  // For floor.
 
 #include <glog/logging.h>
 
@@ -42,23 +43,200 @@ namespace process {
 // This is initialized by process::initialize().
 Statistics* statistics = NULL;
 
-// TODO(bmahler): Move time series related logic into this struct.
-// TODO(bmahler): Investigate using google's btree implementation.
-// This provides better insertion and lookup performance for large
-// containers. This _should_ also provide significant memory
-// savings, especially since:
-//   1. Our insertion order will mostly be in sorted order.
-//   2. Our keys (Seconds) have efficient comparison operators.
-// See: http://code.google.com/p/cpp-btree/
-//      http://code.google.com/p/cpp-btree/wiki/UsageInstructions
+// A single time series value.
+struct Sample
+{
+  Sample() : time(0.0), value(0.0) {}
+  Sample(const Seconds& _time, double _value) : time(_time), value(_value) {}
+
+  Seconds time;
+  double value;
+};
+
+
+// A fixed capacity circular buffer of samples. Pushing onto a full
+// ring overwrites the oldest sample, so memory per series stays
+// bounded regardless of the sampling rate (and inserting a sample
+// never allocates).
+class Ring
+{
+public:
+  explicit Ring(size_t capacity)
+    : samples(capacity), start(0), count(0) {}
+
+  bool empty() const { return count == 0; }
+
+  size_t size() const { return count; }
+
+  // Returns the i'th sample, oldest first.
+  const Sample& at(size_t i) const
+  {
+    return samples[(start + i) % samples.size()];
+  }
+
+  const Sample& oldest() const { return at(0); }
+  const Sample& latest() const { return at(count - 1); }
+
+  void push(const Sample& sample)
+  {
+    if (count == samples.size()) {
+      samples[start] = sample;
+      start = (start + 1) % samples.size();
+    } else {
+      samples[(start + count) % samples.size()] = sample;
+      count++;
+    }
+  }
+
+  // Drops samples from before 'time', but keeps at least 'keep'
+  // samples regardless of their age.
+  void expire(double time, size_t keep)
+  {
+    while (count > keep && oldest().time.secs() < time) {
+      start = (start + 1) % samples.size();
+      count--;
+    }
+  }
+
+private:
+  std::vector<Sample> samples;
+  size_t start; // Index of the oldest sample.
+  size_t count;
+};
+
+
+// A downsampling tier: samples falling within each fixed period get
+// folded into their average, and each completed period is pushed onto
+// a ring of aggregates.
+struct Tier
+{
+  Tier(const Duration& _period, size_t capacity)
+    : ring(capacity), period(_period), start(-1.0), sum(0.0), count(0) {}
+
+  void update(const Sample& sample)
+  {
+    double aligned = floor(sample.time.secs() / period.secs()) * period.secs();
+
+    // A sample from a later period completes the accumulating one.
+    if (count > 0 && aligned > start) {
+      ring.push(Sample(Seconds(start), sum / count));
+      count = 0;
+    }
+
+    if (count == 0) {
+      start = aligned;
+      sum = 0.0;
+    }
+
+    sum += sample.value;
+    count++;
+  }
+
+  Ring ring;
+
+  const Duration period;
+
+  double start; // Start time of the accumulating period, or -1.
+  double sum;   // Sum of the samples in the accumulating period.
+  size_t count; // Number of samples in the accumulating period.
+};
+
+
+// Per tier capacities: at a 1Hz sampling rate the raw tier covers the
+// last minute or so, the 10 second averages cover the last hour, and
+// the 1 minute averages cover the last day, all in fixed memory
+// (under 32KB per series).
+const size_t RAW_CAPACITY = 64;
+const size_t TEN_SECOND_CAPACITY = 360;
+const size_t ONE_MINUTE_CAPACITY = 1440;
+
+
+// Bounded storage for a statistic's time series: recent samples are
+// kept raw while older samples are only retained downsampled (as 10
+// second and then 1 minute averages). Each tier is a ring buffer, so
+// a series occupies a fixed footprint no matter how long or how fast
+// it is updated.
 struct TimeSeries
 {
-  TimeSeries() : values(), archived(false) {}
+  TimeSeries()
+    : raw(RAW_CAPACITY),
+      tenSeconds(Seconds(10.0), TEN_SECOND_CAPACITY),
+      oneMinute(Minutes(1.0), ONE_MINUTE_CAPACITY),
+      archived(false) {}
+
+  bool empty() const { return raw.empty(); }
+
+  // Returns the most recent sample (only valid when not empty).
+  const Sample& latest() const { return raw.latest(); }
+
+  void set(double value, const Seconds& time)
+  {
+    Sample sample(time, value);
+    raw.push(sample);
+    tenSeconds.update(sample);
+    oneMinute.update(sample);
+    archived = false;
+  }
+
+  // Returns the samples with times in [start, stop], in sorted order.
+  // Each coarser tier only contributes history from before the next
+  // finer tier begins, so a period is never reported twice.
+  map<Seconds, double> window(
+      const Option<Seconds>& start,
+      const Option<Seconds>& stop) const
+  {
+    double lower = start.isSome() ? start.get().secs() : 0.0;
+    double upper = stop.isSome() ? stop.get().secs() : DBL_MAX;
+
+    map<Seconds, double> result;
+
+    double rawStart = raw.empty() ? DBL_MAX : raw.oldest().time.secs();
+    double tenSecondStart = tenSeconds.ring.empty()
+      ? rawStart
+      : std::min(rawStart, tenSeconds.ring.oldest().time.secs());
+
+    append(result, oneMinute.ring, lower, upper, tenSecondStart);
+    append(result, tenSeconds.ring, lower, upper, rawStart);
+    append(result, raw, lower, upper, DBL_MAX);
+
+    return result;
+  }
+
+  // Drops samples that fell out of the window (i.e., from before
+  // 'expiry'). We always keep the latest raw sample for a statistic,
+  // unless it is archived! Returns true iff the series is empty.
+  bool truncate(double expiry)
+  {
+    oneMinute.ring.expire(expiry, 0);
+    tenSeconds.ring.expire(expiry, 0);
+    raw.expire(expiry, archived ? 0 : 1);
+    return raw.empty();
+  }
 
-  // We use a map instead of a hashmap to store the values because
-  // that way we can retrieve a series in sorted order efficiently.
-  map<Seconds, double> values;
   bool archived;
+
+private:
+  // Appends the samples in the ring with times in [lower, upper] that
+  // are also older than 'before'.
+  static void append(
+      map<Seconds, double>& result,
+      const Ring& ring,
+      double lower,
+      double upper,
+      double before)
+  {
+    for (size_t i = 0; i < ring.size(); i++) {
+      const Sample& sample = ring.at(i);
+      double time = sample.time.secs();
+      if (time >= lower && time <= upper && time < before) {
+        result[sample.time] = sample.value;
+      }
+    }
+  }
+
+  Ring raw;        // Raw samples.
+  Tier tenSeconds; // 10 second averages.
+  Tier oneMinute;  // 1 minute averages.
 };
 
 
@@ -178,16 +356,7 @@ map<Seconds, double> StatisticsProcess::timeseries(
     return map<Seconds, double>();
   }
 
-  const std::map<Seconds, double>& values =
-    statistics[context].find(name)->second.values;
-
-  map<Seconds, double>::const_iterator lower =
-    values.lower_bound(start.isSome() ? start.get() : Seconds(0.0));
-
-  map<Seconds, double>::const_iterator upper =
-    values.upper_bound(stop.isSome() ? stop.get() : Seconds(DBL_MAX));
-
-  return map<Seconds, double>(lower, upper);
+  return statistics[context].find(name)->second.window(start, stop);
 }
 
 
@@ -195,10 +364,10 @@ Option<double> StatisticsProcess::get(const string& context, const string& name)
 {
   if (!statistics.contains(context) ||
       !statistics[context].contains(name) ||
-      statistics[context][name].values.empty()) {
+      statistics[context][name].empty()) {
     return Option<double>::none();
   } else {
-    return statistics[context][name].values.rbegin()->second;
+    return statistics[context][name].latest().value;
   }
 }
 
@@ -212,10 +381,8 @@ map<string, double> StatisticsProcess::get(const string& context)
   }
 
   foreachkey (const string& name, statistics[context]) {
-    const map<Seconds, double>& values = statistics[context][name].values;
-
-    if (!values.empty()) {
-      results[name] = values.rbegin()->second;
+    if (!statistics[context][name].empty()) {
+      results[name] = statistics[context][name].latest().value;
     }
   }
 
@@ -229,10 +396,10 @@ void StatisticsProcess::set(
     double value,
     const Seconds& time)
 {
-  statistics[context][name].values[time] = value; // Update the raw value.
-  statistics[context][name].archived = false;     // Unarchive.
-
-  truncate(context, name);
+  // Note that there is no need to truncate here like we used to: the
+  // ring buffers bound memory on their own, and values outside the
+  // window get dropped by the periodic truncation.
+  statistics[context][name].set(value, time); // Update (and unarchive).
 
   // Update the metered values, if necessary.
   if (meters.contains(context) && meters[context].contains(name)) {
@@ -241,8 +408,7 @@ void StatisticsProcess::set(
       statistics[context][meter->name].archived = false; // Unarchive.
 
       if (update.isSome()) {
-        statistics[context][meter->name].values[time] = update.get();
-        truncate(context, meter->name);
+        statistics[context][meter->name].set(update.get(), time);
       }
     }
   }
@@ -267,8 +433,8 @@ void StatisticsProcess::archive(const string& context, const string& name)
 void StatisticsProcess::increment(const string& context, const string& name)
 {
   double value = 0.0;
-  if (!statistics[context][name].values.empty()) {
-    value = statistics[context][name].values.rbegin()->second;
+  if (!statistics[context][name].empty()) {
+    value = statistics[context][name].latest().value;
   }
   set(context, name, value + 1.0, Seconds(Clock::now()));
 }
@@ -277,8 +443,8 @@ void StatisticsProcess::increment(const string& context, const string& name)
 void StatisticsProcess::decrement(const string& context, const string& name)
 {
   double value = 0.0;
-  if (!statistics[context][name].values.empty()) {
-    value = statistics[context][name].values.rbegin()->second;
+  if (!statistics[context][name].empty()) {
+    value = statistics[context][name].latest().value;
   }
   set(context, name, value - 1.0, Seconds(Clock::now()));
 }
@@ -289,27 +455,7 @@ bool StatisticsProcess::truncate(const string& context, const string& name)
   CHECK(statistics.contains(context));
   CHECK(statistics[context].contains(name));
 
-  if (statistics[context][name].values.empty()) {
-    return true; // No truncation is needed, the time series is already empty.
-  }
-
-  map<Seconds, double>::iterator start =
-    statistics[context][name].values.begin();
-
-  while ((Clock::now() - start->first.secs()) > window.secs()) {
-    // Always keep at least one value for a statistic, unless it's archived!
-    if (statistics[context][name].values.size() == 1) {
-      if (statistics[context][name].archived) {
-        statistics[context][name].values.clear();
-      }
-      break;
-    }
-
-    statistics[context][name].values.erase(start);
-    start = statistics[context][name].values.begin();
-  }
-
-  return statistics[context][name].values.empty();
+  return statistics[context][name].truncate(Clock::now() - window.secs());
 }
 
 
@@ -348,7 +494,7 @@ Future<Response> StatisticsProcess::snapshot(const Request& request)
     foreachkey (const string& name, statistics[context]) {
       // Exclude archived and empty time series.
       if (statistics[context][name].archived ||
-          statistics[context][name].values.empty()) {
+          statistics[context][name].empty()) {
         continue;
       }
 
@@ -362,10 +508,8 @@ Future<Response> StatisticsProcess::snapshot(const Request& request)
       JSON::Object object;
       object.values["context"] = context;
       object.values["name"] = name;
-      object.values["time"] =
-        statistics[context][name].values.rbegin()->first.secs();
-      object.values["value"] =
-        statistics[context][name].values.rbegin()->second;
+      object.values["time"] = statistics[context][name].latest().time.secs();
+      object.values["value"] = statistics[context][name].latest().value;
       array.values.push_back(object);
     }
   }
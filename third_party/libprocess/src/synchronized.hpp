@@ -1,3 +1,6 @@
+#ifndef SYNCHRONIZED_HPP
+#define SYNCHRONIZED_HPP
+
 #include <pthread.h>
 
 #include <iostream>
@@ -102,3 +105,5 @@ private:
 #define SYNCHRONIZED_INITIALIZER Synchronizable(PTHREAD_MUTEX_NORMAL)
 #define SYNCHRONIZED_INITIALIZER_DEBUG Synchronizable(PTHREAD_MUTEX_ERRORCHECK)
 #define SYNCHRONIZED_INITIALIZER_RECURSIVE Synchronizable(PTHREAD_MUTEX_RECURSIVE)
+
+#endif // SYNCHRONIZED_HPP
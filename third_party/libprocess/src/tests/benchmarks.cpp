@@ -0,0 +1,286 @@
+// Benchmarks for the libprocess hot paths: local dispatching, remote
+// messaging through the socket layer, future chains and timers. Each
+// benchmark prints a line of the form:
+//
+//   BENCHMARK <name> <operations> ops <seconds> secs <rate>
+//
+// so that runs from different commits can be compared directly (e.g.,
+// saved to a file and diffed/plotted). These are deliberately not
+// part of 'make check' since their numbers are only meaningful on an
+// otherwise idle machine; run the 'benchmarks' binary by hand.
+
+#include <gmock/gmock.h>
+
+#include <stdio.h>
+
+#include <sys/time.h>
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/process.hpp>
+#include <process/timer.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/lambda.hpp>
+#include <stout/strings.hpp>
+
+using namespace process;
+
+using std::string;
+using std::vector;
+
+// Set from main() so the remote benchmark can exec another copy of
+// this binary to act as the server.
+static string program;
+
+
+// Returns the current wall clock time in seconds.
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+
+static void report(
+    const string& name,
+    size_t operations,
+    double elapsed,
+    const string& unit)
+{
+  std::cout << "BENCHMARK " << name << " "
+            << operations << " ops "
+            << std::fixed << std::setprecision(6) << elapsed << " secs "
+            << std::setprecision(0) << (operations / elapsed) << " " << unit
+            << std::endl;
+}
+
+
+class BenchmarkProcess : public Process<BenchmarkProcess>
+{
+public:
+  bool task()
+  {
+    return true;
+  }
+};
+
+
+// Measures the round trip of a dispatch: enqueue, resume, service,
+// satisfy the returned future and wake the waiter.
+TEST(Benchmark, DispatchRoundTrip)
+{
+  BenchmarkProcess process;
+  PID<BenchmarkProcess> pid = spawn(&process);
+
+  const size_t operations = 10000;
+
+  double start = now();
+  for (size_t i = 0; i < operations; i++) {
+    ASSERT_TRUE(dispatch(pid, &BenchmarkProcess::task).await());
+  }
+  double elapsed = now() - start;
+
+  report("DispatchRoundTrip", operations, elapsed, "round-trips/sec");
+
+  terminate(process);
+  wait(process);
+}
+
+
+static int increment(const int& i)
+{
+  return i + 1;
+}
+
+
+// Measures the overhead of building and firing a long future chain.
+TEST(Benchmark, FutureChain)
+{
+  const size_t operations = 10000;
+
+  Promise<int> promise;
+  Future<int> future = promise.future();
+
+  double start = now();
+  for (size_t i = 0; i < operations; i++) {
+    future = future.then(lambda::bind(&increment, lambda::_1));
+  }
+  promise.set(0);
+  future.await();
+  double elapsed = now() - start;
+
+  ASSERT_EQ((int) operations, future.get());
+
+  report("FutureChain", operations, elapsed, "links/sec");
+}
+
+
+static void nop() {}
+
+
+// Measures arming and canceling timers, the common fate of timers
+// used for timeouts (e.g., pings, filters) that rarely fire.
+TEST(Benchmark, TimerChurn)
+{
+  const size_t operations = 100000;
+
+  vector<Timer> timers;
+  timers.reserve(operations);
+
+  double start = now();
+  for (size_t i = 0; i < operations; i++) {
+    // Spread the timeouts out like real timers are.
+    timers.push_back(
+        Timer::create(Seconds(10.0 + (i % 1000) / 10.0), &nop));
+  }
+  double created = now() - start;
+
+  report("TimerCreate", operations, created, "timers/sec");
+
+  start = now();
+  for (size_t i = 0; i < operations; i++) {
+    ASSERT_TRUE(Timer::cancel(timers[i]));
+  }
+  double canceled = now() - start;
+
+  report("TimerCancel", operations, canceled, "timers/sec");
+}
+
+
+// The server side of the remote throughput benchmark: echoes every
+// "ping" back to its sender and terminates on "shutdown".
+class EchoProcess : public Process<EchoProcess>
+{
+public:
+  EchoProcess() : ProcessBase("echo") {}
+
+protected:
+  virtual void initialize()
+  {
+    install("ping", &EchoProcess::ping);
+    install("shutdown", &EchoProcess::shutdown);
+  }
+
+private:
+  void ping(const UPID& from, const string& body)
+  {
+    send(from, "pong", body.data(), body.size());
+  }
+
+  void shutdown(const UPID& from, const string& body)
+  {
+    terminate(self());
+  }
+};
+
+
+// The client side: keeps a window of pings outstanding so that the
+// sockets stay busy, and measures until all round trips completed.
+class PingProcess : public Process<PingProcess>
+{
+public:
+  PingProcess(const UPID& _server, size_t _messages, Promise<double>* _promise)
+    : server(_server),
+      messages(_messages),
+      sent(0),
+      received(0),
+      promise(_promise) {}
+
+protected:
+  virtual void initialize()
+  {
+    install("pong", &PingProcess::pong);
+
+    start = now();
+
+    const size_t window = 100;
+    while (sent < messages && sent < window) {
+      send(server, "ping");
+      sent++;
+    }
+  }
+
+private:
+  void pong(const UPID& from, const string& body)
+  {
+    received++;
+    if (sent < messages) {
+      send(server, "ping");
+      sent++;
+    }
+    if (received == messages) {
+      promise->set(now() - start);
+    }
+  }
+
+  const UPID server;
+  const size_t messages;
+  size_t sent;
+  size_t received;
+  double start;
+  Promise<double>* promise;
+};
+
+
+// Measures message round trips between two OS processes, exercising
+// the full encode/socket/decode path in both directions (the server
+// is another copy of this binary, see main below).
+TEST(Benchmark, RemoteThroughput)
+{
+  FILE* server = popen((program + " --server").c_str(), "r");
+  ASSERT_TRUE(server != NULL);
+
+  // The server prints its UPID once it is up.
+  char line[1024];
+  ASSERT_TRUE(fgets(line, sizeof(line), server) != NULL);
+
+  UPID upid(strings::trim(line));
+
+  const size_t messages = 10000;
+
+  Promise<double> promise;
+  Future<double> future = promise.future();
+
+  PingProcess process(upid, messages, &promise);
+  spawn(&process);
+
+  ASSERT_TRUE(future.await(Seconds(60.0)));
+
+  report("RemoteThroughput", messages, future.get(), "round-trips/sec");
+
+  terminate(process);
+  wait(process);
+
+  post(upid, "shutdown");
+  pclose(server);
+}
+
+
+int main(int argc, char** argv)
+{
+  if (argc == 2 && string(argv[1]) == "--server") {
+    // Run as the echo server for the remote throughput benchmark.
+    process::initialize();
+
+    EchoProcess process;
+    UPID pid = spawn(&process);
+
+    std::cout << pid << std::endl;
+
+    wait(pid);
+    return 0;
+  }
+
+  program = argv[0];
+
+  testing::InitGoogleMock(&argc, argv);
+  return RUN_ALL_TESTS();
+}
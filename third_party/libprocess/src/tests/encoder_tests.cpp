@@ -25,8 +25,21 @@ TEST(Encoder, Response)
   Request request;
   const OK& response("body");
 
-  // Encode the response.
-  const string& encoded = HttpResponseEncoder::encode(response, request);
+  // Encode the response, draining the encoder through its iovec
+  // interface (which also verifies nothing gets lost across segment
+  // boundaries, e.g., between the headers and the body).
+  HttpResponseEncoder encoder(response, request);
+
+  string encoded;
+  struct iovec iov[2];
+  int count;
+  while ((count = encoder.next(iov, 2)) > 0) {
+    for (int i = 0; i < count; i++) {
+      encoded.append((const char*) iov[i].iov_base, iov[i].iov_len);
+    }
+  }
+
+  EXPECT_EQ(0, encoder.remaining());
 
   // Now decode it back, and verify the encoding was correct.
   ResponseDecoder decoder;
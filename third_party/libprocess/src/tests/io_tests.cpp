@@ -99,6 +99,128 @@ TEST(IO, Read)
 }
 
 
+TEST(IO, Readv)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  int pipes[2];
+  char first[2];
+  char second[2];
+
+  struct iovec iov[2];
+  iov[0].iov_base = first;
+  iov[0].iov_len = 2;
+  iov[1].iov_base = second;
+  iov[1].iov_len = 2;
+
+  // Create a blocking pipe.
+  ASSERT_NE(-1, ::pipe(pipes));
+
+  // Test on a blocking file descriptor.
+  EXPECT_FUTURE_WILL_FAIL(io::readv(pipes[0], iov, 2));
+
+  close(pipes[0]);
+  close(pipes[1]);
+
+  // Create a nonblocking pipe.
+  ASSERT_NE(-1, ::pipe(pipes));
+  ASSERT_SOME(os::nonblock(pipes[0]));
+  ASSERT_SOME(os::nonblock(pipes[1]));
+
+  // Test reading into nothing.
+  EXPECT_FUTURE_WILL_FAIL(io::readv(pipes[0], iov, 0));
+
+  // Test a successful read spanning both buffers.
+  Future<size_t> future = io::readv(pipes[0], iov, 2);
+  ASSERT_FALSE(future.isReady());
+
+  ASSERT_EQ(4, write(pipes[1], "hiya", 4));
+  ASSERT_FUTURE_WILL_EQ(4u, future);
+  EXPECT_EQ('h', first[0]);
+  EXPECT_EQ('i', first[1]);
+  EXPECT_EQ('y', second[0]);
+  EXPECT_EQ('a', second[1]);
+
+  close(pipes[0]);
+  close(pipes[1]);
+}
+
+
+TEST(IO, Writev)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  int pipes[2];
+  char data[5];
+
+  // Create a nonblocking pipe.
+  ASSERT_NE(-1, ::pipe(pipes));
+  ASSERT_SOME(os::nonblock(pipes[0]));
+  ASSERT_SOME(os::nonblock(pipes[1]));
+
+  char first[] = "hi ";
+  char second[] = "yo";
+
+  struct iovec iov[2];
+  iov[0].iov_base = first;
+  iov[0].iov_len = 3;
+  iov[1].iov_base = second;
+  iov[1].iov_len = 2;
+
+  // Test writing nothing.
+  EXPECT_FUTURE_WILL_FAIL(io::writev(pipes[1], iov, 0));
+
+  // Test a successful write gathering both buffers.
+  ASSERT_FUTURE_WILL_EQ(5u, io::writev(pipes[1], iov, 2));
+  ASSERT_EQ(5, read(pipes[0], data, 5));
+  EXPECT_EQ("hi yo", string(data, 5));
+
+  close(pipes[0]);
+  close(pipes[1]);
+}
+
+
+TEST(IO, BufferedReader)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  int pipes[2];
+
+  // Create a nonblocking pipe.
+  ASSERT_NE(-1, ::pipe(pipes));
+  ASSERT_SOME(os::nonblock(pipes[0]));
+
+  io::BufferedReader reader(pipes[0]);
+
+  // The first read triggers a refill of the readahead buffer.
+  Future<io::Slice> future = reader.read(2);
+  ASSERT_FALSE(future.isReady());
+
+  ASSERT_EQ(5, write(pipes[1], "hello", 5));
+
+  future.await();
+  ASSERT_TRUE(future.isReady());
+  EXPECT_EQ("he", string(future.get().data(), future.get().size()));
+
+  // The rest gets served straight out of the readahead buffer.
+  future = reader.read();
+  ASSERT_TRUE(future.isReady());
+  EXPECT_EQ("llo", string(future.get().data(), future.get().size()));
+
+  // An empty slice signifies end-of-file.
+  future = reader.read();
+  ASSERT_FALSE(future.isReady());
+
+  close(pipes[1]);
+
+  future.await();
+  ASSERT_TRUE(future.isReady());
+  EXPECT_TRUE(future.get().empty());
+
+  close(pipes[0]);
+}
+
+
 TEST(IO, BufferedRead)
 {
   // 128 Bytes.
@@ -5,8 +5,11 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
+#include <iostream>
+#include <list>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <process/async.hpp>
 #include <process/collect.hpp>
@@ -20,12 +23,14 @@
 #include <process/gc.hpp>
 #include <process/gmock.hpp>
 #include <process/gtest.hpp>
+#include <process/latch.hpp>
 #include <process/process.hpp>
 #include <process/run.hpp>
 #include <process/thread.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/nothing.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/os.hpp>
 #include <stout/stringify.hpp>
 
@@ -69,7 +74,7 @@ TEST(Process, event)
   EXPECT_FALSE(event->is<MessageEvent>());
   EXPECT_FALSE(event->is<ExitedEvent>());
   EXPECT_TRUE(event->is<TerminateEvent>());
-  delete event;
+  destroy(event);
 }
 
 
@@ -305,6 +310,70 @@ TEST(Process, dispatch)
 }
 
 
+class CountProcess : public Process<CountProcess>
+{
+public:
+  CountProcess(long _limit) : count(0), limit(_limit) {}
+
+  Future<Nothing> done() { return promise.future(); }
+
+  void increment()
+  {
+    if (++count == limit) {
+      promise.set(Nothing());
+    }
+  }
+
+private:
+  long count;
+  const long limit;
+  Promise<Nothing> promise;
+};
+
+
+TEST(Process, scheduling)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  // A crude scheduling throughput benchmark: dispatch a large number
+  // of messages round-robin across a handful of processes, which
+  // stresses concurrent enqueueing and dequeueing on the run queue
+  // (each delivered dispatch makes the receiver runnable again).
+  const int processes = 8;
+  const long messages = 10000;
+
+  std::vector<CountProcess*> counters;
+  std::list<Future<Nothing> > futures;
+
+  for (int i = 0; i < processes; i++) {
+    CountProcess* counter = new CountProcess(messages);
+    spawn(counter);
+    counters.push_back(counter);
+    futures.push_back(counter->done());
+  }
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  for (long i = 0; i < messages; i++) {
+    for (int j = 0; j < processes; j++) {
+      dispatch(counters[j], &CountProcess::increment);
+    }
+  }
+
+  ASSERT_FUTURE_WILL_SUCCEED(collect(futures));
+
+  std::cout << "Delivered " << (processes * messages) << " dispatches in "
+            << stopwatch.elapsed() << std::endl;
+
+  for (int i = 0; i < processes; i++) {
+    terminate(counters[i]);
+    wait(counters[i]);
+    delete counters[i];
+  }
+}
+
+
 TEST(Process, defer1)
 {
   ASSERT_TRUE(GTEST_IS_THREADSAFE);
@@ -497,6 +566,45 @@ TEST(Process, handlers)
 }
 
 
+class FlowControlProcess : public Process<FlowControlProcess>
+{
+public:
+  Future<Nothing> ping(const UPID& to)
+  {
+    return send(to, "func", std::string("body"), false);
+  }
+};
+
+
+TEST(Process, flowControl)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  HandlersProcess process;
+  FlowControlProcess sender;
+
+  EXPECT_CALL(process, func(_, _))
+    .Times(1);
+
+  PID<HandlersProcess> pid = spawn(&process);
+  PID<FlowControlProcess> from = spawn(&sender);
+
+  // A flow controlled send to a local process delivers immediately
+  // and never surfaces backpressure.
+  Future<Nothing> sent =
+    dispatch(from, &FlowControlProcess::ping, (UPID) pid);
+
+  sent.await(Seconds(1.0));
+  ASSERT_TRUE(sent.isReady());
+
+  terminate(pid, false);
+  wait(pid);
+
+  terminate(from, false);
+  wait(from);
+}
+
+
 // Tests EXPECT_MESSAGE and EXPECT_DISPATCH and in particular that an
 // event can get dropped before being processed.
 TEST(Process, expect)
@@ -885,6 +993,42 @@ TEST(Process, collect)
 }
 
 
+TEST(Process, awaitAll)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  Promise<int> promise1;
+  Promise<int> promise2;
+  Promise<int> promise3;
+
+  std::list<Future<int> > futures;
+  futures.push_back(promise1.future());
+  futures.push_back(promise2.future());
+  futures.push_back(promise3.future());
+
+  promise1.set(1);
+  promise2.fail("failure");
+  promise3.set(3);
+
+  Future<std::list<Future<int> > > future = awaitAll(futures);
+
+  EXPECT_TRUE(future.await());
+  EXPECT_TRUE(future.isReady());
+
+  // A failed constituent does not short circuit the wait, and the
+  // futures come back in input order.
+  std::list<Future<int> > results = future.get();
+  ASSERT_EQ(3u, results.size());
+
+  std::list<Future<int> >::const_iterator iterator = results.begin();
+  EXPECT_EQ(1, (*iterator).get());
+  ++iterator;
+  EXPECT_TRUE((*iterator).isFailed());
+  ++iterator;
+  EXPECT_EQ(3, (*iterator).get());
+}
+
+
 class SettleProcess : public Process<SettleProcess>
 {
 public:
@@ -1069,12 +1213,23 @@ TEST(Process, remote)
 
   ASSERT_EQ(0, connect(s, (sockaddr*) &addr, sizeof(addr)));
 
-  Message message;
-  message.name = "handler";
-  message.from = UPID();
-  message.to = process.self();
-
-  const std::string& data = MessageEncoder::encode(&message);
+  Message* message = new Message();
+  message->name = "handler";
+  message->from = UPID();
+  message->to = process.self();
+
+  // Drain the encoder (which takes ownership of the message) through
+  // its iovec interface to get the bytes to put on the wire.
+  MessageEncoder encoder(message);
+
+  std::string data;
+  struct iovec iov[2];
+  int count;
+  while ((count = encoder.next(iov, 2)) > 0) {
+    for (int i = 0; i < count; i++) {
+      data.append((const char*) iov[i].iov_base, iov[i].iov_len);
+    }
+  }
 
   ASSERT_EQ(data.size(), write(s, data.data(), data.size()));
 
@@ -1140,3 +1295,20 @@ TEST(Process, async)
   // Non-void function that returns a future.
   EXPECT_EQ("42", async(&itoa1, &i).get().get());
 }
+
+
+TEST(Process, workerPool)
+{
+  ASSERT_TRUE(GTEST_IS_THREADSAFE);
+
+  WorkerPool pool(1, 2);
+
+  Latch latch;
+  ASSERT_TRUE(pool.submit(
+      std::tr1::bind(&Latch::trigger, &latch), WorkerPool::HIGH));
+  EXPECT_TRUE(latch.await(Seconds(10.0)));
+
+  WorkerPool::Stats stats = pool.stats();
+  EXPECT_EQ(1u, stats.submitted);
+  EXPECT_EQ(0u, stats.rejected);
+}
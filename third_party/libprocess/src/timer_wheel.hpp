@@ -0,0 +1,260 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <math.h>
+
+#include <list>
+#include <map>
+
+#include <process/timer.hpp>
+
+namespace process {
+
+// A two-level timing wheel. Timers due within the wheel's horizon
+// live in a circular array of buckets (each bucket covering one tick
+// of time), so arming a timer is just a push onto the right bucket
+// and canceling one only touches the bucket its timeout hashes to,
+// regardless of how many timers are outstanding. Timers beyond the
+// horizon wait in a sorted overflow map and migrate into the wheel as
+// it turns (with tens of thousands of short lived timers and only a
+// handful of distant ones, the overflow map stays small).
+//
+// Note that operations are NOT internally synchronized; the caller is
+// expected to hold a lock (in process.cpp, the 'timeouts' lock, which
+// also protects the clock state that timers are ordered against).
+class TimerWheel
+{
+public:
+  TimerWheel()
+    : tick(1.0 / 16.0),
+      start(0.0),
+      offset(0),
+      wheeled(0),
+      earliest(-1.0) {}
+
+  bool empty() const
+  {
+    return wheeled == 0 && overflow.empty();
+  }
+
+  // Returns the earliest timeout of any timer (only valid when the
+  // wheel is not empty).
+  double next() const
+  {
+    return earliest;
+  }
+
+  void add(const Timer& timer)
+  {
+    double timeout = timer.timeout().value();
+
+    // With no timers in the buckets we're free to (re)anchor the
+    // wheel so that the horizon covers the new timer (overflow timers
+    // are beyond any horizon we might pick, so they stay put).
+    if (wheeled == 0 && (overflow.empty() || timeout < start)) {
+      start = floor(timeout / tick) * tick;
+      offset = 0;
+    }
+
+    insert(timer);
+
+    if (earliest < 0 || timeout < earliest) {
+      earliest = timeout;
+    }
+  }
+
+  bool cancel(const Timer& timer)
+  {
+    double timeout = timer.timeout().value();
+
+    bool canceled = false;
+
+    if (timeout < start + WIDTH * tick) {
+      std::list<Timer>& bucket = buckets[index(timeout)];
+      size_t size = bucket.size();
+      bucket.remove(timer);
+      if (bucket.size() < size) {
+        wheeled -= size - bucket.size();
+        canceled = true;
+      }
+    } else {
+      std::pair<std::multimap<double, Timer>::iterator,
+                std::multimap<double, Timer>::iterator> range =
+        overflow.equal_range(timeout);
+      for (std::multimap<double, Timer>::iterator iterator = range.first;
+           iterator != range.second;
+           ++iterator) {
+        if (iterator->second == timer) {
+          overflow.erase(iterator);
+          canceled = true;
+          break;
+        }
+      }
+    }
+
+    if (canceled && timeout == earliest) {
+      recompute();
+    }
+
+    return canceled;
+  }
+
+  // Removes and returns (ordered by timeout) all timers with
+  // timeouts less than or equal to 'now'.
+  std::list<Timer> advance(double now)
+  {
+    std::list<Timer> expired;
+
+    // If the entire wheel is in the past just dump it rather than
+    // turning one slot at a time (e.g., after being idle).
+    if (wheeled > 0 && now >= start + WIDTH * tick) {
+      for (size_t i = 0; i < WIDTH; i++) {
+        expired.splice(expired.end(), buckets[i]);
+      }
+      wheeled = 0;
+      start = floor(now / tick) * tick;
+      offset = 0;
+      migrate();
+    }
+
+    // Now turn the wheel one slot at a time up to 'now'.
+    while (true) {
+      if (wheeled == 0) {
+        // Jump an empty wheel forward to the first overflow timer
+        // rather than turning through empty slots to reach it.
+        if (overflow.empty()) {
+          break;
+        }
+        start = floor(overflow.begin()->first / tick) * tick;
+        offset = 0;
+        migrate();
+        continue;
+      }
+
+      if (start + tick > now) {
+        break;
+      }
+
+      wheeled -= buckets[offset].size();
+      expired.splice(expired.end(), buckets[offset]);
+      offset = (offset + 1) % WIDTH;
+      start += tick;
+      migrate();
+    }
+
+    // The current bucket might hold a mix of expired and future
+    // timers (anything already due gets hashed here no matter how far
+    // in the past it is), so filter it.
+    if (wheeled > 0) {
+      std::list<Timer>& bucket = buckets[offset];
+      std::list<Timer>::iterator iterator = bucket.begin();
+      while (iterator != bucket.end()) {
+        if (iterator->timeout().value() <= now) {
+          expired.push_back(*iterator);
+          iterator = bucket.erase(iterator);
+          wheeled--;
+        } else {
+          ++iterator;
+        }
+      }
+    }
+
+    // Deliver in timeout order (and creation order within a timeout),
+    // like the sorted map this replaced. Note that std::list::sort is
+    // stable.
+    expired.sort(before);
+
+    recompute();
+
+    return expired;
+  }
+
+private:
+  // Number of buckets ("slots") in the wheel; with a 1/16 second tick
+  // this covers a horizon of 64 seconds, which spans the common
+  // timers (pings, filter expiries) without migrations.
+  enum { WIDTH = 1024 };
+
+  // Returns the bucket a timeout belongs in. Already due timeouts
+  // (less than 'start') share the current bucket.
+  size_t index(double timeout) const
+  {
+    if (timeout <= start) {
+      return offset;
+    }
+    return (offset + (size_t) ((timeout - start) / tick)) % WIDTH;
+  }
+
+  void insert(const Timer& timer)
+  {
+    double timeout = timer.timeout().value();
+    if (timeout < start + WIDTH * tick) {
+      buckets[index(timeout)].push_back(timer);
+      wheeled++;
+    } else {
+      overflow.insert(std::pair<const double, Timer>(timeout, timer));
+    }
+  }
+
+  // Moves overflow timers that the (advanced) horizon now covers into
+  // the wheel.
+  void migrate()
+  {
+    while (!overflow.empty() && overflow.begin()->first < start + WIDTH * tick) {
+      Timer timer = overflow.begin()->second;
+      overflow.erase(overflow.begin());
+      insert(timer);
+    }
+  }
+
+  // Recomputes the cached earliest timeout. The first non-empty
+  // bucket in rotation order bounds the earliest wheeled timer (a
+  // bucket spans a tick, so we take the minimum within it).
+  void recompute()
+  {
+    earliest = -1.0;
+
+    for (size_t i = 0; i < WIDTH && wheeled > 0; i++) {
+      const std::list<Timer>& bucket = buckets[(offset + i) % WIDTH];
+      if (!bucket.empty()) {
+        for (std::list<Timer>::const_iterator iterator = bucket.begin();
+             iterator != bucket.end();
+             ++iterator) {
+          double timeout = iterator->timeout().value();
+          if (earliest < 0 || timeout < earliest) {
+            earliest = timeout;
+          }
+        }
+        break;
+      }
+    }
+
+    if (!overflow.empty() &&
+        (earliest < 0 || overflow.begin()->first < earliest)) {
+      earliest = overflow.begin()->first;
+    }
+  }
+
+  static bool before(const Timer& left, const Timer& right)
+  {
+    return left.timeout().value() < right.timeout().value();
+  }
+
+  const double tick; // Seconds of time each bucket spans.
+
+  std::list<Timer> buckets[WIDTH];
+
+  double start;  // Time at which the current bucket ('offset') begins.
+  size_t offset; // Index of the current bucket.
+  size_t wheeled; // Number of timers in the buckets (not overflow).
+
+  // Timers beyond the horizon, sorted by timeout.
+  std::multimap<double, Timer> overflow;
+
+  // Cached earliest timeout, or -1 when empty.
+  double earliest;
+};
+
+} // namespace process {
+
+#endif // TIMER_WHEEL_HPP
@@ -0,0 +1,123 @@
+#include <pthread.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include <process/timing.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+
+using std::map;
+using std::string;
+
+namespace process {
+namespace timing {
+
+bool enabled = false;
+
+
+// Protects the registry; probes themselves are updated with atomics.
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static map<string, Probe*>* probes = NULL;
+
+
+Probe* probe(const string& name)
+{
+  pthread_mutex_lock(&mutex);
+
+  if (probes == NULL) {
+    probes = new map<string, Probe*>();
+  }
+
+  Probe*& probe = (*probes)[name];
+  if (probe == NULL) {
+    probe = new Probe(name);
+  }
+
+  pthread_mutex_unlock(&mutex);
+  return probe;
+}
+
+
+namespace {
+
+// Estimates the q'th percentile from the merged buckets: the upper
+// bound of the bucket holding the q'th sample, i.e. accurate to the
+// enclosing power of two.
+uint64_t percentile(const uint64_t (&buckets)[BUCKETS], uint64_t count, double q)
+{
+  uint64_t target = (uint64_t) (count * q);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen > target) {
+      return (uint64_t) 1 << (i + 1);
+    }
+  }
+  return 0;
+}
+
+} // namespace {
+
+
+string snapshot()
+{
+  JSON::Writer writer;
+  writer.beginObject();
+
+  pthread_mutex_lock(&mutex);
+
+  if (probes != NULL) {
+    foreachvalue (Probe* probe, *probes) {
+      // Merge the shards. Concurrent records can still be in flight;
+      // the totals are a monitoring grade approximation.
+      uint64_t count = 0;
+      uint64_t sum = 0;
+      uint64_t min = (uint64_t) -1;
+      uint64_t max = 0;
+      uint64_t buckets[BUCKETS];
+      for (size_t j = 0; j < BUCKETS; j++) {
+        buckets[j] = 0;
+      }
+
+      for (size_t i = 0; i < SHARDS; i++) {
+        const Shard& shard = probe->shards[i];
+        count += shard.count;
+        sum += shard.sum;
+        if (shard.min < min) {
+          min = shard.min;
+        }
+        if (shard.max > max) {
+          max = shard.max;
+        }
+        for (size_t j = 0; j < BUCKETS; j++) {
+          buckets[j] += shard.buckets[j];
+        }
+      }
+
+      writer.key(probe->name);
+      writer.beginObject();
+      writer.field("count", count);
+      if (count > 0) {
+        writer.field("total_ns", sum);
+        writer.field("mean_ns", sum / count);
+        writer.field("min_ns", min);
+        writer.field("max_ns", max);
+        writer.field("p50_ns", percentile(buckets, count, 0.50));
+        writer.field("p90_ns", percentile(buckets, count, 0.90));
+        writer.field("p99_ns", percentile(buckets, count, 0.99));
+      }
+      writer.endObject();
+    }
+  }
+
+  pthread_mutex_unlock(&mutex);
+
+  writer.endObject();
+  return writer.str();
+}
+
+} // namespace timing {
+} // namespace process {
@@ -0,0 +1,103 @@
+#ifndef __STOUT_CRC32C_HPP__
+#define __STOUT_CRC32C_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h> // For memcpy.
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+#include <string>
+
+// CRC-32C (Castagnoli, polynomial 0x1EDC6F41), the checksum used by
+// iSCSI and ext4. Unlike the IEEE CRC-32, it maps directly onto the
+// SSE4.2 'crc32' instruction, where it runs at multiple bytes per
+// cycle; without SSE4.2 (at compile time, i.e., -msse4.2) a table
+// driven fallback is used. The streaming form (extend) lets one
+// checksum cover data that arrives in pieces:
+//
+//   uint32_t crc = crc32c::extend(0, head, headLength);
+//   crc = crc32c::extend(crc, tail, tailLength);
+
+namespace crc32c {
+
+namespace internal {
+
+#ifndef __SSE4_2__
+struct Table
+{
+  Table()
+  {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int j = 0; j < 8; j++) {
+        crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+      }
+      entries[i] = crc;
+    }
+  }
+
+  uint32_t entries[256];
+};
+
+
+inline const Table& table()
+{
+  static Table table;
+  return table;
+}
+#endif // __SSE4_2__
+
+} // namespace internal {
+
+
+// Returns the checksum of the concatenation of the data covered by
+// 'crc' and [data, data + length); extend(0, ...) checksums a single
+// piece of data.
+inline uint32_t extend(uint32_t crc, const char* data, size_t length)
+{
+  uint32_t c = crc ^ 0xFFFFFFFF;
+
+#ifdef __SSE4_2__
+#ifdef __x86_64__
+  // 8 bytes a stride, then the tail a byte at a time.
+  while (length >= 8) {
+    uint64_t chunk;
+    memcpy(&chunk, data, 8); // The data may not be aligned.
+    c = (uint32_t) _mm_crc32_u64(c, chunk);
+    data += 8;
+    length -= 8;
+  }
+#endif
+  while (length > 0) {
+    c = _mm_crc32_u8(c, (uint8_t) *data);
+    data++;
+    length--;
+  }
+#else
+  const internal::Table& table = internal::table();
+  for (size_t i = 0; i < length; i++) {
+    c = (c >> 8) ^ table.entries[(c ^ (uint8_t) data[i]) & 0xFF];
+  }
+#endif
+
+  return c ^ 0xFFFFFFFF;
+}
+
+
+inline uint32_t checksum(const char* data, size_t length)
+{
+  return extend(0, data, length);
+}
+
+
+inline uint32_t checksum(const std::string& data)
+{
+  return extend(0, data.data(), data.size());
+}
+
+} // namespace crc32c {
+
+#endif // __STOUT_CRC32C_HPP__
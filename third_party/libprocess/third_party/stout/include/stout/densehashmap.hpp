@@ -0,0 +1,369 @@
+#ifndef __STOUT_DENSEHASHMAP_HPP__
+#define __STOUT_DENSEHASHMAP_HPP__
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include "hashset.hpp"
+#include "foreach.hpp"
+#include "none.hpp"
+#include "option.hpp"
+
+
+// Provides a hash map that stores its entries flat in a single array
+// using open addressing (robin hood hashing with backward shift
+// deletion) rather than a node per entry like hashmap. Lookups probe
+// consecutive array slots instead of chasing pointers and inserting
+// only allocates when the table grows, which makes this a better fit
+// for hot tables that are probed constantly (e.g., task lookups on
+// every status update). It offers the same convenience interface as
+// hashmap (contains, get, keys, values, foreach, etc.) so converting
+// a table is just a type change, with two caveats: Value must be
+// default constructible and copyable (entries live in the array), and
+// iterators are invalidated by any insertion or erasure.
+
+template <typename Key,
+          typename Value,
+          typename Hash = boost::hash<Key> >
+class densehashmap
+{
+private:
+  struct Bucket
+  {
+    Bucket() : hash(0) {}
+
+    // Cached hash of the key, or 0 if this bucket is empty (hashes
+    // get nudged to 1 so that 0 is never a valid hash).
+    size_t hash;
+    std::pair<Key, Value> entry;
+  };
+
+  std::vector<Bucket> buckets;
+  size_t occupied;
+
+public:
+  typedef std::pair<Key, Value> value_type;
+
+  // Iterators walk the bucket array skipping empty slots. Note that
+  // unlike hashmap, the key is not const through an iterator (the
+  // entries are plain pairs); don't mutate it.
+  template <typename Entry, typename BucketT>
+  class iterator_base
+    : public std::iterator<std::forward_iterator_tag, Entry>
+  {
+  public:
+    iterator_base() : bucket(NULL), end(NULL) {}
+
+    iterator_base(BucketT* _bucket, BucketT* _end)
+      : bucket(_bucket), end(_end)
+    {
+      skip();
+    }
+
+    // Allow converting an iterator to a const_iterator.
+    template <typename E, typename B>
+    iterator_base(const iterator_base<E, B>& that)
+      : bucket(that.bucket), end(that.end) {}
+
+    Entry& operator * () const { return bucket->entry; }
+    Entry* operator -> () const { return &bucket->entry; }
+
+    iterator_base& operator ++ ()
+    {
+      bucket++;
+      skip();
+      return *this;
+    }
+
+    iterator_base operator ++ (int)
+    {
+      iterator_base temp = *this;
+      ++*this;
+      return temp;
+    }
+
+    template <typename E, typename B>
+    bool operator == (const iterator_base<E, B>& that) const
+    {
+      return bucket == that.bucket;
+    }
+
+    template <typename E, typename B>
+    bool operator != (const iterator_base<E, B>& that) const
+    {
+      return bucket != that.bucket;
+    }
+
+  private:
+    template <typename E, typename B>
+    friend class iterator_base;
+    friend class densehashmap;
+
+    void skip()
+    {
+      while (bucket != end && bucket->hash == 0) {
+        bucket++;
+      }
+    }
+
+    BucketT* bucket;
+    BucketT* end;
+  };
+
+  typedef iterator_base<value_type, Bucket> iterator;
+  typedef iterator_base<const value_type, const Bucket> const_iterator;
+
+  densehashmap() : occupied(0) {}
+
+  iterator begin()
+  {
+    return iterator(data(), data() + buckets.size());
+  }
+
+  iterator end()
+  {
+    return iterator(data() + buckets.size(), data() + buckets.size());
+  }
+
+  const_iterator begin() const
+  {
+    return const_iterator(data(), data() + buckets.size());
+  }
+
+  const_iterator end() const
+  {
+    return const_iterator(data() + buckets.size(), data() + buckets.size());
+  }
+
+  size_t size() const { return occupied; }
+
+  bool empty() const { return occupied == 0; }
+
+  void clear()
+  {
+    buckets.clear();
+    occupied = 0;
+  }
+
+  iterator find(const Key& key)
+  {
+    size_t index = indexof(key);
+    if (index == buckets.size()) {
+      return end();
+    }
+    return iterator(data() + index, data() + buckets.size());
+  }
+
+  const_iterator find(const Key& key) const
+  {
+    size_t index = indexof(key);
+    if (index == buckets.size()) {
+      return end();
+    }
+    return const_iterator(data() + index, data() + buckets.size());
+  }
+
+  size_t count(const Key& key) const
+  {
+    return indexof(key) != buckets.size() ? 1 : 0;
+  }
+
+  // Checks whether this map contains a binding for a key.
+  bool contains(const Key& key) const
+  {
+    return count(key) > 0;
+  }
+
+  Value& operator [] (const Key& key)
+  {
+    return buckets[place(key)].entry.second;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& entry)
+  {
+    size_t before = occupied;
+    size_t index = place(entry.first);
+    bool inserted = occupied > before;
+    if (inserted) {
+      buckets[index].entry.second = entry.second;
+    }
+    return std::make_pair(
+        iterator(data() + index, data() + buckets.size()), inserted);
+  }
+
+  size_t erase(const Key& key)
+  {
+    size_t index = indexof(key);
+
+    if (index == buckets.size()) {
+      return 0;
+    }
+
+    // Backward shift: pull subsequent entries that are not in their
+    // preferred slot back one, so that probes never need tombstones.
+    size_t mask = buckets.size() - 1;
+    while (true) {
+      size_t next = (index + 1) & mask;
+      if (buckets[next].hash == 0 ||
+          distance(buckets[next].hash, next) == 0) {
+        buckets[index] = Bucket();
+        break;
+      }
+      buckets[index] = buckets[next];
+      index = next;
+    }
+
+    occupied--;
+    return 1;
+  }
+
+  // Returns an Option for the binding to the key.
+  Option<Value> get(const Key& key) const
+  {
+    size_t index = indexof(key);
+    if (index == buckets.size()) {
+      return None();
+    }
+    return buckets[index].entry.second;
+  }
+
+  // Returns the set of keys in this map.
+  hashset<Key> keys() const
+  {
+    hashset<Key> result;
+    foreachkey (const Key& key, *this) {
+      result.insert(key);
+    }
+    return result;
+  }
+
+  // Returns the set of values in this map.
+  hashset<Value> values() const
+  {
+    hashset<Value> result;
+    foreachvalue (const Value& value, *this) {
+      result.insert(value);
+    }
+    return result;
+  }
+
+private:
+  Bucket* data()
+  {
+    return buckets.empty() ? NULL : &buckets[0];
+  }
+
+  const Bucket* data() const
+  {
+    return buckets.empty() ? NULL : &buckets[0];
+  }
+
+  size_t hashof(const Key& key) const
+  {
+    size_t hash = Hash()(key);
+    return hash == 0 ? 1 : hash;
+  }
+
+  // Returns how far the entry with the specified hash currently
+  // sitting at 'index' is from its preferred slot.
+  size_t distance(size_t hash, size_t index) const
+  {
+    size_t mask = buckets.size() - 1;
+    return (index - (hash & mask)) & mask;
+  }
+
+  // Returns the index of the bucket holding the key, or
+  // buckets.size() if not present.
+  size_t indexof(const Key& key) const
+  {
+    if (buckets.empty()) {
+      return buckets.size();
+    }
+
+    size_t hash = hashof(key);
+    size_t mask = buckets.size() - 1;
+    size_t index = hash & mask;
+
+    for (size_t probe = 0; ; probe++, index = (index + 1) & mask) {
+      if (buckets[index].hash == 0) {
+        return buckets.size();
+      }
+      // An entry closer to its preferred slot than we are to ours
+      // would have been displaced during insertion, so the key can't
+      // be any further along the probe sequence.
+      if (distance(buckets[index].hash, index) < probe) {
+        return buckets.size();
+      }
+      if (buckets[index].hash == hash &&
+          buckets[index].entry.first == key) {
+        return index;
+      }
+    }
+  }
+
+  // Returns the index of the bucket holding the key, inserting a
+  // default constructed value (and growing the table) if necessary.
+  size_t place(const Key& key)
+  {
+    // Grow at 3/4 load (table sizes are powers of two).
+    if ((occupied + 1) * 4 > buckets.size() * 3) {
+      rehash(buckets.empty() ? 16 : buckets.size() * 2);
+    }
+
+    size_t index = indexof(key);
+    if (index != buckets.size()) {
+      return index;
+    }
+
+    Bucket bucket;
+    bucket.hash = hashof(key);
+    bucket.entry.first = key;
+
+    occupied++;
+    return insert_(bucket);
+  }
+
+  // Robin hood insertion of a bucket known to not be in the table;
+  // returns the slot where the bucket's original entry ended up.
+  size_t insert_(Bucket bucket)
+  {
+    size_t mask = buckets.size() - 1;
+    size_t index = bucket.hash & mask;
+    size_t result = buckets.size();
+
+    for (size_t probe = 0; ; probe++, index = (index + 1) & mask) {
+      if (buckets[index].hash == 0) {
+        buckets[index] = bucket;
+        return result == buckets.size() ? index : result;
+      }
+      // Steal from the rich: if the resident entry is closer to its
+      // preferred slot than the carried one, swap them and continue
+      // inserting the displaced entry.
+      if (distance(buckets[index].hash, index) < probe) {
+        if (result == buckets.size()) {
+          result = index;
+        }
+        std::swap(bucket, buckets[index]);
+        probe = distance(bucket.hash, index);
+      }
+    }
+  }
+
+  void rehash(size_t capacity)
+  {
+    std::vector<Bucket> old;
+    old.swap(buckets);
+    buckets.resize(capacity);
+
+    for (size_t i = 0; i < old.size(); i++) {
+      if (old[i].hash != 0) {
+        insert_(old[i]);
+      }
+    }
+  }
+};
+
+#endif // __STOUT_DENSEHASHMAP_HPP__
@@ -69,4 +69,50 @@ public:
     : Error(message + ": " + std::string(strerror(errno))) {}
 };
 
+
+// An allocation free error payload for Try (i.e., Try<T, ErrorCode>)
+// on hot paths where errors are expected and frequent, such as
+// probing optional files on every monitoring interval. Stores just an
+// errno value and an optional context string (which must have static
+// storage duration, e.g., a string literal, as it is not copied); a
+// human readable message is only formatted when asked for.
+class ErrorCode
+{
+public:
+  ErrorCode() : code(errno), context(NULL) {}
+
+  explicit ErrorCode(int _code, const char* _context = NULL)
+    : code(_code), context(_context) {}
+
+  // Implicitly converts to an errored Try (same sugar as Error).
+  template <typename T>
+  operator Try<T, ErrorCode> () const
+  {
+    return Try<T, ErrorCode>::error(*this);
+  }
+
+  int value() const { return code; }
+
+  std::string message() const
+  {
+    if (context != NULL) {
+      return std::string(context) + ": " + strerror(code);
+    }
+    return strerror(code);
+  }
+
+  bool operator == (int that) const { return code == that; }
+  bool operator != (int that) const { return code != that; }
+
+private:
+  int code;
+  const char* context; // Optional static context string (not owned).
+};
+
+
+inline std::ostream& operator << (std::ostream& stream, const ErrorCode& code)
+{
+  return stream << code.message();
+}
+
 #endif // __STOUT_ERROR_HPP__
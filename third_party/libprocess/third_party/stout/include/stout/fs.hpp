@@ -25,6 +25,18 @@ inline Try<uint64_t> available(const std::string& path = "/")
 }
 
 
+// Returns the total size in bytes of the file system mounted at the
+// given path.
+inline Try<uint64_t> size(const std::string& path = "/")
+{
+  struct statvfs buf;
+  if (::statvfs(path.c_str(), &buf) < 0) {
+    return ErrnoError();
+  }
+  return buf.f_blocks * buf.f_frsize;
+}
+
+
 // Returns relative disk usage of the file system mounted at the given path.
 inline Try<double> usage(const std::string& fs = "/")
 {
@@ -11,12 +11,261 @@
 #include "try.hpp"
 
 // Compression utilities.
-// TODO(bmahler): Provide streaming compression / decompression as well.
 namespace gzip {
 
 // We use a 16KB buffer with zlib compression / decompression.
 #define GZIP_BUFFER_SIZE 16384
 
+
+// Provides streaming gzip compression. Input is fed incrementally via
+// compress() and each call returns the compressed output produced so
+// far. The stream is flushed on every call so that the concatenation
+// of the returned strings is decompressible as it arrives (at a small
+// cost in compression ratio), making this suitable for compressing
+// "chunked" HTTP responses. A final call to finish() emits any
+// buffered output along with the gzip trailer.
+class Compressor
+{
+public:
+#ifdef HAVE_LIBZ
+  explicit Compressor(int level = Z_DEFAULT_COMPRESSION)
+#else
+  explicit Compressor(int level = -1)
+#endif
+    : ready(false), finished(false)
+  {
+#ifdef HAVE_LIBZ
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+
+    int code = deflateInit2(
+        &stream,
+        level,          // Compression level.
+        Z_DEFLATED,     // Compression method.
+        MAX_WBITS + 16, // Zlib magic for gzip compression / decompression.
+        8,              // Default memLevel value.
+        Z_DEFAULT_STRATEGY);
+
+    ready = (code == Z_OK);
+#endif
+  }
+
+  ~Compressor()
+  {
+#ifdef HAVE_LIBZ
+    if (ready && !finished) {
+      deflateEnd(&stream);
+    }
+#endif
+  }
+
+  // Returns whether the compressor is usable (e.g., libz might not be
+  // available, or initialization might have failed).
+  bool initialized() const
+  {
+    return ready;
+  }
+
+  // Compresses (and flushes) the provided input.
+  Try<std::string> compress(const char* data, size_t length)
+  {
+#ifndef HAVE_LIBZ
+    return Error("libz is not available");
+#else
+    if (!ready) {
+      return Error("Failed to initialize zlib");
+    } else if (finished) {
+      return Error("Compression already finished");
+    }
+
+    stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+    stream.avail_in = length;
+
+    // Build up the compressed result. Z_SYNC_FLUSH means everything
+    // provided so far gets emitted (byte aligned), so we loop until
+    // zlib stops filling the output buffer.
+    Bytef buffer[GZIP_BUFFER_SIZE];
+    std::string result = "";
+    do {
+      stream.next_out = buffer;
+      stream.avail_out = GZIP_BUFFER_SIZE;
+      int code = deflate(&stream, Z_SYNC_FLUSH);
+
+      if (code != Z_OK) {
+        return Error(std::string(stream.msg));
+      }
+
+      result.append(
+          reinterpret_cast<char*>(buffer),
+          GZIP_BUFFER_SIZE - stream.avail_out);
+    } while (stream.avail_out == 0);
+
+    return result;
+#endif // HAVE_LIBZ
+  }
+
+  // Finalizes the stream, returning any remaining output followed by
+  // the gzip trailer. The compressor cannot be used afterwards.
+  Try<std::string> finish()
+  {
+#ifndef HAVE_LIBZ
+    return Error("libz is not available");
+#else
+    if (!ready) {
+      return Error("Failed to initialize zlib");
+    } else if (finished) {
+      return Error("Compression already finished");
+    }
+
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+
+    Bytef buffer[GZIP_BUFFER_SIZE];
+    std::string result = "";
+    int code;
+    do {
+      stream.next_out = buffer;
+      stream.avail_out = GZIP_BUFFER_SIZE;
+      code = deflate(&stream, Z_FINISH);
+
+      if (code != Z_OK && code != Z_STREAM_END) {
+        return Error(std::string(stream.msg));
+      }
+
+      result.append(
+          reinterpret_cast<char*>(buffer),
+          GZIP_BUFFER_SIZE - stream.avail_out);
+    } while (code != Z_STREAM_END);
+
+    finished = true;
+
+    code = deflateEnd(&stream);
+    if (code != Z_OK) {
+      return Error("Failed to clean up zlib: " + std::string(stream.msg));
+    }
+    return result;
+#endif // HAVE_LIBZ
+  }
+
+private:
+  // Not copyable, not assignable (owns the zlib stream state).
+  Compressor(const Compressor&);
+  Compressor& operator = (const Compressor&);
+
+#ifdef HAVE_LIBZ
+  z_stream_s stream;
+#endif
+  bool ready;    // Whether initialization succeeded.
+  bool finished; // Whether finish() has been called.
+};
+
+// Provides streaming gzip decompression, the counterpart to
+// Compressor: input arrives incrementally via decompress() (e.g.,
+// from an io::read pipeline) and each call returns whatever output
+// could be produced so far, so neither the compressed nor the
+// decompressed data needs to be held in memory whole. Once the gzip
+// trailer has been seen finished() returns true; a stream that ends
+// without it was truncated.
+class Decompressor
+{
+public:
+  Decompressor()
+    : ready(false), done(false)
+  {
+#ifdef HAVE_LIBZ
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+
+    int code = inflateInit2(
+        &stream,
+        MAX_WBITS + 16); // Zlib magic for gzip compression / decompression.
+
+    ready = (code == Z_OK);
+#endif
+  }
+
+  ~Decompressor()
+  {
+#ifdef HAVE_LIBZ
+    if (ready) {
+      inflateEnd(&stream);
+    }
+#endif
+  }
+
+  // Returns whether the decompressor is usable (e.g., libz might not
+  // be available, or initialization might have failed).
+  bool initialized() const
+  {
+    return ready;
+  }
+
+  // Returns whether the end of the gzip stream has been reached.
+  bool finished() const
+  {
+    return done;
+  }
+
+  // Decompresses the provided input, returning whatever output it
+  // yields (possibly none if the input stops mid-block).
+  Try<std::string> decompress(const char* data, size_t length)
+  {
+#ifndef HAVE_LIBZ
+    return Error("libz is not available");
+#else
+    if (!ready) {
+      return Error("Failed to initialize zlib");
+    } else if (done) {
+      return Error("Decompression already finished");
+    }
+
+    stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+    stream.avail_in = length;
+
+    Bytef buffer[GZIP_BUFFER_SIZE];
+    std::string result = "";
+    do {
+      stream.next_out = buffer;
+      stream.avail_out = GZIP_BUFFER_SIZE;
+      int code = inflate(&stream, Z_SYNC_FLUSH);
+
+      if (code == Z_STREAM_END) {
+        done = true;
+      } else if (code != Z_OK &&
+                 !(code == Z_BUF_ERROR && stream.avail_in == 0)) {
+        // Z_BUF_ERROR with no input left just means more input is
+        // needed to make progress; everything else is a real error.
+        return Error(std::string(stream.msg));
+      }
+
+      result.append(
+          reinterpret_cast<char*>(buffer),
+          GZIP_BUFFER_SIZE - stream.avail_out);
+    } while (stream.avail_out == 0 && !done);
+
+    return result;
+#endif // HAVE_LIBZ
+  }
+
+private:
+  // Not copyable, not assignable (owns the zlib stream state).
+  Decompressor(const Decompressor&);
+  Decompressor& operator = (const Decompressor&);
+
+#ifdef HAVE_LIBZ
+  z_stream_s stream;
+#endif
+  bool ready; // Whether initialization succeeded.
+  bool done;  // Whether the gzip trailer has been seen.
+};
+
+
 // Returns a gzip compressed version of the provided string.
 // The compression level should be within the range [-1, 9].
 // See zlib.h:
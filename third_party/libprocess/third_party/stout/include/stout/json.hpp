@@ -1,6 +1,14 @@
 #ifndef __STOUT_JSON__
 #define __STOUT_JSON__
 
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h> // For memcpy.
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include <iomanip>
 #include <iostream>
 #include <list>
@@ -85,6 +93,292 @@ struct False {};
 struct Null {};
 
 
+namespace internal {
+
+// Returns the length of the longest prefix of [data, data + size) in
+// which no byte requires escaping, i.e., no '"', '\\', '/', control
+// character (below 0x20) or byte at or above 0x7F (see RFC4627 and
+// the NOTE in Renderer about non-ASCII bytes). With SSE2 the scan
+// proceeds 16 bytes a stride, so serializing a typical string (a
+// path, an id, a name) costs one scan plus one bulk append instead
+// of per-character dispatch.
+inline size_t span(const char* data, size_t size)
+{
+  size_t i = 0;
+
+#ifdef __SSE2__
+  // NOTE: SSE2 only has signed byte compares: bytes below 0x20 and
+  // bytes at or above 0x80 are both caught by a signed 'less than
+  // 0x20', leaving only 0x7F to check for equality.
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i del = _mm_set1_epi8(0x7F);
+  const __m128i low = _mm_set1_epi8(0x20);
+
+  while (i + 16 <= size) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*) (data + i));
+    __m128i bad =
+      _mm_or_si128(
+          _mm_or_si128(
+              _mm_cmpeq_epi8(chunk, quote),
+              _mm_cmpeq_epi8(chunk, backslash)),
+          _mm_or_si128(
+              _mm_or_si128(
+                  _mm_cmpeq_epi8(chunk, slash),
+                  _mm_cmpeq_epi8(chunk, del)),
+              _mm_cmplt_epi8(chunk, low)));
+
+    int mask = _mm_movemask_epi8(bad);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+
+    i += 16;
+  }
+#endif
+
+  while (i < size) {
+    unsigned char c = (unsigned char) data[i];
+    if (c < 0x20 || c >= 0x7F || c == '"' || c == '\\' || c == '/') {
+      break;
+    }
+    i++;
+  }
+
+  return i;
+}
+
+
+// Appends the escape sequence for a single byte that span() above
+// stopped on.
+inline void escape(std::string& out, unsigned char c)
+{
+  switch (c) {
+    case '"':  out += "\\\""; break;
+    case '\\': out += "\\\\"; break;
+    case '/':  out += "\\/";  break;
+    case '\b': out += "\\b";  break;
+    case '\f': out += "\\f";  break;
+    case '\n': out += "\\n";  break;
+    case '\r': out += "\\r";  break;
+    case '\t': out += "\\t";  break;
+    default: {
+      // NOTE: We also escape all bytes > 0x7F since they imply more
+      // than 1 byte in UTF-8 (this is why we don't escape UTF-8
+      // properly); see RFC4627 for the \u00XX format.
+      char buffer[8];
+      snprintf(buffer, sizeof(buffer), "\\u%04X", (unsigned int) c);
+      out += buffer;
+      break;
+    }
+  }
+}
+
+
+// Formats 'value' into 'buffer' (which must hold at least 21 bytes)
+// two digits at a time, returning a pointer past the last character
+// written. Considerably cheaper than snprintf for the integers that
+// dominate serialized numbers (counters, sizes, timestamps).
+inline char* itoa(int64_t value, char* buffer)
+{
+  static const char DIGITS[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+  char temp[20];
+  char* p = temp + sizeof(temp);
+
+  uint64_t magnitude =
+    value < 0 ? -((uint64_t) value) : (uint64_t) value;
+
+  while (magnitude >= 100) {
+    size_t index = (size_t) (magnitude % 100) * 2;
+    magnitude /= 100;
+    *--p = DIGITS[index + 1];
+    *--p = DIGITS[index];
+  }
+
+  if (magnitude >= 10) {
+    size_t index = (size_t) magnitude * 2;
+    *--p = DIGITS[index + 1];
+    *--p = DIGITS[index];
+  } else {
+    *--p = (char) ('0' + magnitude);
+  }
+
+  if (value < 0) {
+    *buffer++ = '-';
+  }
+
+  size_t length = (temp + sizeof(temp)) - p;
+  memcpy(buffer, p, length);
+  return buffer + length;
+}
+
+} // namespace internal {
+
+
+// Serializes JSON directly into one growable buffer, avoiding the
+// intermediate tree of variants (and the heap allocation per node)
+// that building an Object costs. Commas are inserted automatically;
+// the caller is responsible for invoking beginObject/endObject,
+// beginArray/endArray and key/value in a well-formed order. The
+// output is byte compatible with rendering the equivalent Object
+// modulo key order (an Object sorts its keys, a writer emits them in
+// the order written).
+class Writer
+{
+public:
+  Writer() : comma(false) {}
+
+  void beginObject()
+  {
+    separate();
+    out += '{';
+    comma = false;
+  }
+
+  void endObject()
+  {
+    out += '}';
+    comma = true;
+  }
+
+  void beginArray()
+  {
+    separate();
+    out += '[';
+    comma = false;
+  }
+
+  void endArray()
+  {
+    out += ']';
+    comma = true;
+  }
+
+  void key(const std::string& _key)
+  {
+    separate();
+    escape(_key);
+    out += ':';
+    comma = false;
+  }
+
+  void value(const std::string& _value)
+  {
+    separate();
+    escape(_value);
+    comma = true;
+  }
+
+  void value(const char* _value)
+  {
+    value(std::string(_value));
+  }
+
+  void value(double _value)
+  {
+    separate();
+
+    // Fast path for integral values (the common case: counters,
+    // sizes, ids). Only taken when '%.10g' would print the same
+    // plain integer form, i.e., at most 10 significant digits.
+    int64_t integral = (int64_t) _value;
+    if (_value == (double) integral &&
+        integral > -10000000000LL && integral < 10000000000LL) {
+      char buffer[24];
+      char* end = internal::itoa(integral, buffer);
+      out.append(buffer, end - buffer);
+    } else {
+      char buffer[32];
+      // Matches how Renderer outputs a Number (precision 10).
+      snprintf(buffer, sizeof(buffer), "%.10g", _value);
+      out += buffer;
+    }
+
+    comma = true;
+  }
+
+  // Helpers for the common case of a key followed by a leaf value.
+  void field(const std::string& _key, const std::string& _value)
+  {
+    key(_key);
+    value(_value);
+  }
+
+  void field(const std::string& _key, const char* _value)
+  {
+    key(_key);
+    value(_value);
+  }
+
+  void field(const std::string& _key, double _value)
+  {
+    key(_key);
+    value(_value);
+  }
+
+  // Appends already-serialized JSON verbatim (e.g., a cached
+  // fragment produced by another writer).
+  void append(const std::string& json)
+  {
+    separate();
+    out += json;
+    comma = true;
+  }
+
+  const std::string& str() const
+  {
+    return out;
+  }
+
+private:
+  void separate()
+  {
+    if (comma) {
+      out += ',';
+    }
+  }
+
+  // Appends the string quoted and escaped (same rules as Renderer):
+  // clean spans are located up front (see internal::span) and
+  // appended in bulk; only the occasional byte needing an escape
+  // goes through per-character dispatch.
+  void escape(const std::string& string)
+  {
+    out += '"';
+
+    const char* data = string.data();
+    const size_t size = string.size();
+
+    size_t i = 0;
+    while (i < size) {
+      size_t clean = internal::span(data + i, size - i);
+
+      if (clean > 0) {
+        out.append(data + i, clean);
+        i += clean;
+      }
+
+      if (i < size) {
+        internal::escape(out, (unsigned char) data[i]);
+        i++;
+      }
+    }
+
+    out += '"';
+  }
+
+  std::string out;
+  bool comma; // Whether the next element needs a separating comma.
+};
+
+
 // Implementation of rendering JSON objects built above using standard
 // C++ output streams. The visitor pattern is used thanks to to build
 // a "renderer" with boost::static_visitor and two top-level render
@@ -99,41 +393,43 @@ struct Renderer : boost::static_visitor<>
     // TODO(benh): This escaping DOES NOT handle unicode, it encodes as ASCII.
     // See RFC4627 for the JSON string specificiation.
     out << "\"";
-    foreach (unsigned char c, string.value) {
-      switch (c) {
-        case '"':  out << "\\\""; break;
-        case '\\': out << "\\\\"; break;
-        case '/':  out << "\\/";  break;
-        case '\b': out << "\\b";  break;
-        case '\f': out << "\\f";  break;
-        case '\n': out << "\\n";  break;
-        case '\r': out << "\\r";  break;
-        case '\t': out << "\\t";  break;
-        default:
-          // See RFC4627 for these ranges.
-          if ((c >= 0x20 && c <= 0x21) ||
-              (c >= 0x23 && c <= 0x5B) ||
-              (c >= 0x5D && c < 0x7F)) {
-            out << c;
-          } else {
-            // NOTE: We also escape all bytes > 0x7F since they imply more than
-            // 1 byte in UTF-8. This is why we don't escape UTF-8 properly.
-            // See RFC4627 for the escaping format: \uXXXX (X is a hex digit).
-            // Each byte here will be of the form: \u00XX (this is why we need
-            // setw and the cast to unsigned int).
-            out << "\\u" << std::setfill('0') << std::setw(4)
-                << std::hex << std::uppercase << (unsigned int) c;
-          }
-          break;
+
+    const char* data = string.value.data();
+    const size_t size = string.value.size();
+
+    size_t i = 0;
+    while (i < size) {
+      size_t clean = internal::span(data + i, size - i);
+
+      if (clean > 0) {
+        out.write(data + i, clean);
+        i += clean;
+      }
+
+      if (i < size) {
+        std::string escaped;
+        internal::escape(escaped, (unsigned char) data[i]);
+        out << escaped;
+        i++;
       }
     }
+
     out << "\"";
   }
 
   void operator () (const Number& number) const
   {
-    out.precision(10);
-    out << number.value;
+    // Fast path for integral values; see Writer::value(double).
+    int64_t integral = (int64_t) number.value;
+    if (number.value == (double) integral &&
+        integral > -10000000000LL && integral < 10000000000LL) {
+      char buffer[24];
+      char* end = internal::itoa(integral, buffer);
+      out.write(buffer, end - buffer);
+    } else {
+      out.precision(10);
+      out << number.value;
+    }
   }
 
   void operator () (const Object& object) const
@@ -2,108 +2,189 @@
 #define __STOUT_MULTIHASHMAP_HPP__
 
 #include <algorithm> // For find.
-#include <list>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include <boost/unordered_map.hpp>
 
+#include "foreach.hpp"
 
-// Implementation of a hash multimap via Boost's 'unordered_multimap'
-// but with a better interface. The rationale for creating this is
-// that the std::multimap interface is painful to use (requires lots
-// of iterator garbage, as well as the use of 'equal_range' which
-// makes for cluttered code).
+
+// Implementation of a hash multimap with a better interface than
+// std::multimap (which requires lots of iterator garbage, as well as
+// the use of 'equal_range' which makes for cluttered code). Values
+// for a key are stored contiguously in a vector rather than a node
+// per value like unordered_multimap, so putting N values for a key
+// costs one growing allocation instead of N and getting them walks a
+// contiguous array. Note that get() returns a snapshot of the values
+// rather than a live view since callers commonly remove values while
+// iterating over the result of a get().
 template <typename K, typename V>
-class multihashmap : public boost::unordered_multimap<K, V>
+class multihashmap
 {
-public:
-  void put(const K& key, const V& value);
-  std::list<V> get(const K& key) const;
-  std::set<K> keys() const;
-  bool remove(const K& key);
-  bool remove(const K& key, const V& value);
-  bool contains(const K& key) const;
-  bool contains(const K& key, const V& value) const;
-};
+private:
+  typedef boost::unordered_map<K, std::vector<V> > Map;
 
+  Map map;
+  size_t count; // Total number of values (i.e., size()).
 
-template <typename K, typename V>
-void multihashmap<K, V>::put(const K& key, const V& value)
-{
-  boost::unordered_multimap<K, V>::insert(std::pair<K, V>(key, value));
-}
+public:
+  multihashmap() : count(0) {}
+
+  // Iterates over every (key, value) pair, presenting each as a pair
+  // like std::multimap does. Values for a key are visited in
+  // insertion order. Iterators are read only and are invalidated by
+  // put/remove.
+  class const_iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::pair<K, V> value_type;
+    typedef std::pair<const K&, const V&> reference;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type* pointer;
+
+    const_iterator() : index(0) {}
+
+    explicit const_iterator(const typename Map::const_iterator& _outer)
+      : outer(_outer), index(0) {}
+
+    reference operator * () const
+    {
+      return reference(outer->first, outer->second[index]);
+    }
 
+    // Helper so that 'it->first' works even though dereferencing
+    // produces a proxy pair of references rather than a real pair.
+    struct Proxy
+    {
+      explicit Proxy(const reference& _pair) : pair(_pair) {}
+      const reference* operator -> () const { return &pair; }
+      reference pair;
+    };
+
+    Proxy operator -> () const { return Proxy(**this); }
+
+    const_iterator& operator ++ ()
+    {
+      if (++index >= outer->second.size()) {
+        ++outer;
+        index = 0;
+      }
+      return *this;
+    }
 
-template <typename K, typename V>
-std::list<V> multihashmap<K, V>::get(const K& key) const
-{
-  std::list<V> values; // Values to return.
+    const_iterator operator ++ (int)
+    {
+      const_iterator temp = *this;
+      ++*this;
+      return temp;
+    }
 
-  std::pair<typename boost::unordered_multimap<K, V>::const_iterator,
-    typename boost::unordered_multimap<K, V>::const_iterator> range;
+    bool operator == (const const_iterator& that) const
+    {
+      return outer == that.outer && index == that.index;
+    }
 
-  range = boost::unordered_multimap<K, V>::equal_range(key);
+    bool operator != (const const_iterator& that) const
+    {
+      return !(*this == that);
+    }
 
-  typename boost::unordered_multimap<K, V>::const_iterator i;
-  for (i = range.first; i != range.second; ++i) {
-    values.push_back(i->second);
-  }
+  private:
+    typename Map::const_iterator outer;
+    size_t index;
+  };
 
-  return values;
-}
+  typedef const_iterator iterator;
 
+  const_iterator begin() const
+  {
+    return const_iterator(map.begin());
+  }
 
-template <typename K, typename V>
-std::set<K> multihashmap<K, V>::keys() const
-{
-  std::set<K> keys;
-  foreachkey (const K& key, *this) {
-    keys.insert(key);
+  const_iterator end() const
+  {
+    return const_iterator(map.end());
   }
-  return keys;
-}
 
+  size_t size() const { return count; }
 
-template <typename K, typename V>
-bool multihashmap<K, V>::remove(const K& key)
-{
-  return boost::unordered_multimap<K, V>::erase(key) > 0;
-}
+  bool empty() const { return count == 0; }
 
+  void put(const K& key, const V& value)
+  {
+    map[key].push_back(value);
+    count++;
+  }
 
-template <typename K, typename V>
-bool multihashmap<K, V>::remove(const K& key, const V& value)
-{
-  std::pair<typename boost::unordered_multimap<K, V>::iterator,
-    typename boost::unordered_multimap<K, V>::iterator> range;
+  std::vector<V> get(const K& key) const
+  {
+    typename Map::const_iterator it = map.find(key);
+    if (it == map.end()) {
+      return std::vector<V>();
+    }
+    return it->second;
+  }
 
-  range = boost::unordered_multimap<K, V>::equal_range(key);
+  std::set<K> keys() const
+  {
+    std::set<K> keys;
+    foreachkey (const K& key, map) {
+      keys.insert(key);
+    }
+    return keys;
+  }
 
-  typename boost::unordered_multimap<K, V>::iterator i;
-  for (i = range.first; i != range.second; ++i) {
-    if (i->second == value) {
-      boost::unordered_multimap<K, V>::erase(i);
-      return true;
+  bool remove(const K& key)
+  {
+    typename Map::iterator it = map.find(key);
+    if (it == map.end()) {
+      return false;
     }
+    count -= it->second.size();
+    map.erase(it);
+    return true;
   }
 
-  return false;
-}
+  bool remove(const K& key, const V& value)
+  {
+    typename Map::iterator it = map.find(key);
+    if (it == map.end()) {
+      return false;
+    }
 
+    typename std::vector<V>::iterator position =
+      std::find(it->second.begin(), it->second.end(), value);
 
-template <typename K, typename V>
-bool multihashmap<K, V>::contains(const K& key) const
-{
-  return multihashmap<K, V>::count(key) > 0;
-}
+    if (position == it->second.end()) {
+      return false;
+    }
 
+    it->second.erase(position);
+    if (it->second.empty()) {
+      map.erase(it);
+    }
 
-template <typename K, typename V>
-bool multihashmap<K, V>::contains(const K& key, const V& value) const
-{
-  const std::list<V>& values = get(key);
-  return std::find(values.begin(), values.end(), value) != values.end();
-}
+    count--;
+    return true;
+  }
+
+  bool contains(const K& key) const
+  {
+    return map.find(key) != map.end();
+  }
+
+  bool contains(const K& key, const V& value) const
+  {
+    typename Map::const_iterator it = map.find(key);
+    if (it == map.end()) {
+      return false;
+    }
+    return std::find(it->second.begin(), it->second.end(), value) !=
+      it->second.end();
+  }
+};
 
 #endif // __STOUT_MULTIHASHMAP_HPP__
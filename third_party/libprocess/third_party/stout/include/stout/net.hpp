@@ -14,6 +14,7 @@
 
 #include <string>
 
+#include "bytes.hpp"
 #include "error.hpp"
 #include "os.hpp"
 #include "try.hpp"
@@ -23,8 +24,13 @@
 namespace net {
 
 // Returns the HTTP response code resulting from attempting to download the
-// specified HTTP or FTP URL into a file at the specified path.
-inline Try<int> download(const std::string& url, const std::string& path)
+// specified HTTP or FTP URL into a file at the specified path. An optional
+// 'limit' caps the transfer rate at that many bytes per second (0 means
+// unlimited).
+inline Try<int> download(
+    const std::string& url,
+    const std::string& path,
+    const Bytes& limit = Bytes(0))
 {
 #ifndef HAVE_LIBCURL
   return Error("libcurl is not available");
@@ -48,6 +54,13 @@ inline Try<int> download(const std::string& url, const std::string& path)
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, NULL);
 
+  if (limit.bytes() > 0) {
+    curl_easy_setopt(
+        curl,
+        CURLOPT_MAX_RECV_SPEED_LARGE,
+        (curl_off_t) limit.bytes());
+  }
+
   FILE* file = fdopen(fd.get(), "w");
   if (file == NULL) {
     return ErrnoError("Failed to open file handle of '" + path + "'");
@@ -36,6 +36,7 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "duration.hpp"
 #include "error.hpp"
@@ -726,13 +727,127 @@ inline std::list<std::string> ls(const std::string& directory)
 }
 
 
+// Iterates over the entries of a directory one at a time instead of
+// materializing them all into a list like ls(), so that walking a
+// directory with hundreds of thousands of entries (e.g., an executor
+// sandbox) uses constant memory: the dirent buffer is allocated once
+// and reused for every entry. If 'recursive' is true the walk
+// descends depth-first into subdirectories (without following
+// symbolic links) and also yields the subdirectories themselves.
+// Entries are yielded as paths relative to the starting directory.
+class DirectoryWalker
+{
+public:
+  explicit DirectoryWalker(
+      const std::string& _directory,
+      bool _recursive = false)
+    : directory(_directory), recursive(_recursive), buffer(NULL)
+  {
+    push("");
+  }
+
+  ~DirectoryWalker()
+  {
+    for (size_t i = 0; i < stack.size(); i++) {
+      closedir(stack[i].dir);
+    }
+    free(buffer);
+  }
+
+  // Returns the next entry, or none once the walk is finished (like
+  // ls(), errors reading a directory just terminate it early).
+  Option<std::string> next()
+  {
+    while (!stack.empty()) {
+      DIR* dir = stack.back().dir;
+      const std::string prefix = stack.back().prefix;
+
+      dirent* entry;
+      if (readdir_r(dir, buffer, &entry) != 0 || entry == NULL) {
+        closedir(dir);
+        stack.pop_back();
+        continue;
+      }
+
+      if (strcmp(entry->d_name, ".") == 0 ||
+          strcmp(entry->d_name, "..") == 0) {
+        continue;
+      }
+
+      std::string result = prefix + entry->d_name;
+
+      if (recursive) {
+        std::string path = path::join(directory, result);
+        if (isdir(path) && !islink(path)) {
+          push(result + "/");
+        }
+      }
+
+      return result;
+    }
+
+    return None();
+  }
+
+private:
+  // Not copyable, not assignable (owns the open directories).
+  DirectoryWalker(const DirectoryWalker&);
+  DirectoryWalker& operator = (const DirectoryWalker&);
+
+  struct Level
+  {
+    DIR* dir;
+    std::string prefix;
+  };
+
+  void push(const std::string& prefix)
+  {
+    DIR* dir = opendir(path::join(directory, prefix).c_str());
+
+    if (dir == NULL) {
+      return;
+    }
+
+    if (buffer == NULL) {
+      // Calculate the size for a "directory entry" (see ls() above);
+      // the buffer gets reused for every entry at every level.
+      long name_max = fpathconf(dirfd(dir), _PC_NAME_MAX);
+
+      if (name_max == -1) {
+        name_max = (NAME_MAX > 255) ? NAME_MAX : 255;
+      }
+
+      size_t name_end =
+        (size_t) offsetof(dirent, d_name) + name_max + 1;
+
+      buffer = (dirent*) malloc(
+          name_end > sizeof(dirent) ? name_end : sizeof(dirent));
+
+      if (buffer == NULL) {
+        closedir(dir);
+        return;
+      }
+    }
+
+    Level level;
+    level.dir = dir;
+    level.prefix = prefix;
+    stack.push_back(level);
+  }
+
+  const std::string directory;
+  const bool recursive;
+  dirent* buffer;
+  std::vector<Level> stack;
+};
+
+
 // Return the list of file paths that match the given pattern by recursively
 // searching the given directory. A match is successful if the pattern is a
 // substring of the file name.
 // NOTE: Directory path should not end with '/'.
 // NOTE: Symbolic links are not followed.
 // TODO(vinod): Support regular expressions for pattern.
-// TODO(vinod): Consider using ftw or a non-recursive approach.
 inline Try<std::list<std::string> > find(
     const std::string& directory,
     const std::string& pattern)
@@ -743,22 +858,22 @@ inline Try<std::list<std::string> > find(
     return Error("'" + directory + "' is not a directory");
   }
 
-  foreach (const std::string& entry, ls(directory)) {
-    std::string path = path::join(directory, entry);
-    // If it's a directory, recurse.
-    if (isdir(path) && !islink(path)) {
-      Try<std::list<std::string> > matches = find(path, pattern);
-      if (matches.isError()) {
-        return matches;
-      }
-      foreach (const std::string& match, matches.get()) {
-        results.push_back(match);
-      }
-    } else {
-      if (entry.find(pattern) != std::string::npos) {
+  DirectoryWalker walker(directory, true);
+
+  Option<std::string> entry = walker.next();
+  while (entry.isSome()) {
+    std::string path = path::join(directory, entry.get());
+    if (!isdir(path) || islink(path)) {
+      // Match against the file name, not the directories leading up
+      // to it.
+      size_t index = entry.get().rfind('/');
+      std::string name =
+        index == std::string::npos ? entry.get() : entry.get().substr(index + 1);
+      if (name.find(pattern) != std::string::npos) {
         results.push_back(path); // Matched the file pattern!
       }
     }
+    entry = walker.next();
   }
 
   return results;
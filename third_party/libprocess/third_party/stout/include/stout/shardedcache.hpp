@@ -0,0 +1,196 @@
+#ifndef __STOUT_SHARDEDCACHE_HPP__
+#define __STOUT_SHARDEDCACHE_HPP__
+
+#include <pthread.h>
+#include <time.h>
+
+#include <list>
+
+#include <tr1/unordered_map>
+
+#include <boost/functional/hash.hpp>
+
+#include "duration.hpp"
+#include "none.hpp"
+#include "option.hpp"
+
+// Provides an internally synchronized least-recently used (LRU)
+// cache, unlike stout::cache which requires external locking. The
+// entries are split across shards by key hash, each protected by its
+// own mutex, so concurrent callers hitting different shards do not
+// serialize on one lock.
+//
+// Eviction is by accounted size rather than entry count: the
+// capacity is in bytes and put() charges each entry the number of
+// bytes the caller says it occupies (defaulting to the in-line size
+// of the key and value, appropriate for flat types; callers caching
+// strings or similar should pass the real footprint). Each shard
+// evicts from its own LRU order when over its share of the budget,
+// so the bound is approximate at shard granularity. An entry larger
+// than a whole shard's share will not stay cached.
+//
+// If a TTL is given, entries older than it are treated as misses and
+// dropped lazily when encountered.
+template <typename Key, typename Value, typename Hash = boost::hash<Key> >
+class shardedcache
+{
+public:
+  explicit shardedcache(
+      size_t _capacity,
+      const Option<Duration>& _ttl = None())
+    : capacity(_capacity / SHARDS), ttl(_ttl)
+  {
+    for (size_t i = 0; i < SHARDS; i++) {
+      pthread_mutex_init(&shards[i].mutex, NULL);
+      shards[i].bytes = 0;
+    }
+  }
+
+  ~shardedcache()
+  {
+    for (size_t i = 0; i < SHARDS; i++) {
+      pthread_mutex_destroy(&shards[i].mutex);
+    }
+  }
+
+  void put(
+      const Key& key,
+      const Value& value,
+      size_t bytes = sizeof(Key) + sizeof(Value))
+  {
+    Shard& shard = shards[Hash()(key) % SHARDS];
+
+    pthread_mutex_lock(&shard.mutex);
+
+    typename Shard::map::iterator i = shard.values.find(key);
+    if (i != shard.values.end()) {
+      remove(shard, i);
+    }
+
+    typename std::list<Key>::iterator position =
+      shard.keys.insert(shard.keys.end(), key);
+
+    Entry entry;
+    entry.value = value;
+    entry.bytes = bytes;
+    entry.expiration = expiration();
+    entry.position = position;
+    shard.values.insert(std::make_pair(key, entry));
+    shard.bytes += bytes;
+
+    // Evict least-recently used entries while over budget. Note
+    // that an entry bigger than the whole budget evicts everything,
+    // itself included.
+    while (shard.bytes > capacity && !shard.keys.empty()) {
+      typename Shard::map::iterator j = shard.values.find(shard.keys.front());
+      remove(shard, j);
+    }
+
+    pthread_mutex_unlock(&shard.mutex);
+  }
+
+  Option<Value> get(const Key& key)
+  {
+    Shard& shard = shards[Hash()(key) % SHARDS];
+
+    pthread_mutex_lock(&shard.mutex);
+
+    typename Shard::map::iterator i = shard.values.find(key);
+    if (i == shard.values.end()) {
+      pthread_mutex_unlock(&shard.mutex);
+      return None();
+    }
+
+    if (expired(i->second)) {
+      remove(shard, i);
+      pthread_mutex_unlock(&shard.mutex);
+      return None();
+    }
+
+    // A read counts as a use: move to the back of the LRU order.
+    shard.keys.splice(shard.keys.end(), shard.keys, i->second.position);
+    i->second.position = --shard.keys.end();
+
+    Option<Value> value = i->second.value;
+    pthread_mutex_unlock(&shard.mutex);
+    return value;
+  }
+
+  void erase(const Key& key)
+  {
+    Shard& shard = shards[Hash()(key) % SHARDS];
+
+    pthread_mutex_lock(&shard.mutex);
+    typename Shard::map::iterator i = shard.values.find(key);
+    if (i != shard.values.end()) {
+      remove(shard, i);
+    }
+    pthread_mutex_unlock(&shard.mutex);
+  }
+
+  // Returns the total bytes currently charged (approximate while
+  // other threads are mutating).
+  size_t size() const
+  {
+    size_t total = 0;
+    for (size_t i = 0; i < SHARDS; i++) {
+      pthread_mutex_lock(&shards[i].mutex);
+      total += shards[i].bytes;
+      pthread_mutex_unlock(&shards[i].mutex);
+    }
+    return total;
+  }
+
+private:
+  // Not copyable, not assignable (owns mutexes).
+  shardedcache(const shardedcache&);
+  shardedcache& operator = (const shardedcache&);
+
+  static const size_t SHARDS = 16;
+
+  struct Entry
+  {
+    Value value;
+    size_t bytes;
+    time_t expiration; // 0 when no TTL is configured.
+    typename std::list<Key>::iterator position;
+  };
+
+  struct Shard
+  {
+    typedef std::tr1::unordered_map<Key, Entry, Hash> map;
+
+    mutable pthread_mutex_t mutex;
+    map values;
+    std::list<Key> keys; // Ordered least-recently used first.
+    size_t bytes;        // Currently charged to this shard.
+  };
+
+  time_t expiration() const
+  {
+    return ttl.isSome()
+      ? time(NULL) + static_cast<time_t>(ttl.get().secs())
+      : 0;
+  }
+
+  bool expired(const Entry& entry) const
+  {
+    return entry.expiration != 0 && time(NULL) >= entry.expiration;
+  }
+
+  // Drops the entry at 'i', updating the charge and the LRU order.
+  // Must be called with the shard's mutex held.
+  void remove(Shard& shard, typename Shard::map::iterator i)
+  {
+    shard.bytes -= i->second.bytes;
+    shard.keys.erase(i->second.position);
+    shard.values.erase(i);
+  }
+
+  const size_t capacity; // Byte budget per shard.
+  const Option<Duration> ttl;
+
+  Shard shards[SHARDS];
+};
+
+#endif // __STOUT_SHARDEDCACHE_HPP__
@@ -135,6 +135,70 @@ inline std::vector<std::string> split(
 }
 
 
+// Iterates over the tokens of a string without copying them: each
+// call to next() yields a (pointer, length) piece of the original
+// string, which must therefore outlive the tokenizer. By default
+// empty tokens are skipped, like tokenize(); pass allowEmpty to get
+// the split() semantics instead (note that split() always yields at
+// least one, possibly empty, token). This avoids the vector and the
+// string per token that tokenize() and split() allocate, which
+// matters in hot paths like HTTP request routing.
+class Tokenizer
+{
+public:
+  Tokenizer(const std::string& _s,
+            const char* _delims,
+            bool _allowEmpty = false)
+    : s(_s), delims(_delims), allowEmpty(_allowEmpty),
+      offset(0), done(false) {}
+
+  // Stores the next token in (data, length) and returns true, or
+  // returns false when the tokens are exhausted.
+  bool next(const char** data, size_t* length)
+  {
+    if (allowEmpty) {
+      if (done) {
+        return false;
+      }
+
+      *data = s.data() + offset;
+      size_t next = s.find_first_of(delims, offset);
+      if (next == std::string::npos) {
+        *length = s.size() - offset;
+        done = true;
+      } else {
+        *length = next - offset;
+        offset = next + 1;
+      }
+      return true;
+    }
+
+    size_t i = s.find_first_not_of(delims, offset);
+    if (i == std::string::npos) {
+      offset = s.size();
+      return false;
+    }
+
+    size_t j = s.find_first_of(delims, i);
+    if (j == std::string::npos) {
+      j = s.size();
+    }
+
+    *data = s.data() + i;
+    *length = j - i;
+    offset = j;
+    return true;
+  }
+
+private:
+  const std::string& s;
+  const char* delims;
+  const bool allowEmpty;
+  size_t offset;
+  bool done;
+};
+
+
 // Returns a map of strings to strings based on calling tokenize
 // twice. All non-pairs are discarded. For example:
 //
@@ -8,23 +8,29 @@
 #include <string>
 
 
-template <typename T>
+// The default error type is a std::string holding a human readable
+// message. Hot paths where errors are expected and frequent (and so
+// shouldn't pay for constructing throwaway strings) can use a
+// lightweight error type instead, e.g., Try<T, ErrorCode> (see
+// stout/error.hpp), which formats a message only when one is
+// actually asked for.
+template <typename T, typename E = std::string>
 class Try
 {
 public:
-  static Try<T> some(const T& t)
+  static Try<T, E> some(const T& t)
   {
-    return Try<T>(SOME, new T(t));
+    return Try<T, E>(SOME, new T(t));
   }
 
-  static Try<T> error(const std::string& message)
+  static Try<T, E> error(const E& e)
   {
-    return Try<T>(ERROR, NULL, message);
+    return Try<T, E>(ERROR, NULL, e);
   }
 
   Try(const T& _t) : state(SOME), t(new T(_t)) {}
 
-  Try(const Try<T>& that)
+  Try(const Try<T, E>& that)
   {
     state = that.state;
     if (that.t != NULL) {
@@ -32,7 +38,7 @@ public:
     } else {
       t = NULL;
     }
-    message = that.message;
+    e = that.e;
   }
 
   ~Try()
@@ -40,7 +46,7 @@ public:
     delete t;
   }
 
-  Try<T>& operator = (const Try<T>& that)
+  Try<T, E>& operator = (const Try<T, E>& that)
   {
     if (this != &that) {
       delete t;
@@ -50,7 +56,7 @@ public:
       } else {
         t = NULL;
       }
-      message = that.message;
+      e = that.e;
     }
 
     return *this;
@@ -68,7 +74,7 @@ public:
     return *t;
   }
 
-  std::string error() const { assert(state == ERROR); return message; }
+  E error() const { assert(state == ERROR); return e; }
 
 private:
   enum State {
@@ -76,12 +82,12 @@ private:
     ERROR
   };
 
-  Try(State _state, T* _t = NULL, const std::string& _message = "")
-    : state(_state), t(_t), message(_message) {}
+  Try(State _state, T* _t = NULL, const E& _e = E())
+    : state(_state), t(_t), e(_e) {}
 
   State state;
   T* t;
-  std::string message;
+  E e;
 };
 
 
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <gmock/gmock.h>
+
+#include <string>
+
+#include <stout/densehashmap.hpp>
+#include <stout/foreach.hpp>
+#include <stout/gtest.hpp>
+
+using std::string;
+
+
+TEST(DenseHashMapTest, Insert)
+{
+  densehashmap<string, int> map;
+  map["abc"] = 1;
+  map["def"] = 2;
+
+  ASSERT_SOME_EQ(1, map.get("abc"));
+  ASSERT_SOME_EQ(2, map.get("def"));
+  ASSERT_EQ(2u, map.size());
+
+  map["def"] = 4;
+  ASSERT_SOME_EQ(4, map.get("def"));
+  ASSERT_EQ(2u, map.size());
+}
+
+
+TEST(DenseHashMapTest, Contains)
+{
+  densehashmap<string, int> map;
+  map["abc"] = 1;
+
+  ASSERT_TRUE(map.contains("abc"));
+  ASSERT_FALSE(map.contains("def"));
+  ASSERT_TRUE(map.get("def").isNone());
+}
+
+
+TEST(DenseHashMapTest, Erase)
+{
+  densehashmap<int, int> map;
+
+  // Enough entries to force growth and plenty of collisions.
+  for (int i = 0; i < 1000; i++) {
+    map[i] = i * 2;
+  }
+  ASSERT_EQ(1000u, map.size());
+
+  for (int i = 0; i < 1000; i += 2) {
+    ASSERT_EQ(1u, map.erase(i));
+  }
+  ASSERT_EQ(0u, map.erase(0));
+  ASSERT_EQ(500u, map.size());
+
+  // The remaining entries must still be reachable after the
+  // backward shifting done by erase.
+  for (int i = 0; i < 1000; i++) {
+    if (i % 2 == 0) {
+      ASSERT_FALSE(map.contains(i));
+    } else {
+      ASSERT_SOME_EQ(i * 2, map.get(i));
+    }
+  }
+}
+
+
+TEST(DenseHashMapTest, Foreach)
+{
+  densehashmap<string, int> map;
+  map["abc"] = 1;
+  map["def"] = 2;
+
+  int sum = 0;
+  foreachvalue (int value, map) {
+    sum += value;
+  }
+  ASSERT_EQ(3, sum);
+
+  foreachpair (const string& key, int value, map) {
+    if (key == "abc") {
+      ASSERT_EQ(1, value);
+    } else {
+      ASSERT_EQ("def", key);
+      ASSERT_EQ(2, value);
+    }
+  }
+
+  ASSERT_EQ(2u, map.keys().size());
+  ASSERT_TRUE(map.keys().contains("abc"));
+  ASSERT_TRUE(map.values().contains(2));
+}
@@ -2,6 +2,7 @@
 
 #include <gmock/gmock.h>
 
+#include <algorithm>
 #include <string>
 
 #include <stout/gtest.hpp>
@@ -50,4 +51,47 @@ TEST(GzipTest, CompressDecompressString)
   ASSERT_SOME(decompressed);
   ASSERT_EQ(s, decompressed.get());
 }
+
+
+TEST(GzipTest, StreamingCompressDecompress)
+{
+  // A 1MB random string, fed through in chunks.
+  string s;
+  while (s.length() < (1024 * 1024)) {
+    s.append(1, ' ' + (rand() % ('~' - ' ')));
+  }
+
+  gzip::Compressor compressor;
+  ASSERT_TRUE(compressor.initialized());
+
+  gzip::Decompressor decompressor;
+  ASSERT_TRUE(decompressor.initialized());
+
+  // Feed each compressed chunk straight into the decompressor, the
+  // way an io::read pipeline would.
+  string decompressed;
+  size_t chunk = 4096;
+  for (size_t offset = 0; offset < s.length(); offset += chunk) {
+    Try<string> compressed =
+      compressor.compress(s.data() + offset, std::min(chunk, s.length() - offset));
+    ASSERT_SOME(compressed);
+
+    Try<string> output =
+      decompressor.decompress(compressed.get().data(), compressed.get().length());
+    ASSERT_SOME(output);
+    decompressed += output.get();
+  }
+
+  Try<string> trailer = compressor.finish();
+  ASSERT_SOME(trailer);
+  ASSERT_FALSE(decompressor.finished());
+
+  Try<string> output =
+    decompressor.decompress(trailer.get().data(), trailer.get().length());
+  ASSERT_SOME(output);
+  decompressed += output.get();
+
+  ASSERT_TRUE(decompressor.finished());
+  ASSERT_EQ(s, decompressed);
+}
 #endif // HAVE_LIBZ
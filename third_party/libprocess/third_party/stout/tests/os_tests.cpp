@@ -160,6 +160,44 @@ TEST_F(OsTest, find)
 }
 
 
+TEST_F(OsTest, directoryWalker)
+{
+  ASSERT_SOME(os::mkdir(tmpdir + "/dir1/dir2"));
+  ASSERT_SOME(os::touch(tmpdir + "/file1"));
+  ASSERT_SOME(os::touch(tmpdir + "/dir1/file2"));
+  ASSERT_SOME(os::touch(tmpdir + "/dir1/dir2/file3"));
+
+  // A non-recursive walk yields just the top level entries.
+  hashset<string> entries;
+  os::DirectoryWalker walker(tmpdir);
+  Option<string> entry = walker.next();
+  while (entry.isSome()) {
+    entries.insert(entry.get());
+    entry = walker.next();
+  }
+
+  ASSERT_EQ(2u, entries.size());
+  ASSERT_TRUE(entries.contains("dir1"));
+  ASSERT_TRUE(entries.contains("file1"));
+
+  // A recursive walk also yields everything underneath.
+  entries.clear();
+  os::DirectoryWalker recursive(tmpdir, true);
+  entry = recursive.next();
+  while (entry.isSome()) {
+    entries.insert(entry.get());
+    entry = recursive.next();
+  }
+
+  ASSERT_EQ(5u, entries.size());
+  ASSERT_TRUE(entries.contains("dir1"));
+  ASSERT_TRUE(entries.contains("file1"));
+  ASSERT_TRUE(entries.contains("dir1/file2"));
+  ASSERT_TRUE(entries.contains("dir1/dir2"));
+  ASSERT_TRUE(entries.contains("dir1/dir2/file3"));
+}
+
+
 TEST_F(OsTest, uname)
 {
   Try<os::UTSInfo> info = os::uname();
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <stout/duration.hpp>
+#include <stout/gtest.hpp>
+#include <stout/shardedcache.hpp>
+
+using std::string;
+
+
+TEST(ShardedCacheTest, PutGet)
+{
+  shardedcache<string, int> cache(16 * 1024);
+
+  cache.put("foo", 1);
+  cache.put("bar", 2);
+
+  ASSERT_SOME_EQ(1, cache.get("foo"));
+  ASSERT_SOME_EQ(2, cache.get("bar"));
+  ASSERT_TRUE(cache.get("baz").isNone());
+
+  cache.put("foo", 3);
+  ASSERT_SOME_EQ(3, cache.get("foo"));
+
+  cache.erase("foo");
+  ASSERT_TRUE(cache.get("foo").isNone());
+  ASSERT_SOME_EQ(2, cache.get("bar"));
+}
+
+
+TEST(ShardedCacheTest, Evict)
+{
+  // All keys hash to some shard with a 16th of the budget; charging
+  // each entry enough to only fit a couple per shard forces the
+  // least-recently used ones out.
+  shardedcache<int, int> cache(16 * 32);
+
+  for (int i = 0; i < 1000; i++) {
+    cache.put(i, i, 16);
+  }
+
+  // Everything still cached fits in the budget, and the last entry
+  // inserted into its shard must still be there.
+  EXPECT_LE(cache.size(), 16u * 32u);
+  ASSERT_SOME_EQ(999, cache.get(999));
+}
+
+
+TEST(ShardedCacheTest, Ttl)
+{
+  // A zero TTL expires entries immediately.
+  shardedcache<string, int> expiring(16 * 1024, Seconds(0.0));
+  expiring.put("foo", 1);
+  ASSERT_TRUE(expiring.get("foo").isNone());
+
+  shardedcache<string, int> cache(16 * 1024, Seconds(60.0));
+  cache.put("foo", 1);
+  ASSERT_SOME_EQ(1, cache.get("foo"));
+}
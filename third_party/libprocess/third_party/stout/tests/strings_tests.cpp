@@ -144,6 +144,56 @@ TEST(StringsTest, TokenizeDelimOnlyString)
 }
 
 
+TEST(StringsTest, Tokenizer)
+{
+  const string s = "/foo//bar/baz/";
+
+  strings::Tokenizer tokenizer(s, "/");
+  const char* data;
+  size_t length;
+
+  ASSERT_TRUE(tokenizer.next(&data, &length));
+  EXPECT_EQ("foo", string(data, length));
+  ASSERT_TRUE(tokenizer.next(&data, &length));
+  EXPECT_EQ("bar", string(data, length));
+  ASSERT_TRUE(tokenizer.next(&data, &length));
+  EXPECT_EQ("baz", string(data, length));
+  ASSERT_FALSE(tokenizer.next(&data, &length));
+
+  // The pieces point into the original string: no copies are made.
+  strings::Tokenizer pieces(s, "/");
+  ASSERT_TRUE(pieces.next(&data, &length));
+  EXPECT_EQ(s.data() + 1, data);
+}
+
+
+TEST(StringsTest, TokenizerAllowEmpty)
+{
+  const string s = "a,,b,";
+
+  strings::Tokenizer tokenizer(s, ",", true);
+  const char* data;
+  size_t length;
+
+  ASSERT_TRUE(tokenizer.next(&data, &length));
+  EXPECT_EQ("a", string(data, length));
+  ASSERT_TRUE(tokenizer.next(&data, &length));
+  EXPECT_EQ("", string(data, length));
+  ASSERT_TRUE(tokenizer.next(&data, &length));
+  EXPECT_EQ("b", string(data, length));
+  ASSERT_TRUE(tokenizer.next(&data, &length));
+  EXPECT_EQ("", string(data, length));
+  ASSERT_FALSE(tokenizer.next(&data, &length));
+
+  // Like split(), an empty string yields one empty token.
+  const string empty = "";
+  strings::Tokenizer none(empty, ",", true);
+  ASSERT_TRUE(none.next(&data, &length));
+  EXPECT_EQ(0u, length);
+  ASSERT_FALSE(none.next(&data, &length));
+}
+
+
 TEST(StringsTest, SplitEmptyString)
 {
   vector<string> tokens = strings::split("", ",");